@@ -66,9 +66,12 @@ IF(CPU_i386 OR CPU_amd64)
 			SET(SSSE3_FLAG "/arch:SSE2")
 			SET(SSE41_FLAG "/arch:SSE2")
 		ENDIF(CPU_i386)
+		# AVX2 always requires /arch:AVX2 with MSVC.
+		SET(AVX2_FLAG "/arch:AVX2")
 		IF(CMAKE_CXX_COMPILER_ID STREQUAL Clang)
 			SET(SSSE3_FLAG "-mssse3")
 			SET(SSE41_FLAG "-msse4.1")
+			SET(AVX2_FLAG "-mavx2")
 		ENDIF(CMAKE_CXX_COMPILER_ID STREQUAL Clang)
 	ELSE()
 		IF(CPU_i386)
@@ -77,5 +80,6 @@ IF(CPU_i386 OR CPU_amd64)
 		ENDIF(CPU_i386)
 		SET(SSSE3_FLAG "-mssse3")
 		SET(SSE41_FLAG "-msse4.1")
+		SET(AVX2_FLAG "-mavx2")
 	ENDIF()
 ENDIF(CPU_i386 OR CPU_amd64)
@@ -519,8 +519,12 @@ static void mapDecompressedData(Pixel32* pOutput, uint32_t width, const Pixel32*
 		}
 	}
 }
+// rom-properties: Added firstRow and lastRow to decompress a band of word rows.
+// Each iteration decodes the bottom half of word row (wordY) and the top half
+// of word row (wordY+1), so bands starting at firstRow never overlap.
 template<bool PVRTCII>
-static uint32_t pvrtcDecompress(uint8_t* pCompressedData, Pixel32* pDecompressedData, uint32_t width, uint32_t height, uint8_t bpp)
+static uint32_t pvrtcDecompress(uint8_t* pCompressedData, Pixel32* pDecompressedData, uint32_t width, uint32_t height, uint8_t bpp,
+	uint32_t firstRow, uint32_t lastRow)
 {
 	uint32_t wordWidth = 4;
 	uint32_t wordHeight = 4;
@@ -538,7 +542,7 @@ static uint32_t pvrtcDecompress(uint8_t* pCompressedData, Pixel32* pDecompressed
 	std::vector<Pixel32> pPixels(wordWidth * wordHeight * sizeof(Pixel32));
 
 	// For each row of words
-	for (int32_t wordY = -1; wordY < i32NumYWords - 1; wordY++)
+	for (int32_t wordY = static_cast<int32_t>(firstRow) - 1; wordY < static_cast<int32_t>(lastRow) - 1; wordY++)
 	{
 		// for each column of words
 		for (int32_t wordX = -1; wordX < i32NumXWords - 1; wordX++)
@@ -600,7 +604,7 @@ static uint32_t PVRTDecompressPVRTC_int(const void* pCompressedData, uint32_t Do
 
 	// Decompress the surface.
 	uint32_t retval = pvrtcDecompress<PVRTCII>((uint8_t*)pCompressedData,
-		pDecompressedData, XTrueDim, YTrueDim, uint8_t(Do2bitMode == 1 ? 2 : 4));
+		pDecompressedData, XTrueDim, YTrueDim, uint8_t(Do2bitMode == 1 ? 2 : 4), 0, YTrueDim / 4);
 
 	// If the dimensions were too small, then copy the new buffer back into the output buffer.
 	if (XTrueDim != XDim || YTrueDim != YDim)
@@ -625,6 +629,32 @@ uint32_t PVRTDecompressPVRTC(const void* pCompressedData, uint32_t Do2bitMode, u
 uint32_t PVRTDecompressPVRTCII(const void* pCompressedData, uint32_t Do2bitMode, uint32_t XDim, uint32_t YDim, uint8_t* pResultImage)
 {
 	return PVRTDecompressPVRTC_int<true>(pCompressedData, Do2bitMode, XDim, YDim, pResultImage);
+}
+
+// rom-properties: Band decompression.
+template<bool PVRTCII>
+static uint32_t PVRTDecompressPVRTC_rows_int(const void* pCompressedData, uint32_t Do2bitMode, uint32_t XDim, uint32_t YDim, uint8_t* pResultImage,
+	uint32_t firstRow, uint32_t lastRow)
+{
+	// The image must be at least the minimum size, since there's
+	// no temporary buffer in this version.
+	if (XDim < ((Do2bitMode == 1u) ? 16u : 8u) || YDim < 8u) { return 0; }
+	if (firstRow >= lastRow || lastRow > YDim / 4) { return 0; }
+
+	return pvrtcDecompress<PVRTCII>((uint8_t*)pCompressedData,
+		(Pixel32*)pResultImage, XDim, YDim, uint8_t(Do2bitMode == 1 ? 2 : 4), firstRow, lastRow);
+}
+
+uint32_t PVRTDecompressPVRTC_rows(const void* pCompressedData, uint32_t Do2bitMode, uint32_t XDim, uint32_t YDim, uint8_t* pResultImage,
+	uint32_t firstRow, uint32_t lastRow)
+{
+	return PVRTDecompressPVRTC_rows_int<false>(pCompressedData, Do2bitMode, XDim, YDim, pResultImage, firstRow, lastRow);
+}
+
+uint32_t PVRTDecompressPVRTCII_rows(const void* pCompressedData, uint32_t Do2bitMode, uint32_t XDim, uint32_t YDim, uint8_t* pResultImage,
+	uint32_t firstRow, uint32_t lastRow)
+{
+	return PVRTDecompressPVRTC_rows_int<true>(pCompressedData, Do2bitMode, XDim, YDim, pResultImage, firstRow, lastRow);
 }	
 } // namespace pvr
 //!\endcond
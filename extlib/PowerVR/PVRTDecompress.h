@@ -29,4 +29,36 @@ uint32_t PVRTDecompressPVRTC(const void* compressedData, uint32_t do2bitMode, ui
 /// <returns>Return the amount of data that was decompressed.</returns>
 uint32_t PVRTDecompressPVRTCII(const void* compressedData, uint32_t do2bitMode, uint32_t xDim, uint32_t yDim, uint8_t* outResultImage);
 
+// rom-properties: Band decompression functions.
+// PVRTC words are 4 pixels high. These functions decompress word rows
+// [firstRow, lastRow), with the output shifted up by half a word, and
+// wrapping around for the first row. Decompressing a set of bands that
+// covers [0, yDim/4) produces the full image, and separate bands can be
+// decompressed concurrently.
+// The image must be at least 8x8 (4bpp) or 16x8 (2bpp).
+
+/// <summary>Decompresses a band of PVRTC word rows to RGBA 8888.</summary>
+/// <param name="compressedData">The PVRTC texture data to decompress</param>
+/// <param name="do2bitMode">Signifies whether the data is PVRTC2 or PVRTC4</param>
+/// <param name="xDim">X dimension of the texture</param>
+/// <param name="yDim">Y dimension of the texture</param>
+/// <param name="outResultImage">The decompressed texture data (entire image)</param>
+/// <param name="firstRow">First word row</param>
+/// <param name="lastRow">Last word row (exclusive)</param>
+/// <returns>Return the amount of data in the entire texture, or 0 on error.</returns>
+uint32_t PVRTDecompressPVRTC_rows(const void* compressedData, uint32_t do2bitMode, uint32_t xDim, uint32_t yDim, uint8_t* outResultImage,
+	uint32_t firstRow, uint32_t lastRow);
+
+/// <summary>Decompresses a band of PVRTC-II word rows to RGBA 8888.</summary>
+/// <param name="compressedData">The PVRTC-II texture data to decompress</param>
+/// <param name="do2bitMode">Signifies whether the data is PVRTC2 or PVRTC4</param>
+/// <param name="xDim">X dimension of the texture</param>
+/// <param name="yDim">Y dimension of the texture</param>
+/// <param name="outResultImage">The decompressed texture data (entire image)</param>
+/// <param name="firstRow">First word row</param>
+/// <param name="lastRow">Last word row (exclusive)</param>
+/// <returns>Return the amount of data in the entire texture, or 0 on error.</returns>
+uint32_t PVRTDecompressPVRTCII_rows(const void* compressedData, uint32_t do2bitMode, uint32_t xDim, uint32_t yDim, uint8_t* outResultImage,
+	uint32_t firstRow, uint32_t lastRow);
+
 } // namespace pvr
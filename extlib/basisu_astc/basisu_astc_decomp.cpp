@@ -34,6 +34,7 @@
  *//*--------------------------------------------------------------------*/
 #include "basisu_astc_decomp.h"
 #include <assert.h>
+#include <string.h>
 #include <algorithm>
 
 #define DE_LENGTH_OF_ARRAY(x) (sizeof(x)/sizeof(x[0]))
@@ -588,6 +589,26 @@ inline void setASTCErrorColorBlock (void* dst, int blockWidth, int blockHeight,
 		}
 	}
 }
+// rom-properties: Get the 8-bit color of an LDR void-extent block.
+// Returns false if the block is not a valid LDR void-extent block.
+bool decodeVoidExtentColorUNorm8 (deUint8 color[4], const Block128& blockData)
+{
+	// Same validation as decodeVoidExtentBlock(). (HDR is not supported.)
+	const deUint32	minSExtent			= blockData.getBits(12, 24);
+	const deUint32	maxSExtent			= blockData.getBits(25, 37);
+	const deUint32	minTExtent			= blockData.getBits(38, 50);
+	const deUint32	maxTExtent			= blockData.getBits(51, 63);
+	const bool		allExtentsAllOnes	= minSExtent == 0x1fff && maxSExtent == 0x1fff && minTExtent == 0x1fff && maxTExtent == 0x1fff;
+	if (blockData.isBitSet(9) || (!allExtentsAllOnes && (minSExtent >= maxSExtent || minTExtent >= maxTExtent)))
+		return false;
+	// The 16-bit UNORM color converts to 8-bit by taking the high byte.
+	// NOTE: R and B are swapped for rom-properties.
+	color[2] = (deUint8)blockData.getBits(72,  79);
+	color[1] = (deUint8)blockData.getBits(88,  95);
+	color[0] = (deUint8)blockData.getBits(104, 111);
+	color[3] = (deUint8)blockData.getBits(120, 127);
+	return true;
+}
 DecompressResult decodeVoidExtentBlock (void* dst, const Block128& blockData, int blockWidth, int blockHeight, bool isSRGB, bool isLDRMode)
 {
 	const deUint32	minSExtent			= blockData.getBits(12, 24);
@@ -1341,7 +1362,63 @@ void interpolateWeights (TexelWeightPair* dst, const deUint32 (&unquantizedWeigh
 		}
 	}
 }
-void computeTexelWeights (TexelWeightPair* dst, const Block128& blockData, int blockWidth, int blockHeight, const ASTCBlockMode& blockMode)
+// rom-properties: Compute a weight infill table. (same as interpolateWeights(), but without the weights)
+void computeInfillTable (decompress_tables::infill_texel* dst, int blockWidth, int blockHeight, int weightGridWidth, int weightGridHeight)
+{
+	const deUint32	scaleX				= (1024 + blockWidth/2) / (blockWidth-1);
+	const deUint32	scaleY				= (1024 + blockHeight/2) / (blockHeight-1);
+	for (int texelY = 0; texelY < blockHeight; texelY++)
+	{
+		for (int texelX = 0; texelX < blockWidth; texelX++, dst++)
+		{
+			const deUint32 gX	= (scaleX*texelX*(weightGridWidth-1) + 32) >> 6;
+			const deUint32 gY	= (scaleY*texelY*(weightGridHeight-1) + 32) >> 6;
+			const deUint32 jX	= gX >> 4;
+			const deUint32 jY	= gY >> 4;
+			const deUint32 fX	= gX & 0xf;
+			const deUint32 fY	= gY & 0xf;
+			const deUint32 w11	= (fX*fY + 8) >> 4;
+			const deUint32 i00	= jY*weightGridWidth + jX;
+			dst->w[0]	= (deUint8)(16 - fX - fY + w11);
+			dst->w[1]	= (deUint8)(fX - w11);
+			dst->w[2]	= (deUint8)(fY - w11);
+			dst->w[3]	= (deUint8)w11;
+			dst->idx[0]	= (deUint8)i00;
+			dst->idx[1]	= (deUint8)(i00 + 1);
+			dst->idx[2]	= (deUint8)(i00 + weightGridWidth);
+			dst->idx[3]	= (deUint8)(i00 + weightGridWidth + 1);
+		}
+	}
+}
+// rom-properties: Interpolate weights using a precomputed infill table.
+void interpolateWeights (TexelWeightPair* dst, const deUint32 (&unquantizedWeights) [64], int numTexels, const decompress_tables::infill_texel* infill, const ASTCBlockMode& blockMode)
+{
+	if (!blockMode.isDualPlane)
+	{
+		for (int texelNdx = 0; texelNdx < numTexels; texelNdx++)
+		{
+			const decompress_tables::infill_texel& t = infill[texelNdx];
+			// & 0x3f clamps address to bounds of unquantizedWeights
+			dst[texelNdx].w[0] = (unquantizedWeights[t.idx[0] & 0x3f]*t.w[0] + unquantizedWeights[t.idx[1] & 0x3f]*t.w[1] +
+								  unquantizedWeights[t.idx[2] & 0x3f]*t.w[2] + unquantizedWeights[t.idx[3] & 0x3f]*t.w[3] + 8) >> 4;
+		}
+		return;
+	}
+	for (int texelNdx = 0; texelNdx < numTexels; texelNdx++)
+	{
+		const decompress_tables::infill_texel& t = infill[texelNdx];
+		for (int texelWeightNdx = 0; texelWeightNdx < 2; texelWeightNdx++)
+		{
+			const deUint32 p00	= unquantizedWeights[(t.idx[0] * 2 + texelWeightNdx) & 0x3f];
+			const deUint32 p01	= unquantizedWeights[(t.idx[1] * 2 + texelWeightNdx) & 0x3f];
+			const deUint32 p10	= unquantizedWeights[(t.idx[2] * 2 + texelWeightNdx) & 0x3f];
+			const deUint32 p11	= unquantizedWeights[(t.idx[3] * 2 + texelWeightNdx) & 0x3f];
+			dst[texelNdx].w[texelWeightNdx] = (p00*t.w[0] + p01*t.w[1] + p10*t.w[2] + p11*t.w[3] + 8) >> 4;
+		}
+	}
+}
+void computeTexelWeights (TexelWeightPair* dst, const Block128& blockData, int blockWidth, int blockHeight, const ASTCBlockMode& blockMode,
+						  const decompress_tables::infill_texel* infill)
 {
 	ISEDecodedResult weightGrid[64];
 	{
@@ -1351,7 +1428,10 @@ void computeTexelWeights (TexelWeightPair* dst, const Block128& blockData, int b
 	{
 		deUint32 unquantizedWeights[64];
 		unquantizeWeights(&unquantizedWeights[0], &weightGrid[0], blockMode);
-		interpolateWeights(dst, unquantizedWeights, blockWidth, blockHeight, blockMode);
+		if (infill)
+			interpolateWeights(dst, unquantizedWeights, blockWidth*blockHeight, infill, blockMode);
+		else
+			interpolateWeights(dst, unquantizedWeights, blockWidth, blockHeight, blockMode);
 	}
 }
 inline deUint32 hash52 (deUint32 v)
@@ -1421,7 +1501,8 @@ int computeTexelPartition (deUint32 seedIn, deUint32 xIn, deUint32 yIn, deUint32
 		 :								  3;
 }
 DecompressResult setTexelColors (void* dst, ColorEndpointPair* colorEndpoints, TexelWeightPair* texelWeights, int ccs, deUint32 partitionIndexSeed,
-								 int numPartitions, int blockWidth, int blockHeight, bool isSRGB, bool isLDRMode, const deUint32* colorEndpointModes)
+								 int numPartitions, int blockWidth, int blockHeight, bool isSRGB, bool isLDRMode, const deUint32* colorEndpointModes,
+								 const deUint8* partitionTable, bool isUNorm8)
 {
 	const bool			smallBlock	= blockWidth*blockHeight < 31;
 	DecompressResult	result		= DECOMPRESS_RESULT_VALID_BLOCK;
@@ -1435,11 +1516,50 @@ DecompressResult setTexelColors (void* dst, ColorEndpointPair* colorEndpoints, T
 			return DECOMPRESS_RESULT_ERROR;
 	}
 
+	// rom-properties: Fast path for 8-bit BGRA output.
+	// HDR endpoints were rejected above, so only the LDR interpolation is needed.
+	if (isUNorm8)
+	{
+		deUint32 c0[4][4], c1[4][4];
+		for (int i = 0; i < numPartitions; i++)
+		for (int channelNdx = 0; channelNdx < 4; channelNdx++)
+		{
+			c0[i][channelNdx] = (colorEndpoints[i].e0[channelNdx] << 8) | colorEndpoints[i].e0[channelNdx];
+			c1[i][channelNdx] = (colorEndpoints[i].e1[channelNdx] << 8) | colorEndpoints[i].e1[channelNdx];
+		}
+		const int		numTexels	= blockWidth*blockHeight;
+		const int		wSel[4]		= { ccs == 0, ccs == 1, ccs == 2, ccs == 3 };
+		deUint8*		dstU		= (deUint8*)dst;
+		for (int texelNdx = 0; texelNdx < numTexels; texelNdx++, dstU += 4)
+		{
+			const int				colorEndpointNdx	= numPartitions == 1 ? 0
+														: partitionTable ? partitionTable[texelNdx]
+														: computeTexelPartition(partitionIndexSeed, texelNdx % blockWidth, texelNdx / blockWidth, 0, numPartitions, smallBlock);
+			const deUint32*			pc0					= c0[colorEndpointNdx];
+			const deUint32*			pc1					= c1[colorEndpointNdx];
+			const TexelWeightPair&	weight				= texelWeights[texelNdx];
+			deUint32 c[4];
+			for (int channelNdx = 0; channelNdx < 4; channelNdx++)
+			{
+				const deUint32 w = weight.w[wSel[channelNdx]];
+				c[channelNdx] = (pc0[channelNdx]*(64-w) + pc1[channelNdx]*w + 32) >> 6;
+			}
+			// NOTE: R and B are swapped for rom-properties.
+			dstU[0] = (deUint8)(c[2] >> 8);
+			dstU[1] = (deUint8)(c[1] >> 8);
+			dstU[2] = (deUint8)(c[0] >> 8);
+			dstU[3] = (deUint8)(c[3] >> 8);
+		}
+		return result;
+	}
+
 	unsigned int texelNdx = 0;
 	for (int texelY = 0; texelY < blockHeight; texelY++)
 	for (int texelX = 0; texelX < blockWidth; texelX++, texelNdx++)
 	{
-		const int				colorEndpointNdx	= numPartitions == 1 ? 0 : computeTexelPartition(partitionIndexSeed, texelX, texelY, 0, numPartitions, smallBlock);
+		const int				colorEndpointNdx	= numPartitions == 1 ? 0
+													: partitionTable ? partitionTable[texelNdx]
+													: computeTexelPartition(partitionIndexSeed, texelX, texelY, 0, numPartitions, smallBlock);
 		DE_ASSERT(colorEndpointNdx < numPartitions);
 		const UVec4&			e0					= colorEndpoints[colorEndpointNdx].e0;
 		const UVec4&			e1					= colorEndpoints[colorEndpointNdx].e1;
@@ -1500,20 +1620,36 @@ DecompressResult setTexelColors (void* dst, ColorEndpointPair* colorEndpoints, T
 	}
 	return result;
 }
-DecompressResult decompressBlock (void* dst, const Block128& blockData, int blockWidth, int blockHeight, bool isSRGB, bool isLDR)
+DecompressResult decompressBlock (void* dst, const Block128& blockData, int blockWidth, int blockHeight, bool isSRGB, bool isLDR,
+								  const decompress_tables* pTables, bool isUNorm8)
 {
 	DE_ASSERT(isLDR || !isSRGB);
+	DE_ASSERT(isLDR || !isUNorm8);
+	// rom-properties: If isUNorm8 is set, non-sRGB output is written as 8-bit BGRA instead of float.
+	const bool is8Bit = isSRGB || isUNorm8;
 	// Decode block mode.
 	const ASTCBlockMode blockMode = getASTCBlockMode(blockData.getBits(0, 10));
 	// Check for block mode errors.
 	if (blockMode.isError)
 	{
-		setASTCErrorColorBlock(dst, blockWidth, blockHeight, isSRGB);
+		setASTCErrorColorBlock(dst, blockWidth, blockHeight, is8Bit);
 		return DECOMPRESS_RESULT_ERROR;
 	}
 	// Separate path for void-extent.
 	if (blockMode.isVoidExtent)
-		return decodeVoidExtentBlock(dst, blockData, blockWidth, blockHeight, isSRGB, isLDR);
+	{
+		if (!isUNorm8)
+			return decodeVoidExtentBlock(dst, blockData, blockWidth, blockHeight, isSRGB, isLDR);
+		deUint8 color[4];
+		if (!decodeVoidExtentColorUNorm8(color, blockData))
+		{
+			setASTCErrorColorBlock(dst, blockWidth, blockHeight, true);
+			return DECOMPRESS_RESULT_ERROR;
+		}
+		for (int i = 0; i < blockWidth*blockHeight; i++)
+			memcpy((deUint8*)dst + i*4, color, 4);
+		return DECOMPRESS_RESULT_VALID_BLOCK;
+	}
 	// Compute weight grid values.
 	const int numWeights			= computeNumWeights(blockMode);
 	const int numWeightDataBits		= computeNumRequiredBits(blockMode.weightISEParams, numWeights);
@@ -1526,7 +1662,7 @@ DecompressResult decompressBlock (void* dst, const Block128& blockData, int bloc
 		blockMode.weightGridHeight > blockHeight	||
 		(numPartitions == 4 && blockMode.isDualPlane))
 	{
-		setASTCErrorColorBlock(dst, blockWidth, blockHeight, isSRGB);
+		setASTCErrorColorBlock(dst, blockWidth, blockHeight, is8Bit);
 		return DECOMPRESS_RESULT_ERROR;
 	}
 	// Compute number of bits available for color endpoint data.
@@ -1546,7 +1682,7 @@ DecompressResult decompressBlock (void* dst, const Block128& blockData, int bloc
 	// Check for errors in color endpoint value count.
 	if (numColorEndpointValues > 18 || numBitsForColorEndpoints < (int)deDivRoundUp32(13*numColorEndpointValues, 5))
 	{
-		setASTCErrorColorBlock(dst, blockWidth, blockHeight, isSRGB);
+		setASTCErrorColorBlock(dst, blockWidth, blockHeight, is8Bit);
 		return DECOMPRESS_RESULT_ERROR;
 	}
 	// Compute color endpoints.
@@ -1555,42 +1691,107 @@ DecompressResult decompressBlock (void* dst, const Block128& blockData, int bloc
 						  computeMaximumRangeISEParams(numBitsForColorEndpoints, numColorEndpointValues), numBitsForColorEndpoints);
 	// Compute texel weights.
 	TexelWeightPair texelWeights[MAX_BLOCK_WIDTH*MAX_BLOCK_HEIGHT];
-	computeTexelWeights(&texelWeights[0], blockData, blockWidth, blockHeight, blockMode);
+	computeTexelWeights(&texelWeights[0], blockData, blockWidth, blockHeight, blockMode,
+						pTables ? pTables->getInfillTable(blockMode.weightGridWidth, blockMode.weightGridHeight) : nullptr);
 	// Set texel colors.
 	const int		ccs						= blockMode.isDualPlane ? (int)blockData.getBits(extraCemBitsStart-2, extraCemBitsStart-1) : -1;
 	const deUint32	partitionIndexSeed		= numPartitions > 1 ? blockData.getBits(13, 22) : (deUint32)-1;
-	return setTexelColors(dst, &colorEndpoints[0], &texelWeights[0], ccs, partitionIndexSeed, numPartitions, blockWidth, blockHeight, isSRGB, isLDR, &colorEndpointModes[0]);
+	const deUint8*	partitionTable			= (pTables && numPartitions > 1) ? pTables->getPartitionTable(numPartitions, partitionIndexSeed) : nullptr;
+	return setTexelColors(dst, &colorEndpoints[0], &texelWeights[0], ccs, partitionIndexSeed, numPartitions, blockWidth, blockHeight, isSRGB, isLDR, &colorEndpointModes[0],
+						  partitionTable, isUNorm8);
 }
 
 } // anonymous
 
-bool decompress(uint8_t *pDst, const uint8_t * data, bool isSRGB, int blockWidth, int blockHeight)
+decompress_tables::decompress_tables(int blockWidth, int blockHeight)
+	: m_blockWidth(blockWidth)
+	, m_blockHeight(blockHeight)
+	, m_partitionSlot(3*1024, 0xFFFF)
+	, m_infillSlot(11*11, 0xFF)
 {
-	// rg - We only support LDR here, although adding back in HDR would be easy.
-	const bool isLDR = true;
-	DE_ASSERT(isLDR || !isSRGB);
-	
-	float linear[MAX_BLOCK_WIDTH * MAX_BLOCK_HEIGHT * 4];
+	DE_ASSERT(inRange(blockWidth, 4, MAX_BLOCK_WIDTH) && inRange(blockHeight, 4, MAX_BLOCK_HEIGHT));
+}
 
-	const Block128 blockData(data);
-	if (decompressBlock(isSRGB ? (void*)pDst : (void*)& linear[0],
-		blockData, blockWidth, blockHeight, isSRGB, isLDR) != DECOMPRESS_RESULT_VALID_BLOCK)
-		return false;
-	
-	if (!isSRGB)
+void decompress_tables::prepare(const uint8_t* pBlocks, size_t numBlocks)
+{
+	const int	numTexels	= m_blockWidth * m_blockHeight;
+	const bool	smallBlock	= numTexels < 31;
+
+	for (; numBlocks > 0; numBlocks--, pBlocks += 16)
 	{
-		const float *pLinear = linear;
-		for (int i = blockWidth * blockHeight; i > 0; i--, pDst += 4, pLinear += 4)
+		const Block128 blockData(pBlocks);
+		const ASTCBlockMode blockMode = getASTCBlockMode(blockData.getBits(0, 10));
+		if (blockMode.isError || blockMode.isVoidExtent)
+			continue;
+
+		// Weight infill table.
+		// NOTE: Invalid grid sizes are rejected by decompressBlock(),
+		// so don't bother computing tables for them.
+		if (blockMode.weightGridWidth <= m_blockWidth && blockMode.weightGridHeight <= m_blockHeight &&
+			computeNumWeights(blockMode) <= 64)
 		{
-			// NOTE: R and B are swapped for rom-properties.
-			pDst[2] = (uint8_t)(basisu_astc::clamp<int>((int)(pLinear[0] * 65536.0f + .5f), 0, 65535) >> 8);
-			pDst[1] = (uint8_t)(basisu_astc::clamp<int>((int)(pLinear[1] * 65536.0f + .5f), 0, 65535) >> 8);
-			pDst[0] = (uint8_t)(basisu_astc::clamp<int>((int)(pLinear[2] * 65536.0f + .5f), 0, 65535) >> 8);
-			pDst[3] = (uint8_t)(basisu_astc::clamp<int>((int)(pLinear[3] * 65536.0f + .5f), 0, 65535) >> 8);
+			deUint8& slot = m_infillSlot[(blockMode.weightGridWidth-2)*11 + (blockMode.weightGridHeight-2)];
+			if (slot == 0xFF)
+			{
+				slot = (deUint8)(m_infill.size() / numTexels);
+				m_infill.resize(m_infill.size() + numTexels);
+				computeInfillTable(&m_infill[(size_t)slot * numTexels], m_blockWidth, m_blockHeight,
+								   blockMode.weightGridWidth, blockMode.weightGridHeight);
+			}
+		}
+
+		// Partition table.
+		const int numPartitions = (int)blockData.getBits(11, 12) + 1;
+		if (numPartitions == 1)
+			continue;
+		const deUint32 seed = blockData.getBits(13, 22);
+		deUint16& slot = m_partitionSlot[(numPartitions-2)*1024 + seed];
+		if (slot == 0xFFFF)
+		{
+			slot = (deUint16)(m_partitions.size() / numTexels);
+			m_partitions.resize(m_partitions.size() + numTexels);
+			deUint8* dst = &m_partitions[(size_t)slot * numTexels];
+			for (int texelY = 0; texelY < m_blockHeight; texelY++)
+			for (int texelX = 0; texelX < m_blockWidth; texelX++)
+				*dst++ = (deUint8)computeTexelPartition(seed, texelX, texelY, 0, numPartitions, smallBlock);
 		}
 	}
+}
 
-	return true;
+const uint8_t* decompress_tables::getPartitionTable(int numPartitions, uint32_t seed) const
+{
+	DE_ASSERT(inRange(numPartitions, 2, 4) && seed < 1024);
+	const deUint16 slot = m_partitionSlot[(numPartitions-2)*1024 + seed];
+	return (slot != 0xFFFF) ? &m_partitions[(size_t)slot * m_blockWidth * m_blockHeight] : nullptr;
+}
+
+const decompress_tables::infill_texel* decompress_tables::getInfillTable(int gridWidth, int gridHeight) const
+{
+	DE_ASSERT(inRange(gridWidth, 2, MAX_BLOCK_WIDTH) && inRange(gridHeight, 2, MAX_BLOCK_HEIGHT));
+	const deUint8 slot = m_infillSlot[(gridWidth-2)*11 + (gridHeight-2)];
+	return (slot != 0xFF) ? &m_infill[(size_t)slot * m_blockWidth * m_blockHeight] : nullptr;
+}
+
+bool getVoidExtentColor(uint8_t pColor[4], const uint8_t* data)
+{
+	const Block128 blockData(data);
+	if (blockData.getBits(0, 8) != 0x1fc)
+		return false;
+	return decodeVoidExtentColorUNorm8(pColor, blockData);
+}
+
+bool decompress(uint8_t *pDst, const uint8_t * data, bool isSRGB, int blockWidth, int blockHeight, const decompress_tables* pTables)
+{
+	// rg - We only support LDR here, although adding back in HDR would be easy.
+	const bool isLDR = true;
+	DE_ASSERT(isLDR || !isSRGB);
+	
+	// rom-properties: Non-sRGB output used to be decoded to float, then converted
+	// back to 8-bit. Since the interpolated value is a 16-bit UNORM, the float
+	// round-trip is exactly (c >> 8), so write 8-bit BGRA output directly.
+	DE_ASSERT(!pTables || (pTables->blockWidth() == blockWidth && pTables->blockHeight() == blockHeight));
+	const Block128 blockData(data);
+	return decompressBlock(pDst, blockData, blockWidth, blockHeight, isSRGB, isLDR, pTables, !isSRGB) == DECOMPRESS_RESULT_VALID_BLOCK;
 }
 
 } // astc
@@ -26,6 +26,7 @@
 // rom-properties: Disabled the basisu.h include.
 //#include "../transcoder/basisu.h" // to pick up the iterator debug level madness
 #include <vector>
+#include <stddef.h>
 #include <stdint.h>
 
 namespace basisu_astc
@@ -33,10 +34,63 @@ namespace basisu_astc
 namespace astc
 {
 
+// rom-properties: Precomputed per-texture decoding tables.
+// Partition assignments only depend on (seed, partition count, block size),
+// and weight infill only depends on the block size and weight grid size,
+// so these are computed once per texture instead of once per block.
+// Call prepare() once, before decompressing; the tables are read-only
+// afterwards, so a single instance can be shared by multiple threads.
+class decompress_tables
+{
+public:
+	// Weight infill for a single texel: indexes and weights of the
+	// four surrounding weight grid points.
+	struct infill_texel
+	{
+		uint8_t idx[4];
+		uint8_t w[4];
+	};
+
+	decompress_tables(int blockWidth, int blockHeight);
+
+	// Scan ASTC blocks and compute the tables needed to decode them.
+	void prepare(const uint8_t* pBlocks, size_t numBlocks);
+
+	int blockWidth() const { return m_blockWidth; }
+	int blockHeight() const { return m_blockHeight; }
+
+	// Get a partition table. (one partition index per texel)
+	// Returns nullptr if the table was not prepared.
+	const uint8_t* getPartitionTable(int numPartitions, uint32_t seed) const;
+
+	// Get a weight infill table. (one entry per texel)
+	// Returns nullptr if the table was not prepared.
+	const infill_texel* getInfillTable(int gridWidth, int gridHeight) const;
+
+private:
+	int m_blockWidth;
+	int m_blockHeight;
+
+	// Partition tables: 3 partition counts (2-4) x 1024 seeds.
+	std::vector<uint16_t> m_partitionSlot;
+	std::vector<uint8_t> m_partitions;
+
+	// Infill tables: 11x11 weight grid sizes (2-12).
+	std::vector<uint8_t> m_infillSlot;
+	std::vector<infill_texel> m_infill;
+};
+
 // Unpacks a single ASTC block to pDst
 // If isSRGB is true, the spec requires the decoder to scale the LDR 8-bit endpoints to 16-bit before interpolation slightly differently, 
 // which will lead to different outputs. So be sure to set it correctly (ideally it should match whatever the encoder did).
-bool decompress(uint8_t* pDst, const uint8_t* data, bool isSRGB, int blockWidth, int blockHeight);
+// rom-properties: If pTables is specified, its block size must match,
+// and precomputed tables will be used if available.
+bool decompress(uint8_t* pDst, const uint8_t* data, bool isSRGB, int blockWidth, int blockHeight,
+	const decompress_tables* pTables = nullptr);
+
+// rom-properties: Check if a block is a valid LDR void-extent (constant color) block.
+// If it is, the color is stored in pColor, using the same format as decompress() with isSRGB == false.
+bool getVoidExtentColor(uint8_t pColor[4], const uint8_t* data);
 
 } // astc
 } // basisu
@@ -22,6 +22,14 @@ using LibRomData::RomDataFactory;
 #include "libromdata/img/TCreateThumbnail.cpp"
 using LibRomData::TCreateThumbnail;
 
+#include "librptexture/img/PixelBufferPool.hpp"
+#ifdef RP_GTK_USE_CAIRO
+#  include "RpCairoBackend.hpp"
+#endif /* RP_GTK_USE_CAIRO */
+
+// One-time initialization.
+#include "librpthreads/pthread_once.h"
+
 // C++ STL classes.
 using std::string;
 using std::unique_ptr;
@@ -263,99 +271,27 @@ static int openFromFilenameOrURI(const char *source_file, IRpFile **pp_file, str
 }
 
 /**
- * Thumbnail creator function for wrapper programs.
- * @param source_file Source file or URI. (UTF-8)
- * @param output_file Output file. (UTF-8)
- * @param maximum_size Maximum size.
- * @return 0 on success; non-zero on error.
+ * Get the common XDG thumbnail cache tEXt chunks for a source file.
+ * The image dimensions and URI are added by writeThumbnailPng().
+ * @param romData	[in] RomData object.
+ * @param s_uri		[in] Normalized URI.
+ * @param kv		[out] tEXt chunks.
  */
-extern "C"
-G_MODULE_EXPORT int RP_C_API rp_create_thumbnail(const char *source_file, const char *output_file, int maximum_size)
+static void getCommonTextChunks(const RomData *romData, const string &s_uri, RpPngWriter::kv_vector &kv)
 {
-	// Some of this is based on the GNOME Thumbnailer skeleton project.
-	// https://github.com/hadess/gnome-thumbnailer-skeleton/blob/master/gnome-thumbnailer-skeleton.c
-	CHECK_UID_RET(RPCT_RUNNING_AS_ROOT);
-
-	// Make sure glib is initialized.
-	// NOTE: This is a no-op as of glib-2.35.1.
-#if !GLIB_CHECK_VERSION(2,35,1)
-	g_type_init();
-#endif
-
-	// NOTE: TCreateThumbnail() has wrappers for opening the
-	// ROM file and getting RomData*, but we're doing it here
-	// in order to return better error codes.
-
-	// Attempt to open the ROM file.
-	IRpFile *file = nullptr;
-	string s_uri;
-	int ret = openFromFilenameOrURI(source_file, &file, s_uri);
-	if (ret != 0) {
-		// Error opening the file.
-		return ret;
-	}
-	assert(file != nullptr);
-
-	// Get the appropriate RomData class for this ROM.
-	// RomData class *must* support at least one image type.
-	RomData *const romData = RomDataFactory::create(file, RomDataFactory::RDA_HAS_THUMBNAIL);
-	file->unref();	// file is ref()'d by RomData.
-	if (!romData) {
-		// ROM is not supported.
-		return RPCT_SOURCE_FILE_NOT_SUPPORTED;
-	}
-
-	// Create the thumbnail.
-	// TODO: If image is larger than maximum_size, resize down.
-	unique_ptr<CreateThumbnailPrivate> d(new CreateThumbnailPrivate());
-	CreateThumbnailPrivate::GetThumbnailOutParams_t outParams;
-	ret = d->getThumbnail(romData, maximum_size, &outParams);
-	if (ret != 0) {
-		// No image.
-		romData->unref();
-		return RPCT_SOURCE_FILE_NO_IMAGE;
-	}
-
-	// Save the image using RpPngWriter.
-	unique_ptr<const uint8_t*[]> row_pointers;
-	guchar *pixels;
-	int rowstride;
-	int pwRet;
-
-	// tEXt chunks.
-	RpPngWriter::kv_vector kv;
-	char mtime_str[32];
-	char szFile_str[32];
-	GFile *f_src = nullptr;
-	const char *mimeType;
-
-	// gdk-pixbuf doesn't support CI8, so we'll assume all
-	// images are ARGB32. (Well, ABGR32, but close enough.)
-	// TODO: Verify channels, etc.?
-	unique_ptr<RpPngWriter> pngWriter(new RpPngWriter(output_file,
-		outParams.thumbSize.width, outParams.thumbSize.height,
-		rp_image::Format::ARGB32));
-	if (!pngWriter->isOpen()) {
-		// Could not open the PNG writer.
-		ret = RPCT_OUTPUT_FILE_FAILED;
-		goto cleanup;
-	}
-
-	/** tEXt chunks. **/
-	// NOTE: These are written before IHDR in order to put the
-	// tEXt chunks before the IDAT chunk.
-
 	// Get values for the XDG thumbnail cache text chunks.
 	// KDE uses this order: Software, MTime, Mimetype, Size, URI
-	kv.reserve(5);
+	kv.reserve(7);
 
 	// Software.
 	kv.emplace_back("Software", "ROM Properties Page shell extension (GTK" GTK_MAJOR_STR ")");
 
 	// Modification time and file size.
+	char mtime_str[32];
+	char szFile_str[32];
 	mtime_str[0] = 0;
 	szFile_str[0] = 0;
-	f_src = g_file_new_for_uri(s_uri.c_str());
+	GFile *const f_src = g_file_new_for_uri(s_uri.c_str());
 	if (f_src) {
 		GError *error = nullptr;
 		GFileInfo *const fi_src = g_file_query_info(f_src,
@@ -387,7 +323,7 @@ G_MODULE_EXPORT int RP_C_API rp_create_thumbnail(const char *source_file, const
 	}
 
 	// MIME type.
-	mimeType = romData->mimeType();
+	const char *const mimeType = romData->mimeType();
 	if (mimeType) {
 		kv.emplace_back("Thumb::Mimetype", mimeType);
 	}
@@ -396,6 +332,35 @@ G_MODULE_EXPORT int RP_C_API rp_create_thumbnail(const char *source_file, const
 	if (szFile_str[0] != 0) {
 		kv.emplace_back("Thumb::Size", szFile_str);
 	}
+}
+
+/**
+ * Write a thumbnail to a PNG file.
+ * @param output_file	[in] Output file. (UTF-8)
+ * @param outParams	[in] Thumbnail from CreateThumbnailPrivate::getThumbnail().
+ * @param kv_common	[in] Common tEXt chunks from getCommonTextChunks().
+ * @param s_uri		[in] Normalized URI.
+ * @return 0 on success; RPCT error code on error.
+ */
+static int writeThumbnailPng(const char *output_file,
+	const CreateThumbnailPrivate::GetThumbnailOutParams_t &outParams,
+	const RpPngWriter::kv_vector &kv_common, const string &s_uri)
+{
+	// gdk-pixbuf doesn't support CI8, so we'll assume all
+	// images are ARGB32. (Well, ABGR32, but close enough.)
+	// TODO: Verify channels, etc.?
+	unique_ptr<RpPngWriter> pngWriter(new RpPngWriter(output_file,
+		outParams.thumbSize.width, outParams.thumbSize.height,
+		rp_image::Format::ARGB32));
+	if (!pngWriter->isOpen()) {
+		// Could not open the PNG writer.
+		return RPCT_OUTPUT_FILE_FAILED;
+	}
+
+	/** tEXt chunks. **/
+	// NOTE: These are written before IHDR in order to put the
+	// tEXt chunks before the IDAT chunk.
+	RpPngWriter::kv_vector kv(kv_common);
 
 	// Original image dimensions.
 	if (outParams.fullSize.width > 0 && outParams.fullSize.height > 0) {
@@ -414,29 +379,32 @@ G_MODULE_EXPORT int RP_C_API rp_create_thumbnail(const char *source_file, const
 	// References:
 	// - https://bugs.kde.org/show_bug.cgi?id=393015
 	// - https://specifications.freedesktop.org/thumbnail-spec/thumbnail-spec-latest.html
-	kv.emplace_back("Thumb::URI", s_uri.c_str());
+	kv.emplace_back("Thumb::URI", s_uri);
 
 	// Write the tEXt chunks.
 	pngWriter->write_tEXt(kv);
 
 	/** IHDR **/
 
+	// Thumbnails are cached, so encoding speed is more
+	// important than file size.
+	pngWriter->setCompressionProfile(RpPngWriter::CompressionProfile::Fast);
+
 	// If sBIT wasn't found, all fields will be 0.
 	// RpPngWriter will ignore sBIT in this case.
-	pwRet = pngWriter->write_IHDR(&outParams.sBIT);
+	int pwRet = pngWriter->write_IHDR(&outParams.sBIT);
 	if (pwRet != 0) {
 		// Error writing IHDR.
 		// TODO: Unlink the PNG image.
-		ret = RPCT_OUTPUT_FILE_FAILED;
-		goto cleanup;
+		return RPCT_OUTPUT_FILE_FAILED;
 	}
 
 	/** IDAT chunk. **/
 
 	// Initialize the row pointers.
-	row_pointers.reset(new const uint8_t*[outParams.thumbSize.height]);
-	pixels = PIMGTYPE_get_image_data(outParams.retImg);
-	rowstride = PIMGTYPE_get_rowstride(outParams.retImg);
+	unique_ptr<const uint8_t*[]> row_pointers(new const uint8_t*[outParams.thumbSize.height]);
+	const guchar *pixels = PIMGTYPE_get_image_data(outParams.retImg);
+	const int rowstride = PIMGTYPE_get_rowstride(outParams.retImg);
 	for (int y = 0; y < outParams.thumbSize.height; y++, pixels += rowstride) {
 		row_pointers[y] = pixels;
 	}
@@ -453,12 +421,144 @@ G_MODULE_EXPORT int RP_C_API rp_create_thumbnail(const char *source_file, const
 	if (pwRet != 0) {
 		// Error writing IDAT.
 		// TODO: Unlink the PNG image.
-		ret = RPCT_OUTPUT_FILE_FAILED;
-		goto cleanup;
+		return RPCT_OUTPUT_FILE_FAILED;
+	}
+
+	return RPCT_SUCCESS;
+}
+
+#ifdef RP_GTK_USE_CAIRO
+// pthread_once() control variable for the rp_image backend.
+static pthread_once_t rp_image_backend_once_control = PTHREAD_ONCE_INIT;
+
+/**
+ * Register RpCairoBackend if no other backend is registered.
+ * rp_create_thumbnails() may be called from multiple threads,
+ * so this function MUST be called using pthread_once().
+ */
+static void init_rp_image_backend(void)
+{
+	if (!rp_image::backendCreatorFn()) {
+		rp_image::setBackendCreatorFn(RpCairoBackend::creator_fn);
+	}
+}
+#endif /* RP_GTK_USE_CAIRO */
+
+/**
+ * Thumbnail creator function for wrapper programs.
+ * Multiple sizes are created from a single decode of the source file.
+ * @param source_file Source file or URI. (UTF-8)
+ * @param output_files Output files. (UTF-8)
+ * @param maximum_sizes Maximum sizes.
+ * @param count Number of output files.
+ * @param cancelled [in,opt] If non-zero, stop before writing the next output file.
+ * @return 0 on success; non-zero on error.
+ */
+extern "C"
+G_MODULE_EXPORT int RP_C_API rp_create_thumbnails(const char *source_file,
+	const char *const *output_files, const int *maximum_sizes, unsigned int count,
+	const volatile int *cancelled)
+{
+	// Some of this is based on the GNOME Thumbnailer skeleton project.
+	// https://github.com/hadess/gnome-thumbnailer-skeleton/blob/master/gnome-thumbnailer-skeleton.c
+	CHECK_UID_RET(RPCT_RUNNING_AS_ROOT);
+
+	assert(output_files != nullptr);
+	assert(maximum_sizes != nullptr);
+	assert(count > 0);
+	if (!output_files || !maximum_sizes || count == 0) {
+		return RPCT_INVALID_IMAGE_SIZE;
+	}
+
+	// Make sure glib is initialized.
+	// NOTE: This is a no-op as of glib-2.35.1.
+#if !GLIB_CHECK_VERSION(2,35,1)
+	g_type_init();
+#endif
+
+#ifdef RP_GTK_USE_CAIRO
+	// Decode images directly into Cairo surfaces.
+	pthread_once(&rp_image_backend_once_control, init_rp_image_backend);
+#endif /* RP_GTK_USE_CAIRO */
+
+	// NOTE: TCreateThumbnail() has wrappers for opening the
+	// ROM file and getting RomData*, but we're doing it here
+	// in order to return better error codes.
+
+	// Attempt to open the ROM file.
+	IRpFile *file = nullptr;
+	string s_uri;
+	int ret = openFromFilenameOrURI(source_file, &file, s_uri);
+	if (ret != 0) {
+		// Error opening the file.
+		return ret;
+	}
+	assert(file != nullptr);
+
+	// Get the appropriate RomData class for this ROM.
+	// RomData class *must* support at least one image type.
+	RomData *const romData = RomDataFactory::create(file, RomDataFactory::RDA_HAS_THUMBNAIL);
+	file->unref();	// file is ref()'d by RomData.
+	if (!romData) {
+		// ROM is not supported.
+		return RPCT_SOURCE_FILE_NOT_SUPPORTED;
 	}
 
-cleanup:
-	d->freeImgClass(outParams.retImg);
+	// Create the thumbnails.
+	// The image is only decoded once; smaller sizes are
+	// downscaled from the next-larger thumbnail.
+	unique_ptr<CreateThumbnailPrivate> d(new CreateThumbnailPrivate());
+	unique_ptr<CreateThumbnailPrivate::GetThumbnailOutParams_t[]> outParams(
+		new CreateThumbnailPrivate::GetThumbnailOutParams_t[count]);
+	ret = d->getThumbnails(romData, maximum_sizes, count, outParams.get());
+	if (ret != 0) {
+		// No image.
+		romData->unref();
+		return RPCT_SOURCE_FILE_NO_IMAGE;
+	}
+
+	// tEXt chunks shared by all of the output files.
+	RpPngWriter::kv_vector kv_common;
+	getCommonTextChunks(romData, s_uri, kv_common);
+
+	// Save the images using RpPngWriter.
+	// NOTE: Decoding can't be interrupted, but if the request is
+	// cancelled, the remaining output files won't be written.
+	for (unsigned int i = 0; i < count; i++) {
+		if (ret == 0 && cancelled && g_atomic_int_get(cancelled)) {
+			ret = RPCT_CANCELLED;
+		}
+		if (ret == 0) {
+			ret = writeThumbnailPng(output_files[i], outParams[i], kv_common, s_uri);
+		}
+		d->freeImgClass(outParams[i].retImg);
+	}
 	romData->unref();
 	return ret;
 }
+
+/**
+ * Log the pixel buffer pool statistics.
+ * Used by wrapper programs, e.g. before shutting down.
+ */
+extern "C"
+G_MODULE_EXPORT void RP_C_API rp_log_pixel_buffer_pool_stats(void)
+{
+	LibRpTexture::PixelBufferPool::Stats poolStats;
+	LibRpTexture::PixelBufferPool::getStats(&poolStats);
+	g_debug("rom-properties pixel buffer pool: %u allocs, %u%% hit rate, %u oversize, %u evictions",
+		poolStats.allocs, poolStats.hitRate(), poolStats.oversize, poolStats.evictions);
+}
+
+/**
+ * Thumbnail creator function for wrapper programs.
+ * @param source_file Source file or URI. (UTF-8)
+ * @param output_file Output file. (UTF-8)
+ * @param maximum_size Maximum size.
+ * @return 0 on success; non-zero on error.
+ */
+extern "C"
+G_MODULE_EXPORT int RP_C_API rp_create_thumbnail(const char *source_file, const char *output_file, int maximum_size)
+{
+	return rp_create_thumbnails(source_file, &output_file, &maximum_size, 1, nullptr);
+}
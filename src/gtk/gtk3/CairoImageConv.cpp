@@ -2,12 +2,13 @@
  * ROM Properties Page shell extension. (GTK+ common)                      *
  * CairoImageConv.cpp: Helper functions to convert from rp_image to Cairo. *
  *                                                                         *
- * Copyright (c) 2017-2021 by David Korth.                                 *
+ * Copyright (c) 2017-2022 by David Korth.                                 *
  * SPDX-License-Identifier: GPL-2.0-or-later                               *
  ***************************************************************************/
 
 #include "stdafx.h"
 #include "CairoImageConv.hpp"
+#include "RpCairoBackend.hpp"
 
 // C++ STL classes.
 using std::array;
@@ -15,26 +16,66 @@ using std::array;
 // librptexture
 using LibRpTexture::rp_image;
 
+/**
+ * Get a Cairo surface from an rp_image that uses RpCairoBackend.
+ * @param img		[in] rp_image.
+ * @param premultiply	[in] If true, premultiply. Needed for display; NOT needed for PNG.
+ * @return cairo_surface_t, or nullptr if RpCairoBackend can't be used.
+ */
+cairo_surface_t *CairoImageConv::getBackendSurface(const rp_image *img, bool premultiply)
+{
+	if (img->format() != rp_image::Format::ARGB32)
+		return nullptr;
+
+	const RpCairoBackend *const backend =
+		dynamic_cast<const RpCairoBackend*>(img->backend());
+	if (backend && !premultiply) {
+		// The image is already stored in a Cairo surface.
+		// Use it directly. (zero-copy)
+		return backend->getCairoSurface();
+	} else if (premultiply && rp_image::backendCreatorFn() == RpCairoBackend::creator_fn) {
+		// Premultiply into a new image. This will use RpCairoBackend,
+		// so the new image's surface can be used directly.
+		rp_image *const img_prex = img->processed(rp_image::PixelOps().premultiply());
+		if (img_prex) {
+			const RpCairoBackend *const backend_prex =
+				dynamic_cast<const RpCairoBackend*>(img_prex->backend());
+			cairo_surface_t *const surface =
+				(backend_prex ? backend_prex->getCairoSurface() : nullptr);
+			img_prex->unref();
+			return surface;
+		}
+	}
+
+	return nullptr;
+}
+
 /**
  * Convert an rp_image to cairo_surface_t.
+ * Standard version using regular C++ code.
  * @param img		[in] rp_image.
  * @param premultiply	[in] If true, premultiply. Needed for display; NOT needed for PNG.
- * @return GdkPixbuf, or nullptr on error.
+ * @return cairo_surface_t, or nullptr on error.
  */
-cairo_surface_t *CairoImageConv::rp_image_to_cairo_surface_t(const rp_image *img, bool premultiply)
+cairo_surface_t *CairoImageConv::rp_image_to_cairo_surface_t_cpp(const rp_image *img, bool premultiply)
 {
 	assert(img != nullptr);
 	if (unlikely(!img || !img->isValid()))
 		return nullptr;
 
-	// NOTE: cairo_image_surface_create_for_data() doesn't do a
-	// deep copy, so we can't use it.
+	cairo_surface_t *surface = getBackendSurface(img, premultiply);
+	if (surface) {
+		return surface;
+	}
+
+	// NOTE: If the image doesn't use RpCairoBackend, the image data
+	// has to be copied into a new surface.
 	// NOTE 2: cairo_image_surface_create() always returns a valid
 	// pointer, but the status may be CAIRO_STATUS_NULL_POINTER if
 	// it failed to create a surface. We'll still check for nullptr.
 	const int width = img->width();
 	const int height = img->height();
-	cairo_surface_t *surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, width, height);
+	surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, width, height);
 	// cairo_image_surface_create() always returns a valid pointer.
 	assert(cairo_surface_status(surface) == CAIRO_STATUS_SUCCESS);
 	if (unlikely(cairo_surface_status(surface) != CAIRO_STATUS_SUCCESS)) {
@@ -50,9 +91,12 @@ cairo_surface_t *CairoImageConv::rp_image_to_cairo_surface_t(const rp_image *img
 			const rp_image *img_prex;
 			if (premultiply) {
 				// Premultiply the image first.
-				// TODO: Combined dup()/premultiply() function?
-				img_prex = img->dup();
-				const_cast<rp_image*>(img_prex)->premultiply();
+				// The copy and premultiply are done in a single pass.
+				img_prex = img->processed(rp_image::PixelOps().premultiply());
+				if (!img_prex) {
+					cairo_surface_destroy(surface);
+					return nullptr;
+				}
 			} else {
 				// No premultiplication.
 				img_prex = img;
@@ -2,15 +2,15 @@
  * ROM Properties Page shell extension. (GTK+ common)                      *
  * CairoImageConv.hpp: Helper functions to convert from rp_image to Cairo. *
  *                                                                         *
- * Copyright (c) 2017-2020 by David Korth.                                 *
+ * Copyright (c) 2017-2022 by David Korth.                                 *
  * SPDX-License-Identifier: GPL-2.0-or-later                               *
  ***************************************************************************/
 
 #ifndef __ROMPROPERTIES_GTK_CAIROIMAGECONV_HPP__
 #define __ROMPROPERTIES_GTK_CAIROIMAGECONV_HPP__
 
-// NOTE: Cairo doesn't natively support 8bpp. Because of this,
-// we can't simply make a cairo_surface_t rp_image backend.
+// NOTE: Cairo doesn't natively support 8bpp, so RpCairoBackend
+// is only used for ARGB32 images. CI8 images are converted here.
 
 #include "common.h"
 #include "librpcpu/cpu_dispatch.h"
@@ -20,6 +20,11 @@ namespace LibRpTexture {
 }
 #include <cairo.h>
 
+#if defined(RP_CPU_I386) || defined(RP_CPU_AMD64)
+# include "librpcpu/cpuflags_x86.h"
+# define CAIROIMAGECONV_HAS_SSSE3 1
+#endif
+
 class CairoImageConv
 {
 	private:
@@ -28,14 +33,68 @@ class CairoImageConv
 		~CairoImageConv();
 		RP_DISABLE_COPY(CairoImageConv)
 
+	private:
+		/**
+		 * Get a Cairo surface from an rp_image that uses RpCairoBackend.
+		 * @param img		[in] rp_image.
+		 * @param premultiply	[in] If true, premultiply. Needed for display; NOT needed for PNG.
+		 * @return cairo_surface_t, or nullptr if RpCairoBackend can't be used.
+		 */
+		static cairo_surface_t *getBackendSurface(const LibRpTexture::rp_image *img, bool premultiply);
+
 	public:
 		/**
 		 * Convert an rp_image to cairo_surface_t.
+		 * Standard version using regular C++ code.
+		 * @param img		[in] rp_image.
+		 * @param premultiply	[in] If true, premultiply. Needed for display; NOT needed for PNG.
+		 * @return cairo_surface_t, or nullptr on error.
+		 */
+		static cairo_surface_t *rp_image_to_cairo_surface_t_cpp(const LibRpTexture::rp_image *img, bool premultiply = true);
+
+#ifdef CAIROIMAGECONV_HAS_SSSE3
+		/**
+		 * Convert an rp_image to cairo_surface_t.
+		 * SSSE3-optimized version.
 		 * @param img		[in] rp_image.
 		 * @param premultiply	[in] If true, premultiply. Needed for display; NOT needed for PNG.
 		 * @return cairo_surface_t, or nullptr on error.
 		 */
-		static cairo_surface_t *rp_image_to_cairo_surface_t(const LibRpTexture::rp_image *img, bool premultiply = true);
+		static cairo_surface_t *rp_image_to_cairo_surface_t_ssse3(const LibRpTexture::rp_image *img, bool premultiply = true);
+#endif /* CAIROIMAGECONV_HAS_SSSE3 */
+
+		/**
+		 * Convert an rp_image to cairo_surface_t.
+		 * @param img		[in] rp_image.
+		 * @param premultiply	[in] If true, premultiply. Needed for display; NOT needed for PNG.
+		 * @return cairo_surface_t, or nullptr on error.
+		 */
+		static IFUNC_INLINE cairo_surface_t *rp_image_to_cairo_surface_t(const LibRpTexture::rp_image *img, bool premultiply = true);
 };
 
+#if !defined(HAVE_IFUNC) || (!defined(RP_CPU_I386) && !defined(RP_CPU_AMD64))
+
+// System does not support IFUNC, or we don't have optimizations for these CPUs.
+// Use standard inline dispatch.
+
+/**
+ * Convert an rp_image to cairo_surface_t.
+ * @param img		[in] rp_image.
+ * @param premultiply	[in] If true, premultiply. Needed for display; NOT needed for PNG.
+ * @return cairo_surface_t, or nullptr on error.
+ */
+inline cairo_surface_t *CairoImageConv::rp_image_to_cairo_surface_t(const LibRpTexture::rp_image *img, bool premultiply)
+{
+#ifdef CAIROIMAGECONV_HAS_SSSE3
+	if (RP_CPU_HasSSSE3()) {
+		return rp_image_to_cairo_surface_t_ssse3(img, premultiply);
+	} else
+#endif /* CAIROIMAGECONV_HAS_SSSE3 */
+	{
+		return rp_image_to_cairo_surface_t_cpp(img, premultiply);
+	}
+}
+
+#endif /* !defined(HAVE_IFUNC) || (!defined(RP_CPU_I386) && !defined(RP_CPU_AMD64)) */
+
 #endif /* __ROMPROPERTIES_GTK_CAIROIMAGECONV_HPP__ */
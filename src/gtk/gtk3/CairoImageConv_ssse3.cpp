@@ -0,0 +1,116 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (GTK+ 3.x)                         *
+ * CairoImageConv_ssse3.cpp: Helper functions to convert from rp_image to  *
+ * Cairo. (SSSE3-optimized version)                                        *
+ *                                                                         *
+ * Copyright (c) 2017-2022 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "stdafx.h"
+#include "CairoImageConv.hpp"
+
+// librptexture
+using LibRpTexture::rp_image;
+
+// SSSE3 intrinsics
+#include <emmintrin.h>
+#include <tmmintrin.h>
+
+/**
+ * Premultiply four ARGB32 pixels.
+ * Same algorithm as rp_image::premultiply_ssse3().
+ * @param px	[in] Four ARGB32 pixels.
+ * @return Premultiplied pixels.
+ */
+static FORCEINLINE __m128i premultiply_4px_ssse3(__m128i px)
+{
+	// Alpha shuffle masks: Copy alpha to the 16-bit B/G/R lanes.
+	const __m128i shuf_lo = _mm_setr_epi8(3,-1,3,-1,3,-1,-1,-1, 7,-1,7,-1,7,-1,-1,-1);
+	const __m128i shuf_hi = _mm_setr_epi8(11,-1,11,-1,11,-1,-1,-1, 15,-1,15,-1,15,-1,-1,-1);
+	const __m128i alpha_mul = _mm_setr_epi16(0,0,0,255, 0,0,0,255);
+	const __m128i rnd = _mm_set1_epi16(0x80);
+	const __m128i alpha_mask = _mm_set1_epi32(0xFF000000);
+	const __m128i zero = _mm_setzero_si128();
+
+	__m128i lo = _mm_unpacklo_epi8(px, zero);
+	__m128i hi = _mm_unpackhi_epi8(px, zero);
+	lo = _mm_mullo_epi16(lo, _mm_or_si128(_mm_shuffle_epi8(px, shuf_lo), alpha_mul));
+	hi = _mm_mullo_epi16(hi, _mm_or_si128(_mm_shuffle_epi8(px, shuf_hi), alpha_mul));
+	lo = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(lo, _mm_srli_epi16(lo, 8)), rnd), 8);
+	hi = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(hi, _mm_srli_epi16(hi, 8)), rnd), 8);
+	const __m128i res = _mm_packus_epi16(lo, hi);
+
+	// Keep the original pixels if alpha == 0.
+	const __m128i a0 = _mm_cmpeq_epi32(_mm_and_si128(px, alpha_mask), zero);
+	return _mm_or_si128(_mm_and_si128(a0, px), _mm_andnot_si128(a0, res));
+}
+
+/**
+ * Convert an rp_image to cairo_surface_t.
+ * SSSE3-optimized version.
+ * @param img		[in] rp_image.
+ * @param premultiply	[in] If true, premultiply. Needed for display; NOT needed for PNG.
+ * @return cairo_surface_t, or nullptr on error.
+ */
+cairo_surface_t *CairoImageConv::rp_image_to_cairo_surface_t_ssse3(const rp_image *img, bool premultiply)
+{
+	assert(img != nullptr);
+	if (unlikely(!img || !img->isValid()))
+		return nullptr;
+
+	if (!premultiply || img->format() != rp_image::Format::ARGB32) {
+		// Only premultiplied ARGB32 conversion is optimized.
+		// CI8 images only need the palette to be premultiplied.
+		return rp_image_to_cairo_surface_t_cpp(img, premultiply);
+	}
+
+	cairo_surface_t *surface = getBackendSurface(img, premultiply);
+	if (surface) {
+		return surface;
+	}
+
+	// Copy and premultiply the image data in a single pass.
+	const int width = img->width();
+	const int height = img->height();
+	surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, width, height);
+	// cairo_image_surface_create() always returns a valid pointer.
+	assert(cairo_surface_status(surface) == CAIRO_STATUS_SUCCESS);
+	if (unlikely(cairo_surface_status(surface) != CAIRO_STATUS_SUCCESS)) {
+		cairo_surface_destroy(surface);
+		return nullptr;
+	}
+
+	uint8_t *px_dest = cairo_image_surface_get_data(surface);
+	assert(px_dest != nullptr);
+	const uint8_t *img_buf = static_cast<const uint8_t*>(img->bits());
+	const int dest_stride = cairo_image_surface_get_stride(surface);
+	const int src_stride = img->stride();
+
+	for (unsigned int y = (unsigned int)height; y > 0; y--) {
+		// NOTE: Cairo only guarantees 4-byte row alignment.
+		const __m128i *xmm_src = reinterpret_cast<const __m128i*>(img_buf);
+		__m128i *xmm_dest = reinterpret_cast<__m128i*>(px_dest);
+
+		// Process 4 pixels per iteration using SSSE3.
+		unsigned int x;
+		for (x = (unsigned int)width; x > 3; x -= 4, xmm_src++, xmm_dest++) {
+			_mm_storeu_si128(xmm_dest, premultiply_4px_ssse3(_mm_loadu_si128(xmm_src)));
+		}
+
+		// Remaining pixels.
+		const uint32_t *px32_src = reinterpret_cast<const uint32_t*>(xmm_src);
+		uint32_t *px32_dest = reinterpret_cast<uint32_t*>(xmm_dest);
+		for (; x > 0; x--, px32_src++, px32_dest++) {
+			*px32_dest = rp_image::premultiply_pixel(*px32_src);
+		}
+
+		// Next line.
+		img_buf += src_stride;
+		px_dest += dest_stride;
+	}
+
+	// Mark the surface as dirty.
+	cairo_surface_mark_dirty(surface);
+	return surface;
+}
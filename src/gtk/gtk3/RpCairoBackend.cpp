@@ -0,0 +1,192 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (GTK+ 3.x)                         *
+ * RpCairoBackend.cpp: rp_image_backend using cairo_surface_t.             *
+ *                                                                         *
+ * Copyright (c) 2017-2022 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "stdafx.h"
+#include "RpCairoBackend.hpp"
+
+// librptexture
+#include "librptexture/img/PixelBufferPool.hpp"
+using LibRpTexture::rp_image;
+using LibRpTexture::rp_image_backend;
+
+// User data keys.
+// The pixel buffer is owned by the surface that was created first.
+// Shrunken surfaces hold a reference to their parent surface.
+static cairo_user_data_key_t data_key;
+static cairo_user_data_key_t parent_key;
+
+RpCairoBackend::RpCairoBackend(int width, int height, rp_image::Format format)
+	: super(width, height, format)
+	, m_surface(nullptr)
+{
+	// Cairo doesn't support 8bpp images.
+	assert(format == rp_image::Format::ARGB32);
+	if (format != rp_image::Format::ARGB32) {
+		clear_properties();
+		return;
+	}
+
+	// Allocate our own memory buffer.
+	// This is needed in order to use 16-byte row alignment.
+	this->stride = ALIGN_BYTES(16, width * sizeof(uint32_t));
+	uint8_t *const data = static_cast<uint8_t*>(
+		LibRpTexture::PixelBufferPool::allocBuffer(height * this->stride));
+	if (!data) {
+		// Error allocating the memory buffer.
+		clear_properties();
+		return;
+	}
+
+	// Create the Cairo surface using the allocated memory buffer.
+	// NOTE: cairo_image_surface_create_for_data() always returns
+	// a valid pointer, even on error.
+	m_surface = cairo_image_surface_create_for_data(data,
+		CAIRO_FORMAT_ARGB32, width, height, this->stride);
+	if (cairo_surface_status(m_surface) != CAIRO_STATUS_SUCCESS ||
+	    cairo_surface_set_user_data(m_surface, &data_key, data,
+		LibRpTexture::PixelBufferPool::freeBuffer) != CAIRO_STATUS_SUCCESS)
+	{
+		// Error creating the Cairo surface.
+		cairo_surface_destroy(m_surface);
+		m_surface = nullptr;
+		LibRpTexture::PixelBufferPool::freeBuffer(data);
+		clear_properties();
+		return;
+	}
+
+	// Make sure we have the correct stride.
+	assert(this->stride == cairo_image_surface_get_stride(m_surface));
+}
+
+RpCairoBackend::~RpCairoBackend()
+{
+	if (m_surface) {
+		cairo_surface_destroy(m_surface);
+	}
+}
+
+/**
+ * Creator function for rp_image::setBackendCreatorFn().
+ * @return RpCairoBackend, or nullptr if the format isn't ARGB32.
+ */
+rp_image_backend *RpCairoBackend::creator_fn(int width, int height, rp_image::Format format)
+{
+	if (format != rp_image::Format::ARGB32) {
+		// Not supported by Cairo. Use the default backend.
+		return nullptr;
+	}
+	return new RpCairoBackend(width, height, format);
+}
+
+void *RpCairoBackend::data(void)
+{
+	if (!m_surface)
+		return nullptr;
+	return cairo_image_surface_get_data(m_surface);
+}
+
+const void *RpCairoBackend::data(void) const
+{
+	if (!m_surface)
+		return nullptr;
+	return cairo_image_surface_get_data(m_surface);
+}
+
+size_t RpCairoBackend::data_len(void) const
+{
+	if (!m_surface)
+		return 0;
+	return static_cast<size_t>(this->stride) * this->height;
+}
+
+uint32_t *RpCairoBackend::palette(void)
+{
+	// ARGB32 only. No palette.
+	return nullptr;
+}
+
+const uint32_t *RpCairoBackend::palette(void) const
+{
+	// ARGB32 only. No palette.
+	return nullptr;
+}
+
+unsigned int RpCairoBackend::palette_len(void) const
+{
+	// ARGB32 only. No palette.
+	return 0;
+}
+
+/**
+ * Shrink image dimensions.
+ * @param width New width.
+ * @param height New height.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int RpCairoBackend::shrink(int width, int height)
+{
+	assert(width > 0);
+	assert(height > 0);
+	assert(this->width > 0);
+	assert(this->height > 0);
+	assert(width <= this->width);
+	assert(height <= this->height);
+	if (!m_surface || width <= 0 || height <= 0 ||
+	    this->width <= 0 || this->height <= 0 ||
+	    width > this->width || height > this->height)
+	{
+		return -EINVAL;
+	}
+
+	// Cairo doesn't support changing width/height in-place,
+	// but the stride doesn't change, so we can create a new
+	// surface using the same memory buffer.
+	cairo_surface_flush(m_surface);
+	cairo_surface_t *const surface = cairo_image_surface_create_for_data(
+		cairo_image_surface_get_data(m_surface),
+		CAIRO_FORMAT_ARGB32, width, height, this->stride);
+	if (cairo_surface_status(surface) != CAIRO_STATUS_SUCCESS) {
+		cairo_surface_destroy(surface);
+		return -ENOMEM;
+	}
+
+	// The new surface takes over our reference to the old surface,
+	// which owns the memory buffer.
+	if (cairo_surface_set_user_data(surface, &parent_key, m_surface,
+		reinterpret_cast<cairo_destroy_func_t>(cairo_surface_destroy)) != CAIRO_STATUS_SUCCESS)
+	{
+		cairo_surface_destroy(surface);
+		return -ENOMEM;
+	}
+
+	m_surface = surface;
+	this->width = width;
+	this->height = height;
+	return 0;
+}
+
+/**
+ * Get the underlying Cairo surface.
+ *
+ * NOTE: The surface shares its pixel buffer with the rp_image,
+ * so the rp_image must not be modified while the surface is
+ * in use. The pixel buffer remains valid after the rp_image
+ * is deleted.
+ *
+ * @return New reference to the cairo_surface_t. (Caller must destroy it.)
+ */
+cairo_surface_t *RpCairoBackend::getCairoSurface(void) const
+{
+	if (!m_surface)
+		return nullptr;
+
+	// rp_image functions write to the buffer directly,
+	// so Cairo has to drop any cached data.
+	cairo_surface_mark_dirty(m_surface);
+	return cairo_surface_reference(m_surface);
+}
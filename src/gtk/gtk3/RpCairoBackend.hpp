@@ -0,0 +1,86 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (GTK+ 3.x)                         *
+ * RpCairoBackend.hpp: rp_image_backend using cairo_surface_t.             *
+ *                                                                         *
+ * Copyright (c) 2017-2022 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#ifndef __ROMPROPERTIES_GTK_GTK3_RPCAIROBACKEND_HPP__
+#define __ROMPROPERTIES_GTK_GTK3_RPCAIROBACKEND_HPP__
+
+// librptexture
+#include "librptexture/img/rp_image_backend.hpp"
+
+// Cairo
+#include <cairo.h>
+
+/**
+ * rp_image data storage class using a Cairo image surface.
+ *
+ * rp_image's ARGB32 format has the same memory layout as
+ * CAIRO_FORMAT_ARGB32, so decoders write directly into the
+ * surface's pixel buffer.
+ *
+ * NOTE: Cairo doesn't support 8bpp images, so only ARGB32
+ * is supported. CI8 images use the default backend.
+ *
+ * NOTE: rp_image uses straight alpha, whereas Cairo expects
+ * premultiplied alpha for display. The surface can be used
+ * as-is for writing PNGs, but it has to be premultiplied
+ * before being drawn.
+ */
+class RpCairoBackend : public LibRpTexture::rp_image_backend
+{
+	public:
+		RpCairoBackend(int width, int height, LibRpTexture::rp_image::Format format);
+		~RpCairoBackend() final;
+
+	private:
+		typedef LibRpTexture::rp_image_backend super;
+		RP_DISABLE_COPY(RpCairoBackend)
+
+	public:
+		/**
+		 * Creator function for rp_image::setBackendCreatorFn().
+		 * @return RpCairoBackend, or nullptr if the format isn't ARGB32.
+		 */
+		static LibRpTexture::rp_image_backend *creator_fn(int width, int height, LibRpTexture::rp_image::Format format);
+
+		// Image data.
+		void *data(void) final;
+		const void *data(void) const final;
+		size_t data_len(void) const final;
+
+		// Image palette.
+		uint32_t *palette(void) final;
+		const uint32_t *palette(void) const final;
+		unsigned int palette_len(void) const final;
+
+	public:
+		/**
+		 * Shrink image dimensions.
+		 * @param width New width.
+		 * @param height New height.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		int shrink(int width, int height) final;
+
+	public:
+		/**
+		 * Get the underlying Cairo surface.
+		 *
+		 * NOTE: The surface shares its pixel buffer with the rp_image,
+		 * so the rp_image must not be modified while the surface is
+		 * in use. The pixel buffer remains valid after the rp_image
+		 * is deleted.
+		 *
+		 * @return New reference to the cairo_surface_t. (Caller must destroy it.)
+		 */
+		cairo_surface_t *getCairoSurface(void) const;
+
+	protected:
+		cairo_surface_t *m_surface;
+};
+
+#endif /* __ROMPROPERTIES_GTK_GTK3_RPCAIROBACKEND_HPP__ */
@@ -13,6 +13,7 @@
 #include "RpNautilusPlugin.hpp"
 #include "RpNautilusProvider.hpp"
 #include "AchGDBus.hpp"
+#include "RpCairoBackend.hpp"
 
 static GType type_list[1];
 
@@ -75,6 +76,9 @@ prefix##_module_initialize(GTypeModule *module) \
 \
 	/* Symbols loaded. Register our types. */ \
 	rp_nautilus_register_types(module); \
+\
+	/* Decode images directly into Cairo surfaces. */ \
+	LibRpTexture::rp_image::setBackendCreatorFn(RpCairoBackend::creator_fn); \
 \
 	/* Register AchGDBus if it's available. */ \
 	REGISTER_ACHDBUS(); \
@@ -13,6 +13,7 @@
 #include "RpThunarPlugin.hpp"
 #include "RpThunarProvider.hpp"
 #include "AchGDBus.hpp"
+#include "RpCairoBackend.hpp"
 
 // Thunar version is based on GTK+ version.
 #if GTK_CHECK_VERSION(3,0,0)
@@ -99,6 +100,9 @@ thunar_extension_initialize(ThunarxProviderPlugin *plugin)
 
 	// Symbols loaded. Register our types.
 	rp_thunar_register_types(plugin);
+
+	// Decode images directly into Cairo surfaces.
+	LibRpTexture::rp_image::setBackendCreatorFn(RpCairoBackend::creator_fn);
 }
 
 /** Common shutdown and list_types functions. **/
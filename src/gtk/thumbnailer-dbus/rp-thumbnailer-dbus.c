@@ -21,6 +21,7 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <string.h>
+#include <unistd.h>
 
 // from tumbler-utils.h
 #define g_dbus_async_return_val_if_fail(expr, invocation, val) \
@@ -42,6 +43,8 @@ enum RpThumbnailerProperties {
 	PROP_CONNECTION,
 	PROP_CACHE_DIR,
 	PROP_PFN_RP_CREATE_THUMBNAIL,
+	PROP_PFN_RP_CREATE_THUMBNAILS,
+	PROP_MAX_THREADS,
 	PROP_EXPORTED,
 
 	PROP_LAST
@@ -68,8 +71,12 @@ static void	rp_thumbnailer_set_property	(GObject	*object,
 						 const GValue	*value,
 						 GParamSpec	*pspec);
 
+struct request_info;
 static gboolean	rp_thumbnailer_timeout		(RpThumbnailer	*thumbnailer);
-static gboolean	rp_thumbnailer_process		(RpThumbnailer	*thumbnailer);
+static void	rp_thumbnailer_dispatch		(RpThumbnailer	*thumbnailer);
+static void	rp_thumbnailer_process		(struct request_info *req,
+						 RpThumbnailer	*thumbnailer);
+static gboolean	rp_thumbnailer_complete		(struct request_info *req);
 
 // D-Bus methods.
 static gboolean	rp_thumbnailer_queue		(OrgFreedesktopThumbnailsSpecializedThumbnailer1 *skeleton,
@@ -93,14 +100,64 @@ struct _RpThumbnailerClass {
 
 #define SHUTDOWN_TIMEOUT_SECONDS 30U
 
+// Request priorities.
+// The SpecializedThumbnailer1 interface doesn't have the 'scheduler'
+// argument from Thumbnailer1, so 'urgent' requests are handled as
+// "foreground" and everything else is handled as "background".
+typedef enum {
+	RP_PRIORITY_FOREGROUND	= 0,	// 'urgent' requests
+	RP_PRIORITY_BACKGROUND	= 1,	// everything else
+
+	RP_PRIORITY_MAX
+} RpThumbnailerPriority;
+
+// Thumbnail flavors.
+// Reference: https://specifications.freedesktop.org/thumbnail-spec/thumbnail-spec-latest.html
+typedef struct _RpThumbnailFlavor {
+	const char *name;	// Flavor name, which is also the cache subdirectory.
+	int size;		// Maximum thumbnail size.
+} RpThumbnailFlavor;
+static const RpThumbnailFlavor rp_thumbnail_flavors[] = {
+	{"normal",	 128},
+	{"large",	 256},
+	{"x-large",	 512},
+	{"xx-large",	1024},
+};
+#define RP_THUMBNAIL_FLAVOR_COUNT G_N_ELEMENTS(rp_thumbnail_flavors)
+#define RP_THUMBNAIL_FLAVOR_NORMAL (1U << 0)
+
 // Thumbnail request information.
 struct request_info {
 	gchar *uri;
 	guint32 handle;
-	bool large;	// False for 'normal' (128x128); true for 'large' (256x256)
+	guint flavors;	// Bitfield of rp_thumbnail_flavors[] indexes
 	bool urgent;	// 'urgent' value
+
+	// Set by rp_thumbnailer_dequeue() if the request
+	// was dequeued while it was being processed.
+	// Checked by the worker thread, so use atomic access.
+	gint cancelled;
+
+	// Owning RpThumbnailer. (Holds a reference while in flight.)
+	RpThumbnailer *thumbnailer;
+
+	// Result, set by the worker thread.
+	// If error_msg is NULL, the thumbnail was created successfully.
+	const char *error_msg;
+	int error_code;
 };
 
+/**
+ * Free a request_info struct.
+ * @param req request_info
+ */
+static void
+request_info_free(struct request_info *req)
+{
+	g_free(req->uri);
+	g_free(req);
+}
+
 struct _RpThumbnailer {
 	GObject __parent__;
 	OrgFreedesktopThumbnailsSpecializedThumbnailer1 *skeleton;
@@ -111,14 +168,23 @@ struct _RpThumbnailer {
 	// Shutdown timeout.
 	guint timeout_id;
 
-	// Idle function for processing.
-	guint idle_process;
-
 	// Last handle value.
 	guint32 last_handle;
 
-	// Request queue.
-	GQueue request_queue;	// element is struct request_info*
+	// Request queues, one per priority.
+	// Requests are dispatched from the highest-priority queue
+	// that isn't empty, so newer foreground requests are
+	// processed before older background requests.
+	GQueue request_queue[RP_PRIORITY_MAX];	// element is struct request_info*
+
+	// Requests currently being processed by the worker pool.
+	// No more than max_threads requests are in flight at once,
+	// so the pool's own queue is always empty and Dequeue
+	// can simply remove pending requests from request_queue[].
+	GQueue active_requests;	// element is struct request_info*
+
+	// Worker thread pool.
+	GThreadPool *pool;
 
 	/** Properties. **/
 
@@ -131,6 +197,14 @@ struct _RpThumbnailer {
 	// rp_create_thumbnail() function pointer.
 	PFN_RP_CREATE_THUMBNAIL pfn_rp_create_thumbnail;
 
+	// rp_create_thumbnails() function pointer. (optional)
+	// Used if a request has more than one flavor.
+	PFN_RP_CREATE_THUMBNAILS pfn_rp_create_thumbnails;
+
+	// Maximum number of worker threads.
+	// If 0, the number of CPU cores is used.
+	guint max_threads;
+
 	// Is the D-Bus object exported?
 	bool exported;
 };
@@ -200,6 +274,15 @@ rp_thumbnailer_class_init(RpThumbnailerClass *klass, gpointer class_data)
 		"pfn-rp-create-thumbnail", "pfn-rp-create-thumbnail", "rp_create_thumbnail() function pointer.",
 		G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | G_PARAM_CONSTRUCT_ONLY);
 
+	props[PROP_PFN_RP_CREATE_THUMBNAILS] = g_param_spec_pointer(
+		"pfn-rp-create-thumbnails", "pfn-rp-create-thumbnails", "rp_create_thumbnails() function pointer. (optional)",
+		G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | G_PARAM_CONSTRUCT_ONLY);
+
+	props[PROP_MAX_THREADS] = g_param_spec_uint(
+		"max-threads", "max-threads", "Maximum number of worker threads. (0 for the number of CPU cores)",
+		0, 256, 0,
+		G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | G_PARAM_CONSTRUCT_ONLY);
+
 	props[PROP_EXPORTED] = g_param_spec_boolean(
 		"exported", "exported", "Is the D-Bus object exported?",
 		false,
@@ -232,7 +315,27 @@ rp_thumbnailer_constructed(GObject *object)
 	g_return_if_fail(IS_RP_THUMBNAILER(object));
 	RpThumbnailer *const thumbnailer = RP_THUMBNAILER(object);
 
+	// Create the worker thread pool.
+	if (thumbnailer->max_threads == 0) {
+#if GLIB_CHECK_VERSION(2,36,0)
+		thumbnailer->max_threads = g_get_num_processors();
+#else /* !GLIB_CHECK_VERSION(2,36,0) */
+		const long nprocs = sysconf(_SC_NPROCESSORS_ONLN);
+		thumbnailer->max_threads = (nprocs > 0 ? (guint)nprocs : 1);
+#endif /* GLIB_CHECK_VERSION(2,36,0) */
+	}
+	g_debug("Using %u worker thread(s).", thumbnailer->max_threads);
+
 	GError *error = NULL;
+	thumbnailer->pool = g_thread_pool_new((GFunc)rp_thumbnailer_process, thumbnailer,
+		(gint)thumbnailer->max_threads, false, &error);
+	if (error) {
+		g_critical("Error creating the RpThumbnailer thread pool: %s", error->message);
+		g_error_free(error);
+		thumbnailer->exported = false;
+		return;
+	}
+
 	thumbnailer->skeleton = org_freedesktop_thumbnails_specialized_thumbnailer1_skeleton_new();
 	g_dbus_interface_skeleton_export(G_DBUS_INTERFACE_SKELETON(thumbnailer->skeleton),
 		thumbnailer->connection, "/com/gerbilsoft/rom_properties/SpecializedThumbnailer1", &error);
@@ -269,10 +372,12 @@ rp_thumbnailer_dispose(GObject *object)
 		thumbnailer->timeout_id = 0;
 	}
 
-	// Unregister idle_process.
-	if (G_UNLIKELY(thumbnailer->idle_process != 0)) {
-		g_source_remove(thumbnailer->idle_process);
-		thumbnailer->idle_process = 0;
+	// Stop the worker thread pool.
+	// NOTE: In-flight requests hold a reference to the RpThumbnailer,
+	// so nothing should be running at this point.
+	if (thumbnailer->pool) {
+		g_thread_pool_free(thumbnailer->pool, false, true);
+		thumbnailer->pool = NULL;
 	}
 
 	// No longer exported.
@@ -288,15 +393,18 @@ rp_thumbnailer_finalize(GObject *object)
 	RpThumbnailer *const thumbnailer = RP_THUMBNAILER(object);
 	g_clear_object(&thumbnailer->skeleton);
 
-	// Delete any remaining requests and free the queue.
-	for (GList *p = thumbnailer->request_queue.head; p != NULL; p = p->next) {
-		if (p->data) {
-			struct request_info *const req = (struct request_info*)p->data;
-			g_free(req->uri);
-			g_free(req);
+	// Delete any remaining requests and free the queues.
+	for (unsigned int prio = 0; prio < RP_PRIORITY_MAX; prio++) {
+		GQueue *const queue = &thumbnailer->request_queue[prio];
+		for (GList *p = queue->head; p != NULL; p = p->next) {
+			if (p->data) {
+				request_info_free((struct request_info*)p->data);
+			}
 		}
+		g_queue_clear(queue);
 	}
-	g_queue_clear(&thumbnailer->request_queue);
+	g_warn_if_fail(g_queue_is_empty(&thumbnailer->active_requests));
+	g_queue_clear(&thumbnailer->active_requests);
 
 	/** Properties. **/
 	g_free(thumbnailer->cache_dir);
@@ -329,6 +437,12 @@ rp_thumbnailer_get_property(GObject *object,
 		case PROP_PFN_RP_CREATE_THUMBNAIL:
 			g_value_set_pointer(value, (gpointer)thumbnailer->pfn_rp_create_thumbnail);
 			break;
+		case PROP_PFN_RP_CREATE_THUMBNAILS:
+			g_value_set_pointer(value, (gpointer)thumbnailer->pfn_rp_create_thumbnails);
+			break;
+		case PROP_MAX_THREADS:
+			g_value_set_uint(value, thumbnailer->max_threads);
+			break;
 		case PROP_EXPORTED:
 			g_value_set_boolean(value, thumbnailer->exported);
 			break;
@@ -374,6 +488,15 @@ rp_thumbnailer_set_property(GObject *object,
 				(PFN_RP_CREATE_THUMBNAIL)g_value_get_pointer(value);
 			break;
 
+		case PROP_PFN_RP_CREATE_THUMBNAILS:
+			thumbnailer->pfn_rp_create_thumbnails =
+				(PFN_RP_CREATE_THUMBNAILS)g_value_get_pointer(value);
+			break;
+
+		case PROP_MAX_THREADS:
+			thumbnailer->max_threads = g_value_get_uint(value);
+			break;
+
 		case PROP_EXPORTED:
 			// FIXME: Read-only property.
 			// Need to show some error message...
@@ -385,13 +508,54 @@ rp_thumbnailer_set_property(GObject *object,
 	}
 }
 
+/**
+ * Parse a thumbnail flavor string.
+ *
+ * The flavor may be a single flavor, e.g. "large", or a comma-separated
+ * list of flavors, e.g. "normal,large,x-large", in which case all of
+ * the flavors are created from a single decode of the source file.
+ * "all" selects all supported flavors.
+ *
+ * Unknown flavors are ignored. If no known flavors are specified,
+ * "normal" is used.
+ *
+ * @param flavor	[in] Flavor string.
+ * @return Bitfield of rp_thumbnail_flavors[] indexes.
+ */
+static guint
+rp_thumbnailer_parse_flavor(const char *flavor)
+{
+	if (!flavor || flavor[0] == '\0') {
+		return RP_THUMBNAIL_FLAVOR_NORMAL;
+	}
+
+	if (!g_ascii_strcasecmp(flavor, "all")) {
+		return (1U << RP_THUMBNAIL_FLAVOR_COUNT) - 1;
+	}
+
+	guint flavors = 0;
+	gchar **const tokens = g_strsplit(flavor, ",", -1);
+	for (gchar **p = tokens; *p != NULL; p++) {
+		const gchar *const token = g_strstrip(*p);
+		for (unsigned int i = 0; i < RP_THUMBNAIL_FLAVOR_COUNT; i++) {
+			if (!g_ascii_strcasecmp(token, rp_thumbnail_flavors[i].name)) {
+				flavors |= (1U << i);
+				break;
+			}
+		}
+	}
+	g_strfreev(tokens);
+
+	return (flavors != 0 ? flavors : RP_THUMBNAIL_FLAVOR_NORMAL);
+}
+
 /**
  * Queue a ROM image for thumbnailing.
  * @param skeleton	[in] GDBusObjectSkeleton
  * @param invocation	[in/out] GDBusMethodInvocation
  * @param uri		[in] URI to thumbnail.
  * @param mime_type	[in] MIME type of the URI.
- * @param flavor	[in] The flavor that should be made, e.g. "normal".
+ * @param flavor	[in] The flavor that should be made, e.g. "normal". (may be a comma-separated list)
  * @param urgent	[in] Is this thumbnail "urgent"?
  * @param thumbnailer	[in] RpThumbnailer object.
  * @return True if the signal was handled; false if not.
@@ -430,22 +594,19 @@ rp_thumbnailer_queue(OrgFreedesktopThumbnailsSpecializedThumbnailer1 *skeleton,
 	}
 
 	// Add the URI to the queue.
-	// NOTE: Currently handling all flavors that aren't "large" as "normal".
-	struct request_info *const req = g_malloc(sizeof(struct request_info));
+	struct request_info *const req = g_malloc0(sizeof(struct request_info));
 	req->uri = g_strdup(uri);
 	req->handle = handle;
-	req->large = flavor && (g_ascii_strcasecmp(flavor, "large") == 0);
+	req->flavors = rp_thumbnailer_parse_flavor(flavor);
 	req->urgent = urgent;
-	// TODO Put 'urgent' requests at the front of the queue?
-	g_queue_push_tail(&thumbnailer->request_queue, req);
-
-	// Make sure the idle process is started.
-	// TODO: Make it multi-threaded? (needs atomic compare and/or mutex...)
-	if (thumbnailer->idle_process == 0) {
-		thumbnailer->idle_process = g_idle_add((GSourceFunc)rp_thumbnailer_process, thumbnailer);
-	}
+	g_queue_push_tail(&thumbnailer->request_queue[
+		urgent ? RP_PRIORITY_FOREGROUND : RP_PRIORITY_BACKGROUND], req);
 
+	// Return the handle before any signals are emitted for it.
 	org_freedesktop_thumbnails_specialized_thumbnailer1_complete_queue(skeleton, invocation, handle);
+
+	// Start processing the request if a worker thread is available.
+	rp_thumbnailer_dispatch(thumbnailer);
 	return true;
 }
 
@@ -466,11 +627,56 @@ rp_thumbnailer_dequeue(OrgFreedesktopThumbnailsSpecializedThumbnailer1 *skeleton
 	g_dbus_async_return_val_if_fail(IS_RP_THUMBNAILER(thumbnailer), invocation, false);
 	g_dbus_async_return_val_if_fail(handle != 0, invocation, false);
 
-	// TODO
+	// NOTE: No signals are emitted for dequeued requests.
+
+	// If the request hasn't been started yet, remove it from the queue.
+	for (unsigned int prio = 0; prio < RP_PRIORITY_MAX; prio++) {
+		GQueue *const queue = &thumbnailer->request_queue[prio];
+		for (GList *p = queue->head; p != NULL; p = p->next) {
+			struct request_info *const req = (struct request_info*)p->data;
+			if (req->handle == handle) {
+				g_queue_delete_link(queue, p);
+				request_info_free(req);
+				goto done;
+			}
+		}
+	}
+
+	// If the request is in flight, mark it as cancelled.
+	// The worker thread will skip it if it hasn't started
+	// creating the thumbnail yet, or stop before writing the
+	// next flavor if it has. rp_thumbnailer_complete() won't
+	// emit any signals for it.
+	for (GList *p = thumbnailer->active_requests.head; p != NULL; p = p->next) {
+		struct request_info *const req = (struct request_info*)p->data;
+		if (req->handle == handle) {
+			g_atomic_int_set(&req->cancelled, 1);
+			break;
+		}
+	}
+
+done:
 	org_freedesktop_thumbnails_specialized_thumbnailer1_complete_dequeue(skeleton, invocation);
 	return true;
 }
 
+/**
+ * Is the RpThumbnailer idle?
+ * @param thumbnailer RpThumbnailer object.
+ * @return True if no requests are queued or in flight; false if not.
+ */
+static bool
+rp_thumbnailer_is_idle(RpThumbnailer *thumbnailer)
+{
+	if (!g_queue_is_empty(&thumbnailer->active_requests))
+		return false;
+	for (unsigned int prio = 0; prio < RP_PRIORITY_MAX; prio++) {
+		if (!g_queue_is_empty(&thumbnailer->request_queue[prio]))
+			return false;
+	}
+	return true;
+}
+
 /**
  * Inactivity timeout has elapsed.
  * @param thumbnailer RpThumbnailer object.
@@ -479,7 +685,7 @@ static gboolean
 rp_thumbnailer_timeout(RpThumbnailer *thumbnailer)
 {
 	g_return_val_if_fail(IS_RP_THUMBNAILER(thumbnailer), false);
-	if (!g_queue_is_empty(&thumbnailer->request_queue)) {
+	if (!rp_thumbnailer_is_idle(thumbnailer)) {
 		// Still processing stuff.
 		return true;
 	}
@@ -493,138 +699,212 @@ rp_thumbnailer_timeout(RpThumbnailer *thumbnailer)
 }
 
 /**
- * Process a thumbnail.
+ * Get the next request to process.
  * @param thumbnailer RpThumbnailer object.
+ * @return Highest-priority request, or NULL if no requests are queued.
  */
-static gboolean
-rp_thumbnailer_process(RpThumbnailer *thumbnailer)
+static struct request_info*
+rp_thumbnailer_pop_request(RpThumbnailer *thumbnailer)
 {
-	g_return_val_if_fail(IS_RP_THUMBNAILER(thumbnailer), FALSE);
-
-	const gchar *md5_string;	// owned by md5 object
-	const struct request_info *req;	// request info from the map
-	gchar *cache_filename = NULL;	// cache filename (g_strdup_printf())
-	size_t cache_filename_sz;	// size of cache_filename
-	int pos, pos2;			// snprintf() position
-	int ret;
-
-	// Process one thumbnail.
-	req = (struct request_info*)g_queue_pop_head(&thumbnailer->request_queue);
-	if (req == NULL) {
-		// Nothing in the queue.
-		goto cleanup;
+	for (unsigned int prio = 0; prio < RP_PRIORITY_MAX; prio++) {
+		struct request_info *const req =
+			(struct request_info*)g_queue_pop_head(&thumbnailer->request_queue[prio]);
+		if (req)
+			return req;
 	}
+	return NULL;
+}
 
-	// NOTE: cache_dir and pfn_rp_create_thumbnail should NOT be NULL
-	// at this point, but we're checking it anyway.
-	if (!thumbnailer->cache_dir || thumbnailer->cache_dir[0] == 0) {
-		// No cache directory...
-		org_freedesktop_thumbnails_specialized_thumbnailer1_emit_error(
-			thumbnailer->skeleton, req->handle, "",
-			0, "Thumbnail cache directory is empty.");
-		goto finished;
-	}
-	if (!thumbnailer->pfn_rp_create_thumbnail) {
-		// No thumbnailer function.
-		org_freedesktop_thumbnails_specialized_thumbnailer1_emit_error(
-			thumbnailer->skeleton, req->handle, "",
-			0, "No thumbnailer function is available.");
-		goto finished;
-	}
+/**
+ * Start processing queued requests.
+ * Requests are handed to the worker pool in priority order
+ * until all worker threads are busy or the queues are empty.
+ *
+ * This function must be called on the main thread.
+ *
+ * @param thumbnailer RpThumbnailer object.
+ */
+static void
+rp_thumbnailer_dispatch(RpThumbnailer *thumbnailer)
+{
+	while (g_queue_get_length(&thumbnailer->active_requests) < thumbnailer->max_threads) {
+		struct request_info *const req = rp_thumbnailer_pop_request(thumbnailer);
+		if (!req) {
+			// Nothing in the queue.
+			break;
+		}
 
-	// TODO: Make sure the URI to thumbnail is not in the cache directory.
+		// NOTE: cache_dir and pfn_rp_create_thumbnail should NOT be NULL
+		// at this point, but we're checking it anyway.
+		const char *error_msg = NULL;
+		if (!thumbnailer->cache_dir || thumbnailer->cache_dir[0] == 0) {
+			// No cache directory...
+			error_msg = "Thumbnail cache directory is empty.";
+		} else if (!thumbnailer->pfn_rp_create_thumbnail) {
+			// No thumbnailer function.
+			error_msg = "No thumbnailer function is available.";
+		}
+		if (error_msg) {
+			org_freedesktop_thumbnails_specialized_thumbnailer1_emit_error(
+				thumbnailer->skeleton, req->handle, "", 0, error_msg);
+			org_freedesktop_thumbnails_specialized_thumbnailer1_emit_finished(
+				thumbnailer->skeleton, req->handle);
+			request_info_free(req);
+			continue;
+		}
 
-	// Make sure the thumbnail directory exists.
-	// g_malloc() sizes:
-	// - "/thumbnails/" == 12
-	// - "large" / "normal" == 6
-	// - "/" == 1
-	// - MD5 as a string == 32
-	// - ".png" == 4
-	// NULL terminator == 1
-	cache_filename_sz = strlen(thumbnailer->cache_dir) + 12 + 6 + 1 + 32 + 4 + 1;
-	cache_filename = g_malloc(cache_filename_sz);
-	pos = snprintf(cache_filename, cache_filename_sz, "%s/thumbnails/%s",
-		thumbnailer->cache_dir, (req->large ? "large" : "normal"));
-	// pos does NOT include the NULL terminator, so check >=.
-	if (pos < 0 || ((size_t)pos + 1 + 32 + 4) > cache_filename_sz) {
-		// Not enough memory.
-		org_freedesktop_thumbnails_specialized_thumbnailer1_emit_error(
-			thumbnailer->skeleton, req->handle, req->uri,
-			0, "Cannot snprintf() the thumbnail cache directory name.");
-		goto finished;
+		// Hand the request to the worker pool.
+		// The request holds a reference to the RpThumbnailer
+		// until rp_thumbnailer_complete() is called.
+		org_freedesktop_thumbnails_specialized_thumbnailer1_emit_started(
+			thumbnailer->skeleton, req->handle);
+		req->thumbnailer = g_object_ref(thumbnailer);
+		g_queue_push_tail(&thumbnailer->active_requests, req);
+		g_thread_pool_push(thumbnailer->pool, req, NULL);
 	}
 
-	if (g_mkdir_with_parents(cache_filename, 0777) != 0) {
-		org_freedesktop_thumbnails_specialized_thumbnailer1_emit_error(
-			thumbnailer->skeleton, req->handle, req->uri,
-			0, "Cannot mkdir() the thumbnail cache directory.");
-		goto finished;
+	if (rp_thumbnailer_is_idle(thumbnailer)) {
+		// Nothing is queued or in flight. This can happen if all of
+		// the dispatched requests failed immediately, so make sure
+		// the inactivity timeout is running.
+		if (G_LIKELY(thumbnailer->timeout_id == 0)) {
+			thumbnailer->timeout_id = g_timeout_add_seconds(SHUTDOWN_TIMEOUT_SECONDS,
+				(GSourceFunc)rp_thumbnailer_timeout, thumbnailer);
+		}
+	}
+}
+
+/**
+ * Process a thumbnail.
+ *
+ * This function runs on a worker thread. D-Bus signals are
+ * emitted by rp_thumbnailer_complete() on the main thread.
+ *
+ * @param req request_info
+ * @param thumbnailer RpThumbnailer object.
+ */
+static void
+rp_thumbnailer_process(struct request_info *req, RpThumbnailer *thumbnailer)
+{
+	gchar *md5_string = NULL;	// MD5 of the URI (g_compute_checksum_for_data())
+	gchar *cache_filenames[RP_THUMBNAIL_FLAVOR_COUNT];	// cache filenames (g_strdup_printf())
+	int maximum_sizes[RP_THUMBNAIL_FLAVOR_COUNT];
+	unsigned int count = 0;
+	int ret = 0;
+
+	if (g_atomic_int_get(&req->cancelled)) {
+		// Request was dequeued before it was started.
+		goto cleanup;
 	}
 
+	// TODO: Make sure the URI to thumbnail is not in the cache directory.
+
 	// Reference: https://specifications.freedesktop.org/thumbnail-spec/thumbnail-spec-latest.html
 	md5_string = g_compute_checksum_for_data(G_CHECKSUM_MD5, (const guchar*)req->uri, strlen(req->uri));
 	if (!md5_string) {
 		// Cannot compute the checksum...
-		org_freedesktop_thumbnails_specialized_thumbnailer1_emit_error(
-			thumbnailer->skeleton, req->handle, req->uri,
-			0, "g_compute_checksum_for_data() failed.");
-		goto finished;
+		req->error_msg = "g_compute_checksum_for_data() failed.";
+		goto cleanup;
 	}
 
-	// Append the MD5.
-	pos2 = snprintf(&cache_filename[pos], cache_filename_sz - pos, "/%s.png", md5_string);
-	// pos and pos2 do NOT include the NULL terminator, so check >=.
-	if (pos2 < 0 || ((size_t)pos + (size_t)pos2) >= cache_filename_sz) {
-		// Not enough memory.
-		org_freedesktop_thumbnails_specialized_thumbnailer1_emit_error(
-			thumbnailer->skeleton, req->handle, req->uri,
-			0, "Cannot snprintf() the thumbnail filename.");
-		goto finished;
+	// Make sure the thumbnail directories exist.
+	for (unsigned int i = 0; i < RP_THUMBNAIL_FLAVOR_COUNT; i++) {
+		if (!(req->flavors & (1U << i)))
+			continue;
+
+		gchar *const cache_dirname = g_strdup_printf("%s/thumbnails/%s",
+			thumbnailer->cache_dir, rp_thumbnail_flavors[i].name);
+		const int mkret = g_mkdir_with_parents(cache_dirname, 0777);
+		if (mkret == 0) {
+			cache_filenames[count] = g_strdup_printf("%s/%s.png", cache_dirname, md5_string);
+			maximum_sizes[count] = rp_thumbnail_flavors[i].size;
+			count++;
+		}
+		g_free(cache_dirname);
+		if (mkret != 0) {
+			req->error_msg = "Cannot mkdir() the thumbnail cache directory.";
+			goto cleanup;
+		}
 	}
 
 	// Thumbnail the image.
-	ret = thumbnailer->pfn_rp_create_thumbnail(req->uri, cache_filename, req->large ? 256 : 128);
-	if (ret == 0) {
+	// If the request is dequeued while it's in flight, the
+	// remaining flavors won't be written. (The image that's
+	// currently being decoded can't be interrupted.)
+	if (count > 1 && thumbnailer->pfn_rp_create_thumbnails) {
+		// Create all flavors from a single decode.
+		ret = thumbnailer->pfn_rp_create_thumbnails(req->uri,
+			(const char *const *)cache_filenames, maximum_sizes, count,
+			&req->cancelled);
+	} else {
+		for (unsigned int i = 0; i < count && ret == 0; i++) {
+			if (g_atomic_int_get(&req->cancelled))
+				break;
+			ret = thumbnailer->pfn_rp_create_thumbnail(req->uri, cache_filenames[i], maximum_sizes[i]);
+		}
+	}
+	if (g_atomic_int_get(&req->cancelled)) {
+		// Request was dequeued while it was being processed.
+		// No signals will be emitted, so don't bother logging it.
+	} else if (ret == 0) {
 		// Image thumbnailed successfully.
-		g_debug("rom-properties thumbnail: %s -> %s [OK]", req->uri, cache_filename);
-		org_freedesktop_thumbnails_specialized_thumbnailer1_emit_ready(
-			thumbnailer->skeleton, req->handle, req->uri);
+		g_debug("rom-properties thumbnail: %s -> %s (%u flavor(s)) [OK]", req->uri, cache_filenames[0], count);
 	} else {
 		// Error thumbnailing the image...
-		g_debug("rom-properties thumbnail: %s -> %s [ERR=%d]", req->uri, cache_filename, ret);
-		org_freedesktop_thumbnails_specialized_thumbnailer1_emit_error(
-			thumbnailer->skeleton, req->handle, req->uri,
-			2, "Image thumbnailing failed... (TODO: return code)");
+		g_debug("rom-properties thumbnail: %s -> %s (%u flavor(s)) [ERR=%d]", req->uri, cache_filenames[0], count, ret);
+		req->error_code = 2;
+		req->error_msg = "Image thumbnailing failed... (TODO: return code)";
 	}
 
-finished:
-	// Request is finished. Emit the finished signal.
-	org_freedesktop_thumbnails_specialized_thumbnailer1_emit_finished(
-		thumbnailer->skeleton, req->handle);
-
 cleanup:
 	// Free allocated things.
-	g_free(cache_filename);
-
-	// req was allocated using g_malloc() before it was
-	// added to the queue. We'll need to free it here.
-	g_free((gpointer)req);
+	g_free(md5_string);
+	for (unsigned int i = 0; i < count; i++) {
+		g_free(cache_filenames[i]);
+	}
 
-	// Return TRUE if we still have more thumbnails queued.
-	const bool isEmpty = g_queue_is_empty(&thumbnailer->request_queue);
-	if (isEmpty) {
-		// Clear the idle process.
-		// FIXME: Atomic compare and/or mutex? (assuming multi-threaded...)
-		thumbnailer->idle_process = 0;
+	// Emit the signals on the main thread.
+	g_idle_add((GSourceFunc)rp_thumbnailer_complete, req);
+}
 
-		// Restart the inactivity timeout.
-		if (G_LIKELY(thumbnailer->timeout_id == 0)) {
-			thumbnailer->timeout_id = g_timeout_add_seconds(SHUTDOWN_TIMEOUT_SECONDS,
-				(GSourceFunc)rp_thumbnailer_timeout, thumbnailer);
+/**
+ * A worker thread has finished processing a thumbnail.
+ * This function runs on the main thread.
+ * @param req request_info
+ */
+static gboolean
+rp_thumbnailer_complete(struct request_info *req)
+{
+	RpThumbnailer *const thumbnailer = req->thumbnailer;
+	g_queue_remove(&thumbnailer->active_requests, req);
+
+	// Don't emit any signals if the request was dequeued.
+	if (!g_atomic_int_get(&req->cancelled)) {
+		if (!req->error_msg) {
+			org_freedesktop_thumbnails_specialized_thumbnailer1_emit_ready(
+				thumbnailer->skeleton, req->handle, req->uri);
+		} else {
+			org_freedesktop_thumbnails_specialized_thumbnailer1_emit_error(
+				thumbnailer->skeleton, req->handle, req->uri,
+				req->error_code, req->error_msg);
 		}
+
+		// Request is finished. Emit the finished signal.
+		org_freedesktop_thumbnails_specialized_thumbnailer1_emit_finished(
+			thumbnailer->skeleton, req->handle);
 	}
-	return !isEmpty;
+
+	// req was allocated using g_malloc0() before it was
+	// added to the queue. We'll need to free it here.
+	request_info_free(req);
+
+	// A worker thread is available. Start the next request.
+	// If nothing else is pending, this restarts the inactivity timeout.
+	rp_thumbnailer_dispatch(thumbnailer);
+
+	// Release the reference taken by rp_thumbnailer_dispatch().
+	g_object_unref(thumbnailer);
+	return false;
 }
 
 /**
@@ -632,17 +912,23 @@ cleanup:
  * @param connection			[in] GDBusConnection
  * @param cache_dir			[in] Cache directory.
  * @param pfn_rp_create_thumbnail	[in] rp_create_thumbnail() function pointer.
+ * @param pfn_rp_create_thumbnails	[in,opt] rp_create_thumbnails() function pointer.
+ * @param max_threads			[in] Maximum number of worker threads. (0 for the number of CPU cores)
  * @return RpThumbnailer object.
  */
 RpThumbnailer*
 rp_thumbnailer_new(GDBusConnection *connection,
 	const gchar *cache_dir,
-	PFN_RP_CREATE_THUMBNAIL pfn_rp_create_thumbnail)
+	PFN_RP_CREATE_THUMBNAIL pfn_rp_create_thumbnail,
+	PFN_RP_CREATE_THUMBNAILS pfn_rp_create_thumbnails,
+	guint max_threads)
 {
 	return g_object_new(TYPE_RP_THUMBNAILER,
 		"connection", connection,
 		"cache-dir", cache_dir,
 		"pfn-rp-create-thumbnail", pfn_rp_create_thumbnail,
+		"pfn-rp-create-thumbnails", pfn_rp_create_thumbnails,
+		"max-threads", max_threads,
 		NULL);
 }
 
@@ -23,6 +23,17 @@ G_BEGIN_DECLS
  */
 typedef int (*PFN_RP_CREATE_THUMBNAIL)(const char *source_file, const char *output_file, int maximum_size);
 
+/**
+ * rp_create_thumbnails() function pointer.
+ * @param source_file Source file. (UTF-8)
+ * @param output_files Output files. (UTF-8)
+ * @param maximum_sizes Maximum sizes.
+ * @param count Number of output files.
+ * @param cancelled [in,opt] If non-zero, stop before writing the next output file.
+ * @return 0 on success; non-zero on error.
+ */
+typedef int (*PFN_RP_CREATE_THUMBNAILS)(const char *source_file, const char *const *output_files, const int *maximum_sizes, unsigned int count, const volatile int *cancelled);
+
 typedef struct _RpThumbnailerClass	RpThumbnailerClass;
 typedef struct _RpThumbnailer		RpThumbnailer;
 
@@ -37,7 +48,9 @@ GType		rp_thumbnailer_get_type			(void) G_GNUC_CONST G_GNUC_INTERNAL;
 
 RpThumbnailer	*rp_thumbnailer_new			(GDBusConnection *connection,
 							 const gchar *cache_dir,
-							 PFN_RP_CREATE_THUMBNAIL pfn_rp_create_thumbnail)
+							 PFN_RP_CREATE_THUMBNAIL pfn_rp_create_thumbnail,
+							 PFN_RP_CREATE_THUMBNAILS pfn_rp_create_thumbnails,
+							 guint max_threads)
 							G_GNUC_MALLOC G_GNUC_WARN_UNUSED_RESULT;
 
 gboolean	rp_thumbnailer_is_exported		(RpThumbnailer *thumbnailer);
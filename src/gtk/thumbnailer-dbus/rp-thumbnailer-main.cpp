@@ -18,6 +18,7 @@
 // C includes. (C++ namespace)
 #include <cstdarg>
 #include <cstdio>
+#include <cstdlib>
 
 // C++ includes.
 #include <string>
@@ -47,6 +48,27 @@ static int init_cache_dir(void)
 	return 0;
 }
 
+/**
+ * Get the maximum number of worker threads.
+ * This can be set using the RP_THUMBNAILER_MAX_THREADS environment variable.
+ * @return Maximum number of worker threads, or 0 for the number of CPU cores.
+ */
+static guint get_max_threads(void)
+{
+	const char *const s_max_threads = getenv("RP_THUMBNAILER_MAX_THREADS");
+	if (!s_max_threads || s_max_threads[0] == '\0') {
+		return 0;
+	}
+
+	char *endptr = nullptr;
+	const unsigned long max_threads = strtoul(s_max_threads, &endptr, 10);
+	if (*endptr != '\0' || max_threads > 256) {
+		g_warning("Invalid RP_THUMBNAILER_MAX_THREADS value: %s", s_max_threads);
+		return 0;
+	}
+	return static_cast<guint>(max_threads);
+}
+
 /**
  * Debug print function for rp_dll_search().
  * @param level Debug level.
@@ -149,6 +171,11 @@ int main(int argc, char *argv[])
 		return EXIT_FAILURE;
 	}
 
+	// rp_create_thumbnails() is optional. If available, it's used
+	// to create multiple flavors from a single decode.
+	PFN_RP_CREATE_THUMBNAILS pfn_rp_create_thumbnails =
+		(PFN_RP_CREATE_THUMBNAILS)dlsym(pDll, "rp_create_thumbnails");
+
 	GError *error = nullptr;
 	GDBusConnection *const connection = g_bus_get_sync(G_BUS_TYPE_SESSION, nullptr, &error);
 	if (error) {
@@ -160,9 +187,14 @@ int main(int argc, char *argv[])
 
 	GMainLoop *main_loop = g_main_loop_new(nullptr, false);
 
+	// Maximum number of worker threads.
+	// Defaults to the number of CPU cores.
+	const guint max_threads = get_max_threads();
+
 	// Create the RpThumbnail service object.
 	RpThumbnailer *const thumbnailer = rp_thumbnailer_new(
-		connection, cache_dir.c_str(), pfn_rp_create_thumbnail);
+		connection, cache_dir.c_str(), pfn_rp_create_thumbnail,
+		pfn_rp_create_thumbnails, max_threads);
 
 	// Register the D-Bus service.
 	g_bus_own_name_on_connection(connection,
@@ -181,6 +213,14 @@ int main(int argc, char *argv[])
 			g_main_loop_run(main_loop);
 		}
 	}
+
+	// Log the pixel buffer pool statistics, if available.
+	typedef void (*PFN_RP_LOG_PIXEL_BUFFER_POOL_STATS)(void);
+	PFN_RP_LOG_PIXEL_BUFFER_POOL_STATS pfn_rp_log_pixel_buffer_pool_stats =
+		(PFN_RP_LOG_PIXEL_BUFFER_POOL_STATS)dlsym(pDll, "rp_log_pixel_buffer_pool_stats");
+	if (pfn_rp_log_pixel_buffer_pool_stats) {
+		pfn_rp_log_pixel_buffer_pool_stats();
+	}
 	dlclose(pDll);
 	return 0;
 }
@@ -0,0 +1,451 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (D-Bus Thumbnailer/tests)          *
+ * RpThumbnailerSchedulerTest.cpp: RpThumbnailer scheduling test.          *
+ *                                                                         *
+ * Copyright (c) 2017-2022 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+/**
+ * This test runs RpThumbnailer on a private D-Bus session bus
+ * using GTestDBus, with a fake rp_create_thumbnail() function
+ * that takes a fixed amount of time per thumbnail.
+ *
+ * The workload simulates a file manager where the user scrolls
+ * through a large directory: a batch of background requests is
+ * queued first, followed by several pages of urgent requests for
+ * the visible items. When the view scrolls, unfinished requests
+ * for the previous page are dequeued.
+ *
+ * NOTE: dbus-daemon must be installed.
+ */
+
+// Google Test
+#include "gtest/gtest.h"
+
+#include "common.h"
+#include "rp-thumbnailer-dbus.h"
+#include "SpecializedThumbnailer1.h"
+
+// C includes. (C++ namespace)
+#include <cstdio>
+
+// C++ includes.
+#include <algorithm>
+#include <map>
+#include <set>
+#include <vector>
+
+namespace RpThumbnailerDBus { namespace Tests {
+
+class RpThumbnailerSchedulerTest : public ::testing::Test
+{
+	protected:
+		RpThumbnailerSchedulerTest()
+			: m_bus(nullptr)
+			, m_server_conn(nullptr)
+			, m_client_conn(nullptr)
+			, m_thumbnailer(nullptr)
+			, m_proxy(nullptr)
+			, m_cache_dir(nullptr)
+		{ }
+
+		void SetUp(void) final;
+		void TearDown(void) final;
+
+	public:
+		GTestDBus *m_bus;
+		GDBusConnection *m_server_conn;
+		GDBusConnection *m_client_conn;
+		RpThumbnailer *m_thumbnailer;
+		OrgFreedesktopThumbnailsSpecializedThumbnailer1 *m_proxy;
+		gchar *m_cache_dir;
+
+		// All handles returned by Queue.
+		std::vector<guint32> m_handles;
+		// Time at which the Ready signal was received for each handle.
+		std::map<guint32, gint64> m_ready_time;
+		// Handles for which the Finished signal was received.
+		std::set<guint32> m_finished;
+
+	public:
+		// Simulated time to create a thumbnail, in milliseconds.
+		static const unsigned int THUMBNAIL_DELAY_MS = 20;
+		// Number of worker threads.
+		static const unsigned int WORKER_THREADS = 2;
+		// Number of background requests queued before scrolling.
+		static const unsigned int BACKGROUND_COUNT = 64;
+		// Number of pages scrolled through.
+		static const unsigned int PAGE_COUNT = 4;
+		// Number of visible items per page.
+		static const unsigned int PAGE_SIZE = 8;
+		// Time between scroll events, in milliseconds.
+		static const unsigned int SCROLL_INTERVAL_MS = 30;
+		// Maximum time to wait for thumbnails, in milliseconds.
+		static const unsigned int WAIT_TIMEOUT_MS = 10000;
+
+		/**
+		 * Fake rp_create_thumbnail() function.
+		 * @param source_file Source file. (UTF-8)
+		 * @param output_file Output file. (UTF-8)
+		 * @param maximum_size Maximum size.
+		 * @return 0 on success; non-zero on error.
+		 */
+		static int fake_create_thumbnail(const char *source_file, const char *output_file, int maximum_size);
+
+		/**
+		 * Run the default main context for the specified amount of time.
+		 * @param ms Time, in milliseconds.
+		 */
+		static void iterate(unsigned int ms);
+
+		/**
+		 * Queue a URI for thumbnailing.
+		 * @param uri URI
+		 * @param urgent Is this request urgent?
+		 * @return Handle, or 0 on error.
+		 */
+		guint32 queue(const char *uri, bool urgent);
+
+		/**
+		 * Dequeue a request.
+		 * @param handle Handle
+		 */
+		void dequeue(guint32 handle);
+
+		/**
+		 * Wait for the Finished signal for all of the specified handles.
+		 * @param handles Handles
+		 * @return True if all handles are finished; false on timeout.
+		 */
+		bool waitForFinished(const std::vector<guint32> &handles);
+
+		/** Signal handlers **/
+
+		static void ready_cb(OrgFreedesktopThumbnailsSpecializedThumbnailer1 *proxy,
+			guint handle, const gchar *uri, RpThumbnailerSchedulerTest *test);
+		static void finished_cb(OrgFreedesktopThumbnailsSpecializedThumbnailer1 *proxy,
+			guint handle, RpThumbnailerSchedulerTest *test);
+
+		/**
+		 * RpThumbnailer weak reference notification.
+		 * @param data Pointer to a bool that will be set to true.
+		 * @param where_the_object_was RpThumbnailer object being finalized.
+		 */
+		static void thumbnailer_weak_notify(gpointer data, GObject *where_the_object_was);
+};
+
+/**
+ * SetUp() function.
+ * Run before each test.
+ */
+void RpThumbnailerSchedulerTest::SetUp(void)
+{
+	// Start a private session bus.
+	m_bus = g_test_dbus_new(G_TEST_DBUS_NONE);
+	g_test_dbus_up(m_bus);
+
+	GError *error = nullptr;
+	m_server_conn = g_bus_get_sync(G_BUS_TYPE_SESSION, nullptr, &error);
+	ASSERT_TRUE(m_server_conn != nullptr) << "Unable to connect to the session bus: " << error->message;
+	m_client_conn = g_dbus_connection_new_for_address_sync(g_test_dbus_get_bus_address(m_bus),
+		(GDBusConnectionFlags)(G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT |
+		                       G_DBUS_CONNECTION_FLAGS_MESSAGE_BUS_CONNECTION),
+		nullptr, nullptr, &error);
+	ASSERT_TRUE(m_client_conn != nullptr) << "Unable to connect to the session bus: " << error->message;
+
+	// Thumbnails are "written" to a temporary cache directory.
+	m_cache_dir = g_dir_make_tmp("rp-thumbnailer-test-XXXXXX", &error);
+	ASSERT_TRUE(m_cache_dir != nullptr) << "Unable to create a temporary directory: " << error->message;
+
+	m_thumbnailer = rp_thumbnailer_new(m_server_conn, m_cache_dir,
+		fake_create_thumbnail, nullptr, WORKER_THREADS);
+	ASSERT_TRUE(rp_thumbnailer_is_exported(m_thumbnailer));
+
+	m_proxy = org_freedesktop_thumbnails_specialized_thumbnailer1_proxy_new_sync(
+		m_client_conn, G_DBUS_PROXY_FLAGS_DO_NOT_LOAD_PROPERTIES,
+		g_dbus_connection_get_unique_name(m_server_conn),
+		"/com/gerbilsoft/rom_properties/SpecializedThumbnailer1",
+		nullptr, &error);
+	ASSERT_TRUE(m_proxy != nullptr) << "Unable to create the D-Bus proxy: " << error->message;
+
+	g_signal_connect(m_proxy, "ready", G_CALLBACK(ready_cb), this);
+	g_signal_connect(m_proxy, "finished", G_CALLBACK(finished_cb), this);
+}
+
+/**
+ * TearDown() function.
+ * Run after each test.
+ */
+void RpThumbnailerSchedulerTest::TearDown(void)
+{
+	if (m_proxy) {
+		// Dequeue everything that's left.
+		for (guint32 handle : m_handles) {
+			if (m_finished.find(handle) == m_finished.end()) {
+				dequeue(handle);
+			}
+		}
+	}
+
+	if (m_thumbnailer) {
+		// In-flight requests hold a reference to the RpThumbnailer
+		// until rp_thumbnailer_complete() runs on the main thread.
+		// Release our reference and wait for the object to be finalized.
+		// NOTE: The last reference is always released on the main thread,
+		// so the object can't be finalized while we're not iterating.
+		bool finalized = false;
+		GObject *const obj = G_OBJECT(m_thumbnailer);
+		g_object_weak_ref(obj, thumbnailer_weak_notify, &finalized);
+		g_clear_object(&m_thumbnailer);
+		for (unsigned int ms = 0; !finalized && ms < WAIT_TIMEOUT_MS; ms += 10) {
+			iterate(10);
+		}
+		EXPECT_TRUE(finalized) << "RpThumbnailer was not finalized.";
+		if (!finalized) {
+			// Don't let the notification write to our stack later.
+			g_object_weak_unref(obj, thumbnailer_weak_notify, &finalized);
+		}
+	}
+
+	g_clear_object(&m_proxy);
+	if (m_client_conn) {
+		g_dbus_connection_close_sync(m_client_conn, nullptr, nullptr);
+		g_clear_object(&m_client_conn);
+	}
+	g_clear_object(&m_server_conn);
+	if (m_bus) {
+		g_test_dbus_down(m_bus);
+		g_clear_object(&m_bus);
+	}
+
+	if (m_cache_dir) {
+		// Remove the empty thumbnail directories.
+		gchar *const normal_dir = g_build_filename(m_cache_dir, "thumbnails", "normal", nullptr);
+		gchar *const thumbnails_dir = g_build_filename(m_cache_dir, "thumbnails", nullptr);
+		g_rmdir(normal_dir);
+		g_rmdir(thumbnails_dir);
+		g_rmdir(m_cache_dir);
+		g_free(normal_dir);
+		g_free(thumbnails_dir);
+		g_free(m_cache_dir);
+		m_cache_dir = nullptr;
+	}
+}
+
+/**
+ * Fake rp_create_thumbnail() function.
+ * @param source_file Source file. (UTF-8)
+ * @param output_file Output file. (UTF-8)
+ * @param maximum_size Maximum size.
+ * @return 0 on success; non-zero on error.
+ */
+int RpThumbnailerSchedulerTest::fake_create_thumbnail(const char *source_file, const char *output_file, int maximum_size)
+{
+	RP_UNUSED(source_file);
+	RP_UNUSED(output_file);
+	RP_UNUSED(maximum_size);
+
+	g_usleep(THUMBNAIL_DELAY_MS * 1000);
+	return 0;
+}
+
+/**
+ * Run the default main context for the specified amount of time.
+ * @param ms Time, in milliseconds.
+ */
+void RpThumbnailerSchedulerTest::iterate(unsigned int ms)
+{
+	const gint64 end_time = g_get_monotonic_time() + (gint64)ms * 1000;
+	bool timed_out = false;
+	const guint timeout_id = g_timeout_add(ms, [](gpointer user_data) -> gboolean {
+		*static_cast<bool*>(user_data) = true;
+		return false;
+	}, &timed_out);
+
+	while (!timed_out && g_get_monotonic_time() < end_time) {
+		g_main_context_iteration(nullptr, true);
+	}
+	if (!timed_out) {
+		g_source_remove(timeout_id);
+	}
+}
+
+/**
+ * Queue a URI for thumbnailing.
+ * @param uri URI
+ * @param urgent Is this request urgent?
+ * @return Handle, or 0 on error.
+ */
+guint32 RpThumbnailerSchedulerTest::queue(const char *uri, bool urgent)
+{
+	// NOTE: The server is running on this thread, so the
+	// main context has to be iterated while waiting.
+	struct queue_result {
+		bool done;
+		guint handle;
+	} result = {false, 0};
+
+	org_freedesktop_thumbnails_specialized_thumbnailer1_call_queue(m_proxy,
+		uri, "application/octet-stream", "normal", urgent, nullptr,
+		[](GObject *source_object, GAsyncResult *res, gpointer user_data) {
+			queue_result *const result = static_cast<queue_result*>(user_data);
+			if (!org_freedesktop_thumbnails_specialized_thumbnailer1_call_queue_finish(
+				ORG_FREEDESKTOP_THUMBNAILS_SPECIALIZED_THUMBNAILER1(source_object),
+				&result->handle, res, nullptr))
+			{
+				result->handle = 0;
+			}
+			result->done = true;
+		}, &result);
+
+	while (!result.done) {
+		g_main_context_iteration(nullptr, true);
+	}
+
+	if (result.handle != 0) {
+		m_handles.push_back(result.handle);
+	}
+	return result.handle;
+}
+
+/**
+ * Dequeue a request.
+ * @param handle Handle
+ */
+void RpThumbnailerSchedulerTest::dequeue(guint32 handle)
+{
+	bool done = false;
+	org_freedesktop_thumbnails_specialized_thumbnailer1_call_dequeue(m_proxy,
+		handle, nullptr,
+		[](GObject *source_object, GAsyncResult *res, gpointer user_data) {
+			org_freedesktop_thumbnails_specialized_thumbnailer1_call_dequeue_finish(
+				ORG_FREEDESKTOP_THUMBNAILS_SPECIALIZED_THUMBNAILER1(source_object),
+				res, nullptr);
+			*static_cast<bool*>(user_data) = true;
+		}, &done);
+
+	while (!done) {
+		g_main_context_iteration(nullptr, true);
+	}
+}
+
+/**
+ * Wait for the Finished signal for all of the specified handles.
+ * @param handles Handles
+ * @return True if all handles are finished; false on timeout.
+ */
+bool RpThumbnailerSchedulerTest::waitForFinished(const std::vector<guint32> &handles)
+{
+	for (unsigned int ms = 0; ms < WAIT_TIMEOUT_MS; ms += 10) {
+		const bool all_finished = std::all_of(handles.begin(), handles.end(),
+			[this](guint32 handle) { return m_finished.find(handle) != m_finished.end(); });
+		if (all_finished)
+			return true;
+		iterate(10);
+	}
+	return false;
+}
+
+void RpThumbnailerSchedulerTest::ready_cb(OrgFreedesktopThumbnailsSpecializedThumbnailer1 *proxy,
+	guint handle, const gchar *uri, RpThumbnailerSchedulerTest *test)
+{
+	RP_UNUSED(proxy);
+	RP_UNUSED(uri);
+	test->m_ready_time.insert(std::make_pair(handle, g_get_monotonic_time()));
+}
+
+void RpThumbnailerSchedulerTest::finished_cb(OrgFreedesktopThumbnailsSpecializedThumbnailer1 *proxy,
+	guint handle, RpThumbnailerSchedulerTest *test)
+{
+	RP_UNUSED(proxy);
+	test->m_finished.insert(handle);
+}
+
+void RpThumbnailerSchedulerTest::thumbnailer_weak_notify(gpointer data, GObject *where_the_object_was)
+{
+	RP_UNUSED(where_the_object_was);
+	*static_cast<bool*>(data) = true;
+}
+
+/**
+ * Synthetic scrolling workload.
+ * Measures the time to the first visible thumbnail on the last page.
+ */
+TEST_F(RpThumbnailerSchedulerTest, scrolling)
+{
+	char uri[64];
+
+	// Queue the background requests.
+	for (unsigned int i = 0; i < BACKGROUND_COUNT; i++) {
+		snprintf(uri, sizeof(uri), "file:///background/%u.rom", i);
+		ASSERT_NE(0U, queue(uri, false));
+	}
+
+	// Scroll through the pages.
+	std::vector<guint32> page;
+	gint64 page_time = 0;
+	for (unsigned int p = 0; p < PAGE_COUNT; p++) {
+		// The previous page is no longer visible.
+		for (guint32 handle : page) {
+			if (m_finished.find(handle) == m_finished.end()) {
+				dequeue(handle);
+			}
+		}
+		page.clear();
+
+		page_time = g_get_monotonic_time();
+		for (unsigned int i = 0; i < PAGE_SIZE; i++) {
+			snprintf(uri, sizeof(uri), "file:///page%u/%u.rom", p, i);
+			const guint32 handle = queue(uri, true);
+			ASSERT_NE(0U, handle);
+			page.push_back(handle);
+		}
+
+		if (p != PAGE_COUNT - 1) {
+			iterate(SCROLL_INTERVAL_MS);
+		}
+	}
+
+	// Wait for the last page to finish.
+	ASSERT_TRUE(waitForFinished(page)) << "Timed out waiting for the visible thumbnails.";
+
+	gint64 first_ready = G_MAXINT64, last_ready = 0;
+	for (guint32 handle : page) {
+		auto iter = m_ready_time.find(handle);
+		ASSERT_TRUE(iter != m_ready_time.end()) << "No Ready signal for handle " << handle;
+		first_ready = std::min(first_ready, iter->second);
+		last_ready = std::max(last_ready, iter->second);
+	}
+
+	const double first_ms = (double)(first_ready - page_time) / 1000.0;
+	const double last_ms = (double)(last_ready - page_time) / 1000.0;
+	printf("Time to first visible thumbnail: %.1f ms\n", first_ms);
+	printf("Time to all visible thumbnails:  %.1f ms\n", last_ms);
+
+	// If the visible thumbnails were processed after all of the
+	// background thumbnails, it would take at least this long.
+	const double background_ms = (double)(BACKGROUND_COUNT * THUMBNAIL_DELAY_MS) / WORKER_THREADS;
+	printf("Time to process all background thumbnails: %.1f ms\n", background_ms);
+
+	// Save the timings in the XML report, in microseconds.
+	RecordProperty("first_visible_us", static_cast<int>(first_ready - page_time));
+	RecordProperty("all_visible_us", static_cast<int>(last_ready - page_time));
+	EXPECT_LT(first_ms, background_ms);
+	EXPECT_LT(last_ms, background_ms);
+}
+
+} }
+
+/**
+ * Test suite main function.
+ */
+int main(int argc, char *argv[])
+{
+	fprintf(stderr, "rp-thumbnailer-dbus test suite: RpThumbnailer scheduling tests.\n\n");
+	fflush(nullptr);
+
+	// coverity[fun_call_w_exception]: uncaught exceptions cause nonzero exit anyway, so don't warn.
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
@@ -30,6 +30,9 @@ using LibRomData::RomDataFactory;
 #include "libromdata/img/TCreateThumbnail.cpp"
 using LibRomData::TCreateThumbnail;
 
+// One-time initialization.
+#include "librpthreads/pthread_once.h"
+
 // C++ STL classes.
 using std::string;
 using std::unique_ptr;
@@ -49,6 +52,19 @@ using std::unique_ptr;
 # error Qt is too old.
 #endif
 
+// pthread_once() control variable for the rp_image backend.
+static pthread_once_t rp_image_backend_once_control = PTHREAD_ONCE_INIT;
+
+/**
+ * Register RpQImageBackend.
+ * rp_create_thumbnail() may be called from multiple threads,
+ * so this function MUST be called using pthread_once().
+ */
+static void init_rp_image_backend(void)
+{
+	rp_image::setBackendCreatorFn(RpQImageBackend::creator_fn);
+}
+
 /**
  * Factory method.
  * References:
@@ -59,7 +75,7 @@ extern "C" {
 	Q_DECL_EXPORT ThumbCreator *new_creator()
 	{
 		// Register RpQImageBackend and AchQtDBus.
-		rp_image::setBackendCreatorFn(RpQImageBackend::creator_fn);
+		pthread_once(&rp_image_backend_once_control, init_rp_image_backend);
 #if defined(ENABLE_ACHIEVEMENTS) && defined(HAVE_QtDBus_NOTIFY)
 		AchQtDBus::instance();
 #endif /* ENABLE_ACHIEVEMENTS && HAVE_QtDBus_NOTIFY */
@@ -295,8 +311,7 @@ Q_DECL_EXPORT int RP_C_API rp_create_thumbnail(const char *source_file, const ch
 	CHECK_UID_RET(RPCT_RUNNING_AS_ROOT);
 
 	// Register RpQImageBackend.
-	// TODO: Static initializer somewhere?
-	rp_image::setBackendCreatorFn(RpQImageBackend::creator_fn);
+	pthread_once(&rp_image_backend_once_control, init_rp_image_backend);
 
 	// Attempt to open the ROM file.
 	QUrl localUrl = localizeQUrl(QUrl(QString::fromUtf8(source_file)));
@@ -425,6 +440,10 @@ Q_DECL_EXPORT int RP_C_API rp_create_thumbnail(const char *source_file, const ch
 	// RpPngWriter will ignore the palette arguments in that case.
 	QVector<QRgb> colorTable = outParams.retImg.colorTable();
 
+	// Thumbnails are cached, so encoding speed is more
+	// important than file size.
+	pngWriter->setCompressionProfile(RpPngWriter::CompressionProfile::Fast);
+
 	// If sBIT wasn't found, all fields will be 0.
 	// RpPngWriter will ignore sBIT in this case.
 	int pwRet = pngWriter->write_IHDR(&outParams.sBIT,
@@ -17,6 +17,7 @@
 
 // librpbase, librptexture
 #include "librpbase/aligned_malloc.h"
+#include "librptexture/img/PixelBufferPool.hpp"
 using LibRpTexture::rp_image;
 using LibRpTexture::rp_image_backend;
 
@@ -45,7 +46,12 @@ RpQImageBackend::RpQImageBackend(int width, int height, rp_image::Format format)
 
 	// Allocate our own memory buffer.
 	// This is needed in order to use 16-byte row alignment.
+	// NOTE: Qt4 frees the buffer itself, so it can't be pooled.
+#if QT_VERSION >= QT_VERSION_CHECK(5,0,0)
+	uint8_t *data = static_cast<uint8_t*>(LibRpTexture::PixelBufferPool::allocBuffer(height * this->stride));
+#else /* QT_VERSION < QT_VERSION_CHECK(5,0,0) */
 	uint8_t *data = static_cast<uint8_t*>(aligned_malloc(16, height * this->stride));
+#endif
 	if (!data) {
 		// Error allocating the memory buffer.
 		clear_properties();
@@ -59,13 +65,17 @@ RpQImageBackend::RpQImageBackend(int width, int height, rp_image::Format format)
 
 	// Create the QImage using the allocated memory buffer.
 #if QT_VERSION >= QT_VERSION_CHECK(5,0,0)
-	m_qImage = QImage(data, width, height, this->stride, qfmt, aligned_free, data);
+	m_qImage = QImage(data, width, height, this->stride, qfmt, LibRpTexture::PixelBufferPool::freeBuffer, data);
 #else /* QT_VERSION < QT_VERSION_CHECK(5,0,0) */
 	m_qImage = QImage(data, width, height, this->stride, qfmt);
 #endif
 	if (m_qImage.isNull()) {
 		// Error creating the QImage.
+#if QT_VERSION >= QT_VERSION_CHECK(5,0,0)
+		LibRpTexture::PixelBufferPool::freeBuffer(data);
+#else /* QT_VERSION < QT_VERSION_CHECK(5,0,0) */
 		aligned_free(data);
+#endif
 		clear_properties();
 		return;
 	}
@@ -17,6 +17,10 @@
 #include "librpfile/FileSystem.hpp"
 using namespace LibRpFile;
 
+// libcachecommon
+#include "libcachecommon/CacheIndex.hpp"
+using LibCacheCommon::CacheIndex;
+
 // C includes
 #include <dirent.h>
 #include <fcntl.h>	// AT_FDCWD
@@ -32,11 +36,12 @@ using std::string;
 
 /**
  * Recursively scan a directory for files.
- * @param path	[in] Path to scan.
- * @param rlist	[in/out] Return list for filenames and file types. (d_type)
+ * @param path		[in] Path to scan.
+ * @param rlist		[in/out] Return list for filenames and file types. (d_type)
+ * @param index_base_len [in] If non-zero, allow cache index files relative to this many characters of path.
  * @return 0 on success; non-zero on error.
  */
-static int recursiveScan(const char *path, list<pair<tstring, uint8_t> > &rlist)
+static int recursiveScan(const char *path, list<pair<tstring, uint8_t> > &rlist, size_t index_base_len = 0)
 {
 	DIR *pdir = opendir(path);
 	if (!pdir) {
@@ -105,6 +110,11 @@ static int recursiveScan(const char *path, list<pair<tstring, uint8_t> > &rlist)
 			if (!strcasecmp(dirent->d_name, _T("Thumbs.db")))
 				goto isok;
 
+			// Cache index files can be deleted from the rom-properties cache.
+			// NOTE: The cache index detects if it was deleted and starts over.
+			if (index_base_len != 0 && CacheIndex::isIndexFile(fullpath.c_str() + index_base_len))
+				goto isok;
+
 			// Check the extension.
 			size_t len = strlen(dirent->d_name);
 			if (len <= 4) {
@@ -129,7 +139,7 @@ static int recursiveScan(const char *path, list<pair<tstring, uint8_t> > &rlist)
 		// If this is a directory, recursively scan it, then add it.
 		if (d_type == DT_DIR) {
 			// Recursively scan it.
-			recursiveScan(fullpath.c_str(), rlist);
+			recursiveScan(fullpath.c_str(), rlist, index_base_len);
 		}
 
 		// Add the filename and file type.
@@ -202,7 +212,8 @@ void CacheCleaner::run(void)
 	// TODO: Do we really want to store everything in a list? (Wastes memory.)
 	// Maybe do a simple counting scan first, then delete.
 	list<pair<string, uint8_t> > rlist;
-	int ret = recursiveScan(dir.c_str(), rlist);
+	const size_t index_base_len = (m_cacheDir == CacheCleaner::CD_RomProperties ? dir.size() + 1 : 0);
+	int ret = recursiveScan(dir.c_str(), rlist, index_base_len);
 	if (ret != 0) {
 		// Non-image file found.
 		QString qs_err;
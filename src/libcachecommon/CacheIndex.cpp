@@ -0,0 +1,1496 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (libcachecommon)                   *
+ * CacheIndex.cpp: Cache index with LRU eviction and small file packing.   *
+ *                                                                         *
+ * Copyright (c) 2016-2022 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "config.libcachecommon.h"
+#include "CacheIndex.hpp"
+#include "CacheDir.hpp"
+#include "CacheKeys.hpp"
+
+// librpthreads
+#include "librpthreads/Mutex.hpp"
+#include "librpthreads/pthread_once.h"
+using LibRpThreads::Mutex;
+using LibRpThreads::MutexLocker;
+
+// C includes.
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+// C includes. (C++ namespace)
+#include <cctype>
+#include <cerrno>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+
+// C++ includes.
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+using std::map;
+using std::string;
+using std::unique_ptr;
+using std::unordered_map;
+using std::vector;
+
+#ifndef O_CLOEXEC
+# define O_CLOEXEC 0
+#endif /* !O_CLOEXEC */
+
+namespace LibCacheCommon {
+
+// Index file header.
+static const char idx_header[] = "RPCACHEIDX 1\n";
+// Pack file header.
+static const char pack_magic[8] = {'R','P','C','P','A','C','K','1'};
+
+// Index, lock, and pack directory names.
+static const char idx_name[] = "cache.idx";
+static const char lock_name[] = "cache.lock";
+static const char packs_name[] = "packs";
+
+// Files up to this size are stored in pack files if packing is enabled.
+#define PACK_MAX_FILE_SIZE (64U*1024U)
+// Pack files are closed for appending once they reach this size.
+#define PACK_MAX_SIZE (16U*1024U*1024U)
+// Access times are only written to the index if they changed
+// by at least this many seconds.
+#define TOUCH_INTERVAL 3600
+// Files modified within this many seconds are skipped by migrate(),
+// since they might still be downloading.
+#define MIGRATE_MIN_AGE 60
+// Eviction reduces the cache to this percentage of the maximum size,
+// so eviction doesn't have to run every time a file is added.
+#define EVICT_TARGET_PERCENT 90
+
+class CacheIndexPrivate
+{
+	public:
+		explicit CacheIndexPrivate(const string &cacheDir);
+		~CacheIndexPrivate();
+
+	private:
+		RP_DISABLE_COPY(CacheIndexPrivate)
+
+	public:
+		typedef CacheIndex::Entry Entry;
+
+		/**
+		 * Cross-process lock for operations that modify
+		 * cache files, e.g. packing and eviction.
+		 * NOTE: Recursive within a process. Mutex must be held.
+		 */
+		class FileLocker
+		{
+			public:
+				explicit FileLocker(CacheIndexPrivate *d)
+					: d(d)
+				{
+					if (d->lockDepth++ == 0 && d->lockFd >= 0) {
+						while (flock(d->lockFd, LOCK_EX) != 0 && errno == EINTR) { }
+					}
+				}
+				~FileLocker()
+				{
+					if (--d->lockDepth == 0 && d->lockFd >= 0) {
+						flock(d->lockFd, LOCK_UN);
+					}
+				}
+			private:
+				RP_DISABLE_COPY(FileLocker)
+				CacheIndexPrivate *const d;
+		};
+
+	public:
+		/**
+		 * Open the index file and read all records.
+		 * The index file will be created if it doesn't exist.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		int openIndex(void);
+
+		/**
+		 * Close the index file and clear the in-memory index.
+		 */
+		void closeIndex(void);
+
+		/**
+		 * Read new records from the index file.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		int readIndex(void);
+
+		/**
+		 * Apply an index record.
+		 * @param line Record, without the trailing newline.
+		 */
+		void applyRecord(const string &line);
+
+		/**
+		 * Set an entry in the in-memory index.
+		 * @param key Filtered cache key.
+		 * @param entry Entry.
+		 */
+		void setEntry(const string &key, const Entry &entry);
+
+		/**
+		 * Erase an entry from the in-memory index.
+		 * @param key Filtered cache key.
+		 */
+		void eraseEntry(const string &key);
+
+		/**
+		 * Append a record to the index file.
+		 * @param record Record, including the trailing newline.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		int appendRecord(const string &record);
+
+		/**
+		 * Add an entry and append its record to the index file.
+		 * File lock must be held.
+		 * @param key Filtered cache key.
+		 * @param entry Entry.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		int writeEntry(const string &key, const Entry &entry);
+
+		/**
+		 * Erase an entry and append its record to the index file.
+		 * File lock must be held.
+		 * @param key Filtered cache key.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		int deleteEntry(const string &key);
+
+		/**
+		 * Synchronize the in-memory index with the index file.
+		 * Mutex must be held.
+		 * @param force If true, always check the index file.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		int sync(bool force);
+
+		/**
+		 * Add a file that's stored separately in the cache directory.
+		 * Mutex and file lock must be held, and the index must be synchronized.
+		 * @param key	[in] Filtered cache key.
+		 * @param st	[in] File status.
+		 * @param mtime	[in] Time the file was stored in the cache.
+		 * @param atime	[in] Access time.
+		 * @param entry	[out] Entry.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		int addFile(const string &key, const struct stat &st, int64_t mtime, int64_t atime, Entry &entry);
+
+		/**
+		 * Open the current pack file for appending.
+		 * A new pack file will be started if the current one is full.
+		 * File lock must be held.
+		 * @param pPack		[out] Pack file number.
+		 * @param pOffset	[out] Offset of the next file in the pack file.
+		 * @return File descriptor, or negative POSIX error code on error.
+		 */
+		int openPackForAppend(uint32_t *pPack, uint64_t *pOffset);
+
+		/**
+		 * Append data to the current pack file.
+		 * File lock must be held.
+		 * @param data	[in] Data.
+		 * @param size	[in] Data size.
+		 * @param entry	[in,out] Entry. (pack and offset will be updated)
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		int appendToPack(const uint8_t *data, size_t size, Entry &entry);
+
+		/**
+		 * Evict the least recently used files if the cache
+		 * is larger than the maximum size.
+		 * Mutex and file lock must be held, and the index must be synchronized.
+		 * @param keep Filtered cache key of a file that shouldn't be evicted, e.g. a file that was just added.
+		 * @return Number of files evicted; negative POSIX error code on error.
+		 */
+		int evict(const string *keep = nullptr);
+
+		/**
+		 * Compact pack files that are mostly unused.
+		 * Mutex and file lock must be held, and the index must be synchronized.
+		 */
+		void compactPacks(void);
+
+		/**
+		 * Add all files in a directory that aren't indexed yet.
+		 * Mutex and file lock must be held, and the index must be synchronized.
+		 * @param subdir	[in] Subdirectory, relative to the cache directory. (empty for the root)
+		 * @param pStats	[in,out] Migration statistics.
+		 */
+		void migrateDir(const string &subdir, CacheIndex::MigrateStats *pStats);
+
+		/**
+		 * Rewrite the index file if it has too many obsolete records.
+		 * Mutex and file lock must be held, and the index must be synchronized.
+		 * @param force If true, always rewrite the index file.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		int rewriteIndex(bool force = false);
+
+	public:
+		string cacheDir;	// Cache directory, with trailing slash.
+		string idxFilename;	// Index filename.
+		int idxFd;		// Index file descriptor.
+		int lockFd;		// Lock file descriptor.
+		int lockDepth;		// Lock file recursion depth.
+		dev_t idxDev;		// Index file device.
+		ino_t idxIno;		// Index file inode.
+		off_t idxPos;		// Position of the next unread record.
+		unsigned int idxRecords;	// Number of records in the index file.
+		time_t lastSync;	// Time of the last synchronization.
+
+		// Settings
+		uint64_t maxSize;
+		bool packSmallFiles;
+
+		// In-memory index.
+		Mutex mutex;
+		unordered_map<string, Entry> entries;
+		uint64_t totalSize;
+		// Size of the live files in each pack file.
+		map<uint32_t, uint64_t> packLive;
+};
+
+/** CacheIndexPrivate **/
+
+CacheIndexPrivate::CacheIndexPrivate(const string &cacheDir)
+	: cacheDir(cacheDir)
+	, idxFd(-1)
+	, lockFd(-1)
+	, lockDepth(0)
+	, idxDev(0)
+	, idxIno(0)
+	, idxPos(0)
+	, idxRecords(0)
+	, lastSync(0)
+	, maxSize(0)
+	, packSmallFiles(false)
+	, totalSize(0)
+{
+	if (this->cacheDir.empty())
+		return;
+	if (this->cacheDir[this->cacheDir.size()-1] != '/') {
+		this->cacheDir += '/';
+	}
+	idxFilename = this->cacheDir + idx_name;
+
+	// Make sure the cache directory exists.
+	// NOTE: Only the last two components are created, since
+	// the user's cache directory should already exist.
+	string parentDir = this->cacheDir.substr(0, this->cacheDir.size()-1);
+	const size_t slash = parentDir.rfind('/');
+	if (slash != string::npos && slash > 0) {
+		parentDir.resize(slash);
+		mkdir(parentDir.c_str(), 0777);
+	}
+	mkdir(this->cacheDir.c_str(), 0777);
+
+	const string lockFilename = this->cacheDir + lock_name;
+	lockFd = open(lockFilename.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+	if (lockFd < 0) {
+		// Unable to create the lock file.
+		// The cache directory is probably not writable.
+		return;
+	}
+
+	MutexLocker mutexLocker(mutex);
+	if (openIndex() != 0) {
+		close(lockFd);
+		lockFd = -1;
+	}
+}
+
+CacheIndexPrivate::~CacheIndexPrivate()
+{
+	closeIndex();
+	if (lockFd >= 0) {
+		close(lockFd);
+	}
+}
+
+/**
+ * Open the index file and read all records.
+ * The index file will be created if it doesn't exist.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int CacheIndexPrivate::openIndex(void)
+{
+	closeIndex();
+
+	idxFd = open(idxFilename.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+	if (idxFd < 0) {
+		const int err = errno;
+		return (err != 0 ? -err : -EIO);
+	}
+
+	struct stat st;
+	if (fstat(idxFd, &st) != 0) {
+		const int err = errno;
+		closeIndex();
+		return (err != 0 ? -err : -EIO);
+	}
+	idxDev = st.st_dev;
+	idxIno = st.st_ino;
+	lastSync = time(nullptr);
+
+	if (st.st_size > 0) {
+		// Existing index.
+		int ret = readIndex();
+		if (ret != -EBADMSG) {
+			return ret;
+		}
+
+		// Invalid index file. Discard it and create a new one.
+		FileLocker fileLocker(this);
+		unlink(idxFilename.c_str());
+		closeIndex();
+		idxFd = open(idxFilename.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+		if (idxFd < 0 || fstat(idxFd, &st) != 0) {
+			const int err = errno;
+			closeIndex();
+			return (err != 0 ? -err : -EIO);
+		}
+		idxDev = st.st_dev;
+		idxIno = st.st_ino;
+	}
+
+	// New index file.
+	// If another process is creating it, wait for it to finish.
+	FileLocker fileLocker(this);
+	if (fstat(idxFd, &st) != 0) {
+		const int err = errno;
+		closeIndex();
+		return (err != 0 ? -err : -EIO);
+	}
+	if (st.st_size == 0) {
+		// Write the header, then add all files that are
+		// already in the cache directory.
+		if (write(idxFd, idx_header, sizeof(idx_header)-1) != (ssize_t)(sizeof(idx_header)-1)) {
+			closeIndex();
+			return -EIO;
+		}
+		idxPos = sizeof(idx_header)-1;
+		migrateDir(string(), nullptr);
+		evict();
+		return 0;
+	}
+
+	return readIndex();
+}
+
+/**
+ * Close the index file and clear the in-memory index.
+ */
+void CacheIndexPrivate::closeIndex(void)
+{
+	if (idxFd >= 0) {
+		close(idxFd);
+		idxFd = -1;
+	}
+	idxPos = 0;
+	idxRecords = 0;
+	entries.clear();
+	packLive.clear();
+	totalSize = 0;
+}
+
+/**
+ * Read new records from the index file.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int CacheIndexPrivate::readIndex(void)
+{
+	string buf;
+	char chunk[16384];
+	off_t pos = idxPos;
+	for (;;) {
+		const ssize_t size = pread(idxFd, chunk, sizeof(chunk), pos);
+		if (size < 0) {
+			if (errno == EINTR)
+				continue;
+			const int err = errno;
+			return (err != 0 ? -err : -EIO);
+		} else if (size == 0) {
+			break;
+		}
+		buf.append(chunk, size);
+		pos += size;
+	}
+
+	size_t start = 0;
+	if (idxPos == 0) {
+		// Verify the header.
+		if (buf.compare(0, sizeof(idx_header)-1, idx_header) != 0) {
+			return -EBADMSG;
+		}
+		start = sizeof(idx_header)-1;
+	}
+
+	// Process complete records only. A partial record may
+	// be in the process of being written by another process.
+	size_t nl;
+	while ((nl = buf.find('\n', start)) != string::npos) {
+		applyRecord(buf.substr(start, nl - start));
+		idxRecords++;
+		start = nl + 1;
+	}
+	idxPos += start;
+	return 0;
+}
+
+/**
+ * Apply an index record.
+ * @param line Record, without the trailing newline.
+ */
+void CacheIndexPrivate::applyRecord(const string &line)
+{
+	// Record formats:
+	// - Add:    "A size mtime atime pack offset key"
+	// - Touch:  "T atime key"
+	// - Delete: "D key"
+	if (line.size() < 3 || line[1] != ' ')
+		return;
+
+	const char *p = line.c_str() + 2;
+	char *endptr;
+	switch (line[0]) {
+		case 'A': {
+			Entry entry;
+			entry.size = static_cast<uint32_t>(strtoul(p, &endptr, 10));
+			if (*endptr != ' ') return;
+			entry.mtime = strtoll(endptr + 1, &endptr, 10);
+			if (*endptr != ' ') return;
+			entry.atime = strtoll(endptr + 1, &endptr, 10);
+			if (*endptr != ' ') return;
+			entry.pack = static_cast<uint32_t>(strtoul(endptr + 1, &endptr, 10));
+			if (*endptr != ' ') return;
+			entry.offset = strtoull(endptr + 1, &endptr, 10);
+			if (*endptr != ' ' || endptr[1] == '\0') return;
+			setEntry(string(endptr + 1), entry);
+			break;
+		}
+
+		case 'T': {
+			const int64_t atime = strtoll(p, &endptr, 10);
+			if (*endptr != ' ') return;
+			auto iter = entries.find(string(endptr + 1));
+			if (iter != entries.end() && iter->second.atime < atime) {
+				iter->second.atime = atime;
+			}
+			break;
+		}
+
+		case 'D':
+			eraseEntry(string(p));
+			break;
+
+		default:
+			// Unknown record.
+			break;
+	}
+}
+
+/**
+ * Set an entry in the in-memory index.
+ * @param key Filtered cache key.
+ * @param entry Entry.
+ */
+void CacheIndexPrivate::setEntry(const string &key, const Entry &entry)
+{
+	eraseEntry(key);
+	entries.emplace(key, entry);
+	totalSize += entry.size;
+	if (entry.pack != 0) {
+		packLive[entry.pack] += entry.size;
+	}
+}
+
+/**
+ * Erase an entry from the in-memory index.
+ * @param key Filtered cache key.
+ */
+void CacheIndexPrivate::eraseEntry(const string &key)
+{
+	auto iter = entries.find(key);
+	if (iter == entries.end())
+		return;
+
+	const Entry &entry = iter->second;
+	totalSize -= entry.size;
+	if (entry.pack != 0) {
+		// NOTE: The pack file is kept in packLive even if
+		// it's empty so compactPacks() can delete it.
+		packLive[entry.pack] -= entry.size;
+	}
+	entries.erase(iter);
+}
+
+/**
+ * Append a record to the index file.
+ * @param record Record, including the trailing newline.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int CacheIndexPrivate::appendRecord(const string &record)
+{
+	if (idxFd < 0)
+		return -EBADF;
+
+	// NOTE: The index file is opened with O_APPEND, so the record
+	// is written atomically at the end of the file. It will be
+	// read again by readIndex(), which is harmless, since
+	// applying the same record twice has no effect.
+	ssize_t size;
+	do {
+		size = write(idxFd, record.data(), record.size());
+	} while (size < 0 && errno == EINTR);
+	if (size != static_cast<ssize_t>(record.size())) {
+		const int err = (size < 0 ? errno : EIO);
+		return (err != 0 ? -err : -EIO);
+	}
+	return 0;
+}
+
+/**
+ * Add an entry and append its record to the index file.
+ * File lock must be held.
+ * @param key Filtered cache key.
+ * @param entry Entry.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int CacheIndexPrivate::writeEntry(const string &key, const Entry &entry)
+{
+	char buf[128];
+	snprintf(buf, sizeof(buf), "A %u %" PRId64 " %" PRId64 " %u %" PRIu64 " ",
+		entry.size, entry.mtime, entry.atime, entry.pack, entry.offset);
+	string record(buf);
+	record += key;
+	record += '\n';
+
+	int ret = appendRecord(record);
+	if (ret == 0) {
+		setEntry(key, entry);
+	}
+	return ret;
+}
+
+/**
+ * Erase an entry and append its record to the index file.
+ * File lock must be held.
+ * @param key Filtered cache key.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int CacheIndexPrivate::deleteEntry(const string &key)
+{
+	string record("D ");
+	record += key;
+	record += '\n';
+
+	int ret = appendRecord(record);
+	if (ret == 0) {
+		eraseEntry(key);
+	}
+	return ret;
+}
+
+/**
+ * Synchronize the in-memory index with the index file.
+ * Mutex must be held.
+ * @param force If true, always check the index file.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int CacheIndexPrivate::sync(bool force)
+{
+	if (lockFd < 0)
+		return -EBADF;
+
+	const time_t now = time(nullptr);
+	if (!force && idxFd >= 0 && now == lastSync) {
+		// Already synchronized within the last second.
+		return 0;
+	}
+	lastSync = now;
+
+	struct stat st;
+	if (idxFd < 0 || stat(idxFilename.c_str(), &st) != 0 ||
+	    st.st_dev != idxDev || st.st_ino != idxIno || st.st_size < idxPos)
+	{
+		// Index file was deleted, e.g. if the cache was cleared,
+		// or it was replaced by rewriteIndex() in another process.
+		return openIndex();
+	} else if (st.st_size > idxPos) {
+		// New records were added by another process.
+		return readIndex();
+	}
+	return 0;
+}
+
+/**
+ * Add a file that's stored separately in the cache directory.
+ * Mutex and file lock must be held, and the index must be synchronized.
+ * @param key	[in] Filtered cache key.
+ * @param st	[in] File status.
+ * @param mtime	[in] Time the file was stored in the cache.
+ * @param atime	[in] Access time.
+ * @param entry	[out] Entry.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int CacheIndexPrivate::addFile(const string &key, const struct stat &st, int64_t mtime, int64_t atime, Entry &entry)
+{
+	if (st.st_size > static_cast<off_t>(UINT32_MAX))
+		return -EFBIG;
+
+	entry.mtime = mtime;
+	entry.atime = atime;
+	entry.size = static_cast<uint32_t>(st.st_size);
+	entry.pack = 0;
+	entry.offset = 0;
+
+	if (!packSmallFiles || entry.size > PACK_MAX_FILE_SIZE) {
+		// Keep the file separate.
+		return writeEntry(key, entry);
+	}
+
+	// Move the file into a pack file.
+	// Negative cache entries don't need to be stored
+	// at all, since the index entry has all the data.
+	const string filename = cacheDir + key;
+	if (entry.size > 0) {
+		const int fd = open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+		if (fd < 0) {
+			const int err = errno;
+			return (err != 0 ? -err : -EIO);
+		}
+		unique_ptr<uint8_t[]> data(new uint8_t[entry.size]);
+		const ssize_t size = pread(fd, data.get(), entry.size, 0);
+		close(fd);
+		if (size != static_cast<ssize_t>(entry.size) ||
+		    appendToPack(data.get(), entry.size, entry) != 0)
+		{
+			// Unable to pack the file. Keep it separate.
+			entry.pack = 0;
+			entry.offset = 0;
+			return writeEntry(key, entry);
+		}
+	}
+
+	int ret = writeEntry(key, entry);
+	if (ret == 0) {
+		// File is now in the pack file.
+		unlink(filename.c_str());
+	}
+	return ret;
+}
+
+/**
+ * Open the current pack file for appending.
+ * A new pack file will be started if the current one is full.
+ * File lock must be held.
+ * @param pPack		[out] Pack file number.
+ * @param pOffset	[out] Offset of the next file in the pack file.
+ * @return File descriptor, or negative POSIX error code on error.
+ */
+int CacheIndexPrivate::openPackForAppend(uint32_t *pPack, uint64_t *pOffset)
+{
+	const string packDir = cacheDir + packs_name;
+	mkdir(packDir.c_str(), 0777);
+
+	uint32_t pack = (packLive.empty() ? 1 : packLive.rbegin()->first);
+	for (unsigned int tries = 0; tries < 2; tries++, pack++) {
+		char buf[32];
+		snprintf(buf, sizeof(buf), "/%08u.pak", pack);
+		const string packFilename = packDir + buf;
+
+		const int fd = open(packFilename.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+		if (fd < 0) {
+			const int err = errno;
+			return (err != 0 ? -err : -EIO);
+		}
+
+		struct stat st;
+		if (fstat(fd, &st) != 0) {
+			const int err = errno;
+			close(fd);
+			return (err != 0 ? -err : -EIO);
+		}
+		if (st.st_size >= static_cast<off_t>(PACK_MAX_SIZE)) {
+			// Pack file is full.
+			close(fd);
+			continue;
+		}
+
+		if (st.st_size == 0) {
+			// New pack file.
+			if (write(fd, pack_magic, sizeof(pack_magic)) != (ssize_t)sizeof(pack_magic)) {
+				close(fd);
+				return -EIO;
+			}
+			st.st_size = sizeof(pack_magic);
+		}
+
+		*pPack = pack;
+		*pOffset = static_cast<uint64_t>(st.st_size);
+		return fd;
+	}
+
+	return -ENOSPC;
+}
+
+/**
+ * Append data to the current pack file.
+ * File lock must be held.
+ * @param data	[in] Data.
+ * @param size	[in] Data size.
+ * @param entry	[in,out] Entry. (pack and offset will be updated)
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int CacheIndexPrivate::appendToPack(const uint8_t *data, size_t size, Entry &entry)
+{
+	uint32_t pack;
+	uint64_t offset;
+	const int fd = openPackForAppend(&pack, &offset);
+	if (fd < 0)
+		return fd;
+
+	const ssize_t written = write(fd, data, size);
+	close(fd);
+	if (written != static_cast<ssize_t>(size)) {
+		// NOTE: A partially-written file will be removed
+		// when the pack file is compacted.
+		return -EIO;
+	}
+
+	entry.pack = pack;
+	entry.offset = offset;
+	if (packLive.find(pack) == packLive.end()) {
+		// Make sure the next file is appended to this pack file.
+		packLive.emplace(pack, 0);
+	}
+	return 0;
+}
+
+/**
+ * Evict the least recently used files if the cache
+ * is larger than the maximum size.
+ * Mutex and file lock must be held, and the index must be synchronized.
+ * @param keep Filtered cache key of a file that shouldn't be evicted, e.g. a file that was just added.
+ * @return Number of files evicted; negative POSIX error code on error.
+ */
+int CacheIndexPrivate::evict(const string *keep)
+{
+	if (maxSize == 0 || totalSize <= maxSize)
+		return 0;
+
+	// Sort the files by access time.
+	// NOTE: Negative cache entries are handled by the Cache Manager,
+	// and they don't take up any space, so they're not evicted.
+	vector<std::pair<int64_t, const string*> > lru;
+	lru.reserve(entries.size());
+	for (const auto &p : entries) {
+		if (p.second.size > 0 && (!keep || p.first != *keep)) {
+			lru.emplace_back(p.second.atime, &p.first);
+		}
+	}
+	std::sort(lru.begin(), lru.end(),
+		[](const std::pair<int64_t, const string*> &a, const std::pair<int64_t, const string*> &b) {
+			return (a.first < b.first);
+		});
+
+	const uint64_t targetSize = maxSize / 100 * EVICT_TARGET_PERCENT;
+	int count = 0;
+	for (const auto &p : lru) {
+		if (totalSize <= targetSize)
+			break;
+
+		const string key = *p.second;
+		const Entry &entry = entries[key];
+		if (entry.pack == 0) {
+			const string filename = cacheDir + key;
+			if (unlink(filename.c_str()) != 0 && errno != ENOENT) {
+				// Unable to delete the file.
+				continue;
+			}
+		}
+		int ret = deleteEntry(key);
+		if (ret != 0)
+			return ret;
+		count++;
+	}
+
+	// Reclaim space in the pack files.
+	compactPacks();
+	return count;
+}
+
+/**
+ * Compact pack files that are mostly unused.
+ * Mutex and file lock must be held, and the index must be synchronized.
+ */
+void CacheIndexPrivate::compactPacks(void)
+{
+	// Find pack files that are less than half used.
+	// NOTE: The current pack file isn't compacted unless it's
+	// empty, since new files are still being appended to it.
+	vector<uint32_t> packs;
+	const uint32_t curPack = (packLive.empty() ? 0 : packLive.rbegin()->first);
+	for (const auto &p : packLive) {
+		if (p.second == 0) {
+			packs.push_back(p.first);
+			continue;
+		} else if (p.first == curPack) {
+			continue;
+		}
+
+		char buf[32];
+		snprintf(buf, sizeof(buf), "%s/%08u.pak", packs_name, p.first);
+		struct stat st;
+		if (stat((cacheDir + buf).c_str(), &st) == 0 &&
+		    p.second * 2 < static_cast<uint64_t>(st.st_size))
+		{
+			packs.push_back(p.first);
+		}
+	}
+
+	for (const uint32_t pack : packs) {
+		char buf[32];
+		snprintf(buf, sizeof(buf), "%s/%08u.pak", packs_name, pack);
+		const string packFilename = cacheDir + buf;
+
+		// Move the live files into the current pack file.
+		bool ok = true;
+		if (packLive[pack] != 0) {
+			const int fd = open(packFilename.c_str(), O_RDONLY | O_CLOEXEC);
+			if (fd < 0)
+				continue;
+
+			vector<string> keys;
+			for (const auto &p : entries) {
+				if (p.second.pack == pack) {
+					keys.push_back(p.first);
+				}
+			}
+			for (const string &key : keys) {
+				Entry entry = entries[key];
+				unique_ptr<uint8_t[]> data(new uint8_t[entry.size]);
+				if (pread(fd, data.get(), entry.size, entry.offset) != static_cast<ssize_t>(entry.size) ||
+				    appendToPack(data.get(), entry.size, entry) != 0 ||
+				    writeEntry(key, entry) != 0)
+				{
+					ok = false;
+					break;
+				}
+			}
+			close(fd);
+		}
+
+		if (ok) {
+			unlink(packFilename.c_str());
+			packLive.erase(pack);
+		}
+	}
+}
+
+/**
+ * Add all files in a directory that aren't indexed yet.
+ * Mutex and file lock must be held, and the index must be synchronized.
+ * @param subdir	[in] Subdirectory, relative to the cache directory. (empty for the root)
+ * @param pStats	[in,out] Migration statistics.
+ */
+void CacheIndexPrivate::migrateDir(const string &subdir, CacheIndex::MigrateStats *pStats)
+{
+	const string dirname = cacheDir + subdir;
+	DIR *const dir = opendir(dirname.c_str());
+	if (!dir)
+		return;
+
+	const time_t now = time(nullptr);
+	vector<string> subdirs;
+	struct dirent *dirent;
+	while ((dirent = readdir(dir)) != nullptr) {
+		const char *const name = dirent->d_name;
+		if (name[0] == '.') {
+			// Skip "." and "..", as well as hidden files.
+			continue;
+		}
+		if (subdir.empty() &&
+		    (!strncmp(name, idx_name, sizeof(idx_name)-1) ||
+		     !strcmp(name, lock_name) || !strcmp(name, packs_name)))
+		{
+			// Skip the index, lock, and pack files.
+			continue;
+		}
+
+		const string key = subdir + name;
+		const string filename = cacheDir + key;
+		struct stat st;
+		if (lstat(filename.c_str(), &st) != 0)
+			continue;
+
+		if (S_ISDIR(st.st_mode)) {
+			subdirs.push_back(key + '/');
+			continue;
+		} else if (!S_ISREG(st.st_mode)) {
+			continue;
+		}
+
+		if (entries.find(key) != entries.end()) {
+			// Already indexed.
+			continue;
+		}
+		if (now - st.st_mtime < MIGRATE_MIN_AGE && now >= st.st_mtime) {
+			// File was just modified. It might still be downloading.
+			continue;
+		}
+
+		// NOTE: Using the file's access time to keep the
+		// LRU order of existing files if possible.
+		Entry entry;
+		if (addFile(key, st, st.st_mtime, std::max(st.st_atime, st.st_mtime), entry) != 0)
+			continue;
+		if (pStats) {
+			pStats->files++;
+			pStats->bytes += entry.size;
+			if (entry.pack != 0) {
+				pStats->packed++;
+			}
+		}
+	}
+	closedir(dir);
+
+	for (const string &s : subdirs) {
+		migrateDir(s, pStats);
+		if (packSmallFiles) {
+			// Remove the directory if all of its files were packed.
+			rmdir((cacheDir + s).c_str());
+		}
+	}
+}
+
+/**
+ * Rewrite the index file if it has too many obsolete records.
+ * Mutex and file lock must be held, and the index must be synchronized.
+ * @param force If true, always rewrite the index file.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int CacheIndexPrivate::rewriteIndex(bool force)
+{
+	if (!force && idxRecords < (entries.size() * 2) + 256)
+		return 0;
+
+	char buf[64];
+	snprintf(buf, sizeof(buf), ".tmp.%u", static_cast<unsigned int>(getpid()));
+	const string tmpFilename = idxFilename + buf;
+	FILE *f = fopen(tmpFilename.c_str(), "wb");
+	if (!f) {
+		const int err = errno;
+		return (err != 0 ? -err : -EIO);
+	}
+
+	fputs(idx_header, f);
+	for (const auto &p : entries) {
+		const Entry &entry = p.second;
+		fprintf(f, "A %u %" PRId64 " %" PRId64 " %u %" PRIu64 " %s\n",
+			entry.size, entry.mtime, entry.atime, entry.pack, entry.offset,
+			p.first.c_str());
+	}
+	const bool ok = !ferror(f);
+	if (fclose(f) != 0 || !ok ||
+	    rename(tmpFilename.c_str(), idxFilename.c_str()) != 0)
+	{
+		unlink(tmpFilename.c_str());
+		return -EIO;
+	}
+
+	// Reopen the new index file.
+	// NOTE: This re-reads the index, but that's rare enough
+	// that it isn't worth optimizing.
+	return openIndex();
+}
+
+/** CacheIndex **/
+
+CacheIndex::CacheIndex(const string &cacheDir)
+	: d_ptr(new CacheIndexPrivate(cacheDir))
+{ }
+
+CacheIndex::~CacheIndex()
+{
+	delete d_ptr;
+}
+
+// CacheIndex instance for the user's cache directory.
+static pthread_once_t instance_once_control = PTHREAD_ONCE_INIT;
+static unique_ptr<CacheIndex> instance_ptr;
+
+/**
+ * Initialize the CacheIndex instance.
+ * Called by pthread_once().
+ */
+static void initInstance(void)
+{
+	const string &cacheDir = getCacheDirectory();
+	if (cacheDir.empty())
+		return;
+
+	unique_ptr<CacheIndex> index(new CacheIndex(cacheDir));
+	if (index->isOpen()) {
+		instance_ptr = std::move(index);
+	}
+}
+
+/**
+ * Get the CacheIndex for the user's cache directory.
+ * @return CacheIndex, or nullptr if the cache directory isn't accessible.
+ */
+CacheIndex *CacheIndex::instance(void)
+{
+	pthread_once(&instance_once_control, initInstance);
+	return instance_ptr.get();
+}
+
+/**
+ * Is the cache index open?
+ * @return True if open; false if not.
+ */
+bool CacheIndex::isOpen(void) const
+{
+	RP_D(const CacheIndex);
+	return (d->idxFd >= 0);
+}
+
+/** Settings **/
+
+/**
+ * Get the maximum cache size.
+ * @return Maximum cache size, in bytes. (0 == unlimited)
+ */
+uint64_t CacheIndex::maxSize(void) const
+{
+	RP_D(const CacheIndex);
+	return d->maxSize;
+}
+
+/**
+ * Set the maximum cache size.
+ * If the cache is larger than the new maximum size,
+ * files will be evicted the next time a file is added.
+ * @param maxSize Maximum cache size, in bytes. (0 == unlimited)
+ */
+void CacheIndex::setMaxSize(uint64_t maxSize)
+{
+	RP_D(CacheIndex);
+	MutexLocker mutexLocker(d->mutex);
+	d->maxSize = maxSize;
+}
+
+/**
+ * Are small files packed into pack files?
+ * @return True if small files are packed; false if not.
+ */
+bool CacheIndex::packSmallFiles(void) const
+{
+	RP_D(const CacheIndex);
+	return d->packSmallFiles;
+}
+
+/**
+ * Set whether small files should be packed into pack files.
+ * This only affects files added after this setting is changed.
+ * @param packSmallFiles True to pack small files; false to keep them separate.
+ */
+void CacheIndex::setPackSmallFiles(bool packSmallFiles)
+{
+	RP_D(CacheIndex);
+	MutexLocker mutexLocker(d->mutex);
+	d->packSmallFiles = packSmallFiles;
+}
+
+/** Cache entries **/
+
+/**
+ * Look up a cache key.
+ * The entry's access time will be updated.
+ * @param cacheKey	[in] Cache key. (Will be filtered using filterCacheKey().)
+ * @param entry		[out] Cache entry.
+ * @return 0 on success; negative POSIX error code on error. (-ENOENT if not indexed)
+ */
+int CacheIndex::lookup(const string &cacheKey, Entry &entry)
+{
+	string key = cacheKey;
+	if (filterCacheKey(key) != 0)
+		return -EINVAL;
+
+	RP_D(CacheIndex);
+	MutexLocker mutexLocker(d->mutex);
+	d->sync(false);
+
+	auto iter = d->entries.find(key);
+	if (iter == d->entries.end())
+		return -ENOENT;
+
+	// Update the access time.
+	// NOTE: Only written to the index file if it changed significantly
+	// in order to reduce the number of index records.
+	const time_t now = time(nullptr);
+	if (now - iter->second.atime >= TOUCH_INTERVAL) {
+		iter->second.atime = now;
+		char buf[32];
+		snprintf(buf, sizeof(buf), "T %" PRId64 " ", static_cast<int64_t>(now));
+		string record(buf);
+		record += key;
+		record += '\n';
+		d->appendRecord(record);
+	}
+
+	entry = iter->second;
+	return 0;
+}
+
+/**
+ * Add a file to the cache index.
+ *
+ * The file must already be present in the cache directory,
+ * e.g. after it was downloaded by rp-download. If packing is
+ * enabled and the file is small enough, it will be moved into
+ * a pack file. If the cache is larger than the maximum size,
+ * the least recently used files will be evicted.
+ *
+ * NOTE: rp-download sets the file's mtime to the server's
+ * Last-Modified time, so the time the file was downloaded
+ * or revalidated should be specified in mtime.
+ *
+ * @param cacheKey	[in] Cache key. (Will be filtered using filterCacheKey().)
+ * @param mtime		[in,opt] Time the file was stored in the cache, or -1 to use the file's mtime.
+ * @param pEntry	[out,opt] Cache entry.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int CacheIndex::add(const string &cacheKey, int64_t mtime, Entry *pEntry)
+{
+	string key = cacheKey;
+	if (filterCacheKey(key) != 0)
+		return -EINVAL;
+
+	RP_D(CacheIndex);
+	MutexLocker mutexLocker(d->mutex);
+	CacheIndexPrivate::FileLocker fileLocker(d);
+	int ret = d->sync(true);
+	if (ret != 0)
+		return ret;
+
+	struct stat st;
+	if (stat((d->cacheDir + key).c_str(), &st) != 0 || !S_ISREG(st.st_mode)) {
+		const int err = errno;
+		auto iter = d->entries.find(key);
+		if (iter != d->entries.end()) {
+			// Another process already added this file.
+			if (pEntry) {
+				*pEntry = iter->second;
+			}
+			return 0;
+		}
+		return (err != 0 ? -err : -EIO);
+	}
+
+	Entry entry;
+	ret = d->addFile(key, st, (mtime >= 0 ? mtime : st.st_mtime), time(nullptr), entry);
+	if (ret != 0)
+		return ret;
+	if (pEntry) {
+		*pEntry = entry;
+	}
+
+	d->evict(&key);
+	d->rewriteIndex();
+	return 0;
+}
+
+/**
+ * Remove a file from the cache.
+ * The file will be deleted if it's stored separately.
+ * @param cacheKey Cache key. (Will be filtered using filterCacheKey().)
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int CacheIndex::remove(const string &cacheKey)
+{
+	string key = cacheKey;
+	if (filterCacheKey(key) != 0)
+		return -EINVAL;
+
+	RP_D(CacheIndex);
+	MutexLocker mutexLocker(d->mutex);
+	CacheIndexPrivate::FileLocker fileLocker(d);
+	int ret = d->sync(true);
+	if (ret != 0)
+		return ret;
+
+	auto iter = d->entries.find(key);
+	const bool indexed = (iter != d->entries.end());
+	if (!indexed || iter->second.pack == 0) {
+		if (unlink((d->cacheDir + key).c_str()) != 0) {
+			const int err = errno;
+			if (!indexed || err != ENOENT) {
+				return (err != 0 ? -err : -EIO);
+			}
+		}
+	}
+	if (indexed) {
+		ret = d->deleteEntry(key);
+		d->rewriteIndex();
+	}
+	return ret;
+}
+
+/**
+ * Extract a file stored in a pack file to a separate file
+ * in the cache directory, e.g. so rp-download can revalidate it.
+ * The file's mtime is set to the entry's mtime.
+ *
+ * The index entry isn't changed. Call add() afterwards
+ * to index the separate file.
+ *
+ * @param cacheKey Cache key. (Will be filtered using filterCacheKey().)
+ * @return 0 on success (or if the file is already stored separately); negative POSIX error code on error.
+ */
+int CacheIndex::extract(const string &cacheKey)
+{
+	string key = cacheKey;
+	if (filterCacheKey(key) != 0)
+		return -EINVAL;
+
+	RP_D(CacheIndex);
+	MutexLocker mutexLocker(d->mutex);
+	CacheIndexPrivate::FileLocker fileLocker(d);
+	int ret = d->sync(true);
+	if (ret != 0)
+		return ret;
+
+	auto iter = d->entries.find(key);
+	if (iter == d->entries.end())
+		return -ENOENT;
+	const Entry entry = iter->second;
+	if (entry.pack == 0 || entry.size == 0) {
+		// Not stored in a pack file.
+		return 0;
+	}
+
+	// Read the file data from the pack file.
+	char buf[32];
+	snprintf(buf, sizeof(buf), "%s/%08u.pak", packs_name, entry.pack);
+	int fd = open((d->cacheDir + buf).c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		const int err = errno;
+		return (err != 0 ? -err : -EIO);
+	}
+	unique_ptr<uint8_t[]> data(new uint8_t[entry.size]);
+	const ssize_t size = pread(fd, data.get(), entry.size, entry.offset);
+	close(fd);
+	if (size != static_cast<ssize_t>(entry.size))
+		return -EIO;
+
+	// Create subdirectories if necessary.
+	for (size_t pos = key.find('/'); pos != string::npos; pos = key.find('/', pos + 1)) {
+		mkdir((d->cacheDir + key.substr(0, pos)).c_str(), 0777);
+	}
+
+	// Write the file to a temporary file first so
+	// other processes never see a partial file.
+	const string filename = d->cacheDir + key;
+	snprintf(buf, sizeof(buf), ".tmp.%u", static_cast<unsigned int>(getpid()));
+	const string tmpFilename = filename + buf;
+	fd = open(tmpFilename.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (fd < 0) {
+		const int err = errno;
+		return (err != 0 ? -err : -EIO);
+	}
+	ret = 0;
+	if (write(fd, data.get(), entry.size) != static_cast<ssize_t>(entry.size)) {
+		ret = -EIO;
+	} else {
+		struct timeval tv[2];
+		tv[0].tv_sec = static_cast<time_t>(entry.mtime);
+		tv[0].tv_usec = 0;
+		tv[1] = tv[0];
+		futimes(fd, tv);
+	}
+	close(fd);
+	if (ret == 0 && rename(tmpFilename.c_str(), filename.c_str()) != 0) {
+		const int err = errno;
+		ret = (err != 0 ? -err : -EIO);
+	}
+	if (ret != 0) {
+		unlink(tmpFilename.c_str());
+	}
+	return ret;
+}
+
+/**
+ * Get the filename of a file stored separately in the cache.
+ * @param cacheKey Cache key. (Will be filtered using filterCacheKey().)
+ * @return Filename, or empty string on error.
+ */
+string CacheIndex::filename(const string &cacheKey) const
+{
+	string key = cacheKey;
+	if (filterCacheKey(key) != 0)
+		return string();
+
+	RP_D(const CacheIndex);
+	return d->cacheDir + key;
+}
+
+/**
+ * Get the filename of a pack file.
+ * @param pack Pack file number.
+ * @return Filename, or empty string on error.
+ */
+string CacheIndex::packFilename(uint32_t pack) const
+{
+	if (pack == 0)
+		return string();
+
+	char buf[32];
+	snprintf(buf, sizeof(buf), "%s/%08u.pak", packs_name, pack);
+	RP_D(const CacheIndex);
+	return d->cacheDir + buf;
+}
+
+/** Maintenance **/
+
+/**
+ * Synchronize the in-memory index with the index file.
+ * This is done automatically at most once per second.
+ * @param force If true, always check the index file.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int CacheIndex::sync(bool force)
+{
+	RP_D(CacheIndex);
+	MutexLocker mutexLocker(d->mutex);
+	return d->sync(force);
+}
+
+/**
+ * Check if a file in the cache directory belongs to the cache index,
+ * i.e. the index file, the lock file, or a pack file.
+ * Cache cleaners should allow these files to be deleted.
+ * @param relpath Filename, relative to the cache directory.
+ * @return True if the file belongs to the cache index; false if not.
+ */
+bool CacheIndex::isIndexFile(const char *relpath)
+{
+	if (!relpath)
+		return false;
+
+	// Index file, including temporary files from rewriteIndex().
+	if (!strncmp(relpath, idx_name, sizeof(idx_name)-1)) {
+		const char *const suffix = &relpath[sizeof(idx_name)-1];
+		return (suffix[0] == '\0' || !strncmp(suffix, ".tmp.", 5));
+	}
+	if (!strcmp(relpath, lock_name))
+		return true;
+
+	// Pack file: "packs/%08u.pak"
+	if (strncmp(relpath, packs_name, sizeof(packs_name)-1) != 0 ||
+	    relpath[sizeof(packs_name)-1] != '/')
+	{
+		return false;
+	}
+	const char *const pak = &relpath[sizeof(packs_name)];
+	if (strlen(pak) != 12 || strcmp(&pak[8], ".pak") != 0)
+		return false;
+	for (unsigned int i = 0; i < 8; i++) {
+		if (!isdigit(static_cast<unsigned char>(pak[i])))
+			return false;
+	}
+	return true;
+}
+
+/**
+ * Add all files in the cache directory that aren't indexed yet.
+ * This is used to migrate a cache created by an older version.
+ * @param pStats [out,opt] Migration statistics.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int CacheIndex::migrate(MigrateStats *pStats)
+{
+	MigrateStats stats = {0, 0, 0};
+
+	RP_D(CacheIndex);
+	MutexLocker mutexLocker(d->mutex);
+	CacheIndexPrivate::FileLocker fileLocker(d);
+	int ret = d->sync(true);
+	if (ret != 0)
+		return ret;
+
+	d->migrateDir(string(), &stats);
+	d->evict();
+	d->rewriteIndex();
+
+	if (pStats) {
+		*pStats = stats;
+	}
+	return 0;
+}
+
+/**
+ * Evict the least recently used files if the cache
+ * is larger than the maximum size.
+ * @return Number of files evicted; negative POSIX error code on error.
+ */
+int CacheIndex::evict(void)
+{
+	RP_D(CacheIndex);
+	MutexLocker mutexLocker(d->mutex);
+	CacheIndexPrivate::FileLocker fileLocker(d);
+	int ret = d->sync(true);
+	if (ret != 0)
+		return ret;
+
+	ret = d->evict();
+	d->rewriteIndex();
+	return ret;
+}
+
+/**
+ * Get the total size of all indexed files.
+ * @return Total size, in bytes.
+ */
+uint64_t CacheIndex::totalSize(void) const
+{
+	RP_D(CacheIndex);
+	MutexLocker mutexLocker(d->mutex);
+	return d->totalSize;
+}
+
+/**
+ * Get the number of indexed files.
+ * @return Number of indexed files, including negative cache entries.
+ */
+unsigned int CacheIndex::count(void) const
+{
+	RP_D(CacheIndex);
+	MutexLocker mutexLocker(d->mutex);
+	return static_cast<unsigned int>(d->entries.size());
+}
+
+}
@@ -0,0 +1,242 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (libcachecommon)                   *
+ * CacheIndex.hpp: Cache index with LRU eviction and small file packing.   *
+ *                                                                         *
+ * Copyright (c) 2016-2022 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#ifndef __ROMPROPERTIES_LIBCACHECOMMON_CACHEINDEX_HPP__
+#define __ROMPROPERTIES_LIBCACHECOMMON_CACHEINDEX_HPP__
+
+#include "common.h"
+
+// C includes.
+#include <stdint.h>
+
+// C++ includes.
+#include <string>
+
+namespace LibCacheCommon {
+
+/**
+ * Cache index.
+ *
+ * The cache index keeps track of every file in the cache directory,
+ * along with its size and last access time, in order to:
+ * - Look up cache files without accessing the file system.
+ * - Limit the total size of the cache by evicting the least
+ *   recently used files.
+ * - Optionally pack small files into append-only pack files,
+ *   which reduces the number of inodes used by the cache.
+ *
+ * The index is stored as an append-only journal ("cache.idx") in
+ * the cache directory, so multiple processes can share it. Each
+ * process keeps an in-memory copy and replays journal records
+ * written by other processes when it's synchronized.
+ *
+ * Files that were cached before the index was created are added
+ * when they're first used. migrate() can be used to add all of
+ * them at once.
+ *
+ * NOTE: The cache index is currently only available on Unix-like systems.
+ */
+class CacheIndexPrivate;
+class CacheIndex
+{
+	public:
+		/**
+		 * Open the cache index for a cache directory.
+		 * The cache directory will be created if it doesn't exist.
+		 * @param cacheDir Cache directory.
+		 */
+		explicit CacheIndex(const std::string &cacheDir);
+		~CacheIndex();
+
+	private:
+		RP_DISABLE_COPY(CacheIndex)
+	private:
+		friend class CacheIndexPrivate;
+		CacheIndexPrivate *const d_ptr;
+
+	public:
+		/**
+		 * Get the CacheIndex for the user's cache directory.
+		 * @return CacheIndex, or nullptr if the cache directory isn't accessible.
+		 */
+		static CacheIndex *instance(void);
+
+		/**
+		 * Is the cache index open?
+		 * @return True if open; false if not.
+		 */
+		bool isOpen(void) const;
+
+	public:
+		/** Settings **/
+
+		/**
+		 * Get the maximum cache size.
+		 * @return Maximum cache size, in bytes. (0 == unlimited)
+		 */
+		uint64_t maxSize(void) const;
+
+		/**
+		 * Set the maximum cache size.
+		 * If the cache is larger than the new maximum size,
+		 * files will be evicted the next time a file is added.
+		 * @param maxSize Maximum cache size, in bytes. (0 == unlimited)
+		 */
+		void setMaxSize(uint64_t maxSize);
+
+		/**
+		 * Are small files packed into pack files?
+		 * @return True if small files are packed; false if not.
+		 */
+		bool packSmallFiles(void) const;
+
+		/**
+		 * Set whether small files should be packed into pack files.
+		 * This only affects files added after this setting is changed.
+		 * @param packSmallFiles True to pack small files; false to keep them separate.
+		 */
+		void setPackSmallFiles(bool packSmallFiles);
+
+	public:
+		/** Cache entries **/
+
+		/**
+		 * Cache entry.
+		 */
+		struct Entry {
+			int64_t mtime;		// Time the file was stored in the cache or last revalidated.
+			int64_t atime;		// Time the file was last accessed. (used for LRU eviction)
+			uint32_t size;		// File size. (0 == negative cache entry)
+			uint32_t pack;		// Pack file number, or 0 for a separate file.
+			uint64_t offset;	// Offset of the file data in the pack file.
+		};
+
+		/**
+		 * Look up a cache key.
+		 * The entry's access time will be updated.
+		 * @param cacheKey	[in] Cache key. (Will be filtered using filterCacheKey().)
+		 * @param entry		[out] Cache entry.
+		 * @return 0 on success; negative POSIX error code on error. (-ENOENT if not indexed)
+		 */
+		int lookup(const std::string &cacheKey, Entry &entry);
+
+		/**
+		 * Add a file to the cache index.
+		 *
+		 * The file must already be present in the cache directory,
+		 * e.g. after it was downloaded by rp-download. If packing is
+		 * enabled and the file is small enough, it will be moved into
+		 * a pack file. If the cache is larger than the maximum size,
+		 * the least recently used files will be evicted.
+		 *
+		 * NOTE: rp-download sets the file's mtime to the server's
+		 * Last-Modified time, so the time the file was downloaded
+		 * or revalidated should be specified in mtime.
+		 *
+		 * @param cacheKey	[in] Cache key. (Will be filtered using filterCacheKey().)
+		 * @param mtime		[in,opt] Time the file was stored in the cache, or -1 to use the file's mtime.
+		 * @param pEntry	[out,opt] Cache entry.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		int add(const std::string &cacheKey, int64_t mtime = -1, Entry *pEntry = nullptr);
+
+		/**
+		 * Extract a file stored in a pack file to a separate file
+		 * in the cache directory, e.g. so rp-download can revalidate it.
+		 * The file's mtime is set to the entry's mtime.
+		 *
+		 * The index entry isn't changed. Call add() afterwards
+		 * to index the separate file.
+		 *
+		 * @param cacheKey Cache key. (Will be filtered using filterCacheKey().)
+		 * @return 0 on success (or if the file is already stored separately); negative POSIX error code on error.
+		 */
+		int extract(const std::string &cacheKey);
+
+		/**
+		 * Remove a file from the cache.
+		 * The file will be deleted if it's stored separately.
+		 * @param cacheKey Cache key. (Will be filtered using filterCacheKey().)
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		int remove(const std::string &cacheKey);
+
+		/**
+		 * Get the filename of a file stored separately in the cache.
+		 * @param cacheKey Cache key. (Will be filtered using filterCacheKey().)
+		 * @return Filename, or empty string on error.
+		 */
+		std::string filename(const std::string &cacheKey) const;
+
+		/**
+		 * Get the filename of a pack file.
+		 * @param pack Pack file number.
+		 * @return Filename, or empty string on error.
+		 */
+		std::string packFilename(uint32_t pack) const;
+
+	public:
+		/** Maintenance **/
+
+		/**
+		 * Check if a file in the cache directory belongs to the cache index,
+		 * i.e. the index file, the lock file, or a pack file.
+		 * Cache cleaners should allow these files to be deleted.
+		 * @param relpath Filename, relative to the cache directory.
+		 * @return True if the file belongs to the cache index; false if not.
+		 */
+		static bool isIndexFile(const char *relpath);
+
+		/**
+		 * Synchronize the in-memory index with the index file.
+		 * This is done automatically at most once per second.
+		 * @param force If true, always check the index file.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		int sync(bool force = false);
+
+		/**
+		 * Migration statistics.
+		 */
+		struct MigrateStats {
+			unsigned int files;	// Number of files added to the index.
+			unsigned int packed;	// Number of files moved into pack files.
+			uint64_t bytes;		// Total size of the added files.
+		};
+
+		/**
+		 * Add all files in the cache directory that aren't indexed yet.
+		 * This is used to migrate a cache created by an older version.
+		 * @param pStats [out,opt] Migration statistics.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		int migrate(MigrateStats *pStats = nullptr);
+
+		/**
+		 * Evict the least recently used files if the cache
+		 * is larger than the maximum size.
+		 * @return Number of files evicted; negative POSIX error code on error.
+		 */
+		int evict(void);
+
+		/**
+		 * Get the total size of all indexed files.
+		 * @return Total size, in bytes.
+		 */
+		uint64_t totalSize(void) const;
+
+		/**
+		 * Get the number of indexed files.
+		 * @return Number of indexed files, including negative cache entries.
+		 */
+		unsigned int count(void) const;
+};
+
+}
+
+#endif /* __ROMPROPERTIES_LIBCACHECOMMON_CACHEINDEX_HPP__ */
@@ -0,0 +1,617 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (libcachecommon/tests)             *
+ * CacheIndexTest.cpp: CacheIndex test.                                    *
+ *                                                                         *
+ * Copyright (c) 2016-2022 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+
+// libcachecommon
+#include "libcachecommon/CacheIndex.hpp"
+
+// C includes.
+#include <dirent.h>
+#include <strings.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+// C includes. (C++ namespace)
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+
+// C++ includes.
+#include <memory>
+#include <string>
+using std::string;
+using std::unique_ptr;
+
+namespace LibCacheCommon { namespace Tests {
+
+class CacheIndexTest : public ::testing::Test
+{
+	protected:
+		void SetUp(void) override
+		{
+			char dirname[] = "CacheIndexTest.XXXXXX";
+			ASSERT_TRUE(mkdtemp(dirname) != nullptr);
+			m_cacheDir = dirname;
+			m_cacheDir += "/rom-properties";
+		}
+
+		void TearDown(void) override
+		{
+			const size_t slash = m_cacheDir.rfind('/');
+			removeRecursive(m_cacheDir.substr(0, slash));
+		}
+
+		/**
+		 * Recursively remove a directory.
+		 * @param path Directory.
+		 */
+		static void removeRecursive(const string &path)
+		{
+			DIR *const dir = opendir(path.c_str());
+			if (!dir) {
+				unlink(path.c_str());
+				return;
+			}
+			struct dirent *dirent;
+			while ((dirent = readdir(dir)) != nullptr) {
+				if (!strcmp(dirent->d_name, ".") || !strcmp(dirent->d_name, ".."))
+					continue;
+				removeRecursive(path + '/' + dirent->d_name);
+			}
+			closedir(dir);
+			rmdir(path.c_str());
+		}
+
+		/**
+		 * Create a file in the cache directory.
+		 * @param key Cache key.
+		 * @param size File size.
+		 * @param fill Fill byte.
+		 * @param age If non-zero, set the file's access and modification times to this many seconds ago.
+		 */
+		void createFile(const string &key, size_t size, uint8_t fill, time_t age = 0)
+		{
+			// Create subdirectories.
+			mkdir(m_cacheDir.c_str(), 0777);
+			for (size_t pos = key.find('/'); pos != string::npos; pos = key.find('/', pos + 1)) {
+				mkdir((m_cacheDir + '/' + key.substr(0, pos)).c_str(), 0777);
+			}
+
+			const string filename = m_cacheDir + '/' + key;
+			FILE *f = fopen(filename.c_str(), "wb");
+			ASSERT_TRUE(f != nullptr);
+			unique_ptr<uint8_t[]> data(new uint8_t[size + 1]);
+			memset(data.get(), fill, size);
+			ASSERT_EQ(size, fwrite(data.get(), 1, size, f));
+			fclose(f);
+
+			if (age != 0) {
+				struct timeval tv[2];
+				tv[0].tv_sec = time(nullptr) - age;
+				tv[0].tv_usec = 0;
+				tv[1] = tv[0];
+				ASSERT_EQ(0, utimes(filename.c_str(), tv));
+			}
+		}
+
+		/**
+		 * Read a cached file's data.
+		 * @param index CacheIndex.
+		 * @param key Cache key.
+		 * @return Data, or empty string on error.
+		 */
+		static string readCachedFile(CacheIndex &index, const string &key)
+		{
+			CacheIndex::Entry entry;
+			if (index.lookup(key, entry) != 0)
+				return string();
+
+			const string filename = (entry.pack != 0)
+				? index.packFilename(entry.pack)
+				: index.filename(key);
+			FILE *f = fopen(filename.c_str(), "rb");
+			if (!f)
+				return string();
+			string data(entry.size, '\0');
+			fseek(f, static_cast<long>(entry.offset), SEEK_SET);
+			const size_t size = fread(&data[0], 1, data.size(), f);
+			fclose(f);
+			return (size == data.size() ? data : string());
+		}
+
+		/**
+		 * Does a file exist in the cache directory?
+		 * @param key Cache key.
+		 * @return True if it exists; false if not.
+		 */
+		bool fileExists(const string &key) const
+		{
+			return (access((m_cacheDir + '/' + key).c_str(), F_OK) == 0);
+		}
+
+		string m_cacheDir;
+};
+
+/**
+ * Added files should be found by lookup().
+ */
+TEST_F(CacheIndexTest, addAndLookup)
+{
+	CacheIndex index(m_cacheDir);
+	ASSERT_TRUE(index.isOpen());
+	EXPECT_EQ(0U, index.count());
+
+	CacheIndex::Entry entry;
+	EXPECT_EQ(-ENOENT, index.lookup("wii/cover/US/RSBE01.png", entry));
+	EXPECT_NE(0, index.add("wii/cover/US/RSBE01.png"));
+
+	createFile("wii/cover/US/RSBE01.png", 1000, 'a');
+	ASSERT_EQ(0, index.add("wii/cover/US/RSBE01.png"));
+	ASSERT_EQ(0, index.lookup("wii/cover/US/RSBE01.png", entry));
+	EXPECT_EQ(1000U, entry.size);
+	EXPECT_EQ(0U, entry.pack);
+	EXPECT_EQ(1U, index.count());
+	EXPECT_EQ(1000U, index.totalSize());
+	EXPECT_EQ(string(1000, 'a'), readCachedFile(index, "wii/cover/US/RSBE01.png"));
+
+	// Removing the file deletes it.
+	EXPECT_EQ(0, index.remove("wii/cover/US/RSBE01.png"));
+	EXPECT_EQ(-ENOENT, index.lookup("wii/cover/US/RSBE01.png", entry));
+	EXPECT_FALSE(fileExists("wii/cover/US/RSBE01.png"));
+	EXPECT_EQ(0U, index.count());
+	EXPECT_EQ(0U, index.totalSize());
+}
+
+/**
+ * Changes made by one CacheIndex should be visible to
+ * another CacheIndex, e.g. in a different process.
+ */
+TEST_F(CacheIndexTest, sharedIndex)
+{
+	CacheIndex index1(m_cacheDir);
+	CacheIndex index2(m_cacheDir);
+	ASSERT_TRUE(index1.isOpen());
+	ASSERT_TRUE(index2.isOpen());
+
+	createFile("ds/cover/US/ASME.png", 500, 'b');
+	ASSERT_EQ(0, index1.add("ds/cover/US/ASME.png"));
+
+	CacheIndex::Entry entry;
+	ASSERT_EQ(0, index2.sync(true));
+	ASSERT_EQ(0, index2.lookup("ds/cover/US/ASME.png", entry));
+	EXPECT_EQ(500U, entry.size);
+
+	EXPECT_EQ(0, index2.remove("ds/cover/US/ASME.png"));
+	ASSERT_EQ(0, index1.sync(true));
+	EXPECT_EQ(-ENOENT, index1.lookup("ds/cover/US/ASME.png", entry));
+
+	// A new CacheIndex should load the same state.
+	createFile("ds/cover/US/AMCE.png", 600, 'c');
+	ASSERT_EQ(0, index1.add("ds/cover/US/AMCE.png"));
+	CacheIndex index3(m_cacheDir);
+	EXPECT_EQ(1U, index3.count());
+	EXPECT_EQ(600U, index3.totalSize());
+}
+
+/**
+ * Files that were cached before the index was created
+ * should be added when the index is created.
+ */
+TEST_F(CacheIndexTest, migrateExistingCache)
+{
+	createFile("wii/cover/US/RSBE01.png", 1000, 'a', 86400);
+	createFile("wii/cover/EN/RSBP01.png", 2000, 'b', 86400);
+	createFile("gcn/disc/US/GALE01.png", 0, 0, 86400);
+
+	CacheIndex index(m_cacheDir);
+	ASSERT_TRUE(index.isOpen());
+	EXPECT_EQ(3U, index.count());
+	EXPECT_EQ(3000U, index.totalSize());
+
+	CacheIndex::Entry entry;
+	ASSERT_EQ(0, index.lookup("gcn/disc/US/GALE01.png", entry));
+	EXPECT_EQ(0U, entry.size);
+
+	// Files added by older versions after the index was created
+	// can be added using migrate().
+	createFile("ds/cover/US/ASME.png", 500, 'c', 86400);
+	CacheIndex::MigrateStats stats;
+	ASSERT_EQ(0, index.migrate(&stats));
+	EXPECT_EQ(1U, stats.files);
+	EXPECT_EQ(0U, stats.packed);
+	EXPECT_EQ(500U, stats.bytes);
+	EXPECT_EQ(4U, index.count());
+
+	// Running it again shouldn't add anything.
+	ASSERT_EQ(0, index.migrate(&stats));
+	EXPECT_EQ(0U, stats.files);
+}
+
+/**
+ * If the cache is larger than the maximum size, the least
+ * recently used files should be evicted.
+ */
+TEST_F(CacheIndexTest, lruEviction)
+{
+	// Create files with different access times.
+	// file0.png is the oldest.
+	for (unsigned int i = 0; i < 10; i++) {
+		char key[32];
+		snprintf(key, sizeof(key), "lru/file%u.png", i);
+		createFile(key, 1000, 'a' + i, 86400 * (10 - i));
+	}
+
+	CacheIndex index(m_cacheDir);
+	ASSERT_TRUE(index.isOpen());
+	EXPECT_EQ(10U, index.count());
+	EXPECT_EQ(10000U, index.totalSize());
+
+	// Access file0.png so it's the most recently used file.
+	CacheIndex::Entry entry;
+	ASSERT_EQ(0, index.lookup("lru/file0.png", entry));
+
+	// Evict files to reduce the cache to 90% of 8000 bytes.
+	index.setMaxSize(8000);
+	EXPECT_EQ(3, index.evict());
+	EXPECT_EQ(7U, index.count());
+	EXPECT_EQ(7000U, index.totalSize());
+
+	// NOTE: Not using lookup() for the remaining files,
+	// since that would update their access times.
+	EXPECT_TRUE(fileExists("lru/file0.png"));
+	for (unsigned int i = 1; i < 10; i++) {
+		char key[32];
+		snprintf(key, sizeof(key), "lru/file%u.png", i);
+		if (i <= 3) {
+			EXPECT_EQ(-ENOENT, index.lookup(key, entry)) << key;
+			EXPECT_FALSE(fileExists(key)) << key;
+		} else {
+			EXPECT_TRUE(fileExists(key)) << key;
+		}
+	}
+
+	// Adding a file evicts files automatically.
+	// The new file itself is never evicted.
+	createFile("lru/new.png", 2000, 'z');
+	ASSERT_EQ(0, index.add("lru/new.png"));
+	EXPECT_EQ(7000U, index.totalSize());
+	EXPECT_EQ(0, index.lookup("lru/new.png", entry));
+	EXPECT_EQ(-ENOENT, index.lookup("lru/file4.png", entry));
+	EXPECT_EQ(-ENOENT, index.lookup("lru/file5.png", entry));
+	EXPECT_TRUE(fileExists("lru/file6.png"));
+
+	// Other instances see the evicted files.
+	CacheIndex index2(m_cacheDir);
+	EXPECT_EQ(index.count(), index2.count());
+	EXPECT_EQ(index.totalSize(), index2.totalSize());
+}
+
+/**
+ * Small files should be moved into pack files if enabled.
+ */
+TEST_F(CacheIndexTest, packSmallFiles)
+{
+	CacheIndex index(m_cacheDir);
+	ASSERT_TRUE(index.isOpen());
+	index.setPackSmallFiles(true);
+
+	createFile("pack/small1.png", 1000, 's');
+	createFile("pack/small2.png", 3000, 't');
+	createFile("pack/large.png", 256*1024, 'L');
+	createFile("pack/missing.png", 0, 0);
+	ASSERT_EQ(0, index.add("pack/small1.png"));
+	ASSERT_EQ(0, index.add("pack/small2.png"));
+	ASSERT_EQ(0, index.add("pack/large.png"));
+	ASSERT_EQ(0, index.add("pack/missing.png"));
+
+	// Small files are in a pack file.
+	CacheIndex::Entry entry1, entry2;
+	ASSERT_EQ(0, index.lookup("pack/small1.png", entry1));
+	ASSERT_EQ(0, index.lookup("pack/small2.png", entry2));
+	EXPECT_NE(0U, entry1.pack);
+	EXPECT_EQ(entry1.pack, entry2.pack);
+	EXPECT_NE(entry1.offset, entry2.offset);
+	EXPECT_FALSE(fileExists("pack/small1.png"));
+	EXPECT_FALSE(fileExists("pack/small2.png"));
+	EXPECT_EQ(string(1000, 's'), readCachedFile(index, "pack/small1.png"));
+	EXPECT_EQ(string(3000, 't'), readCachedFile(index, "pack/small2.png"));
+
+	// Large files are stored separately.
+	CacheIndex::Entry entry;
+	ASSERT_EQ(0, index.lookup("pack/large.png", entry));
+	EXPECT_EQ(0U, entry.pack);
+	EXPECT_TRUE(fileExists("pack/large.png"));
+
+	// Negative cache entries are only stored in the index.
+	ASSERT_EQ(0, index.lookup("pack/missing.png", entry));
+	EXPECT_EQ(0U, entry.size);
+	EXPECT_FALSE(fileExists("pack/missing.png"));
+
+	// Packed files are visible to other instances.
+	CacheIndex index2(m_cacheDir);
+	EXPECT_EQ(string(3000, 't'), readCachedFile(index2, "pack/small2.png"));
+
+	// Evicting all packed files deletes the pack file.
+	// Negative cache entries aren't evicted.
+	const string packFilename = index.packFilename(entry1.pack);
+	EXPECT_EQ(0, access(packFilename.c_str(), F_OK));
+	index.setMaxSize(1);
+	EXPECT_EQ(3, index.evict());
+	EXPECT_NE(0, access(packFilename.c_str(), F_OK));
+	EXPECT_FALSE(fileExists("pack/large.png"));
+	EXPECT_EQ(0, index.lookup("pack/missing.png", entry));
+	EXPECT_EQ(1U, index.count());
+}
+
+/**
+ * The time the file was stored in the cache can be specified,
+ * since the file's mtime is the server's Last-Modified time.
+ */
+TEST_F(CacheIndexTest, storedTime)
+{
+	CacheIndex index(m_cacheDir);
+	ASSERT_TRUE(index.isOpen());
+
+	createFile("time/file1.png", 10, 'a', 86400*30);
+	createFile("time/file2.png", 10, 'b', 86400*30);
+	ASSERT_EQ(0, index.add("time/file1.png"));
+	ASSERT_EQ(0, index.add("time/file2.png", 12345678));
+
+	struct stat st;
+	ASSERT_EQ(0, stat((m_cacheDir + "/time/file1.png").c_str(), &st));
+	CacheIndex::Entry entry;
+	ASSERT_EQ(0, index.lookup("time/file1.png", entry));
+	EXPECT_EQ(static_cast<int64_t>(st.st_mtime), entry.mtime);
+	ASSERT_EQ(0, index.lookup("time/file2.png", entry));
+	EXPECT_EQ(12345678, entry.mtime);
+
+	// The stored time is visible to other instances.
+	CacheIndex index2(m_cacheDir);
+	ASSERT_EQ(0, index2.lookup("time/file2.png", entry));
+	EXPECT_EQ(12345678, entry.mtime);
+}
+
+/**
+ * Packed files can be extracted to separate files.
+ */
+TEST_F(CacheIndexTest, extract)
+{
+	CacheIndex index(m_cacheDir);
+	ASSERT_TRUE(index.isOpen());
+	index.setPackSmallFiles(true);
+
+	createFile("ext/small.png", 1000, 'e');
+	createFile("ext/missing.png", 0, 0);
+	ASSERT_EQ(0, index.add("ext/small.png", 12345678));
+	ASSERT_EQ(0, index.add("ext/missing.png"));
+	ASSERT_FALSE(fileExists("ext/small.png"));
+	EXPECT_EQ(-ENOENT, index.extract("ext/none.png"));
+
+	// Remove the directory to make sure extract() recreates it.
+	rmdir((m_cacheDir + "/ext").c_str());
+
+	ASSERT_EQ(0, index.extract("ext/small.png"));
+	ASSERT_TRUE(fileExists("ext/small.png"));
+	struct stat st;
+	ASSERT_EQ(0, stat((m_cacheDir + "/ext/small.png").c_str(), &st));
+	EXPECT_EQ(1000, st.st_size);
+	EXPECT_EQ(12345678, st.st_mtime);
+
+	// The index entry isn't changed until the file is added again.
+	CacheIndex::Entry entry;
+	ASSERT_EQ(0, index.lookup("ext/small.png", entry));
+	EXPECT_NE(0U, entry.pack);
+	index.setPackSmallFiles(false);
+	ASSERT_EQ(0, index.add("ext/small.png"));
+	ASSERT_EQ(0, index.lookup("ext/small.png", entry));
+	EXPECT_EQ(0U, entry.pack);
+	EXPECT_EQ(string(1000, 'e'), readCachedFile(index, "ext/small.png"));
+
+	// Separate files and negative cache entries are left as-is.
+	EXPECT_EQ(0, index.extract("ext/small.png"));
+	EXPECT_EQ(0, index.extract("ext/missing.png"));
+	EXPECT_FALSE(fileExists("ext/missing.png"));
+}
+
+/**
+ * Migrating an existing cache with packing enabled.
+ */
+TEST_F(CacheIndexTest, migrateWithPacking)
+{
+	// Create the index first so the files aren't
+	// migrated automatically.
+	{
+		CacheIndex index(m_cacheDir);
+		ASSERT_TRUE(index.isOpen());
+	}
+	for (unsigned int i = 0; i < 20; i++) {
+		char key[32];
+		snprintf(key, sizeof(key), "mig/%u/file.png", i);
+		createFile(key, 100 + i, 'a' + i, 86400);
+	}
+
+	CacheIndex index(m_cacheDir);
+	index.setPackSmallFiles(true);
+	CacheIndex::MigrateStats stats;
+	ASSERT_EQ(0, index.migrate(&stats));
+	EXPECT_EQ(20U, stats.files);
+	EXPECT_EQ(20U, stats.packed);
+
+	for (unsigned int i = 0; i < 20; i++) {
+		char key[32];
+		snprintf(key, sizeof(key), "mig/%u/file.png", i);
+		EXPECT_FALSE(fileExists(key)) << key;
+		EXPECT_EQ(string(100 + i, 'a' + i), readCachedFile(index, key)) << key;
+	}
+
+	// Empty directories are removed.
+	EXPECT_FALSE(fileExists("mig/0"));
+}
+
+/**
+ * The index file should be rewritten if it has too many obsolete records.
+ */
+TEST_F(CacheIndexTest, indexRewrite)
+{
+	CacheIndex index(m_cacheDir);
+	ASSERT_TRUE(index.isOpen());
+	createFile("keep.png", 10, 'k');
+	ASSERT_EQ(0, index.add("keep.png"));
+
+	for (unsigned int i = 0; i < 1000; i++) {
+		createFile("temp.png", 10, 't');
+		ASSERT_EQ(0, index.add("temp.png"));
+		ASSERT_EQ(0, index.remove("temp.png"));
+	}
+
+	struct stat st;
+	ASSERT_EQ(0, stat((m_cacheDir + "/cache.idx").c_str(), &st));
+	EXPECT_LT(st.st_size, 64*1024);
+
+	CacheIndex index2(m_cacheDir);
+	EXPECT_EQ(1U, index2.count());
+	CacheIndex::Entry entry;
+	EXPECT_EQ(0, index2.lookup("keep.png", entry));
+}
+
+/**
+ * Clearing the cache directory should reset the index.
+ */
+TEST_F(CacheIndexTest, clearCache)
+{
+	CacheIndex index(m_cacheDir);
+	ASSERT_TRUE(index.isOpen());
+	createFile("clear.png", 10, 'c');
+	ASSERT_EQ(0, index.add("clear.png"));
+	EXPECT_EQ(1U, index.count());
+
+	unlink((m_cacheDir + "/clear.png").c_str());
+	unlink((m_cacheDir + "/cache.idx").c_str());
+	ASSERT_EQ(0, index.sync(true));
+	EXPECT_EQ(0U, index.count());
+	EXPECT_TRUE(fileExists("cache.idx"));
+}
+
+/**
+ * Cache cleaners must be able to identify the cache index files.
+ */
+TEST_F(CacheIndexTest, isIndexFile)
+{
+	EXPECT_TRUE(CacheIndex::isIndexFile("cache.idx"));
+	EXPECT_TRUE(CacheIndex::isIndexFile("cache.idx.tmp.1234"));
+	EXPECT_TRUE(CacheIndex::isIndexFile("cache.lock"));
+	EXPECT_TRUE(CacheIndex::isIndexFile("packs/00000001.pak"));
+
+	EXPECT_FALSE(CacheIndex::isIndexFile("cache.idx2"));
+	EXPECT_FALSE(CacheIndex::isIndexFile("cache.lock2"));
+	EXPECT_FALSE(CacheIndex::isIndexFile("packs/1.pak"));
+	EXPECT_FALSE(CacheIndex::isIndexFile("packs/0000000a.pak"));
+	EXPECT_FALSE(CacheIndex::isIndexFile("packs/00000001.png"));
+	EXPECT_FALSE(CacheIndex::isIndexFile("gba/packs/00000001.pak"));
+	EXPECT_FALSE(CacheIndex::isIndexFile("gba/cache.idx"));
+	EXPECT_FALSE(CacheIndex::isIndexFile("file.txt"));
+	EXPECT_FALSE(CacheIndex::isIndexFile(""));
+}
+
+/**
+ * Clean the cache directory the way the KDE cache cleaner does:
+ * only images and cache index files may be deleted.
+ * @param cacheDir	[in] Cache directory.
+ * @param subdir	[in] Subdirectory, relative to the cache directory. (empty for the root)
+ * @param pUnexpected	[out] Set to true if an unexpected file was found.
+ */
+static void cleanCacheDir(const string &cacheDir, const string &subdir, bool *pUnexpected)
+{
+	DIR *const dir = opendir((cacheDir + '/' + subdir).c_str());
+	if (!dir)
+		return;
+	struct dirent *dirent;
+	while ((dirent = readdir(dir)) != nullptr) {
+		if (!strcmp(dirent->d_name, ".") || !strcmp(dirent->d_name, ".."))
+			continue;
+		const string relpath = subdir + dirent->d_name;
+		const string fullpath = cacheDir + '/' + relpath;
+		struct stat st;
+		if (lstat(fullpath.c_str(), &st) != 0)
+			continue;
+		if (S_ISDIR(st.st_mode)) {
+			cleanCacheDir(cacheDir, relpath + '/', pUnexpected);
+			rmdir(fullpath.c_str());
+			continue;
+		}
+
+		const size_t len = relpath.size();
+		if (CacheIndex::isIndexFile(relpath.c_str()) ||
+		    (len > 4 && !strcasecmp(&relpath[len-4], ".png")))
+		{
+			unlink(fullpath.c_str());
+		} else {
+			*pUnexpected = true;
+		}
+	}
+	closedir(dir);
+}
+
+/**
+ * A cache directory containing an index can be cleaned,
+ * and the index starts over afterwards.
+ */
+TEST_F(CacheIndexTest, cleanCacheWithIndex)
+{
+	CacheIndex index(m_cacheDir);
+	ASSERT_TRUE(index.isOpen());
+	index.setPackSmallFiles(true);
+
+	createFile("clean/small.png", 1000, 's');
+	createFile("clean/large.png", 256*1024, 'L');
+	createFile("clean/missing.png", 0, 0);
+	ASSERT_EQ(0, index.add("clean/small.png"));
+	ASSERT_EQ(0, index.add("clean/large.png"));
+	ASSERT_EQ(0, index.add("clean/missing.png"));
+	CacheIndex::Entry entry;
+	ASSERT_EQ(0, index.lookup("clean/small.png", entry));
+	ASSERT_NE(0U, entry.pack);
+	ASSERT_TRUE(fileExists("cache.idx"));
+	ASSERT_TRUE(fileExists("cache.lock"));
+
+	bool unexpected = false;
+	cleanCacheDir(m_cacheDir, string(), &unexpected);
+	EXPECT_FALSE(unexpected);
+	EXPECT_FALSE(fileExists("cache.idx"));
+	EXPECT_FALSE(fileExists("packs"));
+	EXPECT_FALSE(fileExists("clean"));
+
+	// The index detects that it was deleted.
+	ASSERT_EQ(0, index.sync(true));
+	EXPECT_EQ(0U, index.count());
+	EXPECT_EQ(-ENOENT, index.lookup("clean/small.png", entry));
+
+	// Files can be added again.
+	createFile("clean/small.png", 1000, 't');
+	ASSERT_EQ(0, index.add("clean/small.png"));
+	EXPECT_EQ(string(1000, 't'), readCachedFile(index, "clean/small.png"));
+}
+
+} }
+
+/**
+ * Test suite main function.
+ */
+int main(int argc, char *argv[])
+{
+	fprintf(stderr, "LibCacheCommon test suite: CacheIndex tests.\n\n");
+	fflush(nullptr);
+
+	// coverity[fun_call_w_exception]: uncaught exceptions cause nonzero exit anyway, so don't warn.
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
@@ -243,9 +243,7 @@ const rp_image *NintendoDSPrivate::loadIcon(void)
 						// V-flip
 						flipOp = static_cast<rp_image::FlipOp>(flipOp | rp_image::FLIP_V);
 					}
-					rp_image *const flipimg = img->flip(flipOp);
-					img->unref();
-					img = flipimg;
+					img->process(rp_image::PixelOps().flip(flipOp));
 				}
 				iconAnimData->frames[bmp_idx] = img;
 				arr_bmpUsed[high_token] = bmp_idx;
@@ -2,7 +2,7 @@
  * ROM Properties Page shell extension. (libromdata)                       *
  * RpTextureWrapper.hpp: librptexture file format wrapper.                 *
  *                                                                         *
- * Copyright (c) 2019-2021 by David Korth.                                 *
+ * Copyright (c) 2019-2022 by David Korth.                                 *
  * SPDX-License-Identifier: GPL-2.0-or-later                               *
  ***************************************************************************/
 
@@ -364,4 +364,32 @@ int RpTextureWrapper::loadInternalImage(ImageType imageType, const rp_image **pI
 		d->texture->image);	// func
 }
 
+/**
+ * Load an internal image, preferring a smaller version if available.
+ * Called by RomData::image() if a requested size is specified.
+ * @param imageType	[in] Image type to load.
+ * @param reqSize	[in] Requested size. (<= 0 for the full image)
+ * @param allowLowRes	[in] If true, allow a low-quality embedded thumbnail.
+ * @param pImage	[out] Pointer to const rp_image* to store the image in.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int RpTextureWrapper::loadInternalImageForSize(ImageType imageType, int reqSize, bool allowLowRes, const rp_image **pImage)
+{
+	ASSERT_loadInternalImage(imageType, pImage);
+	RP_D(RpTextureWrapper);
+	if (imageType != IMG_INT_IMAGE) {
+		*pImage = nullptr;
+		return -ENOENT;
+	} else if (!d->file) {
+		*pImage = nullptr;
+		return -EBADF;
+	} else if (!d->isValid) {
+		*pImage = nullptr;
+		return -EIO;
+	}
+
+	*pImage = d->texture->imageForSize(reqSize, allowLowRes);
+	return (*pImage != nullptr ? 0 : -EIO);
+}
+
 }
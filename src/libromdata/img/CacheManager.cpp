@@ -12,8 +12,10 @@
 
 // librpbase, librpfile, librpthreads
 #include "librpbase/TextFuncs.hpp"
+#include "librpbase/config/Config.hpp"
 #include "librpfile/RpFile.hpp"
 #include "librpfile/FileSystem.hpp"
+#include "librpfile/SubFile.hpp"
 #include "librpthreads/Semaphore.hpp"
 using namespace LibRpBase;
 using namespace LibRpFile;
@@ -22,6 +24,10 @@ using LibRpThreads::SemaphoreLocker;
 
 // libcachecommon
 #include "libcachecommon/CacheKeys.hpp"
+#ifndef _WIN32
+#  include "libcachecommon/CacheIndex.hpp"
+using LibCacheCommon::CacheIndex;
+#endif /* !_WIN32 */
 
 // OS-specific includes.
 #ifdef _WIN32
@@ -44,7 +50,13 @@ namespace LibRomData {
 // Semaphore used to limit the number of simultaneous downloads.
 // TODO: Determine the best number of simultaneous downloads.
 // TODO: Test this on XP with IEIFLAG_ASYNC.
+#ifdef _WIN32
 Semaphore CacheManager::m_dlsem(2);
+#else /* !_WIN32 */
+// Unix: Downloads are handled by a single rp-download worker process,
+// which limits the number of simultaneous connections itself.
+Semaphore CacheManager::m_dlsem(8);
+#endif /* _WIN32 */
 
 /** Proxy server functions. **/
 // NOTE: This is only useful for downloaders that
@@ -81,41 +93,97 @@ void CacheManager::setProxyUrl(const string &proxyUrl)
 	m_proxyUrl = proxyUrl;
 }
 
+#ifndef _WIN32
 /**
- * Download a file.
- *
+ * Get the cache index, with settings from the configuration.
+ * @return CacheIndex, or nullptr if the cache index isn't available.
+ */
+static CacheIndex *getCacheIndex(void)
+{
+	CacheIndex *const index = CacheIndex::instance();
+	if (index) {
+		const Config *const config = Config::instance();
+		index->setMaxSize(static_cast<uint64_t>(config->cacheMaxSize()) * 1024U * 1024U);
+		index->setPackSmallFiles(config->cachePackSmallFiles());
+	}
+	return index;
+}
+#endif /* !_WIN32 */
+
+/**
+ * Add a file that was stored in the cache to the cache index.
+ * This is done after downloading a file, and for files that
+ * were cached before the cache index was created.
  * @param cache_key Cache key.
+ * @param mtime Time the file was downloaded or revalidated, or -1 to use the file's mtime.
+ */
+static inline void addToCacheIndex(const string &cache_key, int64_t mtime = -1)
+{
+#ifndef _WIN32
+	CacheIndex *const index = getCacheIndex();
+	if (index) {
+		index->add(cache_key, mtime);
+	}
+#else /* _WIN32 */
+	// TODO: Cache index on Windows.
+	RP_UNUSED(cache_key);
+	RP_UNUSED(mtime);
+#endif /* !_WIN32 */
+}
+
+/**
+ * Cache file state.
+ */
+enum class CacheFileState {
+	Cached,		// File is cached.
+	Expired,	// File is cached, but it's older than CacheMaxAge.
+	NeedsDownload,	// File needs to be downloaded.
+	Unavailable,	// Negative cache entry, or an error occurred.
+};
+
+// Negative cache entries are retried after a week.
+// TODO: Configurable time.
+#define NEGATIVE_CACHE_EXPIRY (86400*7)
+
+/**
+ * Check the state of a cache file.
+ * Expired negative cache entries will be deleted.
  *
- * The URL will be determined based on the cache key.
- *
- * If the file is present in the cache, the cached version
- * will be retrieved. Otherwise, the file will be downloaded.
- *
- * If the file was not found on the server, or it was not found
- * the last time it was requested, an empty string will be
- * returned, and a zero-byte file will be stored in the cache.
+ * NOTE: Only indexed files can be expired. The mtime of a file
+ * that isn't indexed is the server's Last-Modified time, not
+ * the time it was downloaded.
  *
- * @return Absolute path to the cached file.
+ * @param cache_key Cache key.
+ * @param cache_filename Cache filename.
+ * @return Cache file state.
  */
-string CacheManager::download(const string &cache_key)
+static CacheFileState checkCacheFile(const string &cache_key, const string &cache_filename)
 {
-	// TODO: Only filter the cache key once.
-	// Currently it's filtered twice:
-	// - getCacheFilename() filters it
-	// - We call filterCacheKey() before passing it to rp-download.
+#ifndef _WIN32
+	// Check the cache index first.
+	CacheIndex *const index = getCacheIndex();
+	CacheIndex::Entry entry;
+	if (index && index->lookup(cache_key, entry) == 0) {
+		if (entry.size > 0) {
+			// Check if the file needs to be revalidated.
+			const int64_t maxAge = static_cast<int64_t>(Config::instance()->cacheMaxAge()) * 86400;
+			if (maxAge > 0 && (time(nullptr) - entry.mtime) >= maxAge) {
+				return CacheFileState::Expired;
+			}
+			return CacheFileState::Cached;
+		} else if ((time(nullptr) - entry.mtime) < NEGATIVE_CACHE_EXPIRY) {
+			return CacheFileState::Unavailable;
+		}
 
-	// Check the main cache key.
-	string cache_filename = LibCacheCommon::getCacheFilename(cache_key);
-	if (cache_filename.empty()) {
-		// Error obtaining the cache key filename.
-		return string();
+		// Negative cache entry is more than a week old.
+		// Delete it and try to download the file again.
+		return (index->remove(cache_key) == 0)
+			? CacheFileState::NeedsDownload
+			: CacheFileState::Unavailable;
 	}
+#endif /* !_WIN32 */
 
-	// Lock the semaphore to make sure we don't
-	// download too many files at once.
-	SemaphoreLocker locker(m_dlsem);
-
-	// Check if the file already exists.
+	// File isn't indexed. Check the file system.
 	off64_t filesize = 0;
 	time_t filemtime = 0;
 	int ret = FileSystem::get_file_size_and_mtime(cache_filename.c_str(), &filesize, &filemtime);
@@ -126,27 +194,176 @@ string CacheManager::download(const string &cache_key)
 			// File is 0 bytes, which indicates it didn't exist
 			// on the server. If the file is older than a week,
 			// try to redownload it.
-			// TODO: Configurable time.
 			const time_t systime = time(nullptr);
-			if ((systime - filemtime) < (86400*7)) {
+			if ((systime - filemtime) < NEGATIVE_CACHE_EXPIRY) {
 				// Less than a week old.
-				return string();
+				addToCacheIndex(cache_key);
+				return CacheFileState::Unavailable;
 			}
 
 			// More than a week old.
 			// Delete the cache file and try to download it again.
 			if (FileSystem::delete_file(cache_filename) != 0) {
 				// Unable to delete the cache file.
-				return string();
+				return CacheFileState::Unavailable;
 			}
 		} else if (filesize > 0) {
 			// File is larger than 0 bytes, which indicates
 			// it was cached successfully.
-			return cache_filename;
+			// NOTE: This file was cached before the cache index
+			// was created, so add it to the index now.
+			addToCacheIndex(cache_key);
+			return CacheFileState::Cached;
 		}
 	} else if (ret != -ENOENT) {
 		// Some error other than "file not found" occurred.
-		return string();
+		return CacheFileState::Unavailable;
+	}
+
+	return CacheFileState::NeedsDownload;
+}
+
+/**
+ * Open a cached file.
+ *
+ * If the file is indexed but can't be opened, e.g. if it was
+ * deleted by the user, its index entry will be removed so it
+ * can be downloaded again.
+ *
+ * @param cache_key Cache key.
+ * @param cache_filename Cache filename.
+ * @return Cached file, or nullptr on error.
+ */
+static IRpFile *openCacheFile(const string &cache_key, const string &cache_filename)
+{
+#ifndef _WIN32
+	CacheIndex *const index = getCacheIndex();
+	bool indexed = false;
+	for (int tries = 0; index && tries < 2; tries++) {
+		CacheIndex::Entry entry;
+		indexed = (index->lookup(cache_key, entry) == 0);
+		if (!indexed)
+			break;
+		if (entry.size == 0) {
+			// Negative cache entry.
+			return nullptr;
+		}
+
+		if (entry.pack == 0) {
+			// File is stored separately.
+			RpFile *const file = new RpFile(index->filename(cache_key), RpFile::FM_OPEN_READ);
+			if (file->isOpen()) {
+				return file;
+			}
+			file->unref();
+		} else {
+			// File is stored in a pack file.
+			RpFile *const packFile = new RpFile(index->packFilename(entry.pack), RpFile::FM_OPEN_READ);
+			if (packFile->isOpen()) {
+				SubFile *const file = new SubFile(packFile, entry.offset, entry.size);
+				packFile->unref();
+				return file;
+			}
+			packFile->unref();
+		}
+
+		// The file might have been packed or evicted by
+		// another process. Reload the index and try again.
+		index->sync(true);
+	}
+	if (indexed) {
+		// The index entry is stale.
+		index->remove(cache_key);
+		return nullptr;
+	}
+#else /* _WIN32 */
+	RP_UNUSED(cache_key);
+#endif /* !_WIN32 */
+
+	RpFile *const file = new RpFile(cache_filename, RpFile::FM_OPEN_READ);
+	if (!file->isOpen()) {
+		file->unref();
+		return nullptr;
+	}
+	return file;
+}
+
+/**
+ * Revalidate an expired cache file with the server.
+ * The cache index entry will be updated afterwards.
+ * @param cache_key Cache key.
+ */
+void CacheManager::revalidate(const string &cache_key)
+{
+#ifndef _WIN32
+	// rp-download can only revalidate separate files.
+	CacheIndex *const index = getCacheIndex();
+	if (index) {
+		index->extract(cache_key);
+	}
+#endif /* !_WIN32 */
+
+	// If the file wasn't modified, or if the server couldn't be
+	// reached, rp-download keeps the cached file as-is. If the file
+	// no longer exists, it's replaced with a negative cache entry.
+	// In all cases, the index entry is updated so the file won't be
+	// revalidated again until it expires.
+	execRpDownload(cache_key, true);
+	addToCacheIndex(cache_key, time(nullptr));
+}
+
+/**
+ * Download a file.
+ *
+ * @param cache_key Cache key.
+ *
+ * The URL will be determined based on the cache key.
+ *
+ * If the file is present in the cache, the cached version
+ * will be retrieved. Otherwise, the file will be downloaded.
+ *
+ * If the file was not found on the server, or it was not found
+ * the last time it was requested, nullptr will be returned,
+ * and a negative cache entry will be stored in the cache.
+ *
+ * @return Cached file (must be unref()'d), or nullptr if not available.
+ */
+IRpFile *CacheManager::download(const string &cache_key)
+{
+	// TODO: Only filter the cache key once.
+	// Currently it's filtered twice:
+	// - getCacheFilename() filters it
+	// - We call filterCacheKey() before passing it to rp-download.
+
+	// Check the main cache key.
+	const string cache_filename = LibCacheCommon::getCacheFilename(cache_key);
+	if (cache_filename.empty()) {
+		// Error obtaining the cache key filename.
+		return nullptr;
+	}
+
+	// Lock the semaphore to make sure we don't
+	// download too many files at once.
+	SemaphoreLocker locker(m_dlsem);
+
+	// Check if the file already exists.
+	switch (checkCacheFile(cache_key, cache_filename)) {
+		case CacheFileState::Expired:
+			revalidate(cache_key);
+			// fall-through
+		case CacheFileState::Cached: {
+			IRpFile *const file = openCacheFile(cache_key, cache_filename);
+			if (file || checkCacheFile(cache_key, cache_filename) != CacheFileState::NeedsDownload) {
+				return file;
+			}
+			// The cached file is missing, and its index entry
+			// was removed. Download it again.
+			break;
+		}
+		case CacheFileState::NeedsDownload:
+			break;
+		default:
+			return nullptr;
 	}
 
 	// TODO: Add an option for "offline only".
@@ -161,36 +378,148 @@ string CacheManager::download(const string &cache_key)
 	// NOTE: Using the unfiltered cache key, since filtering it
 	// results in slashes being changed to backslashes on Windows.
 	// rp-download will filter the key itself.
-	ret = execRpDownload(cache_key);
+	int ret = execRpDownload(cache_key);
+	// NOTE: If the file wasn't found, rp-download stored a
+	// negative cache entry, which should also be indexed.
+	addToCacheIndex(cache_key, time(nullptr));
 	if (ret != 0) {
 		// rp-download failed for some reason.
-		return string();
+		return nullptr;
+	}
+
+	// rp-download has successfully downloaded the file.
+	return openCacheFile(cache_key, cache_filename);
+}
+
+/**
+ * Download the first available file from a list of cache keys.
+ *
+ * The cache keys are in priority order, e.g. region fallbacks.
+ * Cache keys that aren't already cached are downloaded concurrently
+ * if supported by the system. The highest-priority cache key that
+ * was downloaded successfully is returned, and lower-priority
+ * downloads are canceled.
+ *
+ * @param cache_keys	[in] Cache keys, in priority order.
+ * @param pIndex	[out,opt] Index of the cache key that was used.
+ * @return Cached file (must be unref()'d), or nullptr if none are available.
+ */
+IRpFile *CacheManager::downloadFirst(const std::vector<string> &cache_keys, int *pIndex)
+{
+	if (pIndex) {
+		*pIndex = -1;
+	}
+
+	// Lock the semaphore to make sure we don't
+	// download too many files at once.
+	SemaphoreLocker locker(m_dlsem);
+
+	// Check the cache first. Only cache keys with a higher priority
+	// than the first cached file need to be downloaded.
+	std::vector<string> cache_filenames;
+	std::vector<string> dl_keys;
+	std::vector<int> dl_indexes;
+	int fallback = -1;	// Cached file to use if the downloads fail.
+	bool fallbackExpired = false;
+	cache_filenames.reserve(cache_keys.size());
+	for (size_t i = 0; i < cache_keys.size(); i++) {
+		cache_filenames.push_back(LibCacheCommon::getCacheFilename(cache_keys[i]));
+		const string &cache_filename = cache_filenames.back();
+		if (cache_filename.empty()) {
+			// Error obtaining the cache key filename.
+			continue;
+		}
+
+		const CacheFileState state = checkCacheFile(cache_keys[i], cache_filename);
+		if (state == CacheFileState::NeedsDownload) {
+			// NOTE: Using the unfiltered cache key, since filtering it
+			// results in slashes being changed to backslashes on Windows.
+			// rp-download will filter the key itself.
+			dl_keys.push_back(cache_keys[i]);
+			dl_indexes.push_back(static_cast<int>(i));
+		} else if (state == CacheFileState::Cached || state == CacheFileState::Expired) {
+			if (dl_keys.empty()) {
+				// No higher-priority files need to be downloaded.
+				if (state == CacheFileState::Expired) {
+					revalidate(cache_keys[i]);
+				}
+				IRpFile *const file = openCacheFile(cache_keys[i], cache_filename);
+				if (file) {
+					if (pIndex) {
+						*pIndex = static_cast<int>(i);
+					}
+					return file;
+				} else if (checkCacheFile(cache_keys[i], cache_filename) == CacheFileState::NeedsDownload) {
+					// The cached file is missing, and its index entry
+					// was removed. Download it again.
+					dl_keys.push_back(cache_keys[i]);
+					dl_indexes.push_back(static_cast<int>(i));
+					continue;
+				}
+				return nullptr;
+			}
+			// Use this file if the downloads fail.
+			fallback = static_cast<int>(i);
+			fallbackExpired = (state == CacheFileState::Expired);
+			break;
+		}
+	}
+
+	int idx = fallback;
+	if (!dl_keys.empty()) {
+		// Execute rp-download.
+		const int ret = execRpDownloadFirst(dl_keys);
+		if (ret >= 0 && ret < static_cast<int>(dl_indexes.size())) {
+			idx = dl_indexes[ret];
+		}
+
+		// Index the downloaded file, as well as negative cache
+		// entries for higher-priority files that weren't found.
+		const size_t dl_count = (ret >= 0 ? static_cast<size_t>(ret) + 1 : dl_keys.size());
+		const time_t now = time(nullptr);
+		for (size_t i = 0; i < dl_count && i < dl_keys.size(); i++) {
+			addToCacheIndex(dl_keys[i], now);
+		}
+	}
+	if (idx < 0) {
+		// Nothing could be downloaded.
+		return nullptr;
+	} else if (idx == fallback && fallbackExpired) {
+		// Using the expired fallback file.
+		revalidate(cache_keys[idx]);
 	}
 
 	// rp-download has successfully downloaded the file.
-	return cache_filename;
+	if (pIndex) {
+		*pIndex = idx;
+	}
+	return openCacheFile(cache_keys[idx], cache_filenames[idx]);
 }
 
 /**
  * Check if a file has already been cached.
  * @param cache_key Cache key.
- * @return Filename in the cache, or empty string if not found.
+ * @return Cached file (must be unref()'d), or nullptr if not found.
  */
-string CacheManager::findInCache(const string &cache_key)
+IRpFile *CacheManager::findInCache(const string &cache_key)
 {
 	// Get the cache key filename.
-	string cache_filename = LibCacheCommon::getCacheFilename(cache_key);
+	const string cache_filename = LibCacheCommon::getCacheFilename(cache_key);
 	if (cache_filename.empty()) {
 		// Error obtaining the cache key filename.
-		return string();
+		return nullptr;
 	}
 
-	// Return the filename if the file exists.
-	if (FileSystem::access(cache_filename, R_OK) != 0) {
-		// Unable to read the cache file.
-		cache_filename.clear();
+	// NOTE: Expired files aren't revalidated here.
+	switch (checkCacheFile(cache_key, cache_filename)) {
+		case CacheFileState::Cached:
+		case CacheFileState::Expired:
+			break;
+		default:
+			// File isn't cached.
+			return nullptr;
 	}
-	return cache_filename;
+	return openCacheFile(cache_key, cache_filename);
 }
 
 }
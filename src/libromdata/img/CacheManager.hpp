@@ -11,13 +11,17 @@
 
 #include "common.h"
 
-// librpthreads
+// librpfile, librpthreads
+namespace LibRpFile {
+	class IRpFile;
+}
 namespace LibRpThreads {
 	class Semaphore;
 }
 
 // C++ includes.
 #include <string>
+#include <vector>
 
 namespace LibRomData {
 
@@ -25,7 +29,7 @@ class CacheManager
 {
 	public:
 		CacheManager() { }
-		~CacheManager() { }
+		virtual ~CacheManager() { }
 
 	private:
 		RP_DISABLE_COPY(CacheManager)
@@ -65,27 +69,61 @@ class CacheManager
 		 * will be retrieved. Otherwise, the file will be downloaded.
 		 *
 		 * If the file was not found on the server, or it was not found
-		 * the last time it was requested, an empty string will be
-		 * returned, and a zero-byte file will be stored in the cache.
+		 * the last time it was requested, nullptr will be returned,
+		 * and a negative cache entry will be stored in the cache.
 		 *
-		 * @return Absolute path to the cached file.
+		 * @return Cached file (must be unref()'d), or nullptr if not available.
 		 */
-		std::string download(const std::string &cache_key);
+		LibRpFile::IRpFile *download(const std::string &cache_key);
+
+		/**
+		 * Download the first available file from a list of cache keys.
+		 *
+		 * The cache keys are in priority order, e.g. region fallbacks.
+		 * Cache keys that aren't already cached are downloaded concurrently
+		 * if supported by the system. The highest-priority cache key that
+		 * was downloaded successfully is returned, and lower-priority
+		 * downloads are canceled.
+		 *
+		 * @param cache_keys	[in] Cache keys, in priority order.
+		 * @param pIndex	[out,opt] Index of the cache key that was used.
+		 * @return Cached file (must be unref()'d), or nullptr if none are available.
+		 */
+		LibRpFile::IRpFile *downloadFirst(const std::vector<std::string> &cache_keys, int *pIndex = nullptr);
 
 		/**
 		 * Check if a file has already been cached.
 		 * @param cache_key Cache key.
-		 * @return Filename in the cache, or empty string if not found.
+		 * @return Cached file (must be unref()'d), or nullptr if not found.
 		 */
-		std::string findInCache(const std::string &cache_key);
+		LibRpFile::IRpFile *findInCache(const std::string &cache_key);
 
 	protected:
 		/**
 		 * Execute rp-download.
+		 * NOTE: Virtual so the tests can replace rp-download.
 		 * @param filtered_cache_key Filtered cache key.
+		 * @param force If true, revalidate the file even if it's cached.
 		 * @return 0 on success; negative POSIX error code on error.
 		 */
-		int execRpDownload(const std::string &filtered_cache_key);
+		virtual int execRpDownload(const std::string &filtered_cache_key, bool force = false);
+
+		/**
+		 * Execute rp-download for multiple cache keys.
+		 * The first cache key that was successfully downloaded, in priority order,
+		 * will be returned. Lower-priority downloads will be canceled.
+		 * @param filtered_cache_keys Filtered cache keys, in priority order.
+		 * @return Index of the downloaded cache key; negative POSIX error code on error.
+		 */
+		virtual int execRpDownloadFirst(const std::vector<std::string> &filtered_cache_keys);
+
+	private:
+		/**
+		 * Revalidate an expired cache file with the server.
+		 * The cache index entry will be updated afterwards.
+		 * @param cache_key Cache key.
+		 */
+		void revalidate(const std::string &cache_key);
 
 	protected:
 		std::string m_proxyUrl;
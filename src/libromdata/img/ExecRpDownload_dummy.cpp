@@ -18,12 +18,23 @@ namespace LibRomData {
 /**
  * Execute rp-download. (Dummy version)
  * @param filteredCacheKey Filtered cache key.
+ * @param force If true, revalidate the file even if it's cached.
  * @return 0 on success; negative POSIX error code on error.
  */
-int CacheManager::execRpDownload(const string &filteredCacheKey)
+int CacheManager::execRpDownload(const string &filteredCacheKey, bool force)
 {
 #warning CacheManager::execRpDownload() is not implemented!
 	return -ENOSYS;
 }
 
+/**
+ * Execute rp-download for multiple cache keys. (Dummy version)
+ * @param filteredCacheKeys Filtered cache keys, in priority order.
+ * @return Index of the downloaded cache key; negative POSIX error code on error.
+ */
+int CacheManager::execRpDownloadFirst(const std::vector<string> &filteredCacheKeys)
+{
+	return -ENOSYS;
+}
+
 }
@@ -2,144 +2,78 @@
  * ROM Properties Page shell extension. (libromdata)                       *
  * ExecRpDownload_posix.cpp: Execute rp-download.exe. (POSIX)              *
  *                                                                         *
- * Copyright (c) 2016-2020 by David Korth.                                 *
+ * Copyright (c) 2016-2022 by David Korth.                                 *
  * SPDX-License-Identifier: GPL-2.0-or-later                               *
  ***************************************************************************/
 
 #include "stdafx.h"
-#include "config.libromdata.h"
 #include "CacheManager.hpp"
+#include "RpDownloadWorker.hpp"
+
+// librpthreads
+#include "librpthreads/Semaphore.hpp"
+using LibRpThreads::Semaphore;
+using LibRpThreads::SemaphoreLocker;
 
 // OS-specific includes.
 #include <signal.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <unistd.h>
-#ifdef HAVE_POSIX_SPAWN
-# include <spawn.h>
-#endif /* HAVE_POSIX_SPAWN */
+
+// C includes. (C++ namespace)
+#include <ctime>
 
 // C++ includes.
 #include <string>
+#include <vector>
 using std::string;
+using std::vector;
 
 namespace LibRomData {
 
 /**
- * Execute rp-download. (POSIX version)
+ * Get the rp-download worker.
+ * @return rp-download worker.
+ */
+static RpDownloadWorker &rpDownloadWorker(void)
+{
+	static RpDownloadWorker worker;
+	return worker;
+}
+
+// Semaphore used to limit the number of simultaneous
+// rp-download processes if the worker is unavailable.
+static Semaphore spawn_sem(2);
+
+/**
+ * Run rp-download for a single cache key.
+ * This is used if the worker is unavailable.
  * @param filteredCacheKey Filtered cache key.
+ * @param proxyUrl Proxy URL, or empty string to use the environment's proxy settings.
+ * @param force If true, revalidate the file even if it's cached.
  * @return 0 on success; negative POSIX error code on error.
  */
-int CacheManager::execRpDownload(const string &filteredCacheKey)
+static int execRpDownloadSingle(const string &filteredCacheKey, const string &proxyUrl, bool force = false)
 {
-	// TODO: Mac OS X path. (bundle?)
- 	static const char rp_download_exe[] = DIR_INSTALL_LIBEXEC "/rp-download";
+	SemaphoreLocker locker(spawn_sem);
 
 	// Parameters.
-	const char *const argv[3] = {
-		rp_download_exe,
-		filteredCacheKey.c_str(),
-		nullptr
-	};
-
-	// Define a minimal environment for cURL.
-	// This will include http_proxy and https_proxy if the proxy URL is set.
-	// TODO: Separate proxies for http and https?
-	// TODO: Only build this once?
-	int pos[5] = {-1, -1, -1, -1, -1};
-	int count = 0;
-	std::string s_env;
-	s_env.reserve(1024);
-
-	// We want the HOME and USER variables.
-	// If our proxy wasn't set, also get http_proxy and https_proxy
-	// if they're set in the environment.
-	const char *envtmp = getenv("HOME");
-	if (envtmp && envtmp[0] != '\0') {
-		pos[count++] = static_cast<int>(s_env.size());
-		s_env += "HOME=";
-		s_env += envtmp;
-		s_env += '\0';
-	}
-	envtmp = getenv("USER");
-	if (envtmp && envtmp[0] != '\0') {
-		pos[count++] = static_cast<int>(s_env.size());
-		s_env += "USER=";
-		s_env += envtmp;
-		s_env += '\0';
-	}
-	if (m_proxyUrl.empty()) {
-		// Proxy URL is empty. Get the URLs from the environment.
-		envtmp = getenv("http_proxy");
-		if (envtmp && envtmp[0] != '\0') {
-			pos[count++] = static_cast<int>(s_env.size());
-			s_env += "http_proxy=";
-			s_env += envtmp;
-			s_env += '\0';
-		}
-		envtmp = getenv("https_proxy");
-		if (envtmp && envtmp[0] != '\0') {
-			pos[count++] = static_cast<int>(s_env.size());
-			s_env += "https_proxy=";
-			s_env += envtmp;
-			s_env += '\0';
-		}
-	} else {
-		// Proxy URL is set. Use it.
-		pos[count++] = static_cast<int>(s_env.size());
-		s_env += "http_proxy=" + m_proxyUrl;
-		pos[count++] = static_cast<int>(s_env.size());
-		s_env += "https_proxy=" + m_proxyUrl;
-	}
-
-	// Build envp.
-	const char *envp[5] = {nullptr, nullptr, nullptr, nullptr, nullptr};
-	unsigned int envp_idx = 0;
-	for (unsigned int i = 0; i < 5; i++) {
-		if (pos[i] >= 0) {
-			envp[envp_idx++] = &s_env[pos[i]];
-		}
+	const char *argv[4];
+	unsigned int argc = 0;
+	argv[argc++] = RpDownloadWorker::defaultExe();
+	if (force) {
+		argv[argc++] = "-f";
 	}
+	argv[argc++] = filteredCacheKey.c_str();
+	argv[argc] = nullptr;
 
-	// TODO: Maybe we should close file handles...
-#ifdef HAVE_POSIX_SPAWN
-	// posix_spawn()
-	errno = 0;
-	pid_t pid;
-	int ret = posix_spawn(&pid, rp_download_exe,
-		nullptr,	// file_actions
-		nullptr,	// attrp
-		(char *const *)argv, (char *const *)envp);
+	pid_t pid = -1;
+	int ret = RpDownloadWorker::spawn(argv, proxyUrl, -1, &pid);
 	if (ret != 0) {
 		// Error creating the child process.
-		int err = errno;
-		if (err == 0) {
-			err = EIO;
-		}
-		return -err;
+		return ret;
 	}
-#else /* !HAVE_POSIX_SPAWN */
-	// fork()/execve().
-	errno = 0;
-	pid_t pid = fork();
-	if (pid == 0) {
-		// Child process.
-		int ret = execve(rp_download_exe, (char *const *)argv, (char *const *)envp);
-		if (ret != 0) {
-			// execve() failed.
-			exit(EXIT_FAILURE);
-		}
-		assert(!"Shouldn't get here...");
-		exit(EXIT_FAILURE);
-	} else if (pid == -1) {
-		// fork() failed.
-		int err = errno;
-		if (err == 0) {
-			err = EIO;
-		}
-		return -err;
-	}
-#endif /* HAVE_POSIX_SPAWN */
 
 	// Parent process.
 	// Wait up to 10 seconds for the process to exit.
@@ -192,4 +126,82 @@ int CacheManager::execRpDownload(const string &filteredCacheKey)
 	return 0;
 }
 
+/**
+ * Execute rp-download. (POSIX version)
+ * @param filteredCacheKey Filtered cache key.
+ * @param force If true, revalidate the file even if it's cached.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int CacheManager::execRpDownload(const string &filteredCacheKey, bool force)
+{
+	// Use the persistent worker process if possible.
+	int ret = rpDownloadWorker().download(filteredCacheKey, m_proxyUrl, force);
+	if (ret == 0) {
+		// rp-download has successfully downloaded the file.
+		return 0;
+	} else if (ret != -ECHILD) {
+		// rp-download failed for some reason.
+		return (ret < 0 ? ret : -EIO);
+	}
+
+	// Worker is unavailable. Run rp-download for this cache key only.
+	return execRpDownloadSingle(filteredCacheKey, m_proxyUrl, force);
+}
+
+/**
+ * Execute rp-download for multiple cache keys concurrently. (POSIX version)
+ * The first cache key that was successfully downloaded, in priority order,
+ * will be returned. Lower-priority downloads will be canceled.
+ * @param filteredCacheKeys Filtered cache keys, in priority order.
+ * @return Index of the downloaded cache key; negative POSIX error code on error.
+ */
+int CacheManager::execRpDownloadFirst(const vector<string> &filteredCacheKeys)
+{
+	RpDownloadWorker &worker = rpDownloadWorker();
+	const size_t count = filteredCacheKeys.size();
+	vector<RpDownloadWorker::Ticket> tickets(count);
+
+	// Submit all of the requests so they're downloaded concurrently.
+	size_t submitted = 0;
+	for (; submitted < count; submitted++) {
+		if (worker.submit(filteredCacheKeys[submitted], m_proxyUrl, &tickets[submitted]) != 0)
+			break;
+	}
+
+	// NOTE: The worker has a 10-second timeout per download,
+	// but requests may be queued behind other downloads.
+	const time_t deadline = time(nullptr) + 30;
+	for (size_t i = 0; i < count; i++) {
+		int ret;
+		if (i < submitted) {
+			ret = worker.wait(tickets[i], deadline);
+		} else {
+			// Worker is unavailable. Run rp-download for this cache key only.
+			ret = execRpDownloadSingle(filteredCacheKeys[i], m_proxyUrl);
+		}
+		if (ret == -ECHILD && i < submitted) {
+			// Worker exited before responding.
+			ret = execRpDownloadSingle(filteredCacheKeys[i], m_proxyUrl);
+		}
+
+		if (ret == 0) {
+			// Downloaded. Cancel the lower-priority requests.
+			for (size_t j = i + 1; j < submitted; j++) {
+				worker.cancel(tickets[j]);
+			}
+			return static_cast<int>(i);
+		} else if (ret == -ETIMEDOUT) {
+			// Timed out. The remaining requests will time out, too,
+			// so cancel all of them instead of leaving them pending.
+			for (size_t j = i; j < submitted; j++) {
+				worker.cancel(tickets[j]);
+			}
+			break;
+		}
+	}
+
+	// None of the cache keys could be downloaded.
+	return -ENOENT;
+}
+
 }
@@ -31,9 +31,10 @@ namespace LibRomData {
 /**
  * Execute rp-download. (Win32 version)
  * @param filteredCacheKey Filtered cache key.
+ * @param force If true, revalidate the file even if it's cached.
  * @return 0 on success; negative POSIX error code on error.
  */
-int CacheManager::execRpDownload(const string &filteredCacheKey)
+int CacheManager::execRpDownload(const string &filteredCacheKey, bool force)
 {
 	// The executable should be located in the DLL directory.
 	tstring rp_download_exe = dll_filename;
@@ -52,10 +53,10 @@ int CacheManager::execRpDownload(const string &filteredCacheKey)
 	// needs to be quoted properly.
 	tstring t_filteredCacheKey = U82T_s(filteredCacheKey);
 	tstring t_cmd_line;
-	t_cmd_line.reserve(rp_download_exe.size() + 5 + t_filteredCacheKey.size());
+	t_cmd_line.reserve(rp_download_exe.size() + 8 + t_filteredCacheKey.size());
 	t_cmd_line += _T('"');
 	t_cmd_line += rp_download_exe;
-	t_cmd_line += _T("\" \"");
+	t_cmd_line += (force ? _T("\" -f \"") : _T("\" \""));
 	t_cmd_line += t_filteredCacheKey;
 	t_cmd_line += _T('"');
 
@@ -135,4 +136,28 @@ int CacheManager::execRpDownload(const string &filteredCacheKey)
 	return 0;
 }
 
+/**
+ * Execute rp-download for multiple cache keys. (Win32 version)
+ * The first cache key that was successfully downloaded, in priority order,
+ * will be returned.
+ *
+ * NOTE: The cache keys are downloaded sequentially, since
+ * each download requires a separate rp-download process.
+ *
+ * @param filteredCacheKeys Filtered cache keys, in priority order.
+ * @return Index of the downloaded cache key; negative POSIX error code on error.
+ */
+int CacheManager::execRpDownloadFirst(const std::vector<string> &filteredCacheKeys)
+{
+	const int count = static_cast<int>(filteredCacheKeys.size());
+	for (int i = 0; i < count; i++) {
+		if (execRpDownload(filteredCacheKeys[i]) == 0) {
+			return i;
+		}
+	}
+
+	// None of the cache keys could be downloaded.
+	return -ENOENT;
+}
+
 }
@@ -0,0 +1,595 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (libromdata)                       *
+ * RpDownloadWorker.cpp: Persistent rp-download worker process. (POSIX)    *
+ *                                                                         *
+ * Copyright (c) 2016-2022 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "stdafx.h"
+#include "config.libromdata.h"
+#include "RpDownloadWorker.hpp"
+
+// librpthreads
+using LibRpThreads::MutexLocker;
+
+// OS-specific includes.
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#ifdef HAVE_POSIX_SPAWN
+# include <spawn.h>
+#endif /* HAVE_POSIX_SPAWN */
+
+#ifndef MSG_NOSIGNAL
+// Mac OS X: SO_NOSIGPIPE is set on the socket instead.
+#  define MSG_NOSIGNAL 0
+#endif /* !MSG_NOSIGNAL */
+
+// C++ STL classes.
+using std::string;
+using std::vector;
+
+namespace LibRomData {
+
+// TODO: Mac OS X path. (bundle?)
+static const char rp_download_exe[] = DIR_INSTALL_LIBEXEC "/rp-download";
+
+/**
+ * Automatic locker/unlocker for a pthread mutex.
+ * LibRpThreads::Mutex can't be used with a condition variable.
+ */
+class PthreadMutexLocker
+{
+	public:
+		explicit PthreadMutexLocker(pthread_mutex_t &mutex)
+			: m_mutex(mutex)
+		{
+			pthread_mutex_lock(&m_mutex);
+		}
+
+		~PthreadMutexLocker()
+		{
+			pthread_mutex_unlock(&m_mutex);
+		}
+
+	private:
+		RP_DISABLE_COPY(PthreadMutexLocker)
+
+	private:
+		pthread_mutex_t &m_mutex;
+};
+
+/**
+ * Build a minimal environment for rp-download.
+ * This will include http_proxy and https_proxy if the proxy URL is set.
+ * @param proxyUrl	[in] Proxy URL, or empty string to use the environment's proxy settings.
+ * @param s_env		[out] Environment string buffer.
+ * @param envp		[out] Environment pointers. (NULL-terminated; points into s_env)
+ */
+static void buildRpDownloadEnv(const string &proxyUrl, string &s_env, const char *envp[5])
+{
+	// TODO: Separate proxies for http and https?
+	int pos[4] = {-1, -1, -1, -1};
+	int count = 0;
+	s_env.clear();
+	s_env.reserve(1024);
+
+	// We want the HOME and USER variables.
+	// If our proxy wasn't set, also get http_proxy and https_proxy
+	// if they're set in the environment.
+	const char *envtmp = getenv("HOME");
+	if (envtmp && envtmp[0] != '\0') {
+		pos[count++] = static_cast<int>(s_env.size());
+		s_env += "HOME=";
+		s_env += envtmp;
+		s_env += '\0';
+	}
+	envtmp = getenv("USER");
+	if (envtmp && envtmp[0] != '\0') {
+		pos[count++] = static_cast<int>(s_env.size());
+		s_env += "USER=";
+		s_env += envtmp;
+		s_env += '\0';
+	}
+	if (proxyUrl.empty()) {
+		// Proxy URL is empty. Get the URLs from the environment.
+		envtmp = getenv("http_proxy");
+		if (envtmp && envtmp[0] != '\0') {
+			pos[count++] = static_cast<int>(s_env.size());
+			s_env += "http_proxy=";
+			s_env += envtmp;
+			s_env += '\0';
+		}
+		envtmp = getenv("https_proxy");
+		if (envtmp && envtmp[0] != '\0') {
+			pos[count++] = static_cast<int>(s_env.size());
+			s_env += "https_proxy=";
+			s_env += envtmp;
+			s_env += '\0';
+		}
+	} else {
+		// Proxy URL is set. Use it.
+		pos[count++] = static_cast<int>(s_env.size());
+		s_env += "http_proxy=" + proxyUrl;
+		s_env += '\0';
+		pos[count++] = static_cast<int>(s_env.size());
+		s_env += "https_proxy=" + proxyUrl;
+		s_env += '\0';
+	}
+
+	// Build envp.
+	unsigned int envp_idx = 0;
+	for (unsigned int i = 0; i < 4; i++) {
+		if (pos[i] >= 0) {
+			envp[envp_idx++] = &s_env[pos[i]];
+		}
+	}
+	for (; envp_idx < 5; envp_idx++) {
+		envp[envp_idx] = nullptr;
+	}
+}
+
+/**
+ * Create an rp-download worker.
+ * The worker process isn't started until the first request.
+ * @param exe	[in,opt] rp-download executable, or nullptr for the installed rp-download.
+ * @param args	[in,opt] Additional arguments for rp-download -w, or nullptr for none. (NULL-terminated)
+ */
+RpDownloadWorker::RpDownloadWorker(const char *exe, const char *const *args)
+	: m_exe(exe ? exe : rp_download_exe)
+	, m_pid(-1)
+	, m_fd(-1)
+	, m_dead(false)
+	, m_reading(false)
+	, m_generation(0)
+	, m_nextId(1)
+{
+	if (args) {
+		for (; *args != nullptr; args++) {
+			m_args.emplace_back(*args);
+		}
+	}
+
+	pthread_mutex_init(&m_rmutex, nullptr);
+	pthread_cond_init(&m_rcond, nullptr);
+}
+
+RpDownloadWorker::~RpDownloadWorker()
+{
+	// Closing the socket tells the worker to exit
+	// once its pending downloads are finished.
+	{
+		MutexLocker wlocker(m_wmutex);
+		PthreadMutexLocker rlocker(m_rmutex);
+		stop(false);
+	}
+
+	pthread_cond_destroy(&m_rcond);
+	pthread_mutex_destroy(&m_rmutex);
+}
+
+/**
+ * Get the installed rp-download executable.
+ * @return Installed rp-download executable.
+ */
+const char *RpDownloadWorker::defaultExe(void)
+{
+	return rp_download_exe;
+}
+
+/**
+ * Spawn rp-download.
+ * @param argv		[in] Arguments. (NULL-terminated; argv[0] is the executable)
+ * @param proxyUrl	[in] Proxy URL, or empty string to use the environment's proxy settings.
+ * @param stdio_fd	[in] If not -1, file descriptor to use as the child's stdin and stdout.
+ * @param pPid		[out] Child process ID.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int RpDownloadWorker::spawn(const char *const *argv, const string &proxyUrl, int stdio_fd, pid_t *pPid)
+{
+	// Define a minimal environment for cURL.
+	// TODO: Only build this once?
+	string s_env;
+	const char *envp[5];
+	buildRpDownloadEnv(proxyUrl, s_env, envp);
+
+	// NOTE: stdio_fd may have FD_CLOEXEC set. dup2() clears
+	// FD_CLOEXEC on the new file descriptor.
+	// TODO: Maybe we should close file handles...
+#ifdef HAVE_POSIX_SPAWN
+	// posix_spawn()
+	posix_spawn_file_actions_t file_actions;
+	posix_spawn_file_actions_t *p_file_actions = nullptr;
+	if (stdio_fd >= 0) {
+		posix_spawn_file_actions_init(&file_actions);
+		posix_spawn_file_actions_adddup2(&file_actions, stdio_fd, STDIN_FILENO);
+		posix_spawn_file_actions_adddup2(&file_actions, stdio_fd, STDOUT_FILENO);
+		p_file_actions = &file_actions;
+	}
+
+	int ret = posix_spawn(pPid, argv[0],
+		p_file_actions,	// file_actions
+		nullptr,	// attrp
+		(char *const *)argv, (char *const *)envp);
+	if (p_file_actions) {
+		posix_spawn_file_actions_destroy(p_file_actions);
+	}
+	if (ret != 0) {
+		// Error creating the child process.
+		// NOTE: posix_spawn() returns the error code directly.
+		return (ret > 0 ? -ret : -EIO);
+	}
+#else /* !HAVE_POSIX_SPAWN */
+	// fork()/execve().
+	errno = 0;
+	pid_t pid = fork();
+	if (pid == 0) {
+		// Child process.
+		if (stdio_fd >= 0) {
+			if (dup2(stdio_fd, STDIN_FILENO) < 0 ||
+			    dup2(stdio_fd, STDOUT_FILENO) < 0)
+			{
+				// dup2() failed.
+				_exit(EXIT_FAILURE);
+			}
+		}
+		int ret = execve(argv[0], (char *const *)argv, (char *const *)envp);
+		if (ret != 0) {
+			// execve() failed.
+			_exit(EXIT_FAILURE);
+		}
+		assert(!"Shouldn't get here...");
+		_exit(EXIT_FAILURE);
+	} else if (pid == -1) {
+		// fork() failed.
+		int err = errno;
+		if (err == 0) {
+			err = EIO;
+		}
+		return -err;
+	}
+	*pPid = pid;
+#endif /* HAVE_POSIX_SPAWN */
+
+	return 0;
+}
+
+/**
+ * Start the worker process.
+ * Both mutexes must be locked by the caller.
+ * @param proxyUrl Proxy URL, or empty string to use the environment's proxy settings.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int RpDownloadWorker::start(const string &proxyUrl)
+{
+	assert(m_fd < 0);
+	assert(!m_reading);
+
+	// A socketpair is used instead of pipes so we can use
+	// MSG_NOSIGNAL to prevent SIGPIPE if the worker exits.
+	// Don't let other child processes inherit the socket.
+	int sv[2];
+#ifdef SOCK_CLOEXEC
+	if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sv) != 0) {
+		const int err = errno;
+		return (err != 0 ? -err : -EIO);
+	}
+#else /* !SOCK_CLOEXEC */
+	// NOTE: Another thread may fork() before FD_CLOEXEC is set.
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0) {
+		const int err = errno;
+		return (err != 0 ? -err : -EIO);
+	}
+	fcntl(sv[0], F_SETFD, FD_CLOEXEC);
+	fcntl(sv[1], F_SETFD, FD_CLOEXEC);
+#endif /* SOCK_CLOEXEC */
+#ifdef SO_NOSIGPIPE
+	static const int one = 1;
+	setsockopt(sv[0], SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif /* SO_NOSIGPIPE */
+
+	// Arguments: exe -w [args...]
+	vector<const char*> argv;
+	argv.reserve(m_args.size() + 3);
+	argv.push_back(m_exe.c_str());
+	argv.push_back("-w");
+	for (const string &arg : m_args) {
+		argv.push_back(arg.c_str());
+	}
+	argv.push_back(nullptr);
+
+	pid_t pid = -1;
+	int ret = spawn(argv.data(), proxyUrl, sv[1], &pid);
+	close(sv[1]);
+	if (ret != 0) {
+		close(sv[0]);
+		return ret;
+	}
+
+	m_pid = pid;
+	m_fd = sv[0];
+	m_proxyUrl = proxyUrl;
+	m_dead = false;
+	m_generation++;
+	m_linebuf.clear();
+	m_results.clear();
+	m_canceled.clear();
+	return 0;
+}
+
+/**
+ * Stop the worker process.
+ * Both mutexes must be locked by the caller.
+ * @param wait If true, wait for the worker to exit.
+ */
+void RpDownloadWorker::stop(bool wait)
+{
+	// Don't close the socket while another thread is reading from it.
+	while (m_reading) {
+		pthread_cond_wait(&m_rcond, &m_rmutex);
+	}
+
+	if (m_fd >= 0) {
+		close(m_fd);
+		m_fd = -1;
+	}
+	if (m_pid > 0) {
+		// The worker will exit once it sees EOF on stdin.
+		if (waitpid(m_pid, nullptr, WNOHANG) == 0 && wait) {
+			// Still running. Don't wait for pending downloads.
+			kill(m_pid, SIGTERM);
+			waitpid(m_pid, nullptr, 0);
+		}
+		m_pid = -1;
+	}
+	m_dead = true;
+
+	// Wake up any threads waiting for responses.
+	pthread_cond_broadcast(&m_rcond);
+}
+
+/**
+ * Send a line to the worker process.
+ * m_wmutex must be locked by the caller.
+ * @param line Line, including the trailing newline.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int RpDownloadWorker::sendLine(const string &line)
+{
+	const char *p = line.data();
+	size_t len = line.size();
+	while (len > 0) {
+		ssize_t sz = send(m_fd, p, len, MSG_NOSIGNAL);
+		if (sz < 0) {
+			const int err = errno;
+			if (err == EINTR)
+				continue;
+			return (err != 0 ? -err : -EIO);
+		}
+		p += sz;
+		len -= sz;
+	}
+	return 0;
+}
+
+/**
+ * Read responses from the worker process.
+ * m_rmutex must be locked by the caller. It will be unlocked
+ * while waiting for data, and other threads will be woken up
+ * using m_rcond once the responses have been processed.
+ * @param timeout_ms Maximum time to wait, in milliseconds.
+ */
+void RpDownloadWorker::readResponses(int timeout_ms)
+{
+	assert(!m_reading);
+	assert(m_fd >= 0);
+
+	// NOTE: stop() won't close m_fd while m_reading is set,
+	// so it's safe to use it without holding m_rmutex.
+	const int fd = m_fd;
+	m_reading = true;
+	pthread_mutex_unlock(&m_rmutex);
+
+	char buf[1024];
+	ssize_t sz = -1;
+	int err = EAGAIN;
+
+	struct pollfd pfd;
+	pfd.fd = fd;
+	pfd.events = POLLIN;
+	pfd.revents = 0;
+	if (poll(&pfd, 1, timeout_ms) > 0) {
+		sz = recv(fd, buf, sizeof(buf), MSG_DONTWAIT);
+		err = (sz < 0 ? errno : 0);
+	}
+
+	pthread_mutex_lock(&m_rmutex);
+	m_reading = false;
+
+	if (sz == 0 || (sz < 0 && err != EAGAIN && err != EINTR)) {
+		// Worker has exited.
+		m_dead = true;
+	} else if (sz > 0) {
+		m_linebuf.append(buf, sz);
+
+		// Process complete lines: "<id> <status>"
+		size_t nl_pos;
+		while ((nl_pos = m_linebuf.find('\n')) != string::npos) {
+			const string line = m_linebuf.substr(0, nl_pos);
+			m_linebuf.erase(0, nl_pos + 1);
+
+			char *endptr = nullptr;
+			const unsigned long id = strtoul(line.c_str(), &endptr, 10);
+			if (!endptr || *endptr != ' ')
+				continue;
+			const long status = strtol(endptr + 1, nullptr, 10);
+			auto iter = m_canceled.find(static_cast<unsigned int>(id));
+			if (iter != m_canceled.end()) {
+				// Request was canceled. Discard the response.
+				m_canceled.erase(iter);
+				continue;
+			}
+			m_results[static_cast<unsigned int>(id)] = static_cast<int>(status);
+		}
+	}
+
+	// Let the other threads check for their responses.
+	// One of them will take over reading if necessary.
+	pthread_cond_broadcast(&m_rcond);
+}
+
+/**
+ * Submit a download request to the worker.
+ * @param cache_key	[in] Cache key.
+ * @param proxyUrl	[in] Proxy URL, or empty string to use the environment's proxy settings.
+ * @param pTicket	[out] Request ticket, for use with wait() and cancel().
+ * @param force		[in,opt] If true, revalidate the file even if it's cached.
+ * @return 0 on success; -ECHILD if the worker is unavailable; other negative POSIX error code on error.
+ */
+int RpDownloadWorker::submit(const string &cache_key, const string &proxyUrl, Ticket *pTicket, bool force)
+{
+	// Requests are newline-delimited.
+	if (cache_key.empty() || cache_key.find_first_of("\r\n") != string::npos) {
+		return -EINVAL;
+	}
+
+	MutexLocker wlocker(m_wmutex);
+
+	// Try twice: if the worker exited due to its idle timeout,
+	// sending the request will fail, so restart it.
+	for (unsigned int attempt = 0; attempt < 2; attempt++) {
+		{
+			PthreadMutexLocker rlocker(m_rmutex);
+			if (m_fd < 0 || m_dead || m_proxyUrl != proxyUrl) {
+				// (Re-)start the worker.
+				stop(true);
+				if (start(proxyUrl) != 0) {
+					return -ECHILD;
+				}
+			}
+			pTicket->generation = m_generation;
+		}
+
+		pTicket->id = m_nextId++;
+		char s_id[16];
+		snprintf(s_id, sizeof(s_id), (force ? "%u -f " : "%u "), pTicket->id);
+		if (sendLine(s_id + cache_key + '\n') == 0) {
+			return 0;
+		}
+
+		// Worker has exited.
+		PthreadMutexLocker rlocker(m_rmutex);
+		m_dead = true;
+	}
+
+	return -ECHILD;
+}
+
+/**
+ * Wait for a download request to finish.
+ * If this returns -ETIMEDOUT, the request is still pending,
+ * and should be canceled using cancel().
+ * @param ticket Request ticket from submit().
+ * @param deadline Time to give up waiting.
+ * @return 0 on success; -ECHILD if the worker exited; other negative POSIX error code or positive HTTP status code on error.
+ */
+int RpDownloadWorker::wait(const Ticket &ticket, time_t deadline)
+{
+	PthreadMutexLocker rlocker(m_rmutex);
+	for (;;) {
+		auto iter = m_results.find(ticket.id);
+		if (iter != m_results.end() && m_generation == ticket.generation) {
+			const int status = iter->second;
+			m_results.erase(iter);
+			return status;
+		}
+
+		if (m_dead || m_generation != ticket.generation) {
+			// Worker exited before responding.
+			return -ECHILD;
+		} else if (time(nullptr) >= deadline) {
+			return -ETIMEDOUT;
+		}
+
+		if (!m_reading) {
+			// No other thread is reading. Read the responses.
+			// m_rmutex is unlocked while waiting for data.
+			readResponses(100);
+		} else {
+			// Another thread is reading. Wait for it to finish,
+			// with a short timeout in case the deadline passes.
+			struct timeval tv;
+			gettimeofday(&tv, nullptr);
+			struct timespec ts;
+			ts.tv_sec = tv.tv_sec;
+			ts.tv_nsec = (tv.tv_usec + 100*1000) * 1000;
+			if (ts.tv_nsec >= 1000*1000*1000) {
+				ts.tv_sec++;
+				ts.tv_nsec -= 1000*1000*1000;
+			}
+			pthread_cond_timedwait(&m_rcond, &m_rmutex, &ts);
+		}
+	}
+}
+
+/**
+ * Cancel a download request.
+ * The request's result will be discarded.
+ * @param ticket Request ticket from submit().
+ */
+void RpDownloadWorker::cancel(const Ticket &ticket)
+{
+	MutexLocker wlocker(m_wmutex);
+	{
+		PthreadMutexLocker rlocker(m_rmutex);
+		if (m_dead || m_generation != ticket.generation) {
+			// Worker has exited. Nothing to cancel.
+			return;
+		}
+
+		auto iter = m_results.find(ticket.id);
+		if (iter != m_results.end()) {
+			// Request already finished.
+			m_results.erase(iter);
+			return;
+		}
+		m_canceled.insert(ticket.id);
+	}
+
+	char buf[16];
+	snprintf(buf, sizeof(buf), "!%u\n", ticket.id);
+	sendLine(buf);
+}
+
+/**
+ * Download a file using the worker.
+ * @param cache_key Cache key.
+ * @param proxyUrl Proxy URL, or empty string to use the environment's proxy settings.
+ * @param force If true, revalidate the file even if it's cached.
+ * @return 0 on success; -ECHILD if the worker is unavailable; other negative POSIX error code or positive HTTP status code on error.
+ */
+int RpDownloadWorker::download(const string &cache_key, const string &proxyUrl, bool force)
+{
+	Ticket ticket;
+	int ret = submit(cache_key, proxyUrl, &ticket, force);
+	if (ret != 0) {
+		return ret;
+	}
+
+	// NOTE: The worker has a 10-second timeout per download,
+	// but requests may be queued behind other downloads.
+	// TODO: User-configurable timeout?
+	ret = wait(ticket, time(nullptr) + 30);
+	if (ret == -ETIMEDOUT) {
+		// Don't leave the request pending in the worker.
+		cancel(ticket);
+	}
+	return ret;
+}
+
+}
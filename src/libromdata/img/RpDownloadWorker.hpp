@@ -0,0 +1,184 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (libromdata)                       *
+ * RpDownloadWorker.hpp: Persistent rp-download worker process. (POSIX)    *
+ *                                                                         *
+ * Copyright (c) 2016-2022 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#ifndef __ROMPROPERTIES_LIBROMDATA_IMG_RPDOWNLOADWORKER_HPP__
+#define __ROMPROPERTIES_LIBROMDATA_IMG_RPDOWNLOADWORKER_HPP__
+
+#include "common.h"
+
+// librpthreads
+#include "librpthreads/Mutex.hpp"
+
+// C includes.
+#include <pthread.h>
+#include <sys/types.h>
+
+// C includes. (C++ namespace)
+#include <ctime>
+
+// C++ includes.
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace LibRomData {
+
+/**
+ * Persistent rp-download worker process. (rp-download -w)
+ *
+ * Requests from all threads are sent to a single worker,
+ * which reuses connections and downloads multiple files
+ * concurrently. The worker is started on the first request
+ * and restarted if it exits, e.g. due to its idle timeout.
+ */
+class RpDownloadWorker
+{
+	public:
+		/**
+		 * Create an rp-download worker.
+		 * The worker process isn't started until the first request.
+		 * @param exe	[in,opt] rp-download executable, or nullptr for the installed rp-download.
+		 * @param args	[in,opt] Additional arguments for rp-download -w, or nullptr for none. (NULL-terminated)
+		 */
+		explicit RpDownloadWorker(const char *exe = nullptr, const char *const *args = nullptr);
+
+		~RpDownloadWorker();
+
+	private:
+		RP_DISABLE_COPY(RpDownloadWorker)
+
+	public:
+		/**
+		 * Get the installed rp-download executable.
+		 * @return Installed rp-download executable.
+		 */
+		static const char *defaultExe(void);
+
+		/**
+		 * Spawn rp-download.
+		 * @param argv		[in] Arguments. (NULL-terminated; argv[0] is the executable)
+		 * @param proxyUrl	[in] Proxy URL, or empty string to use the environment's proxy settings.
+		 * @param stdio_fd	[in] If not -1, file descriptor to use as the child's stdin and stdout.
+		 * @param pPid		[out] Child process ID.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		static int spawn(const char *const *argv, const std::string &proxyUrl, int stdio_fd, pid_t *pPid);
+
+	public:
+		/**
+		 * Request ticket. Returned by submit().
+		 */
+		struct Ticket {
+			unsigned int id;
+			unsigned int generation;
+		};
+
+		/**
+		 * Submit a download request to the worker.
+		 * @param cache_key	[in] Cache key.
+		 * @param proxyUrl	[in] Proxy URL, or empty string to use the environment's proxy settings.
+		 * @param pTicket	[out] Request ticket, for use with wait() and cancel().
+		 * @param force		[in,opt] If true, revalidate the file even if it's cached.
+		 * @return 0 on success; -ECHILD if the worker is unavailable; other negative POSIX error code on error.
+		 */
+		int submit(const std::string &cache_key, const std::string &proxyUrl, Ticket *pTicket, bool force = false);
+
+		/**
+		 * Wait for a download request to finish.
+		 * If this returns -ETIMEDOUT, the request is still pending,
+		 * and should be canceled using cancel().
+		 * @param ticket Request ticket from submit().
+		 * @param deadline Time to give up waiting.
+		 * @return 0 on success; -ECHILD if the worker exited; other negative POSIX error code or positive HTTP status code on error.
+		 */
+		int wait(const Ticket &ticket, time_t deadline);
+
+		/**
+		 * Cancel a download request.
+		 * The request's result will be discarded.
+		 * @param ticket Request ticket from submit().
+		 */
+		void cancel(const Ticket &ticket);
+
+		/**
+		 * Download a file using the worker.
+		 * @param cache_key Cache key.
+		 * @param proxyUrl Proxy URL, or empty string to use the environment's proxy settings.
+		 * @param force If true, revalidate the file even if it's cached.
+		 * @return 0 on success; -ECHILD if the worker is unavailable; other negative POSIX error code or positive HTTP status code on error.
+		 */
+		int download(const std::string &cache_key, const std::string &proxyUrl, bool force = false);
+
+	private:
+		/**
+		 * Start the worker process.
+		 * Both mutexes must be locked by the caller.
+		 * @param proxyUrl Proxy URL, or empty string to use the environment's proxy settings.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		int start(const std::string &proxyUrl);
+
+		/**
+		 * Stop the worker process.
+		 * Both mutexes must be locked by the caller.
+		 * @param wait If true, wait for the worker to exit.
+		 */
+		void stop(bool wait);
+
+		/**
+		 * Send a line to the worker process.
+		 * m_wmutex must be locked by the caller.
+		 * @param line Line, including the trailing newline.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		int sendLine(const std::string &line);
+
+		/**
+		 * Read responses from the worker process.
+		 * m_rmutex must be locked by the caller. It will be unlocked
+		 * while waiting for data, and other threads will be woken up
+		 * using m_rcond once the responses have been processed.
+		 * @param timeout_ms Maximum time to wait, in milliseconds.
+		 */
+		void readResponses(int timeout_ms);
+
+	private:
+		// rp-download executable and additional arguments.
+		std::string m_exe;
+		std::vector<std::string> m_args;
+
+		// Worker process. (Locked by both mutexes.)
+		pid_t m_pid;
+		int m_fd;
+		std::string m_proxyUrl;
+
+		// m_wmutex: Sending requests. (Lock this first.)
+		// m_rmutex: Reading responses. m_rcond is signaled when
+		// responses have been read or the reader is finished.
+		// NOTE: m_rmutex is a pthread mutex so it can be used
+		// with a condition variable.
+		LibRpThreads::Mutex m_wmutex;
+		pthread_mutex_t m_rmutex;
+		pthread_cond_t m_rcond;
+
+		bool m_dead;			// Worker exited. (m_rmutex)
+		bool m_reading;			// A thread is reading from m_fd. (m_rmutex)
+		unsigned int m_generation;	// Incremented when the worker is restarted. (m_rmutex)
+		unsigned int m_nextId;		// Next request ID. (m_wmutex)
+
+		// Responses that haven't been retrieved yet. (m_rmutex)
+		std::map<unsigned int, int> m_results;
+		// Canceled requests. Responses for these are discarded. (m_rmutex)
+		std::set<unsigned int> m_canceled;
+		std::string m_linebuf;
+};
+
+}
+
+#endif /* __ROMPROPERTIES_LIBROMDATA_IMG_RPDOWNLOADWORKER_HPP__ */
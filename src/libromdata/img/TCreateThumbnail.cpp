@@ -2,7 +2,7 @@
  * ROM Properties Page shell extension. (libromdata)                       *
  * TCreateThumbnail.cpp: Thumbnail creator template.                       *
  *                                                                         *
- * Copyright (c) 2016-2020 by David Korth.                                 *
+ * Copyright (c) 2016-2022 by David Korth.                                 *
  * SPDX-License-Identifier: GPL-2.0-or-later                               *
  ***************************************************************************/
 
@@ -35,8 +35,11 @@ using LibRpTexture::rp_image;
 #include <cstring>
 
 // C++ includes.
+#include <algorithm>
 #include <memory>
+#include <vector>
 using std::unique_ptr;
+using std::vector;
 
 namespace LibRomData {
 
@@ -52,37 +55,32 @@ TCreateThumbnail<ImgClass>::~TCreateThumbnail()
  * Get an internal image.
  * @param romData	[in] RomData object.
  * @param imageType	[in] Image type.
+ * @param req_size	[in] Requested image size. (<= 0 for the full image)
+ * @param allowLowRes	[in] If true, allow a low-quality embedded thumbnail.
  * @param pOutSize	[out,opt] Pointer to ImgSize to store the image's size.
  * @param sBIT		[out,opt] sBIT metadata.
+ * @param pOrigSize	[out,opt] Pointer to ImgSize to store the original image's size, before downscaling.
  * @return Internal image, or null ImgClass on error.
  */
 template<typename ImgClass>
 ImgClass TCreateThumbnail<ImgClass>::getInternalImage(
 	const RomData *romData,
 	RomData::ImageType imageType,
+	int req_size, bool allowLowRes,
 	ImgSize *pOutSize,
-	rp_image::sBIT_t *sBIT)
+	rp_image::sBIT_t *sBIT,
+	ImgSize *pOrigSize)
 {
-	assert(imageType >= RomData::IMG_INT_MIN && imageType <= RomData::IMG_INT_MAX);
-	if (imageType < RomData::IMG_INT_MIN || imageType > RomData::IMG_INT_MAX) {
-		// Out of range.
-		if (sBIT) {
-			memset(sBIT, 0, sizeof(*sBIT));
-		}
-		return getNullImgClass();
-	}
-
-	const rp_image *image = romData->image(imageType);
+	const rp_image *const image = getInternalRpImage(romData, imageType,
+		req_size, allowLowRes, sBIT, pOrigSize);
 	if (!image) {
 		// No image.
-		if (sBIT) {
-			memset(sBIT, 0, sizeof(*sBIT));
-		}
 		return getNullImgClass();
 	}
 
 	// Convert the rp_image to ImgClass.
 	ImgClass ret_img = rpImageToImgClass(image);
+	image->unref();
 	if (isImgClassValid(ret_img)) {
 		// Image converted successfully.
 		if (pOutSize) {
@@ -93,16 +91,68 @@ ImgClass TCreateThumbnail<ImgClass>::getInternalImage(
 			// TODO: Check for errors?
 			getImgClassSize(ret_img, pOutSize);
 		}
+	} else if (sBIT) {
+		memset(sBIT, 0, sizeof(*sBIT));
+	}
+	return ret_img;
+}
+
+/**
+ * Get an internal image as an rp_image.
+ * @param romData	[in] RomData object.
+ * @param imageType	[in] Image type.
+ * @param req_size	[in] Requested image size. (<= 0 for the full image)
+ * @param allowLowRes	[in] If true, allow a low-quality embedded thumbnail.
+ * @param sBIT		[out,opt] sBIT metadata.
+ * @param pOrigSize	[out,opt] Pointer to ImgSize to store the original image's size, before downscaling.
+ * @return Internal image (caller must unref), or nullptr on error.
+ */
+template<typename ImgClass>
+const rp_image *TCreateThumbnail<ImgClass>::getInternalRpImage(
+	const RomData *romData,
+	RomData::ImageType imageType,
+	int req_size, bool allowLowRes,
+	rp_image::sBIT_t *sBIT,
+	ImgSize *pOrigSize)
+{
+	assert(imageType >= RomData::IMG_INT_MIN && imageType <= RomData::IMG_INT_MAX);
+	if (imageType < RomData::IMG_INT_MIN || imageType > RomData::IMG_INT_MAX) {
+		// Out of range.
+		if (sBIT) {
+			memset(sBIT, 0, sizeof(*sBIT));
+		}
+		return nullptr;
+	}
+
+	// NOTE: If req_size is specified, textures with mipmaps will
+	// only decode the smallest mipmap that's still >= req_size.
+	const rp_image *image = romData->image(imageType, req_size, allowLowRes);
+	if (!image) {
+		// No image.
 		if (sBIT) {
-			// Get the sBIT metadata.
-			if (image->get_sBIT(sBIT) != 0) {
-				// No sBIT metadata.
-				// Clear the struct.
-				memset(sBIT, 0, sizeof(*sBIT));
-			}
+			memset(sBIT, 0, sizeof(*sBIT));
 		}
+		return nullptr;
 	}
-	return ret_img;
+
+	if (pOrigSize) {
+		pOrigSize->width = image->width();
+		pOrigSize->height = image->height();
+	}
+	if (sBIT) {
+		// Get the sBIT metadata.
+		if (image->get_sBIT(sBIT) != 0) {
+			// No sBIT metadata.
+			// Clear the struct.
+			memset(sBIT, 0, sizeof(*sBIT));
+		}
+	}
+
+	// Downscale the image if it's larger than req_size.
+	// NOTE: The RomData object owns the original image,
+	// so take a reference if it isn't downscaled.
+	const rp_image *const scaled_img = downscaleForReqSize(image, req_size, romData->imgpf(imageType));
+	return (scaled_img ? scaled_img : image->ref());
 }
 
 /**
@@ -112,13 +162,53 @@ ImgClass TCreateThumbnail<ImgClass>::getInternalImage(
  * @param req_size	[in] Requested image size.
  * @param pOutSize	[out,opt] Pointer to ImgSize to store the image's size.
  * @param sBIT		[out,opt] sBIT metadata.
+ * @param pOrigSize	[out,opt] Pointer to ImgSize to store the original image's size, before downscaling.
  * @return External image, or null ImgClass on error.
  */
 template<typename ImgClass>
 ImgClass TCreateThumbnail<ImgClass>::getExternalImage(
 	const RomData *romData, RomData::ImageType imageType,
 	int req_size, ImgSize *pOutSize,
-	rp_image::sBIT_t *sBIT)
+	rp_image::sBIT_t *sBIT,
+	ImgSize *pOrigSize)
+{
+	const rp_image *const image = getExternalRpImage(romData, imageType,
+		req_size, sBIT, pOrigSize);
+	if (!image) {
+		// No image.
+		return getNullImgClass();
+	}
+
+	// Convert the rp_image to ImgClass.
+	ImgClass ret_img = rpImageToImgClass(image);
+	if (isImgClassValid(ret_img)) {
+		// Image converted successfully.
+		if (pOutSize) {
+			// Get the image size.
+			pOutSize->width = image->width();
+			pOutSize->height = image->height();
+		}
+	} else if (sBIT) {
+		memset(sBIT, 0, sizeof(*sBIT));
+	}
+	image->unref();
+	return ret_img;
+}
+
+/**
+ * Get an external image as an rp_image.
+ * @param romData	[in] RomData object.
+ * @param imageType	[in] Image type.
+ * @param req_size	[in] Requested image size.
+ * @param sBIT		[out,opt] sBIT metadata.
+ * @param pOrigSize	[out,opt] Pointer to ImgSize to store the original image's size, before downscaling.
+ * @return External image (caller must unref), or nullptr on error.
+ */
+template<typename ImgClass>
+const rp_image *TCreateThumbnail<ImgClass>::getExternalRpImage(
+	const RomData *romData, RomData::ImageType imageType,
+	int req_size, rp_image::sBIT_t *sBIT,
+	ImgSize *pOrigSize)
 {
 	assert(imageType >= RomData::IMG_EXT_MIN && imageType <= RomData::IMG_EXT_MAX);
 	if (imageType < RomData::IMG_EXT_MIN || imageType > RomData::IMG_EXT_MAX) {
@@ -126,7 +216,7 @@ ImgClass TCreateThumbnail<ImgClass>::getExternalImage(
 		if (sBIT) {
 			memset(sBIT, 0, sizeof(*sBIT));
 		}
-		return getNullImgClass();
+		return nullptr;
 	}
 
 	// Synchronously download from the source URLs.
@@ -138,7 +228,7 @@ ImgClass TCreateThumbnail<ImgClass>::getExternalImage(
 		if (sBIT) {
 			memset(sBIT, 0, sizeof(*sBIT));
 		}
-		return getNullImgClass();
+		return nullptr;
 	}
 
 	// NOTE: This will force a configuration timestamp check.
@@ -146,63 +236,97 @@ ImgClass TCreateThumbnail<ImgClass>::getExternalImage(
 	const bool extImgDownloadEnabled = config->extImgDownloadEnabled();
 	const bool downloadHighResScans = config->downloadHighResScans();
 
-	CacheManager cache;
-	const auto extURLs_cend = extURLs.cend();
-	for (auto iter = extURLs.cbegin(); iter != extURLs_cend; ++iter) {
-		const RomData::ExtURL &extURL = *iter;
-		std::string proxy = proxyForUrl(extURL.url);
-		cache.setProxyUrl(!proxy.empty() ? proxy.c_str() : nullptr);
-
-		// Should we attempt to download the image,
-		// or just use the local cache?
-		// TODO: Verify that this works correctly.
-		bool download = extImgDownloadEnabled;
+	// Large images (e.g. high-resolution scans) can be decoded
+	// at a reduced size if the image format supports it.
+	// Images that will be rescaled to a specific size by
+	// getThumbnail() need to be decoded at their original size.
+	const uint32_t imgpf = romData->imgpf(imageType);
+	const int targetSize = (imgpf & (RomData::IMGPF_RESCALE_ASPECT_8to7 | RomData::IMGPF_RESCALE_RFT_DIMENSIONS_2))
+		? 0 : req_size;
+
+	// Should we attempt to download the image,
+	// or just use the local cache?
+	// TODO: Verify that this works correctly.
+	auto canDownload = [extImgDownloadEnabled, downloadHighResScans](const RomData::ExtURL &extURL) -> bool {
 		if (!downloadHighResScans && extURL.high_res) {
 			// Don't download high-resolution images, but
 			// use them if they've already been downloaded.
-			download = false;
+			return false;
 		}
+		return extImgDownloadEnabled;
+	};
 
-		// TODO: Have download() return the actual data and/or load the cached file.
-		std::string cache_filename;
-		if (download) {
+	CacheManager cache;
+	const size_t extURLs_count = extURLs.size();
+	for (size_t i = 0; i < extURLs_count; ) {
+		const RomData::ExtURL &extURL = extURLs[i];
+		std::string proxy = proxyForUrl(extURL.url);
+		cache.setProxyUrl(!proxy.empty() ? proxy.c_str() : nullptr);
+
+		IRpFile *cache_file;
+		if (canDownload(extURL)) {
 			// Attempt to download the image if it isn't already
 			// present in the rom-properties cache.
-			cache_filename = cache.download(extURL.cache_key);
+			// Consecutive URLs that can be downloaded, e.g. region
+			// fallbacks, are requested concurrently, and the
+			// highest-priority image that's available is used.
+			// NOTE: All URLs in a batch must use the same proxy.
+			std::vector<std::string> cache_keys;
+			cache_keys.push_back(extURL.cache_key);
+			size_t j = i + 1;
+			for (; j < extURLs_count && canDownload(extURLs[j]); j++) {
+				if (proxyForUrl(extURLs[j].url) != proxy)
+					break;
+				cache_keys.push_back(extURLs[j].cache_key);
+			}
+
+			int index = -1;
+			cache_file = cache.downloadFirst(cache_keys, &index);
+			// If this image can't be loaded, continue with
+			// the next lower-priority URL.
+			i = (index >= 0 ? i + index + 1 : j);
 		} else {
 			// Don't attempt to download the image.
 			// Only check the rom-properties cache.
-			cache_filename = cache.findInCache(extURL.cache_key);
+			cache_file = cache.findInCache(extURL.cache_key);
+			i++;
 		}
-		if (cache_filename.empty())
+		if (!cache_file)
 			continue;
 
 		// Attempt to load the image.
-		unique_RefBase<RpFile> file(new RpFile(cache_filename, RpFile::FM_OPEN_READ));
+		// NOTE: The cached file might be stored in a pack file.
+		unique_RefBase<IRpFile> file(cache_file);
 		if (file->isOpen()) {
-			rp_image *const dl_img = RpImageLoader::load(file.get());
+			int origWidth = 0, origHeight = 0;
+			rp_image *const dl_img = RpImageLoader::load(file.get(), targetSize, &origWidth, &origHeight);
 			if (dl_img && dl_img->isValid()) {
 				// Image loaded successfully.
 				file->close();
-				ImgClass ret_img = rpImageToImgClass(dl_img);
-				if (isImgClassValid(ret_img)) {
-					// Image converted successfully.
-					if (pOutSize) {
-						// Get the image size.
-						pOutSize->width = dl_img->width();
-						pOutSize->height = dl_img->height();
-					}
-					// Get the sBIT metadata.
-					if (sBIT) {
-						if (dl_img->get_sBIT(sBIT) != 0) {
-							// No sBIT metadata.
-							// Clear the struct.
-							memset(sBIT, 0, sizeof(*sBIT));
-						}
+
+				if (pOrigSize) {
+					// Get the original image size.
+					// NOTE: dl_img may have been decoded at a reduced size.
+					pOrigSize->width = origWidth;
+					pOrigSize->height = origHeight;
+				}
+				// Get the sBIT metadata.
+				if (sBIT) {
+					if (dl_img->get_sBIT(sBIT) != 0) {
+						// No sBIT metadata.
+						// Clear the struct.
+						memset(sBIT, 0, sizeof(*sBIT));
 					}
-					// TODO: Transparency processing?
-					return ret_img;
 				}
+				// TODO: Transparency processing?
+
+				// Downscale the image if it's larger than req_size.
+				rp_image *const scaled_img = downscaleForReqSize(dl_img, req_size, imgpf);
+				if (scaled_img) {
+					dl_img->unref();
+					return scaled_img;
+				}
+				return dl_img;
 			}
 			UNREF(dl_img);
 		}
@@ -212,7 +336,7 @@ ImgClass TCreateThumbnail<ImgClass>::getExternalImage(
 	if (sBIT) {
 		memset(sBIT, 0, sizeof(*sBIT));
 	}
-	return getNullImgClass();
+	return nullptr;
 }
 
 /**
@@ -243,6 +367,44 @@ inline void TCreateThumbnail<ImgClass>::rescale_aspect(ImgSize &rs_size, const I
 	}
 }
 
+/**
+ * Downscale an rp_image if it's larger than the requested size.
+ * This is done before converting to ImgClass, so all frontends
+ * use the same high-quality downscaler.
+ * @param image		[in] rp_image
+ * @param req_size	[in] Requested image size. (<= 0 for the full image)
+ * @param imgpf		[in] Image processing flags.
+ * @return Downscaled rp_image (caller must unref), or nullptr if no downscaling is needed.
+ */
+template<typename ImgClass>
+rp_image *TCreateThumbnail<ImgClass>::downscaleForReqSize(const rp_image *image, int req_size, uint32_t imgpf)
+{
+	if (req_size <= 0 ||
+	    (image->width() <= req_size && image->height() <= req_size))
+	{
+		// Image is already small enough.
+		return nullptr;
+	}
+
+	// Images that will be rescaled to a specific size by
+	// getThumbnail() need to be left at their original size.
+	if (imgpf & (RomData::IMGPF_RESCALE_ASPECT_8to7 | RomData::IMGPF_RESCALE_RFT_DIMENSIONS_2)) {
+		return nullptr;
+	}
+
+	ImgSize sz = {image->width(), image->height()};
+	const ImgSize tgt_size = {req_size, req_size};
+	rescale_aspect(sz, tgt_size);
+	if (sz.width <= 0) {
+		sz.width = 1;
+	}
+	if (sz.height <= 0) {
+		sz.height = 1;
+	}
+
+	return image->scaled(sz.width, sz.height, rp_image::ScaleFilter::Box);
+}
+
 /**
  * Create a thumbnail for the specified ROM file.
  * @param romData	[in] RomData object
@@ -269,8 +431,35 @@ int TCreateThumbnail<ImgClass>::getThumbnail(const RomData *romData, int reqSize
 	memset(&pOutParams->sBIT, 0, sizeof(pOutParams->sBIT));
 	pOutParams->retImg = getNullImgClass();
 
+	ThumbSource_t src;
+	int ret = getThumbnailSource(romData, reqSize, &src);
+	if (ret != RPCT_SUCCESS) {
+		return ret;
+	}
+
+	ret = processThumbnail(romData, src, reqSize, pOutParams);
+	src.img->unref();
+	return ret;
+}
+
+/**
+ * Select and retrieve the thumbnail source image for the specified ROM file.
+ * @param romData	[in] RomData object
+ * @param reqSize	[in] Requested image size (single dimension; assuming square image)
+ * @param pSrc		[out] Thumbnail source image (If an error occurs, pSrc->img will be nullptr)
+ * @return 0 on success; non-zero on error.
+ */
+template<typename ImgClass>
+int TCreateThumbnail<ImgClass>::getThumbnailSource(const RomData *romData, int reqSize, ThumbSource_t *pSrc)
+{
+	pSrc->img = nullptr;
+	pSrc->origSize.width = 0;
+	pSrc->origSize.height = 0;
+	memset(&pSrc->sBIT, 0, sizeof(pSrc->sBIT));
+	pSrc->imgpf = 0;
+	pSrc->isInternal = false;
+
 	uint32_t imgbf = romData->supportedImageTypes();
-	uint32_t imgpf = 0;
 
 	// Get the image priority.
 	const Config *const config = Config::instance();
@@ -293,18 +482,22 @@ int TCreateThumbnail<ImgClass>::getThumbnail(const RomData *romData, int reqSize
 			return RPCT_SOURCE_FILE_ERROR;
 	}
 
-	if (config->useIntIconForSmallSizes() && reqSize <= 48) {
+	// If this is a small size, allow low-quality embedded thumbnails.
+	// TODO: Define "small sizes" somewhere. (DPI independence?)
+	const bool isSmallSize = (config->useIntIconForSmallSizes() && reqSize <= 48);
+
+	if (isSmallSize) {
 		// Check for an icon first.
-		// TODO: Define "small sizes" somewhere. (DPI independence?)
 		if (imgbf & RomData::IMGBF_INT_ICON) {
-			pOutParams->retImg = getInternalImage(romData, RomData::IMG_INT_ICON, &pOutParams->fullSize, &pOutParams->sBIT);
-			imgpf = romData->imgpf(RomData::IMG_INT_ICON);
+			pSrc->img = getInternalRpImage(romData, RomData::IMG_INT_ICON,
+				reqSize, true, &pSrc->sBIT, &pSrc->origSize);
+			pSrc->imgpf = romData->imgpf(RomData::IMG_INT_ICON);
+			pSrc->isInternal = true;
 			imgbf &= ~RomData::IMGBF_INT_ICON;
 
-			if (isImgClassValid(pOutParams->retImg)) {
+			if (pSrc->img) {
 				// Image retrieved.
-				// TODO: Better method than goto?
-				goto skip_image_check;
+				return RPCT_SUCCESS;
 			}
 		}
 	}
@@ -329,17 +522,35 @@ int TCreateThumbnail<ImgClass>::getThumbnail(const RomData *romData, int reqSize
 		// This image may be present.
 		if (imgType <= RomData::IMG_INT_MAX) {
 			// Internal image.
-			pOutParams->retImg = getInternalImage(romData, imgType, &pOutParams->fullSize, &pOutParams->sBIT);
-			imgpf = romData->imgpf(imgType);
+			ImgSize origSize = {0, 0};
+			pSrc->img = getInternalRpImage(romData, imgType,
+				reqSize, isSmallSize, &pSrc->sBIT, &origSize);
+			pSrc->imgpf = romData->imgpf(imgType);
+			pSrc->isInternal = true;
+
+			if (pSrc->img) {
+				// A smaller mipmap may have been retrieved.
+				// Get the original size for the thumbnail metadata.
+				const auto sizes = romData->supportedImageSizes(imgType);
+				for (const auto &sz : sizes) {
+					if (sz.width * sz.height > origSize.width * origSize.height) {
+						origSize.width = sz.width;
+						origSize.height = sz.height;
+					}
+				}
+				pSrc->origSize = origSize;
+			}
 		} else {
 			// External image.
-			pOutParams->retImg = getExternalImage(romData, imgType, reqSize, &pOutParams->fullSize, &pOutParams->sBIT);
-			imgpf = romData->imgpf(imgType);
+			pSrc->img = getExternalRpImage(romData, imgType, reqSize,
+				&pSrc->sBIT, &pSrc->origSize);
+			pSrc->imgpf = romData->imgpf(imgType);
+			pSrc->isInternal = false;
 		}
 
-		if (isImgClassValid(pOutParams->retImg)) {
+		if (pSrc->img) {
 			// Image retrieved.
-			break;
+			return RPCT_SUCCESS;
 		}
 
 		// Make sure we don't check this image type again
@@ -348,12 +559,43 @@ int TCreateThumbnail<ImgClass>::getThumbnail(const RomData *romData, int reqSize
 		imgbf &= ~bf;
 	}
 
+	// No image.
+	return RPCT_SOURCE_FILE_NO_IMAGE;
+}
+
+/**
+ * Convert a thumbnail source image to ImgClass and apply
+ * the image processing flags, e.g. rescaling.
+ * @param romData	[in] RomData object
+ * @param src		[in] Thumbnail source image
+ * @param reqSize	[in] Requested image size (single dimension; assuming square image)
+ * @param pOutParams	[out] Output parameters (If an error occurs, pOutParams->retImg will be null)
+ * @return 0 on success; non-zero on error.
+ */
+template<typename ImgClass>
+int TCreateThumbnail<ImgClass>::processThumbnail(const RomData *romData, const ThumbSource_t &src, int reqSize, GetThumbnailOutParams_t *pOutParams)
+{
+	uint32_t imgpf = src.imgpf;
+	ImgSize origSize = src.origSize;
+
+	// Convert the rp_image to ImgClass.
+	pOutParams->retImg = rpImageToImgClass(src.img);
 	if (!isImgClassValid(pOutParams->retImg)) {
-		// No image.
-		return RPCT_SOURCE_FILE_NO_IMAGE;
+		// Conversion failed.
+		pOutParams->retImg = getNullImgClass();
+		return RPCT_SOURCE_FILE_ERROR;
+	}
+	if (src.isInternal) {
+		// NOTE: The image may have been resized on Windows,
+		// since Windows has issues with non-square images.
+		// Hence, we have to get the size from retImg.
+		getImgClassSize(pOutParams->retImg, &pOutParams->fullSize);
+	} else {
+		pOutParams->fullSize.width = src.img->width();
+		pOutParams->fullSize.height = src.img->height();
 	}
+	pOutParams->sBIT = src.sBIT;
 
-skip_image_check:
 	if (pOutParams->fullSize.width <= 0 || pOutParams->fullSize.height <= 0) {
 		// Image size is invalid.
 		freeImgClass(pOutParams->retImg);
@@ -389,6 +631,7 @@ skip_image_check:
 				freeImgClass(pOutParams->retImg);
 				pOutParams->retImg = scaled_img;
 				pOutParams->fullSize = rescaleSize;
+				origSize = rescaleSize;
 
 				// Disable nearest-neighbor scaling, since we already lost
 				// pixel-perfect sharpness with the rescale.
@@ -424,7 +667,8 @@ skip_image_check:
 		}
 	}
 
-	// TODO: If image is larger than req_size, resize down.
+	// NOTE: Images larger than req_size were already downscaled
+	// by getInternalImage() / getExternalImage().
 	if (imgpf & RomData::IMGPF_RESCALE_NEAREST) {
 		// TODO: User configuration.
 		ResizeNearestUpPolicy resize_up = RESIZE_UP_HALF;
@@ -491,6 +735,14 @@ skip_image_check:
 		pOutParams->thumbSize = pOutParams->fullSize;
 	}
 
+	if (origSize.width > pOutParams->fullSize.width &&
+	    origSize.height > pOutParams->fullSize.height)
+	{
+		// A smaller mipmap was retrieved, or the image was downscaled.
+		// Report the original image size.
+		pOutParams->fullSize = origSize;
+	}
+
 	// Image retrieved successfully.
 	return RPCT_SUCCESS;
 }
@@ -570,6 +822,163 @@ int TCreateThumbnail<ImgClass>::getThumbnail(const char *filename, int reqSize,
 	return ret;
 }
 
+
+/**
+ * Create thumbnails of multiple sizes for the specified ROM file.
+ *
+ * The image is only retrieved once, at the largest requested size.
+ * Smaller sizes are downscaled from the next-larger thumbnail.
+ *
+ * @param romData	[in] RomData object
+ * @param reqSizes	[in] Requested image sizes (single dimension; assuming square image)
+ * @param count		[in] Number of requested image sizes
+ * @param pOutParams	[out] Array of count output parameters, in the same order as reqSizes
+ *			(If an error occurs, all retImg values will be null)
+ * @return 0 on success; non-zero on error.
+ */
+template<typename ImgClass>
+int TCreateThumbnail<ImgClass>::getThumbnails(const RomData *romData, const int *reqSizes,
+	unsigned int count, GetThumbnailOutParams_t *pOutParams)
+{
+	assert(romData != nullptr);
+	assert(reqSizes != nullptr);
+	assert(count > 0);
+	assert(pOutParams != nullptr);
+	if (!reqSizes || count == 0) {
+		// Invalid parameter...
+		return RPCT_INVALID_IMAGE_SIZE;
+	}
+	for (unsigned int i = 0; i < count; i++) {
+		pOutParams[i].retImg = getNullImgClass();
+	}
+	for (unsigned int i = 0; i < count; i++) {
+		if (reqSizes[i] <= 0) {
+			// Invalid parameter...
+			return RPCT_INVALID_IMAGE_SIZE;
+		}
+	}
+
+	// Process the sizes from largest to smallest.
+	vector<unsigned int> order(count);
+	for (unsigned int i = 0; i < count; i++) {
+		order[i] = i;
+	}
+	std::stable_sort(order.begin(), order.end(), [reqSizes](unsigned int a, unsigned int b) {
+		return reqSizes[a] > reqSizes[b];
+	});
+
+	// Small sizes may use the internal icon instead of the "real" thumbnail.
+	const bool useIntIconForSmallSizes = Config::instance()->useIntIconForSmallSizes();
+
+	int ret = RPCT_SUCCESS;
+	const GetThumbnailOutParams_t *prev = nullptr;
+	const rp_image *prevImg = nullptr;	// rp_image used to create the previous thumbnail
+	int prevReqSize = 0;
+	for (unsigned int idx : order) {
+		const int reqSize = reqSizes[idx];
+		GetThumbnailOutParams_t *const out = &pOutParams[idx];
+
+		// Derive this size from the previous (larger) thumbnail if possible.
+		// If the previous thumbnail was upscaled, or if this is the first
+		// small size, retrieve the image again.
+		bool derive = (prev != nullptr);
+		if (derive) {
+			if (prev->thumbSize.width > prev->fullSize.width ||
+			    prev->thumbSize.height > prev->fullSize.height)
+			{
+				// Previous thumbnail was upscaled with nearest-neighbor.
+				derive = false;
+			} else if (useIntIconForSmallSizes && reqSize <= 48 && prevReqSize > 48) {
+				// This size may use a different image.
+				derive = false;
+			}
+		}
+
+		if (!derive) {
+			UNREF_AND_NULL(prevImg);
+
+			// Zero out the output parameters initially.
+			out->thumbSize.width = 0;
+			out->thumbSize.height = 0;
+			out->fullSize.width = 0;
+			out->fullSize.height = 0;
+			memset(&out->sBIT, 0, sizeof(out->sBIT));
+
+			ThumbSource_t src;
+			ret = getThumbnailSource(romData, reqSize, &src);
+			if (ret != RPCT_SUCCESS)
+				break;
+			ret = processThumbnail(romData, src, reqSize, out);
+			// Keep the source image for the smaller sizes.
+			prevImg = src.img;
+			if (ret != RPCT_SUCCESS)
+				break;
+			prev = out;
+			prevReqSize = reqSize;
+			continue;
+		}
+
+		ImgSize sz = prev->thumbSize;
+		if (sz.width > reqSize || sz.height > reqSize) {
+			// Cascaded downscaling from the previous thumbnail.
+			const ImgSize tgt_size = {reqSize, reqSize};
+			rescale_aspect(sz, tgt_size);
+			if (sz.width <= 0)
+				sz.width = 1;
+			if (sz.height <= 0)
+				sz.height = 1;
+		}
+
+		// Scale the previous rp_image. The previous thumbnail may have
+		// been rescaled as an ImgClass, e.g. for IMGPF_RESCALE_ASPECT_8to7,
+		// so the rp_image is scaled directly to this thumbnail's size.
+		// NOTE: If the previous rp_image already has the correct size,
+		// it's converted as-is, since each output owns its image.
+		const rp_image *img;
+		if (sz.width == prevImg->width() && sz.height == prevImg->height()) {
+			img = prevImg->ref();
+		} else {
+			// Use the box filter for downscaling.
+			// Use the bilinear filter if either dimension is larger.
+			const rp_image::ScaleFilter filter =
+				(sz.width > prevImg->width() || sz.height > prevImg->height())
+					? rp_image::ScaleFilter::Bilinear
+					: rp_image::ScaleFilter::Box;
+			img = prevImg->scaled(sz.width, sz.height, filter);
+			if (!img) {
+				ret = RPCT_SOURCE_FILE_ERROR;
+				break;
+			}
+		}
+		prevImg->unref();
+		prevImg = img;
+
+		// Convert the rp_image to ImgClass.
+		out->retImg = rpImageToImgClass(img);
+		if (!isImgClassValid(out->retImg)) {
+			ret = RPCT_SOURCE_FILE_ERROR;
+			break;
+		}
+		out->thumbSize = sz;
+		out->fullSize = prev->fullSize;
+		out->sBIT = prev->sBIT;
+		prev = out;
+		prevReqSize = reqSize;
+	}
+	UNREF(prevImg);
+
+	if (ret != RPCT_SUCCESS) {
+		// Free all of the thumbnails.
+		for (unsigned int i = 0; i < count; i++) {
+			if (isImgClassValid(pOutParams[i].retImg)) {
+				freeImgClass(pOutParams[i].retImg);
+			}
+			pOutParams[i].retImg = getNullImgClass();
+		}
+	}
+	return ret;
+}
+
 }
 
 #endif /* __ROMPROPERTIES_LIBROMDATA_IMG_TCREATETHUMBNAIL_CPP__ */
@@ -2,7 +2,7 @@
  * ROM Properties Page shell extension. (libromdata)                       *
  * TCreateThumbnail.hpp: Thumbnail creator template.                       *
  *                                                                         *
- * Copyright (c) 2016-2021 by David Korth.                                 *
+ * Copyright (c) 2016-2022 by David Korth.                                 *
  * SPDX-License-Identifier: GPL-2.0-or-later                               *
  ***************************************************************************/
 
@@ -33,6 +33,7 @@ typedef enum {
 	RPCT_SOURCE_FILE_BAD_FS		= 7,	// Source file is located on a "bad" file system.
 	RPCT_RUNNING_AS_ROOT		= 8,	// Running as root is not supported.
 	RPCT_INVALID_IMAGE_SIZE		= 9,	// Invalid image size requested. (e.g. 0 or less)
+	RPCT_CANCELLED			= 10,	// Request was cancelled by the caller.
 } RpCreateThumbnailError;
 
 /**
@@ -64,6 +65,24 @@ typedef enum {
  */
 typedef int (RP_C_API *PFN_RP_CREATE_THUMBNAIL)(const char *source_file, const char *output_file, int maximum_size);
 
+/**
+ * rp_create_thumbnails() function pointer.
+ * Used for wrapper programs that don't link to libromdata directly.
+ *
+ * The source file is only opened and decoded once. Each output
+ * file is written using the corresponding maximum size.
+ *
+ * @param source_file Source file. (UTF-8)
+ * @param output_files Output files. (UTF-8)
+ * @param maximum_sizes Maximum sizes.
+ * @param count Number of output files.
+ * @param cancelled [in,opt] If non-zero, stop before writing the next output file.
+ * @return 0 on success; non-zero on error.
+ */
+typedef int (RP_C_API *PFN_RP_CREATE_THUMBNAILS)(const char *source_file,
+	const char *const *output_files, const int *maximum_sizes, unsigned int count,
+	const volatile int *cancelled);
+
 #ifdef __cplusplus
 }
 #endif
@@ -106,14 +125,19 @@ class TCreateThumbnail
 		 * Get an internal image.
 		 * @param romData	[in] RomData object.
 		 * @param imageType	[in] Image type.
+		 * @param req_size	[in] Requested image size. (<= 0 for the full image)
+		 * @param allowLowRes	[in] If true, allow a low-quality embedded thumbnail.
 		 * @param pOutSize	[out,opt] Pointer to ImgSize to store the image's size.
 		 * @param sBIT		[out,opt] sBIT metadata.
+		 * @param pOrigSize	[out,opt] Pointer to ImgSize to store the original image's size, before downscaling.
 		 * @return Internal image, or null ImgClass on error.
 		 */
 		ImgClass getInternalImage(const LibRpBase::RomData *romData,
 			LibRpBase::RomData::ImageType imageType,
+			int req_size, bool allowLowRes,
 			ImgSize *pOutSize = nullptr,
-			LibRpTexture::rp_image::sBIT_t *sBIT = nullptr);
+			LibRpTexture::rp_image::sBIT_t *sBIT = nullptr,
+			ImgSize *pOrigSize = nullptr);
 
 		/**
 		 * Get an external image.
@@ -122,12 +146,14 @@ class TCreateThumbnail
 		 * @param req_size	[in] Requested image size.
 		 * @param pOutSize	[out,opt] Pointer to ImgSize to store the image's size.
 		 * @param sBIT		[out,opt] sBIT metadata.
+		 * @param pOrigSize	[out,opt] Pointer to ImgSize to store the original image's size, before downscaling.
 		 * @return External image, or null ImgClass on error.
 		 */
 		ImgClass getExternalImage(
 			const LibRpBase::RomData *romData, LibRpBase::RomData::ImageType imageType,
 			int req_size, ImgSize *pOutSize = nullptr,
-			LibRpTexture::rp_image::sBIT_t *sBIT = nullptr);
+			LibRpTexture::rp_image::sBIT_t *sBIT = nullptr,
+			ImgSize *pOrigSize = nullptr);
 
 		/**
 		 * getThumbnail() output parameters.
@@ -166,6 +192,24 @@ class TCreateThumbnail
 		 */
 		int getThumbnail(const char *filename, int reqSize, GetThumbnailOutParams_t *pOutParams);
 
+		/**
+		 * Create thumbnails of multiple sizes for the specified ROM file.
+		 *
+		 * The image is only retrieved once, at the largest requested size.
+		 * Smaller sizes are downscaled from the next-larger thumbnail's
+		 * rp_image using rp_image::scaled(), and converted to ImgClass
+		 * afterwards.
+		 *
+		 * @param romData	[in] RomData object
+		 * @param reqSizes	[in] Requested image sizes (single dimension; assuming square image)
+		 * @param count		[in] Number of requested image sizes
+		 * @param pOutParams	[out] Array of count output parameters, in the same order as reqSizes
+		 *			(If an error occurs, all retImg values will be null)
+		 * @return 0 on success; non-zero on error.
+		 */
+		int getThumbnails(const LibRpBase::RomData *romData, const int *reqSizes,
+			unsigned int count, GetThumbnailOutParams_t *pOutParams);
+
 	protected:
 		/**
 		 * Rescale a size while maintaining the aspect ratio.
@@ -175,6 +219,81 @@ class TCreateThumbnail
 		 */
 		static inline void rescale_aspect(ImgSize &rs_size, const ImgSize &tgt_size);
 
+		/**
+		 * Downscale an rp_image if it's larger than the requested size.
+		 * This is done before converting to ImgClass, so all frontends
+		 * use the same high-quality downscaler.
+		 * @param image		[in] rp_image
+		 * @param req_size	[in] Requested image size. (<= 0 for the full image)
+		 * @param imgpf		[in] Image processing flags.
+		 * @return Downscaled rp_image (caller must unref), or nullptr if no downscaling is needed.
+		 */
+		static LibRpTexture::rp_image *downscaleForReqSize(const LibRpTexture::rp_image *image,
+			int req_size, uint32_t imgpf);
+
+		/**
+		 * Get an internal image as an rp_image.
+		 * @param romData	[in] RomData object.
+		 * @param imageType	[in] Image type.
+		 * @param req_size	[in] Requested image size. (<= 0 for the full image)
+		 * @param allowLowRes	[in] If true, allow a low-quality embedded thumbnail.
+		 * @param sBIT		[out,opt] sBIT metadata.
+		 * @param pOrigSize	[out,opt] Pointer to ImgSize to store the original image's size, before downscaling.
+		 * @return Internal image (caller must unref), or nullptr on error.
+		 */
+		const LibRpTexture::rp_image *getInternalRpImage(const LibRpBase::RomData *romData,
+			LibRpBase::RomData::ImageType imageType,
+			int req_size, bool allowLowRes,
+			LibRpTexture::rp_image::sBIT_t *sBIT = nullptr,
+			ImgSize *pOrigSize = nullptr);
+
+		/**
+		 * Get an external image as an rp_image.
+		 * @param romData	[in] RomData object.
+		 * @param imageType	[in] Image type.
+		 * @param req_size	[in] Requested image size.
+		 * @param sBIT		[out,opt] sBIT metadata.
+		 * @param pOrigSize	[out,opt] Pointer to ImgSize to store the original image's size, before downscaling.
+		 * @return External image (caller must unref), or nullptr on error.
+		 */
+		const LibRpTexture::rp_image *getExternalRpImage(
+			const LibRpBase::RomData *romData, LibRpBase::RomData::ImageType imageType,
+			int req_size, LibRpTexture::rp_image::sBIT_t *sBIT = nullptr,
+			ImgSize *pOrigSize = nullptr);
+
+		/**
+		 * Thumbnail source image.
+		 * This is the image selected by getThumbnailSource(),
+		 * before any ImgClass-specific processing.
+		 */
+		struct ThumbSource_t {
+			const LibRpTexture::rp_image *img;	// [out] Source image. (caller must unref)
+			ImgSize origSize;			// [out] Original image size, before downscaling.
+			LibRpTexture::rp_image::sBIT_t sBIT;	// [out] sBIT metadata.
+			uint32_t imgpf;				// [out] Image processing flags.
+			bool isInternal;			// [out] True if this is an internal image.
+		};
+
+		/**
+		 * Select and retrieve the thumbnail source image for the specified ROM file.
+		 * @param romData	[in] RomData object
+		 * @param reqSize	[in] Requested image size (single dimension; assuming square image)
+		 * @param pSrc		[out] Thumbnail source image (If an error occurs, pSrc->img will be nullptr)
+		 * @return 0 on success; non-zero on error.
+		 */
+		int getThumbnailSource(const LibRpBase::RomData *romData, int reqSize, ThumbSource_t *pSrc);
+
+		/**
+		 * Convert a thumbnail source image to ImgClass and apply
+		 * the image processing flags, e.g. rescaling.
+		 * @param romData	[in] RomData object
+		 * @param src		[in] Thumbnail source image
+		 * @param reqSize	[in] Requested image size (single dimension; assuming square image)
+		 * @param pOutParams	[out] Output parameters (If an error occurs, pOutParams->retImg will be null)
+		 * @return 0 on success; non-zero on error.
+		 */
+		int processThumbnail(const LibRpBase::RomData *romData, const ThumbSource_t &src, int reqSize, GetThumbnailOutParams_t *pOutParams);
+
 	protected:
 		/** Pure virtual functions. **/
 
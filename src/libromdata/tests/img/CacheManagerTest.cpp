@@ -0,0 +1,353 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (libromdata/tests)                 *
+ * CacheManagerTest.cpp: CacheManager test.                                *
+ *                                                                         *
+ * Copyright (c) 2016-2022 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+
+// librpbase, librpfile
+#include "common.h"
+#include "librpbase/config/Config.hpp"
+#include "librpfile/IRpFile.hpp"
+using LibRpBase::Config;
+using LibRpFile::IRpFile;
+
+// libcachecommon
+#include "libcachecommon/CacheDir.hpp"
+#include "libcachecommon/CacheIndex.hpp"
+#include "libcachecommon/CacheKeys.hpp"
+using LibCacheCommon::CacheIndex;
+
+// libromdata
+#include "libromdata/img/CacheManager.hpp"
+
+// OS-specific includes.
+#include <ftw.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+// C includes. (C++ namespace)
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+
+// C++ includes.
+#include <string>
+#include <vector>
+using std::string;
+using std::vector;
+
+namespace LibRomData { namespace Tests {
+
+/**
+ * CacheManager that simulates rp-download.
+ */
+class TestCacheManager : public CacheManager
+{
+	public:
+		TestCacheManager()
+			: notModified(false)
+			, separateFileExisted(false)
+		{ }
+
+	public:
+		/**
+		 * Simulate rp-download.
+		 * - If notModified is set, the existing file is kept,
+		 *   and its mtime is updated.
+		 * - Otherwise, the file is written with the contents
+		 *   "data:" + cache_key.
+		 * @param filtered_cache_key Filtered cache key.
+		 * @param force If true, revalidate the file even if it's cached.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		int execRpDownload(const string &filtered_cache_key, bool force) final
+		{
+			calls.push_back(filtered_cache_key);
+			forced.push_back(force);
+
+			const string filename = LibCacheCommon::getCacheFilename(filtered_cache_key);
+			separateFileExisted = (access(filename.c_str(), F_OK) == 0);
+			if (notModified) {
+				return (separateFileExisted && utimes(filename.c_str(), nullptr) == 0) ? 0 : -EIO;
+			}
+
+			// Create subdirectories.
+			const string &cacheDir = LibCacheCommon::getCacheDirectory();
+			for (size_t pos = filename.find('/', cacheDir.size() + 1);
+			     pos != string::npos; pos = filename.find('/', pos + 1))
+			{
+				mkdir(filename.substr(0, pos).c_str(), 0777);
+			}
+
+			FILE *f = fopen(filename.c_str(), "wb");
+			if (!f)
+				return -EIO;
+			const string data = "data:" + filtered_cache_key;
+			fwrite(data.data(), 1, data.size(), f);
+			fclose(f);
+			return 0;
+		}
+
+		/**
+		 * Simulate rp-download for multiple cache keys.
+		 * @param filtered_cache_keys Filtered cache keys, in priority order.
+		 * @return Index of the downloaded cache key; negative POSIX error code on error.
+		 */
+		int execRpDownloadFirst(const vector<string> &filtered_cache_keys) final
+		{
+			for (size_t i = 0; i < filtered_cache_keys.size(); i++) {
+				if (execRpDownload(filtered_cache_keys[i], false) == 0)
+					return static_cast<int>(i);
+			}
+			return -ENOENT;
+		}
+
+		bool notModified;		// Simulate 304 Not Modified.
+		bool separateFileExisted;	// Cache file existed as a separate file.
+		vector<string> calls;		// Cache keys passed to execRpDownload().
+		vector<bool> forced;		// force values passed to execRpDownload().
+};
+
+class CacheManagerTest : public ::testing::Test
+{
+	protected:
+		void SetUp(void) override
+		{
+			m_index = CacheIndex::instance();
+			ASSERT_TRUE(m_index != nullptr);
+			m_index->setPackSmallFiles(false);
+		}
+
+		/**
+		 * Create a file in the cache and add it to the cache index.
+		 * @param key Cache key.
+		 * @param data File contents.
+		 * @param stored Time the file was stored in the cache.
+		 */
+		void createCachedFile(const string &key, const string &data, time_t stored)
+		{
+			TestCacheManager mgr;
+			mgr.execRpDownload(key, false);
+			if (data != "data:" + key) {
+				FILE *f = fopen(LibCacheCommon::getCacheFilename(key).c_str(), "wb");
+				ASSERT_TRUE(f != nullptr);
+				fwrite(data.data(), 1, data.size(), f);
+				fclose(f);
+			}
+			ASSERT_EQ(0, m_index->add(key, stored));
+		}
+
+		/**
+		 * Read an IRpFile's contents.
+		 * @param file IRpFile. (This will be unref()'d.)
+		 * @return Contents, or empty string on error.
+		 */
+		static string readAndUnref(IRpFile *file)
+		{
+			if (!file)
+				return string();
+			string data(static_cast<size_t>(file->size()), '\0');
+			file->rewind();
+			const size_t size = file->read(&data[0], data.size());
+			file->unref();
+			return (size == data.size() ? data : string());
+		}
+
+		CacheIndex *m_index;
+};
+
+/**
+ * Files that were stored within CacheMaxAge aren't revalidated.
+ */
+TEST_F(CacheManagerTest, freshEntry)
+{
+	const time_t now = time(nullptr);
+	createCachedFile("test/fresh.png", "old:test/fresh.png", now - 3600);
+
+	TestCacheManager mgr;
+	EXPECT_EQ("old:test/fresh.png", readAndUnref(mgr.download("test/fresh.png")));
+	EXPECT_TRUE(mgr.calls.empty());
+}
+
+/**
+ * Files older than CacheMaxAge are revalidated,
+ * and the cache index entry is updated.
+ */
+TEST_F(CacheManagerTest, expiredEntry)
+{
+	const time_t now = time(nullptr);
+	createCachedFile("test/expired.png", "old:test/expired.png", now - 2*86400);
+
+	TestCacheManager mgr;
+	mgr.notModified = true;
+	EXPECT_EQ("old:test/expired.png", readAndUnref(mgr.download("test/expired.png")));
+	ASSERT_EQ(1U, mgr.calls.size());
+	EXPECT_EQ("test/expired.png", mgr.calls[0]);
+	EXPECT_TRUE(mgr.forced[0]);
+
+	CacheIndex::Entry entry;
+	ASSERT_EQ(0, m_index->lookup("test/expired.png", entry));
+	EXPECT_GE(entry.mtime, static_cast<int64_t>(now));
+
+	// The file won't be revalidated again until it expires.
+	EXPECT_EQ("old:test/expired.png", readAndUnref(mgr.download("test/expired.png")));
+	EXPECT_EQ(1U, mgr.calls.size());
+
+	// If the file was modified, the new version is used.
+	ASSERT_EQ(0, m_index->add("test/expired.png", now - 2*86400));
+	mgr.notModified = false;
+	EXPECT_EQ("data:test/expired.png", readAndUnref(mgr.download("test/expired.png")));
+	EXPECT_EQ(2U, mgr.calls.size());
+}
+
+/**
+ * Expired files in pack files are extracted before they're revalidated,
+ * since rp-download can only revalidate separate files.
+ */
+TEST_F(CacheManagerTest, expiredPackedEntry)
+{
+	m_index->setPackSmallFiles(true);
+	const time_t now = time(nullptr);
+	createCachedFile("test/packed.png", "old:test/packed.png", now - 2*86400);
+	CacheIndex::Entry entry;
+	ASSERT_EQ(0, m_index->lookup("test/packed.png", entry));
+	ASSERT_NE(0U, entry.pack);
+
+	TestCacheManager mgr;
+	mgr.notModified = true;
+	EXPECT_EQ("old:test/packed.png", readAndUnref(mgr.download("test/packed.png")));
+	ASSERT_EQ(1U, mgr.calls.size());
+	EXPECT_TRUE(mgr.forced[0]);
+	EXPECT_TRUE(mgr.separateFileExisted);
+
+	// The file is indexed again.
+	// NOTE: CacheManager uses the configured setting for packing
+	// small files, so the file is now stored separately.
+	ASSERT_EQ(0, m_index->lookup("test/packed.png", entry));
+	EXPECT_EQ(0U, entry.pack);
+	EXPECT_GE(entry.mtime, static_cast<int64_t>(now));
+}
+
+/**
+ * Expired files are revalidated by downloadFirst().
+ */
+TEST_F(CacheManagerTest, downloadFirstExpired)
+{
+	const time_t now = time(nullptr);
+	createCachedFile("test/first.png", "old:test/first.png", now - 2*86400);
+
+	TestCacheManager mgr;
+	mgr.notModified = true;
+	int idx = -1;
+	const vector<string> keys = {"test/first.png"};
+	EXPECT_EQ("old:test/first.png", readAndUnref(mgr.downloadFirst(keys, &idx)));
+	EXPECT_EQ(0, idx);
+	ASSERT_EQ(1U, mgr.calls.size());
+	EXPECT_TRUE(mgr.forced[0]);
+
+	// findInCache() doesn't revalidate expired files.
+	ASSERT_EQ(0, m_index->add("test/first.png", now - 2*86400));
+	EXPECT_EQ("old:test/first.png", readAndUnref(mgr.findInCache("test/first.png")));
+	EXPECT_EQ(1U, mgr.calls.size());
+}
+
+/**
+ * Indexed files that were deleted, e.g. by the user,
+ * are removed from the index and downloaded again.
+ */
+TEST_F(CacheManagerTest, deletedFile)
+{
+	const time_t now = time(nullptr);
+	createCachedFile("test/deleted.png", "old:test/deleted.png", now);
+	ASSERT_EQ(0, unlink(LibCacheCommon::getCacheFilename("test/deleted.png").c_str()));
+
+	TestCacheManager mgr;
+	EXPECT_EQ("data:test/deleted.png", readAndUnref(mgr.download("test/deleted.png")));
+	ASSERT_EQ(1U, mgr.calls.size());
+	EXPECT_FALSE(mgr.forced[0]);
+
+	CacheIndex::Entry entry;
+	ASSERT_EQ(0, m_index->lookup("test/deleted.png", entry));
+	EXPECT_NE(0U, entry.size);
+
+	// Same with downloadFirst().
+	createCachedFile("test/deleted2.png", "old:test/deleted2.png", now);
+	ASSERT_EQ(0, unlink(LibCacheCommon::getCacheFilename("test/deleted2.png").c_str()));
+	int idx = -1;
+	const vector<string> keys = {"test/deleted2.png"};
+	EXPECT_EQ("data:test/deleted2.png", readAndUnref(mgr.downloadFirst(keys, &idx)));
+	EXPECT_EQ(0, idx);
+	EXPECT_EQ(2U, mgr.calls.size());
+
+	// findInCache() doesn't download anything.
+	createCachedFile("test/deleted3.png", "old:test/deleted3.png", now);
+	ASSERT_EQ(0, unlink(LibCacheCommon::getCacheFilename("test/deleted3.png").c_str()));
+	EXPECT_EQ(nullptr, mgr.findInCache("test/deleted3.png"));
+	EXPECT_EQ(-ENOENT, m_index->lookup("test/deleted3.png", entry));
+}
+
+} }
+
+/**
+ * nftw() callback to remove the temporary directory.
+ */
+static int removeCallback(const char *fpath, const struct stat *sb, int typeflag, struct FTW *ftwbuf)
+{
+	RP_UNUSED(sb);
+	RP_UNUSED(typeflag);
+	RP_UNUSED(ftwbuf);
+	remove(fpath);
+	return 0;
+}
+
+/**
+ * Test suite main function.
+ */
+int main(int argc, char *argv[])
+{
+	fprintf(stderr, "LibRomData test suite: CacheManager tests.\n\n");
+	fflush(nullptr);
+
+	// Use a temporary directory for the cache and configuration.
+	// NOTE: This must be done before the cache and configuration
+	// directories are initialized.
+	char tmpl[] = "/tmp/rom-properties-CacheManagerTest.XXXXXX";
+	if (!mkdtemp(tmpl)) {
+		fprintf(stderr, "*** ERROR: Unable to create a temporary directory.\n");
+		return EXIT_FAILURE;
+	}
+	const string tmpdir = tmpl;
+	const string cacheHome = tmpdir + "/cache";
+	const string configHome = tmpdir + "/config";
+	mkdir(cacheHome.c_str(), 0700);
+	mkdir((cacheHome + "/rom-properties").c_str(), 0700);
+	mkdir(configHome.c_str(), 0700);
+	mkdir((configHome + "/rom-properties").c_str(), 0700);
+	setenv("XDG_CACHE_HOME", cacheHome.c_str(), 1);
+	setenv("XDG_CONFIG_HOME", configHome.c_str(), 1);
+
+	// Revalidate files after one day.
+	FILE *f = fopen((configHome + "/rom-properties/rom-properties.conf").c_str(), "w");
+	if (!f) {
+		fprintf(stderr, "*** ERROR: Unable to write rom-properties.conf.\n");
+		return EXIT_FAILURE;
+	}
+	fputs("[Downloads]\nCacheMaxAge=1\n", f);
+	fclose(f);
+	Config::instance()->load();
+
+	// coverity[fun_call_w_exception]: uncaught exceptions cause nonzero exit anyway, so don't warn.
+	::testing::InitGoogleTest(&argc, argv);
+	const int ret = RUN_ALL_TESTS();
+
+	nftw(tmpdir.c_str(), removeCallback, 16, FTW_DEPTH | FTW_PHYS);
+	return ret;
+}
@@ -504,6 +504,19 @@ void ImageDecoderTest::decodeTest_internal(void)
 
 	// Compare the image data.
 	ASSERT_NO_FATAL_FAILURE(Compare_RpImage(img_png.get(), img_dds));
+
+	// Requesting the full image size should return the full image.
+	const int maxDim = std::max(img_dds->width(), img_dds->height());
+	const rp_image *const img_dds_full = m_romData->image(mode.imgType, maxDim, false);
+	EXPECT_EQ(img_dds, img_dds_full) << "Requesting the full image size resulted in a different rp_image object.";
+
+	// Requesting half the image size may return a smaller mipmap,
+	// but it must not be smaller than the requested size.
+	const int reqSize = (maxDim > 1 ? maxDim / 2 : 1);
+	const rp_image *const img_dds_half = m_romData->image(mode.imgType, reqSize, true);
+	ASSERT_TRUE(img_dds_half != nullptr) << "Could not load the " << filetype << " image at size " << reqSize << '.';
+	EXPECT_GE(std::max(img_dds_half->width(), img_dds_half->height()), reqSize) <<
+		"Image retrieved for size " << reqSize << " is too small.";
 }
 
 /**
@@ -768,6 +768,25 @@ int RomData::loadInternalImage(ImageType imageType, const rp_image **pImage)
 	return -ENOENT;
 }
 
+/**
+ * Load an internal image, preferring a smaller version if available.
+ * Called by RomData::image() if a requested size is specified.
+ *
+ * The default implementation calls loadInternalImage().
+ *
+ * @param imageType	[in] Image type to load.
+ * @param reqSize	[in] Requested size. (<= 0 for the full image)
+ * @param allowLowRes	[in] If true, allow a low-quality embedded thumbnail.
+ * @param pImage	[out] Pointer to const rp_image* to store the image in.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int RomData::loadInternalImageForSize(ImageType imageType, int reqSize, bool allowLowRes, const rp_image **pImage)
+{
+	RP_UNUSED(reqSize);
+	RP_UNUSED(allowLowRes);
+	return loadInternalImage(imageType, pImage);
+}
+
 /**
  * Load metadata properties.
  * Called by RomData::metaData() if the field data hasn't been loaded yet.
@@ -823,6 +842,27 @@ const RomMetaData *RomData::metaData(void) const
  * @return Internal image, or nullptr if the ROM doesn't have one.
  */
 const rp_image *RomData::image(ImageType imageType) const
+{
+	return image(imageType, 0, false);
+}
+
+/**
+ * Get an internal image from the ROM, preferring a smaller
+ * version that is at least as large as the requested size.
+ *
+ * This is intended for thumbnailing: for textures with mipmaps,
+ * only the smallest mipmap that's still >= reqSize is decoded.
+ * The returned image may be larger than reqSize.
+ *
+ * The retrieved image must be ref()'d by the caller if the
+ * caller stores it instead of using it immediately.
+ *
+ * @param imageType	[in] Image type to load.
+ * @param reqSize	[in] Requested size. (<= 0 for the full image)
+ * @param allowLowRes	[in] If true, allow a low-quality embedded thumbnail.
+ * @return Internal image, or nullptr if the ROM doesn't have one.
+ */
+const rp_image *RomData::image(ImageType imageType, int reqSize, bool allowLowRes) const
 {
 	assert(imageType >= IMG_INT_MIN && imageType <= IMG_INT_MAX);
 	if (imageType < IMG_INT_MIN || imageType > IMG_INT_MAX) {
@@ -840,7 +880,9 @@ const rp_image *RomData::image(ImageType imageType) const
 #else /* !_DEBUG */
 	const rp_image *img;
 #endif
-	int ret = const_cast<RomData*>(this)->loadInternalImage(imageType, &img);
+	int ret = (reqSize > 0)
+		? const_cast<RomData*>(this)->loadInternalImageForSize(imageType, reqSize, allowLowRes, &img)
+		: const_cast<RomData*>(this)->loadInternalImage(imageType, &img);
 
 	// SANITY CHECK: If loadInternalImage() returns 0,
 	// img *must* be valid. Otherwise, it must be nullptr.
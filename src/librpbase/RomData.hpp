@@ -2,7 +2,7 @@
  * ROM Properties Page shell extension. (librpbase)                        *
  * RomData.hpp: ROM data base class.                                       *
  *                                                                         *
- * Copyright (c) 2016-2021 by David Korth.                                 *
+ * Copyright (c) 2016-2022 by David Korth.                                 *
  * SPDX-License-Identifier: GPL-2.0-or-later                               *
  ***************************************************************************/
 
@@ -425,6 +425,20 @@ class RomData : public RefBase
 		 */
 		virtual int loadInternalImage(ImageType imageType, const LibRpTexture::rp_image **pImage);
 
+		/**
+		 * Load an internal image, preferring a smaller version if available.
+		 * Called by RomData::image() if a requested size is specified.
+		 *
+		 * The default implementation calls loadInternalImage().
+		 *
+		 * @param imageType	[in] Image type to load.
+		 * @param reqSize	[in] Requested size. (<= 0 for the full image)
+		 * @param allowLowRes	[in] If true, allow a low-quality embedded thumbnail.
+		 * @param pImage	[out] Pointer to const rp_image* to store the image in.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		virtual int loadInternalImageForSize(ImageType imageType, int reqSize, bool allowLowRes, const LibRpTexture::rp_image **pImage);
+
 	public:
 		/**
 		 * Get the ROM Fields object.
@@ -458,6 +472,24 @@ class RomData : public RefBase
 		 */
 		const LibRpTexture::rp_image *image(ImageType imageType) const;
 
+		/**
+		 * Get an internal image from the ROM, preferring a smaller
+		 * version that is at least as large as the requested size.
+		 *
+		 * This is intended for thumbnailing: for textures with mipmaps,
+		 * only the smallest mipmap that's still >= reqSize is decoded.
+		 * The returned image may be larger than reqSize.
+		 *
+		 * The retrieved image must be ref()'d by the caller if the
+		 * caller stores it instead of using it immediately.
+		 *
+		 * @param imageType	[in] Image type to load.
+		 * @param reqSize	[in] Requested size. (<= 0 for the full image)
+		 * @param allowLowRes	[in] If true, allow a low-quality embedded thumbnail.
+		 * @return Internal image, or nullptr if the ROM doesn't have one.
+		 */
+		const LibRpTexture::rp_image *image(ImageType imageType, int reqSize, bool allowLowRes) const;
+
 		/**
 		 * External URLs for a media type.
 		 * Includes URL and "cache key" for local caching,
@@ -2,7 +2,7 @@
  * ROM Properties Page shell extension. (librpbase)                        *
  * RomData_decl.hpp: ROM data base class. (Subclass macros)                *
  *                                                                         *
- * Copyright (c) 2016-2021 by David Korth.                                 *
+ * Copyright (c) 2016-2022 by David Korth.                                 *
  * Copyright (c) 2016-2018 by Egor.                                        *
  * SPDX-License-Identifier: GPL-2.0-or-later                               *
  ***************************************************************************/
@@ -160,6 +160,24 @@ class klass final : public LibRpBase::RomData { \
 		 */ \
 		int loadInternalImage(ImageType imageType, const LibRpTexture::rp_image **pImage) final;
 
+/**
+ * RomData subclass function declaration for loading internal images
+ * with a requested size, e.g. for textures with mipmaps.
+ */
+#define ROMDATA_DECL_IMGINT_FORSIZE() \
+	public: \
+		/** \
+		 * Load an internal image, preferring a smaller version if available. \
+		 * Called by RomData::image() if a requested size is specified. \
+		 * @param imageType	[in] Image type to load. \
+		 * @param reqSize	[in] Requested size. (<= 0 for the full image) \
+		 * @param allowLowRes	[in] If true, allow a low-quality embedded thumbnail. \
+		 * @param pImage	[out] Pointer to const rp_image* to store the image in. \
+		 * @return 0 on success; negative POSIX error code on error. \
+		 */ \
+		int loadInternalImageForSize(ImageType imageType, int reqSize, bool allowLowRes, \
+			const LibRpTexture::rp_image **pImage) final;
+
 /**
  * RomData subclass function declaration for obtaining URLs for external images.
  */
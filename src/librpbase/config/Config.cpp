@@ -83,6 +83,9 @@ class ConfigPrivate : public ConfReaderPrivate
 		bool downloadHighResScans;
 		bool storeFileOriginInfo;
 		uint32_t palLanguageForGameTDB;
+		uint32_t cacheMaxSize;
+		uint32_t cacheMaxAge;
+		bool cachePackSmallFiles;
 
 		// DMG title screen mode. [index is ROM type]
 		Config::DMG_TitleScreen_Mode dmgTSMode[Config::DMG_TitleScreen_Mode::DMG_TS_MAX];
@@ -125,6 +128,9 @@ ConfigPrivate::ConfigPrivate()
 	, downloadHighResScans(true)
 	, storeFileOriginInfo(true)
 	, palLanguageForGameTDB('en')
+	, cacheMaxSize(0)
+	, cacheMaxAge(0)
+	, cachePackSmallFiles(false)
 	/* Overlay icon */
 	, showDangerousPermissionsOverlayIcon(true)
 	/* Enable thumbnailing and metadata on network FS */
@@ -155,6 +161,9 @@ void ConfigPrivate::reset(void)
 	useIntIconForSmallSizes = true;
 	downloadHighResScans = true;
 	storeFileOriginInfo = true;
+	cacheMaxSize = 0;
+	cacheMaxAge = 0;
+	cachePackSmallFiles = false;
 
 	// DMG title screen mode.
 	dmgTSMode[Config::DMG_TitleScreen_Mode::DMG_TS_DMG] = Config::DMG_TitleScreen_Mode::DMG_TS_DMG;
@@ -201,6 +210,24 @@ int ConfigPrivate::processConfigLine(const char *section, const char *name, cons
 			param = &downloadHighResScans;
 		} else if (!strcasecmp(name, "StoreFileOriginInfo")) {
 			param = &storeFileOriginInfo;
+		} else if (!strcasecmp(name, "CachePackSmallFiles")) {
+			param = &cachePackSmallFiles;
+		} else if (!strcasecmp(name, "CacheMaxSize")) {
+			// Maximum cache size, in MiB. (0 == unlimited)
+			char *endptr = nullptr;
+			const unsigned long mib = strtoul(value, &endptr, 10);
+			if (endptr && *endptr == '\0') {
+				cacheMaxSize = static_cast<uint32_t>(mib);
+			}
+			return 1;
+		} else if (!strcasecmp(name, "CacheMaxAge")) {
+			// Maximum age of cached files, in days. (0 == unlimited)
+			char *endptr = nullptr;
+			const unsigned long days = strtoul(value, &endptr, 10);
+			if (endptr && *endptr == '\0') {
+				cacheMaxAge = static_cast<uint32_t>(days);
+			}
+			return 1;
 		} else if (!strcasecmp(name, "PalLanguageForGameTDB")) {
 			// PAL language. Parse the language code.
 			// NOTE: Converting to lowercase.
@@ -580,6 +607,41 @@ uint32_t Config::palLanguageForGameTDB(void) const
 	return d->palLanguageForGameTDB;
 }
 
+/**
+ * Maximum size of the rom-properties cache.
+ * Least recently used files are evicted if the cache is larger.
+ * NOTE: Call load() before using this function.
+ * @return Maximum cache size, in MiB. (0 == unlimited)
+ */
+uint32_t Config::cacheMaxSize(void) const
+{
+	RP_D(const Config);
+	return d->cacheMaxSize;
+}
+
+/**
+ * Maximum age of files in the rom-properties cache.
+ * Older files are revalidated with the server before they're used.
+ * NOTE: Call load() before using this function.
+ * @return Maximum cache file age, in days. (0 == unlimited)
+ */
+uint32_t Config::cacheMaxAge(void) const
+{
+	RP_D(const Config);
+	return d->cacheMaxAge;
+}
+
+/**
+ * Pack small files in the rom-properties cache into pack files?
+ * NOTE: Call load() before using this function.
+ * @return True if we should; false if not.
+ */
+bool Config::cachePackSmallFiles(void) const
+{
+	RP_D(const Config);
+	return d->cachePackSmallFiles;
+}
+
 /** DMG title screen mode **/
 
 /**
@@ -121,6 +121,29 @@ class Config : public ConfReader
 		 */
 		uint32_t palLanguageForGameTDB(void) const;
 
+		/**
+		 * Maximum size of the rom-properties cache.
+		 * Least recently used files are evicted if the cache is larger.
+		 * NOTE: Call load() before using this function.
+		 * @return Maximum cache size, in MiB. (0 == unlimited)
+		 */
+		uint32_t cacheMaxSize(void) const;
+
+		/**
+		 * Maximum age of files in the rom-properties cache.
+		 * Older files are revalidated with the server before they're used.
+		 * NOTE: Call load() before using this function.
+		 * @return Maximum cache file age, in days. (0 == unlimited)
+		 */
+		uint32_t cacheMaxAge(void) const;
+
+		/**
+		 * Pack small files in the rom-properties cache into pack files?
+		 * NOTE: Call load() before using this function.
+		 * @return True if we should; false if not.
+		 */
+		bool cachePackSmallFiles(void) const;
+
 		/** DMG title screen mode **/
 
 		enum DMG_TitleScreen_Mode : uint8_t {
@@ -57,10 +57,18 @@ const uint8_t RpImageLoaderPrivate::jpeg_magic_2[4] =
 
 /**
  * Load an image from an IRpFile.
- * @param file IRpFile to load from.
+ *
+ * If targetSize is specified, the image may be decoded at
+ * a reduced size if the format supports it.
+ * The larger dimension will still be at least targetSize.
+ *
+ * @param file		[in] IRpFile to load from.
+ * @param targetSize	[in,opt] Target size. (0 for full size)
+ * @param pOrigWidth	[out,opt] Original image width, before scaling.
+ * @param pOrigHeight	[out,opt] Original image height, before scaling.
  * @return rp_image*, or nullptr on error.
  */
-rp_image *RpImageLoader::load(IRpFile *file)
+rp_image *RpImageLoader::load(IRpFile *file, int targetSize, int *pOrigWidth, int *pOrigHeight)
 {
 	file->rewind();
 
@@ -73,7 +81,7 @@ rp_image *RpImageLoader::load(IRpFile *file)
 		     sizeof(RpImageLoaderPrivate::png_magic)))
 		{
 			// Found a PNG image.
-			return RpPng::load(file);
+			return RpPng::load(file, targetSize, pOrigWidth, pOrigHeight);
 		}
 #ifdef HAVE_JPEG
 		else if (!memcmp(buf, RpImageLoaderPrivate::jpeg_magic_1,
@@ -82,7 +90,7 @@ rp_image *RpImageLoader::load(IRpFile *file)
 			  sizeof(RpImageLoaderPrivate::jpeg_magic_2)))
 		{
 			// Found a JPEG image.
-			return RpJpeg::load(file);
+			return RpJpeg::load(file, targetSize, pOrigWidth, pOrigHeight);
 		}
 #endif /* HAVE_JPEG */
 	}
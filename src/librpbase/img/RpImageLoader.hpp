@@ -31,10 +31,19 @@ class RpImageLoader
 	public:
 		/**
 		 * Load an image from an IRpFile.
-		 * @param file IRpFile to load from.
+		 *
+		 * If targetSize is specified, the image may be decoded at
+		 * a reduced size if the format supports it.
+		 * The larger dimension will still be at least targetSize.
+		 *
+		 * @param file		[in] IRpFile to load from.
+		 * @param targetSize	[in,opt] Target size. (0 for full size)
+		 * @param pOrigWidth	[out,opt] Original image width, before scaling.
+		 * @param pOrigHeight	[out,opt] Original image height, before scaling.
 		 * @return rp_image*, or nullptr on error.
 		 */
-		static LibRpTexture::rp_image *load(LibRpFile::IRpFile *file);
+		static LibRpTexture::rp_image *load(LibRpFile::IRpFile *file, int targetSize = 0,
+			int *pOrigWidth = nullptr, int *pOrigHeight = nullptr);
 };
 
 }
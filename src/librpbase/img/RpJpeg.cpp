@@ -207,10 +207,18 @@ void RpJpegPrivate::jpeg_IRpFile_src(j_decompress_ptr cinfo, IRpFile *infile)
 
 /**
  * Load a JPEG image from an IRpFile.
- * @param file IRpFile to load from.
+ *
+ * If targetSize is specified, libjpeg's DCT scaling is used to
+ * decode the image at 1/2, 1/4, or 1/8 size. The smallest scale
+ * where the larger dimension is still at least targetSize is used.
+ *
+ * @param file		[in] IRpFile to load from.
+ * @param targetSize	[in,opt] Target size. (0 for full size)
+ * @param pOrigWidth	[out,opt] Original image width, before scaling.
+ * @param pOrigHeight	[out,opt] Original image height, before scaling.
  * @return rp_image*, or nullptr on error.
  */
-rp_image *RpJpeg::load(IRpFile *file)
+rp_image *RpJpeg::load(IRpFile *file, int targetSize, int *pOrigWidth, int *pOrigHeight)
 {
 	if (!file)
 		return nullptr;
@@ -288,6 +296,19 @@ rp_image *RpJpeg::load(IRpFile *file)
 	}
 
 	/** Step 4: Set parameters for decompression. **/
+	if (targetSize > 0) {
+		// Use DCT scaling to decode a smaller image.
+		// libjpeg rounds the output size up, so this will
+		// never be smaller than targetSize.
+		const unsigned int maxdim = std::max(cinfo.image_width, cinfo.image_height);
+		unsigned int denom = 8;
+		while (denom > 1 && ((maxdim + denom - 1) / denom) < static_cast<unsigned int>(targetSize)) {
+			denom /= 2;
+		}
+		cinfo.scale_num = 1;
+		cinfo.scale_denom = denom;
+	}
+
 	// Make sure we use libjpeg's built-in colorspace conversion
 	// where possible.
 	switch (cinfo.jpeg_color_space) {
@@ -386,7 +407,7 @@ rp_image *RpJpeg::load(IRpFile *file)
 				return nullptr;
 			}
 
-			img = new rp_image(cinfo.image_width, cinfo.image_height, rp_image::Format::ARGB32);
+			img = new rp_image(cinfo.output_width, cinfo.output_height, rp_image::Format::ARGB32);
 			if (!img->isValid()) {
 				// Could not allocate the image.
 				jpeg_destroy_decompress(&cinfo);
@@ -407,7 +428,7 @@ rp_image *RpJpeg::load(IRpFile *file)
 				return nullptr;
 			}
 
-			img = new rp_image(cinfo.image_width, cinfo.image_height, rp_image::Format::ARGB32);
+			img = new rp_image(cinfo.output_width, cinfo.output_height, rp_image::Format::ARGB32);
 			if (!img->isValid()) {
 				// Could not allocate the image.
 				jpeg_destroy_decompress(&cinfo);
@@ -426,7 +447,7 @@ rp_image *RpJpeg::load(IRpFile *file)
 				return nullptr;
 			}
 
-			img = new rp_image(cinfo.image_width, cinfo.image_height, rp_image::Format::ARGB32);
+			img = new rp_image(cinfo.output_width, cinfo.output_height, rp_image::Format::ARGB32);
 			if (!img->isValid()) {
 				// Could not allocate the image.
 				jpeg_destroy_decompress(&cinfo);
@@ -575,6 +596,14 @@ rp_image *RpJpeg::load(IRpFile *file)
 	// with the stdio data source (and IRpFile).
 	jpeg_finish_decompress(&cinfo);
 
+	// Original image size, before DCT scaling.
+	if (pOrigWidth) {
+		*pOrigWidth = static_cast<int>(cinfo.image_width);
+	}
+	if (pOrigHeight) {
+		*pOrigHeight = static_cast<int>(cinfo.image_height);
+	}
+
 	/** Step 8: Release JPEG decompression object. **/
 	// This will automatically free any memory allocated using
 	// libjpeg's allocation functions.
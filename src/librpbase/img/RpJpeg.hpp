@@ -31,10 +31,19 @@ class RpJpeg
 	public:
 		/**
 		 * Load a JPEG image from an IRpFile.
-		 * @param file IRpFile to load from.
+		 *
+		 * If targetSize is specified, libjpeg's DCT scaling is used to
+		 * decode the image at 1/2, 1/4, or 1/8 size. The smallest scale
+		 * where the larger dimension is still at least targetSize is used.
+		 *
+		 * @param file		[in] IRpFile to load from.
+		 * @param targetSize	[in,opt] Target size. (0 for full size)
+		 * @param pOrigWidth	[out,opt] Original image width, before scaling.
+		 * @param pOrigHeight	[out,opt] Original image height, before scaling.
 		 * @return rp_image*, or nullptr on error.
 		 */
-		static LibRpTexture::rp_image *load(LibRpFile::IRpFile *file);
+		static LibRpTexture::rp_image *load(LibRpFile::IRpFile *file, int targetSize = 0,
+			int *pOrigWidth = nullptr, int *pOrigHeight = nullptr);
 };
 
 }
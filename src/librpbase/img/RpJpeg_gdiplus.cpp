@@ -36,11 +36,19 @@ namespace LibRpBase {
 
 /**
  * Load a JPEG image from an IRpFile.
- * @param file IRpFile to load from.
+ *
+ * NOTE: GDI+ doesn't support DCT scaling, so the image
+ * is always decoded at full size.
+ *
+ * @param file		[in] IRpFile to load from.
+ * @param targetSize	[in,opt] Target size. (ignored)
+ * @param pOrigWidth	[out,opt] Original image width.
+ * @param pOrigHeight	[out,opt] Original image height.
  * @return rp_image*, or nullptr on error.
  */
-rp_image *RpJpeg::load(IRpFile *file)
+rp_image *RpJpeg::load(IRpFile *file, int targetSize, int *pOrigWidth, int *pOrigHeight)
 {
+	RP_UNUSED(targetSize);
 	if (!file)
 		return nullptr;
 
@@ -58,7 +66,14 @@ rp_image *RpJpeg::load(IRpFile *file)
 
 	// Create an rp_image using the GDI+ bitmap.
 	RpGdiplusBackend *const backend = new RpGdiplusBackend(pGdipBmp);
-	return new rp_image(backend);
+	rp_image *const img = new rp_image(backend);
+	if (pOrigWidth) {
+		*pOrigWidth = img->width();
+	}
+	if (pOrigHeight) {
+		*pOrigHeight = img->height();
+	}
+	return img;
 }
 
 }
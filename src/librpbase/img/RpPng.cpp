@@ -143,13 +143,40 @@ class RpPngPrivate
 		static void Read_CI8_Palette(png_structp png_ptr, png_infop info_ptr,
 					     int color_type, rp_image *img);
 
+		/**
+		 * Add an ARGB32 row to the reduced-size accumulator row.
+		 * Color channels are weighted by alpha so fully-transparent
+		 * pixels don't bleed into the visible pixels.
+		 * @param accum		[in,out] Accumulator row. (4 values per destination pixel)
+		 * @param src		[in] Source row.
+		 * @param width		[in] Source width, in pixels.
+		 * @param factor	[in] Reduction factor.
+		 */
+		static void accumRow_ARGB32(uint64_t *accum, const argb32_t *src,
+					    unsigned int width, unsigned int factor);
+
+		/**
+		 * Store the reduced-size accumulator row in a destination row.
+		 * @param dest		[out] Destination row.
+		 * @param accum		[in] Accumulator row. (4 values per destination pixel)
+		 * @param width		[in] Source width, in pixels.
+		 * @param factor	[in] Reduction factor.
+		 * @param rows		[in] Number of source rows in the accumulator.
+		 */
+		static void storeRow_ARGB32(argb32_t *dest, const uint64_t *accum,
+					    unsigned int width, unsigned int factor, unsigned int rows);
+
 		/**
 		 * Load a PNG image from an opened PNG handle.
-		 * @param png_ptr png_structp
-		 * @param info_ptr png_infop
+		 * @param png_ptr	[in] png_structp
+		 * @param info_ptr	[in] png_infop
+		 * @param targetSize	[in] Target size. (0 for full size)
+		 * @param pOrigWidth	[out,opt] Original image width, before scaling.
+		 * @param pOrigHeight	[out,opt] Original image height, before scaling.
 		 * @return rp_image*, or nullptr on error.
 		 */
-		static rp_image *loadPng(png_structp png_ptr, png_infop info_ptr);
+		static rp_image *loadPng(png_structp png_ptr, png_infop info_ptr,
+					 int targetSize, int *pOrigWidth, int *pOrigHeight);
 };
 
 /** RpPngPrivate **/
@@ -327,18 +354,84 @@ void RpPngPrivate::Read_CI8_Palette(png_structp png_ptr, png_infop info_ptr,
 	}
 }
 
+/**
+ * Add an ARGB32 row to the reduced-size accumulator row.
+ * Color channels are weighted by alpha so fully-transparent
+ * pixels don't bleed into the visible pixels.
+ * @param accum		[in,out] Accumulator row. (4 values per destination pixel)
+ * @param src		[in] Source row.
+ * @param width		[in] Source width, in pixels.
+ * @param factor	[in] Reduction factor.
+ */
+void RpPngPrivate::accumRow_ARGB32(uint64_t *accum, const argb32_t *src,
+				   unsigned int width, unsigned int factor)
+{
+	for (unsigned int x = 0; x < width; accum += 4) {
+		const unsigned int x_end = std::min(x + factor, width);
+		uint32_t sum_a = 0, sum_r = 0, sum_g = 0, sum_b = 0;
+		for (; x < x_end; x++, src++) {
+			const unsigned int a = src->a;
+			sum_a += a;
+			sum_r += src->r * a;
+			sum_g += src->g * a;
+			sum_b += src->b * a;
+		}
+		accum[0] += sum_a;
+		accum[1] += sum_r;
+		accum[2] += sum_g;
+		accum[3] += sum_b;
+	}
+}
+
+/**
+ * Store the reduced-size accumulator row in a destination row.
+ * @param dest		[out] Destination row.
+ * @param accum		[in] Accumulator row. (4 values per destination pixel)
+ * @param width		[in] Source width, in pixels.
+ * @param factor	[in] Reduction factor.
+ * @param rows		[in] Number of source rows in the accumulator.
+ */
+void RpPngPrivate::storeRow_ARGB32(argb32_t *dest, const uint64_t *accum,
+				   unsigned int width, unsigned int factor, unsigned int rows)
+{
+	for (unsigned int x = 0; x < width; x += factor, dest++, accum += 4) {
+		// The last column may be narrower than the reduction factor.
+		const uint64_t count = static_cast<uint64_t>(std::min(factor, width - x)) * rows;
+		const uint64_t sum_a = accum[0];
+		if (sum_a == 0) {
+			// Fully transparent.
+			dest->u32 = 0;
+			continue;
+		}
+
+		dest->a = static_cast<uint8_t>((sum_a + (count / 2)) / count);
+		dest->r = static_cast<uint8_t>((accum[1] + (sum_a / 2)) / sum_a);
+		dest->g = static_cast<uint8_t>((accum[2] + (sum_a / 2)) / sum_a);
+		dest->b = static_cast<uint8_t>((accum[3] + (sum_a / 2)) / sum_a);
+	}
+}
+
 /**
  * Load a PNG image from an opened PNG handle.
- * @param png_ptr png_structp
- * @param info_ptr png_infop
+ * @param png_ptr	[in] png_structp
+ * @param info_ptr	[in] png_infop
+ * @param targetSize	[in] Target size. (0 for full size)
+ * @param pOrigWidth	[out,opt] Original image width, before scaling.
+ * @param pOrigHeight	[out,opt] Original image height, before scaling.
  * @return rp_image*, or nullptr on error.
  */
-rp_image *RpPngPrivate::loadPng(png_structp png_ptr, png_infop info_ptr)
+rp_image *RpPngPrivate::loadPng(png_structp png_ptr, png_infop info_ptr,
+				int targetSize, int *pOrigWidth, int *pOrigHeight)
 {
 	// Row pointers. (NOTE: Allocated after IHDR is read.)
 	const png_byte **row_pointers = nullptr;
 	rp_image *img = nullptr;
 
+	// Reduced-size decoding buffers.
+	// NOTE: volatile because these are assigned after setjmp().
+	png_bytep volatile row_buf = nullptr;
+	uint64_t *volatile accum = nullptr;
+
 	bool has_sBIT = false;
 	png_color_8p png_sBIT = nullptr;
 	png_color_8 png_sBIT_fake;	// if sBIT isn't found
@@ -348,6 +441,8 @@ rp_image *RpPngPrivate::loadPng(png_structp png_ptr, png_infop info_ptr)
 	if (setjmp(png_jmpbuf(png_ptr))) {
 		// PNG read failed.
 		png_free(png_ptr, row_pointers);
+		png_free(png_ptr, row_buf);
+		png_free(png_ptr, accum);
 		UNREF(img);
 		return nullptr;
 	}
@@ -507,34 +602,102 @@ rp_image *RpPngPrivate::loadPng(png_structp png_ptr, png_infop info_ptr)
 	// Update the PNG info.
 	png_read_update_info(png_ptr, info_ptr);
 
-	// Create the rp_image.
-
-	// Initialize the row pointers array.
-	img = new rp_image(width, height, fmt);
-	if (!img->isValid()) {
-		// Could not allocate the image.
-		img->unref();
-		return nullptr;
+	// Determine the reduction factor.
+	// Interlaced images need the full image buffer for all
+	// seven Adam7 passes, so they're always decoded at full size.
+	// TCreateThumbnail will rescale them afterwards.
+	unsigned int factor = 1;
+	if (targetSize > 0 && png_get_interlace_type(png_ptr, info_ptr) == PNG_INTERLACE_NONE) {
+		factor = std::max(width, height) / static_cast<unsigned int>(targetSize);
 	}
 
-	// Allocate the row pointers.
-	row_pointers = static_cast<const png_byte**>(
-		png_malloc(png_ptr, sizeof(const png_byte*) * height));
-	if (!row_pointers) {
-		img->unref();
-		return nullptr;
-	}
+	if (factor <= 1) {
+		// Full-size decoding.
+		img = new rp_image(width, height, fmt);
+		if (!img->isValid()) {
+			// Could not allocate the image.
+			img->unref();
+			return nullptr;
+		}
+
+		// Allocate the row pointers.
+		row_pointers = static_cast<const png_byte**>(
+			png_malloc(png_ptr, sizeof(const png_byte*) * height));
+		if (!row_pointers) {
+			img->unref();
+			return nullptr;
+		}
+
+		// Initialize the row pointers array.
+		const png_byte *pb = static_cast<const png_byte*>(img->bits());
+		const int stride = img->stride();
+		for (png_uint_32 y = 0; y < height; y++, pb += stride) {
+			row_pointers[y] = pb;
+		}
 
-	// Initialize the row pointers array.
-	const png_byte *pb = static_cast<const png_byte*>(img->bits());
-	const int stride = img->stride();
-	for (png_uint_32 y = 0; y < height; y++, pb += stride) {
-		row_pointers[y] = pb;
+		// Read the image.
+		png_read_image(png_ptr, const_cast<png_byte**>(row_pointers));
+		png_free(png_ptr, row_pointers);
+	} else {
+		// Reduced-size decoding.
+		// Rows are read one at a time and downsampled on the fly,
+		// so only a single source row is stored in memory.
+		const unsigned int dest_width = (width + factor - 1) / factor;
+		const unsigned int dest_height = (height + factor - 1) / factor;
+		img = new rp_image(dest_width, dest_height, fmt);
+		if (!img->isValid()) {
+			// Could not allocate the image.
+			img->unref();
+			return nullptr;
+		}
+
+		row_buf = static_cast<png_bytep>(png_malloc(png_ptr, png_get_rowbytes(png_ptr, info_ptr)));
+		if (fmt == rp_image::Format::ARGB32) {
+			accum = static_cast<uint64_t*>(png_malloc(png_ptr, dest_width * 4 * sizeof(uint64_t)));
+		}
+		if (!row_buf || (fmt == rp_image::Format::ARGB32 && !accum)) {
+			png_free(png_ptr, row_buf);
+			png_free(png_ptr, accum);
+			img->unref();
+			return nullptr;
+		}
+
+		for (png_uint_32 y = 0; y < height; y++) {
+			png_read_row(png_ptr, row_buf, nullptr);
+			const unsigned int row_in_block = y % factor;
+
+			if (fmt == rp_image::Format::CI8) {
+				// Palette indexes can't be averaged.
+				// Use the top-left pixel of each block.
+				if (row_in_block != 0)
+					continue;
+				uint8_t *dest = static_cast<uint8_t*>(img->scanLine(y / factor));
+				for (unsigned int x = 0; x < width; x += factor, dest++) {
+					*dest = row_buf[x];
+				}
+				continue;
+			}
+
+			if (row_in_block == 0) {
+				memset(accum, 0, dest_width * 4 * sizeof(uint64_t));
+			}
+			accumRow_ARGB32(accum, reinterpret_cast<const argb32_t*>(row_buf), width, factor);
+			if (row_in_block == factor - 1 || y == height - 1) {
+				storeRow_ARGB32(static_cast<argb32_t*>(img->scanLine(y / factor)),
+					accum, width, factor, row_in_block + 1);
+			}
+		}
+
+		png_free(png_ptr, row_buf);
+		png_free(png_ptr, accum);
 	}
 
-	// Read the image.
-	png_read_image(png_ptr, const_cast<png_byte**>(row_pointers));
-	png_free(png_ptr, row_pointers);
+	if (pOrigWidth) {
+		*pOrigWidth = static_cast<int>(width);
+	}
+	if (pOrigHeight) {
+		*pOrigHeight = static_cast<int>(height);
+	}
 
 	// If CI8, read the palette.
 	if (fmt == rp_image::Format::CI8) {
@@ -560,10 +723,23 @@ rp_image *RpPngPrivate::loadPng(png_structp png_ptr, png_infop info_ptr)
 
 /**
  * Load a PNG image from an IRpFile.
- * @param file IRpFile to load from.
+ *
+ * If targetSize is specified, the image is decoded one row at
+ * a time and downsampled by an integer factor on the fly, so
+ * the full-size image is never stored in memory. The largest
+ * factor where the larger dimension is still at least targetSize
+ * is used. ARGB32 images are area-averaged; CI8 images use
+ * nearest-neighbor sampling in order to keep the palette.
+ *
+ * NOTE: Interlaced images are always decoded at full size.
+ *
+ * @param file		[in] IRpFile to load from.
+ * @param targetSize	[in,opt] Target size. (0 for full size)
+ * @param pOrigWidth	[out,opt] Original image width, before scaling.
+ * @param pOrigHeight	[out,opt] Original image height, before scaling.
  * @return rp_image*, or nullptr on error.
  */
-rp_image *RpPng::load(IRpFile *file)
+rp_image *RpPng::load(IRpFile *file, int targetSize, int *pOrigWidth, int *pOrigHeight)
 {
 	if (!file)
 		return nullptr;
@@ -607,7 +783,8 @@ rp_image *RpPng::load(IRpFile *file)
 	png_set_read_fn(png_ptr, file, RpPngPrivate::png_io_IRpFile_read);
 
 	// Call the actual PNG image reading function.
-	rp_image *img = RpPngPrivate::loadPng(png_ptr, info_ptr);
+	rp_image *img = RpPngPrivate::loadPng(png_ptr, info_ptr,
+		targetSize, pOrigWidth, pOrigHeight);
 
 	// Free the PNG structs.
 	png_destroy_read_struct(&png_ptr, &info_ptr, nullptr);
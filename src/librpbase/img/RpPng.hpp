@@ -33,10 +33,24 @@ class RpPng
 	public:
 		/**
 		 * Load a PNG image from an IRpFile.
-		 * @param file IRpFile to load from.
+		 *
+		 * If targetSize is specified, the image is decoded one row at
+		 * a time and downsampled by an integer factor on the fly, so
+		 * the full-size image is never stored in memory. The largest
+		 * factor where the larger dimension is still at least targetSize
+		 * is used. ARGB32 images are area-averaged; CI8 images use
+		 * nearest-neighbor sampling in order to keep the palette.
+		 *
+		 * NOTE: Interlaced images are always decoded at full size.
+		 *
+		 * @param file		[in] IRpFile to load from.
+		 * @param targetSize	[in,opt] Target size. (0 for full size)
+		 * @param pOrigWidth	[out,opt] Original image width, before scaling.
+		 * @param pOrigHeight	[out,opt] Original image height, before scaling.
 		 * @return rp_image*, or nullptr on error.
 		 */
-		static LibRpTexture::rp_image *load(LibRpFile::IRpFile *file);
+		static LibRpTexture::rp_image *load(LibRpFile::IRpFile *file, int targetSize = 0,
+			int *pOrigWidth = nullptr, int *pOrigHeight = nullptr);
 
 		/**
 		 * Save an image in PNG format to an IRpFile.
@@ -118,26 +118,38 @@ class RpPngWriterPrivate
 		// ref() is done here if needed.
 		RpPngWriterPrivate(IRpFile *file, int width, int height, rp_image::Format format)
 			: lastError(0), file(nullptr), imageTag(ImageTag::Invalid)
-			, png_ptr(nullptr), info_ptr(nullptr), IHDR_written(false)
+			, png_ptr(nullptr), info_ptr(nullptr)
+			, compressionProfile(RpPngWriter::CompressionProfile::Default)
+			, parallelDeflate(PARALLEL_DEFLATE_DEFAULT)
+			, IHDR_written(false), has_trailing_text(false)
 		{
 			init(file, width, height, format);
 		}
 		RpPngWriterPrivate(IRpFile *file, const rp_image *img)
 			: lastError(0), file(nullptr), imageTag(ImageTag::Invalid)
-			, png_ptr(nullptr), info_ptr(nullptr), IHDR_written(false)
+			, png_ptr(nullptr), info_ptr(nullptr)
+			, compressionProfile(RpPngWriter::CompressionProfile::Default)
+			, parallelDeflate(PARALLEL_DEFLATE_DEFAULT)
+			, IHDR_written(false), has_trailing_text(false)
 		{
 			init(file, img);
 		}
 		RpPngWriterPrivate(IRpFile *file, const IconAnimData *iconAnimData)
 			: lastError(0), file(nullptr), imageTag(ImageTag::Invalid)
-			, png_ptr(nullptr), info_ptr(nullptr), IHDR_written(false)
+			, png_ptr(nullptr), info_ptr(nullptr)
+			, compressionProfile(RpPngWriter::CompressionProfile::Default)
+			, parallelDeflate(PARALLEL_DEFLATE_DEFAULT)
+			, IHDR_written(false), has_trailing_text(false)
 		{
 			init(file, iconAnimData);
 		}
 
 		RpPngWriterPrivate(const char *filename, int width, int height, rp_image::Format format)
 			: lastError(0), file(nullptr), imageTag(ImageTag::Invalid)
-			, png_ptr(nullptr), info_ptr(nullptr), IHDR_written(false)
+			, png_ptr(nullptr), info_ptr(nullptr)
+			, compressionProfile(RpPngWriter::CompressionProfile::Default)
+			, parallelDeflate(PARALLEL_DEFLATE_DEFAULT)
+			, IHDR_written(false), has_trailing_text(false)
 		{
 			RpFile *const file = (filename ? new RpFile(filename, RpFile::FM_CREATE_WRITE) : nullptr);
 			init(file, width, height, format);
@@ -145,7 +157,10 @@ class RpPngWriterPrivate
 		}
 		RpPngWriterPrivate(const char *filename, const rp_image *img)
 			: lastError(0), file(nullptr), imageTag(ImageTag::Invalid)
-			, png_ptr(nullptr), info_ptr(nullptr), IHDR_written(false)
+			, png_ptr(nullptr), info_ptr(nullptr)
+			, compressionProfile(RpPngWriter::CompressionProfile::Default)
+			, parallelDeflate(PARALLEL_DEFLATE_DEFAULT)
+			, IHDR_written(false), has_trailing_text(false)
 		{
 			RpFile *const file = (filename ? new RpFile(filename, RpFile::FM_CREATE_WRITE) : nullptr);
 			init(file, img);
@@ -153,7 +168,10 @@ class RpPngWriterPrivate
 		}
 		RpPngWriterPrivate(const char *filename, const IconAnimData *iconAnimData)
 			: lastError(0), file(nullptr), imageTag(ImageTag::Invalid)
-			, png_ptr(nullptr), info_ptr(nullptr), IHDR_written(false)
+			, png_ptr(nullptr), info_ptr(nullptr)
+			, compressionProfile(RpPngWriter::CompressionProfile::Default)
+			, parallelDeflate(PARALLEL_DEFLATE_DEFAULT)
+			, IHDR_written(false), has_trailing_text(false)
 		{
 			RpFile *const file = (filename ? new RpFile(filename, RpFile::FM_CREATE_WRITE) : nullptr);
 			init(file, iconAnimData);
@@ -274,8 +292,38 @@ class RpPngWriterPrivate
 		png_structp png_ptr;
 		png_infop info_ptr;
 
+		// Compression settings.
+		RpPngWriter::CompressionProfile compressionProfile;
+		bool parallelDeflate;
+
 		// Current state.
 		bool IHDR_written;
+		bool has_trailing_text;	// tEXt chunks were added after IHDR.
+
+	public:
+		/**
+		 * Parallel deflate band size, in bytes of filtered image data.
+		 * Bands are rounded up to whole rows.
+		 *
+		 * NOTE: This is a fixed size instead of being based on the
+		 * number of threads, so the output is the same everywhere.
+		 */
+		static const size_t PARALLEL_DEFLATE_BAND_SIZE = 128U*1024U;
+
+		/**
+		 * Minimum filtered image size for parallel deflate.
+		 * Smaller images are compressed by libpng.
+		 */
+		static const size_t PARALLEL_DEFLATE_MIN_SIZE = 2U*PARALLEL_DEFLATE_BAND_SIZE;
+
+		// Parallel deflate is only enabled by default if
+		// OpenMP is available. Otherwise, it would reduce
+		// the compression ratio for no benefit.
+#ifdef _OPENMP
+		static const bool PARALLEL_DEFLATE_DEFAULT = true;
+#else /* !_OPENMP */
+		static const bool PARALLEL_DEFLATE_DEFAULT = false;
+#endif /* _OPENMP */
 
 	public:
 		/**
@@ -308,6 +356,14 @@ class RpPngWriterPrivate
 	public:
 		/** Internal functions. **/
 
+		/**
+		 * Get the compression parameters for the current profile.
+		 * @param pLevel	[out] zlib compression level.
+		 * @param pStrategy	[out] zlib compression strategy.
+		 * @param pFilter	[out] PNG filter(s). (PNG_FILTER_*)
+		 */
+		void getCompressionParams(int *pLevel, int *pStrategy, int *pFilter) const;
+
 		/**
 		 * Write the palette from a CI8 image.
 		 * @return 0 on success; negative POSIX error code on error.
@@ -328,6 +384,25 @@ class RpPngWriterPrivate
 		 */
 		int write_IDAT(const png_byte *const *row_pointers, bool is_abgr = false);
 
+		/**
+		 * Write raw image data to the PNG image using parallel deflate.
+		 *
+		 * The image is filtered and split into row bands of at least
+		 * PARALLEL_DEFLATE_BAND_SIZE bytes. Each band is compressed
+		 * as a raw deflate stream primed with the last 32 KB of the
+		 * previous band, and the bands are concatenated into a single
+		 * zlib stream. (Same method as pigz.)
+		 *
+		 * libpng doesn't allow writing IDAT chunks using png_write_chunk()
+		 * followed by png_write_end(), so this function writes IEND and
+		 * closes the file. Trailing tEXt chunks are not supported.
+		 *
+		 * @param row_pointers PNG row pointers. Array must have cache.height elements.
+		 * @param is_abgr If true, image data is ABGR instead of ARGB.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		int write_IDAT_parallel(const png_byte *const *row_pointers, bool is_abgr);
+
 		/**
 		 * Write the rp_image data to the PNG image.
 		 *
@@ -663,6 +738,48 @@ void PNGCAPI RpPngWriterPrivate::png_io_IRpFile_flush(png_structp png_ptr)
 	// TODO: IRpFile::flush()
 }
 
+/**
+ * Get the compression parameters for the current profile.
+ * @param pLevel	[out] zlib compression level.
+ * @param pStrategy	[out] zlib compression strategy.
+ * @param pFilter	[out] PNG filter(s). (PNG_FILTER_*)
+ */
+void RpPngWriterPrivate::getCompressionParams(int *pLevel, int *pStrategy, int *pFilter) const
+{
+	switch (compressionProfile) {
+		case RpPngWriter::CompressionProfile::Fast:
+			*pLevel = 1;
+			if (cache.format == rp_image::Format::CI8) {
+				// Filtering palette indexes doesn't help, and Z_RLE
+				// is much worse than regular matching for CI8.
+				*pStrategy = Z_DEFAULT_STRATEGY;
+				*pFilter = PNG_FILTER_NONE;
+			} else {
+				// Z_RLE only looks for runs of the previous byte,
+				// which works well with the Sub filter.
+				*pStrategy = Z_RLE;
+				*pFilter = PNG_FILTER_SUB;
+			}
+			break;
+
+		default:
+			assert(!"Invalid compression profile.");
+			// fall-through
+		case RpPngWriter::CompressionProfile::Default:
+			*pLevel = PNG_Z_DEFAULT_COMPRESSION;
+			*pStrategy = Z_DEFAULT_STRATEGY;
+			*pFilter = PNG_FILTER_NONE;
+			break;
+
+		case RpPngWriter::CompressionProfile::Archival:
+			// libpng uses Z_FILTERED by default if filtering is enabled.
+			*pLevel = 9;
+			*pStrategy = Z_FILTERED;
+			*pFilter = PNG_ALL_FILTERS;
+			break;
+	}
+}
+
 /**
  * Write the palette from a CI8 image.
  * @return 0 on success; negative POSIX error code on error.
@@ -744,6 +861,28 @@ int RpPngWriterPrivate::write_IDAT(const png_byte *const *row_pointers, bool is_
 		return -lastError;
 	}
 
+	// Use parallel deflate for large images.
+	// NOTE: Not used for Archival, since adaptive filtering
+	// is handled by libpng.
+	if (parallelDeflate && !has_trailing_text &&
+	    compressionProfile != RpPngWriter::CompressionProfile::Archival)
+	{
+		size_t bpp;
+		if (cache.format == rp_image::Format::CI8) {
+			bpp = 1;
+		} else {
+#ifdef PNG_sBIT_SUPPORTED
+			bpp = (cache.skip_alpha ? 3 : 4);
+#else /* !PNG_sBIT_SUPPORTED */
+			bpp = 4;
+#endif /* PNG_sBIT_SUPPORTED */
+		}
+		const size_t filtered_size = (1 + (static_cast<size_t>(cache.width) * bpp)) * cache.height;
+		if (filtered_size >= PARALLEL_DEFLATE_MIN_SIZE) {
+			return write_IDAT_parallel(row_pointers, is_abgr);
+		}
+	}
+
 #ifdef PNG_SETJMP_SUPPORTED
 	// WARNING: Do NOT initialize any C++ objects past this point!
 	if (setjmp(png_jmpbuf(png_ptr))) {
@@ -776,6 +915,274 @@ int RpPngWriterPrivate::write_IDAT(const png_byte *const *row_pointers, bool is_
 	return 0;
 }
 
+/**
+ * Convert a row of image data to PNG byte order.
+ * @param dest		[out] Destination row. (width * bpp bytes)
+ * @param src		[in] Source row.
+ * @param width		[in] Width, in pixels.
+ * @param bpp		[in] Destination bytes per pixel. (1 == CI8, 3 == RGB, 4 == RGBA)
+ * @param is_abgr	[in] If true, image data is ABGR instead of ARGB.
+ */
+static void convertRowForPng(uint8_t *dest, const uint8_t *src, int width, unsigned int bpp, bool is_abgr)
+{
+	if (bpp == 1) {
+		// CI8: Copy as-is.
+		memcpy(dest, src, width);
+		return;
+	}
+
+	const argb32_t *px = reinterpret_cast<const argb32_t*>(src);
+	if (!is_abgr) {
+		for (; width > 0; width--, px++, dest += bpp) {
+			dest[0] = px->r;
+			dest[1] = px->g;
+			dest[2] = px->b;
+			if (bpp == 4) {
+				dest[3] = px->a;
+			}
+		}
+	} else {
+		// Red and blue are swapped.
+		for (; width > 0; width--, px++, dest += bpp) {
+			dest[0] = px->b;
+			dest[1] = px->g;
+			dest[2] = px->r;
+			if (bpp == 4) {
+				dest[3] = px->a;
+			}
+		}
+	}
+}
+
+/**
+ * Filter a row of PNG data.
+ * @param dest		[out] Destination row, starting with the filter type byte. (1 + row_bytes bytes)
+ * @param src		[in] Source row, in PNG byte order.
+ * @param row_bytes	[in] Row size, in bytes.
+ * @param bpp		[in] Bytes per pixel.
+ * @param filter	[in] PNG_FILTER_NONE or PNG_FILTER_SUB.
+ */
+static void filterRowForPng(uint8_t *dest, const uint8_t *src, size_t row_bytes, unsigned int bpp, int filter)
+{
+	switch (filter) {
+		default:
+			assert(!"Unsupported PNG filter for parallel deflate.");
+			// fall-through
+		case PNG_FILTER_NONE:
+			*dest++ = PNG_FILTER_VALUE_NONE;
+			memcpy(dest, src, row_bytes);
+			break;
+
+		case PNG_FILTER_SUB:
+			*dest++ = PNG_FILTER_VALUE_SUB;
+			memcpy(dest, src, bpp);
+			for (size_t i = bpp; i < row_bytes; i++) {
+				dest[i] = src[i] - src[i - bpp];
+			}
+			break;
+	}
+}
+
+/**
+ * Compress a band of filtered PNG data as a raw deflate stream.
+ * @param out		[out] Compressed data.
+ * @param data		[in] Filtered data.
+ * @param len		[in] Size of data.
+ * @param dict		[in,opt] Preset dictionary. (end of the previous band)
+ * @param dict_len	[in] Size of dict.
+ * @param level		[in] zlib compression level.
+ * @param strategy	[in] zlib compression strategy.
+ * @param last		[in] If true, this is the last band.
+ * @return True on success; false on error.
+ */
+static bool deflateBandForPng(ao::uvector<uint8_t> &out,
+	const uint8_t *data, size_t len,
+	const uint8_t *dict, size_t dict_len,
+	int level, int strategy, bool last)
+{
+	z_stream strm;
+	memset(&strm, 0, sizeof(strm));
+	// Negative window bits: Raw deflate. The zlib header and
+	// Adler-32 checksum are written by write_IDAT_parallel().
+	if (deflateInit2(&strm, level, Z_DEFLATED, -MAX_WBITS, 8, strategy) != Z_OK) {
+		return false;
+	}
+	if (dict_len > 0) {
+		deflateSetDictionary(&strm, dict, static_cast<uInt>(dict_len));
+	}
+
+	// NOTE: deflateBound() assumes Z_FINISH. Z_SYNC_FLUSH adds
+	// an empty stored block, which is at most 5 bytes.
+	out.resize(deflateBound(&strm, static_cast<uLong>(len)) + 16);
+	strm.next_in = const_cast<Bytef*>(data);
+	strm.avail_in = static_cast<uInt>(len);
+	strm.next_out = out.data();
+	strm.avail_out = static_cast<uInt>(out.size());
+
+	// Non-final bands end with Z_SYNC_FLUSH, which byte-aligns
+	// the output without setting the final block bit.
+	const int ret = deflate(&strm, last ? Z_FINISH : Z_SYNC_FLUSH);
+	const bool bOK = (last ? (ret == Z_STREAM_END) : (ret == Z_OK && strm.avail_out > 0));
+	out.resize(out.size() - strm.avail_out);
+	deflateEnd(&strm);
+	return bOK;
+}
+
+/**
+ * Write raw image data to the PNG image using parallel deflate.
+ *
+ * The image is filtered and split into row bands of at least
+ * PARALLEL_DEFLATE_BAND_SIZE bytes. Each band is compressed
+ * as a raw deflate stream primed with the last 32 KB of the
+ * previous band, and the bands are concatenated into a single
+ * zlib stream. (Same method as pigz.)
+ *
+ * libpng doesn't allow writing IDAT chunks using png_write_chunk()
+ * followed by png_write_end(), so this function writes IEND and
+ * closes the file. Trailing tEXt chunks are not supported.
+ *
+ * @param row_pointers PNG row pointers. Array must have cache.height elements.
+ * @param is_abgr If true, image data is ABGR instead of ARGB.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int RpPngWriterPrivate::write_IDAT_parallel(const png_byte *const *row_pointers, bool is_abgr)
+{
+	int level, strategy, filter;
+	getCompressionParams(&level, &strategy, &filter);
+
+	unsigned int bpp;
+	if (cache.format == rp_image::Format::CI8) {
+		bpp = 1;
+	} else {
+#ifdef PNG_sBIT_SUPPORTED
+		bpp = (cache.skip_alpha ? 3 : 4);
+#else /* !PNG_sBIT_SUPPORTED */
+		bpp = 4;
+#endif /* PNG_sBIT_SUPPORTED */
+	}
+	const size_t row_bytes = static_cast<size_t>(cache.width) * bpp;
+	const size_t filtered_row_bytes = row_bytes + 1;
+	const int height = cache.height;
+
+	// Band size, in rows.
+	const int band_rows = static_cast<int>(
+		(PARALLEL_DEFLATE_BAND_SIZE + filtered_row_bytes - 1) / filtered_row_bytes);
+	const int bands = (height + band_rows - 1) / band_rows;
+
+	// Filter the image.
+	// NOTE: Only None and Sub are supported here, so rows
+	// don't depend on the previous row.
+	ao::uvector<uint8_t> filtered(filtered_row_bytes * height);
+#pragma omp parallel for schedule(dynamic, 1)
+	for (int band = 0; band < bands; band++) {
+		const int rowBegin = band * band_rows;
+		const int rowEnd = std::min(rowBegin + band_rows, height);
+
+		unique_ptr<uint8_t[]> rowbuf(new uint8_t[row_bytes]);
+		uint8_t *dest = &filtered[filtered_row_bytes * rowBegin];
+		for (int y = rowBegin; y < rowEnd; y++, dest += filtered_row_bytes) {
+			convertRowForPng(rowbuf.get(), row_pointers[y], cache.width, bpp, is_abgr);
+			filterRowForPng(dest, rowbuf.get(), row_bytes, bpp, filter);
+		}
+	}
+
+	// Compress the bands.
+	// Each band is primed with the last 32 KB of the previous band,
+	// so the compression ratio is nearly the same as a single stream.
+	static const size_t DICT_SIZE = 32768;
+	vector<ao::uvector<uint8_t> > zbands(bands);
+	vector<uLong> adlers(bands);
+	bool bOK = true;
+#pragma omp parallel for schedule(dynamic, 1)
+	for (int band = 0; band < bands; band++) {
+		const size_t begin = filtered_row_bytes * (band * band_rows);
+		const size_t end = filtered_row_bytes * std::min((band + 1) * band_rows, height);
+		const size_t dict_len = std::min(begin, DICT_SIZE);
+		const uint8_t *const p = &filtered[begin];
+
+		adlers[band] = adler32(adler32(0, nullptr, 0), p, static_cast<uInt>(end - begin));
+		if (!deflateBandForPng(zbands[band], p, end - begin, p - dict_len, dict_len,
+		                       level, strategy, (band == bands - 1)))
+		{
+#pragma omp atomic write
+			bOK = false;
+		}
+	}
+	if (!bOK) {
+		lastError = ENOMEM;
+		return -lastError;
+	}
+
+	// zlib header: 32 KB window, deflate.
+	// FLEVEL is calculated the same way as zlib.
+	// FCHECK makes the header a multiple of 31.
+	unsigned int flevel;
+	if (strategy >= Z_HUFFMAN_ONLY || (level >= 0 && level < 2)) {
+		flevel = 0;
+	} else if (level >= 0 && level < 6) {
+		flevel = 1;
+	} else if (level < 0 || level == 6) {
+		flevel = 2;
+	} else {
+		flevel = 3;
+	}
+	uint8_t zhdr[2];
+	zhdr[0] = 0x78;
+	zhdr[1] = static_cast<uint8_t>(flevel << 6);
+	zhdr[1] += static_cast<uint8_t>(31 - (((zhdr[0] << 8) | zhdr[1]) % 31));
+
+	// Adler-32 trailer.
+	uLong adler = adlers[0];
+	for (int band = 1; band < bands; band++) {
+		const size_t len = filtered_row_bytes * (std::min((band + 1) * band_rows, height) - (band * band_rows));
+		adler = adler32_combine(adler, adlers[band], static_cast<z_off_t>(len));
+	}
+	uint8_t ztrailer[4];
+	ztrailer[0] = static_cast<uint8_t>(adler >> 24);
+	ztrailer[1] = static_cast<uint8_t>(adler >> 16);
+	ztrailer[2] = static_cast<uint8_t>(adler >> 8);
+	ztrailer[3] = static_cast<uint8_t>(adler);
+
+	static const png_byte chunk_IDAT[5] = {'I','D','A','T','\0'};
+	static const png_byte chunk_IEND[5] = {'I','E','N','D','\0'};
+
+#ifdef PNG_SETJMP_SUPPORTED
+	// WARNING: Do NOT initialize any C++ objects past this point!
+	if (setjmp(png_jmpbuf(png_ptr))) {
+		// PNG write failed.
+		return -EIO;
+	}
+#endif /* PNG_SETJMP_SUPPORTED */
+
+	// Write one IDAT chunk per band.
+	// The first chunk has the zlib header, and the
+	// last chunk has the Adler-32 trailer.
+	for (int band = 0; band < bands; band++) {
+		const ao::uvector<uint8_t> &zband = zbands[band];
+		const bool first = (band == 0);
+		const bool last = (band == bands - 1);
+		const size_t len = zband.size() + (first ? sizeof(zhdr) : 0) + (last ? sizeof(ztrailer) : 0);
+
+		png_write_chunk_start(png_ptr, PNG_CONST_CAST(png_bytep)(chunk_IDAT), static_cast<png_uint_32>(len));
+		if (first) {
+			png_write_chunk_data(png_ptr, zhdr, sizeof(zhdr));
+		}
+		png_write_chunk_data(png_ptr, PNG_CONST_CAST(png_bytep)(zband.data()), zband.size());
+		if (last) {
+			png_write_chunk_data(png_ptr, ztrailer, sizeof(ztrailer));
+		}
+		png_write_chunk_end(png_ptr);
+	}
+
+	// Finished writing.
+	png_write_chunk(png_ptr, PNG_CONST_CAST(png_bytep)(chunk_IEND), nullptr, 0);
+
+	// Free the PNG structs and unref() the file.
+	png_destroy_write_struct(&png_ptr, &info_ptr);
+	UNREF_AND_NULL_NOCHK(file);
+	return 0;
+}
+
 /**
  * Write the rp_image data to the PNG image.
  *
@@ -1087,6 +1494,39 @@ void RpPngWriter::close(void)
 	d->close();
 }
 
+/**
+ * Set the IDAT compression profile.
+ * This must be called before write_IHDR().
+ * @param profile	[in] Compression profile.
+ */
+void RpPngWriter::setCompressionProfile(CompressionProfile profile)
+{
+	RP_D(RpPngWriter);
+	assert(!d->IHDR_written);
+	d->compressionProfile = profile;
+}
+
+/**
+ * Enable or disable parallel deflate.
+ *
+ * If enabled, large images are split into fixed-size row bands,
+ * which are compressed independently (primed with the previous
+ * band's last 32 KB) and concatenated into a single zlib stream.
+ * The output does not depend on the number of threads.
+ *
+ * Parallel deflate is not used for the Archival profile,
+ * or if tEXt chunks were added after write_IHDR().
+ *
+ * Default is enabled if OpenMP is available.
+ *
+ * @param enable	[in] True to enable; false to disable.
+ */
+void RpPngWriter::setParallelDeflate(bool enable)
+{
+	RP_D(RpPngWriter);
+	d->parallelDeflate = enable;
+}
+
 /**
  * Write the PNG IHDR.
  * This must be called before writing any other image data.
@@ -1122,9 +1562,11 @@ int RpPngWriter::write_IHDR(void)
 #endif /* PNG_SETJMP_SUPPORTED */
 
 	// Initialize compression parameters.
-	// TODO: Customizable?
-	png_set_filter(d->png_ptr, 0, PNG_FILTER_NONE);
-	png_set_compression_level(d->png_ptr, PNG_Z_DEFAULT_COMPRESSION);
+	int level, strategy, filter;
+	d->getCompressionParams(&level, &strategy, &filter);
+	png_set_filter(d->png_ptr, 0, filter);
+	png_set_compression_level(d->png_ptr, level);
+	png_set_compression_strategy(d->png_ptr, strategy);
 
 	// Write the PNG header.
 	switch (d->cache.format) {
@@ -1388,6 +1830,10 @@ int RpPngWriter::write_tEXt(const kv_vector &kv)
 #endif /* PNG_SETJMP_SUPPORTED */
 
 	png_set_text(d->png_ptr, d->info_ptr, text.get(), static_cast<int>(kv.size()));
+	if (d->IHDR_written) {
+		// These tEXt chunks will be written after IDAT.
+		d->has_trailing_text = true;
+	}
 	std::for_each(vU8toL1.begin(), vU8toL1.end(), ::free);
 	return 0;
 }
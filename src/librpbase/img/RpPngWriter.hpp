@@ -172,6 +172,39 @@ class RpPngWriter
 		 */
 		void close(void);
 
+		/**
+		 * IDAT compression profile.
+		 */
+		enum class CompressionProfile {
+			Fast,		// zlib level 1; Z_RLE and Sub filter for ARGB32 (thumbnail caches)
+			Default,	// zlib default level, no filter
+			Archival,	// zlib level 9, adaptive filtering
+		};
+
+		/**
+		 * Set the IDAT compression profile.
+		 * This must be called before write_IHDR().
+		 * @param profile	[in] Compression profile.
+		 */
+		void setCompressionProfile(CompressionProfile profile);
+
+		/**
+		 * Enable or disable parallel deflate.
+		 *
+		 * If enabled, large images are split into fixed-size row bands,
+		 * which are compressed independently (primed with the previous
+		 * band's last 32 KB) and concatenated into a single zlib stream.
+		 * The output does not depend on the number of threads.
+		 *
+		 * Parallel deflate is not used for the Archival profile,
+		 * or if tEXt chunks were added after write_IHDR().
+		 *
+		 * Default is enabled if OpenMP is available.
+		 *
+		 * @param enable	[in] True to enable; false to disable.
+		 */
+		void setParallelDeflate(bool enable);
+
 		/**
 		 * Write the PNG IHDR.
 		 * This must be called before writing any other image data.
@@ -0,0 +1,197 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (librpbase/tests)                  *
+ * RpJpegScaleTest.cpp: RpJpeg reduced-size decoding test.                 *
+ *                                                                         *
+ * Copyright (c) 2016-2022 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+
+// librpcpu, librpbase
+#include "common.h"
+#include "config.librpbase.h"
+#include "img/RpImageLoader.hpp"
+
+// librpfile
+#include "librpfile/VectorFile.hpp"
+using namespace LibRpFile;
+
+// librptexture
+#include "librptexture/img/rp_image.hpp"
+using LibRpTexture::rp_image;
+
+// C includes. (C++ namespace)
+#include <cstdio>
+#include <cstdlib>
+
+// C++ includes.
+#include <algorithm>
+#include <ostream>
+#include <vector>
+
+// NOTE: The GDI+ JPEG loader doesn't support reduced-size decoding.
+// jpeg_mem_dest() requires libjpeg v8 or libjpeg-turbo.
+#if defined(HAVE_JPEG) && !defined(_WIN32)
+#  include <jpeglib.h>
+#  if JPEG_LIB_VERSION >= 80 || defined(MEM_SRCDST_SUPPORTED)
+#    define RPJPEG_SCALE_TEST 1
+#  endif
+#endif
+
+#ifdef RPJPEG_SCALE_TEST
+namespace LibRpBase { namespace Tests {
+
+struct RpJpegScaleTest_mode
+{
+	int targetSize;		// Target size passed to RpImageLoader::load()
+	unsigned int denom;	// Expected scale denominator (1/denom)
+
+	RpJpegScaleTest_mode(int targetSize, unsigned int denom)
+		: targetSize(targetSize)
+		, denom(denom)
+	{ }
+};
+
+inline ::std::ostream& operator<<(::std::ostream& os, const RpJpegScaleTest_mode& mode) {
+	return os << "target " << mode.targetSize << " -> 1/" << mode.denom;
+};
+
+class RpJpegScaleTest : public ::testing::TestWithParam<RpJpegScaleTest_mode>
+{
+	protected:
+		// Test image dimensions.
+		static const int IMG_WIDTH = 1024;
+		static const int IMG_HEIGHT = 768;
+
+		static void SetUpTestCase(void);
+		static void TearDownTestCase(void);
+
+	public:
+		// JPEG image, shared by all test cases.
+		static std::vector<uint8_t> ms_jpeg_buf;
+
+		/**
+		 * Encode an RGB gradient as a JPEG image in memory.
+		 * @param buf		[out] JPEG image
+		 * @param width		[in] Width
+		 * @param height	[in] Height
+		 */
+		static void encodeJpeg(std::vector<uint8_t> &buf, int width, int height);
+};
+
+std::vector<uint8_t> RpJpegScaleTest::ms_jpeg_buf;
+
+/**
+ * Encode an RGB gradient as a JPEG image in memory.
+ * @param buf		[out] JPEG image
+ * @param width		[in] Width
+ * @param height	[in] Height
+ */
+void RpJpegScaleTest::encodeJpeg(std::vector<uint8_t> &buf, int width, int height)
+{
+	struct jpeg_compress_struct cinfo;
+	struct jpeg_error_mgr jerr;
+	cinfo.err = jpeg_std_error(&jerr);
+	jpeg_create_compress(&cinfo);
+
+	unsigned char *outbuffer = nullptr;
+	unsigned long outsize = 0;
+	jpeg_mem_dest(&cinfo, &outbuffer, &outsize);
+
+	cinfo.image_width = width;
+	cinfo.image_height = height;
+	cinfo.input_components = 3;
+	cinfo.in_color_space = JCS_RGB;
+	jpeg_set_defaults(&cinfo);
+	jpeg_set_quality(&cinfo, 75, TRUE);
+	jpeg_start_compress(&cinfo, TRUE);
+
+	std::vector<uint8_t> row(width * 3);
+	while (cinfo.next_scanline < cinfo.image_height) {
+		const unsigned int y = cinfo.next_scanline;
+		for (int x = 0; x < width; x++) {
+			row[x*3 + 0] = static_cast<uint8_t>(x * 255 / width);
+			row[x*3 + 1] = static_cast<uint8_t>(y * 255 / height);
+			row[x*3 + 2] = 0x80;
+		}
+		JSAMPROW row_pointer = row.data();
+		jpeg_write_scanlines(&cinfo, &row_pointer, 1);
+	}
+
+	jpeg_finish_compress(&cinfo);
+	jpeg_destroy_compress(&cinfo);
+
+	buf.assign(outbuffer, outbuffer + outsize);
+	free(outbuffer);
+}
+
+/**
+ * Encode the test image once for all test cases.
+ */
+void RpJpegScaleTest::SetUpTestCase(void)
+{
+	encodeJpeg(ms_jpeg_buf, IMG_WIDTH, IMG_HEIGHT);
+}
+
+/**
+ * Free the test image.
+ */
+void RpJpegScaleTest::TearDownTestCase(void)
+{
+	ms_jpeg_buf.clear();
+	ms_jpeg_buf.shrink_to_fit();
+}
+
+/**
+ * Load the JPEG image at the target size and check the scale.
+ */
+TEST_P(RpJpegScaleTest, scale)
+{
+	const RpJpegScaleTest_mode &mode = GetParam();
+	ASSERT_FALSE(ms_jpeg_buf.empty()) << "Could not encode the test JPEG image.";
+
+	unique_RefBase<VectorFile> vecFile(new VectorFile());
+	ASSERT_EQ(ms_jpeg_buf.size(), vecFile->write(ms_jpeg_buf.data(), ms_jpeg_buf.size()));
+	vecFile->rewind();
+
+	int origWidth = 0, origHeight = 0;
+	unique_RefBase<rp_image> img(RpImageLoader::load(vecFile.get(),
+		mode.targetSize, &origWidth, &origHeight));
+	ASSERT_TRUE((bool)img) << "Error loading the JPEG image.";
+	ASSERT_TRUE(img->isValid());
+
+	// The original size must be reported unscaled.
+	const int width = IMG_WIDTH, height = IMG_HEIGHT;
+	EXPECT_EQ(width, origWidth);
+	EXPECT_EQ(height, origHeight);
+
+	// Check the scale.
+	EXPECT_EQ(width / static_cast<int>(mode.denom), img->width());
+	EXPECT_EQ(height / static_cast<int>(mode.denom), img->height());
+
+	// The larger dimension must still be at least the target size,
+	// unless the original image is smaller than the target size.
+	EXPECT_GE(std::max(img->width(), img->height()),
+		std::min(mode.targetSize, std::max(width, height)));
+}
+
+// NOTE: The scale is chosen using the larger dimension. (1024)
+INSTANTIATE_TEST_SUITE_P(RpJpegScale, RpJpegScaleTest,
+	::testing::Values(
+		RpJpegScaleTest_mode(   0, 1),
+		RpJpegScaleTest_mode(2048, 1),
+		RpJpegScaleTest_mode(1024, 1),
+		RpJpegScaleTest_mode( 768, 1),
+		RpJpegScaleTest_mode( 512, 2),
+		RpJpegScaleTest_mode( 384, 2),
+		RpJpegScaleTest_mode( 256, 4),
+		RpJpegScaleTest_mode( 192, 4),
+		RpJpegScaleTest_mode( 128, 8),
+		RpJpegScaleTest_mode(  96, 8),
+		RpJpegScaleTest_mode(  16, 8))
+	);
+
+} }
+#endif /* RPJPEG_SCALE_TEST */
@@ -0,0 +1,482 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (librpbase/tests)                  *
+ * RpPngReducedTest.cpp: RpPng reduced-size decoding test.                 *
+ *                                                                         *
+ * Copyright (c) 2016-2022 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+
+// librpcpu, librpbase
+#include "common.h"
+#include "config.librpbase.h"
+#include "tcharx.h"	// for DIR_SEP_CHR
+#include "img/RpPng.hpp"
+
+#ifdef HAVE_PNG
+#  include <png.h>
+#endif /* HAVE_PNG */
+
+// librpfile
+#include "librpfile/RpFile.hpp"
+#include "librpfile/VectorFile.hpp"
+using namespace LibRpFile;
+
+// librptexture
+#include "librptexture/img/rp_image.hpp"
+using LibRpTexture::rp_image;
+using LibRpTexture::argb32_t;
+
+// C includes. (C++ namespace)
+#include "ctypex.h"
+#include <cstring>
+
+// C++ includes.
+#include <algorithm>
+#include <ostream>
+#include <string>
+#include <vector>
+using std::string;
+
+namespace LibRpBase { namespace Tests {
+
+class RpPngReducedTest : public ::testing::TestWithParam<string>
+{
+	protected:
+		RpPngReducedTest()
+			: ::testing::TestWithParam<string>()
+			, m_img(nullptr)
+		{ }
+
+		void TearDown(void) final;
+
+	public:
+		rp_image *m_img;
+
+	public:
+		/**
+		 * Create an ARGB32 test image made up of solid-color blocks.
+		 * @param width		[in] Width
+		 * @param height	[in] Height
+		 * @param blockSize	[in] Block size
+		 * @return rp_image
+		 */
+		static rp_image *createBlockImage(int width, int height, int blockSize);
+
+		/**
+		 * Get the color of a block in a block image.
+		 * @param bx	[in] Block X
+		 * @param by	[in] Block Y
+		 * @return ARGB32 color
+		 */
+		static inline uint32_t blockColor(int bx, int by)
+		{
+			return 0xFF000000U | ((bx * 37) & 0xFF) << 16 |
+				((by * 53) & 0xFF) << 8 | (((bx + by) * 11) & 0xFF);
+		}
+
+		/**
+		 * Save an rp_image to a PNG image in memory.
+		 * @param img	[in] rp_image
+		 * @return VectorFile containing the PNG image, or nullptr on error.
+		 */
+		static VectorFile *savePng(const rp_image *img);
+
+#ifdef HAVE_PNG
+		/**
+		 * Save an ARGB32 rp_image to an interlaced PNG image in memory.
+		 * RpPngWriter doesn't support interlacing, so libpng is used directly.
+		 * @param img	[in] rp_image
+		 * @return VectorFile containing the PNG image, or nullptr on error.
+		 */
+		static VectorFile *saveInterlacedPng(const rp_image *img);
+#endif /* HAVE_PNG */
+
+		/**
+		 * Compare two rp_images.
+		 * @param expected	[in] Expected image.
+		 * @param actual	[in] Actual image.
+		 */
+		static void compareImages(const rp_image *expected, const rp_image *actual);
+
+		/**
+		 * Downsample an image using the same method as RpPng.
+		 * This is the reference implementation for the streaming decoder.
+		 * @param img		[in] Full-size image
+		 * @param factor	[in] Reduction factor
+		 * @return Downsampled image
+		 */
+		static rp_image *downsample(const rp_image *img, int factor);
+
+		/**
+		 * Test case suffix generator.
+		 * @param info Test parameter information.
+		 * @return Test case suffix.
+		 */
+		static string test_case_suffix_generator(const ::testing::TestParamInfo<string> &info);
+};
+
+/**
+ * TearDown() function.
+ * Run after each test.
+ */
+void RpPngReducedTest::TearDown(void)
+{
+	UNREF_AND_NULL(m_img);
+}
+
+/**
+ * Create an ARGB32 test image made up of solid-color blocks.
+ * @param width		[in] Width
+ * @param height	[in] Height
+ * @param blockSize	[in] Block size
+ * @return rp_image
+ */
+rp_image *RpPngReducedTest::createBlockImage(int width, int height, int blockSize)
+{
+	rp_image *const img = new rp_image(width, height, rp_image::Format::ARGB32);
+	for (int y = 0; y < height; y++) {
+		uint32_t *const row = static_cast<uint32_t*>(img->scanLine(y));
+		for (int x = 0; x < width; x++) {
+			row[x] = blockColor(x / blockSize, y / blockSize);
+		}
+	}
+	return img;
+}
+
+/**
+ * Save an rp_image to a PNG image in memory.
+ * @param img	[in] rp_image
+ * @return VectorFile containing the PNG image, or nullptr on error.
+ */
+VectorFile *RpPngReducedTest::savePng(const rp_image *img)
+{
+	VectorFile *const vecFile = new VectorFile();
+	if (RpPng::save(vecFile, img) != 0) {
+		vecFile->unref();
+		return nullptr;
+	}
+	vecFile->rewind();
+	return vecFile;
+}
+
+#ifdef HAVE_PNG
+/**
+ * libpng I/O write handler for VectorFile.
+ * @param png_ptr	[in] PNG pointer.
+ * @param data		[in] Data to write.
+ * @param length	[in] Size of data.
+ */
+static void PNGCBAPI png_io_VectorFile_write(png_structp png_ptr, png_bytep data, png_size_t length)
+{
+	VectorFile *const vecFile = static_cast<VectorFile*>(png_get_io_ptr(png_ptr));
+	vecFile->write(data, length);
+}
+
+/**
+ * Save an ARGB32 rp_image to an interlaced PNG image in memory.
+ * RpPngWriter doesn't support interlacing, so libpng is used directly.
+ * @param img	[in] rp_image
+ * @return VectorFile containing the PNG image, or nullptr on error.
+ */
+VectorFile *RpPngReducedTest::saveInterlacedPng(const rp_image *img)
+{
+	if (img->format() != rp_image::Format::ARGB32)
+		return nullptr;
+
+	png_structp png_ptr = png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+	if (!png_ptr)
+		return nullptr;
+	png_infop info_ptr = png_create_info_struct(png_ptr);
+	if (!info_ptr) {
+		png_destroy_write_struct(&png_ptr, nullptr);
+		return nullptr;
+	}
+
+	VectorFile *const vecFile = new VectorFile();
+	std::vector<png_bytep> row_pointers(img->height());
+	for (int y = 0; y < img->height(); y++) {
+		row_pointers[y] = static_cast<png_bytep>(const_cast<void*>(img->scanLine(y)));
+	}
+
+	if (setjmp(png_jmpbuf(png_ptr))) {
+		png_destroy_write_struct(&png_ptr, &info_ptr);
+		vecFile->unref();
+		return nullptr;
+	}
+
+	png_set_write_fn(png_ptr, vecFile, png_io_VectorFile_write, nullptr);
+	png_set_IHDR(png_ptr, info_ptr, img->width(), img->height(), 8,
+		PNG_COLOR_TYPE_RGB_ALPHA, PNG_INTERLACE_ADAM7,
+		PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+	png_write_info(png_ptr, info_ptr);
+	png_set_bgr(png_ptr);
+	png_write_image(png_ptr, row_pointers.data());
+	png_write_end(png_ptr, info_ptr);
+	png_destroy_write_struct(&png_ptr, &info_ptr);
+
+	vecFile->rewind();
+	return vecFile;
+}
+#endif /* HAVE_PNG */
+
+/**
+ * Compare two rp_images.
+ * @param expected	[in] Expected image.
+ * @param actual	[in] Actual image.
+ */
+void RpPngReducedTest::compareImages(const rp_image *expected, const rp_image *actual)
+{
+	ASSERT_TRUE(expected != nullptr);
+	ASSERT_TRUE(actual != nullptr);
+	ASSERT_EQ(expected->format(), actual->format());
+	ASSERT_EQ(expected->width(), actual->width());
+	ASSERT_EQ(expected->height(), actual->height());
+
+	if (expected->format() == rp_image::Format::CI8) {
+		ASSERT_EQ(expected->palette_len(), actual->palette_len());
+		EXPECT_EQ(0, memcmp(expected->palette(), actual->palette(),
+			expected->palette_len() * sizeof(uint32_t))) << "Palettes differ";
+	}
+
+	for (int y = 0; y < expected->height(); y++) {
+		ASSERT_EQ(0, memcmp(expected->scanLine(y), actual->scanLine(y), expected->row_bytes())) <<
+			"Images differ at row " << y;
+	}
+}
+
+/**
+ * Downsample an image using the same method as RpPng.
+ * This is the reference implementation for the streaming decoder.
+ * @param img		[in] Full-size image
+ * @param factor	[in] Reduction factor
+ * @return Downsampled image
+ */
+rp_image *RpPngReducedTest::downsample(const rp_image *img, int factor)
+{
+	const int width = img->width();
+	const int height = img->height();
+	const int dest_width = (width + factor - 1) / factor;
+	const int dest_height = (height + factor - 1) / factor;
+	rp_image *const dest = new rp_image(dest_width, dest_height, img->format());
+
+	if (img->format() == rp_image::Format::CI8) {
+		// Nearest-neighbor. (top-left pixel of each block)
+		memcpy(dest->palette(), img->palette(), img->palette_len() * sizeof(uint32_t));
+		for (int dy = 0; dy < dest_height; dy++) {
+			const uint8_t *const src = static_cast<const uint8_t*>(img->scanLine(dy * factor));
+			uint8_t *const row = static_cast<uint8_t*>(dest->scanLine(dy));
+			for (int dx = 0; dx < dest_width; dx++) {
+				row[dx] = src[dx * factor];
+			}
+		}
+		return dest;
+	}
+
+	// Area average, weighted by alpha.
+	for (int dy = 0; dy < dest_height; dy++) {
+		argb32_t *const row = static_cast<argb32_t*>(dest->scanLine(dy));
+		for (int dx = 0; dx < dest_width; dx++) {
+			uint64_t sum_a = 0, sum_r = 0, sum_g = 0, sum_b = 0, count = 0;
+			for (int y = dy * factor; y < std::min((dy + 1) * factor, height); y++) {
+				const argb32_t *const src = static_cast<const argb32_t*>(img->scanLine(y));
+				for (int x = dx * factor; x < std::min((dx + 1) * factor, width); x++) {
+					sum_a += src[x].a;
+					sum_r += src[x].r * src[x].a;
+					sum_g += src[x].g * src[x].a;
+					sum_b += src[x].b * src[x].a;
+					count++;
+				}
+			}
+
+			argb32_t px;
+			px.u32 = 0;
+			if (sum_a != 0) {
+				px.a = static_cast<uint8_t>((sum_a + (count / 2)) / count);
+				px.r = static_cast<uint8_t>((sum_r + (sum_a / 2)) / sum_a);
+				px.g = static_cast<uint8_t>((sum_g + (sum_a / 2)) / sum_a);
+				px.b = static_cast<uint8_t>((sum_b + (sum_a / 2)) / sum_a);
+			}
+			row[dx] = px;
+		}
+	}
+	return dest;
+}
+
+/**
+ * Load a reference image at half size and compare it to
+ * the full-size image downsampled by the reference method.
+ */
+TEST_P(RpPngReducedTest, halfSize)
+{
+	string path = "png_data";
+	path += DIR_SEP_CHR;
+	path += GetParam();
+	unique_RefBase<RpFile> file(new RpFile(path, RpFile::FM_OPEN_READ));
+	ASSERT_TRUE(file->isOpen());
+
+	m_img = RpPng::load(file.get());
+	ASSERT_TRUE(m_img != nullptr) << "Error loading PNG image file: " << GetParam();
+	ASSERT_TRUE(m_img->isValid());
+
+	const int targetSize = std::max(m_img->width(), m_img->height()) / 2;
+	int origWidth = 0, origHeight = 0;
+	unique_RefBase<rp_image> img(RpPng::load(file.get(), targetSize, &origWidth, &origHeight));
+	ASSERT_TRUE((bool)img) << "Error loading PNG image file at reduced size: " << GetParam();
+	EXPECT_EQ(m_img->width(), origWidth);
+	EXPECT_EQ(m_img->height(), origHeight);
+	EXPECT_GE(std::max(img->width(), img->height()), targetSize);
+
+	unique_RefBase<rp_image> expected(downsample(m_img, 2));
+	ASSERT_NO_FATAL_FAILURE(compareImages(expected.get(), img.get()));
+}
+
+/**
+ * Block image with a reduction factor that matches the block size.
+ * Each destination pixel should be exactly one block color.
+ */
+TEST_F(RpPngReducedTest, blockImage)
+{
+	m_img = createBlockImage(512, 384, 4);
+	unique_RefBase<VectorFile> vecFile(savePng(m_img));
+	ASSERT_TRUE((bool)vecFile);
+
+	int origWidth = 0, origHeight = 0;
+	unique_RefBase<rp_image> img(RpPng::load(vecFile.get(), 128, &origWidth, &origHeight));
+	ASSERT_TRUE((bool)img);
+	EXPECT_EQ(512, origWidth);
+	EXPECT_EQ(384, origHeight);
+	ASSERT_EQ(128, img->width());
+	ASSERT_EQ(96, img->height());
+
+	for (int y = 0; y < img->height(); y++) {
+		const uint32_t *const row = static_cast<const uint32_t*>(img->scanLine(y));
+		for (int x = 0; x < img->width(); x++) {
+			ASSERT_EQ(blockColor(x, y), row[x]) << "Pixel differs at (" << x << ',' << y << ')';
+		}
+	}
+}
+
+/**
+ * Block image with dimensions that aren't a multiple of the
+ * reduction factor. The last row and column are partial blocks.
+ */
+TEST_F(RpPngReducedTest, blockImageOddSize)
+{
+	m_img = createBlockImage(509, 383, 3);
+	unique_RefBase<VectorFile> vecFile(savePng(m_img));
+	ASSERT_TRUE((bool)vecFile);
+
+	// 509 / 169 == 3
+	unique_RefBase<rp_image> img(RpPng::load(vecFile.get(), 169));
+	ASSERT_TRUE((bool)img);
+	ASSERT_EQ(170, img->width());
+	ASSERT_EQ(128, img->height());
+
+	for (int y = 0; y < img->height(); y++) {
+		const uint32_t *const row = static_cast<const uint32_t*>(img->scanLine(y));
+		for (int x = 0; x < img->width(); x++) {
+			ASSERT_EQ(blockColor(x, y), row[x]) << "Pixel differs at (" << x << ',' << y << ')';
+		}
+	}
+}
+
+/**
+ * Transparent pixels must not affect the color of the averaged pixel.
+ */
+TEST_F(RpPngReducedTest, alphaWeighted)
+{
+	// Checkerboard of transparent red and opaque blue.
+	m_img = new rp_image(8, 8, rp_image::Format::ARGB32);
+	for (int y = 0; y < 8; y++) {
+		uint32_t *const row = static_cast<uint32_t*>(m_img->scanLine(y));
+		for (int x = 0; x < 8; x++) {
+			row[x] = ((x ^ y) & 1) ? 0x00FF0000 : 0xFF0000FF;
+		}
+	}
+	unique_RefBase<VectorFile> vecFile(savePng(m_img));
+	ASSERT_TRUE((bool)vecFile);
+
+	unique_RefBase<rp_image> img(RpPng::load(vecFile.get(), 1));
+	ASSERT_TRUE((bool)img);
+	ASSERT_EQ(1, img->width());
+	ASSERT_EQ(1, img->height());
+	EXPECT_EQ(0x800000FFU, *static_cast<const uint32_t*>(img->scanLine(0)));
+}
+
+/**
+ * If the target size is larger than half of the image size,
+ * the image should be decoded at full size.
+ */
+TEST_F(RpPngReducedTest, fullSize)
+{
+	m_img = createBlockImage(300, 200, 5);
+	unique_RefBase<VectorFile> vecFile(savePng(m_img));
+	ASSERT_TRUE((bool)vecFile);
+
+	int origWidth = 0, origHeight = 0;
+	unique_RefBase<rp_image> img(RpPng::load(vecFile.get(), 151, &origWidth, &origHeight));
+	EXPECT_EQ(300, origWidth);
+	EXPECT_EQ(200, origHeight);
+	ASSERT_NO_FATAL_FAILURE(compareImages(m_img, img.get()));
+}
+
+#ifdef HAVE_PNG
+/**
+ * Interlaced images are always decoded at full size.
+ */
+TEST_F(RpPngReducedTest, interlacedFallback)
+{
+	m_img = createBlockImage(512, 384, 4);
+	unique_RefBase<VectorFile> vecFile(saveInterlacedPng(m_img));
+	ASSERT_TRUE((bool)vecFile);
+
+	int origWidth = 0, origHeight = 0;
+	unique_RefBase<rp_image> img(RpPng::load(vecFile.get(), 128, &origWidth, &origHeight));
+	EXPECT_EQ(512, origWidth);
+	EXPECT_EQ(384, origHeight);
+	ASSERT_NO_FATAL_FAILURE(compareImages(m_img, img.get()));
+}
+#endif /* HAVE_PNG */
+
+/**
+ * Test case suffix generator.
+ * @param info Test parameter information.
+ * @return Test case suffix.
+ */
+string RpPngReducedTest::test_case_suffix_generator(const ::testing::TestParamInfo<string> &info)
+{
+	string suffix = info.param;
+
+	// Replace all non-alphanumeric characters with '_'.
+	// See gtest-param-util.h::IsValidParamName().
+	std::replace_if(suffix.begin(), suffix.end(),
+		[](char c) { return !ISALNUM(c); }, '_');
+
+	return suffix;
+}
+
+// Test cases.
+// NOTE: Using the same images as RpPngFormatTest.
+INSTANTIATE_TEST_SUITE_P(RpPngReduced, RpPngReducedTest,
+	::testing::Values(
+		"gl_triangle.RGB24.png",
+		"gl_triangle.RGB24.tRNS.png",
+		"gl_triangle.ARGB32.png",
+		"gl_triangle.gray.png",
+		"gl_triangle.gray.alpha.png",
+		"gl_quad.RGB24.png",
+		"gl_quad.RGB24.tRNS.png",
+		"gl_quad.ARGB32.png",
+		"gl_quad.gray.png",
+		"gl_quad.gray.alpha.png",
+		"xterm-256color.CI8.png",
+		"xterm-256color.CI8.tRNS.png",
+		"odd-width.16color.CI4.png",
+		"happy-mac.mono.png",
+		"happy-mac.mono.odd-size.png")
+	, RpPngReducedTest::test_case_suffix_generator);
+
+} }
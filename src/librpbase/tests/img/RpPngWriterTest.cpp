@@ -0,0 +1,377 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (librpbase/tests)                  *
+ * RpPngWriterTest.cpp: RpPngWriter compression profile test.              *
+ *                                                                         *
+ * Copyright (c) 2016-2022 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+
+// librpcpu, librpbase
+#include "common.h"
+#include "tcharx.h"	// for DIR_SEP_CHR
+#include "librpcpu/byteswap_rp.h"
+#include "img/RpPng.hpp"
+#include "img/RpPngWriter.hpp"
+
+// librpfile
+#include "librpfile/RpFile.hpp"
+#include "librpfile/VectorFile.hpp"
+using namespace LibRpFile;
+
+// librptexture
+#include "librptexture/img/rp_image.hpp"
+using LibRpTexture::rp_image;
+
+// C includes. (C++ namespace)
+#include "ctypex.h"
+#include <cstdio>
+#include <cstring>
+
+// C++ includes.
+#include <algorithm>
+#include <ostream>
+#include <string>
+using std::string;
+
+namespace LibRpBase { namespace Tests {
+
+class RpPngWriterTest : public ::testing::TestWithParam<string>
+{
+	protected:
+		RpPngWriterTest()
+			: ::testing::TestWithParam<string>()
+			, m_img(nullptr)
+		{ }
+
+		void SetUp(void) final;
+		void TearDown(void) final;
+
+	public:
+		rp_image *m_img;
+
+	public:
+		// Number of iterations for benchmarks.
+		static const unsigned int BENCHMARK_ITERATIONS = 20;
+
+	public:
+		/**
+		 * Write an rp_image to a PNG image in memory.
+		 * @param img		[in] rp_image
+		 * @param profile	[in] Compression profile
+		 * @param parallel	[in] Enable parallel deflate
+		 * @return VectorFile containing the PNG image, or nullptr on error.
+		 */
+		static VectorFile *writePng(const rp_image *img,
+			RpPngWriter::CompressionProfile profile, bool parallel);
+
+		/**
+		 * Count the IDAT chunks in a PNG image.
+		 * @param png	[in] PNG image
+		 * @return Number of IDAT chunks.
+		 */
+		static unsigned int countIDAT(const std::vector<uint8_t> &png);
+
+		/**
+		 * Compare two rp_images.
+		 * @param expected	[in] Expected image.
+		 * @param actual	[in] Actual image.
+		 */
+		static void compareImages(const rp_image *expected, const rp_image *actual);
+
+		/**
+		 * Round-trip test: Write the image, reload it, and compare.
+		 * @param profile	[in] Compression profile
+		 * @param parallel	[in] Enable parallel deflate
+		 */
+		void roundTrip(RpPngWriter::CompressionProfile profile, bool parallel);
+
+		/**
+		 * Benchmark writing the image.
+		 * @param profile	[in] Compression profile
+		 * @param parallel	[in] Enable parallel deflate
+		 */
+		void benchmark(RpPngWriter::CompressionProfile profile, bool parallel);
+
+		/**
+		 * Test case suffix generator.
+		 * @param info Test parameter information.
+		 * @return Test case suffix.
+		 */
+		static string test_case_suffix_generator(const ::testing::TestParamInfo<string> &info);
+};
+
+/**
+ * SetUp() function.
+ * Run before each test.
+ */
+void RpPngWriterTest::SetUp(void)
+{
+	// Load the PNG image.
+	string path = "png_data";
+	path += DIR_SEP_CHR;
+	path += GetParam();
+	unique_RefBase<RpFile> file(new RpFile(path, RpFile::FM_OPEN_READ));
+	ASSERT_TRUE(file->isOpen());
+
+	m_img = RpPng::load(file.get());
+	ASSERT_TRUE(m_img != nullptr) << "Error loading PNG image file: " << GetParam();
+	ASSERT_TRUE(m_img->isValid());
+}
+
+/**
+ * TearDown() function.
+ * Run after each test.
+ */
+void RpPngWriterTest::TearDown(void)
+{
+	UNREF_AND_NULL(m_img);
+}
+
+/**
+ * Write an rp_image to a PNG image in memory.
+ * @param img		[in] rp_image
+ * @param profile	[in] Compression profile
+ * @param parallel	[in] Enable parallel deflate
+ * @return VectorFile containing the PNG image, or nullptr on error.
+ */
+VectorFile *RpPngWriterTest::writePng(const rp_image *img,
+	RpPngWriter::CompressionProfile profile, bool parallel)
+{
+	VectorFile *const vecFile = new VectorFile();
+	RpPngWriter *const pngWriter = new RpPngWriter(vecFile, img);
+	int ret = -EIO;
+	if (pngWriter->isOpen()) {
+		pngWriter->setCompressionProfile(profile);
+		pngWriter->setParallelDeflate(parallel);
+		ret = pngWriter->write_IHDR();
+		if (ret == 0) {
+			ret = pngWriter->write_IDAT();
+		}
+	}
+
+	// RpPngWriter will finalize the PNG on delete.
+	delete pngWriter;
+	if (ret != 0) {
+		vecFile->unref();
+		return nullptr;
+	}
+	vecFile->rewind();
+	return vecFile;
+}
+
+/**
+ * Count the IDAT chunks in a PNG image.
+ * @param png	[in] PNG image
+ * @return Number of IDAT chunks.
+ */
+unsigned int RpPngWriterTest::countIDAT(const std::vector<uint8_t> &png)
+{
+	unsigned int count = 0;
+
+	// Skip the PNG signature.
+	size_t pos = 8;
+	while (pos + 12 <= png.size()) {
+		uint32_t len;
+		memcpy(&len, &png[pos], sizeof(len));
+		len = be32_to_cpu(len);
+		if (!memcmp(&png[pos + 4], "IDAT", 4)) {
+			count++;
+		}
+		// Length, type, data, CRC
+		pos += 12 + len;
+	}
+	return count;
+}
+
+/**
+ * Compare two rp_images.
+ * @param expected	[in] Expected image.
+ * @param actual	[in] Actual image.
+ */
+void RpPngWriterTest::compareImages(const rp_image *expected, const rp_image *actual)
+{
+	ASSERT_TRUE(expected != nullptr);
+	ASSERT_TRUE(actual != nullptr);
+	ASSERT_EQ(expected->format(), actual->format());
+	ASSERT_EQ(expected->width(), actual->width());
+	ASSERT_EQ(expected->height(), actual->height());
+
+	if (expected->format() == rp_image::Format::CI8) {
+		ASSERT_EQ(expected->palette_len(), actual->palette_len());
+		EXPECT_EQ(0, memcmp(expected->palette(), actual->palette(),
+			expected->palette_len() * sizeof(uint32_t))) << "Palettes differ";
+	}
+
+	for (int y = 0; y < expected->height(); y++) {
+		ASSERT_EQ(0, memcmp(expected->scanLine(y), actual->scanLine(y), expected->row_bytes())) <<
+			"Images differ at row " << y;
+	}
+}
+
+/**
+ * Round-trip test: Write the image, reload it, and compare.
+ * @param profile	[in] Compression profile
+ * @param parallel	[in] Enable parallel deflate
+ */
+void RpPngWriterTest::roundTrip(RpPngWriter::CompressionProfile profile, bool parallel)
+{
+	unique_RefBase<VectorFile> vecFile(writePng(m_img, profile, parallel));
+	ASSERT_TRUE((bool)vecFile) << "RpPngWriter failed.";
+
+	// Large images should be split into multiple IDAT chunks
+	// if parallel deflate is used.
+	const unsigned int bpp = (m_img->format() == rp_image::Format::CI8 ? 1 : 4);
+	const size_t filtered_size = (1 + m_img->width() * bpp) * m_img->height();
+	const unsigned int idatCount = countIDAT(vecFile->vector());
+	if (parallel && profile != RpPngWriter::CompressionProfile::Archival &&
+	    filtered_size >= 512U*1024U)
+	{
+		EXPECT_GT(idatCount, 1U);
+	} else {
+		EXPECT_GE(idatCount, 1U);
+	}
+
+	unique_RefBase<rp_image> img(RpPng::load(vecFile.get()));
+	ASSERT_TRUE((bool)img) << "Error reloading the PNG image.";
+	ASSERT_NO_FATAL_FAILURE(compareImages(m_img, img.get()));
+}
+
+/**
+ * Benchmark writing the image.
+ * @param profile	[in] Compression profile
+ * @param parallel	[in] Enable parallel deflate
+ */
+void RpPngWriterTest::benchmark(RpPngWriter::CompressionProfile profile, bool parallel)
+{
+	size_t pngSize = 0;
+	for (unsigned int i = BENCHMARK_ITERATIONS; i > 0; i--) {
+		unique_RefBase<VectorFile> vecFile(writePng(m_img, profile, parallel));
+		ASSERT_TRUE((bool)vecFile) << "RpPngWriter failed.";
+		pngSize = vecFile->vector().size();
+	}
+	printf("%s: %u bytes\n", GetParam().c_str(), static_cast<unsigned int>(pngSize));
+}
+
+/**
+ * Fast profile.
+ */
+TEST_P(RpPngWriterTest, fast)
+{
+	ASSERT_NO_FATAL_FAILURE(roundTrip(RpPngWriter::CompressionProfile::Fast, false));
+}
+
+/**
+ * Fast profile with parallel deflate.
+ */
+TEST_P(RpPngWriterTest, fast_parallel)
+{
+	ASSERT_NO_FATAL_FAILURE(roundTrip(RpPngWriter::CompressionProfile::Fast, true));
+}
+
+/**
+ * Default profile.
+ */
+TEST_P(RpPngWriterTest, default)
+{
+	ASSERT_NO_FATAL_FAILURE(roundTrip(RpPngWriter::CompressionProfile::Default, false));
+}
+
+/**
+ * Default profile with parallel deflate.
+ */
+TEST_P(RpPngWriterTest, default_parallel)
+{
+	ASSERT_NO_FATAL_FAILURE(roundTrip(RpPngWriter::CompressionProfile::Default, true));
+}
+
+/**
+ * Archival profile.
+ * NOTE: Parallel deflate is ignored for this profile.
+ */
+TEST_P(RpPngWriterTest, archival)
+{
+	ASSERT_NO_FATAL_FAILURE(roundTrip(RpPngWriter::CompressionProfile::Archival, true));
+}
+
+/**
+ * Benchmark the Fast profile.
+ */
+TEST_P(RpPngWriterTest, fast_benchmark)
+{
+	ASSERT_NO_FATAL_FAILURE(benchmark(RpPngWriter::CompressionProfile::Fast, false));
+}
+
+/**
+ * Benchmark the Fast profile with parallel deflate.
+ */
+TEST_P(RpPngWriterTest, fast_parallel_benchmark)
+{
+	ASSERT_NO_FATAL_FAILURE(benchmark(RpPngWriter::CompressionProfile::Fast, true));
+}
+
+/**
+ * Benchmark the Default profile.
+ */
+TEST_P(RpPngWriterTest, default_benchmark)
+{
+	ASSERT_NO_FATAL_FAILURE(benchmark(RpPngWriter::CompressionProfile::Default, false));
+}
+
+/**
+ * Benchmark the Default profile with parallel deflate.
+ */
+TEST_P(RpPngWriterTest, default_parallel_benchmark)
+{
+	ASSERT_NO_FATAL_FAILURE(benchmark(RpPngWriter::CompressionProfile::Default, true));
+}
+
+/**
+ * Benchmark the Archival profile.
+ */
+TEST_P(RpPngWriterTest, archival_benchmark)
+{
+	ASSERT_NO_FATAL_FAILURE(benchmark(RpPngWriter::CompressionProfile::Archival, false));
+}
+
+/**
+ * Test case suffix generator.
+ * @param info Test parameter information.
+ * @return Test case suffix.
+ */
+string RpPngWriterTest::test_case_suffix_generator(const ::testing::TestParamInfo<string> &info)
+{
+	string suffix = info.param;
+
+	// Replace all non-alphanumeric characters with '_'.
+	// See gtest-param-util.h::IsValidParamName().
+	std::replace_if(suffix.begin(), suffix.end(),
+		[](char c) { return !ISALNUM(c); }, '_');
+
+	return suffix;
+}
+
+// Test cases.
+// NOTE: Using the same images as RpPngFormatTest.
+INSTANTIATE_TEST_SUITE_P(RpPngWriter, RpPngWriterTest,
+	::testing::Values(
+		"gl_triangle.RGB24.png",
+		"gl_triangle.RGB24.tRNS.png",
+		"gl_triangle.ARGB32.png",
+		"gl_triangle.gray.png",
+		"gl_triangle.gray.alpha.png",
+		"gl_quad.RGB24.png",
+		"gl_quad.RGB24.tRNS.png",
+		"gl_quad.ARGB32.png",
+		"gl_quad.gray.png",
+		"gl_quad.gray.alpha.png",
+		"xterm-256color.CI8.png",
+		"xterm-256color.CI8.tRNS.png",
+		"odd-width.16color.CI4.png",
+		"happy-mac.mono.png",
+		"happy-mac.mono.odd-size.png")
+	, RpPngWriterTest::test_case_suffix_generator);
+
+} }
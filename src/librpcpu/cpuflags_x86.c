@@ -67,6 +67,10 @@
 #define CPUFLAG_IA32_EXT_ECX_XOP	((uint32_t)(1U << 11))
 #define CPUFLAG_IA32_EXT_ECX_FMA4	((uint32_t)(1U << 16))
 
+// XCR0: XSAVE-enabled register state components.
+#define XCR0_STATE_SSE		((uint32_t)(1U << 1))
+#define XCR0_STATE_AVX		((uint32_t)(1U << 2))
+
 // CPUID functions.
 #define CPUID_MAX_FUNCTIONS			((uint32_t)(0x00000000U))
 #define CPUID_PROC_INFO_FEATURE_BITS		((uint32_t)(0x00000001U))
@@ -183,6 +187,69 @@ static FORCEINLINE void cpuid(unsigned int level, unsigned int regs[4])
 #endif
 }
 
+/**
+ * Run the `cpuid` instruction with a subleaf.
+ * @param level
+ * @param subleaf Subleaf. (stored in %ecx)
+ * @param regs Registers. (%eax, %ebx, %ecx, %edx)
+ */
+static FORCEINLINE void cpuid_count(unsigned int level, unsigned int subleaf, unsigned int regs[4])
+{
+#if defined(__GNUC__)
+#  ifdef ASM_RESERVE_EBX
+	__asm__ (
+		"xchgl	%%ebx, %1\n"
+		"cpuid\n"
+		"xchgl	%%ebx, %1\n"
+		: "=a" (regs[0]), "=r" (regs[1]), "=c" (regs[2]), "=d" (regs[3])
+		: "0" (level), "2" (subleaf)
+		);
+#  else /* !ASM_RESERVE_EBX */
+	__asm__ (
+		"cpuid\n"
+		: "=a" (regs[0]), "=b" (regs[1]), "=c" (regs[2]), "=d" (regs[3])
+		: "0" (level), "2" (subleaf)
+		);
+#  endif
+#elif defined(_MSC_VER) && _MSC_VER >= 1500
+	// CPUID with subleaf for MSVC 2008+
+	// Uses the __cpuidex() intrinsic.
+	__cpuidex((int*)regs, level, subleaf);
+#else
+	// No subleaf support. Assume the extended features aren't available.
+	RP_UNUSED(level);
+	RP_UNUSED(subleaf);
+	regs[0] = 0; regs[1] = 0; regs[2] = 0; regs[3] = 0;
+#endif
+}
+
+/**
+ * Read an extended control register using `xgetbv`.
+ * NOTE: Only call this if CPUID reports OSXSAVE.
+ * @param xcr Extended control register number.
+ * @return Low 32 bits of the register.
+ */
+static FORCEINLINE uint32_t xgetbv_low(unsigned int xcr)
+{
+#if defined(__GNUC__)
+	uint32_t __eax, __edx;
+	// NOTE: Using the opcode directly for old assemblers.
+	__asm__ (
+		".byte 0x0f, 0x01, 0xd0\n"	// xgetbv
+		: "=a" (__eax), "=d" (__edx)
+		: "c" (xcr)
+		);
+	return __eax;
+#elif defined(_MSC_VER) && _MSC_VER >= 1600
+	// MSVC 2010 SP1+
+	return (uint32_t)_xgetbv(xcr);
+#else
+	// Cannot check for OS support. Assume no AVX.
+	RP_UNUSED(xcr);
+	return 0;
+#endif
+}
+
 // Register indexes.
 #define REG_EAX 0
 #define REG_EBX 1
@@ -306,6 +373,25 @@ static void RP_CPU_InitCPUFlags_int(void)
 		if (regs[REG_ECX] & CPUFLAG_IA32_ECX_SSE42)
 			RP_CPU_Flags |= RP_CPUFLAG_X86_SSE42;
 #endif /* defined(__i386__) || defined(_M_IX86) */
+
+		// AVX requires OS support for saving the YMM registers.
+		// This is indicated by OSXSAVE and the XCR0 SSE/AVX state bits.
+		if ((RP_CPU_Flags & RP_CPUFLAG_X86_SSE2) &&
+		    (regs[REG_ECX] & (CPUFLAG_IA32_ECX_OSXSAVE | CPUFLAG_IA32_ECX_AVX)) ==
+		     (CPUFLAG_IA32_ECX_OSXSAVE | CPUFLAG_IA32_ECX_AVX))
+		{
+			const uint32_t xcr0 = xgetbv_low(0);
+			if ((xcr0 & (XCR0_STATE_SSE | XCR0_STATE_AVX)) == (XCR0_STATE_SSE | XCR0_STATE_AVX)) {
+				RP_CPU_Flags |= RP_CPUFLAG_X86_AVX;
+
+				// Check for AVX2. (CPUID function 7, subleaf 0)
+				if (maxFunc >= CPUID_EXT_FEATURES) {
+					cpuid_count(CPUID_EXT_FEATURES, 0, regs);
+					if (regs[REG_EBX] & CPUFLAG_IA32_FN7_EBX_AVX2)
+						RP_CPU_Flags |= RP_CPUFLAG_X86_AVX2;
+				}
+			}
+		}
 	}
 
 	// CPU flags initialized.
@@ -71,11 +71,14 @@ size_t VectorFile::write(const void *ptr, size_t size)
 	}
 
 	// Do we need to expand the std::vector?
-	off64_t req_size = static_cast<off64_t>(m_vector.size()) + size;
+	// NOTE: If size_t is 64-bit, it can't be larger than off64_t.
+	off64_t req_size = static_cast<off64_t>(m_pos) + size;
 	if (req_size < 0) {
 		// Overflow...
 		return 0;
-	} else if (req_size > static_cast<off64_t>(std::numeric_limits<size_t>::max())) {
+	} else if (sizeof(size_t) < sizeof(off64_t) &&
+	           req_size > static_cast<off64_t>(std::numeric_limits<size_t>::max()))
+	{
 		// Too big for size_t.
 		return 0;
 	} else if (req_size > static_cast<off64_t>(m_vector.size())) {
@@ -110,4 +113,31 @@ int VectorFile::seek(off64_t pos)
 	return 0;
 }
 
+/**
+ * Truncate the file.
+ * @param size New size. (default is 0)
+ * @return 0 on success; -1 on error.
+ */
+int VectorFile::truncate(off64_t size)
+{
+	if (size < 0) {
+		m_lastError = EINVAL;
+		return -1;
+	} else if (sizeof(size_t) < sizeof(off64_t) &&
+	           size > static_cast<off64_t>(std::numeric_limits<size_t>::max()))
+	{
+		// Too big for size_t.
+		m_lastError = ENOMEM;
+		return -1;
+	}
+
+	// Resize the std::vector.
+	// If the file position is past the new size, move it to the end.
+	m_vector.resize(static_cast<size_t>(size));
+	if (m_pos > m_vector.size()) {
+		m_pos = m_vector.size();
+	}
+	return 0;
+}
+
 }
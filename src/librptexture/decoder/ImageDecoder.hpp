@@ -24,6 +24,8 @@
 # include "librpcpu/cpuflags_x86.h"
 # define IMAGEDECODER_HAS_SSE2 1
 # define IMAGEDECODER_HAS_SSSE3 1
+# define IMAGEDECODER_HAS_SSE41 1
+# define IMAGEDECODER_HAS_AVX2 1
 #endif
 #ifdef RP_CPU_AMD64
 # define IMAGEDECODER_ALWAYS_HAS_SSE2 1
@@ -239,31 +241,26 @@ rp_image *fromLinear16_sse2(PixelFormat px_format,
 	const uint16_t *RESTRICT img_buf, int img_siz, int stride = 0);
 #endif /* IMAGEDECODER_HAS_SSE2 */
 
-#if defined(HAVE_IFUNC) && (defined(RP_CPU_I386) || defined(RP_CPU_AMD64))
-
-#  ifdef IMAGEDECODER_ALWAYS_HAS_SSE2
-// System does support IFUNC, but it's always guaranteed to have SSE2.
-// Eliminate the IFUNC dispatch on this system.
-
+#ifdef IMAGEDECODER_HAS_AVX2
 /**
  * Convert a linear 16-bit RGB image to rp_image.
+ * AVX2-optimized version.
  * @param px_format	[in] 16-bit pixel format.
  * @param width		[in] Image width.
  * @param height	[in] Image height.
- * @param img_buf	[in] Image buffer.
- * @param img_siz	[in] Size of image data. [must be >= (w*h)*3]
+ * @param img_buf	[in] 16-bit image buffer.
+ * @param img_siz	[in] Size of image data. [must be >= (w*h)*2]
  * @param stride	[in,opt] Stride, in bytes. If 0, assumes width*bytespp.
  * @return rp_image, or nullptr on error.
  */
-static inline rp_image *fromLinear16(PixelFormat px_format,
+rp_image *fromLinear16_avx2(PixelFormat px_format,
 	int width, int height,
-	const uint16_t *img_buf, int img_siz, int stride = 0)
-{
-	// amd64 always has SSE2.
-	return fromLinear16_sse2(px_format, width, height, img_buf, img_siz, stride);
-}
-#  else /* !IMAGEDECODER_ALWAYS_HAS_SSE2 */
-// System supports IFUNC and is not guaranteed to always have SSE2.
+	const uint16_t *RESTRICT img_buf, int img_siz, int stride = 0);
+#endif /* IMAGEDECODER_HAS_AVX2 */
+
+#if defined(HAVE_IFUNC) && (defined(RP_CPU_I386) || defined(RP_CPU_AMD64))
+// NOTE: IFUNC dispatch is used even if the system is guaranteed
+// to have SSE2, since AVX2 might be available.
 
 /**
  * Convert a linear 16-bit RGB image to rp_image.
@@ -275,10 +272,9 @@ static inline rp_image *fromLinear16(PixelFormat px_format,
  * @param stride	[in,opt] Stride, in bytes. If 0, assumes width*bytespp.
  * @return rp_image, or nullptr on error.
  */
-IFUNC_SSE2_STATIC_INLINE rp_image *fromLinear16(PixelFormat px_format,
+IFUNC_STATIC_INLINE rp_image *fromLinear16(PixelFormat px_format,
 	int width, int height,
 	const uint16_t *RESTRICT img_buf, int img_siz, int stride = 0);
-#  endif /* IMAGEDECODER_ALWAYS_HAS_SSE2 */
 
 #else /* !HAVE_IFUNC or not i386/amd64 */
 // System does not support IFUNC, or we aren't guaranteed to have
@@ -298,9 +294,16 @@ static inline rp_image *fromLinear16(PixelFormat px_format,
 	int width, int height,
 	const uint16_t *RESTRICT img_buf, int img_siz, int stride = 0)
 {
+#  ifdef IMAGEDECODER_HAS_AVX2
+	if (RP_CPU_HasAVX2()) {
+		return fromLinear16_avx2(px_format, width, height, img_buf, img_siz, stride);
+	} else
+#  endif /* IMAGEDECODER_HAS_AVX2 */
 #  ifdef IMAGEDECODER_ALWAYS_HAS_SSE2
-	// amd64 always has SSE2.
-	return fromLinear16_sse2(px_format, width, height, img_buf, img_siz, stride);
+	{
+		// amd64 always has SSE2.
+		return fromLinear16_sse2(px_format, width, height, img_buf, img_siz, stride);
+	}
 #  else /* !IMAGEDECODER_ALWAYS_HAS_SSE2 */
 #    ifdef IMAGEDECODER_HAS_SSE2
 	if (RP_CPU_HasSSE2()) {
@@ -351,6 +354,24 @@ rp_image *fromLinear24_ssse3(PixelFormat px_format,
 	const uint8_t *RESTRICT img_buf, int img_siz, int stride = 0);
 #endif /* IMAGEDECODER_HAS_SSSE3 */
 
+#ifdef IMAGEDECODER_HAS_AVX2
+/**
+ * Convert a linear 24-bit RGB image to rp_image.
+ * AVX2-optimized version.
+ * @param px_format	[in] 24-bit pixel format.
+ * @param width		[in] Image width.
+ * @param height	[in] Image height.
+ * @param img_buf	[in] Image buffer. (must be byte-addressable)
+ * @param img_siz	[in] Size of image data. [must be >= (w*h)*3]
+ * @param stride	[in,opt] Stride, in bytes. If 0, assumes width*bytespp.
+ * @return rp_image, or nullptr on error.
+ */
+ATTR_ACCESS_SIZE(read_only, 4, 5)
+rp_image *fromLinear24_avx2(PixelFormat px_format,
+	int width, int height,
+	const uint8_t *RESTRICT img_buf, int img_siz, int stride = 0);
+#endif /* IMAGEDECODER_HAS_AVX2 */
+
 #if defined(HAVE_IFUNC) && (defined(RP_CPU_I386) || defined(RP_CPU_AMD64))
 /**
  * Convert a linear 24-bit RGB image to rp_image.
@@ -385,6 +406,11 @@ static inline rp_image *fromLinear24(PixelFormat px_format,
 	int width, int height,
 	const uint8_t *RESTRICT img_buf, int img_siz, int stride = 0)
 {
+#  ifdef IMAGEDECODER_HAS_AVX2
+	if (RP_CPU_HasAVX2()) {
+		return fromLinear24_avx2(px_format, width, height, img_buf, img_siz, stride);
+	} else
+#  endif /* IMAGEDECODER_HAS_AVX2 */
 #  ifdef IMAGEDECODER_HAS_SSSE3
 	if (RP_CPU_HasSSSE3()) {
 		return fromLinear24_ssse3(px_format, width, height, img_buf, img_siz, stride);
@@ -430,6 +456,23 @@ rp_image *fromLinear32_ssse3(PixelFormat px_format,
 	const uint32_t *RESTRICT img_buf, int img_siz, int stride = 0);
 #endif /* IMAGEDECODER_HAS_SSSE3 */
 
+#ifdef IMAGEDECODER_HAS_AVX2
+/**
+ * Convert a linear 32-bit RGB image to rp_image.
+ * AVX2-optimized version.
+ * @param px_format	[in] 32-bit pixel format.
+ * @param width		[in] Image width.
+ * @param height	[in] Image height.
+ * @param img_buf	[in] 32-bit image buffer.
+ * @param img_siz	[in] Size of image data. [must be >= (w*h)*2]
+ * @param stride	[in,opt] Stride, in bytes. If 0, assumes width*bytespp.
+ * @return rp_image, or nullptr on error.
+ */
+rp_image *fromLinear32_avx2(PixelFormat px_format,
+	int width, int height,
+	const uint32_t *RESTRICT img_buf, int img_siz, int stride = 0);
+#endif /* IMAGEDECODER_HAS_AVX2 */
+
 #if defined(HAVE_IFUNC) && (defined(RP_CPU_I386) || defined(RP_CPU_AMD64))
 /**
  * Convert a linear 32-bit RGB image to rp_image.
@@ -462,6 +505,11 @@ static inline rp_image *fromLinear32(PixelFormat px_format,
 	int width, int height,
 	const uint32_t *RESTRICT img_buf, int img_siz, int stride = 0)
 {
+#  ifdef IMAGEDECODER_HAS_AVX2
+	if (RP_CPU_HasAVX2()) {
+		return fromLinear32_avx2(px_format, width, height, img_buf, img_siz, stride);
+	} else
+#  endif /* IMAGEDECODER_HAS_AVX2 */
 #  ifdef IMAGEDECODER_HAS_SSSE3
 	if (RP_CPU_HasSSSE3()) {
 		return fromLinear32_ssse3(px_format, width, height, img_buf, img_siz, stride);
@@ -473,6 +521,89 @@ static inline rp_image *fromLinear32(PixelFormat px_format,
 }
 #endif /* !HAVE_IFUNC || (!RP_CPU_I386 && !RP_CPU_AMD64) */
 
+/** Swizzled **/
+
+/**
+ * Unswizzle a Morton-ordered ARGB32 image.
+ *
+ * The source image is divided into tiles of (1 << popcount(mask_x))
+ * by (1 << popcount(mask_y)) pixels, stored in row-major order.
+ * Within each tile, pixel (x,y) is located at pdep(x, mask_x) | pdep(y, mask_y).
+ *
+ * @param img		[in] Swizzled ARGB32 image.
+ * @param mask_x	[in] X coordinate bits within a tile.
+ * @param mask_y	[in] Y coordinate bits within a tile.
+ * @return Unswizzled ARGB32 image, or nullptr on error.
+ */
+rp_image *unswizzleMorton32_cpp(const rp_image *img, uint32_t mask_x, uint32_t mask_y);
+
+#ifdef IMAGEDECODER_HAS_SSE2
+/**
+ * Unswizzle a Morton-ordered ARGB32 image.
+ * SSE2-optimized version.
+ *
+ * The source image is divided into tiles of (1 << popcount(mask_x))
+ * by (1 << popcount(mask_y)) pixels, stored in row-major order.
+ * Within each tile, pixel (x,y) is located at pdep(x, mask_x) | pdep(y, mask_y).
+ *
+ * @param img		[in] Swizzled ARGB32 image.
+ * @param mask_x	[in] X coordinate bits within a tile.
+ * @param mask_y	[in] Y coordinate bits within a tile.
+ * @return Unswizzled ARGB32 image, or nullptr on error.
+ */
+rp_image *unswizzleMorton32_sse2(const rp_image *img, uint32_t mask_x, uint32_t mask_y);
+#endif /* IMAGEDECODER_HAS_SSE2 */
+
+#if defined(HAVE_IFUNC) && defined(RP_CPU_I386)
+// System supports IFUNC, but we aren't guaranteed to have SSE2.
+
+/**
+ * Unswizzle a Morton-ordered ARGB32 image.
+ *
+ * The source image is divided into tiles of (1 << popcount(mask_x))
+ * by (1 << popcount(mask_y)) pixels, stored in row-major order.
+ * Within each tile, pixel (x,y) is located at pdep(x, mask_x) | pdep(y, mask_y).
+ *
+ * @param img		[in] Swizzled ARGB32 image.
+ * @param mask_x	[in] X coordinate bits within a tile.
+ * @param mask_y	[in] Y coordinate bits within a tile.
+ * @return Unswizzled ARGB32 image, or nullptr on error.
+ */
+rp_image *unswizzleMorton32(const rp_image *img, uint32_t mask_x, uint32_t mask_y);
+#else /* !HAVE_IFUNC || !RP_CPU_I386 */
+// System does not support IFUNC, or we always have SSE2.
+// Use standard inline dispatch.
+
+/**
+ * Unswizzle a Morton-ordered ARGB32 image.
+ *
+ * The source image is divided into tiles of (1 << popcount(mask_x))
+ * by (1 << popcount(mask_y)) pixels, stored in row-major order.
+ * Within each tile, pixel (x,y) is located at pdep(x, mask_x) | pdep(y, mask_y).
+ *
+ * @param img		[in] Swizzled ARGB32 image.
+ * @param mask_x	[in] X coordinate bits within a tile.
+ * @param mask_y	[in] Y coordinate bits within a tile.
+ * @return Unswizzled ARGB32 image, or nullptr on error.
+ */
+static inline rp_image *unswizzleMorton32(const rp_image *img, uint32_t mask_x, uint32_t mask_y)
+{
+#ifdef IMAGEDECODER_ALWAYS_HAS_SSE2
+	// amd64 always has SSE2.
+	return unswizzleMorton32_sse2(img, mask_x, mask_y);
+#else /* !IMAGEDECODER_ALWAYS_HAS_SSE2 */
+#  ifdef IMAGEDECODER_HAS_SSE2
+	if (RP_CPU_HasSSE2()) {
+		return unswizzleMorton32_sse2(img, mask_x, mask_y);
+	} else
+#  endif /* IMAGEDECODER_HAS_SSE2 */
+	{
+		return unswizzleMorton32_cpp(img, mask_x, mask_y);
+	}
+#endif /* IMAGEDECODER_ALWAYS_HAS_SSE2 */
+}
+#endif /* HAVE_IFUNC && RP_CPU_I386 */
+
 /** GameCube **/
 
 /**
@@ -702,7 +833,7 @@ int fromRed8ToL8(rp_image *img);
 /**
  * Convert a Dreamcast square twiddled 16-bit image to rp_image.
  * @param px_format 16-bit pixel format.
- * @param width Image width. (Maximum is 4096.)
+ * @param width Image width. (Must be a power of 2; maximum is 4096.)
  * @param height Image height. (Must be equal to width.)
  * @param img_buf 16-bit image buffer.
  * @param img_siz Size of image data. [must be >= (w*h)*2]
@@ -776,6 +907,21 @@ static inline int calcDreamcastSmallVQPaletteEntries_WithMipmaps(int width)
 
 /**
  * Convert an ETC1 image to rp_image.
+ * Standard version using regular C++ code.
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf ETC1 image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)/2]
+ * @return rp_image, or nullptr on error.
+ */
+ATTR_ACCESS_SIZE(read_only, 3, 4)
+rp_image *fromETC1_cpp(int width, int height,
+	const uint8_t *RESTRICT img_buf, int img_siz);
+
+#ifdef IMAGEDECODER_HAS_SSE41
+/**
+ * Convert an ETC1 image to rp_image.
+ * SSE4.1-optimized version.
  * @param width Image width.
  * @param height Image height.
  * @param img_buf ETC1 image buffer.
@@ -783,11 +929,57 @@ static inline int calcDreamcastSmallVQPaletteEntries_WithMipmaps(int width)
  * @return rp_image, or nullptr on error.
  */
 ATTR_ACCESS_SIZE(read_only, 3, 4)
-rp_image *fromETC1(int width, int height,
+rp_image *fromETC1_sse41(int width, int height,
+	const uint8_t *RESTRICT img_buf, int img_siz);
+#endif /* IMAGEDECODER_HAS_SSE41 */
+
+#ifdef IMAGEDECODER_HAS_AVX2
+/**
+ * Convert an ETC1 image to rp_image.
+ * AVX2-optimized version.
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf ETC1 image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)/2]
+ * @return rp_image, or nullptr on error.
+ */
+ATTR_ACCESS_SIZE(read_only, 3, 4)
+rp_image *fromETC1_avx2(int width, int height,
+	const uint8_t *RESTRICT img_buf, int img_siz);
+#endif /* IMAGEDECODER_HAS_AVX2 */
+
+/**
+ * Convert an ETC2 RGB image to rp_image.
+ * Standard version using regular C++ code.
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf ETC2 RGB image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)/2]
+ * @return rp_image, or nullptr on error.
+ */
+ATTR_ACCESS_SIZE(read_only, 3, 4)
+rp_image *fromETC2_RGB_cpp(int width, int height,
+	const uint8_t *RESTRICT img_buf, int img_siz);
+
+#ifdef IMAGEDECODER_HAS_SSE41
+/**
+ * Convert an ETC2 RGB image to rp_image.
+ * SSE4.1-optimized version.
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf ETC2 RGB image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)/2]
+ * @return rp_image, or nullptr on error.
+ */
+ATTR_ACCESS_SIZE(read_only, 3, 4)
+rp_image *fromETC2_RGB_sse41(int width, int height,
 	const uint8_t *RESTRICT img_buf, int img_siz);
+#endif /* IMAGEDECODER_HAS_SSE41 */
 
+#ifdef IMAGEDECODER_HAS_AVX2
 /**
  * Convert an ETC2 RGB image to rp_image.
+ * AVX2-optimized version.
  * @param width Image width.
  * @param height Image height.
  * @param img_buf ETC2 RGB image buffer.
@@ -795,11 +987,13 @@ rp_image *fromETC1(int width, int height,
  * @return rp_image, or nullptr on error.
  */
 ATTR_ACCESS_SIZE(read_only, 3, 4)
-rp_image *fromETC2_RGB(int width, int height,
+rp_image *fromETC2_RGB_avx2(int width, int height,
 	const uint8_t *RESTRICT img_buf, int img_siz);
+#endif /* IMAGEDECODER_HAS_AVX2 */
 
 /**
  * Convert an ETC2 RGBA image to rp_image.
+ * Standard version using regular C++ code.
  * @param width Image width.
  * @param height Image height.
  * @param img_buf ETC2 RGBA image buffer.
@@ -807,11 +1001,56 @@ rp_image *fromETC2_RGB(int width, int height,
  * @return rp_image, or nullptr on error.
  */
 ATTR_ACCESS_SIZE(read_only, 3, 4)
-rp_image *fromETC2_RGBA(int width, int height,
+rp_image *fromETC2_RGBA_cpp(int width, int height,
+	const uint8_t *RESTRICT img_buf, int img_siz);
+
+#ifdef IMAGEDECODER_HAS_SSE41
+/**
+ * Convert an ETC2 RGBA image to rp_image.
+ * SSE4.1-optimized version.
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf ETC2 RGBA image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)]
+ * @return rp_image, or nullptr on error.
+ */
+ATTR_ACCESS_SIZE(read_only, 3, 4)
+rp_image *fromETC2_RGBA_sse41(int width, int height,
+	const uint8_t *RESTRICT img_buf, int img_siz);
+#endif /* IMAGEDECODER_HAS_SSE41 */
+
+#ifdef IMAGEDECODER_HAS_AVX2
+/**
+ * Convert an ETC2 RGBA image to rp_image.
+ * AVX2-optimized version.
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf ETC2 RGBA image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)]
+ * @return rp_image, or nullptr on error.
+ */
+ATTR_ACCESS_SIZE(read_only, 3, 4)
+rp_image *fromETC2_RGBA_avx2(int width, int height,
+	const uint8_t *RESTRICT img_buf, int img_siz);
+#endif /* IMAGEDECODER_HAS_AVX2 */
+
+/**
+ * Convert an ETC2 RGB+A1 (punchthrough alpha) image to rp_image.
+ * Standard version using regular C++ code.
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf ETC2 RGB+A1 image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)/2]
+ * @return rp_image, or nullptr on error.
+ */
+ATTR_ACCESS_SIZE(read_only, 3, 4)
+rp_image *fromETC2_RGB_A1_cpp(int width, int height,
 	const uint8_t *RESTRICT img_buf, int img_siz);
 
+#ifdef IMAGEDECODER_HAS_SSE41
 /**
  * Convert an ETC2 RGB+A1 (punchthrough alpha) image to rp_image.
+ * SSE4.1-optimized version.
  * @param width Image width.
  * @param height Image height.
  * @param img_buf ETC2 RGB+A1 image buffer.
@@ -819,11 +1058,42 @@ rp_image *fromETC2_RGBA(int width, int height,
  * @return rp_image, or nullptr on error.
  */
 ATTR_ACCESS_SIZE(read_only, 3, 4)
-rp_image *fromETC2_RGB_A1(int width, int height,
+rp_image *fromETC2_RGB_A1_sse41(int width, int height,
 	const uint8_t *RESTRICT img_buf, int img_siz);
+#endif /* IMAGEDECODER_HAS_SSE41 */
 
+#ifdef IMAGEDECODER_HAS_AVX2
+/**
+ * Convert an ETC2 RGB+A1 (punchthrough alpha) image to rp_image.
+ * AVX2-optimized version.
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf ETC2 RGB+A1 image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)/2]
+ * @return rp_image, or nullptr on error.
+ */
+ATTR_ACCESS_SIZE(read_only, 3, 4)
+rp_image *fromETC2_RGB_A1_avx2(int width, int height,
+	const uint8_t *RESTRICT img_buf, int img_siz);
+#endif /* IMAGEDECODER_HAS_AVX2 */
+
+/**
+ * Convert an EAC R11 image to rp_image.
+ * Standard version using regular C++ code.
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf EAC R11 image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)/2]
+ * @return rp_image, or nullptr on error.
+ */
+ATTR_ACCESS_SIZE(read_only, 3, 4)
+rp_image *fromEAC_R11_cpp(int width, int height,
+	const uint8_t *RESTRICT img_buf, int img_siz);
+
+#ifdef IMAGEDECODER_HAS_SSE41
 /**
  * Convert an EAC R11 image to rp_image.
+ * SSE4.1-optimized version.
  * @param width Image width.
  * @param height Image height.
  * @param img_buf EAC R11 image buffer.
@@ -831,20 +1101,306 @@ rp_image *fromETC2_RGB_A1(int width, int height,
  * @return rp_image, or nullptr on error.
  */
 ATTR_ACCESS_SIZE(read_only, 3, 4)
-rp_image *fromEAC_R11(int width, int height,
+rp_image *fromEAC_R11_sse41(int width, int height,
+	const uint8_t *RESTRICT img_buf, int img_siz);
+#endif /* IMAGEDECODER_HAS_SSE41 */
+
+#ifdef IMAGEDECODER_HAS_AVX2
+/**
+ * Convert an EAC R11 image to rp_image.
+ * AVX2-optimized version.
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf EAC R11 image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)/2]
+ * @return rp_image, or nullptr on error.
+ */
+ATTR_ACCESS_SIZE(read_only, 3, 4)
+rp_image *fromEAC_R11_avx2(int width, int height,
+	const uint8_t *RESTRICT img_buf, int img_siz);
+#endif /* IMAGEDECODER_HAS_AVX2 */
+
+/**
+ * Convert an EAC RG11 image to rp_image.
+ * Standard version using regular C++ code.
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf EAC RG11 image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)]
+ * @return rp_image, or nullptr on error.
+ */
+ATTR_ACCESS_SIZE(read_only, 3, 4)
+rp_image *fromEAC_RG11_cpp(int width, int height,
+	const uint8_t *RESTRICT img_buf, int img_siz);
+
+#ifdef IMAGEDECODER_HAS_SSE41
+/**
+ * Convert an EAC RG11 image to rp_image.
+ * SSE4.1-optimized version.
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf EAC RG11 image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)]
+ * @return rp_image, or nullptr on error.
+ */
+ATTR_ACCESS_SIZE(read_only, 3, 4)
+rp_image *fromEAC_RG11_sse41(int width, int height,
 	const uint8_t *RESTRICT img_buf, int img_siz);
+#endif /* IMAGEDECODER_HAS_SSE41 */
 
+#ifdef IMAGEDECODER_HAS_AVX2
 /**
  * Convert an EAC RG11 image to rp_image.
+ * AVX2-optimized version.
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf EAC RG11 image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)]
+ * @return rp_image, or nullptr on error.
+ */
+ATTR_ACCESS_SIZE(read_only, 3, 4)
+rp_image *fromEAC_RG11_avx2(int width, int height,
+	const uint8_t *RESTRICT img_buf, int img_siz);
+#endif /* IMAGEDECODER_HAS_AVX2 */
+
+#if defined(HAVE_IFUNC) && (defined(RP_CPU_I386) || defined(RP_CPU_AMD64))
+/**
+ * Convert an ETC1 image to rp_image.
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf ETC1 image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)/2]
+ * @return rp_image, or nullptr on error.
+ */
+ATTR_ACCESS_SIZE(read_only, 3, 4)
+IFUNC_STATIC_INLINE rp_image *fromETC1(int width, int height,
+	const uint8_t *RESTRICT img_buf, int img_siz);
+
+/**
+ * Convert an ETC2 RGB image to rp_image.
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf ETC2 RGB image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)/2]
+ * @return rp_image, or nullptr on error.
+ */
+ATTR_ACCESS_SIZE(read_only, 3, 4)
+IFUNC_STATIC_INLINE rp_image *fromETC2_RGB(int width, int height,
+	const uint8_t *RESTRICT img_buf, int img_siz);
+
+/**
+ * Convert an ETC2 RGBA image to rp_image.
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf ETC2 RGBA image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)]
+ * @return rp_image, or nullptr on error.
+ */
+ATTR_ACCESS_SIZE(read_only, 3, 4)
+IFUNC_STATIC_INLINE rp_image *fromETC2_RGBA(int width, int height,
+	const uint8_t *RESTRICT img_buf, int img_siz);
+
+/**
+ * Convert an ETC2 RGB+A1 (punchthrough alpha) image to rp_image.
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf ETC2 RGB+A1 image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)/2]
+ * @return rp_image, or nullptr on error.
+ */
+ATTR_ACCESS_SIZE(read_only, 3, 4)
+IFUNC_STATIC_INLINE rp_image *fromETC2_RGB_A1(int width, int height,
+	const uint8_t *RESTRICT img_buf, int img_siz);
+
+/**
+ * Convert an EAC R11 image to rp_image.
  * @param width Image width.
  * @param height Image height.
  * @param img_buf EAC R11 image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)/2]
+ * @return rp_image, or nullptr on error.
+ */
+ATTR_ACCESS_SIZE(read_only, 3, 4)
+IFUNC_STATIC_INLINE rp_image *fromEAC_R11(int width, int height,
+	const uint8_t *RESTRICT img_buf, int img_siz);
+
+/**
+ * Convert an EAC RG11 image to rp_image.
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf EAC RG11 image buffer.
  * @param img_siz Size of image data. [must be >= (w*h)]
  * @return rp_image, or nullptr on error.
  */
 ATTR_ACCESS_SIZE(read_only, 3, 4)
-rp_image *fromEAC_RG11(int width, int height,
+IFUNC_STATIC_INLINE rp_image *fromEAC_RG11(int width, int height,
 	const uint8_t *RESTRICT img_buf, int img_siz);
+#else
+// System does not support IFUNC, or we aren't guaranteed to have
+// optimizations for these CPUs. Use standard inline dispatch.
+
+/**
+ * Convert an ETC1 image to rp_image.
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf ETC1 image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)/2]
+ * @return rp_image, or nullptr on error.
+ */
+ATTR_ACCESS_SIZE(read_only, 3, 4)
+static inline rp_image *fromETC1(int width, int height,
+	const uint8_t *RESTRICT img_buf, int img_siz)
+{
+#  ifdef IMAGEDECODER_HAS_AVX2
+	if (RP_CPU_HasAVX2()) {
+		return fromETC1_avx2(width, height, img_buf, img_siz);
+	} else
+#  endif /* IMAGEDECODER_HAS_AVX2 */
+#  ifdef IMAGEDECODER_HAS_SSE41
+	if (RP_CPU_HasSSE41()) {
+		return fromETC1_sse41(width, height, img_buf, img_siz);
+	} else
+#  endif /* IMAGEDECODER_HAS_SSE41 */
+	{
+		return fromETC1_cpp(width, height, img_buf, img_siz);
+	}
+}
+
+/**
+ * Convert an ETC2 RGB image to rp_image.
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf ETC2 RGB image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)/2]
+ * @return rp_image, or nullptr on error.
+ */
+ATTR_ACCESS_SIZE(read_only, 3, 4)
+static inline rp_image *fromETC2_RGB(int width, int height,
+	const uint8_t *RESTRICT img_buf, int img_siz)
+{
+#  ifdef IMAGEDECODER_HAS_AVX2
+	if (RP_CPU_HasAVX2()) {
+		return fromETC2_RGB_avx2(width, height, img_buf, img_siz);
+	} else
+#  endif /* IMAGEDECODER_HAS_AVX2 */
+#  ifdef IMAGEDECODER_HAS_SSE41
+	if (RP_CPU_HasSSE41()) {
+		return fromETC2_RGB_sse41(width, height, img_buf, img_siz);
+	} else
+#  endif /* IMAGEDECODER_HAS_SSE41 */
+	{
+		return fromETC2_RGB_cpp(width, height, img_buf, img_siz);
+	}
+}
+
+/**
+ * Convert an ETC2 RGBA image to rp_image.
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf ETC2 RGBA image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)]
+ * @return rp_image, or nullptr on error.
+ */
+ATTR_ACCESS_SIZE(read_only, 3, 4)
+static inline rp_image *fromETC2_RGBA(int width, int height,
+	const uint8_t *RESTRICT img_buf, int img_siz)
+{
+#  ifdef IMAGEDECODER_HAS_AVX2
+	if (RP_CPU_HasAVX2()) {
+		return fromETC2_RGBA_avx2(width, height, img_buf, img_siz);
+	} else
+#  endif /* IMAGEDECODER_HAS_AVX2 */
+#  ifdef IMAGEDECODER_HAS_SSE41
+	if (RP_CPU_HasSSE41()) {
+		return fromETC2_RGBA_sse41(width, height, img_buf, img_siz);
+	} else
+#  endif /* IMAGEDECODER_HAS_SSE41 */
+	{
+		return fromETC2_RGBA_cpp(width, height, img_buf, img_siz);
+	}
+}
+
+/**
+ * Convert an ETC2 RGB+A1 (punchthrough alpha) image to rp_image.
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf ETC2 RGB+A1 image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)/2]
+ * @return rp_image, or nullptr on error.
+ */
+ATTR_ACCESS_SIZE(read_only, 3, 4)
+static inline rp_image *fromETC2_RGB_A1(int width, int height,
+	const uint8_t *RESTRICT img_buf, int img_siz)
+{
+#  ifdef IMAGEDECODER_HAS_AVX2
+	if (RP_CPU_HasAVX2()) {
+		return fromETC2_RGB_A1_avx2(width, height, img_buf, img_siz);
+	} else
+#  endif /* IMAGEDECODER_HAS_AVX2 */
+#  ifdef IMAGEDECODER_HAS_SSE41
+	if (RP_CPU_HasSSE41()) {
+		return fromETC2_RGB_A1_sse41(width, height, img_buf, img_siz);
+	} else
+#  endif /* IMAGEDECODER_HAS_SSE41 */
+	{
+		return fromETC2_RGB_A1_cpp(width, height, img_buf, img_siz);
+	}
+}
+
+/**
+ * Convert an EAC R11 image to rp_image.
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf EAC R11 image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)/2]
+ * @return rp_image, or nullptr on error.
+ */
+ATTR_ACCESS_SIZE(read_only, 3, 4)
+static inline rp_image *fromEAC_R11(int width, int height,
+	const uint8_t *RESTRICT img_buf, int img_siz)
+{
+#  ifdef IMAGEDECODER_HAS_AVX2
+	if (RP_CPU_HasAVX2()) {
+		return fromEAC_R11_avx2(width, height, img_buf, img_siz);
+	} else
+#  endif /* IMAGEDECODER_HAS_AVX2 */
+#  ifdef IMAGEDECODER_HAS_SSE41
+	if (RP_CPU_HasSSE41()) {
+		return fromEAC_R11_sse41(width, height, img_buf, img_siz);
+	} else
+#  endif /* IMAGEDECODER_HAS_SSE41 */
+	{
+		return fromEAC_R11_cpp(width, height, img_buf, img_siz);
+	}
+}
+
+/**
+ * Convert an EAC RG11 image to rp_image.
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf EAC RG11 image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)]
+ * @return rp_image, or nullptr on error.
+ */
+ATTR_ACCESS_SIZE(read_only, 3, 4)
+static inline rp_image *fromEAC_RG11(int width, int height,
+	const uint8_t *RESTRICT img_buf, int img_siz)
+{
+#  ifdef IMAGEDECODER_HAS_AVX2
+	if (RP_CPU_HasAVX2()) {
+		return fromEAC_RG11_avx2(width, height, img_buf, img_siz);
+	} else
+#  endif /* IMAGEDECODER_HAS_AVX2 */
+#  ifdef IMAGEDECODER_HAS_SSE41
+	if (RP_CPU_HasSSE41()) {
+		return fromEAC_RG11_sse41(width, height, img_buf, img_siz);
+	} else
+#  endif /* IMAGEDECODER_HAS_SSE41 */
+	{
+		return fromEAC_RG11_cpp(width, height, img_buf, img_siz);
+	}
+}
+#endif /* HAVE_IFUNC && (RP_CPU_I386 || RP_CPU_AMD64) */
 
 #ifdef ENABLE_PVRTC
 /* PVRTC */
@@ -894,6 +1450,7 @@ rp_image *fromPVRTCII(int width, int height,
 
 /**
  * Convert a BC7 image to rp_image.
+ * Standard version using regular C++ code.
  * @param width Image width.
  * @param height Image height.
  * @param img_buf BC7 image buffer.
@@ -901,9 +1458,83 @@ rp_image *fromPVRTCII(int width, int height,
  * @return rp_image, or nullptr on error.
  */
 ATTR_ACCESS_SIZE(read_only, 3, 4)
-rp_image *fromBC7(int width, int height,
+rp_image *fromBC7_cpp(int width, int height,
 	const uint8_t *img_buf, int img_siz);
 
+#ifdef IMAGEDECODER_HAS_SSE41
+/**
+ * Convert a BC7 image to rp_image.
+ * SSE4.1-optimized version.
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf BC7 image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)]
+ * @return rp_image, or nullptr on error.
+ */
+ATTR_ACCESS_SIZE(read_only, 3, 4)
+rp_image *fromBC7_sse41(int width, int height,
+	const uint8_t *img_buf, int img_siz);
+#endif /* IMAGEDECODER_HAS_SSE41 */
+
+#ifdef IMAGEDECODER_HAS_AVX2
+/**
+ * Convert a BC7 image to rp_image.
+ * AVX2-optimized version.
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf BC7 image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)]
+ * @return rp_image, or nullptr on error.
+ */
+ATTR_ACCESS_SIZE(read_only, 3, 4)
+rp_image *fromBC7_avx2(int width, int height,
+	const uint8_t *img_buf, int img_siz);
+#endif /* IMAGEDECODER_HAS_AVX2 */
+
+#if defined(HAVE_IFUNC) && (defined(RP_CPU_I386) || defined(RP_CPU_AMD64))
+/**
+ * Convert a BC7 image to rp_image.
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf BC7 image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)]
+ * @return rp_image, or nullptr on error.
+ */
+ATTR_ACCESS_SIZE(read_only, 3, 4)
+IFUNC_STATIC_INLINE rp_image *fromBC7(int width, int height,
+	const uint8_t *img_buf, int img_siz);
+#else
+// System does not support IFUNC, or we aren't guaranteed to have
+// optimizations for these CPUs. Use standard inline dispatch.
+
+/**
+ * Convert a BC7 image to rp_image.
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf BC7 image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)]
+ * @return rp_image, or nullptr on error.
+ */
+ATTR_ACCESS_SIZE(read_only, 3, 4)
+static inline rp_image *fromBC7(int width, int height,
+	const uint8_t *img_buf, int img_siz)
+{
+#  ifdef IMAGEDECODER_HAS_AVX2
+	if (RP_CPU_HasAVX2()) {
+		return fromBC7_avx2(width, height, img_buf, img_siz);
+	} else
+#  endif /* IMAGEDECODER_HAS_AVX2 */
+#  ifdef IMAGEDECODER_HAS_SSE41
+	if (RP_CPU_HasSSE41()) {
+		return fromBC7_sse41(width, height, img_buf, img_siz);
+	} else
+#  endif /* IMAGEDECODER_HAS_SSE41 */
+	{
+		return fromBC7_cpp(width, height, img_buf, img_siz);
+	}
+}
+#endif /* HAVE_IFUNC && (RP_CPU_I386 || RP_CPU_AMD64) */
+
 #ifdef ENABLE_ASTC
 /**
  * Convert an ASTC 2D image to rp_image.
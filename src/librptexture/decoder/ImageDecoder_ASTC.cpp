@@ -9,6 +9,7 @@
 #include "stdafx.h"
 
 #include "ImageDecoder.hpp"
+#include "ImageDecoder_p.hpp"
 #include "basisu_astc_decomp.h"
 
 // librptexture
@@ -74,66 +75,69 @@ rp_image *fromASTC(int width, int height,
 	// Calculate the total number of tiles.
 	const int tilesX = physWidth / block_x;
 	const int tilesY = physHeight / block_y;
-	const unsigned int bytesPerTileRow = tilesX * 16;	// for OpenMP
+	const unsigned int bytesPerTileRow = tilesX * 16;
+
+	// Precompute the partition and weight infill tables used by this texture.
+	// NOTE: This must be done before decoding, since the tables
+	// are shared by all threads.
+	basisu_astc::astc::decompress_tables tables(block_x, block_y);
+	tables.prepare(img_buf, static_cast<size_t>(tilesX) * tilesY);
 
 	// NOTE: Largest ASTC format is 12x12.
 	const int stride_px = img->stride() / sizeof(uint32_t);
 	uint32_t *const pDestBits = static_cast<uint32_t*>(img->bits());
 
-#ifdef _OPENMP
-	bool bErr = false;
-#endif /* _OPENMP */
-
-#pragma omp parallel for
-	for (int y = 0; y < tilesY; y++) {
-		const uint8_t *pSrc = &img_buf[y * bytesPerTileRow];
-		for (int x = 0; x < tilesX; x++, pSrc += 16) {
-			// Temporary tile buffer
-			array<uint32_t, 12*12> tileBuf;
-
-			// Decode the tile from ASTC.
-			bool bRet = basisu_astc::astc::decompress(
-				reinterpret_cast<uint8_t*>(tileBuf.data()), pSrc,
-				false,	// TODO: sRGB scaling?
-				block_x, block_y);
-			if (!bRet) {
-				// ASTC decompression error.
-#ifdef _OPENMP
-				// Cannot return when using OpenMP,
-				// so set an error value and continue.
-				bErr = true;
-				break;
-#else /* !_OPENMP */
-				// Not using OpenMP, so return immediately.
-				img->unref();
-				return nullptr;
-#endif /* _OPENMP */
-			}
-
-			// Blit the tile to the main image buffer.
-			// NOTE: Not using BlitTile because ASTC has lots of different tile sizes.
-
-			// Go to the first pixel for this tile.
-			uint32_t *pDest = pDestBits;
-			pDest += (y * block_y) * stride_px;
-			pDest += (x * block_x);
-
-			const uint32_t *pTileBuf = tileBuf.data();
-			for (unsigned int ty = block_y; ty > 0; ty--) {
-				memcpy(pDest, pTileBuf, (block_x * sizeof(uint32_t)));
-				pDest += stride_px;
-				pTileBuf += block_x;
+	// Decode the image in bands of block rows.
+	const bool bOK = ImageDecoderPrivate::decodeBlockRows(img, tilesY, [&](unsigned int rowBegin, unsigned int rowEnd) {
+		for (unsigned int y = rowBegin; y < rowEnd; y++) {
+			const uint8_t *pSrc = &img_buf[y * bytesPerTileRow];
+			for (int x = 0; x < tilesX; x++, pSrc += 16) {
+				// Go to the first pixel for this tile.
+				uint32_t *pDest = pDestBits;
+				pDest += (y * block_y) * stride_px;
+				pDest += (x * block_x);
+
+				// Void-extent blocks have a single color for the entire block.
+				uint32_t color;
+				if (basisu_astc::astc::getVoidExtentColor(reinterpret_cast<uint8_t*>(&color), pSrc)) {
+					for (unsigned int ty = block_y; ty > 0; ty--) {
+						std::fill_n(pDest, block_x, color);
+						pDest += stride_px;
+					}
+					continue;
+				}
+
+				// Temporary tile buffer
+				array<uint32_t, 12*12> tileBuf;
+
+				// Decode the tile from ASTC.
+				bool bRet = basisu_astc::astc::decompress(
+					reinterpret_cast<uint8_t*>(tileBuf.data()), pSrc,
+					false,	// TODO: sRGB scaling?
+					block_x, block_y, &tables);
+				if (!bRet) {
+					// ASTC decompression error.
+					return false;
+				}
+
+				// Blit the tile to the main image buffer.
+				// NOTE: Not using BlitTile because ASTC has lots of different tile sizes.
+				const uint32_t *pTileBuf = tileBuf.data();
+				for (unsigned int ty = block_y; ty > 0; ty--) {
+					memcpy(pDest, pTileBuf, (block_x * sizeof(uint32_t)));
+					pDest += stride_px;
+					pTileBuf += block_x;
+				}
 			}
 		}
-	}
+		return true;
+	});
 
-#ifdef _OPENMP
-	if (bErr) {
+	if (!bOK) {
 		// A decompression error occurred.
 		img->unref();
 		return nullptr;
 	}
-#endif /* _OPENMP */
 
 	if (width < physWidth || height < physHeight) {
 		// Shrink the image.
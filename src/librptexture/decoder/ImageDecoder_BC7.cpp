@@ -10,6 +10,7 @@
 
 #include "ImageDecoder.hpp"
 #include "ImageDecoder_p.hpp"
+#include "ImageDecoder_BC7_p.hpp"
 
 // C++ STL classes.
 using std::array;
@@ -20,10 +21,13 @@ using std::array;
 
 namespace LibRpTexture { namespace ImageDecoder {
 
+// NOTE: The BC7 tables are shared with the SIMD-optimized decoders.
+namespace BC7 {
+
 // Interpolation values.
-static const uint8_t aWeight2[] = {0, 21, 43, 64};
-static const uint8_t aWeight3[] = {0, 9, 18, 27, 37, 46, 55, 64};
-static const uint8_t aWeight4[] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+const uint8_t aWeight2[4] = {0, 21, 43, 64};
+const uint8_t aWeight3[8] = {0, 9, 18, 27, 37, 46, 55, 64};
+const uint8_t aWeight4[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
 
 /** Partition definitions. **/
 
@@ -35,7 +39,7 @@ static const uint8_t aWeight4[] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47,
 // References:
 // - https://rockets2000.wordpress.com/2015/05/19/bc7-partitions-subsets/
 // - https://github.com/hglm/detex/blob/master/bptc-tables.c
-static const uint32_t bc7_2sub[64] = {
+const uint32_t bc7_2sub[64] = {
 	0x50505050, 0x40404040, 0x54545454, 0x54505040,
 	0x50404000, 0x55545450, 0x55545040, 0x54504000,
 	0x50400000, 0x55555450, 0x55544000, 0x54400000,
@@ -58,7 +62,7 @@ static const uint32_t bc7_2sub[64] = {
 // References:
 // - https://rockets2000.wordpress.com/2015/05/19/bc7-partitions-subsets/
 // - https://github.com/hglm/detex/blob/master/bptc-tables.c
-static const uint32_t bc7_3sub[64] = {
+const uint32_t bc7_3sub[64] = {
 	0xAA685050, 0x6A5A5040, 0x5A5A4200, 0x5450A0A8,
 	0xA5A50000, 0xA0A05050, 0x5555A0A0, 0x5A5A5050,
 	0xAA550000, 0xAA555500, 0xAAAA5500, 0x90909090,
@@ -77,6 +81,45 @@ static const uint32_t bc7_3sub[64] = {
 	0x40804080, 0xA9A8A9A8, 0xAAAAAA44, 0x2A4A5254
 };
 
+// Anchor indexes for the second subset (idx == 1) in 2-subset modes.
+const uint8_t anchorIndexes_subset2of2[64] = {
+	15, 15, 15, 15, 15, 15, 15, 15,
+	15, 15, 15, 15, 15, 15, 15, 15,
+	15,  2,  8,  2,  2,  8,  8, 15,
+	 2,  8,  2,  2,  8,  8,  2,  2,
+	15, 15,  6,  8,  2,  8, 15, 15,
+	 2,  8,  2,  2,  2, 15, 15,  6,
+	 6,  2,  6,  8, 15, 15,  2,  2,
+	15, 15, 15, 15, 15,  2,  2, 15,
+};
+
+// Anchor indexes for the second subset (idx == 1) in 3-subset modes.
+const uint8_t anchorIndexes_subset2of3[64] = {
+	 3,  3, 15, 15,  8,  3, 15, 15,
+	 8,  8,  6,  6,  6,  5,  3,  3,
+	 3,  3,  8, 15,  3,  3,  6, 10,
+	 5,  8,  8,  6,  8,  5, 15, 15,
+	 8, 15,  3,  5,  6, 10,  8, 15,
+	15,  3, 15,  5, 15, 15, 15, 15,
+	 3, 15,  5,  5,  5,  8,  5, 10,
+	 5, 10,  8, 13, 15, 12,  3,  3,
+};
+
+// Anchor indexes for the third subset (idx == 2) in 3-subset modes.
+const uint8_t anchorIndexes_subset3of3[64] = {
+	15,  8,  8,  3, 15, 15,  3,  8,
+	15, 15, 15, 15, 15, 15, 15,  8,
+	15,  8, 15,  3, 15,  8, 15,  8,
+	 3, 15,  6, 10, 15, 15, 10,  8,
+	15,  3, 15, 10, 10,  8,  9, 10,
+	 6, 15,  8, 15,  3,  6,  6,  8,
+	15,  3, 15, 15, 15, 15, 15, 15,
+	15, 15, 15, 15,  3, 15, 15,  8,
+};
+
+}
+using namespace BC7;
+
 /**
  * Interpolate a color component.
  * @tparam bits Index precision, in number of bits.
@@ -139,41 +182,6 @@ static inline int get_mode(uint32_t dword0)
 	return -1;
 }
 
-// Anchor indexes for the second subset (idx == 1) in 2-subset modes.
-static const uint8_t anchorIndexes_subset2of2[64] = {
-	15, 15, 15, 15, 15, 15, 15, 15,
-	15, 15, 15, 15, 15, 15, 15, 15,
-	15,  2,  8,  2,  2,  8,  8, 15,
-	 2,  8,  2,  2,  8,  8,  2,  2,
-	15, 15,  6,  8,  2,  8, 15, 15,
-	 2,  8,  2,  2,  2, 15, 15,  6,
-	 6,  2,  6,  8, 15, 15,  2,  2,
-	15, 15, 15, 15, 15,  2,  2, 15,
-};
-
-// Anchor indexes for the second subset (idx == 1) in 3-subset modes.
-static const uint8_t anchorIndexes_subset2of3[64] = {
-	 3,  3, 15, 15,  8,  3, 15, 15,
-	 8,  8,  6,  6,  6,  5,  3,  3,
-	 3,  3,  8, 15,  3,  3,  6, 10,
-	 5,  8,  8,  6,  8,  5, 15, 15,
-	 8, 15,  3,  5,  6, 10,  8, 15,
-	15,  3, 15,  5, 15, 15, 15, 15,
-	 3, 15,  5,  5,  5,  8,  5, 10,
-	 5, 10,  8, 13, 15, 12,  3,  3,
-};
-
-// Anchor indexes for the third subset (idx == 2) in 3-subset modes.
-static const uint8_t anchorIndexes_subset3of3[64] = {
-	15,  8,  8,  3, 15, 15,  3,  8,
-	15, 15, 15, 15, 15, 15, 15,  8,
-	15,  8, 15,  3, 15,  8, 15,  8,
-	 3, 15,  6, 10, 15, 15, 10,  8,
-	15,  3, 15, 10, 10,  8,  9, 10,
-	 6, 15,  8, 15,  3,  6,  6,  8,
-	15,  3, 15, 15, 15, 15, 15, 15,
-	15, 15, 15, 15,  3, 15, 15,  8,
-};
 
 /**
  * Get the index of the "anchor" bits for implied index bits.
@@ -217,42 +225,6 @@ static uint8_t getAnchorIndex(uint8_t partition, uint8_t subset, uint8_t subsetC
 	return idx;
 }
 
-/**
- * BC7 block struct.
- */
-struct bc7_block {
-	uint64_t lsb;
-	uint64_t msb;
-
-	bc7_block(const uint64_t *src)
-	{
-		// TODO: Make sure this is correct on big-endian.
-		lsb = le64_to_cpu(src[0]);
-		msb = le64_to_cpu(src[1]);
-	}
-
-	/**
-	 * Right-shift the two 64-bit values as if it's a single 128-bit value.
-	 * NOTE: Assuming `shamt` is always less than 64.
-	 * @param shamt	[in] Shift amount
-	 */
-	FORCEINLINE void rshift128(unsigned int shamt)
-	{
-		assert(shamt < 64);
-		if (shamt == 0) {
-			// Nothing to do here...
-			return;
-		}
-
-		// Shift LSB first.
-		lsb >>= shamt;
-		// Copy from MSB to LSB.
-		lsb |= (msb << (64 - shamt));
-		// Shift MSB next.
-		msb >>= shamt;
-	}
-};
-
 /**
  * Decode a BC7 block.
  * @param tileBuf	[out] Tile buffer
@@ -643,13 +615,14 @@ static int decodeBC7Block(array<argb32_t, 4*4> &tileBuf, const uint64_t *bc7_src
 
 /**
  * Convert a BC7 image to rp_image.
+ * Standard version using regular C++ code.
  * @param width Image width.
  * @param height Image height.
  * @param img_buf BC7 image buffer.
  * @param img_siz Size of image data. [must be >= (w*h)]
  * @return rp_image, or nullptr on error.
  */
-rp_image *fromBC7(int width, int height,
+rp_image *fromBC7_cpp(int width, int height,
 	const uint8_t *img_buf, int img_siz)
 {
 	// Verify parameters.
@@ -673,7 +646,7 @@ rp_image *fromBC7(int width, int height,
 	// Calculate the total number of tiles.
 	const int tilesX = physWidth / 4;
 	const int tilesY = physHeight / 4;
-	const unsigned int bytesPerTileRow = tilesX * sizeof(bc7_block);	// for OpenMP
+	const unsigned int bytesPerTileRow = tilesX * sizeof(bc7_block);
 
 	// Create an rp_image.
 	rp_image *const img = new rp_image(physWidth, physHeight, rp_image::Format::ARGB32);
@@ -688,52 +661,40 @@ rp_image *fromBC7(int width, int height,
 	// Rotation bits makes this difficult...
 	static const rp_image::sBIT_t sBIT = {8,8,8,0,8};
 
-#ifdef _OPENMP
-	bool bErr = false;
-#endif /* _OPENMP */
-
-#pragma omp parallel for
-	for (int y = 0; y < tilesY; y++) {
-		// BC7 has eight block modes with varying properties, including
-		// bitfields of different lengths. As such, the only guaranteed
-		// block format we have is 128-bit little-endian, which will be
-		// represented as two uint64_t values, which will be shifted
-		// as each component is processed.
-		// TODO: Optimize by using fewer shifts?
-		const uint64_t *bc7_src = reinterpret_cast<const uint64_t*>(
-			&img_buf[y * bytesPerTileRow]);
-		for (int x = 0; x < tilesX; x++, bc7_src += 2) {
-			// Temporary tile buffer
-			array<argb32_t, 4*4> tileBuf;
-
-			// Decode the block.
-			int ret = decodeBC7Block(tileBuf, bc7_src);
-			if (ret != 0) {
-				// BC7 decoding error.
-#ifdef _OPENMP
-				// Cannot return when using OpenMP,
-				// so set an error value and continue.
-				bErr = true;
-				break;
-#else /* !_OPENMP */
-				// Not using OpenMP, so return immediately.
-				img->unref();
-				return nullptr;
-#endif /* _OPENMP */
-			}
+	// Decode the image in bands of block rows.
+	const bool bOK = ImageDecoderPrivate::decodeBlockRows(img, tilesY, [=](unsigned int rowBegin, unsigned int rowEnd) {
+		for (unsigned int y = rowBegin; y < rowEnd; y++) {
+			// BC7 has eight block modes with varying properties, including
+			// bitfields of different lengths. As such, the only guaranteed
+			// block format we have is 128-bit little-endian, which will be
+			// represented as two uint64_t values, which will be shifted
+			// as each component is processed.
+			// TODO: Optimize by using fewer shifts?
+			const uint64_t *bc7_src = reinterpret_cast<const uint64_t*>(
+				&img_buf[y * bytesPerTileRow]);
+			for (int x = 0; x < tilesX; x++, bc7_src += 2) {
+				// Temporary tile buffer
+				array<argb32_t, 4*4> tileBuf;
+
+				// Decode the block.
+				int ret = decodeBC7Block(tileBuf, bc7_src);
+				if (ret != 0) {
+					// BC7 decoding error.
+					return false;
+				}
 
-			// Blit the tile to the main image buffer.
-			ImageDecoderPrivate::BlitTile<uint32_t, 4, 4>(img, tileBuf, x, y);
+				// Blit the tile to the main image buffer.
+				ImageDecoderPrivate::BlitTile<uint32_t, 4, 4>(img, tileBuf, x, y);
+			}
 		}
-	}
+		return true;
+	});
 
-#ifdef _OPENMP
-	if (bErr) {
+	if (!bOK) {
 		// A decoding error occurred.
 		img->unref();
 		return nullptr;
 	}
-#endif /* _OPENMP */
 
 	if (width < physWidth || height < physHeight) {
 		// Shrink the image.
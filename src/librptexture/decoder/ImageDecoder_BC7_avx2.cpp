@@ -0,0 +1,126 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (librptexture)                     *
+ * ImageDecoder_BC7_avx2.cpp: Image decoding functions. (BC7)              *
+ * AVX2-optimized version.                                                 *
+ *                                                                         *
+ * Copyright (c) 2016-2022 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "stdafx.h"
+
+#include "ImageDecoder.hpp"
+#include "ImageDecoder_BC7_p.hpp"
+
+// AVX2 intrinsics
+#include <immintrin.h>
+
+namespace LibRpTexture { namespace ImageDecoder {
+
+using namespace BC7;
+
+namespace {
+
+/**
+ * AVX2 interpolation kernel.
+ * Processes two rows of four pixels at a time.
+ */
+class KernelAVX2
+{
+	public:
+		/**
+		 * Interpolate an unpacked BC7 block and store it in the image.
+		 * @param dest		[out] Destination pixel (top-left of the tile)
+		 * @param stride_px	[in] Destination stride, in pixels
+		 * @param ub		[in] Unpacked block
+		 */
+		static FORCEINLINE void interpolate_and_store(uint32_t *RESTRICT dest,
+			unsigned int stride_px, const bc7_unpacked &ub)
+		{
+			// Component rotation shuffle masks. (duplicated for both lanes)
+			// - 0: ARGB: No rotation.
+			// - 1: RAGB: Swap A and R.
+			// - 2: GRAB: Swap A and G.
+			// - 3: BRGA: Swap A and B.
+			static const uint8_t rotation_shuf[4][16] = {
+				{0,1,2,3, 4,5,6,7, 8,9,10,11, 12,13,14,15},
+				{0,1,3,2, 4,5,7,6, 8,9,11,10, 12,13,15,14},
+				{0,3,2,1, 4,7,6,5, 8,11,10,9, 12,15,14,13},
+				{3,1,2,0, 7,5,6,4, 11,9,10,8, 15,13,14,12},
+			};
+
+			// Broadcast one byte per pixel to all four bytes of that pixel.
+			// Indexed by row pair: low lane is the first row; high lane is the second row.
+			static const uint8_t bcast_shuf[2][32] = {
+				{ 0, 0, 0, 0,  1, 1, 1, 1,  2, 2, 2, 2,  3, 3, 3, 3,
+				  4, 4, 4, 4,  5, 5, 5, 5,  6, 6, 6, 6,  7, 7, 7, 7},
+				{ 8, 8, 8, 8,  9, 9, 9, 9, 10,10,10,10, 11,11,11,11,
+				 12,12,12,12, 13,13,13,13, 14,14,14,14, 15,15,15,15},
+			};
+
+			// NOTE: vpshufb operates within 128-bit lanes, so all
+			// lookup tables are broadcast to both lanes.
+			const __m256i ep0 = _mm256_broadcastsi128_si256(
+				_mm_loadu_si128(reinterpret_cast<const __m128i*>(ub.ep0)));
+			const __m256i ep1 = _mm256_broadcastsi128_si256(
+				_mm_loadu_si128(reinterpret_cast<const __m128i*>(ub.ep1)));
+			const __m256i subset4 = _mm256_broadcastsi128_si256(
+				_mm_loadu_si128(reinterpret_cast<const __m128i*>(ub.subset4)));
+			const __m256i wc = _mm256_broadcastsi128_si256(
+				_mm_loadu_si128(reinterpret_cast<const __m128i*>(ub.wc)));
+			const __m256i wa = _mm256_broadcastsi128_si256(
+				_mm_loadu_si128(reinterpret_cast<const __m128i*>(ub.wa)));
+			const __m256i rot = _mm256_broadcastsi128_si256(
+				_mm_loadu_si128(reinterpret_cast<const __m128i*>(rotation_shuf[ub.rotation & 3])));
+
+			const __m256i sel_base = _mm256_set1_epi32(0x03020100);
+			const __m256i alpha_mask = _mm256_set1_epi32(0xFF000000);
+			const __m256i w64 = _mm256_set1_epi8(64);
+			const __m256i round = _mm256_set1_epi16(32);
+
+			for (unsigned int row = 0; row < 4; row += 2, dest += (stride_px * 2)) {
+				const __m256i bcast = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(bcast_shuf[row / 2]));
+
+				// Select the endpoints for each pixel's subset.
+				const __m256i sel = _mm256_add_epi8(_mm256_shuffle_epi8(subset4, bcast), sel_base);
+				const __m256i e0 = _mm256_shuffle_epi8(ep0, sel);
+				const __m256i e1 = _mm256_shuffle_epi8(ep1, sel);
+
+				// Weights: Color weight for BGR; alpha weight for A.
+				const __m256i w = _mm256_blendv_epi8(
+					_mm256_shuffle_epi8(wc, bcast),
+					_mm256_shuffle_epi8(wa, bcast),
+					alpha_mask);
+				const __m256i iw = _mm256_sub_epi8(w64, w);
+
+				// ((64 - w) * e0 + w * e1 + 32) >> 6
+				__m256i lo = _mm256_maddubs_epi16(_mm256_unpacklo_epi8(e0, e1), _mm256_unpacklo_epi8(iw, w));
+				__m256i hi = _mm256_maddubs_epi16(_mm256_unpackhi_epi8(e0, e1), _mm256_unpackhi_epi8(iw, w));
+				lo = _mm256_srli_epi16(_mm256_add_epi16(lo, round), 6);
+				hi = _mm256_srli_epi16(_mm256_add_epi16(hi, round), 6);
+
+				const __m256i px = _mm256_shuffle_epi8(_mm256_packus_epi16(lo, hi), rot);
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dest), _mm256_castsi256_si128(px));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dest + stride_px), _mm256_extracti128_si256(px, 1));
+			}
+		}
+};
+
+}
+
+/**
+ * Convert a BC7 image to rp_image.
+ * AVX2-optimized version.
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf BC7 image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)]
+ * @return rp_image, or nullptr on error.
+ */
+rp_image *fromBC7_avx2(int width, int height,
+	const uint8_t *img_buf, int img_siz)
+{
+	return fromBC7_tmpl<KernelAVX2>(width, height, img_buf, img_siz);
+}
+
+} }
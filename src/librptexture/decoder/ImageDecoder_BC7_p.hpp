@@ -0,0 +1,475 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (librptexture)                     *
+ * ImageDecoder_BC7_p.hpp: Image decoding functions. (BC7) (PRIVATE)       *
+ *                                                                         *
+ * Copyright (c) 2016-2022 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+/**
+ * Mode-specialized BC7 block unpacking.
+ *
+ * This header is included by the SIMD-optimized BC7 decoders.
+ * Each decoder provides a Kernel class that interpolates and stores
+ * an unpacked block; the block unpacking and image loop are shared.
+ *
+ * NOTE: Everything in the anonymous namespace is instantiated separately
+ * in each translation unit. This is required, since each translation unit
+ * is compiled with different instruction set flags.
+ */
+
+#ifndef __ROMPROPERTIES_LIBRPTEXTURE_DECODER_IMAGEDECODER_BC7_P_HPP__
+#define __ROMPROPERTIES_LIBRPTEXTURE_DECODER_IMAGEDECODER_BC7_P_HPP__
+
+#include "common.h"
+#include "librpcpu/byteswap_rp.h"
+#include "librpcpu/bitstuff.h"
+#include "../img/rp_image.hpp"
+#include "ImageDecoder_p.hpp"
+
+// C includes. (C++ namespace)
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+
+namespace LibRpTexture { namespace ImageDecoder { namespace BC7 {
+
+// Interpolation values.
+extern const uint8_t aWeight2[4];
+extern const uint8_t aWeight3[8];
+extern const uint8_t aWeight4[16];
+
+// Partition definitions for modes with 2 and 3 subsets.
+extern const uint32_t bc7_2sub[64];
+extern const uint32_t bc7_3sub[64];
+
+// Anchor indexes for subsets other than subset 0.
+extern const uint8_t anchorIndexes_subset2of2[64];
+extern const uint8_t anchorIndexes_subset2of3[64];
+extern const uint8_t anchorIndexes_subset3of3[64];
+
+/**
+ * BC7 block struct.
+ */
+struct bc7_block {
+	uint64_t lsb;
+	uint64_t msb;
+
+	bc7_block(const uint64_t *src)
+	{
+		// TODO: Make sure this is correct on big-endian.
+		lsb = le64_to_cpu(src[0]);
+		msb = le64_to_cpu(src[1]);
+	}
+
+	/**
+	 * Right-shift the two 64-bit values as if it's a single 128-bit value.
+	 * NOTE: Assuming `shamt` is always less than 64.
+	 * @param shamt	[in] Shift amount
+	 */
+	FORCEINLINE void rshift128(unsigned int shamt)
+	{
+		assert(shamt < 64);
+		if (shamt == 0) {
+			// Nothing to do here...
+			return;
+		}
+
+		// Shift LSB first.
+		lsb >>= shamt;
+		// Copy from MSB to LSB.
+		lsb |= (msb << (64 - shamt));
+		// Shift MSB next.
+		msb >>= shamt;
+	}
+};
+
+/**
+ * Unpacked BC7 block.
+ * Endpoints are fully expanded, and indexes are converted to weights,
+ * so the only remaining step is interpolation.
+ */
+struct bc7_unpacked {
+	uint32_t ep0[4];	// Endpoint 0 for each subset (ARGB32)
+	uint32_t ep1[4];	// Endpoint 1 for each subset (ARGB32)
+	uint8_t subset4[16];	// Subset index for each pixel, multiplied by 4
+	uint8_t wc[16];		// Color weight for each pixel (0-64)
+	uint8_t wa[16];		// Alpha weight for each pixel (0-64)
+	unsigned int rotation;	// Rotation mode (0-3)
+};
+
+// Mode properties.
+// NOTE: These are constexpr so they can be used as template constants.
+static constexpr uint8_t SubsetCount[8] = {3, 2, 3, 2, 1, 1, 1, 2};
+static constexpr uint8_t PartitionBits[8] = {4, 6, 6, 6, 0, 0, 0, 6};
+static constexpr uint8_t EndpointCount[8] = {6, 4, 6, 4, 2, 2, 2, 4};
+static constexpr uint8_t EndpointBits[8] = {4, 6, 5, 7, 5, 7, 7, 5};
+static constexpr uint8_t AlphaBits[8] = {0, 0, 0, 0, 6, 8, 7, 5};
+static constexpr uint8_t PBitCount[8] = {1, 1, 0, 1, 0, 0, 1, 1};
+static constexpr uint8_t IndexBits[8] = {3, 3, 2, 2, 0, 2, 4, 2};
+
+namespace {
+
+/**
+ * Get the weight table for the specified index precision.
+ * @param bits Index precision, in number of bits. (2, 3, 4)
+ * @return Weight table.
+ */
+static FORCEINLINE const uint8_t *getWeightTable(unsigned int bits)
+{
+	assert(bits >= 2 && bits <= 4);
+	return (bits == 2) ? aWeight2 : ((bits == 3) ? aWeight3 : aWeight4);
+}
+
+/**
+ * Convert an index stream to weights.
+ * @tparam subsetCount Number of subsets. (1, 2, 3)
+ * @param weights	[out] Weights (16)
+ * @param idxData	[in] Index data
+ * @param index_bits	[in] Bits per index
+ * @param subset	[in] Subset data (2 bits per pixel)
+ * @param anchor_index	[in] Anchor indexes
+ */
+template<unsigned int subsetCount>
+static FORCEINLINE void indexesToWeights(uint8_t *RESTRICT weights,
+	uint64_t idxData, unsigned int index_bits,
+	uint32_t subset, const uint8_t *RESTRICT anchor_index)
+{
+	const uint8_t *const wtbl = getWeightTable(index_bits);
+	const unsigned int index_mask = (1U << index_bits) - 1;
+
+	// Pixel 0 is always the anchor for subset 0.
+	weights[0] = wtbl[idxData & (index_mask >> 1)];
+	idxData >>= (index_bits - 1);
+	subset >>= 2;
+
+	for (unsigned int i = 1; i < 16; i++, subset >>= 2) {
+		if (subsetCount > 1 && i == anchor_index[subset & 3]) {
+			// This is an anchor index.
+			// Highest bit is 0.
+			weights[i] = wtbl[idxData & (index_mask >> 1)];
+			idxData >>= (index_bits - 1);
+		} else {
+			// Regular index.
+			weights[i] = wtbl[idxData & index_mask];
+			idxData >>= index_bits;
+		}
+	}
+}
+
+/**
+ * Unpack a BC7 block.
+ * This is the same algorithm as decodeBC7Block() in ImageDecoder_BC7.cpp,
+ * but specialized for a single mode at compile time.
+ * @tparam mode Block mode (0-7)
+ * @param ub	[out] Unpacked block
+ * @param block	[in] BC7 block
+ */
+template<unsigned int mode>
+static FORCEINLINE void unpackBlock(bc7_unpacked &ub, bc7_block block)
+{
+	static const unsigned int subsetCount = SubsetCount[mode];
+	static const unsigned int partitionBits = PartitionBits[mode];
+	static const unsigned int endpointCount = EndpointCount[mode];
+
+	block.rshift128(mode+1);
+
+	// Rotation mode. (Modes 4 and 5 only)
+	ub.rotation = 0;
+	if (mode == 4 || mode == 5) {
+		ub.rotation = block.lsb & 3;
+		block.rshift128(2);
+	}
+
+	// Index mode selector. (Mode 4 only)
+	unsigned int idxMode_m4 = 0;
+	if (mode == 4) {
+		idxMode_m4 = block.lsb & 1;
+		block.rshift128(1);
+	}
+
+	// Subset/partition.
+	uint32_t subset = 0;
+	unsigned int partition = 0;
+	if (partitionBits != 0) {
+		partition = block.lsb & ((1U << partitionBits) - 1);
+		block.rshift128(partitionBits);
+		subset = (subsetCount == 2) ? bc7_2sub[partition] : bc7_3sub[partition];
+	}
+
+	// Endpoints. ([endpoint][RGBx])
+	union {
+		uint8_t   u8[6][4];
+		uint32_t u32[6];
+	} endpoints;
+
+	// Extract and extend the components.
+	// NOTE: Components are stored in RRRR/GGGG/BBBB order.
+	unsigned int endpoint_bits = EndpointBits[mode];
+	{
+		const uint8_t endpoint_mask = (1U << endpoint_bits) - 1;
+		const uint8_t endpoint_shamt = 8U - endpoint_bits;
+		for (unsigned int comp = 0; comp < 3; comp++) {
+			for (unsigned int ep = 0; ep < endpointCount; ep++) {
+				endpoints.u8[ep][comp] = (block.lsb & endpoint_mask) << endpoint_shamt;
+				block.rshift128(endpoint_bits);
+			}
+		}
+	}
+
+	// Alpha components.
+	// If no alpha is present, this will be 255.
+	uint8_t alpha[6] = {255, 255, 255, 255, 255, 255};
+	unsigned int alpha_bits = AlphaBits[mode];
+	if (alpha_bits != 0) {
+		const uint8_t alpha_mask = (1U << alpha_bits) - 1;
+		const uint8_t alpha_shamt = 8U - alpha_bits;
+		for (unsigned int i = 0; i < endpointCount; i++) {
+			alpha[i] = (block.lsb & alpha_mask) << alpha_shamt;
+			block.rshift128(alpha_bits);
+		}
+	}
+
+	// P-bits.
+	if (PBitCount[mode] != 0) {
+		if (mode == 1) {
+			// Mode 1: Two P-bits for four endpoints.
+			if (block.lsb & 1) {
+				endpoints.u32[0] |= 0x02020202;
+				endpoints.u32[1] |= 0x02020202;
+			}
+			if (block.lsb & 2) {
+				endpoints.u32[2] |= 0x02020202;
+				endpoints.u32[3] |= 0x02020202;
+			}
+			block.rshift128(2);
+		} else {
+			// Other modes: Unique P-bit for each endpoint.
+			const unsigned int p_ep_shamt = 7 - endpoint_bits;
+			unsigned int lsb8 = (block.lsb & 0xFF);
+			for (unsigned int i = 0; i < endpointCount; i++, lsb8 >>= 1) {
+				if (lsb8 & 1) {
+					endpoints.u32[i] |= (0x01010101 << p_ep_shamt);
+				}
+			}
+
+			if (alpha_bits > 0) {
+				const unsigned int p_a_shamt = 7 - alpha_bits;
+				lsb8 = (block.lsb & 0xFF);
+				for (unsigned int i = 0; i < endpointCount; i++, lsb8 >>= 1) {
+					alpha[i] |= (lsb8 & 1) << p_a_shamt;
+				}
+				alpha_bits++;
+			}
+
+			block.rshift128(endpointCount);
+		}
+		endpoint_bits++;
+	}
+
+	// Expand the endpoints and alpha components.
+	if (endpoint_bits < 8) {
+		for (unsigned int i = 0; i < endpointCount; i++) {
+			endpoints.u8[i][0] |= (endpoints.u8[i][0] >> endpoint_bits);
+			endpoints.u8[i][1] |= (endpoints.u8[i][1] >> endpoint_bits);
+			endpoints.u8[i][2] |= (endpoints.u8[i][2] >> endpoint_bits);
+		}
+	}
+	if (alpha_bits != 0 && alpha_bits < 8) {
+		for (unsigned int i = 0; i < endpointCount; i++) {
+			alpha[i] |= (alpha[i] >> alpha_bits);
+		}
+	}
+
+	// Pack the endpoints as ARGB32.
+	for (unsigned int s = 0; s < subsetCount; s++) {
+		ub.ep0[s] = ((uint32_t)alpha[s*2] << 24) |
+			    ((uint32_t)endpoints.u8[s*2][0] << 16) |
+			    ((uint32_t)endpoints.u8[s*2][1] << 8) |
+			     (uint32_t)endpoints.u8[s*2][2];
+		ub.ep1[s] = ((uint32_t)alpha[s*2+1] << 24) |
+			    ((uint32_t)endpoints.u8[s*2+1][0] << 16) |
+			    ((uint32_t)endpoints.u8[s*2+1][1] << 8) |
+			     (uint32_t)endpoints.u8[s*2+1][2];
+	}
+	for (unsigned int s = subsetCount; s < 4; s++) {
+		ub.ep0[s] = 0;
+		ub.ep1[s] = 0;
+	}
+
+	// Subset indexes.
+	if (subsetCount == 1) {
+		memset(ub.subset4, 0, sizeof(ub.subset4));
+	} else {
+		uint32_t subsetData = subset;
+		for (unsigned int i = 0; i < 16; i++, subsetData >>= 2) {
+			assert((subsetData & 3) != 3);
+			ub.subset4[i] = (subsetData & 3) * 4;
+		}
+	}
+
+	// Anchor indexes.
+	uint8_t anchor_index[4] = {0, 0, 0, 0};
+	if (subsetCount == 2) {
+		anchor_index[1] = anchorIndexes_subset2of2[partition];
+	} else if (subsetCount == 3) {
+		anchor_index[1] = anchorIndexes_subset2of3[partition];
+		anchor_index[2] = anchorIndexes_subset3of3[partition];
+	}
+
+	// At this point, the only remaining data is indexes.
+	if (mode == 4) {
+		// Mode 4 has both 2-bit and 3-bit indexes.
+		// NOTE: We've already shifted by 50 bits by now, so the
+		// MSB contains the high 14 bits of the 3-bit index data, and
+		// the LSB contains the low 33 bits of the 3-bit index data.
+		const uint64_t idx2 = block.lsb & ((1U << 31) - 1);
+		const uint64_t idx3 = (block.msb << 33) | (block.lsb >> 31);
+		if (idxMode_m4) {
+			// Color == 3-bit, Alpha == 2-bit
+			indexesToWeights<1>(ub.wc, idx3, 3, 0, anchor_index);
+			indexesToWeights<1>(ub.wa, idx2, 2, 0, anchor_index);
+		} else {
+			// Color == 2-bit, Alpha == 3-bit
+			indexesToWeights<1>(ub.wc, idx2, 2, 0, anchor_index);
+			indexesToWeights<1>(ub.wa, idx3, 3, 0, anchor_index);
+		}
+	} else {
+		indexesToWeights<subsetCount>(ub.wc, block.lsb, IndexBits[mode], subset, anchor_index);
+		if (mode == 5) {
+			// Mode 5: Separate alpha indexes, stored after the color indexes.
+			indexesToWeights<1>(ub.wa, block.lsb >> 31, IndexBits[mode], 0, anchor_index);
+		} else {
+			// Other modes: Same indexes as color data.
+			// NOTE: Modes 0-3 have alpha == 255 for both endpoints,
+			// so the weight doesn't matter.
+			memcpy(ub.wa, ub.wc, sizeof(ub.wa));
+		}
+	}
+}
+
+/**
+ * Decode a BC7 block directly into an image.
+ * @tparam Kernel Interpolation kernel class
+ * @param dest		[out] Destination pixel (top-left of the tile)
+ * @param stride_px	[in] Destination stride, in pixels
+ * @param bc7_src	[in] BC7 source data
+ * @return 0 on success; negative POSIX error code on error.
+ */
+template<class Kernel>
+static FORCEINLINE int decodeBlock(uint32_t *RESTRICT dest, unsigned int stride_px, const uint64_t *bc7_src)
+{
+	const bc7_block block(bc7_src);
+	bc7_unpacked ub;
+
+	// The mode is indicated by the lowest set bit.
+	const unsigned int mode8 = static_cast<unsigned int>(block.lsb & 0xFF);
+	if (unlikely(mode8 == 0)) {
+		// Invalid mode.
+		return -EIO;
+	}
+
+	switch (uilog2(mode8 & (~mode8 + 1))) {
+		default:
+		case 0:	unpackBlock<0>(ub, block); break;
+		case 1:	unpackBlock<1>(ub, block); break;
+		case 2:	unpackBlock<2>(ub, block); break;
+		case 3:	unpackBlock<3>(ub, block); break;
+		case 4:	unpackBlock<4>(ub, block); break;
+		case 5:	unpackBlock<5>(ub, block); break;
+		case 6:	unpackBlock<6>(ub, block); break;
+		case 7:	unpackBlock<7>(ub, block); break;
+	}
+
+	Kernel::interpolate_and_store(dest, stride_px, ub);
+	return 0;
+}
+
+/**
+ * Convert a BC7 image to rp_image.
+ * @tparam Kernel Interpolation kernel class
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf BC7 image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)]
+ * @return rp_image, or nullptr on error.
+ */
+template<class Kernel>
+static rp_image *fromBC7_tmpl(int width, int height,
+	const uint8_t *img_buf, int img_siz)
+{
+	// Verify parameters.
+	assert(img_buf != nullptr);
+	assert(width > 0);
+	assert(height > 0);
+
+	// BC7 uses 4x4 tiles, but some container formats allow
+	// the last tile to be cut off, so round up for the
+	// physical tile size.
+	const int physWidth = ALIGN_BYTES(4, width);
+	const int physHeight = ALIGN_BYTES(4, height);
+
+	assert(img_siz >= (width * height));
+	if (!img_buf || width <= 0 || height <= 0 ||
+	    img_siz < (physWidth * physHeight))
+	{
+		return nullptr;
+	}
+
+	// Calculate the total number of tiles.
+	const int tilesX = physWidth / 4;
+	const int tilesY = physHeight / 4;
+	const unsigned int bytesPerTileRow = tilesX * sizeof(bc7_block);
+
+	// Create an rp_image.
+	rp_image *const img = new rp_image(physWidth, physHeight, rp_image::Format::ARGB32);
+	if (!img->isValid()) {
+		// Could not allocate the image.
+		img->unref();
+		return nullptr;
+	}
+	const unsigned int stride_px = img->stride() / sizeof(uint32_t);
+	uint32_t *const bits = static_cast<uint32_t*>(img->bits());
+
+	// sBIT metadata.
+	static const rp_image::sBIT_t sBIT = {8,8,8,0,8};
+
+	// Decode the image in bands of block rows.
+	const bool bOK = ImageDecoderPrivate::decodeBlockRows(img, tilesY, [=](unsigned int rowBegin, unsigned int rowEnd) {
+		for (unsigned int y = rowBegin; y < rowEnd; y++) {
+			const uint64_t *bc7_src = reinterpret_cast<const uint64_t*>(
+				&img_buf[y * bytesPerTileRow]);
+			uint32_t *dest = &bits[(y * 4) * stride_px];
+			for (int x = 0; x < tilesX; x++, bc7_src += 2, dest += 4) {
+				if (unlikely(decodeBlock<Kernel>(dest, stride_px, bc7_src) != 0)) {
+					// BC7 decoding error.
+					return false;
+				}
+			}
+		}
+		return true;
+	});
+
+	if (!bOK) {
+		// A decoding error occurred.
+		img->unref();
+		return nullptr;
+	}
+
+	if (width < physWidth || height < physHeight) {
+		// Shrink the image.
+		img->shrink(width, height);
+	}
+
+	// Set the sBIT metadata.
+	img->set_sBIT(&sBIT);
+
+	// Image has been converted.
+	return img;
+}
+
+}
+
+} } }
+
+#endif /* __ROMPROPERTIES_LIBRPTEXTURE_DECODER_IMAGEDECODER_BC7_P_HPP__ */
@@ -10,6 +10,7 @@
 
 #include "stdafx.h"
 #include "ImageDecoder.hpp"
+#include "librpcpu/bitstuff.h"
 
 // librptexture
 #include "img/rp_image.hpp"
@@ -63,7 +64,7 @@ static FORCEINLINE void initDreamcastTwiddleMap(void)
 /**
  * Convert a Dreamcast square twiddled 16-bit image to rp_image.
  * @param px_format 16-bit pixel format.
- * @param width Image width. (Maximum is 4096.)
+ * @param width Image width. (Must be a power of 2; maximum is 4096.)
  * @param height Image height. (Must be equal to width.)
  * @param img_buf 16-bit image buffer.
  * @param img_siz Size of image data. [must be >= (w*h)*2]
@@ -79,80 +80,40 @@ rp_image *fromDreamcastSquareTwiddled16(PixelFormat px_format,
 	assert(height > 0);
 	assert(width == height);
 	assert(width <= 4096);
+	assert(isPow2(width));
 	assert(img_siz >= ((width * height) * 2));
 	if (!img_buf || width <= 0 || height <= 0 ||
-	    width != height || width > 4096 ||
+	    width != height || width > 4096 || !isPow2(width) ||
 	    img_siz < ((width * height) * 2))
 	{
 		return nullptr;
 	}
 
-	// Initialize the twiddle map.
-	initDreamcastTwiddleMap();
-
-	// Create an rp_image.
-	rp_image *const img = new rp_image(width, height, rp_image::Format::ARGB32);
-	if (!img->isValid()) {
-		// Could not allocate the image.
-		img->unref();
-		return nullptr;
-	}
-
-	// Convert one line at a time. (16-bit -> ARGB32)
-	uint32_t *px_dest = static_cast<uint32_t*>(img->bits());
-	const int dest_stride_adj = (img->stride() / sizeof(uint32_t)) - img->width();
 	switch (px_format) {
-		case PixelFormat::ARGB1555: {
-			for (unsigned int y = 0; y < static_cast<unsigned int>(height); y++) {
-				for (unsigned int x = 0; x < static_cast<unsigned int>(width); x++) {
-					const unsigned int srcIdx = ((dc_tmap[x] << 1) | dc_tmap[y]);
-					*px_dest = ARGB1555_to_ARGB32(le16_to_cpu(img_buf[srcIdx]));
-					px_dest++;
-				}
-				px_dest += dest_stride_adj;
-			}
-			// Set the sBIT metadata.
-			static const rp_image::sBIT_t sBIT = {5,5,5,0,1};
-			img->set_sBIT(&sBIT);
+		case PixelFormat::ARGB1555:
+		case PixelFormat::RGB565:
+		case PixelFormat::ARGB4444:
 			break;
-		}
-
-		case PixelFormat::RGB565: {
-			for (unsigned int y = 0; y < static_cast<unsigned int>(height); y++) {
-				for (unsigned int x = 0; x < static_cast<unsigned int>(width); x++) {
-					const unsigned int srcIdx = ((dc_tmap[x] << 1) | dc_tmap[y]);
-					*px_dest = RGB565_to_ARGB32(le16_to_cpu(img_buf[srcIdx]));
-					px_dest++;
-				}
-				px_dest += dest_stride_adj;
-			}
-			// Set the sBIT metadata.
-			static const rp_image::sBIT_t sBIT = {5,6,5,0,0};
-			img->set_sBIT(&sBIT);
-			break;
-		}
-
-		case PixelFormat::ARGB4444: {
-			for (unsigned int y = 0; y < static_cast<unsigned int>(height); y++) {
-				for (unsigned int x = 0; x < static_cast<unsigned int>(width); x++) {
-					const unsigned int srcIdx = ((dc_tmap[x] << 1) | dc_tmap[y]);
-					*px_dest = ARGB4444_to_ARGB32(le16_to_cpu(img_buf[srcIdx]));
-					px_dest++;
-				}
-				px_dest += dest_stride_adj;
-			}
-			// Set the sBIT metadata.
-			static const rp_image::sBIT_t sBIT = {4,4,4,0,4};
-			img->set_sBIT(&sBIT);
-			break;
-		}
-
 		default:
 			assert(!"Invalid pixel format for this function.");
-			img->unref();
 			return nullptr;
 	}
 
+	// Convert the pixels to ARGB32 in twiddled order.
+	// This uses the SIMD-optimized linear decoder.
+	rp_image *const imgtw = fromLinear16(px_format, width, height, img_buf, img_siz);
+	if (!imgtw) {
+		return nullptr;
+	}
+
+	// Dreamcast twiddling is Morton order, with the X and Y bits
+	// interleaved starting with Y. Since the texture is square,
+	// the entire image is a single Morton tile.
+	const uint32_t mask_xy = (1U << (uilog2(width) * 2)) - 1;
+	rp_image *const img = unswizzleMorton32(imgtw,
+		0xAAAAAAAAU & mask_xy, 0x55555555U & mask_xy);
+	imgtw->unref();
+
 	// Image has been converted.
 	return img;
 }
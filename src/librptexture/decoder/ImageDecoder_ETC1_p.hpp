@@ -0,0 +1,690 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (librptexture)                     *
+ * ImageDecoder_ETC1_p.hpp: Image decoding functions. (ETC1) (PRIVATE)     *
+ *                                                                         *
+ * Copyright (c) 2016-2022 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+/**
+ * ETC1/ETC2/EAC block definitions and shared block unpacking.
+ *
+ * This header is included by the standard and SIMD-optimized ETC decoders.
+ * Each SIMD decoder provides a Kernel class that decodes an unpacked block
+ * directly into the image; block unpacking and the image loop are shared.
+ *
+ * NOTE: Everything in the anonymous namespace is instantiated separately
+ * in each translation unit. This is required, since each translation unit
+ * is compiled with different instruction set flags.
+ */
+
+#ifndef __ROMPROPERTIES_LIBRPTEXTURE_DECODER_IMAGEDECODER_ETC1_P_HPP__
+#define __ROMPROPERTIES_LIBRPTEXTURE_DECODER_IMAGEDECODER_ETC1_P_HPP__
+
+#include "common.h"
+#include "librpcpu/byteswap_rp.h"
+#include "../img/rp_image.hpp"
+#include "ImageDecoder_p.hpp"
+
+// C includes. (C++ namespace)
+#include <cassert>
+
+namespace LibRpTexture { namespace ImageDecoder { namespace ETC {
+
+// ETC1 block format.
+// NOTE: Layout maps to on-disk format, which is big-endian.
+typedef union _etc1_block {
+	struct {
+		// Base colors
+		// Byte layout:
+		// - diffbit == 0: 4 MSB == base 1, 4 LSB == base 2
+		// - diffbit == 1: 5 MSB == base, 3 LSB == differential
+		// Some compilers pad this structure to a multiple of 4 bytes
+#pragma pack(1)
+		union PACKED {
+			// Indiv/Diff
+			struct PACKED {
+				uint8_t R;
+				uint8_t G;
+				uint8_t B;
+			} id;
+
+			// ETC2 'T' mode
+			struct PACKED {
+				uint8_t R1;
+				uint8_t G1B1;
+				uint8_t R2G2;
+				// B2 is in `control`.
+			} t;
+
+			// ETC2 'H' mode
+			struct PACKED {
+				uint8_t R1G1a;
+				uint8_t G1bB1aB1b;
+				uint8_t B1bR2G2;
+				// Part of G2 is in `control`.
+				// B2 is in `control`.
+			} h;
+		};
+#pragma pack()
+
+		// Control byte: [ETC1]
+		// - 3 MSB:  table code word 1
+		// - 3 next: table code word 2
+		// - 1 bit:  diff bit
+		// - 1 LSB:  flip bit
+		uint8_t control;
+
+		// Pixel index bits. (big-endian)
+		uint16_t msb;
+		uint16_t lsb;
+	};
+
+	struct {
+		// Planar mode has 3 colors in RGB676 format.
+		// Colors are labelled 'O', 'H', and 'V'.
+		uint8_t RO_GO1;		// 6-1: RO;     0: GO1
+		uint8_t GO2_BO1;	// 6-1: GO2;    0: BO1
+		uint8_t BO2_BO3;	// 4-3: BO2;  1-0: BO3a
+		uint8_t BO3_RH;		//   7: BO3b; 6-2: RH1; 0: RH2
+		uint8_t GH_BH;		// 7-1: GH;     0: BH
+		uint8_t BH_RV;		// 7-3: BH;   2-0: RV
+		uint8_t RV_GV;		// 7-5: RV;   4-0: GV
+		uint8_t GV_BV;		// 7-6: GV;   5-0: BV
+	} planar;
+} etc1_block;
+ASSERT_STRUCT(etc1_block, sizeof(uint64_t));
+
+// ETC2 alpha block format.
+// NOTE: Layout maps to on-disk format, which is big-endian.
+typedef union _etc2_alpha {
+	struct {
+		uint8_t base_codeword;	// Base codeword.
+		uint8_t mult_tbl_idx;	// Multiplier (high 4); table index (low 4)
+		uint8_t values[6];	// Alpha values. (48-bit unsigned; 3-bit per pixel)
+	};
+	uint64_t u64;				// Access the 48-bit alpha value directly. (Requires shifting.)
+} etc2_alpha;
+ASSERT_STRUCT(etc2_alpha, sizeof(uint64_t));
+
+// ETC2 RGBA block format.
+// NOTE: Layout maps to on-disk format, which is big-endian.
+typedef struct _etc2_rgba_block {
+	etc2_alpha alpha;
+	etc1_block etc1;
+} etc2_rgba_block;
+ASSERT_STRUCT(etc2_rgba_block, 16);
+
+/**
+ * Extract the 48-bit code value from etc2_alpha.
+ * @param data etc2_alpha.
+ * @return 48-bit code value.
+ */
+static FORCEINLINE uint64_t extract48(const etc2_alpha *RESTRICT data)
+{
+	// values[6] starts at 0x02 within etc2_alpha.
+	// Hence, we need to mask it after byteswapping.
+	// TODO: constexpr?
+	// TODO: Verify on big-endian.
+	return be64_to_cpu(data->u64) & 0x0000FFFFFFFFFFFFULL;
+}
+
+// Intensity modifier sets.
+// NOTE: See ImageDecoder_ETC1.cpp for the table arrangement.
+extern const int16_t etc1_intensity[8][4];
+extern const int16_t etc2_intensity_a1[8][4];
+
+// ETC1 arranges pixels by column, then by row.
+// This table maps it back to linear.
+extern const uint8_t etc1_mapping[16];
+
+// ETC1 subblock mapping.
+// Index: flip bit
+// Value: 16-bit bitfield; bit 0 == ETC1-arranged pixel 0.
+extern const uint16_t etc1_subblock_mapping[2];
+
+// 3-bit 2's complement lookup table.
+extern const int8_t etc1_3bit_diff_tbl[8];
+
+// ETC2 distance table for 'T' and 'H' modes.
+extern const uint8_t etc2_dist_tbl[8];
+
+// ETC2 alpha modifiers table.
+extern const int8_t etc2_alpha_tbl[16][8];
+
+// ETC2 block mode.
+enum class etc2_block_mode {
+	Unknown = 0,
+	ETC1,	// ETC1-compatible mode (indiv, diff)
+	TH,	// ETC2 'T' or 'H' mode
+	Planar,	// ETC2 'Planar' mode
+};
+
+/**
+ * Extend a 4-bit color component to 8-bit color.
+ * @param value 4-bit color component.
+ * @return 8-bit color value.
+ */
+static inline uint8_t extend_4to8bits(uint8_t value)
+{
+	return (value << 4) | value;
+}
+
+/**
+ * Extend a 5-bit color component to 8-bit color.
+ * @param value 5-bit color component.
+ * @return 8-bit color value.
+ */
+static inline uint8_t extend_5to8bits(uint8_t value)
+{
+	return (value << 3) | (value >> 2);
+}
+
+/**
+ * Extend a 6-bit color component to 8-bit color.
+ * @param value 6-bit color component.
+ * @return 8-bit color value.
+ */
+static inline uint8_t extend_6to8bits(uint8_t value)
+{
+	return (value << 2) | (value >> 4);
+}
+
+/**
+ * Extend a 7-bit color component to 8-bit color.
+ * @param value 7-bit color component.
+ * @return 7-bit color value.
+ */
+static inline uint8_t extend_7to8bits(uint8_t value)
+{
+	return (value << 1) | (value >> 6);
+}
+
+// Temporary RGB structure that allows us to clamp it later.
+struct ColorRGB {
+	int R;
+	int G;
+	int B;
+};
+
+/**
+ * Clamp a ColorRGB struct and convert it to xRGB32.
+ * @param color ColorRGB struct.
+ * @return xRGB32 value. (Alpha channel set to 0xFF)
+ */
+static inline uint32_t clamp_ColorRGB(const ColorRGB &color)
+{
+	uint32_t xrgb32 = 0;
+	if (color.B > 255) {
+		xrgb32 = 255;
+	} else if (color.B > 0) {
+		xrgb32 = color.B;
+	}
+	if (color.G > 255) {
+		xrgb32 |= (255 << 8);
+	} else if (color.G > 0) {
+		xrgb32 |= (color.G << 8);
+	}
+	if (color.R > 255) {
+		xrgb32 |= (255 << 16);
+	} else if (color.R > 0) {
+		xrgb32 |= (color.R << 16);
+	}
+	return xrgb32 | 0xFF000000;
+}
+
+// ETC decoding mode.
+enum ETC_Decoding_Mode {
+	// Bit 0: ETC1 vs. ETC2
+	ETC_DM_ETC1	= (0U << 0),	// ETC1
+	ETC_DM_ETC2	= (1U << 0),	// ETC2
+	ETC_DM_MASK12	= (1U << 0),
+
+	// Bit 1: ETC2 punchthrough alpha
+	ETC2_DM_A1	= (1U << 1),
+};
+
+/**
+ * Unpacked ETC1/ETC2 RGB block.
+ * Base and paint colors are fully expanded, so the only
+ * remaining step is applying the per-pixel indexes.
+ */
+struct etc_rgb_unpacked {
+	etc2_block_mode block_mode;
+
+	// Base colors.
+	// For ETC1 mode, these are used as base colors for the two subblocks.
+	// For 'T' and 'H' mode, these are used to calculate the paint colors.
+	// For 'Planar' mode, three colors are used as 'O', 'H', and 'V'.
+	ColorRGB base_color[3];
+
+	// 'T', 'H' modes: Paint colors are used instead of base colors.
+	// Intensity modifications are not supported, so we'll store the
+	// final xRGB32 values instead of ColorRGB.
+	uint32_t paint_color[4];
+
+	// ETC1 mode: Intensities for the table codewords.
+	const int16_t *tbl[2];
+
+	// ETC1 mode: Subblock bitfield. (ETC1-arranged)
+	uint16_t subblock;
+
+	// Pixel index bits. (ETC1-arranged)
+	uint16_t px_msb;
+	uint16_t px_lsb;
+
+	// ETC2 punchthrough alpha: If true, px_idx == 2 is transparent.
+	bool punchthrough;
+};
+
+/**
+ * Unpack an ETC1/ETC2 RGB block.
+ * @tparam mode		[in] Mode flags. (ETC_Decoding_Mode)
+ * @param ub		[out] Unpacked block.
+ * @param etc1_src	[in] Source RGB block.
+ */
+template</* ETC_Decoding_Mode */ unsigned int mode>
+static inline void unpackBlock_ETC_RGB(etc_rgb_unpacked &ub, const etc1_block *etc1_src)
+{
+	// Prevent invalid combinations from being used.
+	static_assert(mode != (ETC_DM_ETC1 | ETC2_DM_A1), "Cannot use ETC1 with punchthrough alpha.");
+
+	ColorRGB *const base_color = ub.base_color;
+	uint32_t *const paint_color = ub.paint_color;
+
+	// ETC2 block mode.
+	etc2_block_mode block_mode = etc2_block_mode::Unknown;
+
+	// TODO: Optimize the extend function by assuming the value is MSB-aligned.
+
+	// control, bit 1: diffbit
+	// NOTE: If using punchthrough alpha, this is repurposed as the opaque bit.
+	// Hence, individual mode is unavailable.
+	if (!(mode & ETC2_DM_A1) && !(etc1_src->control & 0x02)) {
+		// Individual mode.
+		block_mode = etc2_block_mode::ETC1;
+		base_color[0].R = extend_4to8bits(etc1_src->id.R >> 4);
+		base_color[0].G = extend_4to8bits(etc1_src->id.G >> 4);
+		base_color[0].B = extend_4to8bits(etc1_src->id.B >> 4);
+		base_color[1].R = extend_4to8bits(etc1_src->id.R & 0x0F);
+		base_color[1].G = extend_4to8bits(etc1_src->id.G & 0x0F);
+		base_color[1].B = extend_4to8bits(etc1_src->id.B & 0x0F);
+	} else {
+		// Other mode.
+
+		// Differential colors are 3-bit two's complement.
+		const int8_t dR2 = etc1_3bit_diff_tbl[etc1_src->id.R & 0x07];
+		const int8_t dG2 = etc1_3bit_diff_tbl[etc1_src->id.G & 0x07];
+		const int8_t dB2 = etc1_3bit_diff_tbl[etc1_src->id.B & 0x07];
+
+		// Sums of R+dR2, G+dG2, and B+dB2 are used to determine the mode.
+		// If all of the sums are within [0,31], ETC1 differential mode is used.
+		// Otherwise, a new ETC2 mode is used, which may discard some of the above values.
+		const int sR = (etc1_src->id.R >> 3) + dR2;
+		const int sG = (etc1_src->id.G >> 3) + dG2;
+		const int sB = (etc1_src->id.B >> 3) + dB2;
+
+		if ((mode & ETC_DM_MASK12) == ETC_DM_ETC2) {
+			// ETC2 block modes are available.
+			if ((sR & ~0x1F) != 0) {
+				// 'T' mode.
+				// Base colors are arranged differently compared to ETC1,
+				// and R1 is calculated differently.
+				// Note that G and B are arranged slightly differently.
+				block_mode = etc2_block_mode::TH;
+				base_color[0].R = extend_4to8bits(((etc1_src->t.R1 & 0x18) >> 1) |
+								   (etc1_src->t.R1 & 0x03));
+				base_color[0].G = extend_4to8bits(etc1_src->t.G1B1 >> 4);
+				base_color[0].B = extend_4to8bits(etc1_src->t.G1B1 & 0x0F);
+				base_color[1].R = extend_4to8bits(etc1_src->t.R2G2 >> 4);
+				base_color[1].G = extend_4to8bits(etc1_src->t.R2G2 & 0x0F);
+				base_color[1].B = extend_4to8bits(etc1_src->control >> 4);
+
+				// Determine the paint colors.
+				paint_color[0] = clamp_ColorRGB(base_color[0]);
+				paint_color[2] = clamp_ColorRGB(base_color[1]);
+
+				// Paint colors 1 and 3 are adjusted using the distance table.
+				const uint8_t d = etc2_dist_tbl[((etc1_src->control & 0x0C) >> 1) |
+								 (etc1_src->control & 0x01)];
+				ColorRGB tmp;
+				tmp.R = base_color[1].R + d;
+				tmp.G = base_color[1].G + d;
+				tmp.B = base_color[1].B + d;
+				paint_color[1] = clamp_ColorRGB(tmp);
+				tmp.R = base_color[1].R - d;
+				tmp.G = base_color[1].G - d;
+				tmp.B = base_color[1].B - d;
+				paint_color[3] = clamp_ColorRGB(tmp);
+			} else if ((sG & ~0x1F) != 0) {
+				// 'H' mode.
+				// Base colors are arranged differently compared to ETC1,
+				// and G1 and B1 are calculated differently.
+				block_mode = etc2_block_mode::TH;
+				base_color[0].R = extend_4to8bits(etc1_src->h.R1G1a >> 3);
+				base_color[0].G = extend_4to8bits(((etc1_src->h.R1G1a & 0x07) << 1) |
+								  ((etc1_src->h.G1bB1aB1b >> 4) & 0x01));
+				base_color[0].B = extend_4to8bits( (etc1_src->h.G1bB1aB1b & 0x08) |
+								  ((etc1_src->h.G1bB1aB1b & 0x03) << 1) |
+								   (etc1_src->h.B1bR2G2 >> 7));
+				base_color[1].R = extend_4to8bits(etc1_src->h.B1bR2G2 >> 3);
+				base_color[1].G = extend_4to8bits(((etc1_src->h.B1bR2G2 & 0x07) << 1) |
+								  (etc1_src->control >> 7));
+				base_color[1].B = extend_4to8bits((etc1_src->control >> 3) & 0x0F);
+
+				// Determine the paint colors.
+				// All paint colors in 'H' mode are adjusted using the distance table.
+				uint8_t d_idx = (etc1_src->control & 0x04) | ((etc1_src->control & 0x01) << 1);
+				// d_idx LSB is determined by comparing the base colors in xRGB32 format.
+				d_idx |= (clamp_ColorRGB(base_color[0]) >= clamp_ColorRGB(base_color[1]));
+
+				const uint8_t d = etc2_dist_tbl[d_idx];
+				ColorRGB tmp;
+				tmp.R = base_color[0].R + d;
+				tmp.G = base_color[0].G + d;
+				tmp.B = base_color[0].B + d;
+				paint_color[0] = clamp_ColorRGB(tmp);
+				tmp.R = base_color[0].R - d;
+				tmp.G = base_color[0].G - d;
+				tmp.B = base_color[0].B - d;
+				paint_color[1] = clamp_ColorRGB(tmp);
+				tmp.R = base_color[1].R + d;
+				tmp.G = base_color[1].G + d;
+				tmp.B = base_color[1].B + d;
+				paint_color[2] = clamp_ColorRGB(tmp);
+				tmp.R = base_color[1].R - d;
+				tmp.G = base_color[1].G - d;
+				tmp.B = base_color[1].B - d;
+				paint_color[3] = clamp_ColorRGB(tmp);
+			} else if ((sB & ~0x1F) != 0) {
+				// 'Planar' mode.
+				// TODO: Needs testing - I don't have a sample file with 'Planar' encoding.
+				block_mode = etc2_block_mode::Planar;
+
+				// 'O' color.
+				base_color[0].R = extend_6to8bits((etc1_src->planar.RO_GO1 >> 1) & 0x3F);
+				base_color[0].G = extend_7to8bits(((etc1_src->planar.RO_GO1 << 6) & 0x40) |
+								  ((etc1_src->planar.GO2_BO1 >> 1) & 0x3F));
+				base_color[0].B = extend_6to8bits(((etc1_src->planar.GO2_BO1 << 5) & 0x20) |
+								   (etc1_src->planar.BO2_BO3 & 0x18) |
+								  ((etc1_src->planar.BO2_BO3 << 1) & 0x06) |
+								   (etc1_src->planar.BO3_RH >> 7));
+
+				// 'H' color.
+				base_color[1].R = extend_6to8bits(((etc1_src->planar.BO3_RH >> 1) & 0x3C) |
+								   (etc1_src->planar.BO3_RH & 0x01));
+				base_color[1].G = extend_7to8bits(etc1_src->planar.GH_BH >> 1);
+				base_color[1].B = extend_6to8bits(((etc1_src->planar.GH_BH << 5) & 0x20) |
+								   (etc1_src->planar.BH_RV >> 3));
+
+				// 'V' color.
+				base_color[2].R = extend_6to8bits(((etc1_src->planar.BH_RV << 3) & 0x38) |
+								   (etc1_src->planar.RV_GV >> 5));
+				base_color[2].G = extend_7to8bits(((etc1_src->planar.RV_GV << 2) & 0x7C) |
+								   (etc1_src->planar.GV_BV >> 6));
+				base_color[2].B = extend_6to8bits(etc1_src->planar.GV_BV & 0x3F);
+			}
+		}
+
+		if ((mode & ETC_DM_MASK12) == ETC_DM_ETC1 ||
+		    block_mode == etc2_block_mode::Unknown)
+		{
+			// ETC1 differential mode.
+			block_mode = etc2_block_mode::ETC1;
+			base_color[0].R = extend_5to8bits(etc1_src->id.R >> 3);
+			base_color[0].G = extend_5to8bits(etc1_src->id.G >> 3);
+			base_color[0].B = extend_5to8bits(etc1_src->id.B >> 3);
+			base_color[1].R = extend_5to8bits(sR);
+			base_color[1].G = extend_5to8bits(sG);
+			base_color[1].B = extend_5to8bits(sB);
+		}
+	}
+
+	ub.block_mode = block_mode;
+	ub.punchthrough = ((mode & ETC2_DM_A1) && !(etc1_src->control & 0x02));
+
+	if (block_mode == etc2_block_mode::ETC1) {
+		// Intensities for the table codewords.
+		if (ub.punchthrough) {
+			// ETC2, punchthrough alpha: Opaque bit is unset.
+			ub.tbl[0] = etc2_intensity_a1[ etc1_src->control >> 5];
+			ub.tbl[1] = etc2_intensity_a1[(etc1_src->control >> 2) & 0x07];
+		} else {
+			// All other versions.
+			ub.tbl[0] = etc1_intensity[ etc1_src->control >> 5];
+			ub.tbl[1] = etc1_intensity[(etc1_src->control >> 2) & 0x07];
+		}
+
+		// control, bit 0: flip
+		ub.subblock = etc1_subblock_mapping[etc1_src->control & 0x01];
+	}
+
+	ub.px_msb = be16_to_cpu(etc1_src->msb);
+	ub.px_lsb = be16_to_cpu(etc1_src->lsb);
+}
+
+namespace {
+
+/**
+ * Convert an ETC/EAC image to rp_image.
+ * Shared image loop for the SIMD-optimized decoders.
+ * @tparam block_t Block type
+ * @tparam DecodeFn Block decoding function: void(uint32_t *dest, unsigned int stride_px, const block_t *src)
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf Image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)*sizeof(block_t)/16]
+ * @param sBIT sBIT metadata.
+ * @param decodeBlock Block decoding function.
+ * @return rp_image, or nullptr on error.
+ */
+template<typename block_t, typename DecodeFn>
+static FORCEINLINE rp_image *fromETC_tmpl(int width, int height,
+	const uint8_t *RESTRICT img_buf, int img_siz,
+	const rp_image::sBIT_t *sBIT, DecodeFn decodeBlock)
+{
+	// Verify parameters.
+	assert(img_buf != nullptr);
+	assert(width > 0);
+	assert(height > 0);
+	assert(img_siz >= ((width * height) * static_cast<int>(sizeof(block_t)) / 16));
+
+	// ETC uses 4x4 tiles, but some container formats allow
+	// the last tile to be cut off, so round up for the
+	// physical tile size.
+	const int physWidth = ALIGN_BYTES(4, width);
+	const int physHeight = ALIGN_BYTES(4, height);
+
+	if (!img_buf || width <= 0 || height <= 0 ||
+	    img_siz < ((physWidth * physHeight) * static_cast<int>(sizeof(block_t)) / 16))
+	{
+		return nullptr;
+	}
+
+	// Create an rp_image.
+	rp_image *const img = new rp_image(physWidth, physHeight, rp_image::Format::ARGB32);
+	if (!img->isValid()) {
+		// Could not allocate the image.
+		img->unref();
+		return nullptr;
+	}
+	const unsigned int stride_px = img->stride() / sizeof(uint32_t);
+	uint32_t *const bits = static_cast<uint32_t*>(img->bits());
+
+	// Calculate the total number of tiles.
+	const unsigned int tilesX = static_cast<unsigned int>(physWidth / 4);
+	const unsigned int tilesY = static_cast<unsigned int>(physHeight / 4);
+
+	// Decode the image in bands of block rows.
+	ImageDecoderPrivate::decodeBlockRows(img, tilesY, [=](unsigned int rowBegin, unsigned int rowEnd) {
+		const block_t *src = reinterpret_cast<const block_t*>(img_buf) + (rowBegin * tilesX);
+		for (unsigned int y = rowBegin; y < rowEnd; y++) {
+			uint32_t *dest = &bits[(y * 4) * stride_px];
+			for (unsigned int x = 0; x < tilesX; x++, src++, dest += 4) {
+				decodeBlock(dest, stride_px, src);
+			}
+		}
+		return true;
+	});
+
+	if (width < physWidth || height < physHeight) {
+		// Shrink the image.
+		img->shrink(width, height);
+	}
+
+	// Set the sBIT metadata.
+	img->set_sBIT(sBIT);
+
+	// Image has been converted.
+	return img;
+}
+
+/**
+ * Convert an ETC1 image to rp_image.
+ * @tparam Kernel Block decoding kernel class
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf ETC1 image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)/2]
+ * @return rp_image, or nullptr on error.
+ */
+template<class Kernel>
+static rp_image *fromETC1_tmpl(int width, int height,
+	const uint8_t *RESTRICT img_buf, int img_siz)
+{
+	static const rp_image::sBIT_t sBIT = {8,8,8,0,0};
+	return fromETC_tmpl<etc1_block>(width, height, img_buf, img_siz, &sBIT,
+		[](uint32_t *dest, unsigned int stride_px, const etc1_block *src) {
+			// NOTE: Fields that aren't used by the block mode are left unset by
+			// unpackBlock_ETC_RGB(), so zero-initialize to keep gcc quiet.
+			etc_rgb_unpacked ub = {};
+			unpackBlock_ETC_RGB<ETC_DM_ETC1>(ub, src);
+			Kernel::decodeBlock_RGB(dest, stride_px, ub);
+		});
+}
+
+/**
+ * Convert an ETC2 RGB image to rp_image.
+ * @tparam Kernel Block decoding kernel class
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf ETC2 RGB image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)/2]
+ * @return rp_image, or nullptr on error.
+ */
+template<class Kernel>
+static rp_image *fromETC2_RGB_tmpl(int width, int height,
+	const uint8_t *RESTRICT img_buf, int img_siz)
+{
+	static const rp_image::sBIT_t sBIT = {8,8,8,0,0};
+	return fromETC_tmpl<etc1_block>(width, height, img_buf, img_siz, &sBIT,
+		[](uint32_t *dest, unsigned int stride_px, const etc1_block *src) {
+			// NOTE: Fields that aren't used by the block mode are left unset by
+			// unpackBlock_ETC_RGB(), so zero-initialize to keep gcc quiet.
+			etc_rgb_unpacked ub = {};
+			unpackBlock_ETC_RGB<ETC_DM_ETC2>(ub, src);
+			Kernel::decodeBlock_RGB(dest, stride_px, ub);
+		});
+}
+
+/**
+ * Convert an ETC2 RGBA image to rp_image.
+ * @tparam Kernel Block decoding kernel class
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf ETC2 RGBA image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)]
+ * @return rp_image, or nullptr on error.
+ */
+template<class Kernel>
+static rp_image *fromETC2_RGBA_tmpl(int width, int height,
+	const uint8_t *RESTRICT img_buf, int img_siz)
+{
+	static const rp_image::sBIT_t sBIT = {8,8,8,0,8};
+	return fromETC_tmpl<etc2_rgba_block>(width, height, img_buf, img_siz, &sBIT,
+		[](uint32_t *dest, unsigned int stride_px, const etc2_rgba_block *src) {
+			// NOTE: Fields that aren't used by the block mode are left unset by
+			// unpackBlock_ETC_RGB(), so zero-initialize to keep gcc quiet.
+			etc_rgb_unpacked ub = {};
+			unpackBlock_ETC_RGB<ETC_DM_ETC2>(ub, &src->etc1);
+			Kernel::decodeBlock_RGBA(dest, stride_px, ub, &src->alpha);
+		});
+}
+
+/**
+ * Convert an ETC2 RGB+A1 (punchthrough alpha) image to rp_image.
+ * @tparam Kernel Block decoding kernel class
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf ETC2 RGB+A1 image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)/2]
+ * @return rp_image, or nullptr on error.
+ */
+template<class Kernel>
+static rp_image *fromETC2_RGB_A1_tmpl(int width, int height,
+	const uint8_t *RESTRICT img_buf, int img_siz)
+{
+	static const rp_image::sBIT_t sBIT = {8,8,8,0,1};
+	return fromETC_tmpl<etc1_block>(width, height, img_buf, img_siz, &sBIT,
+		[](uint32_t *dest, unsigned int stride_px, const etc1_block *src) {
+			// NOTE: Fields that aren't used by the block mode are left unset by
+			// unpackBlock_ETC_RGB(), so zero-initialize to keep gcc quiet.
+			etc_rgb_unpacked ub = {};
+			unpackBlock_ETC_RGB<ETC_DM_ETC2 | ETC2_DM_A1>(ub, src);
+			Kernel::decodeBlock_RGB(dest, stride_px, ub);
+		});
+}
+
+/**
+ * Convert an EAC R11 image to rp_image.
+ * @tparam Kernel Block decoding kernel class
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf EAC R11 image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)/2]
+ * @return rp_image, or nullptr on error.
+ */
+template<class Kernel>
+static rp_image *fromEAC_R11_tmpl(int width, int height,
+	const uint8_t *RESTRICT img_buf, int img_siz)
+{
+	// NOTE: Cannot set the G and B channels to 0, so setting them to 1.
+	static const rp_image::sBIT_t sBIT = {8,1,1,0,0};
+	return fromETC_tmpl<etc2_alpha>(width, height, img_buf, img_siz, &sBIT,
+		[](uint32_t *dest, unsigned int stride_px, const etc2_alpha *src) {
+			Kernel::decodeBlock_R11(dest, stride_px, src);
+		});
+}
+
+/**
+ * Convert an EAC RG11 image to rp_image.
+ * @tparam Kernel Block decoding kernel class
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf EAC RG11 image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)]
+ * @return rp_image, or nullptr on error.
+ */
+template<class Kernel>
+static rp_image *fromEAC_RG11_tmpl(int width, int height,
+	const uint8_t *RESTRICT img_buf, int img_siz)
+{
+	// EAC RG11 blocks consist of two EAC blocks: R11, then G11.
+	struct eac_rg11_block {
+		etc2_alpha r;
+		etc2_alpha g;
+	};
+
+	// NOTE: Cannot set the B channel to 0, so setting it to 1 instead.
+	static const rp_image::sBIT_t sBIT = {8,8,1,0,0};
+	return fromETC_tmpl<eac_rg11_block>(width, height, img_buf, img_siz, &sBIT,
+		[](uint32_t *dest, unsigned int stride_px, const eac_rg11_block *src) {
+			Kernel::decodeBlock_RG11(dest, stride_px, &src->r, &src->g);
+		});
+}
+
+}
+
+} } }
+
+#endif /* __ROMPROPERTIES_LIBRPTEXTURE_DECODER_IMAGEDECODER_ETC1_P_HPP__ */
@@ -0,0 +1,390 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (librptexture)                     *
+ * ImageDecoder_ETC1_sse41.cpp: Image decoding functions. (ETC1)           *
+ * SSE4.1-optimized version.                                               *
+ *                                                                         *
+ * Copyright (c) 2016-2022 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "stdafx.h"
+
+#include "ImageDecoder.hpp"
+#include "ImageDecoder_ETC1_p.hpp"
+
+// SSE4.1 intrinsics
+#include <emmintrin.h>
+#include <tmmintrin.h>
+#include <smmintrin.h>
+
+namespace LibRpTexture { namespace ImageDecoder {
+
+using namespace ETC;
+
+namespace {
+
+/**
+ * SSE4.1 block decoding kernel.
+ *
+ * All 16 pixels of a block are processed at once as 16-bit lanes,
+ * in linear order. (lanes 0-7: rows 0-1; lanes 8-15: rows 2-3)
+ * Results are saturated to 8-bit, which handles clamping.
+ */
+class KernelSSE41
+{
+	private:
+		/**
+		 * Test a 16-bit ETC1-arranged bitfield for each pixel.
+		 * @param lo	[out] Pixels 0-7: 0xFFFF if set; 0 if not.
+		 * @param hi	[out] Pixels 8-15: 0xFFFF if set; 0 if not.
+		 * @param bits	[in] ETC1-arranged bitfield
+		 */
+		static FORCEINLINE void testBits(__m128i &lo, __m128i &hi, uint16_t bits)
+		{
+			// ETC1 arranges pixels by column, then by row.
+			const __m128i mask_lo = _mm_setr_epi16(
+				1U<<0, 1U<<4, 1U<<8, 1U<<12, 1U<<1, 1U<<5, 1U<<9, 1U<<13);
+			const __m128i mask_hi = _mm_setr_epi16(
+				1U<<2, 1U<<6, 1U<<10, 1U<<14, 1U<<3, 1U<<7, 1U<<11, (short)(1U<<15));
+
+			const __m128i v = _mm_set1_epi16(bits);
+			lo = _mm_cmpeq_epi16(_mm_and_si128(v, mask_lo), mask_lo);
+			hi = _mm_cmpeq_epi16(_mm_and_si128(v, mask_hi), mask_hi);
+		}
+
+		/**
+		 * Interleave BGRA planes and store a 4x4 tile.
+		 * @param dest		[out] Destination pixel (top-left of the tile)
+		 * @param stride_px	[in] Destination stride, in pixels
+		 * @param b8		[in] B plane (16 bytes, linear order)
+		 * @param g8		[in] G plane
+		 * @param r8		[in] R plane
+		 * @param a8		[in] A plane
+		 */
+		static FORCEINLINE void storeTile(uint32_t *RESTRICT dest, unsigned int stride_px,
+			__m128i b8, __m128i g8, __m128i r8, __m128i a8)
+		{
+			const __m128i bg_lo = _mm_unpacklo_epi8(b8, g8);
+			const __m128i bg_hi = _mm_unpackhi_epi8(b8, g8);
+			const __m128i ra_lo = _mm_unpacklo_epi8(r8, a8);
+			const __m128i ra_hi = _mm_unpackhi_epi8(r8, a8);
+
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dest), _mm_unpacklo_epi16(bg_lo, ra_lo));
+			dest += stride_px;
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dest), _mm_unpackhi_epi16(bg_lo, ra_lo));
+			dest += stride_px;
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dest), _mm_unpacklo_epi16(bg_hi, ra_hi));
+			dest += stride_px;
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dest), _mm_unpackhi_epi16(bg_hi, ra_hi));
+		}
+
+		/**
+		 * Decode an unpacked ETC1/ETC2 RGB block to BGR planes.
+		 * @param b8	[out] B plane (16 bytes, linear order)
+		 * @param g8	[out] G plane
+		 * @param r8	[out] R plane
+		 * @param t8	[out] Transparency mask (0xFF if transparent)
+		 * @param ub	[in] Unpacked block
+		 */
+		static FORCEINLINE void decodeRGB(__m128i &b8, __m128i &g8, __m128i &r8, __m128i &t8,
+			const etc_rgb_unpacked &ub)
+		{
+			__m128i msb_lo, msb_hi, lsb_lo, lsb_hi;
+			testBits(msb_lo, msb_hi, ub.px_msb);
+			testBits(lsb_lo, lsb_hi, ub.px_lsb);
+
+			// ETC2 punchthrough alpha: px_idx == 2 is transparent.
+			if (ub.punchthrough) {
+				t8 = _mm_packs_epi16(_mm_andnot_si128(lsb_lo, msb_lo), _mm_andnot_si128(lsb_hi, msb_hi));
+			} else {
+				t8 = _mm_setzero_si128();
+			}
+
+			switch (ub.block_mode) {
+				default:
+					assert(!"Invalid ETC2 block mode.");
+					b8 = _mm_setzero_si128();
+					g8 = b8;
+					r8 = b8;
+					t8 = _mm_cmpeq_epi8(b8, b8);
+					break;
+
+				case etc2_block_mode::ETC1: {
+					// ETC1 block mode.
+					__m128i sub_lo, sub_hi;
+					testBits(sub_lo, sub_hi, ub.subblock);
+
+					// Table index: subblock (bit 2), msb (bit 1), lsb (bit 0)
+					const __m128i one = _mm_set1_epi16(1);
+					const __m128i two = _mm_set1_epi16(2);
+					const __m128i four = _mm_set1_epi16(4);
+					const __m128i j_lo = _mm_or_si128(_mm_and_si128(sub_lo, four),
+						_mm_or_si128(_mm_and_si128(msb_lo, two), _mm_and_si128(lsb_lo, one)));
+					const __m128i j_hi = _mm_or_si128(_mm_and_si128(sub_hi, four),
+						_mm_or_si128(_mm_and_si128(msb_hi, two), _mm_and_si128(lsb_hi, one)));
+
+					// Look up the intensity modifiers.
+					// Both tables are combined into a single register as int16_t[8],
+					// so the shuffle control is (j*2) | ((j*2+1) << 8).
+					const __m128i tbl = _mm_unpacklo_epi64(
+						_mm_loadl_epi64(reinterpret_cast<const __m128i*>(ub.tbl[0])),
+						_mm_loadl_epi64(reinterpret_cast<const __m128i*>(ub.tbl[1])));
+					const __m128i shuf_mul = _mm_set1_epi16(0x0202);
+					const __m128i shuf_add = _mm_set1_epi16(0x0100);
+					const __m128i adj_lo = _mm_shuffle_epi8(tbl, _mm_add_epi16(_mm_mullo_epi16(j_lo, shuf_mul), shuf_add));
+					const __m128i adj_hi = _mm_shuffle_epi8(tbl, _mm_add_epi16(_mm_mullo_epi16(j_hi, shuf_mul), shuf_add));
+
+#define ETC1_CHANNEL(c, dst) do { \
+	const __m128i base0 = _mm_set1_epi16(ub.base_color[0].c); \
+	const __m128i base1 = _mm_set1_epi16(ub.base_color[1].c); \
+	const __m128i c_lo = _mm_add_epi16(_mm_blendv_epi8(base0, base1, sub_lo), adj_lo); \
+	const __m128i c_hi = _mm_add_epi16(_mm_blendv_epi8(base0, base1, sub_hi), adj_hi); \
+	dst = _mm_packus_epi16(c_lo, c_hi); \
+} while (0)
+					ETC1_CHANNEL(B, b8);
+					ETC1_CHANNEL(G, g8);
+					ETC1_CHANNEL(R, r8);
+#undef ETC1_CHANNEL
+					break;
+				}
+
+				case etc2_block_mode::TH: {
+					// ETC2 'T' or 'H' mode.
+					// Pixel index indicates the paint color to use.
+					const __m128i one = _mm_set1_epi16(1);
+					const __m128i two = _mm_set1_epi16(2);
+					const __m128i idx_lo = _mm_or_si128(_mm_and_si128(msb_lo, two), _mm_and_si128(lsb_lo, one));
+					const __m128i idx_hi = _mm_or_si128(_mm_and_si128(msb_hi, two), _mm_and_si128(lsb_hi, one));
+					// Convert to byte offsets within paint_color[].
+					const __m128i idx4 = _mm_slli_epi16(_mm_packus_epi16(idx_lo, idx_hi), 2);
+
+					const __m128i paint = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ub.paint_color));
+					b8 = _mm_shuffle_epi8(paint, idx4);
+					g8 = _mm_shuffle_epi8(paint, _mm_add_epi8(idx4, _mm_set1_epi8(1)));
+					r8 = _mm_shuffle_epi8(paint, _mm_add_epi8(idx4, _mm_set1_epi8(2)));
+					break;
+				}
+
+				case etc2_block_mode::Planar: {
+					// ETC2 'Planar' mode.
+					// Each pixel is interpolated using the three RGB676 colors.
+					// NOTE: Punchthrough alpha is not used in 'Planar' mode.
+					t8 = _mm_setzero_si128();
+					// Color order: 0, 1, 2 => 'O', 'H', 'V'
+					const __m128i pX = _mm_setr_epi16(0, 1, 2, 3, 0, 1, 2, 3);
+					const __m128i pY_lo = _mm_setr_epi16(0, 0, 0, 0, 1, 1, 1, 1);
+					const __m128i pY_hi = _mm_setr_epi16(2, 2, 2, 2, 3, 3, 3, 3);
+
+#define PLANAR_CHANNEL(c, dst) do { \
+	const __m128i dH = _mm_set1_epi16(ub.base_color[1].c - ub.base_color[0].c); \
+	const __m128i dV = _mm_set1_epi16(ub.base_color[2].c - ub.base_color[0].c); \
+	const __m128i o = _mm_set1_epi16((4 * ub.base_color[0].c) + 2); \
+	const __m128i xh = _mm_add_epi16(_mm_mullo_epi16(pX, dH), o); \
+	const __m128i c_lo = _mm_srai_epi16(_mm_add_epi16(xh, _mm_mullo_epi16(pY_lo, dV)), 2); \
+	const __m128i c_hi = _mm_srai_epi16(_mm_add_epi16(xh, _mm_mullo_epi16(pY_hi, dV)), 2); \
+	dst = _mm_packus_epi16(c_lo, c_hi); \
+} while (0)
+					PLANAR_CHANNEL(B, b8);
+					PLANAR_CHANNEL(G, g8);
+					PLANAR_CHANNEL(R, r8);
+#undef PLANAR_CHANNEL
+					break;
+				}
+			}
+		}
+
+		/**
+		 * Decode an EAC (ETC2) alpha block.
+		 * NOTE: For R11/RG11 EAC, this results in an 8-bit value, not 11-bit.
+		 * @param alpha	[in] Source alpha block
+		 * @return Decoded values (16 bytes, linear order)
+		 */
+		static FORCEINLINE __m128i decodeEAC(const etc2_alpha *alpha)
+		{
+			// Load the entire block: base, mult/table, values[6]
+			const __m128i blk = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(alpha));
+
+			// Extract the 3-bit pixel indexes.
+			// NOTE: EAC codeword bits are stored *backwards*, and the
+			// pixels are arranged by column, then by row.
+			// Each lane gets the big-endian 16-bit window containing the
+			// pixel's index bits, then shifts them into bits 15-13.
+			const __m128i win_lo = _mm_setr_epi8(
+				3, 2, 4, 3, 6, 5, 7, 6, 3, 2, 4, 3, 6, 5, 7, 6);
+			const __m128i win_hi = _mm_setr_epi8(
+				3, 2, 5, 4, 6, 5, (char)0x80, 7, 4, 3, 5, 4, 7, 6, (char)0x80, 7);
+			const __m128i shl_lo = _mm_setr_epi16(1, 16, 1, 16, 8, 128, 8, 128);
+			const __m128i shl_hi = _mm_setr_epi16(64, 4, 64, 4, 2, 32, 2, 32);
+			const __m128i idx_lo = _mm_srli_epi16(_mm_mullo_epi16(_mm_shuffle_epi8(blk, win_lo), shl_lo), 13);
+			const __m128i idx_hi = _mm_srli_epi16(_mm_mullo_epi16(_mm_shuffle_epi8(blk, win_hi), shl_hi), 13);
+
+			// Look up the modifiers and sign-extend them to 16-bit.
+			const __m128i tbl = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(
+				etc2_alpha_tbl[alpha->mult_tbl_idx & 0x0F]));
+			const __m128i mod_lo = _mm_srai_epi16(_mm_slli_epi16(_mm_shuffle_epi8(tbl, idx_lo), 8), 8);
+			const __m128i mod_hi = _mm_srai_epi16(_mm_slli_epi16(_mm_shuffle_epi8(tbl, idx_hi), 8), 8);
+
+			// A = base + (modifier * mult), clamped to [0,255].
+			// NOTE: mult == 0 is not allowed to be used by the encoder,
+			// but the specification requires decoders to handle it.
+			const __m128i base = _mm_set1_epi16(alpha->base_codeword);
+			const __m128i mult = _mm_set1_epi16(alpha->mult_tbl_idx >> 4);
+			return _mm_packus_epi16(
+				_mm_add_epi16(base, _mm_mullo_epi16(mod_lo, mult)),
+				_mm_add_epi16(base, _mm_mullo_epi16(mod_hi, mult)));
+		}
+
+	public:
+		/**
+		 * Decode an ETC1/ETC2 RGB block and store it in the image.
+		 * @param dest		[out] Destination pixel (top-left of the tile)
+		 * @param stride_px	[in] Destination stride, in pixels
+		 * @param ub		[in] Unpacked block
+		 */
+		static FORCEINLINE void decodeBlock_RGB(uint32_t *RESTRICT dest,
+			unsigned int stride_px, const etc_rgb_unpacked &ub)
+		{
+			__m128i b8, g8, r8, t8;
+			decodeRGB(b8, g8, r8, t8, ub);
+
+			// Transparent pixels are 0.
+			storeTile(dest, stride_px,
+				_mm_andnot_si128(t8, b8), _mm_andnot_si128(t8, g8),
+				_mm_andnot_si128(t8, r8), _mm_andnot_si128(t8, _mm_set1_epi8(-1)));
+		}
+
+		/**
+		 * Decode an ETC2 RGBA block and store it in the image.
+		 * @param dest		[out] Destination pixel (top-left of the tile)
+		 * @param stride_px	[in] Destination stride, in pixels
+		 * @param ub		[in] Unpacked RGB block
+		 * @param alpha		[in] Source alpha block
+		 */
+		static FORCEINLINE void decodeBlock_RGBA(uint32_t *RESTRICT dest,
+			unsigned int stride_px, const etc_rgb_unpacked &ub, const etc2_alpha *alpha)
+		{
+			__m128i b8, g8, r8, t8;
+			decodeRGB(b8, g8, r8, t8, ub);
+			storeTile(dest, stride_px, b8, g8, r8, decodeEAC(alpha));
+		}
+
+		/**
+		 * Decode an EAC R11 block and store it in the image.
+		 * @param dest		[out] Destination pixel (top-left of the tile)
+		 * @param stride_px	[in] Destination stride, in pixels
+		 * @param r		[in] Source R11 block
+		 */
+		static FORCEINLINE void decodeBlock_R11(uint32_t *RESTRICT dest,
+			unsigned int stride_px, const etc2_alpha *r)
+		{
+			const __m128i zero = _mm_setzero_si128();
+			storeTile(dest, stride_px, zero, zero, decodeEAC(r), _mm_set1_epi8(-1));
+		}
+
+		/**
+		 * Decode an EAC RG11 block and store it in the image.
+		 * @param dest		[out] Destination pixel (top-left of the tile)
+		 * @param stride_px	[in] Destination stride, in pixels
+		 * @param r		[in] Source R11 block
+		 * @param g		[in] Source G11 block
+		 */
+		static FORCEINLINE void decodeBlock_RG11(uint32_t *RESTRICT dest,
+			unsigned int stride_px, const etc2_alpha *r, const etc2_alpha *g)
+		{
+			storeTile(dest, stride_px, _mm_setzero_si128(), decodeEAC(g), decodeEAC(r), _mm_set1_epi8(-1));
+		}
+};
+
+}
+
+/**
+ * Convert an ETC1 image to rp_image.
+ * SSE4.1-optimized version.
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf ETC1 image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)/2]
+ * @return rp_image, or nullptr on error.
+ */
+rp_image *fromETC1_sse41(int width, int height,
+	const uint8_t *RESTRICT img_buf, int img_siz)
+{
+	return fromETC1_tmpl<KernelSSE41>(width, height, img_buf, img_siz);
+}
+
+/**
+ * Convert an ETC2 RGB image to rp_image.
+ * SSE4.1-optimized version.
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf ETC2 RGB image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)/2]
+ * @return rp_image, or nullptr on error.
+ */
+rp_image *fromETC2_RGB_sse41(int width, int height,
+	const uint8_t *RESTRICT img_buf, int img_siz)
+{
+	return fromETC2_RGB_tmpl<KernelSSE41>(width, height, img_buf, img_siz);
+}
+
+/**
+ * Convert an ETC2 RGBA image to rp_image.
+ * SSE4.1-optimized version.
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf ETC2 RGBA image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)]
+ * @return rp_image, or nullptr on error.
+ */
+rp_image *fromETC2_RGBA_sse41(int width, int height,
+	const uint8_t *RESTRICT img_buf, int img_siz)
+{
+	return fromETC2_RGBA_tmpl<KernelSSE41>(width, height, img_buf, img_siz);
+}
+
+/**
+ * Convert an ETC2 RGB+A1 (punchthrough alpha) image to rp_image.
+ * SSE4.1-optimized version.
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf ETC2 RGB+A1 image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)/2]
+ * @return rp_image, or nullptr on error.
+ */
+rp_image *fromETC2_RGB_A1_sse41(int width, int height,
+	const uint8_t *RESTRICT img_buf, int img_siz)
+{
+	return fromETC2_RGB_A1_tmpl<KernelSSE41>(width, height, img_buf, img_siz);
+}
+
+/**
+ * Convert an EAC R11 image to rp_image.
+ * SSE4.1-optimized version.
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf EAC R11 image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)/2]
+ * @return rp_image, or nullptr on error.
+ */
+rp_image *fromEAC_R11_sse41(int width, int height,
+	const uint8_t *RESTRICT img_buf, int img_siz)
+{
+	return fromEAC_R11_tmpl<KernelSSE41>(width, height, img_buf, img_siz);
+}
+
+/**
+ * Convert an EAC RG11 image to rp_image.
+ * SSE4.1-optimized version.
+ * @param width Image width.
+ * @param height Image height.
+ * @param img_buf EAC RG11 image buffer.
+ * @param img_siz Size of image data. [must be >= (w*h)]
+ * @return rp_image, or nullptr on error.
+ */
+rp_image *fromEAC_RG11_sse41(int width, int height,
+	const uint8_t *RESTRICT img_buf, int img_siz)
+{
+	return fromEAC_RG11_tmpl<KernelSSE41>(width, height, img_buf, img_siz);
+}
+
+} }
@@ -2,7 +2,7 @@
  * ROM Properties Page shell extension. (librptexture)                     *
  * ImageDecoder_GCN.cpp: Image decoding functions. (GameCube)              *
  *                                                                         *
- * Copyright (c) 2016-2020 by David Korth.                                 *
+ * Copyright (c) 2016-2022 by David Korth.                                 *
  * SPDX-License-Identifier: GPL-2.0-or-later                               *
  ***************************************************************************/
 
@@ -60,24 +60,29 @@ rp_image *fromGcn16(PixelFormat px_format,
 	const unsigned int tilesX = static_cast<unsigned int>(width / 4);
 	const unsigned int tilesY = static_cast<unsigned int>(height / 4);
 
-	// Temporary tile buffer.
-	array<uint32_t, 4*4> tileBuf;
+	// Tiles are converted directly into the destination image,
+	// since each tile row is 4 contiguous pixels.
+	uint32_t *const dest_bits = static_cast<uint32_t*>(img->bits());
+	const int dest_stride_px = img->stride() / sizeof(uint32_t);
+
+#define fromGcn16_convert(fmt) do { \
+		for (unsigned int y = 0; y < tilesY; y++) { \
+			uint32_t *pTileDest = &dest_bits[y * 4 * dest_stride_px]; \
+			for (unsigned int x = 0; x < tilesX; x++, pTileDest += 4) { \
+				uint32_t *pDest = pTileDest; \
+				for (unsigned int ty = 4; ty > 0; ty--, img_buf += 4, pDest += dest_stride_px) { \
+					pDest[0] = fmt##_to_ARGB32(be16_to_cpu(img_buf[0])); \
+					pDest[1] = fmt##_to_ARGB32(be16_to_cpu(img_buf[1])); \
+					pDest[2] = fmt##_to_ARGB32(be16_to_cpu(img_buf[2])); \
+					pDest[3] = fmt##_to_ARGB32(be16_to_cpu(img_buf[3])); \
+				} \
+			} \
+		} \
+	} while (0)
 
 	switch (px_format) {
 		case PixelFormat::RGB5A3: {
-			for (unsigned int y = 0; y < tilesY; y++) {
-				for (unsigned int x = 0; x < tilesX; x++) {
-					// Convert each tile to ARGB32 manually.
-					// TODO: Optimize using pointers instead of indexes?
-					for (unsigned int i = 0; i < 4*4; i += 2, img_buf += 2) {
-						tileBuf[i+0] = RGB5A3_to_ARGB32(be16_to_cpu(img_buf[0]));
-						tileBuf[i+1] = RGB5A3_to_ARGB32(be16_to_cpu(img_buf[1]));
-					}
-
-					// Blit the tile to the main image buffer.
-					ImageDecoderPrivate::BlitTile<uint32_t, 4, 4>(img, tileBuf, x, y);
-				}
-			}
+			fromGcn16_convert(RGB5A3);
 			// Set the sBIT metadata.
 			// NOTE: Pixels may be RGB555 or ARGB4444.
 			// We'll use 555 for RGB, and 4 for alpha.
@@ -88,19 +93,7 @@ rp_image *fromGcn16(PixelFormat px_format,
 		}
 
 		case PixelFormat::RGB565: {
-			for (unsigned int y = 0; y < tilesY; y++) {
-				for (unsigned int x = 0; x < tilesX; x++) {
-					// Convert each tile to ARGB32 manually.
-					// TODO: Optimize using pointers instead of indexes?
-					for (unsigned int i = 0; i < 4*4; i += 2, img_buf += 2) {
-						tileBuf[i+0] = RGB565_to_ARGB32(be16_to_cpu(img_buf[0]));
-						tileBuf[i+1] = RGB565_to_ARGB32(be16_to_cpu(img_buf[1]));
-					}
-
-					// Blit the tile to the main image buffer.
-					ImageDecoderPrivate::BlitTile<uint32_t, 4, 4>(img, tileBuf, x, y);
-				}
-			}
+			fromGcn16_convert(RGB565);
 			// Set the sBIT metadata.
 			static const rp_image::sBIT_t sBIT = {5,6,5,0,0};
 			img->set_sBIT(&sBIT);
@@ -108,19 +101,7 @@ rp_image *fromGcn16(PixelFormat px_format,
 		}
 
 		case PixelFormat::IA8: {
-			for (unsigned int y = 0; y < tilesY; y++) {
-				for (unsigned int x = 0; x < tilesX; x++) {
-					// Convert each tile to ARGB32 manually.
-					// TODO: Optimize using pointers instead of indexes?
-					for (unsigned int i = 0; i < 4*4; i += 2, img_buf += 2) {
-						tileBuf[i+0] = IA8_to_ARGB32(be16_to_cpu(img_buf[0]));
-						tileBuf[i+1] = IA8_to_ARGB32(be16_to_cpu(img_buf[1]));
-					}
-
-					// Blit the tile to the main image buffer.
-					ImageDecoderPrivate::BlitTile<uint32_t, 4, 4>(img, tileBuf, x, y);
-				}
-			}
+			fromGcn16_convert(IA8);
 			// Set the sBIT metadata.
 			// NOTE: Setting the grayscale value, though we're
 			// not saving grayscale PNGs at the moment.
@@ -134,6 +115,7 @@ rp_image *fromGcn16(PixelFormat px_format,
 			img->unref();
 			return nullptr;
 	}
+#undef fromGcn16_convert
 
 	// Image has been converted.
 	return img;
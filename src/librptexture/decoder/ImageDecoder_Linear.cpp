@@ -836,10 +836,10 @@ rp_image *fromLinear16_cpp(PixelFormat px_format,
 		fromLinear16_convert(ABGR4444, 4,4,4,0,4);
 		fromLinear16_convert(RGBA4444, 4,4,4,0,4);
 		fromLinear16_convert(BGRA4444, 4,4,4,0,4);
-		fromLinear16_convert(xRGB4444, 4,4,4,0,4);
-		fromLinear16_convert(xBGR4444, 4,4,4,0,4);
-		fromLinear16_convert(RGBx4444, 4,4,4,0,4);
-		fromLinear16_convert(BGRx4444, 4,4,4,0,4);
+		fromLinear16_convert(xRGB4444, 4,4,4,0,0);
+		fromLinear16_convert(xBGR4444, 4,4,4,0,0);
+		fromLinear16_convert(RGBx4444, 4,4,4,0,0);
+		fromLinear16_convert(BGRx4444, 4,4,4,0,0);
 		fromLinear16_convert(ARGB8332, 3,3,2,0,8);
 
 		// PlayStation 2.
@@ -1275,7 +1275,7 @@ rp_image *fromLinear32_cpp(PixelFormat px_format,
 				px_dest += dest_stride_adj;
 			}
 			// Set the sBIT metadata.
-			img->set_sBIT(&sBIT_x32);
+			img->set_sBIT(&sBIT_A32);
 			break;
 		}
 
@@ -1,8 +1,8 @@
 /***************************************************************************
  * ROM Properties Page shell extension. (librptexture)                     *
- * ImageDecoder_GCN.cpp: Image decoding functions. (Nintendo 3DS)          *
+ * ImageDecoder_N3DS.cpp: Image decoding functions. (Nintendo 3DS)         *
  *                                                                         *
- * Copyright (c) 2016-2020 by David Korth.                                 *
+ * Copyright (c) 2016-2022 by David Korth.                                 *
  * SPDX-License-Identifier: GPL-2.0-or-later                               *
  ***************************************************************************/
 
@@ -13,21 +13,15 @@
 #include "PixelConversion.hpp"
 using namespace LibRpTexture::PixelConversion;
 
-// C++ STL classes.
-using std::array;
-
 namespace LibRpTexture { namespace ImageDecoder {
 
-// N3DS uses 3-level Z-ordered tiling.
+// N3DS uses 3-level Z-ordered tiling: 8x8 tiles in row-major order,
+// with Morton order within each tile, starting with X.
 // References:
 // - https://github.com/devkitPro/3dstools/blob/master/src/smdhtool.cpp
 // - https://en.wikipedia.org/wiki/Z-order_curve
-static const uint8_t N3DS_tile_order[] = {
-	 0,  1,  8,  9,  2,  3, 10, 11, 16, 17, 24, 25, 18, 19, 26, 27,
-	 4,  5, 12, 13,  6,  7, 14, 15, 20, 21, 28, 29, 22, 23, 30, 31,
-	32, 33, 40, 41, 34, 35, 42, 43, 48, 49, 56, 57, 50, 51, 58, 59,
-	36, 37, 44, 45, 38, 39, 46, 47, 52, 53, 60, 61, 54, 55, 62, 63
-};
+static const uint32_t N3DS_TILE_MASK_X = 0x15;
+static const uint32_t N3DS_TILE_MASK_Y = 0x2A;
 
 /**
  * Convert a Nintendo 3DS RGB565 tiled icon to rp_image.
@@ -57,37 +51,16 @@ rp_image *fromN3DSTiledRGB565(int width, int height,
 	if (width % 8 != 0 || height % 8 != 0)
 		return nullptr;
 
-	// Create an rp_image.
-	rp_image *const img = new rp_image(width, height, rp_image::Format::ARGB32);
-	if (!img->isValid()) {
-		// Could not allocate the image.
-		img->unref();
+	// Convert the pixels to ARGB32 in tiled order.
+	// This uses the SIMD-optimized linear decoder.
+	rp_image *const imgtiled = fromLinear16(PixelFormat::RGB565, width, height, img_buf, img_siz);
+	if (!imgtiled) {
 		return nullptr;
 	}
 
-	// Calculate the total number of tiles.
-	const unsigned int tilesX = static_cast<unsigned int>(width / 8);
-	const unsigned int tilesY = static_cast<unsigned int>(height / 8);
-
-	// Temporary tile buffer.
-	array<uint32_t, 8*8> tileBuf;
-
-	for (unsigned int y = 0; y < tilesY; y++) {
-		for (unsigned int x = 0; x < tilesX; x++) {
-			// Convert each tile to ARGB32 manually.
-			for (size_t i = 0; i < tileBuf.size(); i += 2, img_buf += 2) {
-				tileBuf[N3DS_tile_order[i+0]] = RGB565_to_ARGB32(le16_to_cpu(img_buf[0]));
-				tileBuf[N3DS_tile_order[i+1]] = RGB565_to_ARGB32(le16_to_cpu(img_buf[1]));
-			}
-
-			// Blit the tile to the main image buffer.
-			ImageDecoderPrivate::BlitTile<uint32_t, 8, 8>(img, tileBuf, x, y);
-		}
-	}
-
-	// Set the sBIT metadata.
-	static const rp_image::sBIT_t sBIT = {5,6,5,0,0};
-	img->set_sBIT(&sBIT);
+	// Untile the image.
+	rp_image *const img = unswizzleMorton32(imgtiled, N3DS_TILE_MASK_X, N3DS_TILE_MASK_Y);
+	imgtiled->unref();
 
 	// Image has been converted.
 	return img;
@@ -127,41 +100,34 @@ rp_image *fromN3DSTiledRGB565_A4(int width, int height,
 	if (width % 8 != 0 || height % 8 != 0)
 		return nullptr;
 
-	// Calculate the total number of tiles.
-	const unsigned int tilesX = static_cast<unsigned int>(width / 8);
-	const unsigned int tilesY = static_cast<unsigned int>(height / 8);
-
 	// Create an rp_image.
-	rp_image *const img = new rp_image(width, height, rp_image::Format::ARGB32);
-	if (!img->isValid()) {
+	rp_image *const imgtiled = new rp_image(width, height, rp_image::Format::ARGB32);
+	if (!imgtiled->isValid()) {
 		// Could not allocate the image.
-		img->unref();
+		imgtiled->unref();
 		return nullptr;
 	}
 
-	// Temporary tile buffer.
-	array<uint32_t, 8*8> tileBuf;
-
-	for (unsigned int y = 0; y < tilesY; y++) {
-		for (unsigned int x = 0; x < tilesX; x++) {
-			// Convert each tile to ARGB32 manually.
-			// FIXME: Nybble ordering for A4?
-			// Assuming LeftLSN, same as NDS CI4.
-			for (size_t i = 0; i < tileBuf.size(); i += 2, img_buf += 2, alpha_buf++) {
-				tileBuf[N3DS_tile_order[i+0]] = RGB565_A4_to_ARGB32(
-					le16_to_cpu(img_buf[0]), *alpha_buf & 0x0F);
-				tileBuf[N3DS_tile_order[i+1]] = RGB565_A4_to_ARGB32(
-					le16_to_cpu(img_buf[1]), *alpha_buf >> 4);
-			}
-
-			// Blit the tile to the main image buffer.
-			ImageDecoderPrivate::BlitTile<uint32_t, 8, 8>(img, tileBuf, x, y);
-		}
+	// Convert the pixels to ARGB32 in tiled order.
+	// NOTE: Since the width is a multiple of 8,
+	// there aren't any extra bytes of stride.
+	// FIXME: Nybble ordering for A4?
+	// Assuming LeftLSN, same as NDS CI4.
+	uint32_t *px_dest = static_cast<uint32_t*>(imgtiled->bits());
+	for (unsigned int i = static_cast<unsigned int>(width * height); i > 0;
+	     i -= 2, img_buf += 2, alpha_buf++, px_dest += 2)
+	{
+		px_dest[0] = RGB565_A4_to_ARGB32(le16_to_cpu(img_buf[0]), *alpha_buf & 0x0F);
+		px_dest[1] = RGB565_A4_to_ARGB32(le16_to_cpu(img_buf[1]), *alpha_buf >> 4);
 	}
 
 	// Set the sBIT metadata.
 	static const rp_image::sBIT_t sBIT = {5,6,5,0,4};
-	img->set_sBIT(&sBIT);
+	imgtiled->set_sBIT(&sBIT);
+
+	// Untile the image.
+	rp_image *const img = unswizzleMorton32(imgtiled, N3DS_TILE_MASK_X, N3DS_TILE_MASK_Y);
+	imgtiled->unref();
 
 	// Image has been converted.
 	return img;
@@ -9,6 +9,7 @@
 #include "stdafx.h"
 
 #include "ImageDecoder.hpp"
+#include "ImageDecoder_p.hpp"
 #include "PVRTDecompress.h"
 
 // librptexture
@@ -86,12 +87,19 @@ rp_image *fromPVRTC(int width, int height,
 	}
 
 	// Use the PowerVR Native SDK to decompress the texture.
+	// PVRTC words are 4 pixels high, and each band of word rows
+	// can be decompressed independently.
 	// Return value is the size of the *input* data that was decompressed.
 	// TODO: Row padding?
-	uint32_t size = pvr::PVRTDecompressPVRTC(img_buf, ((mode & PVRTC_BPP_MASK) == PVRTC_2BPP),
-		physWidth, physHeight, static_cast<uint8_t*>(img->bits()));
-	assert(size == expected_size_in);
-	if (size != expected_size_in) {
+	const bool is2bpp = ((mode & PVRTC_BPP_MASK) == PVRTC_2BPP);
+	uint8_t *const bits = static_cast<uint8_t*>(img->bits());
+	const bool bOK = ImageDecoderPrivate::decodeBlockRows(img, physHeight / 4, [=](unsigned int rowBegin, unsigned int rowEnd) {
+		const uint32_t size = pvr::PVRTDecompressPVRTC_rows(img_buf, is2bpp,
+			physWidth, physHeight, bits, rowBegin, rowEnd);
+		assert(size == expected_size_in);
+		return (size == expected_size_in);
+	});
+	if (!bOK) {
 		// Read error...
 		img->unref();
 		return nullptr;
@@ -180,12 +188,19 @@ rp_image *fromPVRTCII(int width, int height,
 	}
 
 	// Use the PowerVR Native SDK to decompress the texture.
+	// PVRTC words are 4 pixels high, and each band of word rows
+	// can be decompressed independently.
 	// Return value is the size of the *input* data that was decompressed.
 	// TODO: Row padding?
-	uint32_t size = pvr::PVRTDecompressPVRTCII(img_buf, ((mode & PVRTC_BPP_MASK) == PVRTC_2BPP),
-		physWidth, physHeight, static_cast<uint8_t*>(img->bits()));
-	assert(size == expected_size_in);
-	if (size != expected_size_in) {
+	const bool is2bpp = ((mode & PVRTC_BPP_MASK) == PVRTC_2BPP);
+	uint8_t *const bits = static_cast<uint8_t*>(img->bits());
+	const bool bOK = ImageDecoderPrivate::decodeBlockRows(img, physHeight / 4, [=](unsigned int rowBegin, unsigned int rowEnd) {
+		const uint32_t size = pvr::PVRTDecompressPVRTCII_rows(img_buf, is2bpp,
+			physWidth, physHeight, bits, rowBegin, rowEnd);
+		assert(size == expected_size_in);
+		return (size == expected_size_in);
+	});
+	if (!bOK) {
 		// Read error...
 		img->unref();
 		return nullptr;
@@ -0,0 +1,100 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (librptexture)                     *
+ * ImageDecoder_Swizzle.cpp: Image decoding functions. (Swizzled)          *
+ *                                                                         *
+ * Copyright (c) 2016-2022 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "stdafx.h"
+#include "ImageDecoder.hpp"
+#include "ImageDecoder_p.hpp"
+
+// librptexture
+#include "img/rp_image.hpp"
+
+// C++ STL classes.
+using std::unique_ptr;
+
+namespace LibRpTexture { namespace ImageDecoder {
+
+/**
+ * Unswizzle a Morton-ordered ARGB32 image.
+ *
+ * The source image is divided into tiles of (1 << popcount(mask_x))
+ * by (1 << popcount(mask_y)) pixels, stored in row-major order.
+ * Within each tile, pixel (x,y) is located at pdep(x, mask_x) | pdep(y, mask_y).
+ *
+ * @param img		[in] Swizzled ARGB32 image.
+ * @param mask_x	[in] X coordinate bits within a tile.
+ * @param mask_y	[in] Y coordinate bits within a tile.
+ * @return Unswizzled ARGB32 image, or nullptr on error.
+ */
+rp_image *unswizzleMorton32_cpp(const rp_image *img, uint32_t mask_x, uint32_t mask_y)
+{
+	// Verify parameters.
+	if (!ImageDecoderPrivate::checkMortonParams(img, mask_x, mask_y)) {
+		return nullptr;
+	}
+
+	const unsigned int width = static_cast<unsigned int>(img->width());
+	const unsigned int height = static_cast<unsigned int>(img->height());
+	const unsigned int tileW = 1U << popcount(mask_x);
+	const unsigned int tileH = 1U << popcount(mask_y);
+
+	// Create an rp_image.
+	rp_image *const imgunswz = new rp_image(width, height, rp_image::Format::ARGB32);
+	if (!imgunswz->isValid()) {
+		// Could not allocate the image.
+		imgunswz->unref();
+		return nullptr;
+	}
+
+	const uint32_t *src_tile = static_cast<const uint32_t*>(img->bits());
+	unique_ptr<uint32_t[]> src_contig;
+	if (img->stride() != img->row_bytes()) {
+		// The source image has extra bytes of stride.
+		// This only happens if the width isn't a multiple of 4,
+		// so copy the pixels to a contiguous buffer first.
+		src_contig.reset(new uint32_t[width * height]);
+		const size_t row_bytes = img->row_bytes();
+		for (unsigned int y = 0; y < height; y++) {
+			memcpy(&src_contig[y * width], img->scanLine(y), row_bytes);
+		}
+		src_tile = src_contig.get();
+	}
+
+	uint32_t *const dest_bits = static_cast<uint32_t*>(imgunswz->bits());
+	const int dest_stride_px = imgunswz->stride() / sizeof(uint32_t);
+
+	// Swizzled offsets are advanced using masked increments:
+	// setting the unused bits to 1 lets the carry propagate
+	// to the next bit in the mask.
+	for (unsigned int ty = 0; ty < height; ty += tileH) {
+		for (unsigned int tx = 0; tx < width; tx += tileW) {
+			uint32_t *pDest = &dest_bits[ty * dest_stride_px + tx];
+			uint32_t yoff = 0;
+			for (unsigned int y = tileH; y > 0; y--) {
+				uint32_t xoff = 0;
+				for (unsigned int x = 0; x < tileW; x++) {
+					pDest[x] = src_tile[xoff | yoff];
+					xoff = (xoff - mask_x) & mask_x;
+				}
+				yoff = (yoff - mask_y) & mask_y;
+				pDest += dest_stride_px;
+			}
+			src_tile += tileW * tileH;
+		}
+	}
+
+	// Copy the sBIT metadata.
+	rp_image::sBIT_t sBIT;
+	if (img->get_sBIT(&sBIT) == 0) {
+		imgunswz->set_sBIT(&sBIT);
+	}
+
+	// Image has been unswizzled.
+	return imgunswz;
+}
+
+} }
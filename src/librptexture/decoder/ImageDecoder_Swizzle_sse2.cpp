@@ -0,0 +1,207 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (librptexture)                     *
+ * ImageDecoder_Swizzle_sse2.cpp: Image decoding functions. (Swizzled)     *
+ * SSE2-optimized version.                                                 *
+ *                                                                         *
+ * Copyright (c) 2016-2022 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "stdafx.h"
+#include "ImageDecoder.hpp"
+#include "ImageDecoder_p.hpp"
+
+// librptexture
+#include "img/rp_image.hpp"
+
+// SSE2 intrinsics
+#include <emmintrin.h>
+
+namespace LibRpTexture { namespace ImageDecoder {
+
+/**
+ * Ordering of the 16 pixels in a swizzled 4x4 block.
+ * Determined by the low four bits of mask_x.
+ */
+enum class BlockOrder {
+	XFirst,		// mask_x & 0xF == 0x5 (Xbox, Nintendo 3DS)
+	YFirst,		// mask_x & 0xF == 0xA (Dreamcast)
+	Linear,		// mask_x & 0xF == 0x3 (row-major 4x4 tiles)
+};
+
+/**
+ * Copy a swizzled 4x4 block to the destination image.
+ * @tparam order	[in] Block ordering.
+ * @param pDest		[out] Top-left destination pixel.
+ * @param dest_stride_px [in] Destination stride, in pixels.
+ * @param pSrc		[in] 16 contiguous swizzled pixels.
+ */
+template<BlockOrder order>
+static FORCEINLINE void T_unswizzleBlock4x4(uint32_t *RESTRICT pDest, int dest_stride_px,
+	const uint32_t *RESTRICT pSrc)
+{
+	const __m128i *const xmm_src = reinterpret_cast<const __m128i*>(pSrc);
+	const __m128i v0 = _mm_loadu_si128(&xmm_src[0]);
+	const __m128i v1 = _mm_loadu_si128(&xmm_src[1]);
+	const __m128i v2 = _mm_loadu_si128(&xmm_src[2]);
+	const __m128i v3 = _mm_loadu_si128(&xmm_src[3]);
+
+	__m128i row0, row1, row2, row3;
+	switch (order) {
+		case BlockOrder::XFirst:
+			// Each 2x2 sub-block is 4 contiguous pixels:
+			// v0 = {(0,0),(1,0),(0,1),(1,1)}, v1 = {(2,0),(3,0),(2,1),(3,1)}
+			row0 = _mm_unpacklo_epi64(v0, v1);
+			row1 = _mm_unpackhi_epi64(v0, v1);
+			row2 = _mm_unpacklo_epi64(v2, v3);
+			row3 = _mm_unpackhi_epi64(v2, v3);
+			break;
+
+		case BlockOrder::YFirst: {
+			// Each 2x2 sub-block is 4 contiguous pixels:
+			// v0 = {(0,0),(0,1),(1,0),(1,1)}, v2 = {(2,0),(2,1),(3,0),(3,1)}
+			const __m128 f0 = _mm_castsi128_ps(v0);
+			const __m128 f1 = _mm_castsi128_ps(v1);
+			const __m128 f2 = _mm_castsi128_ps(v2);
+			const __m128 f3 = _mm_castsi128_ps(v3);
+			row0 = _mm_castps_si128(_mm_shuffle_ps(f0, f2, _MM_SHUFFLE(2,0,2,0)));
+			row1 = _mm_castps_si128(_mm_shuffle_ps(f0, f2, _MM_SHUFFLE(3,1,3,1)));
+			row2 = _mm_castps_si128(_mm_shuffle_ps(f1, f3, _MM_SHUFFLE(2,0,2,0)));
+			row3 = _mm_castps_si128(_mm_shuffle_ps(f1, f3, _MM_SHUFFLE(3,1,3,1)));
+			break;
+		}
+
+		case BlockOrder::Linear:
+		default:
+			row0 = v0;
+			row1 = v1;
+			row2 = v2;
+			row3 = v3;
+			break;
+	}
+
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(pDest), row0);
+	pDest += dest_stride_px;
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(pDest), row1);
+	pDest += dest_stride_px;
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(pDest), row2);
+	pDest += dest_stride_px;
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(pDest), row3);
+}
+
+/**
+ * Unswizzle a Morton-ordered ARGB32 image, one 4x4 block at a time.
+ * @tparam order	[in] Block ordering.
+ * @param imgunswz	[out] Destination image.
+ * @param img		[in] Swizzled ARGB32 image.
+ * @param mask_x	[in] X coordinate bits within a tile.
+ * @param mask_y	[in] Y coordinate bits within a tile.
+ */
+template<BlockOrder order>
+static void T_unswizzleMorton32(rp_image *RESTRICT imgunswz, const rp_image *RESTRICT img,
+	uint32_t mask_x, uint32_t mask_y)
+{
+	const unsigned int width = static_cast<unsigned int>(img->width());
+	const unsigned int height = static_cast<unsigned int>(img->height());
+	const unsigned int tileW = 1U << popcount(mask_x);
+	const unsigned int tileH = 1U << popcount(mask_y);
+
+	// Swizzled offset increments for 4 pixels in each direction.
+	// This is the third-lowest bit of each mask.
+	uint32_t step_x = mask_x & (mask_x - 1);
+	step_x &= (step_x - 1);
+	step_x &= ~(step_x - 1);
+	uint32_t step_y = mask_y & (mask_y - 1);
+	step_y &= (step_y - 1);
+	step_y &= ~(step_y - 1);
+
+	const uint32_t *src_tile = static_cast<const uint32_t*>(img->bits());
+	uint32_t *const dest_bits = static_cast<uint32_t*>(imgunswz->bits());
+	const int dest_stride_px = imgunswz->stride() / sizeof(uint32_t);
+
+	for (unsigned int ty = 0; ty < height; ty += tileH) {
+		for (unsigned int tx = 0; tx < width; tx += tileW) {
+			uint32_t *pDest = &dest_bits[ty * dest_stride_px + tx];
+			uint32_t yoff = 0;
+			for (unsigned int y = tileH; y > 0; y -= 4) {
+				uint32_t xoff = 0;
+				for (unsigned int x = 0; x < tileW; x += 4) {
+					T_unswizzleBlock4x4<order>(&pDest[x], dest_stride_px, &src_tile[xoff | yoff]);
+					xoff = ((xoff | ~mask_x) + step_x) & mask_x;
+				}
+				yoff = ((yoff | ~mask_y) + step_y) & mask_y;
+				pDest += dest_stride_px * 4;
+			}
+			src_tile += tileW * tileH;
+		}
+	}
+}
+
+/**
+ * Unswizzle a Morton-ordered ARGB32 image.
+ * SSE2-optimized version.
+ *
+ * The source image is divided into tiles of (1 << popcount(mask_x))
+ * by (1 << popcount(mask_y)) pixels, stored in row-major order.
+ * Within each tile, pixel (x,y) is located at pdep(x, mask_x) | pdep(y, mask_y).
+ *
+ * @param img		[in] Swizzled ARGB32 image.
+ * @param mask_x	[in] X coordinate bits within a tile.
+ * @param mask_y	[in] Y coordinate bits within a tile.
+ * @return Unswizzled ARGB32 image, or nullptr on error.
+ */
+rp_image *unswizzleMorton32_sse2(const rp_image *img, uint32_t mask_x, uint32_t mask_y)
+{
+	// Verify parameters.
+	if (!ImageDecoderPrivate::checkMortonParams(img, mask_x, mask_y)) {
+		return nullptr;
+	}
+
+	// Tiles must be at least 4x4, and the low four bits
+	// must form a 4x4 block in one of the known orders.
+	BlockOrder order;
+	if (popcount(mask_x) < 2 || popcount(mask_y) < 2) {
+		// Tiles are too small.
+		return unswizzleMorton32_cpp(img, mask_x, mask_y);
+	}
+	switch (mask_x & 0xF) {
+		case 0x5:	order = BlockOrder::XFirst;	break;
+		case 0xA:	order = BlockOrder::YFirst;	break;
+		case 0x3:	order = BlockOrder::Linear;	break;
+		default:
+			// Unsupported block order.
+			return unswizzleMorton32_cpp(img, mask_x, mask_y);
+	}
+
+	// Create an rp_image.
+	rp_image *const imgunswz = new rp_image(img->width(), img->height(), rp_image::Format::ARGB32);
+	if (!imgunswz->isValid()) {
+		// Could not allocate the image.
+		imgunswz->unref();
+		return nullptr;
+	}
+
+	switch (order) {
+		case BlockOrder::XFirst:
+			T_unswizzleMorton32<BlockOrder::XFirst>(imgunswz, img, mask_x, mask_y);
+			break;
+		case BlockOrder::YFirst:
+			T_unswizzleMorton32<BlockOrder::YFirst>(imgunswz, img, mask_x, mask_y);
+			break;
+		case BlockOrder::Linear:
+		default:
+			T_unswizzleMorton32<BlockOrder::Linear>(imgunswz, img, mask_x, mask_y);
+			break;
+	}
+
+	// Copy the sBIT metadata.
+	rp_image::sBIT_t sBIT;
+	if (img->get_sBIT(&sBIT) == 0) {
+		imgunswz->set_sBIT(&sBIT);
+	}
+
+	// Image has been unswizzled.
+	return imgunswz;
+}
+
+} }
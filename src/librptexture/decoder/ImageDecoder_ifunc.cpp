@@ -17,23 +17,51 @@ using namespace LibRpTexture;
 // IFUNC attribute doesn't support C++ name mangling.
 extern "C" {
 
-#ifndef IMAGEDECODER_ALWAYS_HAS_SSE2
 /**
  * IFUNC resolver function for fromLinear16().
  * @return Function pointer.
  */
 static __typeof__(&ImageDecoder::fromLinear16_cpp) fromLinear16_resolve(void)
 {
-#ifdef IMAGEDECODER_HAS_SSE2
+#ifdef IMAGEDECODER_HAS_AVX2
+	if (RP_CPU_HasAVX2()) {
+		return &ImageDecoder::fromLinear16_avx2;
+	} else
+#endif /* IMAGEDECODER_HAS_AVX2 */
+#ifdef IMAGEDECODER_ALWAYS_HAS_SSE2
+	{
+		// amd64 always has SSE2.
+		return &ImageDecoder::fromLinear16_sse2;
+	}
+#else /* !IMAGEDECODER_ALWAYS_HAS_SSE2 */
+#  ifdef IMAGEDECODER_HAS_SSE2
 	if (RP_CPU_HasSSE2()) {
 		return &ImageDecoder::fromLinear16_sse2;
 	} else
-#endif /* IMAGEDECODER_HAS_SSE2 */
+#  endif /* IMAGEDECODER_HAS_SSE2 */
 	{
 		return &ImageDecoder::fromLinear16_cpp;
 	}
-}
 #endif /* IMAGEDECODER_ALWAYS_HAS_SSE2 */
+}
+
+#ifndef IMAGEDECODER_ALWAYS_HAS_SSE2
+/**
+ * IFUNC resolver function for unswizzleMorton32().
+ * @return Function pointer.
+ */
+static __typeof__(&ImageDecoder::unswizzleMorton32_cpp) unswizzleMorton32_resolve(void)
+{
+#ifdef IMAGEDECODER_HAS_SSE2
+	if (RP_CPU_HasSSE2()) {
+		return &ImageDecoder::unswizzleMorton32_sse2;
+	} else
+#endif /* IMAGEDECODER_HAS_SSE2 */
+	{
+		return &ImageDecoder::unswizzleMorton32_cpp;
+	}
+}
+#endif /* !IMAGEDECODER_ALWAYS_HAS_SSE2 */
 
 /**
  * IFUNC resolver function for fromLinear24().
@@ -41,6 +69,11 @@ static __typeof__(&ImageDecoder::fromLinear16_cpp) fromLinear16_resolve(void)
  */
 static __typeof__(&ImageDecoder::fromLinear24_cpp) fromLinear24_resolve(void)
 {
+#ifdef IMAGEDECODER_HAS_AVX2
+	if (RP_CPU_HasAVX2()) {
+		return &ImageDecoder::fromLinear24_avx2;
+	} else
+#endif /* IMAGEDECODER_HAS_AVX2 */
 #ifdef IMAGEDECODER_HAS_SSSE3
 	if (RP_CPU_HasSSSE3()) {
 		return &ImageDecoder::fromLinear24_ssse3;
@@ -57,6 +90,11 @@ static __typeof__(&ImageDecoder::fromLinear24_cpp) fromLinear24_resolve(void)
  */
 static __typeof__(&ImageDecoder::fromLinear32_cpp) fromLinear32_resolve(void)
 {
+#ifdef IMAGEDECODER_HAS_AVX2
+	if (RP_CPU_HasAVX2()) {
+		return &ImageDecoder::fromLinear32_avx2;
+	} else
+#endif /* IMAGEDECODER_HAS_AVX2 */
 #ifdef IMAGEDECODER_HAS_SSSE3
 	if (RP_CPU_HasSSSE3()) {
 		return &ImageDecoder::fromLinear32_ssse3;
@@ -67,14 +105,159 @@ static __typeof__(&ImageDecoder::fromLinear32_cpp) fromLinear32_resolve(void)
 	}
 }
 
+/**
+ * IFUNC resolver function for fromBC7().
+ * @return Function pointer.
+ */
+static __typeof__(&ImageDecoder::fromBC7_cpp) fromBC7_resolve(void)
+{
+#ifdef IMAGEDECODER_HAS_AVX2
+	if (RP_CPU_HasAVX2()) {
+		return &ImageDecoder::fromBC7_avx2;
+	} else
+#endif /* IMAGEDECODER_HAS_AVX2 */
+#ifdef IMAGEDECODER_HAS_SSE41
+	if (RP_CPU_HasSSE41()) {
+		return &ImageDecoder::fromBC7_sse41;
+	} else
+#endif /* IMAGEDECODER_HAS_SSE41 */
+	{
+		return &ImageDecoder::fromBC7_cpp;
+	}
+}
+
+/**
+ * IFUNC resolver function for fromETC1().
+ * @return Function pointer.
+ */
+static __typeof__(&ImageDecoder::fromETC1_cpp) fromETC1_resolve(void)
+{
+#ifdef IMAGEDECODER_HAS_AVX2
+	if (RP_CPU_HasAVX2()) {
+		return &ImageDecoder::fromETC1_avx2;
+	} else
+#endif /* IMAGEDECODER_HAS_AVX2 */
+#ifdef IMAGEDECODER_HAS_SSE41
+	if (RP_CPU_HasSSE41()) {
+		return &ImageDecoder::fromETC1_sse41;
+	} else
+#endif /* IMAGEDECODER_HAS_SSE41 */
+	{
+		return &ImageDecoder::fromETC1_cpp;
+	}
+}
+
+/**
+ * IFUNC resolver function for fromETC2_RGB().
+ * @return Function pointer.
+ */
+static __typeof__(&ImageDecoder::fromETC2_RGB_cpp) fromETC2_RGB_resolve(void)
+{
+#ifdef IMAGEDECODER_HAS_AVX2
+	if (RP_CPU_HasAVX2()) {
+		return &ImageDecoder::fromETC2_RGB_avx2;
+	} else
+#endif /* IMAGEDECODER_HAS_AVX2 */
+#ifdef IMAGEDECODER_HAS_SSE41
+	if (RP_CPU_HasSSE41()) {
+		return &ImageDecoder::fromETC2_RGB_sse41;
+	} else
+#endif /* IMAGEDECODER_HAS_SSE41 */
+	{
+		return &ImageDecoder::fromETC2_RGB_cpp;
+	}
+}
+
+/**
+ * IFUNC resolver function for fromETC2_RGBA().
+ * @return Function pointer.
+ */
+static __typeof__(&ImageDecoder::fromETC2_RGBA_cpp) fromETC2_RGBA_resolve(void)
+{
+#ifdef IMAGEDECODER_HAS_AVX2
+	if (RP_CPU_HasAVX2()) {
+		return &ImageDecoder::fromETC2_RGBA_avx2;
+	} else
+#endif /* IMAGEDECODER_HAS_AVX2 */
+#ifdef IMAGEDECODER_HAS_SSE41
+	if (RP_CPU_HasSSE41()) {
+		return &ImageDecoder::fromETC2_RGBA_sse41;
+	} else
+#endif /* IMAGEDECODER_HAS_SSE41 */
+	{
+		return &ImageDecoder::fromETC2_RGBA_cpp;
+	}
+}
+
+/**
+ * IFUNC resolver function for fromETC2_RGB_A1().
+ * @return Function pointer.
+ */
+static __typeof__(&ImageDecoder::fromETC2_RGB_A1_cpp) fromETC2_RGB_A1_resolve(void)
+{
+#ifdef IMAGEDECODER_HAS_AVX2
+	if (RP_CPU_HasAVX2()) {
+		return &ImageDecoder::fromETC2_RGB_A1_avx2;
+	} else
+#endif /* IMAGEDECODER_HAS_AVX2 */
+#ifdef IMAGEDECODER_HAS_SSE41
+	if (RP_CPU_HasSSE41()) {
+		return &ImageDecoder::fromETC2_RGB_A1_sse41;
+	} else
+#endif /* IMAGEDECODER_HAS_SSE41 */
+	{
+		return &ImageDecoder::fromETC2_RGB_A1_cpp;
+	}
+}
+
+/**
+ * IFUNC resolver function for fromEAC_R11().
+ * @return Function pointer.
+ */
+static __typeof__(&ImageDecoder::fromEAC_R11_cpp) fromEAC_R11_resolve(void)
+{
+#ifdef IMAGEDECODER_HAS_AVX2
+	if (RP_CPU_HasAVX2()) {
+		return &ImageDecoder::fromEAC_R11_avx2;
+	} else
+#endif /* IMAGEDECODER_HAS_AVX2 */
+#ifdef IMAGEDECODER_HAS_SSE41
+	if (RP_CPU_HasSSE41()) {
+		return &ImageDecoder::fromEAC_R11_sse41;
+	} else
+#endif /* IMAGEDECODER_HAS_SSE41 */
+	{
+		return &ImageDecoder::fromEAC_R11_cpp;
+	}
+}
+
+/**
+ * IFUNC resolver function for fromEAC_RG11().
+ * @return Function pointer.
+ */
+static __typeof__(&ImageDecoder::fromEAC_RG11_cpp) fromEAC_RG11_resolve(void)
+{
+#ifdef IMAGEDECODER_HAS_AVX2
+	if (RP_CPU_HasAVX2()) {
+		return &ImageDecoder::fromEAC_RG11_avx2;
+	} else
+#endif /* IMAGEDECODER_HAS_AVX2 */
+#ifdef IMAGEDECODER_HAS_SSE41
+	if (RP_CPU_HasSSE41()) {
+		return &ImageDecoder::fromEAC_RG11_sse41;
+	} else
+#endif /* IMAGEDECODER_HAS_SSE41 */
+	{
+		return &ImageDecoder::fromEAC_RG11_cpp;
+	}
+}
+
 }
 
-#ifndef IMAGEDECODER_ALWAYS_HAS_SSE2
 rp_image *ImageDecoder::fromLinear16(PixelFormat px_format,
 	int width, int height,
 	const uint16_t *img_buf, int img_siz, int stride)
 	IFUNC_ATTR(fromLinear16_resolve);
-#endif /* IMAGEDECODER_ALWAYS_HAS_SSE2 */
 
 rp_image *ImageDecoder::fromLinear24(PixelFormat px_format,
 	int width, int height,
@@ -86,4 +269,37 @@ rp_image *ImageDecoder::fromLinear32(PixelFormat px_format,
 	const uint32_t *img_buf, int img_siz, int stride)
 	IFUNC_ATTR(fromLinear32_resolve);
 
+#ifndef IMAGEDECODER_ALWAYS_HAS_SSE2
+rp_image *ImageDecoder::unswizzleMorton32(const rp_image *img, uint32_t mask_x, uint32_t mask_y)
+	IFUNC_ATTR(unswizzleMorton32_resolve);
+#endif /* !IMAGEDECODER_ALWAYS_HAS_SSE2 */
+
+rp_image *ImageDecoder::fromBC7(int width, int height,
+	const uint8_t *img_buf, int img_siz)
+	IFUNC_ATTR(fromBC7_resolve);
+
+rp_image *ImageDecoder::fromETC1(int width, int height,
+	const uint8_t *RESTRICT img_buf, int img_siz)
+	IFUNC_ATTR(fromETC1_resolve);
+
+rp_image *ImageDecoder::fromETC2_RGB(int width, int height,
+	const uint8_t *RESTRICT img_buf, int img_siz)
+	IFUNC_ATTR(fromETC2_RGB_resolve);
+
+rp_image *ImageDecoder::fromETC2_RGBA(int width, int height,
+	const uint8_t *RESTRICT img_buf, int img_siz)
+	IFUNC_ATTR(fromETC2_RGBA_resolve);
+
+rp_image *ImageDecoder::fromETC2_RGB_A1(int width, int height,
+	const uint8_t *RESTRICT img_buf, int img_siz)
+	IFUNC_ATTR(fromETC2_RGB_A1_resolve);
+
+rp_image *ImageDecoder::fromEAC_R11(int width, int height,
+	const uint8_t *RESTRICT img_buf, int img_siz)
+	IFUNC_ATTR(fromEAC_R11_resolve);
+
+rp_image *ImageDecoder::fromEAC_RG11(int width, int height,
+	const uint8_t *RESTRICT img_buf, int img_siz)
+	IFUNC_ATTR(fromEAC_RG11_resolve);
+
 #endif /* HAVE_IFUNC */
@@ -2,7 +2,7 @@
  * ROM Properties Page shell extension. (librptexture)                     *
  * ImageDecoder_p.hpp: Image decoding functions. (PRIVATE CLASS)           *
  *                                                                         *
- * Copyright (c) 2016-2021 by David Korth.                                 *
+ * Copyright (c) 2016-2022 by David Korth.                                 *
  * SPDX-License-Identifier: GPL-2.0-or-later                               *
  ***************************************************************************/
 
@@ -10,6 +10,7 @@
 #define __ROMPROPERTIES_LIBRPTEXTURE_DECODER_IMAGEDECODER_P_HPP__
 
 #include "common.h"
+#include "librpcpu/bitstuff.h"
 #include "../img/rp_image.hpp"
 
 // C includes. (C++ namespace)
@@ -17,8 +18,13 @@
 #include <cstring>
 
 // C++ includes.
+#include <algorithm>
 #include <array>
 
+#ifdef _OPENMP
+#  include <omp.h>
+#endif /* _OPENMP */
+
 namespace LibRpTexture {
 
 class ImageDecoderPrivate
@@ -94,6 +100,43 @@ class ImageDecoderPrivate
 		static inline void BlitTile_CI4_LeftLSN(
 			rp_image *RESTRICT img, const std::array<uint8_t, tileW*tileH/2> &tileBuf,
 			unsigned int tileX, unsigned int tileY);
+
+	public:
+		/**
+		 * Minimum image size for parallel decoding, in pixels.
+		 * Smaller images are decoded on the calling thread,
+		 * since the threading overhead outweighs the gain.
+		 */
+		static const unsigned int PARALLEL_DECODE_MIN_PIXELS = 256*256;
+
+		/**
+		 * Decode an image in bands of block rows.
+		 *
+		 * Each band covers a contiguous range of block rows, which
+		 * must be independent of every other band. If OpenMP is
+		 * available and the image has at least PARALLEL_DECODE_MIN_PIXELS
+		 * pixels, the bands are decoded on the OpenMP thread pool.
+		 * Otherwise, the whole image is decoded on the calling thread.
+		 *
+		 * @tparam DecodeFn	[in] bool decodeFn(unsigned int rowBegin, unsigned int rowEnd)
+		 * @param img		[in] Destination rp_image
+		 * @param blockRows	[in] Number of block rows
+		 * @param decodeFn	[in] Band decoding function; returns false on error.
+		 * @return True on success; false if any band failed.
+		 */
+		template<typename DecodeFn>
+		static inline bool decodeBlockRows(const rp_image *img,
+			unsigned int blockRows, DecodeFn decodeFn);
+
+		/**
+		 * Verify the parameters for unswizzleMorton32().
+		 * @param img		[in] Swizzled ARGB32 image.
+		 * @param mask_x	[in] X coordinate bits within a tile.
+		 * @param mask_y	[in] Y coordinate bits within a tile.
+		 * @return True if the parameters are valid; false if not.
+		 */
+		static inline bool checkMortonParams(const rp_image *img,
+			uint32_t mask_x, uint32_t mask_y);
 };
 
 /**
@@ -219,6 +262,86 @@ inline void ImageDecoderPrivate::BlitTile_CI4_LeftLSN(
 	}
 }
 
+/**
+ * Decode an image in bands of block rows.
+ *
+ * Each band covers a contiguous range of block rows, which
+ * must be independent of every other band. If OpenMP is
+ * available and the image has at least PARALLEL_DECODE_MIN_PIXELS
+ * pixels, the bands are decoded on the OpenMP thread pool.
+ * Otherwise, the whole image is decoded on the calling thread.
+ *
+ * @tparam DecodeFn	[in] bool decodeFn(unsigned int rowBegin, unsigned int rowEnd)
+ * @param img		[in] Destination rp_image
+ * @param blockRows	[in] Number of block rows
+ * @param decodeFn	[in] Band decoding function; returns false on error.
+ * @return True on success; false if any band failed.
+ */
+template<typename DecodeFn>
+inline bool ImageDecoderPrivate::decodeBlockRows(const rp_image *img,
+	unsigned int blockRows, DecodeFn decodeFn)
+{
+#ifdef _OPENMP
+	const unsigned int pixels = static_cast<unsigned int>(img->width()) *
+	                            static_cast<unsigned int>(img->height());
+	const int threads = omp_get_max_threads();
+	if (threads > 1 && blockRows > 1 && pixels >= PARALLEL_DECODE_MIN_PIXELS) {
+		// Use a few bands per thread so uneven blocks
+		// (e.g. BC7 modes) don't stall a single thread.
+		const int bands = static_cast<int>(std::min(blockRows, static_cast<unsigned int>(threads) * 4U));
+		bool bOK = true;
+
+#pragma omp parallel for schedule(dynamic, 1)
+		for (int band = 0; band < bands; band++) {
+			const unsigned int rowBegin = static_cast<unsigned int>((static_cast<uint64_t>(blockRows) * band) / bands);
+			const unsigned int rowEnd = static_cast<unsigned int>((static_cast<uint64_t>(blockRows) * (band + 1)) / bands);
+			if (!decodeFn(rowBegin, rowEnd)) {
+#pragma omp atomic write
+				bOK = false;
+			}
+		}
+
+		return bOK;
+	}
+#else /* !_OPENMP */
+	RP_UNUSED(img);
+#endif /* _OPENMP */
+
+	return decodeFn(0, blockRows);
+}
+
+/**
+ * Verify the parameters for unswizzleMorton32().
+ * @param img		[in] Swizzled ARGB32 image.
+ * @param mask_x	[in] X coordinate bits within a tile.
+ * @param mask_y	[in] Y coordinate bits within a tile.
+ * @return True if the parameters are valid; false if not.
+ */
+inline bool ImageDecoderPrivate::checkMortonParams(const rp_image *img,
+	uint32_t mask_x, uint32_t mask_y)
+{
+	assert(img != nullptr);
+	assert(img->isValid());
+	assert(img->format() == rp_image::Format::ARGB32);
+	if (!img || !img->isValid() || img->format() != rp_image::Format::ARGB32)
+		return false;
+
+	// The masks must not overlap, and together they must
+	// cover the low bits of the tile index.
+	const uint32_t mask_xy = mask_x | mask_y;
+	assert((mask_x & mask_y) == 0);
+	assert((mask_xy & (mask_xy + 1)) == 0);
+	if ((mask_x & mask_y) != 0 || (mask_xy & (mask_xy + 1)) != 0)
+		return false;
+
+	// Image dimensions must be a multiple of the tile size.
+	const int tileW = 1 << popcount(mask_x);
+	const int tileH = 1 << popcount(mask_y);
+	assert(img->width() % tileW == 0);
+	assert(img->height() % tileH == 0);
+	return (img->width() % tileW == 0 && img->height() % tileH == 0);
+}
+
 }
 
 #endif /* __ROMPROPERTIES_LIBRPTEXTURE_DECODER_IMAGEDECODER_P_HPP__ */
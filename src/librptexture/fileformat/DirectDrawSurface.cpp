@@ -57,19 +57,31 @@ class DirectDrawSurfacePrivate final : public FileFormatPrivate
 		// Texture data start address.
 		unsigned int texDataStartAddr;
 
-		// Decoded image.
-		rp_image *img;
+		// Decoded mipmaps.
+		// Mipmap 0 is the full image.
+		vector<rp_image*> mipmaps;
 
 		// Pixel format message.
 		// NOTE: Used for both valid and invalid pixel formats
 		// due to various bit specifications.
 		char pixel_format[32];
 
+		/**
+		 * Calculate the size of a mipmap's texture data.
+		 * @param mip		[in] Mipmap number.
+		 * @param width		[in] Mipmap width.
+		 * @param height	[in] Mipmap height.
+		 * @param pStride	[out] Stride, for uncompressed images. (0 for compressed images)
+		 * @return Size of the mipmap's texture data, in bytes, or 0 if the format isn't supported.
+		 */
+		uint32_t calcMipmapSize(int mip, unsigned int width, unsigned int height, unsigned int *pStride) const;
+
 		/**
 		 * Load the image.
+		 * @param mip Mipmap number. (0 == full image)
 		 * @return Image, or nullptr on error.
 		 */
-		const rp_image *loadImage(void);
+		const rp_image *loadImage(int mip);
 
 	public:
 		// Supported uncompressed RGB formats.
@@ -498,7 +510,6 @@ int DirectDrawSurfacePrivate::updatePixelFormat(void)
 DirectDrawSurfacePrivate::DirectDrawSurfacePrivate(DirectDrawSurface *q, IRpFile *file)
 	: super(q, file, &textureInfo)
 	, texDataStartAddr(0)
-	, img(nullptr)
 	, pxf_uncomp(ImageDecoder::PixelFormat::Unknown)
 	, bytespp(0)
 	, dxgi_format(0)
@@ -513,18 +524,238 @@ DirectDrawSurfacePrivate::DirectDrawSurfacePrivate(DirectDrawSurface *q, IRpFile
 
 DirectDrawSurfacePrivate::~DirectDrawSurfacePrivate()
 {
-	UNREF(img);
+	for (rp_image *img : mipmaps) {
+		UNREF(img);
+	}
+}
+
+/**
+ * Calculate the size of a mipmap's texture data.
+ * @param mip		[in] Mipmap number.
+ * @param width		[in] Mipmap width.
+ * @param height	[in] Mipmap height.
+ * @param pStride	[out] Stride, for uncompressed images. (0 for compressed images)
+ * @return Size of the mipmap's texture data, in bytes, or 0 if the format isn't supported.
+ */
+uint32_t DirectDrawSurfacePrivate::calcMipmapSize(int mip, unsigned int width, unsigned int height, unsigned int *pStride) const
+{
+	*pStride = 0;
+	if (dxgi_format == 0) {
+		// Uncompressed linear image data.
+		assert(pxf_uncomp != ImageDecoder::PixelFormat::Unknown);
+		assert(bytespp != 0);
+		if (pxf_uncomp == ImageDecoder::PixelFormat::Unknown || bytespp == 0) {
+			// Pixel format wasn't updated...
+			return 0;
+		}
+
+		unsigned int stride = 0;
+		if (mip == 0) {
+			// If DDSD_LINEARSIZE is set, the field is linear size,
+			// so it needs to be divided by the image height.
+			if (ddsHeader.dwFlags & DDSD_LINEARSIZE) {
+				if (ddsHeader.dwHeight != 0) {
+					stride = ddsHeader.dwPitchOrLinearSize / ddsHeader.dwHeight;
+				}
+			} else {
+				stride = ddsHeader.dwPitchOrLinearSize;
+			}
+		}
+		if (stride == 0) {
+			// Invalid stride, or a smaller mipmap.
+			// Mipmaps don't have a stride field, so assume stride == width * bytespp.
+			// TODO: Check for stride is too small but non-zero?
+			stride = width * bytespp;
+		} else if (stride > (width * 16)) {
+			// Stride is too large.
+			return 0;
+		}
+
+		*pStride = stride;
+		return height * stride;
+	}
+
+	// Compressed RGB data.
+	// NOTE: dwPitchOrLinearSize is not necessarily correct.
+	// Calculate the expected size.
+	uint32_t expected_size;
+	switch (dxgi_format) {
+#ifdef ENABLE_PVRTC
+		case DXGI_FORMAT_FAKE_PVRTC_2bpp:
+			// 32 pixels compressed into 64 bits. (2bpp)
+			// NOTE: Image dimensions must be a power of 2 for PVRTC-I.
+			expected_size = ImageSizeCalc::calcImageSizePVRTC_PoT<true>(
+				width, height);
+			break;
+
+		case DXGI_FORMAT_FAKE_PVRTC_4bpp:
+			// 16 pixels compressed into 64 bits. (4bpp)
+			// NOTE: Image dimensions must be a power of 2 for PVRTC-I.
+			expected_size = ImageSizeCalc::calcImageSizePVRTC_PoT<false>(
+				width, height);
+			break;
+#endif /* ENABLE_PVRTC */
+
+		case DXGI_FORMAT_BC1_TYPELESS:
+		case DXGI_FORMAT_BC1_UNORM:
+		case DXGI_FORMAT_BC1_UNORM_SRGB:
+		case DXGI_FORMAT_BC4_TYPELESS:
+		case DXGI_FORMAT_BC4_UNORM:
+		case DXGI_FORMAT_BC4_SNORM:
+			// 16 pixels compressed into 64 bits. (4bpp)
+			// NOTE: Width and height must be rounded to the nearest tile. (4x4)
+			expected_size = ALIGN_BYTES(4, width) *
+			                ALIGN_BYTES(4, height) / 2;
+			break;
+
+		case DXGI_FORMAT_BC2_TYPELESS:
+		case DXGI_FORMAT_BC2_UNORM:
+		case DXGI_FORMAT_BC2_UNORM_SRGB:
+		case DXGI_FORMAT_BC3_TYPELESS:
+		case DXGI_FORMAT_BC3_UNORM:
+		case DXGI_FORMAT_BC3_UNORM_SRGB:
+		case DXGI_FORMAT_BC5_TYPELESS:
+		case DXGI_FORMAT_BC5_UNORM:
+		case DXGI_FORMAT_BC5_SNORM:
+		case DXGI_FORMAT_BC7_TYPELESS:
+		case DXGI_FORMAT_BC7_UNORM:
+		case DXGI_FORMAT_BC7_UNORM_SRGB:
+			// 16 pixels compressed into 128 bits. (8bpp)
+			// NOTE: Width and height must be rounded to the nearest tile. (4x4)
+			expected_size = ALIGN_BYTES(4, width) *
+			                ALIGN_BYTES(4, height);
+			break;
+
+		case DXGI_FORMAT_R9G9B9E5_SHAREDEXP:
+			// Uncompressed "special" 32bpp formats.
+			expected_size = width * height * 4;
+			break;
+
+#ifdef ENABLE_ASTC
+		case DXGI_FORMAT_ASTC_4X4_TYPELESS:
+		case DXGI_FORMAT_ASTC_4X4_UNORM:
+		case DXGI_FORMAT_ASTC_4X4_UNORM_SRGB:
+			expected_size = ImageSizeCalc::calcImageSizeASTC(
+				width, height, 4, 4);
+			break;
+		case DXGI_FORMAT_ASTC_5X4_TYPELESS:
+		case DXGI_FORMAT_ASTC_5X4_UNORM:
+		case DXGI_FORMAT_ASTC_5X4_UNORM_SRGB:
+			expected_size = ImageSizeCalc::calcImageSizeASTC(
+				width, height, 5, 4);
+			break;
+		case DXGI_FORMAT_ASTC_5X5_TYPELESS:
+		case DXGI_FORMAT_ASTC_5X5_UNORM:
+		case DXGI_FORMAT_ASTC_5X5_UNORM_SRGB:
+			expected_size = ImageSizeCalc::calcImageSizeASTC(
+				width, height, 5, 5);
+			break;
+		case DXGI_FORMAT_ASTC_6X5_TYPELESS:
+		case DXGI_FORMAT_ASTC_6X5_UNORM:
+		case DXGI_FORMAT_ASTC_6X5_UNORM_SRGB:
+			expected_size = ImageSizeCalc::calcImageSizeASTC(
+				width, height, 6, 5);
+			break;
+		case DXGI_FORMAT_ASTC_6X6_TYPELESS:
+		case DXGI_FORMAT_ASTC_6X6_UNORM:
+		case DXGI_FORMAT_ASTC_6X6_UNORM_SRGB:
+			expected_size = ImageSizeCalc::calcImageSizeASTC(
+				width, height, 6, 6);
+			break;
+		case DXGI_FORMAT_ASTC_8X5_TYPELESS:
+		case DXGI_FORMAT_ASTC_8X5_UNORM:
+		case DXGI_FORMAT_ASTC_8X5_UNORM_SRGB:
+			expected_size = ImageSizeCalc::calcImageSizeASTC(
+				width, height, 8, 5);
+			break;
+		case DXGI_FORMAT_ASTC_8X6_TYPELESS:
+		case DXGI_FORMAT_ASTC_8X6_UNORM:
+		case DXGI_FORMAT_ASTC_8X6_UNORM_SRGB:
+			expected_size = ImageSizeCalc::calcImageSizeASTC(
+				width, height, 8, 6);
+			break;
+		case DXGI_FORMAT_ASTC_8X8_TYPELESS:
+		case DXGI_FORMAT_ASTC_8X8_UNORM:
+		case DXGI_FORMAT_ASTC_8X8_UNORM_SRGB:
+			expected_size = ImageSizeCalc::calcImageSizeASTC(
+				width, height, 8, 8);
+			break;
+		case DXGI_FORMAT_ASTC_10X5_TYPELESS:
+		case DXGI_FORMAT_ASTC_10X5_UNORM:
+		case DXGI_FORMAT_ASTC_10X5_UNORM_SRGB:
+			expected_size = ImageSizeCalc::calcImageSizeASTC(
+				width, height, 10, 5);
+			break;
+		case DXGI_FORMAT_ASTC_10X6_TYPELESS:
+		case DXGI_FORMAT_ASTC_10X6_UNORM:
+		case DXGI_FORMAT_ASTC_10X6_UNORM_SRGB:
+			expected_size = ImageSizeCalc::calcImageSizeASTC(
+				width, height, 10, 6);
+			break;
+		case DXGI_FORMAT_ASTC_10X8_TYPELESS:
+		case DXGI_FORMAT_ASTC_10X8_UNORM:
+		case DXGI_FORMAT_ASTC_10X8_UNORM_SRGB:
+			expected_size = ImageSizeCalc::calcImageSizeASTC(
+				width, height, 10, 8);
+			break;
+		case DXGI_FORMAT_ASTC_10X10_TYPELESS:
+		case DXGI_FORMAT_ASTC_10X10_UNORM:
+		case DXGI_FORMAT_ASTC_10X10_UNORM_SRGB:
+			expected_size = ImageSizeCalc::calcImageSizeASTC(
+				width, height, 10, 10);
+			break;
+		case DXGI_FORMAT_ASTC_12X10_TYPELESS:
+		case DXGI_FORMAT_ASTC_12X10_UNORM:
+		case DXGI_FORMAT_ASTC_12X10_UNORM_SRGB:
+			expected_size = ImageSizeCalc::calcImageSizeASTC(
+				width, height, 12, 10);
+			break;
+		case DXGI_FORMAT_ASTC_12X12_TYPELESS:
+		case DXGI_FORMAT_ASTC_12X12_UNORM:
+		case DXGI_FORMAT_ASTC_12X12_UNORM_SRGB:
+			expected_size = ImageSizeCalc::calcImageSizeASTC(
+				width, height, 12, 12);
+			break;
+#endif /* ENABLE_ASTC */
+
+		default:
+			// Not supported.
+			return 0;
+	}
+
+	return expected_size;
 }
 
 /**
  * Load the image.
+ * @param mip Mipmap number. (0 == full image)
  * @return Image, or nullptr on error.
  */
-const rp_image *DirectDrawSurfacePrivate::loadImage(void)
+const rp_image *DirectDrawSurfacePrivate::loadImage(int mip)
 {
-	if (img) {
+	int mipmapCount = static_cast<int>(ddsHeader.dwMipMapCount);
+	if (mipmapCount <= 0) {
+		// No mipmaps == one image.
+		mipmapCount = 1;
+	}
+
+	assert(mip >= 0);
+	assert(mip < mipmapCount);
+	if (mip < 0 || mip >= mipmapCount) {
+		// Invalid mipmap number.
+		return nullptr;
+	} else if (mip > 0 && (ddsHeader.dwCaps2 & DDSCAPS2_VOLUME)) {
+		// TODO: Volume textures store all slices of a mipmap
+		// together, so the mipmap offsets are different.
+		return nullptr;
+	}
+
+	if (mipmaps.empty()) {
+		mipmaps.resize(mipmapCount);
+	}
+	if (mipmaps[mip]) {
 		// Image has already been loaded.
-		return img;
+		return mipmaps[mip];
 	} else if (!this->file || !this->isValid) {
 		// Can't load the image.
 		return nullptr;
@@ -557,10 +788,37 @@ const rp_image *DirectDrawSurfacePrivate::loadImage(void)
 	}
 	const uint32_t file_sz = static_cast<uint32_t>(file->size());
 
-	// Seek to the start of the texture data.
-	int ret = file->seek(texDataStartAddr);
-	if (ret != 0) {
-		// Seek error.
+	// NOTE: Mipmaps are stored *after* the main image, with each
+	// mipmap being half the size of the previous one.
+	// For texture arrays and cubemaps, the first surface's mipmaps
+	// are stored before the other surfaces, so this works there, too.
+	unsigned int width = ddsHeader.dwWidth;
+	unsigned int height = ddsHeader.dwHeight;
+	unsigned int stride;
+	uint32_t addr = texDataStartAddr;
+	uint32_t expected_size = calcMipmapSize(0, width, height, &stride);
+	for (int i = 1; i <= mip && expected_size != 0; i++) {
+		addr += expected_size;
+		width = std::max(width / 2, 1U);
+		height = std::max(height / 2, 1U);
+		expected_size = calcMipmapSize(i, width, height, &stride);
+	}
+	if (expected_size == 0) {
+		// Not supported.
+		return nullptr;
+	}
+
+	// Verify file size.
+	if (addr > file_sz || expected_size > file_sz - addr) {
+		// File is too small.
+		return nullptr;
+	}
+
+	// Read the texture data.
+	auto buf = aligned_uptr<uint8_t>(16, expected_size);
+	size_t size = file->seekAndRead(addr, buf.get(), expected_size);
+	if (size != expected_size) {
+		// Seek and/or read error.
 		return nullptr;
 	}
 
@@ -571,172 +829,9 @@ const rp_image *DirectDrawSurfacePrivate::loadImage(void)
 
 	// TODO: Handle sRGB.
 
-	// NOTE: Mipmaps are stored *after* the main image.
-	// Hence, no mipmap processing is necessary.
+	rp_image *img = nullptr;
 	if (dxgi_format != 0) {
 		// Compressed RGB data.
-
-		// NOTE: dwPitchOrLinearSize is not necessarily correct.
-		// Calculate the expected size.
-		uint32_t expected_size;
-		switch (dxgi_format) {
-#ifdef ENABLE_PVRTC
-			case DXGI_FORMAT_FAKE_PVRTC_2bpp:
-				// 32 pixels compressed into 64 bits. (2bpp)
-				// NOTE: Image dimensions must be a power of 2 for PVRTC-I.
-				expected_size = ImageSizeCalc::calcImageSizePVRTC_PoT<true>(
-					ddsHeader.dwWidth, ddsHeader.dwHeight);
-				break;
-
-			case DXGI_FORMAT_FAKE_PVRTC_4bpp:
-				// 16 pixels compressed into 64 bits. (4bpp)
-				// NOTE: Image dimensions must be a power of 2 for PVRTC-I.
-				expected_size = ImageSizeCalc::calcImageSizePVRTC_PoT<false>(
-					ddsHeader.dwWidth, ddsHeader.dwHeight);
-				break;
-#endif /* ENABLE_PVRTC */
-
-			case DXGI_FORMAT_BC1_TYPELESS:
-			case DXGI_FORMAT_BC1_UNORM:
-			case DXGI_FORMAT_BC1_UNORM_SRGB:
-			case DXGI_FORMAT_BC4_TYPELESS:
-			case DXGI_FORMAT_BC4_UNORM:
-			case DXGI_FORMAT_BC4_SNORM:
-				// 16 pixels compressed into 64 bits. (4bpp)
-				// NOTE: Width and height must be rounded to the nearest tile. (4x4)
-				expected_size = ALIGN_BYTES(4, ddsHeader.dwWidth) *
-				                ALIGN_BYTES(4, ddsHeader.dwHeight) / 2;
-				break;
-
-			case DXGI_FORMAT_BC2_TYPELESS:
-			case DXGI_FORMAT_BC2_UNORM:
-			case DXGI_FORMAT_BC2_UNORM_SRGB:
-			case DXGI_FORMAT_BC3_TYPELESS:
-			case DXGI_FORMAT_BC3_UNORM:
-			case DXGI_FORMAT_BC3_UNORM_SRGB:
-			case DXGI_FORMAT_BC5_TYPELESS:
-			case DXGI_FORMAT_BC5_UNORM:
-			case DXGI_FORMAT_BC5_SNORM:
-			case DXGI_FORMAT_BC7_TYPELESS:
-			case DXGI_FORMAT_BC7_UNORM:
-			case DXGI_FORMAT_BC7_UNORM_SRGB:
-				// 16 pixels compressed into 128 bits. (8bpp)
-				// NOTE: Width and height must be rounded to the nearest tile. (4x4)
-				expected_size = ALIGN_BYTES(4, ddsHeader.dwWidth) *
-				                ALIGN_BYTES(4, ddsHeader.dwHeight);
-				break;
-
-			case DXGI_FORMAT_R9G9B9E5_SHAREDEXP:
-				// Uncompressed "special" 32bpp formats.
-				expected_size = ddsHeader.dwWidth * ddsHeader.dwHeight * 4;
-				break;
-
-#ifdef ENABLE_ASTC
-			case DXGI_FORMAT_ASTC_4X4_TYPELESS:
-			case DXGI_FORMAT_ASTC_4X4_UNORM:
-			case DXGI_FORMAT_ASTC_4X4_UNORM_SRGB:
-				expected_size = ImageSizeCalc::calcImageSizeASTC(
-					ddsHeader.dwWidth, ddsHeader.dwHeight, 4, 4);
-				break;
-			case DXGI_FORMAT_ASTC_5X4_TYPELESS:
-			case DXGI_FORMAT_ASTC_5X4_UNORM:
-			case DXGI_FORMAT_ASTC_5X4_UNORM_SRGB:
-				expected_size = ImageSizeCalc::calcImageSizeASTC(
-					ddsHeader.dwWidth, ddsHeader.dwHeight, 5, 4);
-				break;
-			case DXGI_FORMAT_ASTC_5X5_TYPELESS:
-			case DXGI_FORMAT_ASTC_5X5_UNORM:
-			case DXGI_FORMAT_ASTC_5X5_UNORM_SRGB:
-				expected_size = ImageSizeCalc::calcImageSizeASTC(
-					ddsHeader.dwWidth, ddsHeader.dwHeight, 5, 5);
-				break;
-			case DXGI_FORMAT_ASTC_6X5_TYPELESS:
-			case DXGI_FORMAT_ASTC_6X5_UNORM:
-			case DXGI_FORMAT_ASTC_6X5_UNORM_SRGB:
-				expected_size = ImageSizeCalc::calcImageSizeASTC(
-					ddsHeader.dwWidth, ddsHeader.dwHeight, 6, 5);
-				break;
-			case DXGI_FORMAT_ASTC_6X6_TYPELESS:
-			case DXGI_FORMAT_ASTC_6X6_UNORM:
-			case DXGI_FORMAT_ASTC_6X6_UNORM_SRGB:
-				expected_size = ImageSizeCalc::calcImageSizeASTC(
-					ddsHeader.dwWidth, ddsHeader.dwHeight, 6, 6);
-				break;
-			case DXGI_FORMAT_ASTC_8X5_TYPELESS:
-			case DXGI_FORMAT_ASTC_8X5_UNORM:
-			case DXGI_FORMAT_ASTC_8X5_UNORM_SRGB:
-				expected_size = ImageSizeCalc::calcImageSizeASTC(
-					ddsHeader.dwWidth, ddsHeader.dwHeight, 8, 5);
-				break;
-			case DXGI_FORMAT_ASTC_8X6_TYPELESS:
-			case DXGI_FORMAT_ASTC_8X6_UNORM:
-			case DXGI_FORMAT_ASTC_8X6_UNORM_SRGB:
-				expected_size = ImageSizeCalc::calcImageSizeASTC(
-					ddsHeader.dwWidth, ddsHeader.dwHeight, 8, 6);
-				break;
-			case DXGI_FORMAT_ASTC_8X8_TYPELESS:
-			case DXGI_FORMAT_ASTC_8X8_UNORM:
-			case DXGI_FORMAT_ASTC_8X8_UNORM_SRGB:
-				expected_size = ImageSizeCalc::calcImageSizeASTC(
-					ddsHeader.dwWidth, ddsHeader.dwHeight, 8, 8);
-				break;
-			case DXGI_FORMAT_ASTC_10X5_TYPELESS:
-			case DXGI_FORMAT_ASTC_10X5_UNORM:
-			case DXGI_FORMAT_ASTC_10X5_UNORM_SRGB:
-				expected_size = ImageSizeCalc::calcImageSizeASTC(
-					ddsHeader.dwWidth, ddsHeader.dwHeight, 10, 5);
-				break;
-			case DXGI_FORMAT_ASTC_10X6_TYPELESS:
-			case DXGI_FORMAT_ASTC_10X6_UNORM:
-			case DXGI_FORMAT_ASTC_10X6_UNORM_SRGB:
-				expected_size = ImageSizeCalc::calcImageSizeASTC(
-					ddsHeader.dwWidth, ddsHeader.dwHeight, 10, 6);
-				break;
-			case DXGI_FORMAT_ASTC_10X8_TYPELESS:
-			case DXGI_FORMAT_ASTC_10X8_UNORM:
-			case DXGI_FORMAT_ASTC_10X8_UNORM_SRGB:
-				expected_size = ImageSizeCalc::calcImageSizeASTC(
-					ddsHeader.dwWidth, ddsHeader.dwHeight, 10, 8);
-				break;
-			case DXGI_FORMAT_ASTC_10X10_TYPELESS:
-			case DXGI_FORMAT_ASTC_10X10_UNORM:
-			case DXGI_FORMAT_ASTC_10X10_UNORM_SRGB:
-				expected_size = ImageSizeCalc::calcImageSizeASTC(
-					ddsHeader.dwWidth, ddsHeader.dwHeight, 10, 10);
-				break;
-			case DXGI_FORMAT_ASTC_12X10_TYPELESS:
-			case DXGI_FORMAT_ASTC_12X10_UNORM:
-			case DXGI_FORMAT_ASTC_12X10_UNORM_SRGB:
-				expected_size = ImageSizeCalc::calcImageSizeASTC(
-					ddsHeader.dwWidth, ddsHeader.dwHeight, 12, 10);
-				break;
-			case DXGI_FORMAT_ASTC_12X12_TYPELESS:
-			case DXGI_FORMAT_ASTC_12X12_UNORM:
-			case DXGI_FORMAT_ASTC_12X12_UNORM_SRGB:
-				expected_size = ImageSizeCalc::calcImageSizeASTC(
-					ddsHeader.dwWidth, ddsHeader.dwHeight, 12, 12);
-				break;
-#endif /* ENABLE_ASTC */
-
-			default:
-				// Not supported.
-				return nullptr;
-		}
-
-		// Verify file size.
-		if (expected_size >= file_sz + texDataStartAddr) {
-			// File is too small.
-			return nullptr;
-		}
-
-		// Read the texture data.
-		auto buf = aligned_uptr<uint8_t>(16, expected_size);
-		size_t size = file->read(buf.get(), expected_size);
-		if (size != expected_size) {
-			// Read error.
-			return nullptr;
-		}
-
 		// TODO: Handle typeless, signed, sRGB, float.
 		switch (dxgi_format) {
 			case DXGI_FORMAT_BC1_TYPELESS:
@@ -745,12 +840,12 @@ const rp_image *DirectDrawSurfacePrivate::loadImage(void)
 				if (likely(dxgi_alpha != DDS_ALPHA_MODE_OPAQUE)) {
 					// 1-bit alpha.
 					img = ImageDecoder::fromDXT1_A1(
-						ddsHeader.dwWidth, ddsHeader.dwHeight,
+						width, height,
 						buf.get(), expected_size);
 				} else {
 					// No alpha channel.
 					img = ImageDecoder::fromDXT1(
-						ddsHeader.dwWidth, ddsHeader.dwHeight,
+						width, height,
 						buf.get(), expected_size);
 				}
 				break;
@@ -761,12 +856,12 @@ const rp_image *DirectDrawSurfacePrivate::loadImage(void)
 				if (likely(dxgi_alpha != DDS_ALPHA_MODE_PREMULTIPLIED)) {
 					// Standard alpha: DXT3
 					img = ImageDecoder::fromDXT3(
-						ddsHeader.dwWidth, ddsHeader.dwHeight,
+						width, height,
 						buf.get(), expected_size);
 				} else {
 					// Premultiplied alpha: DXT2
 					img = ImageDecoder::fromDXT2(
-						ddsHeader.dwWidth, ddsHeader.dwHeight,
+						width, height,
 						buf.get(), expected_size);
 				}
 				break;
@@ -777,12 +872,12 @@ const rp_image *DirectDrawSurfacePrivate::loadImage(void)
 				if (likely(dxgi_alpha != DDS_ALPHA_MODE_PREMULTIPLIED)) {
 					// Standard alpha: DXT5
 					img = ImageDecoder::fromDXT5(
-						ddsHeader.dwWidth, ddsHeader.dwHeight,
+						width, height,
 						buf.get(), expected_size);
 				} else {
 					// Premultiplied alpha: DXT4
 					img = ImageDecoder::fromDXT4(
-						ddsHeader.dwWidth, ddsHeader.dwHeight,
+						width, height,
 						buf.get(), expected_size);
 				}
 				break;
@@ -791,7 +886,7 @@ const rp_image *DirectDrawSurfacePrivate::loadImage(void)
 			case DXGI_FORMAT_BC4_UNORM:
 			case DXGI_FORMAT_BC4_SNORM:
 				img = ImageDecoder::fromBC4(
-					ddsHeader.dwWidth, ddsHeader.dwHeight,
+					width, height,
 					buf.get(), expected_size);
 				break;
 
@@ -799,7 +894,7 @@ const rp_image *DirectDrawSurfacePrivate::loadImage(void)
 			case DXGI_FORMAT_BC5_UNORM:
 			case DXGI_FORMAT_BC5_SNORM:
 				img = ImageDecoder::fromBC5(
-					ddsHeader.dwWidth, ddsHeader.dwHeight,
+					width, height,
 					buf.get(), expected_size);
 				break;
 
@@ -807,7 +902,7 @@ const rp_image *DirectDrawSurfacePrivate::loadImage(void)
 			case DXGI_FORMAT_BC7_UNORM:
 			case DXGI_FORMAT_BC7_UNORM_SRGB:
 				img = ImageDecoder::fromBC7(
-					ddsHeader.dwWidth, ddsHeader.dwHeight,
+					width, height,
 					buf.get(), expected_size);
 				break;
 
@@ -815,7 +910,7 @@ const rp_image *DirectDrawSurfacePrivate::loadImage(void)
 			case DXGI_FORMAT_FAKE_PVRTC_2bpp:
 				// PVRTC, 2bpp, has alpha.
 				img = ImageDecoder::fromPVRTC(
-					ddsHeader.dwWidth, ddsHeader.dwHeight,
+					width, height,
 					buf.get(), expected_size,
 					ImageDecoder::PVRTC_2BPP | ImageDecoder::PVRTC_ALPHA_YES);
 				break;
@@ -823,7 +918,7 @@ const rp_image *DirectDrawSurfacePrivate::loadImage(void)
 			case DXGI_FORMAT_FAKE_PVRTC_4bpp:
 				// PVRTC, 4bpp, has alpha.
 				img = ImageDecoder::fromPVRTC(
-					ddsHeader.dwWidth, ddsHeader.dwHeight,
+					width, height,
 					buf.get(), expected_size,
 					ImageDecoder::PVRTC_4BPP | ImageDecoder::PVRTC_ALPHA_YES);
 				break;
@@ -833,7 +928,7 @@ const rp_image *DirectDrawSurfacePrivate::loadImage(void)
 				// RGB9_E5 (technically uncompressed...)
 				img = ImageDecoder::fromLinear32(
 					ImageDecoder::PixelFormat::RGB9_E5,
-					ddsHeader.dwWidth, ddsHeader.dwHeight,
+					width, height,
 					reinterpret_cast<const uint32_t*>(buf.get()),
 					expected_size);
 				break;
@@ -843,98 +938,98 @@ const rp_image *DirectDrawSurfacePrivate::loadImage(void)
 			case DXGI_FORMAT_ASTC_4X4_UNORM:
 			case DXGI_FORMAT_ASTC_4X4_UNORM_SRGB:
 				img = ImageDecoder::fromASTC(
-					ddsHeader.dwWidth, ddsHeader.dwHeight,
+					width, height,
 					buf.get(), expected_size, 4, 4);
 				break;
 			case DXGI_FORMAT_ASTC_5X4_TYPELESS:
 			case DXGI_FORMAT_ASTC_5X4_UNORM:
 			case DXGI_FORMAT_ASTC_5X4_UNORM_SRGB:
 				img = ImageDecoder::fromASTC(
-					ddsHeader.dwWidth, ddsHeader.dwHeight,
+					width, height,
 					buf.get(), expected_size, 5, 4);
 				break;
 			case DXGI_FORMAT_ASTC_5X5_TYPELESS:
 			case DXGI_FORMAT_ASTC_5X5_UNORM:
 			case DXGI_FORMAT_ASTC_5X5_UNORM_SRGB:
 				img = ImageDecoder::fromASTC(
-					ddsHeader.dwWidth, ddsHeader.dwHeight,
+					width, height,
 					buf.get(), expected_size, 5, 5);
 				break;
 			case DXGI_FORMAT_ASTC_6X5_TYPELESS:
 			case DXGI_FORMAT_ASTC_6X5_UNORM:
 			case DXGI_FORMAT_ASTC_6X5_UNORM_SRGB:
 				img = ImageDecoder::fromASTC(
-					ddsHeader.dwWidth, ddsHeader.dwHeight,
+					width, height,
 					buf.get(), expected_size, 6, 5);
 				break;
 			case DXGI_FORMAT_ASTC_6X6_TYPELESS:
 			case DXGI_FORMAT_ASTC_6X6_UNORM:
 			case DXGI_FORMAT_ASTC_6X6_UNORM_SRGB:
 				img = ImageDecoder::fromASTC(
-					ddsHeader.dwWidth, ddsHeader.dwHeight,
+					width, height,
 					buf.get(), expected_size, 6, 6);
 				break;
 			case DXGI_FORMAT_ASTC_8X5_TYPELESS:
 			case DXGI_FORMAT_ASTC_8X5_UNORM:
 			case DXGI_FORMAT_ASTC_8X5_UNORM_SRGB:
 				img = ImageDecoder::fromASTC(
-					ddsHeader.dwWidth, ddsHeader.dwHeight,
+					width, height,
 					buf.get(), expected_size, 8, 5);
 				break;
 			case DXGI_FORMAT_ASTC_8X6_TYPELESS:
 			case DXGI_FORMAT_ASTC_8X6_UNORM:
 			case DXGI_FORMAT_ASTC_8X6_UNORM_SRGB:
 				img = ImageDecoder::fromASTC(
-					ddsHeader.dwWidth, ddsHeader.dwHeight,
+					width, height,
 					buf.get(), expected_size, 8, 6);
 				break;
 			case DXGI_FORMAT_ASTC_8X8_TYPELESS:
 			case DXGI_FORMAT_ASTC_8X8_UNORM:
 			case DXGI_FORMAT_ASTC_8X8_UNORM_SRGB:
 				img = ImageDecoder::fromASTC(
-					ddsHeader.dwWidth, ddsHeader.dwHeight,
+					width, height,
 					buf.get(), expected_size, 8, 8);
 				break;
 			case DXGI_FORMAT_ASTC_10X5_TYPELESS:
 			case DXGI_FORMAT_ASTC_10X5_UNORM:
 			case DXGI_FORMAT_ASTC_10X5_UNORM_SRGB:
 				img = ImageDecoder::fromASTC(
-					ddsHeader.dwWidth, ddsHeader.dwHeight,
+					width, height,
 					buf.get(), expected_size, 10, 5);
 				break;
 			case DXGI_FORMAT_ASTC_10X6_TYPELESS:
 			case DXGI_FORMAT_ASTC_10X6_UNORM:
 			case DXGI_FORMAT_ASTC_10X6_UNORM_SRGB:
 				img = ImageDecoder::fromASTC(
-					ddsHeader.dwWidth, ddsHeader.dwHeight,
+					width, height,
 					buf.get(), expected_size, 10, 6);
 				break;
 			case DXGI_FORMAT_ASTC_10X8_TYPELESS:
 			case DXGI_FORMAT_ASTC_10X8_UNORM:
 			case DXGI_FORMAT_ASTC_10X8_UNORM_SRGB:
 				img = ImageDecoder::fromASTC(
-					ddsHeader.dwWidth, ddsHeader.dwHeight,
+					width, height,
 					buf.get(), expected_size, 10, 8);
 				break;
 			case DXGI_FORMAT_ASTC_10X10_TYPELESS:
 			case DXGI_FORMAT_ASTC_10X10_UNORM:
 			case DXGI_FORMAT_ASTC_10X10_UNORM_SRGB:
 				img = ImageDecoder::fromASTC(
-					ddsHeader.dwWidth, ddsHeader.dwHeight,
+					width, height,
 					buf.get(), expected_size, 10, 10);
 				break;
 			case DXGI_FORMAT_ASTC_12X10_TYPELESS:
 			case DXGI_FORMAT_ASTC_12X10_UNORM:
 			case DXGI_FORMAT_ASTC_12X10_UNORM_SRGB:
 				img = ImageDecoder::fromASTC(
-					ddsHeader.dwWidth, ddsHeader.dwHeight,
+					width, height,
 					buf.get(), expected_size, 12, 10);
 				break;
 			case DXGI_FORMAT_ASTC_12X12_TYPELESS:
 			case DXGI_FORMAT_ASTC_12X12_UNORM:
 			case DXGI_FORMAT_ASTC_12X12_UNORM_SRGB:
 				img = ImageDecoder::fromASTC(
-					ddsHeader.dwWidth, ddsHeader.dwHeight,
+					width, height,
 					buf.get(), expected_size, 12, 12);
 				break;
 #endif /* ENABLE_ASTC */
@@ -945,59 +1040,18 @@ const rp_image *DirectDrawSurfacePrivate::loadImage(void)
 		}
 	} else {
 		// Uncompressed linear image data.
-		assert(pxf_uncomp != ImageDecoder::PixelFormat::Unknown);
-		assert(bytespp != 0);
-		if (pxf_uncomp == ImageDecoder::PixelFormat::Unknown || bytespp == 0) {
-			// Pixel format wasn't updated...
-			return nullptr;
-		}
-
-		// If DDSD_LINEARSIZE is set, the field is linear size,
-		// so it needs to be divided by the image height.
-		unsigned int stride = 0;
-		if (ddsHeader.dwFlags & DDSD_LINEARSIZE) {
-			if (ddsHeader.dwHeight != 0) {
-				stride = ddsHeader.dwPitchOrLinearSize / ddsHeader.dwHeight;
-			}
-		} else {
-			stride = ddsHeader.dwPitchOrLinearSize;
-		}
-		if (stride == 0) {
-			// Invalid stride. Assume stride == width * bytespp.
-			// TODO: Check for stride is too small but non-zero?
-			stride = ddsHeader.dwWidth * bytespp;
-		} else if (stride > (ddsHeader.dwWidth * 16)) {
-			// Stride is too large.
-			return nullptr;
-		}
-		const unsigned int expected_size = ddsHeader.dwHeight * stride;
-
-		// Verify file size.
-		if (expected_size >= file_sz + texDataStartAddr) {
-			// File is too small.
-			return nullptr;
-		}
-
-		// Read the texture data.
-		auto buf = aligned_uptr<uint8_t>(16, expected_size);
-		size_t size = file->read(buf.get(), expected_size);
-		if (size != expected_size) {
-			// Read error.
-			return nullptr;
-		}
-
 		switch (bytespp) {
 			case sizeof(uint8_t):
 				// 8-bit image. (Usually luminance or alpha.)
 				img = ImageDecoder::fromLinear8(
-					pxf_uncomp, ddsHeader.dwWidth, ddsHeader.dwHeight,
+					pxf_uncomp, width, height,
 					buf.get(), expected_size, stride);
 				break;
 
 			case sizeof(uint16_t):
 				// 16-bit RGB image.
 				img = ImageDecoder::fromLinear16(
-					pxf_uncomp, ddsHeader.dwWidth, ddsHeader.dwHeight,
+					pxf_uncomp, width, height,
 					reinterpret_cast<const uint16_t*>(buf.get()),
 					expected_size, stride);
 				break;
@@ -1005,14 +1059,14 @@ const rp_image *DirectDrawSurfacePrivate::loadImage(void)
 			case 24/8:
 				// 24-bit RGB image.
 				img = ImageDecoder::fromLinear24(
-					pxf_uncomp, ddsHeader.dwWidth, ddsHeader.dwHeight,
+					pxf_uncomp, width, height,
 					buf.get(), expected_size, stride);
 				break;
 
 			case sizeof(uint32_t):
 				// 32-bit RGB image.
 				img = ImageDecoder::fromLinear32(
-					pxf_uncomp, ddsHeader.dwWidth, ddsHeader.dwHeight,
+					pxf_uncomp, width, height,
 					reinterpret_cast<const uint32_t*>(buf.get()),
 					expected_size, stride);
 				break;
@@ -1025,6 +1079,7 @@ const rp_image *DirectDrawSurfacePrivate::loadImage(void)
 	}
 
 	// TODO: Untile textures for XBOX format.
+	mipmaps[mip] = img;
 	return img;
 }
 
@@ -1498,11 +1553,7 @@ const rp_image *DirectDrawSurface::mipmap(int mip) const
 		return nullptr;
 	}
 
-	// FIXME: Support decoding mipmaps.
-	if (mip == 0) {
-		return const_cast<DirectDrawSurfacePrivate*>(d)->loadImage();
-	}
-	return nullptr;
+	return const_cast<DirectDrawSurfacePrivate*>(d)->loadImage(mip);
 }
 
 }
@@ -173,4 +173,53 @@ int FileFormat::getRescaleDimensions(int pBuf[3]) const
 	return 0;
 }
 
+/**
+ * Get the smallest image that is at least as large as the requested size.
+ * This is intended for thumbnailing, where decoding the full image
+ * would be wasteful if it's going to be downscaled anyway.
+ *
+ * The default implementation selects the smallest mipmap whose
+ * largest dimension is >= reqSize. If the mipmap can't be decoded,
+ * the next larger mipmap is tried, up to the full image.
+ *
+ * @param reqSize	[in] Requested size. (<= 0 for the full image)
+ * @param allowLowRes	[in] If true, allow an embedded low-resolution
+ *                           image that may have lower quality than the
+ *                           equivalent mipmap.
+ * @return Image, or nullptr on error.
+ */
+const rp_image *FileFormat::imageForSize(int reqSize, bool allowLowRes) const
+{
+	RP_UNUSED(allowLowRes);	// no low-res images in the base class
+	RP_D(const FileFormat);
+	if (!d->isValid) {
+		// Unknown file type.
+		return nullptr;
+	}
+
+	const int mipmapCount = this->mipmapCount();
+	if (reqSize <= 0 || mipmapCount <= 1) {
+		// Full image requested, or no mipmaps.
+		return this->image();
+	}
+
+	// Find the smallest mipmap that's still >= reqSize.
+	// Each mipmap is half the size of the previous one.
+	const int maxDim = std::max(d->dimensions[0], d->dimensions[1]);
+	int mip = 0;
+	while (mip + 1 < mipmapCount && (maxDim >> (mip + 1)) >= reqSize) {
+		mip++;
+	}
+
+	// Some formats can only decode mipmap 0.
+	// Try the selected mipmap first, then larger ones.
+	for (; mip > 0; mip--) {
+		const rp_image *const img = this->mipmap(mip);
+		if (img) {
+			return img;
+		}
+	}
+	return this->image();
+}
+
 }
@@ -2,7 +2,7 @@
  * ROM Properties Page shell extension. (librptexture)                     *
  * FileFormat.hpp: Texture file format base class.                         *
  *                                                                         *
- * Copyright (c) 2016-2021 by David Korth.                                 *
+ * Copyright (c) 2016-2022 by David Korth.                                 *
  * SPDX-License-Identifier: GPL-2.0-or-later                               *
  ***************************************************************************/
 
@@ -180,6 +180,23 @@ class FileFormat : public RefBase
 		 * @return Image, or nullptr on error.
 		 */
 		virtual const rp_image *mipmap(int mip) const = 0;
+
+		/**
+		 * Get the smallest image that is at least as large as the requested size.
+		 * This is intended for thumbnailing, where decoding the full image
+		 * would be wasteful if it's going to be downscaled anyway.
+		 *
+		 * The default implementation selects the smallest mipmap whose
+		 * largest dimension is >= reqSize. If the mipmap can't be decoded,
+		 * the next larger mipmap is tried, up to the full image.
+		 *
+		 * @param reqSize	[in] Requested size. (<= 0 for the full image)
+		 * @param allowLowRes	[in] If true, allow an embedded low-resolution
+		 *                           image that may have lower quality than the
+		 *                           equivalent mipmap.
+		 * @return Image, or nullptr on error.
+		 */
+		virtual const rp_image *imageForSize(int reqSize, bool allowLowRes) const;
 };
 
 }
@@ -2,7 +2,7 @@
  * ROM Properties Page shell extension. (librptexture)                     *
  * FileFormat_decl.hpp: Texture file format base class. (Subclass macros)  *
  *                                                                         *
- * Copyright (c) 2016-2021 by David Korth.                                 *
+ * Copyright (c) 2016-2022 by David Korth.                                 *
  * Copyright (c) 2016-2018 by Egor.                                        *
  * SPDX-License-Identifier: GPL-2.0-or-later                               *
  ***************************************************************************/
@@ -115,6 +115,21 @@ class klass final : public LibRpTexture::FileFormat { \
 		 */ \
 		void close(void) final;
 
+/**
+ * FileFormat subclass function declaration for selecting an image by size.
+ * Only needed if the subclass has a better image source than mipmaps,
+ * e.g. an embedded low-resolution image.
+ */
+#define FILEFORMAT_DECL_IMAGEFORSIZE() \
+	public: \
+		/** \
+		 * Get the smallest image that is at least as large as the requested size. \
+		 * @param reqSize	[in] Requested size. (<= 0 for the full image) \
+		 * @param allowLowRes	[in] If true, allow an embedded low-resolution image. \
+		 * @return Image, or nullptr on error. \
+		 */ \
+		const LibRpTexture::rp_image *imageForSize(int reqSize, bool allowLowRes) const final;
+
 /**
  * End of FileFormat subclass declaration.
  */
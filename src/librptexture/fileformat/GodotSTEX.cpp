@@ -502,8 +502,11 @@ const rp_image *GodotSTEXPrivate::loadImage(int mip)
 	}
 
 	// Decode the image.
+	// Post-processing operations are collected in `ops`
+	// so they can be applied in a single pass.
 	// TODO: More formats.
 	rp_image *img = nullptr;
+	rp_image::PixelOps ops;
 	switch (pixelFormat) {
 		default:
 			break;
@@ -638,8 +641,8 @@ const rp_image *GodotSTEXPrivate::loadImage(int mip)
 			img = ImageDecoder::fromETC1(
 				mdata.width, mdata.height,
 				buf.get(), mdata.size);
-			if (img && stexVersion == 4) {
-				img->swapRB();
+			if (stexVersion == 4) {
+				ops.swapRB();
 			}
 			break;
 		case STEX_FORMAT_ETC2_RGB8:
@@ -648,24 +651,24 @@ const rp_image *GodotSTEXPrivate::loadImage(int mip)
 			img = ImageDecoder::fromETC2_RGB(
 				mdata.width, mdata.height,
 				buf.get(), mdata.size);
-			if (img && stexVersion == 4) {
-				img->swapRB();
+			if (stexVersion == 4) {
+				ops.swapRB();
 			}
 			break;
 		case STEX_FORMAT_ETC2_RGBA8:
 			img = ImageDecoder::fromETC2_RGBA(
 				mdata.width, mdata.height,
 				buf.get(), mdata.size);
-			if (img && stexVersion == 4) {
-				img->swapRB();
+			if (stexVersion == 4) {
+				ops.swapRB();
 			}
 			break;
 		case STEX_FORMAT_ETC2_RGB8A1:
 			img = ImageDecoder::fromETC2_RGB_A1(
 				mdata.width, mdata.height,
 				buf.get(), mdata.size);
-			if (img && stexVersion == 4) {
-				img->swapRB();
+			if (stexVersion == 4) {
+				ops.swapRB();
 			}
 			break;
 
@@ -699,6 +702,11 @@ const rp_image *GodotSTEXPrivate::loadImage(int mip)
 #endif /* ENABLE_ASTC */
 	}
 
+	// Post-processing.
+	if (img && ops.count > 0) {
+		img->process(ops);
+	}
+
 	// Image rescaling is handled by the UI frontend.
 	mipmaps[mip] = img;
 	return img;
@@ -71,8 +71,9 @@ class KhronosKTXPrivate final : public FileFormatPrivate
 		// Texture data start address.
 		unsigned int texDataStartAddr;
 
-		// Decoded image.
-		rp_image *img;
+		// Decoded mipmaps.
+		// Mipmap 0 is the full image.
+		vector<rp_image*> mipmaps;
 
 		// Invalid pixel format message.
 		char invalid_pixel_format[24];
@@ -85,9 +86,10 @@ class KhronosKTXPrivate final : public FileFormatPrivate
 
 		/**
 		 * Load the image.
+		 * @param mip Mipmap number. (0 == full image)
 		 * @return Image, or nullptr on error.
 		 */
-		const rp_image *loadImage(void);
+		const rp_image *loadImage(int mip);
 
 		/**
 		 * Load key/value data.
@@ -120,7 +122,6 @@ KhronosKTXPrivate::KhronosKTXPrivate(KhronosKTX *q, IRpFile *file)
 	, isByteswapNeeded(false)
 	, flipOp(rp_image::FLIP_V)
 	, texDataStartAddr(0)
-	, img(nullptr)
 {
 	// Clear the KTX header struct.
 	memset(&ktxHeader, 0, sizeof(ktxHeader));
@@ -129,18 +130,37 @@ KhronosKTXPrivate::KhronosKTXPrivate(KhronosKTX *q, IRpFile *file)
 
 KhronosKTXPrivate::~KhronosKTXPrivate()
 {
-	UNREF(img);
+	for (rp_image *img : mipmaps) {
+		UNREF(img);
+	}
 }
 
 /**
  * Load the image.
+ * @param mip Mipmap number. (0 == full image)
  * @return Image, or nullptr on error.
  */
-const rp_image *KhronosKTXPrivate::loadImage(void)
+const rp_image *KhronosKTXPrivate::loadImage(int mip)
 {
-	if (img) {
+	int mipmapCount = static_cast<int>(ktxHeader.numberOfMipmapLevels);
+	if (mipmapCount <= 0) {
+		// No mipmaps == one image.
+		mipmapCount = 1;
+	}
+
+	assert(mip >= 0);
+	assert(mip < mipmapCount);
+	if (mip < 0 || mip >= mipmapCount) {
+		// Invalid mipmap number.
+		return nullptr;
+	}
+
+	if (mipmaps.empty()) {
+		mipmaps.resize(mipmapCount);
+	}
+	if (mipmaps[mip] != nullptr) {
 		// Image has already been loaded.
-		return img;
+		return mipmaps[mip];
 	} else if (!this->file || !this->isValid) {
 		// Can't load the image.
 		return nullptr;
@@ -171,20 +191,56 @@ const rp_image *KhronosKTXPrivate::loadImage(void)
 	}
 	const uint32_t file_sz = static_cast<uint32_t>(file->size());
 
-	// Seek to the start of the texture data.
-	int ret = file->seek(texDataStartAddr);
+	// Handle a 1D texture as a "width x 1" 2D texture.
+	// NOTE: Handling a 3D texture as a single 2D texture.
+	int width = static_cast<int>(ktxHeader.pixelWidth);
+	int height = (ktxHeader.pixelHeight > 0 ? static_cast<int>(ktxHeader.pixelHeight) : 1);
+
+	// Find the requested mipmap.
+	// Each mipmap level is stored as a uint32_t imageSize field,
+	// followed by the image data, padded to 4 bytes.
+	// NOTE: For non-array cubemaps, imageSize is the size of a
+	// single face, and each face is padded to 4 bytes.
+	const bool isNonArrayCubemap = (ktxHeader.numberOfArrayElements == 0 &&
+	                                ktxHeader.numberOfFaces == 6);
+	uint32_t addr = texDataStartAddr;
+	for (int i = 0; i < mip; i++) {
+		uint32_t levelSize;
+		size_t size = file->seekAndRead(addr, &levelSize, sizeof(levelSize));
+		if (size != sizeof(levelSize)) {
+			// Seek and/or read error.
+			return nullptr;
+		}
+		if (isByteswapNeeded) {
+			levelSize = __swab32(levelSize);
+		}
+		if (levelSize > file_sz) {
+			// Level is larger than the file.
+			return nullptr;
+		}
+		levelSize = ALIGN_BYTES(4, levelSize);
+		if (isNonArrayCubemap) {
+			levelSize *= 6;
+		}
+
+		addr += sizeof(levelSize);
+		if (addr > file_sz || levelSize > file_sz - addr) {
+			// Level extends past the end of the file.
+			return nullptr;
+		}
+		addr += levelSize;
+
+		width = std::max(width / 2, 1);
+		height = std::max(height / 2, 1);
+	}
+
+	// Seek to the start of the mipmap data.
+	int ret = file->seek(addr);
 	if (ret != 0) {
 		// Seek error.
 		return nullptr;
 	}
 
-	// NOTE: Mipmaps are stored *after* the main image.
-	// Hence, no mipmap processing is necessary.
-
-	// Handle a 1D texture as a "width x 1" 2D texture.
-	// NOTE: Handling a 3D texture as a single 2D texture.
-	const int height = (ktxHeader.pixelHeight > 0 ? ktxHeader.pixelHeight : 1);
-
 	// Calculate the expected size.
 	// NOTE: Scanlines are 4-byte aligned.
 	uint32_t expected_size;
@@ -192,26 +248,26 @@ const rp_image *KhronosKTXPrivate::loadImage(void)
 	switch (ktxHeader.glFormat) {
 		case GL_RGB:
 			// 24-bit RGB.
-			stride = ALIGN_BYTES(4, ktxHeader.pixelWidth * 3);
+			stride = ALIGN_BYTES(4, width * 3);
 			expected_size = static_cast<unsigned int>(stride * height);
 			break;
 
 		case GL_RGBA:
 			// 32-bit RGBA.
-			stride = ktxHeader.pixelWidth * 4;
+			stride = width * 4;
 			expected_size = static_cast<unsigned int>(stride * height);
 			break;
 
 		case GL_LUMINANCE:
 			// 8-bit luminance.
-			stride = ALIGN_BYTES(4, ktxHeader.pixelWidth);
+			stride = ALIGN_BYTES(4, width);
 			expected_size = static_cast<unsigned int>(stride * height);
 			break;
 
 		case GL_RGB9_E5:
 			// Uncompressed "special" 32bpp formats.
 			// TODO: Does KTX handle GL_RGB9_E5 as compressed?
-			stride = ktxHeader.pixelWidth * 4;
+			stride = width * 4;
 			expected_size = static_cast<unsigned int>(stride * height);
 			break;
 
@@ -226,17 +282,17 @@ const rp_image *KhronosKTXPrivate::loadImage(void)
 					// 32 pixels compressed into 64 bits. (2bpp)
 					// NOTE: Image dimensions must be a power of 2 for PVRTC-I.
 					expected_size = ImageSizeCalc::calcImageSizePVRTC_PoT<true>(
-						ktxHeader.pixelWidth, height);
+						width, height);
 					break;
 
 				case GL_COMPRESSED_RGBA_PVRTC_2BPPV2_IMG:
 					// 32 pixels compressed into 64 bits. (2bpp)
 					// NOTE: Width and height must be rounded to the nearest tile. (8x4)
 					// FIXME: Our PVRTC-II decoder requires power-of-2 textures right now.
-					//expected_size = ALIGN_BYTES(8, ktxHeader.pixelWidth) *
+					//expected_size = ALIGN_BYTES(8, width) *
 					//                ALIGN_BYTES(4, (int)height) / 4;
 					expected_size = ImageSizeCalc::calcImageSizePVRTC_PoT<true>
-						(ktxHeader.pixelWidth, height);
+						(width, height);
 					break;
 
 				case GL_COMPRESSED_RGB_PVRTC_4BPPV1_IMG:
@@ -244,17 +300,17 @@ const rp_image *KhronosKTXPrivate::loadImage(void)
 					// 16 pixels compressed into 64 bits. (4bpp)
 					// NOTE: Image dimensions must be a power of 2 for PVRTC-I.
 					expected_size = ImageSizeCalc::calcImageSizePVRTC_PoT<false>(
-						ktxHeader.pixelWidth, height);
+						width, height);
 					break;
 
 				case GL_COMPRESSED_RGBA_PVRTC_4BPPV2_IMG:
 					// 16 pixels compressed into 64 bits. (4bpp)
 					// NOTE: Width and height must be rounded to the nearest tile. (4x4)
 					// FIXME: Our PVRTC-II decoder requires power-of-2 textures right now.
-					//expected_size = ALIGN_BYTES(4, ktxHeader.pixelWidth) *
+					//expected_size = ALIGN_BYTES(4, width) *
 					//                ALIGN_BYTES(4, (int)height) / 2;
 					expected_size = ImageSizeCalc::calcImageSizePVRTC_PoT<false>
-						(ktxHeader.pixelWidth, height);
+						(width, height);
 					break;
 #endif /* ENABLE_PVRTC */
 
@@ -275,7 +331,7 @@ const rp_image *KhronosKTXPrivate::loadImage(void)
 				case GL_COMPRESSED_SIGNED_LUMINANCE_LATC1_EXT:
 					// 16 pixels compressed into 64 bits. (4bpp)
 					// NOTE: Width and height must be rounded to the nearest tile. (4x4)
-					expected_size = ALIGN_BYTES(4, ktxHeader.pixelWidth) *
+					expected_size = ALIGN_BYTES(4, width) *
 					                ALIGN_BYTES(4, (int)height) / 2;
 					break;
 
@@ -297,86 +353,86 @@ const rp_image *KhronosKTXPrivate::loadImage(void)
 				case GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM:
 					// 16 pixels compressed into 128 bits. (8bpp)
 					// NOTE: Width and height must be rounded to the nearest tile. (4x4)
-					expected_size = ALIGN_BYTES(4, ktxHeader.pixelWidth) *
+					expected_size = ALIGN_BYTES(4, width) *
 					                ALIGN_BYTES(4, (int)height);
 					break;
 
 				case GL_RGB9_E5:
 					// Uncompressed "special" 32bpp formats.
 					// TODO: Does KTX handle GL_RGB9_E5 as compressed?
-					expected_size = ktxHeader.pixelWidth * height * 4;
+					expected_size = width * height * 4;
 					break;
 
 #ifdef ENABLE_ASTC
 				case GL_COMPRESSED_RGBA_ASTC_4x4_KHR:
 				case GL_COMPRESSED_SRGB8_ALPHA8_ASTC_4x4_KHR:
 					expected_size = ImageSizeCalc::calcImageSizeASTC(
-						ktxHeader.pixelWidth, height, 4, 4);
+						width, height, 4, 4);
 					break;
 				case GL_COMPRESSED_RGBA_ASTC_5x4_KHR:
 				case GL_COMPRESSED_SRGB8_ALPHA8_ASTC_5x4_KHR:
 					expected_size = ImageSizeCalc::calcImageSizeASTC(
-						ktxHeader.pixelWidth, height, 5, 4);
+						width, height, 5, 4);
 					break;
 				case GL_COMPRESSED_RGBA_ASTC_5x5_KHR:
 				case GL_COMPRESSED_SRGB8_ALPHA8_ASTC_5x5_KHR:
 					expected_size = ImageSizeCalc::calcImageSizeASTC(
-						ktxHeader.pixelWidth, height, 5, 5);
+						width, height, 5, 5);
 					break;
 				case GL_COMPRESSED_RGBA_ASTC_6x5_KHR:
 				case GL_COMPRESSED_SRGB8_ALPHA8_ASTC_6x5_KHR:
 					expected_size = ImageSizeCalc::calcImageSizeASTC(
-						ktxHeader.pixelWidth, height, 6, 5);
+						width, height, 6, 5);
 					break;
 				case GL_COMPRESSED_RGBA_ASTC_6x6_KHR:
 				case GL_COMPRESSED_SRGB8_ALPHA8_ASTC_6x6_KHR:
 					expected_size = ImageSizeCalc::calcImageSizeASTC(
-						ktxHeader.pixelWidth, height, 6, 6);
+						width, height, 6, 6);
 					break;
 				case GL_COMPRESSED_RGBA_ASTC_8x5_KHR:
 				case GL_COMPRESSED_SRGB8_ALPHA8_ASTC_8x5_KHR:
 					expected_size = ImageSizeCalc::calcImageSizeASTC(
-						ktxHeader.pixelWidth, height, 8, 5);
+						width, height, 8, 5);
 					break;
 				case GL_COMPRESSED_RGBA_ASTC_8x6_KHR:
 				case GL_COMPRESSED_SRGB8_ALPHA8_ASTC_8x6_KHR:
 					expected_size = ImageSizeCalc::calcImageSizeASTC(
-						ktxHeader.pixelWidth, height, 8, 6);
+						width, height, 8, 6);
 					break;
 				case GL_COMPRESSED_RGBA_ASTC_8x8_KHR:
 				case GL_COMPRESSED_SRGB8_ALPHA8_ASTC_8x8_KHR:
 					expected_size = ImageSizeCalc::calcImageSizeASTC(
-						ktxHeader.pixelWidth, height, 8, 8);
+						width, height, 8, 8);
 					break;
 				case GL_COMPRESSED_RGBA_ASTC_10x5_KHR:
 				case GL_COMPRESSED_SRGB8_ALPHA8_ASTC_10x5_KHR:
 					expected_size = ImageSizeCalc::calcImageSizeASTC(
-						ktxHeader.pixelWidth, height, 10, 5);
+						width, height, 10, 5);
 					break;
 				case GL_COMPRESSED_RGBA_ASTC_10x6_KHR:
 				case GL_COMPRESSED_SRGB8_ALPHA8_ASTC_10x6_KHR:
 					expected_size = ImageSizeCalc::calcImageSizeASTC(
-						ktxHeader.pixelWidth, height, 10, 6);
+						width, height, 10, 6);
 					break;
 				case GL_COMPRESSED_RGBA_ASTC_10x8_KHR:
 				case GL_COMPRESSED_SRGB8_ALPHA8_ASTC_10x8_KHR:
 					expected_size = ImageSizeCalc::calcImageSizeASTC(
-						ktxHeader.pixelWidth, height, 10, 8);
+						width, height, 10, 8);
 					break;
 				case GL_COMPRESSED_RGBA_ASTC_10x10_KHR:
 				case GL_COMPRESSED_SRGB8_ALPHA8_ASTC_10x10_KHR:
 					expected_size = ImageSizeCalc::calcImageSizeASTC(
-						ktxHeader.pixelWidth, height, 10, 10);
+						width, height, 10, 10);
 					break;
 				case GL_COMPRESSED_RGBA_ASTC_12x10_KHR:
 				case GL_COMPRESSED_SRGB8_ALPHA8_ASTC_12x10_KHR:
 					expected_size = ImageSizeCalc::calcImageSizeASTC(
-						ktxHeader.pixelWidth, height, 12, 10);
+						width, height, 12, 10);
 					break;
 				case GL_COMPRESSED_RGBA_ASTC_12x12_KHR:
 				case GL_COMPRESSED_SRGB8_ALPHA8_ASTC_12x12_KHR:
 					expected_size = ImageSizeCalc::calcImageSizeASTC(
-						ktxHeader.pixelWidth, height, 12, 12);
+						width, height, 12, 12);
 					break;
 #endif /* ENABLE_ASTC */
 
@@ -388,7 +444,7 @@ const rp_image *KhronosKTXPrivate::loadImage(void)
 	}
 
 	// Verify file size.
-	if (texDataStartAddr + expected_size > file_sz) {
+	if (addr + sizeof(uint32_t) + expected_size > file_sz) {
 		// File is too small.
 		return nullptr;
 	}
@@ -426,6 +482,8 @@ const rp_image *KhronosKTXPrivate::loadImage(void)
 		return nullptr;
 	}
 
+	rp_image *img;
+
 	// TODO: Byteswapping.
 	// TODO: Handle variants. Check for channel sizes in glInternalFormat?
 	// TODO: Handle sRGB post-processing? (for e.g. GL_SRGB8)
@@ -434,7 +492,7 @@ const rp_image *KhronosKTXPrivate::loadImage(void)
 			// 24-bit RGB.
 			img = ImageDecoder::fromLinear24(
 				ImageDecoder::PixelFormat::BGR888,
-				ktxHeader.pixelWidth, height,
+				width, height,
 				buf.get(), expected_size, stride);
 			break;
 
@@ -442,7 +500,7 @@ const rp_image *KhronosKTXPrivate::loadImage(void)
 			// 32-bit RGBA.
 			img = ImageDecoder::fromLinear32(
 				ImageDecoder::PixelFormat::ABGR8888,
-				ktxHeader.pixelWidth, height,
+				width, height,
 				reinterpret_cast<const uint32_t*>(buf.get()), expected_size, stride);
 			break;
 
@@ -450,7 +508,7 @@ const rp_image *KhronosKTXPrivate::loadImage(void)
 			// 8-bit Luminance.
 			img = ImageDecoder::fromLinear8(
 				ImageDecoder::PixelFormat::L8,
-				ktxHeader.pixelWidth, height,
+				width, height,
 				buf.get(), expected_size, stride);
 			break;
 
@@ -459,7 +517,7 @@ const rp_image *KhronosKTXPrivate::loadImage(void)
 			// TODO: Does KTX handle GL_RGB9_E5 as compressed?
 			img = ImageDecoder::fromLinear32(
 				ImageDecoder::PixelFormat::RGB9_E5,
-				ktxHeader.pixelWidth, height,
+				width, height,
 				reinterpret_cast<const uint32_t*>(buf.get()), expected_size, stride);
 			break;
 
@@ -473,21 +531,21 @@ const rp_image *KhronosKTXPrivate::loadImage(void)
 				case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
 					// DXT1-compressed texture.
 					img = ImageDecoder::fromDXT1(
-						ktxHeader.pixelWidth, height,
+						width, height,
 						buf.get(), expected_size);
 					break;
 
 				case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
 					// DXT1-compressed texture with 1-bit alpha.
 					img = ImageDecoder::fromDXT1_A1(
-						ktxHeader.pixelWidth, height,
+						width, height,
 						buf.get(), expected_size);
 					break;
 
 				case GL_COMPRESSED_RGBA_S3TC_DXT3_EXT:
 					// DXT3-compressed texture.
 					img = ImageDecoder::fromDXT3(
-						ktxHeader.pixelWidth, height,
+						width, height,
 						buf.get(), expected_size);
 					break;
 
@@ -496,14 +554,14 @@ const rp_image *KhronosKTXPrivate::loadImage(void)
 				case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
 					// DXT5-compressed texture.
 					img = ImageDecoder::fromDXT5(
-						ktxHeader.pixelWidth, height,
+						width, height,
 						buf.get(), expected_size);
 					break;
 
 				case GL_ETC1_RGB8_OES:
 					// ETC1-compressed texture.
 					img = ImageDecoder::fromETC1(
-						ktxHeader.pixelWidth, height,
+						width, height,
 						buf.get(), expected_size);
 					break;
 
@@ -512,7 +570,7 @@ const rp_image *KhronosKTXPrivate::loadImage(void)
 					// ETC2-compressed RGB texture.
 					// TODO: Handle sRGB.
 					img = ImageDecoder::fromETC2_RGB(
-						ktxHeader.pixelWidth, height,
+						width, height,
 						buf.get(), expected_size);
 					break;
 
@@ -522,7 +580,7 @@ const rp_image *KhronosKTXPrivate::loadImage(void)
 					// with punchthrough alpha.
 					// TODO: Handle sRGB.
 					img = ImageDecoder::fromETC2_RGB_A1(
-						ktxHeader.pixelWidth, height,
+						width, height,
 						buf.get(), expected_size);
 					break;
 
@@ -532,7 +590,7 @@ const rp_image *KhronosKTXPrivate::loadImage(void)
 					// with EAC-compressed alpha channel.
 					// TODO: Handle sRGB.
 					img = ImageDecoder::fromETC2_RGBA(
-						ktxHeader.pixelWidth, height,
+						width, height,
 						buf.get(), expected_size);
 					break;
 
@@ -541,7 +599,7 @@ const rp_image *KhronosKTXPrivate::loadImage(void)
 					// EAC-compressed R11 texture.
 					// TODO: Does the signed version get decoded differently?
 					img = ImageDecoder::fromEAC_R11(
-						ktxHeader.pixelWidth, height,
+						width, height,
 						buf.get(), expected_size);
 					break;
 
@@ -550,7 +608,7 @@ const rp_image *KhronosKTXPrivate::loadImage(void)
 					// EAC-compressed RG11 texture.
 					// TODO: Does the signed version get decoded differently?
 					img = ImageDecoder::fromEAC_RG11(
-						ktxHeader.pixelWidth, height,
+						width, height,
 						buf.get(), expected_size);
 					break;
 
@@ -559,7 +617,7 @@ const rp_image *KhronosKTXPrivate::loadImage(void)
 					// RGTC, one component. (BC4)
 					// TODO: Handle signed properly.
 					img = ImageDecoder::fromBC4(
-						ktxHeader.pixelWidth, height,
+						width, height,
 						buf.get(), expected_size);
 					break;
 
@@ -568,7 +626,7 @@ const rp_image *KhronosKTXPrivate::loadImage(void)
 					// RGTC, two components. (BC5)
 					// TODO: Handle signed properly.
 					img = ImageDecoder::fromBC5(
-						ktxHeader.pixelWidth, height,
+						width, height,
 						buf.get(), expected_size);
 					break;
 
@@ -577,7 +635,7 @@ const rp_image *KhronosKTXPrivate::loadImage(void)
 					// LATC, one component. (BC4)
 					// TODO: Handle signed properly.
 					img = ImageDecoder::fromBC4(
-						ktxHeader.pixelWidth, height,
+						width, height,
 						buf.get(), expected_size);
 					// TODO: If this fails, return it anyway or return nullptr?
 					ImageDecoder::fromRed8ToL8(img);
@@ -588,7 +646,7 @@ const rp_image *KhronosKTXPrivate::loadImage(void)
 					// LATC, two components. (BC5)
 					// TODO: Handle signed properly.
 					img = ImageDecoder::fromBC5(
-						ktxHeader.pixelWidth, height,
+						width, height,
 						buf.get(), expected_size);
 					// TODO: If this fails, return it anyway or return nullptr?
 					ImageDecoder::fromRG8ToLA8(img);
@@ -598,35 +656,35 @@ const rp_image *KhronosKTXPrivate::loadImage(void)
 				case GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM:
 					// BPTC-compressed RGBA texture. (BC7)
 					img = ImageDecoder::fromBC7(
-						ktxHeader.pixelWidth, height,
+						width, height,
 						buf.get(), expected_size);
 					break;
 
 #ifdef ENABLE_PVRTC
 				case GL_COMPRESSED_RGB_PVRTC_2BPPV1_IMG:
 					// PVRTC, 2bpp, no alpha.
-					img = ImageDecoder::fromPVRTC(ktxHeader.pixelWidth, height,
+					img = ImageDecoder::fromPVRTC(width, height,
 						buf.get(), expected_size,
 						ImageDecoder::PVRTC_2BPP | ImageDecoder::PVRTC_ALPHA_NONE);
 					break;
 
 				case GL_COMPRESSED_RGBA_PVRTC_2BPPV1_IMG:
 					// PVRTC, 2bpp, has alpha.
-					img = ImageDecoder::fromPVRTC(ktxHeader.pixelWidth, height,
+					img = ImageDecoder::fromPVRTC(width, height,
 						buf.get(), expected_size,
 						ImageDecoder::PVRTC_2BPP | ImageDecoder::PVRTC_ALPHA_YES);
 					break;
 
 				case GL_COMPRESSED_RGB_PVRTC_4BPPV1_IMG:
 					// PVRTC, 4bpp, no alpha.
-					img = ImageDecoder::fromPVRTC(ktxHeader.pixelWidth, height,
+					img = ImageDecoder::fromPVRTC(width, height,
 						buf.get(), expected_size,
 						ImageDecoder::PVRTC_4BPP | ImageDecoder::PVRTC_ALPHA_NONE);
 					break;
 
 				case GL_COMPRESSED_RGBA_PVRTC_4BPPV1_IMG:
 					// PVRTC, 4bpp, has alpha.
-					img = ImageDecoder::fromPVRTC(ktxHeader.pixelWidth, height,
+					img = ImageDecoder::fromPVRTC(width, height,
 						buf.get(), expected_size,
 						ImageDecoder::PVRTC_4BPP | ImageDecoder::PVRTC_ALPHA_YES);
 					break;
@@ -634,7 +692,7 @@ const rp_image *KhronosKTXPrivate::loadImage(void)
 				case GL_COMPRESSED_RGBA_PVRTC_2BPPV2_IMG:
 					// PVRTC-II, 2bpp.
 					// NOTE: Assuming this has alpha.
-					img = ImageDecoder::fromPVRTCII(ktxHeader.pixelWidth, height,
+					img = ImageDecoder::fromPVRTCII(width, height,
 						buf.get(), expected_size,
 						ImageDecoder::PVRTC_2BPP | ImageDecoder::PVRTC_ALPHA_YES);
 					break;
@@ -642,7 +700,7 @@ const rp_image *KhronosKTXPrivate::loadImage(void)
 				case GL_COMPRESSED_RGBA_PVRTC_4BPPV2_IMG:
 					// PVRTC-II, 4bpp.
 					// NOTE: Assuming this has alpha.
-					img = ImageDecoder::fromPVRTCII(ktxHeader.pixelWidth, height,
+					img = ImageDecoder::fromPVRTCII(width, height,
 						buf.get(), expected_size,
 						ImageDecoder::PVRTC_4BPP | ImageDecoder::PVRTC_ALPHA_YES);
 					break;
@@ -653,7 +711,7 @@ const rp_image *KhronosKTXPrivate::loadImage(void)
 					// TODO: Does KTX handle GL_RGB9_E5 as compressed?
 					img = ImageDecoder::fromLinear32(
 						ImageDecoder::PixelFormat::RGB9_E5,
-						ktxHeader.pixelWidth, height,
+						width, height,
 						reinterpret_cast<const uint32_t*>(buf.get()), expected_size);
 					break;
 
@@ -661,90 +719,91 @@ const rp_image *KhronosKTXPrivate::loadImage(void)
 				case GL_COMPRESSED_RGBA_ASTC_4x4_KHR:
 				case GL_COMPRESSED_SRGB8_ALPHA8_ASTC_4x4_KHR:
 					img = ImageDecoder::fromASTC(
-						ktxHeader.pixelWidth, height,
+						width, height,
 						buf.get(), expected_size, 4, 4);
 					break;
 				case GL_COMPRESSED_RGBA_ASTC_5x4_KHR:
 				case GL_COMPRESSED_SRGB8_ALPHA8_ASTC_5x4_KHR:
 					img = ImageDecoder::fromASTC(
-						ktxHeader.pixelWidth, height,
+						width, height,
 						buf.get(), expected_size, 5, 4);
 					break;
 				case GL_COMPRESSED_RGBA_ASTC_5x5_KHR:
 				case GL_COMPRESSED_SRGB8_ALPHA8_ASTC_5x5_KHR:
 					img = ImageDecoder::fromASTC(
-						ktxHeader.pixelWidth, height,
+						width, height,
 						buf.get(), expected_size, 5, 5);
 					break;
 				case GL_COMPRESSED_RGBA_ASTC_6x5_KHR:
 				case GL_COMPRESSED_SRGB8_ALPHA8_ASTC_6x5_KHR:
 					img = ImageDecoder::fromASTC(
-						ktxHeader.pixelWidth, height,
+						width, height,
 						buf.get(), expected_size, 6, 5);
 					break;
 				case GL_COMPRESSED_RGBA_ASTC_6x6_KHR:
 				case GL_COMPRESSED_SRGB8_ALPHA8_ASTC_6x6_KHR:
 					img = ImageDecoder::fromASTC(
-						ktxHeader.pixelWidth, height,
+						width, height,
 						buf.get(), expected_size, 6, 6);
 					break;
 				case GL_COMPRESSED_RGBA_ASTC_8x5_KHR:
 				case GL_COMPRESSED_SRGB8_ALPHA8_ASTC_8x5_KHR:
 					img = ImageDecoder::fromASTC(
-						ktxHeader.pixelWidth, height,
+						width, height,
 						buf.get(), expected_size, 8, 5);
 					break;
 				case GL_COMPRESSED_RGBA_ASTC_8x6_KHR:
 				case GL_COMPRESSED_SRGB8_ALPHA8_ASTC_8x6_KHR:
 					img = ImageDecoder::fromASTC(
-						ktxHeader.pixelWidth, height,
+						width, height,
 						buf.get(), expected_size, 8, 6);
 					break;
 				case GL_COMPRESSED_RGBA_ASTC_8x8_KHR:
 				case GL_COMPRESSED_SRGB8_ALPHA8_ASTC_8x8_KHR:
 					img = ImageDecoder::fromASTC(
-						ktxHeader.pixelWidth, height,
+						width, height,
 						buf.get(), expected_size, 8, 8);
 					break;
 				case GL_COMPRESSED_RGBA_ASTC_10x5_KHR:
 				case GL_COMPRESSED_SRGB8_ALPHA8_ASTC_10x5_KHR:
 					img = ImageDecoder::fromASTC(
-						ktxHeader.pixelWidth, height,
+						width, height,
 						buf.get(), expected_size, 10, 5);
 					break;
 				case GL_COMPRESSED_RGBA_ASTC_10x6_KHR:
 				case GL_COMPRESSED_SRGB8_ALPHA8_ASTC_10x6_KHR:
 					img = ImageDecoder::fromASTC(
-						ktxHeader.pixelWidth, height,
+						width, height,
 						buf.get(), expected_size, 10, 6);
 					break;
 				case GL_COMPRESSED_RGBA_ASTC_10x8_KHR:
 				case GL_COMPRESSED_SRGB8_ALPHA8_ASTC_10x8_KHR:
 					img = ImageDecoder::fromASTC(
-						ktxHeader.pixelWidth, height,
+						width, height,
 						buf.get(), expected_size, 10, 8);
 					break;
 				case GL_COMPRESSED_RGBA_ASTC_10x10_KHR:
 				case GL_COMPRESSED_SRGB8_ALPHA8_ASTC_10x10_KHR:
 					img = ImageDecoder::fromASTC(
-						ktxHeader.pixelWidth, height,
+						width, height,
 						buf.get(), expected_size, 10, 10);
 					break;
 				case GL_COMPRESSED_RGBA_ASTC_12x10_KHR:
 				case GL_COMPRESSED_SRGB8_ALPHA8_ASTC_12x10_KHR:
 					img = ImageDecoder::fromASTC(
-						ktxHeader.pixelWidth, height,
+						width, height,
 						buf.get(), expected_size, 12, 10);
 					break;
 				case GL_COMPRESSED_RGBA_ASTC_12x12_KHR:
 				case GL_COMPRESSED_SRGB8_ALPHA8_ASTC_12x12_KHR:
 					img = ImageDecoder::fromASTC(
-						ktxHeader.pixelWidth, height,
+						width, height,
 						buf.get(), expected_size, 12, 12);
 					break;
 #endif /* ENABLE_ASTC */
 				default:
 					// Not supported.
+					img = nullptr;
 					break;
 			}
 			break;
@@ -752,13 +811,11 @@ const rp_image *KhronosKTXPrivate::loadImage(void)
 
 	// Post-processing: Check if a flip is needed.
 	if (img && flipOp != rp_image::FLIP_NONE) {
-		rp_image *const flipimg = img->flip(flipOp);
-		if (flipimg) {
-			img->unref();
-			img = flipimg;
-		}
+		// NOTE: Flipping in place to avoid allocating a second image.
+		img->process(rp_image::PixelOps().flip(flipOp));
 	}
 
+	mipmaps[mip] = img;
 	return img;
 }
 
@@ -1204,11 +1261,7 @@ const rp_image *KhronosKTX::mipmap(int mip) const
 		return nullptr;
 	}
 
-	// FIXME: Support decoding mipmaps.
-	if (mip == 0) {
-		return const_cast<KhronosKTXPrivate*>(d)->loadImage();
-	}
-	return nullptr;
+	return const_cast<KhronosKTXPrivate*>(d)->loadImage(mip);
 }
 
 }
@@ -695,11 +695,8 @@ const rp_image *KhronosKTX2Private::loadImage(int mip)
 	// Post-processing: Check if a flip is needed.
 	if (img && flipOp != rp_image::FLIP_NONE) {
 		// TODO: Assert that img dimensions match ktx2Header?
-		rp_image *const flipimg = img->flip(flipOp);
-		if (flipimg) {
-			img->unref();
-			img = flipimg;
-		}
+		// NOTE: Flipping in place to avoid allocating a second image.
+		img->process(rp_image::PixelOps().flip(flipOp));
 	}
 
 	mipmaps[mip] = img;
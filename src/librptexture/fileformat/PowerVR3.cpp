@@ -513,7 +513,10 @@ const rp_image *PowerVR3Private::loadImage(int mip)
 	}
 
 	// Decode the image.
+	// Post-processing operations are collected in `ops`
+	// so they can be applied in a single pass.
 	rp_image *img = nullptr;
+	rp_image::PixelOps ops;
 	if (pvr3Header.channel_depth != 0) {
 		// Uncompressed format.
 		assert(fmtLkup != nullptr);
@@ -642,7 +645,9 @@ const rp_image *PowerVR3Private::loadImage(int mip)
 
 			case PVR3_PXF_DXT2:
 				// DXT2-compressed texture.
-				img = ImageDecoder::fromDXT2(width, height, buf.get(), expected_size);
+				// Decoded as DXT3; un-premultiplied during post-processing.
+				img = ImageDecoder::fromDXT3(width, height, buf.get(), expected_size);
+				ops.un_premultiply();
 				break;
 
 			case PVR3_PXF_DXT3:
@@ -652,7 +657,9 @@ const rp_image *PowerVR3Private::loadImage(int mip)
 
 			case PVR3_PXF_DXT4:
 				// DXT4-compressed texture.
-				img = ImageDecoder::fromDXT4(width, height, buf.get(), expected_size);
+				// Decoded as DXT5; un-premultiplied during post-processing.
+				img = ImageDecoder::fromDXT5(width, height, buf.get(), expected_size);
+				ops.un_premultiply();
 				break;
 
 			case PVR3_PXF_DXT5:
@@ -739,13 +746,11 @@ const rp_image *PowerVR3Private::loadImage(int mip)
 	// TODO: Handle sRGB.
 	// TODO: Handle premultiplied alpha, aside from DXT2 and DXT4.
 
-	// Post-processing: Check if a flip is needed.
-	if (img && flipOp != rp_image::FLIP_NONE) {
-		rp_image *const flipimg = img->flip(flipOp);
-		if (flipimg) {
-			img->unref();
-			img = flipimg;
-		}
+	// Post-processing: Un-premultiply and/or flip in a single pass.
+	ops.flip(flipOp);
+	if (img && (ops.count > 0 || ops.flipOp != rp_image::FLIP_NONE)) {
+		// NOTE: Processing in place to avoid allocating a second image.
+		img->process(ops);
 	}
 
 	mipmaps[mip] = img;
@@ -125,6 +125,30 @@ class SegaPVRPrivate final : public FileFormatPrivate
 		 * @return Unswizzled 16-bit SVR texture, or nullptr on error.
 		 */
 		static rp_image *svr_unswizzle_16(const rp_image *img_swz);
+
+		/**
+		 * Generate the source offset tables for SVR unswizzling.
+		 *
+		 * The swizzle pattern only depends on the row parity and on
+		 * whether the row is in an odd 4-row group, so four tables
+		 * of source offsets (relative to the start of the row pair)
+		 * cover the entire texture.
+		 *
+		 * @param width Texture width. (must be a multiple of 8)
+		 * @return Source offset tables: [((y / 4) & 1) << 1 | (y & 1)][x]
+		 */
+		static unique_ptr<unsigned int[]> svr_unswizzle_tables(int width);
+
+		/**
+		 * Unswizzle an SVR texture using precomputed source offset tables.
+		 * @tparam pixel Pixel type.
+		 * @param img		[out] Unswizzled texture.
+		 * @param img_swz	[in] Swizzled texture.
+		 * @param tbls		[in] Source offset tables from svr_unswizzle_tables().
+		 */
+		template<typename pixel>
+		static void T_svr_unswizzle(rp_image *img, const rp_image *img_swz,
+			const unsigned int *tbls);
 };
 
 FILEFORMAT_IMPL(SegaPVR)
@@ -1011,13 +1035,6 @@ rp_image *SegaPVRPrivate::svr_unswizzle_4or8(const rp_image *img_swz)
 	// Original Delphi version by Dageron:
 	// - https://gta.nick7.com/ps2/swizzling/unswizzle_delphi.txt
 
-	static const uint8_t interlaceMatrix[] = {
-		0x00, 0x10, 0x02, 0x12,
-		0x11, 0x01, 0x13, 0x03,
-	};
-	static const int8_t matrix[] = {0, 1, -1, 0};
-	static const int8_t tileMatrix[] = {4, -4};
-
 	// Only CI8 formats are supported here.
 	assert(img_swz != nullptr);
 	assert(img_swz->isValid());
@@ -1031,10 +1048,11 @@ rp_image *SegaPVRPrivate::svr_unswizzle_4or8(const rp_image *img_swz)
 	const int width = img_swz->width();
 	const int height = img_swz->height();
 
-	// Texture dimensions must be a multiple of 4.
-	assert(width % 4 == 0);
+	// Texture width must be a multiple of 8,
+	// and texture height must be a multiple of 4.
+	assert(width % 8 == 0);
 	assert(height % 4 == 0);
-	if (width % 4 != 0 || height % 4 != 0) {
+	if (width % 8 != 0 || height % 4 != 0) {
 		// Unable to unswizzle this texture.
 		return nullptr;
 	}
@@ -1058,37 +1076,8 @@ rp_image *SegaPVRPrivate::svr_unswizzle_4or8(const rp_image *img_swz)
 	const unsigned int palette_len = std::min(img_swz->palette_len(), img->palette_len());
 	memcpy(img->palette(), img_swz->palette(), palette_len * sizeof(uint32_t));
 
-	const uint8_t *src_pixels = static_cast<const uint8_t*>(img_swz->bits());
-	for (int y = 0; y < height; y++) {
-		const bool oddRow = (y & 1);
-		const int num1 = (y / 4) & 1;
-		const int num3 = (y % 4);
-		const int yy = y + matrix[num3];
-
-		int num7 = y * width;
-		if (oddRow) {
-			num7 -= width;
-		}
-
-		uint8_t *const destLine = static_cast<uint8_t*>(img->scanLine(yy));
-		for (int x = 0; x < width; x++) {
-			const int num2 = (x / 4) & 1;
-
-			int num4 = ((x / 4) % 4);
-			if (oddRow) {
-				num4 += 4;
-			}
-
-			const int num5 = ((x * 4) % 16);
-			const int num6 = ((x / 16) * 32);
-
-			const int xx = x + num1 * tileMatrix[num2];
-
-			const int i = interlaceMatrix[num4] + num5 + num6 + num7;
-
-			destLine[xx] = src_pixels[i];
-		}
-	}
+	const unique_ptr<unsigned int[]> tbls = svr_unswizzle_tables(width);
+	T_svr_unswizzle<uint8_t>(img, img_swz, tbls.get());
 
 	return img;
 }
@@ -1113,13 +1102,6 @@ rp_image *SegaPVRPrivate::svr_unswizzle_16(const rp_image *img_swz)
 	// Original Delphi version by Dageron:
 	// - https://gta.nick7.com/ps2/swizzling/unswizzle_delphi.txt
 
-	static const uint8_t interlaceMatrix[] = {
-		0x00, 0x10, 0x02, 0x12,
-		0x11, 0x01, 0x13, 0x03,
-	};
-	static const int8_t matrix[] = {0, 1, -1, 0};
-	static const int8_t tileMatrix[] = {4, -4};
-
 	// Only ARGB32 formats are supported here.
 	assert(img_swz != nullptr);
 	assert(img_swz->isValid());
@@ -1133,10 +1115,11 @@ rp_image *SegaPVRPrivate::svr_unswizzle_16(const rp_image *img_swz)
 	const int width = img_swz->width();
 	const int height = img_swz->height();
 
-	// Texture dimensions must be a multiple of 4.
-	assert(width % 4 == 0);
+	// Texture width must be a multiple of 8,
+	// and texture height must be a multiple of 4.
+	assert(width % 8 == 0);
 	assert(height % 4 == 0);
-	if (width % 4 != 0 || height % 4 != 0) {
+	if (width % 8 != 0 || height % 4 != 0) {
 		// Unable to unswizzle this texture.
 		return nullptr;
 	}
@@ -1158,19 +1141,45 @@ rp_image *SegaPVRPrivate::svr_unswizzle_16(const rp_image *img_swz)
 		return nullptr;
 	}
 
-	const uint32_t *src_pixels = static_cast<const uint32_t*>(img_swz->bits());
-	for (int y = 0; y < height; y++) {
-		const bool oddRow = (y & 1);
-		const int num1 = (y / 4) & 1;
-		const int num3 = (y % 4);
-		const int yy = y + matrix[num3];
+	const unique_ptr<unsigned int[]> tbls = svr_unswizzle_tables(width);
+	T_svr_unswizzle<uint32_t>(img, img_swz, tbls.get());
 
-		int num7 = y * width;
-		if (oddRow) {
-			num7 -= width;
-		}
+	return img;
+}
+
+/**
+ * Generate the source offset tables for SVR unswizzling.
+ *
+ * The swizzle pattern only depends on the row parity and on
+ * whether the row is in an odd 4-row group, so four tables
+ * of source offsets (relative to the start of the row pair)
+ * cover the entire texture.
+ *
+ * @param width Texture width. (must be a multiple of 8)
+ * @return Source offset tables: [((y / 4) & 1) << 1 | (y & 1)][x]
+ */
+unique_ptr<unsigned int[]> SegaPVRPrivate::svr_unswizzle_tables(int width)
+{
+	// References:
+	// - https://forum.xentax.com/viewtopic.php?f=18&t=3516
+	// - https://gist.github.com/Fireboyd78/1546f5c86ebce52ce05e7837c697dc72
+
+	// Original Delphi version by Dageron:
+	// - https://gta.nick7.com/ps2/swizzling/unswizzle_delphi.txt
+
+	static const uint8_t interlaceMatrix[] = {
+		0x00, 0x10, 0x02, 0x12,
+		0x11, 0x01, 0x13, 0x03,
+	};
+	static const int8_t tileMatrix[] = {4, -4};
+
+	assert(width % 8 == 0);
+	unique_ptr<unsigned int[]> tbls(new unsigned int[width * 4]);
+	for (int k = 0; k < 4; k++) {
+		const bool oddRow = (k & 1);
+		const int num1 = (k >> 1);
+		unsigned int *const tbl = &tbls[k * width];
 
-		uint32_t *const destLine = static_cast<uint32_t*>(img->scanLine(yy));
 		for (int x = 0; x < width; x++) {
 			const int num2 = (x / 4) & 1;
 
@@ -1184,13 +1193,44 @@ rp_image *SegaPVRPrivate::svr_unswizzle_16(const rp_image *img_swz)
 
 			const int xx = x + num1 * tileMatrix[num2];
 
-			const int i = interlaceMatrix[num4] + num5 + num6 + num7;
-
-			destLine[xx] = src_pixels[i];
+			tbl[xx] = interlaceMatrix[num4] + num5 + num6;
 		}
 	}
 
-	return img;
+	return tbls;
+}
+
+/**
+ * Unswizzle an SVR texture using precomputed source offset tables.
+ * @tparam pixel Pixel type.
+ * @param img		[out] Unswizzled texture.
+ * @param img_swz	[in] Swizzled texture.
+ * @param tbls		[in] Source offset tables from svr_unswizzle_tables().
+ */
+template<typename pixel>
+void SegaPVRPrivate::T_svr_unswizzle(rp_image *img, const rp_image *img_swz,
+	const unsigned int *tbls)
+{
+	static const int8_t matrix[] = {0, 1, -1, 0};
+
+	const int width = img_swz->width();
+	const int height = img_swz->height();
+
+	const pixel *const src_pixels = static_cast<const pixel*>(img_swz->bits());
+	for (int y = 0; y < height; y++) {
+		const int oddRow = (y & 1);
+		const int num1 = (y / 4) & 1;
+		const int yy = y + matrix[y % 4];
+
+		// Source rows are interleaved in pairs.
+		const pixel *const srcRowPair = &src_pixels[(y - oddRow) * width];
+		const unsigned int *const tbl = &tbls[((num1 << 1) | oddRow) * width];
+
+		pixel *const destLine = static_cast<pixel*>(img->scanLine(yy));
+		for (int x = 0; x < width; x++) {
+			destLine[x] = srcRowPair[tbl[x]];
+		}
+	}
 }
 
 /** SegaPVR **/
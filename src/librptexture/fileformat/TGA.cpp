@@ -450,11 +450,8 @@ const rp_image *TGAPrivate::loadTGAImage(void)
 
 	// Post-processing: Check if a flip is needed.
 	if (imgtmp && flipOp != rp_image::FLIP_NONE) {
-		rp_image *const flipimg = imgtmp->flip(flipOp);
-		if (flipimg) {
-			imgtmp->unref();
-			imgtmp = flipimg;
-		}
+		// NOTE: Flipping in place to avoid allocating a second image.
+		imgtmp->process(rp_image::PixelOps().flip(flipOp));
 	}
 
 	img = imgtmp;
@@ -73,6 +73,9 @@ class ValveVTFPrivate final : public FileFormatPrivate
 		};
 		vector<mipmap_data_t> mipmap_data;
 
+		// Decoded low-resolution image.
+		rp_image *lowResImage;
+
 		// Invalid pixel format message.
 		char invalid_pixel_format[24];
 
@@ -97,6 +100,15 @@ class ValveVTFPrivate final : public FileFormatPrivate
 		 */
 		int getMipmapInfo(void);
 
+		/**
+		 * Decode VTF image data.
+		 * @param format	[in] VTF image format.
+		 * @param mdata		[in] Image size and layout.
+		 * @param buf		[in] Image data. (must be mdata.size bytes)
+		 * @return Image, or nullptr on error.
+		 */
+		static rp_image *decodeImage(int format, const mipmap_data_t &mdata, const uint8_t *buf);
+
 		/**
 		 * Load the image.
 		 * @param mip Mipmap number. (0 == full image)
@@ -104,6 +116,12 @@ class ValveVTFPrivate final : public FileFormatPrivate
 		 */
 		const rp_image *loadImage(int mip);
 
+		/**
+		 * Load the embedded low-resolution image.
+		 * @return Image, or nullptr on error.
+		 */
+		const rp_image *loadLowResImage(void);
+
 #if SYS_BYTEORDER == SYS_BIG_ENDIAN
 		/**
 		 * Byteswap a float. (TODO: Move to byteswap_rp.h?)
@@ -218,6 +236,7 @@ static_assert(ARRAY_SIZE(ValveVTFPrivate::img_format_tbl)-1 == VTF_IMAGE_FORMAT_
 ValveVTFPrivate::ValveVTFPrivate(ValveVTF *q, IRpFile *file)
 	: super(q, file, &textureInfo)
 	, texDataStartAddr(0)
+	, lowResImage(nullptr)
 {
 	// Clear the structs and arrays.
 	memset(&vtfHeader, 0, sizeof(vtfHeader));
@@ -229,6 +248,7 @@ ValveVTFPrivate::~ValveVTFPrivate()
 	for (rp_image *img : mipmaps) {
 		UNREF(img);
 	}
+	UNREF(lowResImage);
 }
 
 /**
@@ -388,7 +408,6 @@ int ValveVTFPrivate::getMipmapInfo(void)
  */
 const rp_image *ValveVTFPrivate::loadImage(int mip)
 {
-	// TODO: Option to load the low-res image instead?
 	int mipmapCount = vtfHeader.mipmapCount;
 	if (mipmapCount <= 0) {
 		// No mipmaps == one image.
@@ -465,12 +484,29 @@ const rp_image *ValveVTFPrivate::loadImage(int mip)
 	// since the width is smaller than 4.
 
 	// Decode the image.
+	rp_image *const img = decodeImage(vtfHeader.highResImageFormat, mdata, buf.get());
+	mipmaps[mip] = img;
+	return img;
+}
+
+/**
+ * Decode VTF image data.
+ * @param format	[in] VTF image format.
+ * @param mdata		[in] Image size and layout.
+ * @param buf		[in] Image data. (must be mdata.size bytes)
+ * @return Image, or nullptr on error.
+ */
+rp_image *ValveVTFPrivate::decodeImage(int format, const mipmap_data_t &mdata, const uint8_t *buf)
+{
 	// NOTE: VTF channel ordering does NOT match ImageDecoder channel ordering.
 	// (The channels appear to be backwards.)
 	// TODO: Lookup table to convert to PXF constants?
 	// TODO: Verify on big-endian?
+	// Post-processing operations are collected in `ops`
+	// so they can be applied in a single pass.
 	rp_image *img = nullptr;
-	switch (vtfHeader.highResImageFormat) {
+	rp_image::PixelOps ops;
+	switch (format) {
 		/* 32-bit */
 		case VTF_IMAGE_FORMAT_RGBA8888:
 		case VTF_IMAGE_FORMAT_UVWQ8888:	// handling as RGBA8888
@@ -478,14 +514,14 @@ const rp_image *ValveVTFPrivate::loadImage(int mip)
 			img = ImageDecoder::fromLinear32(
 				ImageDecoder::PixelFormat::ABGR8888,
 				mdata.width, mdata.height,
-				reinterpret_cast<const uint32_t*>(buf.get()), mdata.size,
+				reinterpret_cast<const uint32_t*>(buf), mdata.size,
 				mdata.row_width * sizeof(uint32_t));
 			break;
 		case VTF_IMAGE_FORMAT_ABGR8888:
 			img = ImageDecoder::fromLinear32(
 				ImageDecoder::PixelFormat::RGBA8888,
 				mdata.width, mdata.height,
-				reinterpret_cast<const uint32_t*>(buf.get()), mdata.size,
+				reinterpret_cast<const uint32_t*>(buf), mdata.size,
 				mdata.row_width * sizeof(uint32_t));
 			break;
 		case VTF_IMAGE_FORMAT_ARGB8888:
@@ -494,21 +530,21 @@ const rp_image *ValveVTFPrivate::loadImage(int mip)
 			img = ImageDecoder::fromLinear32(
 				ImageDecoder::PixelFormat::RABG8888,
 				mdata.width, mdata.height,
-				reinterpret_cast<const uint32_t*>(buf.get()), mdata.size,
+				reinterpret_cast<const uint32_t*>(buf), mdata.size,
 				mdata.row_width * sizeof(uint32_t));
 			break;
 		case VTF_IMAGE_FORMAT_BGRA8888:
 			img = ImageDecoder::fromLinear32(
 				ImageDecoder::PixelFormat::ARGB8888,
 				mdata.width, mdata.height,
-				reinterpret_cast<const uint32_t*>(buf.get()), mdata.size,
+				reinterpret_cast<const uint32_t*>(buf), mdata.size,
 				mdata.row_width * sizeof(uint32_t));
 			break;
 		case VTF_IMAGE_FORMAT_BGRx8888:
 			img = ImageDecoder::fromLinear32(
 				ImageDecoder::PixelFormat::xRGB8888,
 				mdata.width, mdata.height,
-				reinterpret_cast<const uint32_t*>(buf.get()), mdata.size,
+				reinterpret_cast<const uint32_t*>(buf), mdata.size,
 				mdata.row_width * sizeof(uint32_t));
 			break;
 
@@ -517,31 +553,31 @@ const rp_image *ValveVTFPrivate::loadImage(int mip)
 			img = ImageDecoder::fromLinear24(
 				ImageDecoder::PixelFormat::BGR888,
 				mdata.width, mdata.height,
-				buf.get(), mdata.size,
+				buf, mdata.size,
 				mdata.row_width * 3);
 			break;
 		case VTF_IMAGE_FORMAT_BGR888:
 			img = ImageDecoder::fromLinear24(
 				ImageDecoder::PixelFormat::RGB888,
 				mdata.width, mdata.height,
-				buf.get(), mdata.size,
+				buf, mdata.size,
 				mdata.row_width * 3);
 			break;
 		case VTF_IMAGE_FORMAT_RGB888_BLUESCREEN:
 			img = ImageDecoder::fromLinear24(
 				ImageDecoder::PixelFormat::BGR888,
 				mdata.width, mdata.height,
-				buf.get(), mdata.size,
+				buf, mdata.size,
 				mdata.row_width * 3);
-			img->apply_chroma_key(0xFF0000FF);
+			ops.apply_chroma_key(0xFF0000FF);
 			break;
 		case VTF_IMAGE_FORMAT_BGR888_BLUESCREEN:
 			img = ImageDecoder::fromLinear24(
 				ImageDecoder::PixelFormat::RGB888,
 				mdata.width, mdata.height,
-				buf.get(), mdata.size,
+				buf, mdata.size,
 				mdata.row_width * 3);
-			img->apply_chroma_key(0xFF0000FF);
+			ops.apply_chroma_key(0xFF0000FF);
 			break;
 
 		/* 16-bit */
@@ -549,35 +585,35 @@ const rp_image *ValveVTFPrivate::loadImage(int mip)
 			img = ImageDecoder::fromLinear16(
 				ImageDecoder::PixelFormat::BGR565,
 				mdata.width, mdata.height,
-				reinterpret_cast<const uint16_t*>(buf.get()), mdata.size,
+				reinterpret_cast<const uint16_t*>(buf), mdata.size,
 				mdata.row_width * sizeof(uint16_t));
 			break;
 		case VTF_IMAGE_FORMAT_BGR565:
 			img = ImageDecoder::fromLinear16(
 				ImageDecoder::PixelFormat::RGB565,
 				mdata.width, mdata.height,
-				reinterpret_cast<const uint16_t*>(buf.get()), mdata.size,
+				reinterpret_cast<const uint16_t*>(buf), mdata.size,
 				mdata.row_width * sizeof(uint16_t));
 			break;
 		case VTF_IMAGE_FORMAT_BGRx5551:
 			img = ImageDecoder::fromLinear16(
 				ImageDecoder::PixelFormat::RGB555,
 				mdata.width, mdata.height,
-				reinterpret_cast<const uint16_t*>(buf.get()), mdata.size,
+				reinterpret_cast<const uint16_t*>(buf), mdata.size,
 				mdata.row_width * sizeof(uint16_t));
 			break;
 		case VTF_IMAGE_FORMAT_BGRA4444:
 			img = ImageDecoder::fromLinear16(
 				ImageDecoder::PixelFormat::ARGB4444,
 				mdata.width, mdata.height,
-				reinterpret_cast<const uint16_t*>(buf.get()), mdata.size,
+				reinterpret_cast<const uint16_t*>(buf), mdata.size,
 				mdata.row_width * sizeof(uint16_t));
 			break;
 		case VTF_IMAGE_FORMAT_BGRA5551:
 			img = ImageDecoder::fromLinear16(
 				ImageDecoder::PixelFormat::ARGB1555,
 				mdata.width, mdata.height,
-				reinterpret_cast<const uint16_t*>(buf.get()), mdata.size,
+				reinterpret_cast<const uint16_t*>(buf), mdata.size,
 				mdata.row_width * sizeof(uint16_t));
 			break;
 		case VTF_IMAGE_FORMAT_IA88:
@@ -590,7 +626,7 @@ const rp_image *ValveVTFPrivate::loadImage(int mip)
 			img = ImageDecoder::fromLinear16(
 				ImageDecoder::PixelFormat::A8L8,
 				mdata.width, mdata.height,
-				reinterpret_cast<const uint16_t*>(buf.get()), mdata.size,
+				reinterpret_cast<const uint16_t*>(buf), mdata.size,
 				mdata.row_width * sizeof(uint16_t));
 			break;
 		case VTF_IMAGE_FORMAT_UV88:
@@ -598,7 +634,7 @@ const rp_image *ValveVTFPrivate::loadImage(int mip)
 			img = ImageDecoder::fromLinear16(
 				ImageDecoder::PixelFormat::GR88,
 				mdata.width, mdata.height,
-				reinterpret_cast<const uint16_t*>(buf.get()), mdata.size,
+				reinterpret_cast<const uint16_t*>(buf), mdata.size,
 				mdata.row_width * sizeof(uint16_t));
 			break;
 
@@ -610,14 +646,14 @@ const rp_image *ValveVTFPrivate::loadImage(int mip)
 			img = ImageDecoder::fromLinear8(
 				ImageDecoder::PixelFormat::L8,
 				mdata.width, mdata.height,
-				buf.get(), mdata.size,
+				buf, mdata.size,
 				mdata.row_width);
 			break;
 		case VTF_IMAGE_FORMAT_A8:
 			img = ImageDecoder::fromLinear8(
 				ImageDecoder::PixelFormat::A8,
 				mdata.width, mdata.height,
-				buf.get(), mdata.size,
+				buf, mdata.size,
 				mdata.row_width);
 			break;
 
@@ -625,22 +661,22 @@ const rp_image *ValveVTFPrivate::loadImage(int mip)
 		case VTF_IMAGE_FORMAT_DXT1:
 			img = ImageDecoder::fromDXT1(
 				mdata.width, mdata.height,
-				buf.get(), mdata.size);
+				buf, mdata.size);
 			break;
 		case VTF_IMAGE_FORMAT_DXT1_ONEBITALPHA:
 			img = ImageDecoder::fromDXT1_A1(
 				mdata.width, mdata.height,
-				buf.get(), mdata.size);
+				buf, mdata.size);
 			break;
 		case VTF_IMAGE_FORMAT_DXT3:
 			img = ImageDecoder::fromDXT3(
 				mdata.width, mdata.height,
-				buf.get(), mdata.size);
+				buf, mdata.size);
 			break;
 		case VTF_IMAGE_FORMAT_DXT5:
 			img = ImageDecoder::fromDXT5(
 				mdata.width, mdata.height,
-				buf.get(), mdata.size);
+				buf, mdata.size);
 			break;
 
 		case VTF_IMAGE_FORMAT_P8:
@@ -651,10 +687,67 @@ const rp_image *ValveVTFPrivate::loadImage(int mip)
 			break;
 	}
 
-	mipmaps[mip] = img;
+	// Post-processing.
+	if (img && ops.count > 0) {
+		img->process(ops);
+	}
+
 	return img;
 }
 
+/**
+ * Load the embedded low-resolution image.
+ * @return Image, or nullptr on error.
+ */
+const rp_image *ValveVTFPrivate::loadLowResImage(void)
+{
+	if (lowResImage) {
+		// Image has already been loaded.
+		return lowResImage;
+	} else if (!this->file || !this->isValid) {
+		// Can't load the image.
+		return nullptr;
+	} else if (vtfHeader.lowResImageFormat < 0 ||
+		   vtfHeader.lowResImageWidth == 0 || vtfHeader.lowResImageHeight == 0)
+	{
+		// No low-resolution image.
+		return nullptr;
+	}
+
+	if (file->size() > 128*1024*1024) {
+		// Sanity check: VTF files shouldn't be more than 128 MB.
+		return nullptr;
+	}
+	const uint32_t file_sz = static_cast<uint32_t>(file->size());
+
+	// The low-resolution image is stored immediately before the mipmaps.
+	mipmap_data_t mdata;
+	mdata.addr = texDataStartAddr;
+	mdata.width = vtfHeader.lowResImageWidth;
+	mdata.height = vtfHeader.lowResImageHeight;
+	mdata.row_width = vtfHeader.lowResImageWidth;
+	mdata.size = ImageSizeCalc::calcImageSize(
+		op_tbl, ARRAY_SIZE(op_tbl), vtfHeader.lowResImageFormat,
+		mdata.width, mdata.height);
+	if (mdata.size == 0 || mdata.addr < sizeof(vtfHeader) ||
+	    mdata.addr + mdata.size > file_sz)
+	{
+		// Invalid image size, or the file is too small.
+		return nullptr;
+	}
+
+	// Read the texture data.
+	auto buf = aligned_uptr<uint8_t>(16, mdata.size);
+	size_t size = file->seekAndRead(mdata.addr, buf.get(), mdata.size);
+	if (size != mdata.size) {
+		// Read error.
+		return nullptr;
+	}
+
+	lowResImage = decodeImage(vtfHeader.lowResImageFormat, mdata, buf.get());
+	return lowResImage;
+}
+
 /** ValveVTF **/
 
 /**
@@ -993,4 +1086,37 @@ const rp_image *ValveVTF::mipmap(int mip) const
 	return const_cast<ValveVTFPrivate*>(d)->loadImage(mip);
 }
 
+/**
+ * Get the smallest image that is at least as large as the requested size.
+ *
+ * If allowed by the caller, the embedded low-resolution image is
+ * used if it's large enough. This image is usually DXT1-compressed,
+ * so it may have lower quality than the equivalent mipmap.
+ *
+ * @param reqSize	[in] Requested size. (<= 0 for the full image)
+ * @param allowLowRes	[in] If true, allow an embedded low-resolution image.
+ * @return Image, or nullptr on error.
+ */
+const rp_image *ValveVTF::imageForSize(int reqSize, bool allowLowRes) const
+{
+	RP_D(const ValveVTF);
+	if (!d->isValid) {
+		// Unknown file type.
+		return nullptr;
+	}
+
+	if (allowLowRes && reqSize > 0 &&
+	    std::max(d->vtfHeader.lowResImageWidth, d->vtfHeader.lowResImageHeight) >= reqSize)
+	{
+		// The low-resolution image is large enough.
+		const rp_image *const img = const_cast<ValveVTFPrivate*>(d)->loadLowResImage();
+		if (img) {
+			return img;
+		}
+	}
+
+	// Use the default mipmap selection.
+	return super::imageForSize(reqSize, allowLowRes);
+}
+
 }
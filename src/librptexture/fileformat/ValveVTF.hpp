@@ -2,7 +2,7 @@
  * ROM Properties Page shell extension. (librptexture)                     *
  * ValveVTF.hpp: Valve VTF texture reader.                                 *
  *                                                                         *
- * Copyright (c) 2017-2019 by David Korth.                                 *
+ * Copyright (c) 2017-2022 by David Korth.                                 *
  * SPDX-License-Identifier: GPL-2.0-or-later                               *
  ***************************************************************************/
 
@@ -14,6 +14,7 @@
 namespace LibRpTexture {
 
 FILEFORMAT_DECL_BEGIN(ValveVTF)
+FILEFORMAT_DECL_IMAGEFORSIZE()
 FILEFORMAT_DECL_END()
 
 }
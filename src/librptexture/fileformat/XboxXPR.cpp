@@ -2,7 +2,7 @@
  * ROM Properties Page shell extension. (librptexture)                     *
  * XboxXPR.cpp: Microsoft Xbox XPR0 texture reader.                        *
  *                                                                         *
- * Copyright (c) 2019-2021 by David Korth.                                 *
+ * Copyright (c) 2019-2022 by David Korth.                                 *
  * SPDX-License-Identifier: GPL-2.0-or-later                               *
  ***************************************************************************/
 
@@ -83,64 +83,6 @@ class XboxXPRPrivate final : public FileFormatPrivate
 			unsigned int width, unsigned int height,
 			uint32_t *mask_x, uint32_t *mask_y);
 
-		/**
-		 * This fills a pattern with a value if your value has bits abcd and your
-		 * pattern is 11010100100 this will return: 0a0b0c00d00
-		 *
-		 * Based on Cxbx-Reloaded's unswizzling code:
-		 * https://github.com/Cxbx-Reloaded/Cxbx-Reloaded/blob/5d79c0b66e58bf38d39ea28cb4de954209d1e8ad/src/devices/video/swizzle.cpp
-		 * Original license: LGPLv2 (GPLv2 for contributions after 2012/01/13)
-		 *
-		 * @param pattern
-		 * @param value
-		 * @return
-		 */
-		static uint32_t fill_pattern(uint32_t pattern, uint32_t value);
-
-		/**
-		 * Get a swizzled texture offset.
-		 * Based on Cxbx-Reloaded's unswizzling code:
-		 * https://github.com/Cxbx-Reloaded/Cxbx-Reloaded/blob/5d79c0b66e58bf38d39ea28cb4de954209d1e8ad/src/devices/video/swizzle.cpp
-		 * Original license: LGPLv2 (GPLv2 for contributions after 2012/01/13)
-		 *
-		 * rom-properties modification: Removed depth, since we're only
-		 * handling 2D textures.
-		 *
-		 * @param x
-		 * @param y
-		 * @param mask_x
-		 * @param mask_y
-		 * @param bytes_per_pixel
-		 * @return
-		 */
-		static inline unsigned int get_swizzled_offset(
-			unsigned int x, unsigned int y,
-			uint32_t mask_x, uint32_t mask_y,
-			unsigned int bytes_per_pixel);
-
-		/**
-		 * Unswizzle an ARGB texture.
-		 * Based on Cxbx-Reloaded's unswizzling code:
-		 * https://github.com/Cxbx-Reloaded/Cxbx-Reloaded/blob/5d79c0b66e58bf38d39ea28cb4de954209d1e8ad/src/devices/video/swizzle.cpp
-		 * Original license: LGPLv2 (GPLv2 for contributions after 2012/01/13)
-		 *
-		 * rom-properties modification: Removed depth, since we're only
-		 * handling 2D textures. Also removed slice_pitch, since we don't
-		 * have any slices here.
-		 *
-		 * @param src_buf
-		 * @param width
-		 * @param height
-		 * @param dst_buf
-		 * @param row_pitch
-		 * @param slice_pitch
-		 * @param bytes_per_pixel
-		 */
-		static void unswizzle_box(const uint8_t *src_buf,
-			unsigned int width, unsigned int height,
-			uint8_t *dst_buf, unsigned int row_pitch,
-			unsigned int bytes_per_pixel);
-
 		/**
 		 * Load the XboxXPR image.
 		 * @return Image, or nullptr on error.
@@ -223,94 +165,6 @@ void XboxXPRPrivate::generate_swizzle_masks(
 	*mask_y = y;
 }
 
-/**
- * This fills a pattern with a value if your value has bits abcd and your
- * pattern is 11010100100 this will return: 0a0b0c00d00
- *
- * Based on Cxbx-Reloaded's unswizzling code:
- * https://github.com/Cxbx-Reloaded/Cxbx-Reloaded/blob/5d79c0b66e58bf38d39ea28cb4de954209d1e8ad/src/devices/video/swizzle.cpp
- * Original license: LGPLv2 (GPLv2 for contributions after 2012/01/13)
- *
- * @param pattern
- * @param value
- * @return
- */
-uint32_t XboxXPRPrivate::fill_pattern(uint32_t pattern, uint32_t value)
-{
-	uint32_t result = 0;
-	uint32_t bit = 1;
-	while(value) {
-		if (pattern & bit) {
-			/* Copy bit to result */
-			result |= value & 1 ? bit : 0;
-			value >>= 1;
-		}
-		bit <<= 1;
-	}
-	return result;
-}
-
-/**
- * Get a swizzled texture offset.
- * Based on Cxbx-Reloaded's unswizzling code:
- * https://github.com/Cxbx-Reloaded/Cxbx-Reloaded/blob/5d79c0b66e58bf38d39ea28cb4de954209d1e8ad/src/devices/video/swizzle.cpp
- * Original license: LGPLv2 (GPLv2 for contributions after 2012/01/13)
- *
- * rom-properties modification: Removed depth, since we're only
- * handling 2D textures.
- *
- * @param x
- * @param y
- * @param mask_x
- * @param mask_y
- * @param bytes_per_pixel
- * @return
- */
-inline unsigned int XboxXPRPrivate::get_swizzled_offset(
-	unsigned int x, unsigned int y,
-	uint32_t mask_x, uint32_t mask_y,
-	unsigned int bytes_per_pixel)
-{
-	return bytes_per_pixel * (fill_pattern(mask_x, x)
-	                       |  fill_pattern(mask_y, y));
-}
-
-/**
- * Unswizzle an ARGB texture.
- * Based on Cxbx-Reloaded's unswizzling code:
- * https://github.com/Cxbx-Reloaded/Cxbx-Reloaded/blob/5d79c0b66e58bf38d39ea28cb4de954209d1e8ad/src/devices/video/swizzle.cpp
- * Original license: LGPLv2 (GPLv2 for contributions after 2012/01/13)
- *
- * rom-properties modification: Removed depth, since we're only
- * handling 2D textures. Also removed slice_pitch, since we don't
- * have any slices here.
- *
- * @param src_buf
- * @param width
- * @param height
- * @param dst_buf
- * @param row_pitch
- * @param slice_pitch
- * @param bytes_per_pixel
- */
-void XboxXPRPrivate::unswizzle_box(const uint8_t *src_buf,
-	unsigned int width, unsigned int height,
-	uint8_t *dst_buf, unsigned int row_pitch,
-	unsigned int bytes_per_pixel)
-{
-	uint32_t mask_x, mask_y;
-	generate_swizzle_masks(width, height, &mask_x, &mask_y);
-
-	for (unsigned int y = 0; y < height; y++) {
-		for (unsigned int x = 0; x < width; x++) {
-			const uint8_t *src = src_buf +
-				get_swizzled_offset(x, y, mask_x, mask_y, bytes_per_pixel);
-			uint8_t *dst = dst_buf + y * row_pitch + x * bytes_per_pixel;
-			memcpy(dst, src, bytes_per_pixel);
-		}
-	}
-}
-
 /**
  * Load the XPR0 image.
  * @return Image, or nullptr on error.
@@ -526,24 +380,18 @@ const rp_image *XboxXPRPrivate::loadXboxXPR0Image(void)
 			return img;
 		}
 
-		// Assuming we don't have any extra bytes of stride,
-		// since the image must be a multiple of 4px wide.
-		// 4px ARGB32 is 16 bytes.
-		assert(img->stride() == img->row_bytes());
-		if (img->stride() != img->row_bytes()) {
-			// We have extra bytes.
+		// NOTE: Xbox swizzling is Morton order, with the
+		// X and Y bits interleaved starting with X.
+		// Since width and height are both powers of two,
+		// the entire image is a single Morton tile.
+		uint32_t mask_x, mask_y;
+		generate_swizzle_masks(width, height, &mask_x, &mask_y);
+		rp_image *const imgunswz = ImageDecoder::unswizzleMorton32(img, mask_x, mask_y);
+		if (!imgunswz) {
 			// Can't unswizzle this image right now.
 			// Return the image as-is.
 			return img;
 		}
-
-		// Assuming img is ARGB32, since we're converting it
-		// from either a 16-bit or 32-bit ARGB format.
-		rp_image *const imgunswz = new rp_image(width, height, rp_image::Format::ARGB32);
-		unswizzle_box(static_cast<const uint8_t*>(img->bits()),
-			width, height,
-			static_cast<uint8_t*>(imgunswz->bits()),
-			img->stride(), sizeof(uint32_t));
 		img->unref();
 		img = imgunswz;
 		return imgunswz;
@@ -0,0 +1,273 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (librptexture)                     *
+ * PixelBufferPool.cpp: Pooled allocator for image pixel buffers.          *
+ *                                                                         *
+ * Copyright (c) 2016-2022 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "stdafx.h"
+#include "PixelBufferPool.hpp"
+
+// librpthreads
+#include "librpthreads/Atomics.h"
+
+// NOTE: MSVC 2013 and earlier don't support thread_local,
+// and __declspec(thread) doesn't support destructors.
+// Pooling is disabled on those compilers.
+#if !defined(_MSC_VER) || _MSC_VER >= 1900
+#  define PIXELBUFFERPOOL_ENABLED 1
+#endif
+
+namespace LibRpTexture { namespace PixelBufferPool {
+
+// Smallest and largest size classes.
+static const unsigned int MIN_CLASS_SHIFT = 10;	// 1 KB
+static const unsigned int MAX_CLASS_SHIFT = 20;	// 1 MB
+// Four size classes per power of two, plus the minimum class.
+static const unsigned int NUM_CLASSES = ((MAX_CLASS_SHIFT - MIN_CLASS_SHIFT) * 4) + 1;
+// Size class index for buffers that aren't pooled.
+static const unsigned int CLASS_NONE = ~0U;
+
+/**
+ * Buffer header.
+ * Stored immediately before the buffer.
+ * Must be 16 bytes in order to keep the buffer 16-byte aligned.
+ */
+struct BufferHeader {
+	unsigned int sizeClass;		// Size class index, or CLASS_NONE.
+	unsigned int reserved[3];
+};
+static_assert(sizeof(BufferHeader) == 16, "BufferHeader must be 16 bytes.");
+
+/**
+ * Free buffer. The next pointer is stored in the buffer itself.
+ */
+struct FreeBuffer {
+	FreeBuffer *next;
+};
+
+// Statistics. (Updated atomically.)
+static volatile int stat_allocs;
+static volatile int stat_hits;
+static volatile int stat_oversize;
+static volatile int stat_evictions;
+
+/**
+ * Get the size class for the specified size.
+ * @param size		[in] Size, in bytes.
+ * @param pClassSize	[out] Size of the size class, in bytes.
+ * @return Size class index, or CLASS_NONE if the size is too large.
+ */
+static inline unsigned int sizeToClass(size_t size, size_t *pClassSize)
+{
+	if (size <= (1U << MIN_CLASS_SHIFT)) {
+		*pClassSize = (1U << MIN_CLASS_SHIFT);
+		return 0;
+	} else if (size > (1U << MAX_CLASS_SHIFT)) {
+		return CLASS_NONE;
+	}
+
+	// Four classes per power of two.
+	const unsigned int shift = uilog2(static_cast<unsigned int>(size - 1));
+	const size_t step = static_cast<size_t>(1) << (shift - 2);
+	const unsigned int sub = static_cast<unsigned int>(((size - 1) - (static_cast<size_t>(1) << shift)) / step);
+	*pClassSize = (static_cast<size_t>(1) << shift) + ((sub + 1) * step);
+	return ((shift - MIN_CLASS_SHIFT) * 4) + sub + 1;
+}
+
+/**
+ * Get the size of a size class.
+ * @param sizeClass Size class index.
+ * @return Size, in bytes.
+ */
+static inline size_t classToSize(unsigned int sizeClass)
+{
+	if (sizeClass == 0) {
+		return (1U << MIN_CLASS_SHIFT);
+	}
+	const unsigned int shift = ((sizeClass - 1) / 4) + MIN_CLASS_SHIFT;
+	const unsigned int sub = (sizeClass - 1) % 4;
+	return (static_cast<size_t>(1) << shift) + ((sub + 1) * (static_cast<size_t>(1) << (shift - 2)));
+}
+
+/**
+ * Allocate a buffer and its header.
+ * @param size Buffer size, not including the header.
+ * @param sizeClass Size class index.
+ * @return Buffer, or nullptr on error.
+ */
+static void *allocWithHeader(size_t size, unsigned int sizeClass)
+{
+	BufferHeader *const hdr = static_cast<BufferHeader*>(aligned_malloc(16, sizeof(BufferHeader) + size));
+	if (!hdr)
+		return nullptr;
+	hdr->sizeClass = sizeClass;
+	return hdr + 1;
+}
+
+#ifdef PIXELBUFFERPOOL_ENABLED
+/**
+ * Has this thread's ThreadCache been destroyed?
+ *
+ * This is a separate trivially-destructible thread_local, since
+ * the ThreadCache object can't be accessed after its destructor
+ * has run. Buffers freed after that point (e.g. by static
+ * destructors) are freed immediately.
+ */
+static thread_local bool tcacheDestroyed = false;
+
+/**
+ * Per-thread free lists.
+ */
+class ThreadCache
+{
+	public:
+		ThreadCache()
+			: pooledBytes(0)
+		{
+			memset(freeLists, 0, sizeof(freeLists));
+			memset(counts, 0, sizeof(counts));
+		}
+
+		~ThreadCache()
+		{
+			clear();
+			tcacheDestroyed = true;
+		}
+
+	private:
+		RP_DISABLE_COPY(ThreadCache)
+
+	public:
+		/**
+		 * Free all buffers in the free lists.
+		 */
+		void clear(void)
+		{
+			for (unsigned int i = 0; i < NUM_CLASSES; i++) {
+				FreeBuffer *buf = freeLists[i];
+				while (buf) {
+					FreeBuffer *const next = buf->next;
+					aligned_free(reinterpret_cast<BufferHeader*>(buf) - 1);
+					buf = next;
+				}
+				freeLists[i] = nullptr;
+				counts[i] = 0;
+			}
+			pooledBytes = 0;
+		}
+
+	public:
+		FreeBuffer *freeLists[NUM_CLASSES];
+		unsigned int counts[NUM_CLASSES];
+		size_t pooledBytes;
+};
+
+static thread_local ThreadCache tcache;
+#endif /* PIXELBUFFERPOOL_ENABLED */
+
+/**
+ * Allocate a 16-byte aligned pixel buffer.
+ * @param size Size, in bytes.
+ * @return Buffer, or nullptr on error.
+ */
+void *allocBuffer(size_t size)
+{
+	ATOMIC_INC_FETCH(&stat_allocs);
+
+	size_t classSize;
+	const unsigned int sizeClass = sizeToClass(size, &classSize);
+	if (sizeClass == CLASS_NONE) {
+		// Too large for the pool.
+		ATOMIC_INC_FETCH(&stat_oversize);
+		return allocWithHeader(size, CLASS_NONE);
+	}
+
+#ifdef PIXELBUFFERPOOL_ENABLED
+	if (!tcacheDestroyed) {
+		ThreadCache &tc = tcache;
+		FreeBuffer *const buf = tc.freeLists[sizeClass];
+		if (buf) {
+			// Found a free buffer.
+			tc.freeLists[sizeClass] = buf->next;
+			tc.counts[sizeClass]--;
+			tc.pooledBytes -= classSize;
+			ATOMIC_INC_FETCH(&stat_hits);
+			return buf;
+		}
+	}
+#endif /* PIXELBUFFERPOOL_ENABLED */
+
+	// Allocate the full size class so the buffer can be reused.
+	return allocWithHeader(classSize, sizeClass);
+}
+
+/**
+ * Free a pixel buffer allocated by allocBuffer().
+ * The buffer is added to this thread's free list if there's room.
+ * @param ptr Buffer. (may be nullptr)
+ */
+void freeBuffer(void *ptr)
+{
+	if (!ptr)
+		return;
+
+	BufferHeader *const hdr = static_cast<BufferHeader*>(ptr) - 1;
+	const unsigned int sizeClass = hdr->sizeClass;
+	if (sizeClass == CLASS_NONE) {
+		// Not pooled.
+		aligned_free(hdr);
+		return;
+	}
+	assert(sizeClass < NUM_CLASSES);
+
+#ifdef PIXELBUFFERPOOL_ENABLED
+	if (!tcacheDestroyed) {
+		ThreadCache &tc = tcache;
+		const size_t classSize = classToSize(sizeClass);
+		if (tc.counts[sizeClass] < MAX_BUFFERS_PER_CLASS &&
+		    tc.pooledBytes + classSize <= MAX_POOLED_BYTES)
+		{
+			// Add the buffer to the free list.
+			FreeBuffer *const buf = static_cast<FreeBuffer*>(ptr);
+			buf->next = tc.freeLists[sizeClass];
+			tc.freeLists[sizeClass] = buf;
+			tc.counts[sizeClass]++;
+			tc.pooledBytes += classSize;
+			return;
+		}
+	}
+#endif /* PIXELBUFFERPOOL_ENABLED */
+
+	// Free list is full.
+	ATOMIC_INC_FETCH(&stat_evictions);
+	aligned_free(hdr);
+}
+
+/**
+ * Free all buffers in this thread's free lists.
+ */
+void trim(void)
+{
+#ifdef PIXELBUFFERPOOL_ENABLED
+	if (!tcacheDestroyed) {
+		tcache.clear();
+	}
+#endif /* PIXELBUFFERPOOL_ENABLED */
+}
+
+/**
+ * Get the pool statistics.
+ * @param pStats	[out] Statistics.
+ */
+void getStats(Stats *pStats)
+{
+	assert(pStats != nullptr);
+	pStats->allocs = static_cast<unsigned int>(stat_allocs);
+	pStats->hits = static_cast<unsigned int>(stat_hits);
+	pStats->oversize = static_cast<unsigned int>(stat_oversize);
+	pStats->evictions = static_cast<unsigned int>(stat_evictions);
+}
+
+} }
@@ -0,0 +1,89 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (librptexture)                     *
+ * PixelBufferPool.hpp: Pooled allocator for image pixel buffers.          *
+ *                                                                         *
+ * Copyright (c) 2016-2022 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#ifndef __ROMPROPERTIES_LIBRPTEXTURE_IMG_PIXELBUFFERPOOL_HPP__
+#define __ROMPROPERTIES_LIBRPTEXTURE_IMG_PIXELBUFFERPOOL_HPP__
+
+#include "common.h"
+
+// C includes.
+#include <stddef.h>	/* size_t */
+
+/**
+ * Long-running processes (rp-thumbnailer-dbus, file manager plugins)
+ * create and destroy many images with a few repeating sizes, e.g.
+ * 32x32 icons, 96x32 banners, and 256x256 thumbnails.
+ *
+ * Buffers are grouped into size classes, with four classes per power
+ * of two from 1 KB to 1 MB. Freed buffers are kept on per-thread free
+ * lists, so no locking is needed. Each thread keeps at most
+ * MAX_BUFFERS_PER_CLASS buffers per class and MAX_POOLED_BYTES total;
+ * anything beyond that is freed immediately.
+ *
+ * All buffers are 16-byte aligned. A small header is stored before
+ * each buffer, so freeBuffer() doesn't need the size, and it can be
+ * used as a destroy callback for e.g. Cairo and Qt.
+ *
+ * NOTE: Buffers allocated here *must* be freed with freeBuffer().
+ */
+
+namespace LibRpTexture { namespace PixelBufferPool {
+
+// Maximum number of free buffers per size class, per thread.
+static const unsigned int MAX_BUFFERS_PER_CLASS = 8;
+// Maximum number of bytes in free buffers, per thread.
+static const size_t MAX_POOLED_BYTES = 4*1024*1024;
+
+/**
+ * Allocate a 16-byte aligned pixel buffer.
+ * @param size Size, in bytes.
+ * @return Buffer, or nullptr on error.
+ */
+void *allocBuffer(size_t size);
+
+/**
+ * Free a pixel buffer allocated by allocBuffer().
+ * The buffer is added to this thread's free list if there's room.
+ * @param ptr Buffer. (may be nullptr)
+ */
+void freeBuffer(void *ptr);
+
+/**
+ * Free all buffers in this thread's free lists.
+ */
+void trim(void);
+
+/**
+ * Pool statistics.
+ * These are totals across all threads.
+ */
+struct Stats {
+	unsigned int allocs;	// Number of allocBuffer() calls
+	unsigned int hits;	// Allocations satisfied by a free list
+	unsigned int oversize;	// Allocations too large for the pool
+	unsigned int evictions;	// Buffers freed because the free list was full
+
+	/**
+	 * Get the hit rate.
+	 * @return Hit rate, in percent.
+	 */
+	inline unsigned int hitRate(void) const
+	{
+		return (allocs > 0 ? static_cast<unsigned int>((hits * 100ULL) / allocs) : 0);
+	}
+};
+
+/**
+ * Get the pool statistics.
+ * @param pStats	[out] Statistics.
+ */
+void getStats(Stats *pStats);
+
+} }
+
+#endif /* __ROMPROPERTIES_LIBRPTEXTURE_IMG_PIXELBUFFERPOOL_HPP__ */
@@ -10,6 +10,7 @@
 #include "rp_image.hpp"
 #include "rp_image_p.hpp"
 #include "rp_image_backend.hpp"
+#include "PixelBufferPool.hpp"
 
 // Workaround for RP_D() expecting the no-underscore, UpperCamelCase naming convention.
 #define rp_imagePrivate rp_image_private
@@ -100,7 +101,7 @@ rp_image_backend_default::rp_image_backend_default(int width, int height, rp_ima
 		return;
 	}
 
-	m_data = aligned_malloc(16, m_data_len);
+	m_data = PixelBufferPool::allocBuffer(m_data_len);
 	assert(m_data != nullptr);
 	if (!m_data) {
 		// Failed to allocate memory.
@@ -114,10 +115,10 @@ rp_image_backend_default::rp_image_backend_default(int width, int height, rp_ima
 		// there's no weird artifacts if the caller
 		// is converting a lower-color image.
 		const size_t palette_sz = 256*sizeof(*m_palette);
-		m_palette = static_cast<uint32_t*>(aligned_malloc(16, palette_sz));
+		m_palette = static_cast<uint32_t*>(PixelBufferPool::allocBuffer(palette_sz));
 		if (!m_palette) {
 			// Failed to allocate memory.
-			aligned_free(m_data);
+			PixelBufferPool::freeBuffer(m_data);
 			m_data = nullptr;
 			m_data_len = 0;
 			clear_properties();
@@ -132,8 +133,8 @@ rp_image_backend_default::rp_image_backend_default(int width, int height, rp_ima
 
 rp_image_backend_default::~rp_image_backend_default()
 {
-	aligned_free(m_data);
-	aligned_free(m_palette);
+	PixelBufferPool::freeBuffer(m_data);
+	PixelBufferPool::freeBuffer(m_palette);
 }
 
 /**
@@ -194,9 +195,13 @@ rp_image_private::rp_image_private(int width, int height, rp_image::Format forma
 	}
 
 	// Allocate a storage object for the image.
+	// NOTE: The backend creator function may return nullptr
+	// if it doesn't support this format.
+	this->backend = nullptr;
 	if (backend_fn != nullptr) {
 		this->backend = backend_fn(width, height, format);
-	} else {
+	}
+	if (!this->backend) {
 		this->backend = new rp_image_backend_default(width, height, format);
 	}
 }
@@ -23,6 +23,7 @@
 #  define RP_IMAGE_HAS_SSE2 1
 #  define RP_IMAGE_HAS_SSSE3 1
 #  define RP_IMAGE_HAS_SSE41 1
+#  define RP_IMAGE_HAS_AVX2 1
 #endif
 #ifdef RP_CPU_AMD64
 #  define RP_IMAGE_ALWAYS_HAS_SSE2 1
@@ -114,6 +115,9 @@ class rp_image : public RefBase
 		/**
 		 * rp_image_backend creator function.
 		 * May be a static member of an rp_image_backend subclass.
+		 * If the backend doesn't support the specified format,
+		 * this function should return nullptr; the default
+		 * backend will be used instead.
 		 */
 		typedef rp_image_backend* (*rp_image_backend_creator_fn)(int width, int height, rp_image::Format format);
 
@@ -369,6 +373,73 @@ class rp_image : public RefBase
 			Alignment alignment = AlignDefault,
 			uint32_t bgColor = 0x00000000) const;
 
+		/**
+		 * Scaling filters for scaled().
+		 */
+		enum class ScaleFilter : uint8_t {
+			Box,		// Area average (best for downscaling)
+			Bilinear,	// Bilinear (triangle filter, widened when downscaling)
+		};
+
+		/**
+		 * Scale the rp_image.
+		 * Standard version using regular C++ code.
+		 *
+		 * Alpha is handled correctly by filtering premultiplied pixels.
+		 * CI8 images are converted to ARGB32.
+		 *
+		 * @param width New width
+		 * @param height New height
+		 * @param filter Scaling filter
+		 * @return New ARGB32 rp_image with a scaled version of the original, or nullptr on error.
+		 */
+		rp_image *scaled_cpp(int width, int height, ScaleFilter filter = ScaleFilter::Box) const;
+
+#ifdef RP_IMAGE_HAS_SSE2
+		/**
+		 * Scale the rp_image.
+		 * SSE2-optimized version.
+		 *
+		 * Alpha is handled correctly by filtering premultiplied pixels.
+		 * CI8 images are converted to ARGB32.
+		 *
+		 * @param width New width
+		 * @param height New height
+		 * @param filter Scaling filter
+		 * @return New ARGB32 rp_image with a scaled version of the original, or nullptr on error.
+		 */
+		rp_image *scaled_sse2(int width, int height, ScaleFilter filter = ScaleFilter::Box) const;
+#endif /* RP_IMAGE_HAS_SSE2 */
+
+#ifdef RP_IMAGE_HAS_AVX2
+		/**
+		 * Scale the rp_image.
+		 * AVX2-optimized version.
+		 *
+		 * Alpha is handled correctly by filtering premultiplied pixels.
+		 * CI8 images are converted to ARGB32.
+		 *
+		 * @param width New width
+		 * @param height New height
+		 * @param filter Scaling filter
+		 * @return New ARGB32 rp_image with a scaled version of the original, or nullptr on error.
+		 */
+		rp_image *scaled_avx2(int width, int height, ScaleFilter filter = ScaleFilter::Box) const;
+#endif /* RP_IMAGE_HAS_AVX2 */
+
+		/**
+		 * Scale the rp_image.
+		 *
+		 * Alpha is handled correctly by filtering premultiplied pixels.
+		 * CI8 images are converted to ARGB32.
+		 *
+		 * @param width New width
+		 * @param height New height
+		 * @param filter Scaling filter
+		 * @return New ARGB32 rp_image with a scaled version of the original, or nullptr on error.
+		 */
+		inline rp_image *scaled(int width, int height, ScaleFilter filter = ScaleFilter::Box) const;
+
 		/**
 		 * Un-premultiply this image.
 		 * Standard version using regular C++ code.
@@ -391,6 +462,18 @@ class rp_image : public RefBase
 		int un_premultiply_sse41(void);
 #endif /* RP_IMAGE_HAS_SSE41 */
 
+#ifdef RP_IMAGE_HAS_AVX2
+		/**
+		 * Un-premultiply this image.
+		 * AVX2-optimized version.
+		 *
+		 * Image must be ARGB32.
+		 *
+		 * @return 0 on success; non-zero on error.
+		 */
+		int un_premultiply_avx2(void);
+#endif /* RP_IMAGE_HAS_AVX2 */
+
 		/**
 		 * Un-premultiply this image.
 		 *
@@ -409,12 +492,46 @@ class rp_image : public RefBase
 
 		/**
 		 * Premultiply this image.
+		 * Standard version using regular C++ code.
+		 *
+		 * Image must be ARGB32.
+		 *
+		 * @return 0 on success; non-zero on error.
+		 */
+		int premultiply_cpp(void);
+
+#ifdef RP_IMAGE_HAS_SSSE3
+		/**
+		 * Premultiply this image.
+		 * SSSE3-optimized version.
+		 *
+		 * Image must be ARGB32.
+		 *
+		 * @return 0 on success; non-zero on error.
+		 */
+		int premultiply_ssse3(void);
+#endif /* RP_IMAGE_HAS_SSSE3 */
+
+#ifdef RP_IMAGE_HAS_AVX2
+		/**
+		 * Premultiply this image.
+		 * AVX2-optimized version.
 		 *
 		 * Image must be ARGB32.
 		 *
 		 * @return 0 on success; non-zero on error.
 		 */
-		int premultiply(void);
+		int premultiply_avx2(void);
+#endif /* RP_IMAGE_HAS_AVX2 */
+
+		/**
+		 * Premultiply this image.
+		 *
+		 * Image must be ARGB32.
+		 *
+		 * @return 0 on success; non-zero on error.
+		 */
+		inline int premultiply(void);
 
 		/**
 		 * Convert a chroma-keyed image to standard ARGB32.
@@ -508,8 +625,176 @@ class rp_image : public RefBase
 		 * @return 0 on success; negative POSIX error code on error.
 		 */
 		inline int swapRB(void);
+
+	public:
+		/** Pixel operation pipeline **/
+
+		/**
+		 * A sequence of image operations to be applied in a single pass.
+		 *
+		 * Per-pixel operations are applied in the order they were added.
+		 * flip() and squared() are geometric operations, so their order
+		 * relative to the per-pixel operations doesn't matter.
+		 *
+		 * Example:
+		 *   rp_image *img2 = img->processed(rp_image::PixelOps()
+		 *       .apply_chroma_key(0xFFFF00FF).swapRB().flip(rp_image::FLIP_V));
+		 */
+		class PixelOps {
+			public:
+				PixelOps()
+					: count(0)
+					, flipOp(FLIP_NONE)
+					, square(false)
+				{ }
+
+			public:
+				enum class Op : uint8_t {
+					ChromaKey,
+					SwapRB,
+					UnPremultiply,
+					Premultiply,
+				};
+
+				/**
+				 * Convert chroma-keyed pixels to transparent.
+				 * @param key Chroma key color.
+				 */
+				inline PixelOps &apply_chroma_key(uint32_t key)
+				{
+					return add(Op::ChromaKey, key);
+				}
+
+				/**
+				 * Swap the Red and Blue channels.
+				 */
+				inline PixelOps &swapRB(void)
+				{
+					return add(Op::SwapRB);
+				}
+
+				/**
+				 * Un-premultiply the pixels.
+				 */
+				inline PixelOps &un_premultiply(void)
+				{
+					return add(Op::UnPremultiply);
+				}
+
+				/**
+				 * Premultiply the pixels.
+				 */
+				inline PixelOps &premultiply(void)
+				{
+					return add(Op::Premultiply);
+				}
+
+				/**
+				 * Flip the image.
+				 * @param op Flip operation.
+				 */
+				inline PixelOps &flip(FlipOp op)
+				{
+					flipOp = static_cast<FlipOp>(flipOp ^ op);
+					return *this;
+				}
+
+				/**
+				 * Square the image by adding transparent rows or columns.
+				 * This requires a new image, so it's only valid for processed().
+				 */
+				inline PixelOps &squared(void)
+				{
+					square = true;
+					return *this;
+				}
+
+			private:
+				inline PixelOps &add(Op op, uint32_t param = 0)
+				{
+					// NOTE: Extra operations are ignored.
+					if (count < MAX_OPS) {
+						ops[count].op = op;
+						ops[count].param = param;
+						count++;
+					}
+					return *this;
+				}
+
+			public:
+				static const unsigned int MAX_OPS = 8;
+				struct {
+					Op op;
+					uint32_t param;
+				} ops[MAX_OPS];
+				uint8_t count;
+				FlipOp flipOp;
+				bool square;
+		};
+
+		/**
+		 * Apply a sequence of operations to this image in place.
+		 *
+		 * Each row is processed by all of the per-pixel operations
+		 * before moving on to the next row. For CI8 images, the
+		 * per-pixel operations are applied to the palette.
+		 *
+		 * NOTE: PixelOps::squared() is not supported here.
+		 *
+		 * @param ops Pixel operations.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		int process(const PixelOps &ops);
+
+		/**
+		 * Apply a sequence of operations to a copy of this image.
+		 *
+		 * Format conversion, flipping, squaring, and all per-pixel
+		 * operations are done in a single pass over the image.
+		 * CI8 images are converted to ARGB32.
+		 *
+		 * @param ops Pixel operations.
+		 * @return New ARGB32 rp_image, or nullptr on error.
+		 */
+		rp_image *processed(const PixelOps &ops) const;
 };
 
+/**
+ * Scale the rp_image.
+ *
+ * Alpha is handled correctly by filtering premultiplied pixels.
+ * CI8 images are converted to ARGB32.
+ *
+ * @param width New width
+ * @param height New height
+ * @param filter Scaling filter
+ * @return New ARGB32 rp_image with a scaled version of the original, or nullptr on error.
+ */
+inline rp_image *rp_image::scaled(int width, int height, ScaleFilter filter) const
+{
+	// FIXME: Figure out how to get IFUNC working with C++ member functions.
+#ifdef RP_IMAGE_HAS_AVX2
+	if (RP_CPU_HasAVX2()) {
+		return scaled_avx2(width, height, filter);
+	} else
+#endif /* RP_IMAGE_HAS_AVX2 */
+#if defined(RP_IMAGE_ALWAYS_HAS_SSE2)
+	{
+		// amd64 always has SSE2.
+		return scaled_sse2(width, height, filter);
+	}
+#else
+#  if defined(RP_IMAGE_HAS_SSE2)
+	if (RP_CPU_HasSSE2()) {
+		return scaled_sse2(width, height, filter);
+	} else
+#  endif /* RP_IMAGE_HAS_SSE2 */
+	{
+		return scaled_cpp(width, height, filter);
+	}
+#endif /* RP_IMAGE_ALWAYS_HAS_SSE2 */
+}
+
 /**
  * Un-premultiply this image.
  *
@@ -520,16 +805,46 @@ class rp_image : public RefBase
 inline int rp_image::un_premultiply(void)
 {
 	// FIXME: Figure out how to get IFUNC working with C++ member functions.
+#ifdef RP_IMAGE_HAS_AVX2
+	if (RP_CPU_HasAVX2()) {
+		return un_premultiply_avx2();
+	} else
+#endif /* RP_IMAGE_HAS_AVX2 */
 #ifdef RP_IMAGE_HAS_SSE41
 	if (RP_CPU_HasSSE41()) {
 		return un_premultiply_sse41();
 	} else
-#endif /* RP_IMAGE_HAS_SSE2 */
+#endif /* RP_IMAGE_HAS_SSE41 */
 	{
 		return un_premultiply_cpp();
 	}
 }
 
+/**
+ * Premultiply this image.
+ *
+ * Image must be ARGB32.
+ *
+ * @return 0 on success; non-zero on error.
+ */
+inline int rp_image::premultiply(void)
+{
+	// FIXME: Figure out how to get IFUNC working with C++ member functions.
+#ifdef RP_IMAGE_HAS_AVX2
+	if (RP_CPU_HasAVX2()) {
+		return premultiply_avx2();
+	} else
+#endif /* RP_IMAGE_HAS_AVX2 */
+#ifdef RP_IMAGE_HAS_SSSE3
+	if (RP_CPU_HasSSSE3()) {
+		return premultiply_ssse3();
+	} else
+#endif /* RP_IMAGE_HAS_SSSE3 */
+	{
+		return premultiply_cpp();
+	}
+}
+
 /**
  * Convert a chroma-keyed image to standard ARGB32.
  *
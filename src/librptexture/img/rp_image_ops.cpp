@@ -10,6 +10,7 @@
 #include "rp_image.hpp"
 #include "rp_image_p.hpp"
 #include "rp_image_backend.hpp"
+#include "rp_image_pipeline_p.hpp"
 
 // Workaround for RP_D() expecting the no-underscore, UpperCamelCase naming convention.
 #define rp_imagePrivate rp_image_private
@@ -498,6 +499,50 @@ rp_image *rp_image::resized(int width, int height, Alignment alignment, uint32_t
 	return img;
 }
 
+/**
+ * Convert chroma-keyed pixels to transparent.
+ * @param row	[in,out] ARGB32 row.
+ * @param width	[in] Width, in pixels.
+ * @param key	[in] Chroma key color.
+ */
+void PixelPipeline::chromaKeyRow_cpp(argb32_t *row, int width, uint32_t key)
+{
+	for (; width > 1; width -= 2, row += 2) {
+		// Check for chroma key pixels.
+		if (row[0].u32 == key) {
+			row[0].u32 = 0;
+		}
+		if (row[1].u32 == key) {
+			row[1].u32 = 0;
+		}
+	}
+
+	if (width == 1) {
+		if (row->u32 == key) {
+			row->u32 = 0;
+		}
+	}
+}
+
+/**
+ * Swap the Red and Blue channels.
+ * @param row	[in,out] ARGB32 row.
+ * @param width	[in] Width, in pixels.
+ * @param param	[in] Unused.
+ */
+void PixelPipeline::swapRBRow_cpp(argb32_t *row, int width, uint32_t param)
+{
+	RP_UNUSED(param);
+	for (; width > 1; width -= 2, row += 2) {
+		std::swap(row[0].r, row[0].b);
+		std::swap(row[1].r, row[1].b);
+	}
+
+	if (width == 1) {
+		std::swap(row->r, row->b);
+	}
+}
+
 /**
  * Convert a chroma-keyed image to standard ARGB32.
  * Standard version using regular C++ code.
@@ -521,30 +566,11 @@ int rp_image::apply_chroma_key_cpp(uint32_t key)
 		return -EINVAL;
 	}
 
-	const unsigned int diff = (backend->stride - this->row_bytes()) / sizeof(uint32_t);
-	uint32_t *img_buf = static_cast<uint32_t*>(backend->data());
-
-	for (unsigned int y = static_cast<unsigned int>(backend->height); y > 0; y--) {
-		unsigned int x = static_cast<unsigned int>(backend->width);
-		for (; x > 1; x -= 2, img_buf += 2) {
-			// Check for chroma key pixels.
-			if (img_buf[0] == key) {
-				img_buf[0] = 0;
-			}
-			if (img_buf[1] == key) {
-				img_buf[1] = 0;
-			}
-		}
-
-		if (x == 1) {
-			if (*img_buf == key) {
-				*img_buf = 0;
-			}
-			img_buf++;
-		}
-
-		// Next row.
-		img_buf += diff;
+	const int width = backend->width;
+	const int stride = backend->stride / sizeof(argb32_t);
+	argb32_t *img_buf = static_cast<argb32_t*>(backend->data());
+	for (unsigned int y = static_cast<unsigned int>(backend->height); y > 0; y--, img_buf += stride) {
+		PixelPipeline::chromaKeyRow_cpp(img_buf, width, key);
 	}
 
 	// Adjust sBIT.
@@ -720,23 +746,11 @@ int rp_image::swapRB_cpp(void)
 			return -EINVAL;
 
 		case rp_image::Format::ARGB32: {
-			const unsigned int diff = (backend->stride - this->row_bytes()) / sizeof(uint32_t);
+			const int width = backend->width;
+			const int stride = backend->stride / sizeof(argb32_t);
 			argb32_t *img_buf = static_cast<argb32_t*>(backend->data());
-
-			for (unsigned int y = static_cast<unsigned int>(backend->height); y > 0; y--) {
-				unsigned int x = static_cast<unsigned int>(backend->width);
-				for (; x > 1; x -= 2, img_buf += 2) {
-					std::swap(img_buf[0].r, img_buf[0].b);
-					std::swap(img_buf[1].r, img_buf[1].b);
-				}
-
-				if (x == 1) {
-					std::swap(img_buf->r, img_buf->b);
-					img_buf++;
-				}
-
-				// Next row.
-				img_buf += diff;
+			for (unsigned int y = static_cast<unsigned int>(backend->height); y > 0; y--, img_buf += stride) {
+				PixelPipeline::swapRBRow_cpp(img_buf, width, 0);
 			}
 			break;
 		}
@@ -751,15 +765,7 @@ int rp_image::swapRB_cpp(void)
 			}
 
 			// Convert the palette.
-			unsigned int i;
-			for (i = 0; i+1 < pal_len; i += 2, pal += 2) {
-				std::swap(pal[i+1].r, pal[i+1].b);
-				std::swap(pal[i+1].r, pal[i+1].b);
-			}
-			for (; i < pal_len; i++, pal++) {
-				// Last color.
-				std::swap(pal[i].r, pal[i].b);
-			}
+			PixelPipeline::swapRBRow_cpp(pal, static_cast<int>(pal_len), 0);
 			break;
 		}
 	}
@@ -11,6 +11,7 @@
 #include "rp_image.hpp"
 #include "rp_image_p.hpp"
 #include "rp_image_backend.hpp"
+#include "rp_image_pipeline_p.hpp"
 
 // SSE2 intrinsics
 #include <emmintrin.h>
@@ -22,6 +23,41 @@ namespace LibRpTexture {
 
 /** Image operations. **/
 
+/**
+ * Convert chroma-keyed pixels to transparent.
+ * SSE2-optimized version.
+ * @param row	[in,out] ARGB32 row.
+ * @param width	[in] Width, in pixels.
+ * @param key	[in] Chroma key color.
+ */
+void PixelPipeline::chromaKeyRow_sse2(argb32_t *row, int width, uint32_t key)
+{
+	// SSE2 constants.
+	const __m128i xmm_key = _mm_set1_epi32(key);
+
+	// Process 4 pixels per iteration with SSE2.
+	for (; width > 3; width -= 4, row += 4) {
+		__m128i *const xmm_data = reinterpret_cast<__m128i*>(row);
+		const __m128i px = _mm_loadu_si128(xmm_data);
+
+		// Compare the pixels to the chroma key.
+		// Equal values will be 0xFFFFFFFF.
+		// Non-equal values will be 0x00000000.
+		const __m128i res = _mm_cmpeq_epi32(px, xmm_key);
+
+		// Mask the original data using the inverted results.
+		// Original data will now have 00s for chroma-keyed pixels.
+		_mm_storeu_si128(xmm_data, _mm_andnot_si128(res, px));
+	}
+
+	// Remaining pixels.
+	for (; width > 0; width--, row++) {
+		if (row->u32 == key) {
+			row->u32 = 0;
+		}
+	}
+}
+
 /**
  * Convert a chroma-keyed image to standard ARGB32.
  * SSE2-optimized version.
@@ -44,38 +80,11 @@ int rp_image::apply_chroma_key_sse2(uint32_t key)
 		return -EINVAL;
 	}
 
-	const unsigned int diff = (backend->stride - this->row_bytes()) / sizeof(uint32_t);
-	uint32_t *img_buf = static_cast<uint32_t*>(backend->data());
-
-	// SSE2 constants.
-	const __m128i xmm_key = _mm_setr_epi32(key, key, key, key);
-	const __m128i xmm_ones = _mm_setr_epi32(0xFFFFFFFF,0xFFFFFFFF,0xFFFFFFFF,0xFFFFFFFF);
-
-	for (unsigned int y = static_cast<unsigned int>(backend->height); y > 0; y--) {
-		// Process 4 pixels per iteration with SSE2.
-		unsigned int x = static_cast<unsigned int>(backend->width);
-		for (; x > 3; x -= 4, img_buf += 4) {
-			__m128i *xmm_data = reinterpret_cast<__m128i*>(img_buf);
-
-			// Compare the pixels to the chroma key.
-			// Equal values will be 0xFFFFFFFF.
-			// Non-equal values will be 0x00000000.
-			__m128i res = _mm_cmpeq_epi32(*xmm_data, xmm_key);
-
-			// Invert the results and mask the original data.
-			// Original data will now have 00s for chroma-keyed pixels.
-			*xmm_data = _mm_and_si128(_mm_xor_si128(res, xmm_ones), *xmm_data);
-		}
-
-		// Remaining pixels.
-		for (; x > 0; x--, img_buf++) {
-			if (*img_buf == key) {
-				*img_buf = 0;
-			}
-		}
-
-		// Next row.
-		img_buf += diff;
+	const int width = backend->width;
+	const int stride = backend->stride / sizeof(argb32_t);
+	argb32_t *img_buf = static_cast<argb32_t*>(backend->data());
+	for (unsigned int y = static_cast<unsigned int>(backend->height); y > 0; y--, img_buf += stride) {
+		PixelPipeline::chromaKeyRow_sse2(img_buf, width, key);
 	}
 
 	// Adjust sBIT.
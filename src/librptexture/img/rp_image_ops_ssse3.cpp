@@ -11,6 +11,7 @@
 #include "rp_image.hpp"
 #include "rp_image_p.hpp"
 #include "rp_image_backend.hpp"
+#include "rp_image_pipeline_p.hpp"
 
 // SSSE3 intrinsics
 #include <emmintrin.h>
@@ -23,6 +24,46 @@ namespace LibRpTexture {
 
 /** Image operations. **/
 
+/**
+ * Swap the Red and Blue channels.
+ * SSSE3-optimized version.
+ * @param row	[in,out] ARGB32 row.
+ * @param width	[in] Width, in pixels.
+ * @param param	[in] Unused.
+ */
+void PixelPipeline::swapRBRow_ssse3(argb32_t *row, int width, uint32_t param)
+{
+	RP_UNUSED(param);
+
+	// ABGR shuffle mask
+	const __m128i shuf_mask = _mm_setr_epi8(2,1,0,3, 6,5,4,7, 10,9,8,11, 14,13,12,15);
+
+	// Process 16 pixels per iteration using SSSE3.
+	__m128i *xmm_buf = reinterpret_cast<__m128i*>(row);
+	for (; width > 15; width -= 16, xmm_buf += 4) {
+		__m128i sa = _mm_loadu_si128(&xmm_buf[0]);
+		__m128i sb = _mm_loadu_si128(&xmm_buf[1]);
+		__m128i sc = _mm_loadu_si128(&xmm_buf[2]);
+		__m128i sd = _mm_loadu_si128(&xmm_buf[3]);
+
+		_mm_storeu_si128(&xmm_buf[0], _mm_shuffle_epi8(sa, shuf_mask));
+		_mm_storeu_si128(&xmm_buf[1], _mm_shuffle_epi8(sb, shuf_mask));
+		_mm_storeu_si128(&xmm_buf[2], _mm_shuffle_epi8(sc, shuf_mask));
+		_mm_storeu_si128(&xmm_buf[3], _mm_shuffle_epi8(sd, shuf_mask));
+	}
+
+	// Process 4 pixels per iteration using SSSE3.
+	for (; width > 3; width -= 4, xmm_buf++) {
+		_mm_storeu_si128(xmm_buf, _mm_shuffle_epi8(_mm_loadu_si128(xmm_buf), shuf_mask));
+	}
+
+	// Remaining pixels.
+	argb32_t *px32 = reinterpret_cast<argb32_t*>(xmm_buf);
+	for (; width > 0; width--, px32++) {
+		std::swap(px32->r, px32->b);
+	}
+}
+
 /**
  * Swap Red and Blue channels in an ARGB32 image.
  * SSSE3-optimized version.
@@ -36,9 +77,6 @@ int rp_image::swapRB_ssse3(void)
 	RP_D(rp_image);
 	rp_image_backend *const backend = d->backend;
 
-	// ABGR shuffle mask
-	const __m128i shuf_mask = _mm_setr_epi8(2,1,0,3, 6,5,4,7, 10,9,8,11, 14,13,12,15);
-
 	switch (backend->format) {
 		default:
 			// Unsupported image format.
@@ -46,33 +84,11 @@ int rp_image::swapRB_ssse3(void)
 			return -EINVAL;
 
 		case rp_image::Format::ARGB32: {
+			const int width = backend->width;
+			const int stride = backend->stride / sizeof(argb32_t);
 			argb32_t *img_buf = static_cast<argb32_t*>(backend->data());
-			const int row_width = backend->stride / sizeof(uint32_t);
-
-			for (unsigned int y = static_cast<unsigned int>(backend->height); y > 0; y--) {
-				// Process 16 pixels per iteration using SSSE3.
-				unsigned int x = static_cast<unsigned int>(backend->width);
-				__m128i *xmm_buf = reinterpret_cast<__m128i*>(img_buf);
-				for (; x > 15; x -= 16, xmm_buf += 4) {
-					__m128i sa = _mm_load_si128(&xmm_buf[0]);
-					__m128i sb = _mm_load_si128(&xmm_buf[1]);
-					__m128i sc = _mm_load_si128(&xmm_buf[2]);
-					__m128i sd = _mm_load_si128(&xmm_buf[3]);
-
-					_mm_store_si128(&xmm_buf[0], _mm_shuffle_epi8(sa, shuf_mask));
-					_mm_store_si128(&xmm_buf[1], _mm_shuffle_epi8(sb, shuf_mask));
-					_mm_store_si128(&xmm_buf[2], _mm_shuffle_epi8(sc, shuf_mask));
-					_mm_store_si128(&xmm_buf[3], _mm_shuffle_epi8(sd, shuf_mask));
-				}
-
-				// Remaining pixels.
-				argb32_t *px32 = reinterpret_cast<argb32_t*>(xmm_buf);
-				for (; x > 0; x--, px32++) {
-					std::swap(px32->r, px32->b);
-				}
-
-				// Next line.
-				img_buf += row_width;
+			for (unsigned int y = static_cast<unsigned int>(backend->height); y > 0; y--, img_buf += stride) {
+				PixelPipeline::swapRBRow_ssse3(img_buf, width, 0);
 			}
 			break;
 		}
@@ -86,26 +102,8 @@ int rp_image::swapRB_ssse3(void)
 				return -EINVAL;
 			}
 
-			// Process 16 colors per iteration using SSSE3.
-			__m128i *xmm_pal = reinterpret_cast<__m128i*>(pal);
-			unsigned int i;
-			for (i = pal_len; i > 15; i -= 16, pal += 4) {
-				__m128i sa = _mm_load_si128(&xmm_pal[0]);
-				__m128i sb = _mm_load_si128(&xmm_pal[1]);
-				__m128i sc = _mm_load_si128(&xmm_pal[2]);
-				__m128i sd = _mm_load_si128(&xmm_pal[3]);
-
-				_mm_store_si128(&xmm_pal[0], _mm_shuffle_epi8(sa, shuf_mask));
-				_mm_store_si128(&xmm_pal[1], _mm_shuffle_epi8(sb, shuf_mask));
-				_mm_store_si128(&xmm_pal[2], _mm_shuffle_epi8(sc, shuf_mask));
-				_mm_store_si128(&xmm_pal[3], _mm_shuffle_epi8(sd, shuf_mask));
-			}
-
-			// Remaining colors
-			argb32_t *pal32 = reinterpret_cast<argb32_t*>(xmm_pal);
-			for (; i > 0; i--, pal32++) {
-				std::swap(pal32->r, pal32->b);
-			}
+			// Convert the palette.
+			PixelPipeline::swapRBRow_ssse3(pal, static_cast<int>(pal_len), 0);
 			break;
 		}
 	}
@@ -0,0 +1,408 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (librptexture)                     *
+ * rp_image_pipeline.cpp: Image class. (pixel pipeline)                    *
+ *                                                                         *
+ * Copyright (c) 2016-2022 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "stdafx.h"
+#include "rp_image.hpp"
+#include "rp_image_p.hpp"
+#include "rp_image_backend.hpp"
+#include "rp_image_pipeline_p.hpp"
+
+// C++ STL classes.
+#include <algorithm>
+
+// Workaround for RP_D() expecting the no-underscore, UpperCamelCase naming convention.
+#define rp_imagePrivate rp_image_private
+
+namespace LibRpTexture { namespace PixelPipeline {
+
+/**
+ * Select the best row kernel for the specified operation.
+ * @param op Operation.
+ * @return Row kernel.
+ */
+static RowKernel selectKernel(rp_image::PixelOps::Op op)
+{
+	// FIXME: Figure out how to get IFUNC working with C++ member functions.
+	switch (op) {
+		default:
+			assert(!"Unsupported PixelOps::Op.");
+			return nullptr;
+
+		case rp_image::PixelOps::Op::ChromaKey:
+#if defined(RP_IMAGE_ALWAYS_HAS_SSE2)
+			// amd64 always has SSE2.
+			return chromaKeyRow_sse2;
+#else
+#  if defined(RP_IMAGE_HAS_SSE2)
+			if (RP_CPU_HasSSE2()) {
+				return chromaKeyRow_sse2;
+			}
+#  endif /* RP_IMAGE_HAS_SSE2 */
+			return chromaKeyRow_cpp;
+#endif /* RP_IMAGE_ALWAYS_HAS_SSE2 */
+
+		case rp_image::PixelOps::Op::SwapRB:
+#ifdef RP_IMAGE_HAS_SSSE3
+			if (RP_CPU_HasSSSE3()) {
+				return swapRBRow_ssse3;
+			}
+#endif /* RP_IMAGE_HAS_SSSE3 */
+			return swapRBRow_cpp;
+
+		case rp_image::PixelOps::Op::UnPremultiply:
+#ifdef RP_IMAGE_HAS_AVX2
+			if (RP_CPU_HasAVX2()) {
+				return unPremultiplyRow_avx2;
+			}
+#endif /* RP_IMAGE_HAS_AVX2 */
+#ifdef RP_IMAGE_HAS_SSE41
+			if (RP_CPU_HasSSE41()) {
+				return unPremultiplyRow_sse41;
+			}
+#endif /* RP_IMAGE_HAS_SSE41 */
+			return unPremultiplyRow_cpp;
+
+		case rp_image::PixelOps::Op::Premultiply:
+#ifdef RP_IMAGE_HAS_AVX2
+			if (RP_CPU_HasAVX2()) {
+				return premultiplyRow_avx2;
+			}
+#endif /* RP_IMAGE_HAS_AVX2 */
+#ifdef RP_IMAGE_HAS_SSSE3
+			if (RP_CPU_HasSSSE3()) {
+				return premultiplyRow_ssse3;
+			}
+#endif /* RP_IMAGE_HAS_SSSE3 */
+			return premultiplyRow_cpp;
+	}
+}
+
+/**
+ * PixelOps, converted to row kernels.
+ */
+class CompiledOps
+{
+	public:
+		explicit CompiledOps(const rp_image::PixelOps &ops)
+			: count(0)
+			, has_chroma_key(false)
+		{
+			for (unsigned int i = 0; i < ops.count; i++) {
+				const RowKernel fn = selectKernel(ops.ops[i].op);
+				if (!fn)
+					continue;
+				kernels[count] = fn;
+				params[count] = ops.ops[i].param;
+				count++;
+
+				if (ops.ops[i].op == rp_image::PixelOps::Op::ChromaKey) {
+					has_chroma_key = true;
+				}
+			}
+		}
+
+	public:
+		/**
+		 * Run all operations on an ARGB32 row.
+		 * @param row	[in,out] ARGB32 row.
+		 * @param width	[in] Width, in pixels.
+		 */
+		inline void run(argb32_t *row, int width) const
+		{
+			for (unsigned int i = 0; i < count; i++) {
+				kernels[i](row, width, params[i]);
+			}
+		}
+
+		/**
+		 * CI8 rows don't have any per-pixel operations.
+		 * (The operations are applied to the palette.)
+		 */
+		inline void run(uint8_t *row, int width) const
+		{
+			RP_UNUSED(row);
+			RP_UNUSED(width);
+		}
+
+	public:
+		RowKernel kernels[rp_image::PixelOps::MAX_OPS];
+		uint32_t params[rp_image::PixelOps::MAX_OPS];
+		unsigned int count;
+		bool has_chroma_key;
+};
+
+/**
+ * Flip and process an image in place, one pair of rows at a time.
+ * @tparam T Pixel type.
+ * @param bits		[in,out] Image data.
+ * @param width		[in] Width.
+ * @param height	[in] Height.
+ * @param stride	[in] Stride, in pixels.
+ * @param flipOp	[in] Flip operation.
+ * @param cops		[in] Compiled operations.
+ */
+template<typename T>
+static void processInPlace(T *bits, int width, int height, int stride,
+	rp_image::FlipOp flipOp, const CompiledOps &cops)
+{
+	const bool flipH = !!(flipOp & rp_image::FLIP_H);
+	if (!(flipOp & rp_image::FLIP_V)) {
+		// No vertical flip. Process one row at a time.
+		for (int y = height; y > 0; y--, bits += stride) {
+			if (flipH) {
+				std::reverse(bits, bits + width);
+			}
+			cops.run(bits, width);
+		}
+		return;
+	}
+
+	// Vertical flip: Swap the top and bottom rows,
+	// then process both while they're still in the cache.
+	T *top = bits;
+	T *bottom = bits + ((height - 1) * stride);
+	for (; top < bottom; top += stride, bottom -= stride) {
+		std::swap_ranges(top, top + width, bottom);
+		if (flipH) {
+			std::reverse(top, top + width);
+			std::reverse(bottom, bottom + width);
+		}
+		cops.run(top, width);
+		cops.run(bottom, width);
+	}
+	if (top == bottom) {
+		// Middle row.
+		if (flipH) {
+			std::reverse(top, top + width);
+		}
+		cops.run(top, width);
+	}
+}
+
+} }
+
+namespace LibRpTexture {
+
+/**
+ * Apply a sequence of operations to this image in place.
+ *
+ * Each row is processed by all of the per-pixel operations
+ * before moving on to the next row. For CI8 images, the
+ * per-pixel operations are applied to the palette.
+ *
+ * NOTE: PixelOps::squared() is not supported here.
+ *
+ * @param ops Pixel operations.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int rp_image::process(const PixelOps &ops)
+{
+	assert(!ops.square);
+	if (ops.square) {
+		// Squaring requires a new image.
+		return -EINVAL;
+	}
+
+	RP_D(rp_image);
+	rp_image_backend *const backend = d->backend;
+	const int width = backend->width;
+	const int height = backend->height;
+	assert(width > 0);
+	assert(height > 0);
+	if (width <= 0 || height <= 0) {
+		return -EINVAL;
+	}
+
+	const PixelPipeline::CompiledOps cops(ops);
+	switch (backend->format) {
+		default:
+			// Unsupported image format.
+			assert(!"Unsupported rp_image::Format.");
+			return -EINVAL;
+
+		case Format::ARGB32:
+			PixelPipeline::processInPlace(static_cast<argb32_t*>(backend->data()),
+				width, height, backend->stride / sizeof(argb32_t),
+				ops.flipOp, cops);
+			break;
+
+		case Format::CI8: {
+			argb32_t *const pal = reinterpret_cast<argb32_t*>(backend->palette());
+			const int pal_len = static_cast<int>(backend->palette_len());
+			assert(pal != nullptr);
+			assert(pal_len > 0);
+			if (!pal || pal_len <= 0) {
+				return -EINVAL;
+			}
+
+			if (cops.has_chroma_key && backend->tr_idx < 0) {
+				// Find the first chroma-keyed palette entry.
+				for (unsigned int i = 0; i < ops.count; i++) {
+					if (ops.ops[i].op != PixelOps::Op::ChromaKey)
+						continue;
+					const argb32_t *const p = std::find_if(pal, pal + pal_len,
+						[&ops, i](const argb32_t &c) { return c.u32 == ops.ops[i].param; });
+					if (p != pal + pal_len) {
+						backend->tr_idx = static_cast<int>(p - pal);
+						break;
+					}
+				}
+			}
+
+			// Per-pixel operations are applied to the palette.
+			cops.run(pal, pal_len);
+			PixelPipeline::processInPlace(static_cast<uint8_t*>(backend->data()),
+				width, height, backend->stride, ops.flipOp, cops);
+			break;
+		}
+	}
+
+	// Adjust sBIT.
+	// TODO: Only if transparent pixels were found.
+	if (cops.has_chroma_key && d->has_sBIT && d->sBIT.alpha == 0) {
+		d->sBIT.alpha = 1;
+	}
+
+	return 0;
+}
+
+/**
+ * Apply a sequence of operations to a copy of this image.
+ *
+ * Format conversion, flipping, squaring, and all per-pixel
+ * operations are done in a single pass over the image.
+ * CI8 images are converted to ARGB32.
+ *
+ * @param ops Pixel operations.
+ * @return New ARGB32 rp_image, or nullptr on error.
+ */
+rp_image *rp_image::processed(const PixelOps &ops) const
+{
+	RP_D(const rp_image);
+	const rp_image_backend *const backend = d->backend;
+	const int width = backend->width;
+	const int height = backend->height;
+	assert(width > 0);
+	assert(height > 0);
+	if (width <= 0 || height <= 0) {
+		return nullptr;
+	}
+
+	PixelPipeline::CompiledOps cops(ops);
+	const bool has_chroma_key = cops.has_chroma_key;
+
+	// For CI8, the per-pixel operations are applied to a copy
+	// of the palette, so each pixel is just a palette lookup.
+	uint32_t pal[256];
+	switch (backend->format) {
+		default:
+			// Unsupported image format.
+			assert(!"Unsupported rp_image::Format.");
+			return nullptr;
+
+		case Format::ARGB32:
+			break;
+
+		case Format::CI8: {
+			// TODO: Handle palette length smaller than 256.
+			assert(backend->palette_len() == 256);
+			if (backend->palette_len() != 256) {
+				return nullptr;
+			}
+			memcpy(pal, backend->palette(), sizeof(pal));
+			cops.run(reinterpret_cast<argb32_t*>(pal), ARRAY_SIZE_I(pal));
+			cops.count = 0;
+			break;
+		}
+	}
+
+	// Determine the output size.
+	int out_width = width, out_height = height;
+	int addToLeft = 0, addToTop = 0;
+	if (ops.square && width != height) {
+		if (width > height) {
+			// Image is wider. Add rows to the top and bottom.
+			out_height = width;
+			addToTop = (width - height) / 2;
+		} else {
+			// Image is taller. Add columns to the left and right.
+			out_width = height;
+			addToLeft = (height - width) / 2;
+		}
+	}
+	const int addToRight = out_width - width - addToLeft;
+
+	rp_image *const img = new rp_image(out_width, out_height, Format::ARGB32);
+	if (!img->isValid()) {
+		// Could not allocate the image.
+		img->unref();
+		return nullptr;
+	}
+
+	const bool flipH = !!(ops.flipOp & FLIP_H);
+	const bool flipV = !!(ops.flipOp & FLIP_V);
+	const uint8_t *const src_bits = static_cast<const uint8_t*>(backend->data());
+	const int src_stride = backend->stride;
+	const int out_row_bytes = img->row_bytes();
+
+	for (int y = 0; y < out_height; y++) {
+		uint32_t *const dest_row = static_cast<uint32_t*>(img->scanLine(y));
+		const int iy = y - addToTop;
+		if (iy < 0 || iy >= height) {
+			// Transparent row.
+			memset(dest_row, 0, out_row_bytes);
+			continue;
+		}
+
+		// Transparent columns.
+		if (addToLeft > 0) {
+			memset(dest_row, 0, addToLeft * sizeof(uint32_t));
+		}
+		if (addToRight > 0) {
+			memset(&dest_row[addToLeft + width], 0, addToRight * sizeof(uint32_t));
+		}
+
+		// Copy the source row, converting to ARGB32 if necessary.
+		uint32_t *const dest = &dest_row[addToLeft];
+		const uint8_t *const src = src_bits + ((flipV ? (height - 1 - iy) : iy) * src_stride);
+		if (backend->format == Format::CI8) {
+			if (flipH) {
+				for (int x = 0; x < width; x++) {
+					dest[x] = pal[src[width - 1 - x]];
+				}
+			} else {
+				for (int x = 0; x < width; x++) {
+					dest[x] = pal[src[x]];
+				}
+			}
+		} else {
+			const uint32_t *const src32 = reinterpret_cast<const uint32_t*>(src);
+			if (flipH) {
+				std::reverse_copy(src32, src32 + width, dest);
+			} else {
+				memcpy(dest, src32, width * sizeof(uint32_t));
+			}
+		}
+
+		// Apply the per-pixel operations while the row is still in the cache.
+		cops.run(reinterpret_cast<argb32_t*>(dest), width);
+	}
+
+	// Copy sBIT if it's set.
+	if (d->has_sBIT) {
+		sBIT_t sBIT = d->sBIT;
+		if (has_chroma_key && sBIT.alpha == 0) {
+			sBIT.alpha = 1;
+		}
+		img->set_sBIT(&sBIT);
+	}
+
+	return img;
+}
+
+}
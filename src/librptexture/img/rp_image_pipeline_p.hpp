@@ -0,0 +1,88 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (librptexture)                     *
+ * rp_image_pipeline_p.hpp: Image class. (pixel pipeline, private)         *
+ *                                                                         *
+ * Copyright (c) 2016-2022 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#ifndef __ROMPROPERTIES_LIBRPTEXTURE_IMG_RP_IMAGE_PIPELINE_P_HPP__
+#define __ROMPROPERTIES_LIBRPTEXTURE_IMG_RP_IMAGE_PIPELINE_P_HPP__
+
+#include "rp_image.hpp"
+
+/**
+ * Row kernels for per-pixel image operations.
+ *
+ * Each kernel processes a single row of ARGB32 pixels in place.
+ * The whole-image functions (apply_chroma_key(), swapRB(), etc.)
+ * call these once per row, and rp_image::process() / processed()
+ * call several of them on the same row while it's still in L1.
+ *
+ * NOTE: Kernels may be called on the palette of a CI8 image,
+ * so they must not assume any alignment.
+ */
+
+namespace LibRpTexture { namespace PixelPipeline {
+
+/**
+ * Row kernel function.
+ * @param row	[in,out] ARGB32 row.
+ * @param width	[in] Width, in pixels.
+ * @param param	[in] Operation-specific parameter.
+ */
+typedef void (*RowKernel)(argb32_t *row, int width, uint32_t param);
+
+/**
+ * Convert chroma-keyed pixels to transparent.
+ * @param row	[in,out] ARGB32 row.
+ * @param width	[in] Width, in pixels.
+ * @param key	[in] Chroma key color.
+ */
+void chromaKeyRow_cpp(argb32_t *row, int width, uint32_t key);
+#ifdef RP_IMAGE_HAS_SSE2
+void chromaKeyRow_sse2(argb32_t *row, int width, uint32_t key);
+#endif /* RP_IMAGE_HAS_SSE2 */
+
+/**
+ * Swap the Red and Blue channels.
+ * @param row	[in,out] ARGB32 row.
+ * @param width	[in] Width, in pixels.
+ * @param param	[in] Unused.
+ */
+void swapRBRow_cpp(argb32_t *row, int width, uint32_t param);
+#ifdef RP_IMAGE_HAS_SSSE3
+void swapRBRow_ssse3(argb32_t *row, int width, uint32_t param);
+#endif /* RP_IMAGE_HAS_SSSE3 */
+
+/**
+ * Un-premultiply pixels.
+ * @param row	[in,out] ARGB32 row.
+ * @param width	[in] Width, in pixels.
+ * @param param	[in] Unused.
+ */
+void unPremultiplyRow_cpp(argb32_t *row, int width, uint32_t param);
+#ifdef RP_IMAGE_HAS_SSE41
+void unPremultiplyRow_sse41(argb32_t *row, int width, uint32_t param);
+#endif /* RP_IMAGE_HAS_SSE41 */
+#ifdef RP_IMAGE_HAS_AVX2
+void unPremultiplyRow_avx2(argb32_t *row, int width, uint32_t param);
+#endif /* RP_IMAGE_HAS_AVX2 */
+
+/**
+ * Premultiply pixels.
+ * @param row	[in,out] ARGB32 row.
+ * @param width	[in] Width, in pixels.
+ * @param param	[in] Unused.
+ */
+void premultiplyRow_cpp(argb32_t *row, int width, uint32_t param);
+#ifdef RP_IMAGE_HAS_SSSE3
+void premultiplyRow_ssse3(argb32_t *row, int width, uint32_t param);
+#endif /* RP_IMAGE_HAS_SSSE3 */
+#ifdef RP_IMAGE_HAS_AVX2
+void premultiplyRow_avx2(argb32_t *row, int width, uint32_t param);
+#endif /* RP_IMAGE_HAS_AVX2 */
+
+} }
+
+#endif /* __ROMPROPERTIES_LIBRPTEXTURE_IMG_RP_IMAGE_PIPELINE_P_HPP__ */
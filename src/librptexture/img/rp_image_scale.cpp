@@ -0,0 +1,325 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (librptexture)                     *
+ * rp_image_scale.cpp: Image class. (scaling)                              *
+ *                                                                         *
+ * Copyright (c) 2016-2022 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "stdafx.h"
+#include "rp_image.hpp"
+#include "rp_image_scale_p.hpp"
+
+// librpbase
+#include "librpbase/aligned_malloc.h"
+
+// C includes. (C++ namespace)
+#include <cmath>
+
+namespace LibRpTexture { namespace ImageScale {
+
+/**
+ * Calculate the filter coefficients for one dimension.
+ * @param coeffs	[out] Filter coefficients.
+ * @param in_size	[in] Source size.
+ * @param out_size	[in] Destination size.
+ * @param filter	[in] Scaling filter.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int calcScaleCoeffs(ScaleCoeffs &coeffs, int in_size, int out_size, rp_image::ScaleFilter filter)
+{
+	assert(in_size > 0);
+	assert(out_size > 0);
+	if (in_size <= 0 || out_size <= 0) {
+		return -EINVAL;
+	}
+
+	// When downscaling, the filter is widened to cover
+	// all source pixels that map to each output pixel.
+	const double scale = static_cast<double>(in_size) / static_cast<double>(out_size);
+	const double fscale = (scale > 1.0 ? scale : 1.0);
+	const double support = fscale * (filter == rp_image::ScaleFilter::Bilinear ? 1.0 : 0.5);
+
+	// Maximum number of taps, rounded up to an even number.
+	int max_taps = static_cast<int>(ceil(support * 2.0)) + 2;
+	if (max_taps > in_size) {
+		max_taps = in_size;
+	}
+	max_taps = (max_taps + 1) & ~1;
+
+	// Floating-point weights, one output pixel at a time.
+	std::vector<double> fw(max_taps);
+
+	coeffs.taps = 0;
+	coeffs.start.resize(out_size);
+	std::vector<int> count(out_size);
+	std::vector<int16_t> weights(out_size * max_taps);
+	for (int i = 0; i < out_size; i++) {
+		const double center = (i + 0.5) * scale;
+		int xmin = static_cast<int>(floor(center - support));
+		int xmax = static_cast<int>(ceil(center + support));
+		if (xmin < 0) {
+			xmin = 0;
+		}
+		if (xmax > in_size) {
+			xmax = in_size;
+		}
+
+		double total = 0.0;
+		int n = 0;
+		for (int x = xmin; x < xmax && n < max_taps; x++, n++) {
+			double w;
+			if (filter == rp_image::ScaleFilter::Bilinear) {
+				// Triangle filter, sampled at the source pixel center.
+				const double t = fabs((x + 0.5 - center) / fscale);
+				w = (t < 1.0 ? 1.0 - t : 0.0);
+			} else {
+				// Box filter: Coverage of source pixel [x, x+1).
+				const double lo = std::max(static_cast<double>(x), center - support);
+				const double hi = std::min(static_cast<double>(x + 1), center + support);
+				w = (hi > lo ? hi - lo : 0.0);
+			}
+			fw[n] = w;
+			total += w;
+		}
+
+		// Trim zero-weight taps from both ends.
+		int first = 0;
+		while (first < n && fw[first] <= 0.0) {
+			first++;
+		}
+		while (n > first && fw[n-1] <= 0.0) {
+			n--;
+		}
+		if (n <= first || total <= 0.0) {
+			// No coverage. Use the nearest pixel.
+			int x = static_cast<int>(center);
+			if (x >= in_size) {
+				x = in_size - 1;
+			}
+			xmin = x;
+			first = 0;
+			n = 1;
+			fw[0] = 1.0;
+			total = 1.0;
+		}
+
+		// Convert to fixed-point. The weights must sum to exactly
+		// WEIGHT_ONE, so any rounding error is added to the largest weight.
+		int16_t *const pw = &weights[i * max_taps];
+		int sum = 0, largest = 0;
+		for (int j = first; j < n; j++) {
+			const int w = static_cast<int>(lrint(fw[j] * WEIGHT_ONE / total));
+			pw[j - first] = static_cast<int16_t>(w);
+			sum += w;
+			if (w > pw[largest]) {
+				largest = j - first;
+			}
+		}
+		pw[largest] += static_cast<int16_t>(WEIGHT_ONE - sum);
+
+		coeffs.start[i] = xmin + first;
+		count[i] = n - first;
+		if (count[i] > coeffs.taps) {
+			coeffs.taps = count[i];
+		}
+	}
+
+	// Use the same (even) number of taps for all output pixels.
+	// If the taps would run past the end of the source, move the
+	// starting position back and shift the weights to compensate.
+	// NOTE: One extra pixel of padding is allowed.
+	const int taps = (coeffs.taps + 1) & ~1;
+	coeffs.taps = taps;
+	coeffs.weights.assign(out_size * taps, 0);
+	for (int i = 0; i < out_size; i++) {
+		int start = coeffs.start[i];
+		int shift = 0;
+		if (start + taps > in_size + 1) {
+			shift = start + taps - (in_size + 1);
+			start -= shift;
+		}
+		coeffs.start[i] = start;
+		memcpy(&coeffs.weights[i * taps + shift], &weights[i * max_taps], count[i] * sizeof(int16_t));
+	}
+
+	return 0;
+}
+
+/**
+ * Scale an image using the specified kernels.
+ * @param img		[in] Source image.
+ * @param width		[in] New width.
+ * @param height	[in] New height.
+ * @param filter	[in] Scaling filter.
+ * @param kernels	[in] Scaling kernels.
+ * @return Scaled ARGB32 image, or nullptr on error.
+ */
+rp_image *scale(const rp_image *img, int width, int height,
+	rp_image::ScaleFilter filter, const ScaleKernels &kernels)
+{
+	assert(width > 0);
+	assert(height > 0);
+	if (!img->isValid() || width <= 0 || height <= 0) {
+		// Invalid parameters.
+		return nullptr;
+	}
+
+	// Scaling is done in ARGB32.
+	rp_image *tmp_argb32 = nullptr;
+	switch (img->format()) {
+		case rp_image::Format::ARGB32:
+			break;
+		case rp_image::Format::CI8:
+			tmp_argb32 = img->dup_ARGB32();
+			if (!tmp_argb32) {
+				return nullptr;
+			}
+			img = tmp_argb32;
+			break;
+		default:
+			assert(!"Unsupported rp_image::Format.");
+			return nullptr;
+	}
+
+	const int in_w = img->width();
+	const int in_h = img->height();
+
+	ScaleCoeffs cx, cy;
+	if (calcScaleCoeffs(cx, in_w, width, filter) != 0 ||
+	    calcScaleCoeffs(cy, in_h, height, filter) != 0)
+	{
+		UNREF(tmp_argb32);
+		return nullptr;
+	}
+
+	rp_image *const dest = new rp_image(width, height, rp_image::Format::ARGB32);
+	if (!dest->isValid()) {
+		// Could not allocate the image.
+		dest->unref();
+		UNREF(tmp_argb32);
+		return nullptr;
+	}
+
+	// Premultiplied source row, with one zeroed pixel of padding.
+	auto row_buf = aligned_uptr<int16_t>(32, (in_w + 1) * 4);
+	memset(row_buf.get() + (in_w * 4), 0, 4 * sizeof(int16_t));
+
+	// Horizontally-scaled rows, with one zeroed row of padding.
+	const size_t tmp_stride = static_cast<size_t>(width) * 4;
+	auto tmp_buf = aligned_uptr<int16_t>(32, tmp_stride * (in_h + 1));
+	memset(tmp_buf.get() + (tmp_stride * in_h), 0, tmp_stride * sizeof(int16_t));
+
+	// Horizontal pass
+	int16_t *pTmp = tmp_buf.get();
+	for (int y = 0; y < in_h; y++, pTmp += tmp_stride) {
+		kernels.premultiplyRow(row_buf.get(),
+			static_cast<const uint32_t*>(img->scanLine(y)), in_w);
+		kernels.hpass(pTmp, row_buf.get(), cx);
+	}
+
+	// Vertical pass
+	const int16_t *pWeights = cy.weights.data();
+	for (int y = 0; y < height; y++, pWeights += cy.taps) {
+		kernels.vpass(static_cast<uint32_t*>(dest->scanLine(y)),
+			tmp_buf.get() + (tmp_stride * cy.start[y]), tmp_stride,
+			cy.taps, pWeights, width);
+	}
+
+	// Copy the sBIT metadata.
+	rp_image::sBIT_t sBIT;
+	if (img->get_sBIT(&sBIT) == 0) {
+		dest->set_sBIT(&sBIT);
+	}
+
+	UNREF(tmp_argb32);
+	return dest;
+}
+
+/** Standard C++ kernels **/
+
+/**
+ * Expand an ARGB32 row to premultiplied int16_t BGRA.
+ * @param dest	[out] Destination row. (width * 4 values)
+ * @param src	[in] Source row.
+ * @param width	[in] Width, in pixels.
+ */
+static void premultiplyRow_cpp(int16_t *RESTRICT dest, const uint32_t *RESTRICT src, int width)
+{
+	for (; width > 0; width--, src++, dest += 4) {
+		premultiplyPixel(dest, *src);
+	}
+}
+
+/**
+ * Horizontal pass for one row.
+ * @param dest	[out] Destination row. (out_width * 4 values)
+ * @param src	[in] Premultiplied source row. (with one zero pixel of padding)
+ * @param cx	[in] Horizontal filter coefficients.
+ */
+static void hpass_cpp(int16_t *RESTRICT dest, const int16_t *RESTRICT src, const ScaleCoeffs &cx)
+{
+	const int taps = cx.taps;
+	const int16_t *pWeights = cx.weights.data();
+	const auto start_cend = cx.start.cend();
+	for (auto iter = cx.start.cbegin(); iter != start_cend; ++iter, pWeights += taps, dest += 4) {
+		const int16_t *pSrc = &src[*iter * 4];
+		int acc[4] = {1 << (WEIGHT_SHIFT-1), 1 << (WEIGHT_SHIFT-1), 1 << (WEIGHT_SHIFT-1), 1 << (WEIGHT_SHIFT-1)};
+		for (int k = 0; k < taps; k++, pSrc += 4) {
+			const int w = pWeights[k];
+			acc[0] += pSrc[0] * w;
+			acc[1] += pSrc[1] * w;
+			acc[2] += pSrc[2] * w;
+			acc[3] += pSrc[3] * w;
+		}
+		dest[0] = static_cast<int16_t>(acc[0] >> WEIGHT_SHIFT);
+		dest[1] = static_cast<int16_t>(acc[1] >> WEIGHT_SHIFT);
+		dest[2] = static_cast<int16_t>(acc[2] >> WEIGHT_SHIFT);
+		dest[3] = static_cast<int16_t>(acc[3] >> WEIGHT_SHIFT);
+	}
+}
+
+/**
+ * Vertical pass for one row. This also un-premultiplies the pixels.
+ * @param dest		[out] Destination ARGB32 row.
+ * @param src		[in] First source row for this output row.
+ * @param src_stride	[in] Source stride, in int16_t units.
+ * @param taps		[in] Number of taps. (always even)
+ * @param weights	[in] Weights for this output row.
+ * @param width		[in] Width, in pixels.
+ */
+static void vpass_cpp(uint32_t *RESTRICT dest, const int16_t *RESTRICT src, size_t src_stride,
+	int taps, const int16_t *RESTRICT weights, int width)
+{
+	for (; width > 0; width--, src += 4, dest++) {
+		*dest = vpassPixel(src, src_stride, taps, weights);
+	}
+}
+
+} }
+
+namespace LibRpTexture {
+
+/**
+ * Scale the rp_image.
+ * Standard version using regular C++ code.
+ *
+ * Alpha is handled correctly by filtering premultiplied pixels.
+ * CI8 images are converted to ARGB32.
+ *
+ * @param width New width
+ * @param height New height
+ * @param filter Scaling filter
+ * @return New ARGB32 rp_image with a scaled version of the original, or nullptr on error.
+ */
+rp_image *rp_image::scaled_cpp(int width, int height, ScaleFilter filter) const
+{
+	static const ImageScale::ScaleKernels kernels = {
+		ImageScale::premultiplyRow_cpp,
+		ImageScale::hpass_cpp,
+		ImageScale::vpass_cpp,
+	};
+	return ImageScale::scale(this, width, height, filter, kernels);
+}
+
+}
@@ -0,0 +1,205 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (librptexture)                     *
+ * rp_image_scale_avx2.cpp: Image class. (scaling)                         *
+ * AVX2-optimized version.                                                 *
+ *                                                                         *
+ * Copyright (c) 2016-2022 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "stdafx.h"
+#include "rp_image.hpp"
+#include "rp_image_scale_p.hpp"
+
+// AVX2 intrinsics
+#include <immintrin.h>
+
+namespace LibRpTexture { namespace ImageScale {
+
+/**
+ * Un-premultiply four filtered pixels and pack them as ARGB32.
+ * @param px02	[in] Pixels 0 and 2, as four int32_t values each. (B,G,R,A)
+ * @param px13	[in] Pixels 1 and 3, as four int32_t values each. (B,G,R,A)
+ * @return Four ARGB32 pixels.
+ */
+static FORCEINLINE __m128i unpremultiply4(__m256i px02, __m256i px13)
+{
+	// NOTE: This must match unpremultiplyPixel() exactly.
+	const __m256 ps_255 = _mm256_set1_ps(255.0f);
+	const __m256 ps_1 = _mm256_set1_ps(1.0f);
+	const __m256 ps_a_scale = _mm256_set1_ps(2.0f / 255.0f);
+	const __m256i alpha_mask = _mm256_setr_epi32(0, 0, 0, -1, 0, 0, 0, -1);
+
+	const __m256 f0 = _mm256_cvtepi32_ps(px02);
+	const __m256 f1 = _mm256_cvtepi32_ps(px13);
+	const __m256 a0 = _mm256_shuffle_ps(f0, f0, _MM_SHUFFLE(3,3,3,3));
+	const __m256 a1 = _mm256_shuffle_ps(f1, f1, _MM_SHUFFLE(3,3,3,3));
+	const __m256 inv0 = _mm256_div_ps(ps_255, _mm256_max_ps(a0, ps_1));
+	const __m256 inv1 = _mm256_div_ps(ps_255, _mm256_max_ps(a1, ps_1));
+
+	__m256i c0 = _mm256_cvtps_epi32(_mm256_mul_ps(f0, inv0));
+	__m256i c1 = _mm256_cvtps_epi32(_mm256_mul_ps(f1, inv1));
+	const __m256i ca0 = _mm256_cvtps_epi32(_mm256_mul_ps(a0, ps_a_scale));
+	const __m256i ca1 = _mm256_cvtps_epi32(_mm256_mul_ps(a1, ps_a_scale));
+	c0 = _mm256_blendv_epi8(c0, ca0, alpha_mask);
+	c1 = _mm256_blendv_epi8(c1, ca1, alpha_mask);
+
+	// Saturate to 8-bit.
+	// Lane 0 has pixels 0 and 1; lane 1 has pixels 2 and 3.
+	__m256i px = _mm256_packs_epi32(c0, c1);
+	px = _mm256_packus_epi16(px, px);
+	px = _mm256_permute4x64_epi64(px, _MM_SHUFFLE(3,1,2,0));
+	return _mm256_castsi256_si128(px);
+}
+
+/**
+ * Expand an ARGB32 row to premultiplied int16_t BGRA.
+ * @param dest	[out] Destination row. (width * 4 values)
+ * @param src	[in] Source row.
+ * @param width	[in] Width, in pixels.
+ */
+static void premultiplyRow_avx2(int16_t *RESTRICT dest, const uint32_t *RESTRICT src, int width)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i alpha_mask = _mm256_setr_epi16(0, 0, 0, -1, 0, 0, 0, -1, 0, 0, 0, -1, 0, 0, 0, -1);
+	const __m256i alpha_255 = _mm256_and_si256(_mm256_set1_epi16(255), alpha_mask);
+	const __m256i shuf_alpha = _mm256_setr_epi8(
+		6,7,6,7,6,7,6,7, 14,15,14,15,14,15,14,15,
+		6,7,6,7,6,7,6,7, 14,15,14,15,14,15,14,15);
+
+	// Process 8 pixels per iteration.
+	for (; width > 7; width -= 8, src += 8, dest += 32) {
+		// Reorder the qwords so the in-lane unpack results are sequential.
+		__m256i px = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src));
+		px = _mm256_permute4x64_epi64(px, _MM_SHUFFLE(3,1,2,0));
+		__m256i lo = _mm256_unpacklo_epi8(px, zero);
+		__m256i hi = _mm256_unpackhi_epi8(px, zero);
+
+		// Multiply B,G,R by A, and A by 255.
+		__m256i a_lo = _mm256_shuffle_epi8(lo, shuf_alpha);
+		__m256i a_hi = _mm256_shuffle_epi8(hi, shuf_alpha);
+		a_lo = _mm256_blendv_epi8(a_lo, alpha_255, alpha_mask);
+		a_hi = _mm256_blendv_epi8(a_hi, alpha_255, alpha_mask);
+		lo = _mm256_srli_epi16(_mm256_mullo_epi16(lo, a_lo), 1);
+		hi = _mm256_srli_epi16(_mm256_mullo_epi16(hi, a_hi), 1);
+
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(dest), lo);
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(dest + 16), hi);
+	}
+
+	// Remaining pixels.
+	for (; width > 0; width--, src++, dest += 4) {
+		premultiplyPixel(dest, *src);
+	}
+}
+
+/**
+ * Horizontal pass for one row.
+ * @param dest	[out] Destination row. (out_width * 4 values)
+ * @param src	[in] Premultiplied source row. (with one zero pixel of padding)
+ * @param cx	[in] Horizontal filter coefficients.
+ */
+static void hpass_avx2(int16_t *RESTRICT dest, const int16_t *RESTRICT src, const ScaleCoeffs &cx)
+{
+	const __m128i rnd = _mm_set1_epi32(1 << (WEIGHT_SHIFT-1));
+	const __m256i wperm = _mm256_setr_epi32(0, 0, 0, 0, 1, 1, 1, 1);
+	const int taps = cx.taps;
+	const int16_t *pWeights = cx.weights.data();
+	const auto start_cend = cx.start.cend();
+	for (auto iter = cx.start.cbegin(); iter != start_cend; ++iter, pWeights += taps, dest += 4) {
+		const int16_t *pSrc = &src[*iter * 4];
+		__m256i acc256 = _mm256_setzero_si256();
+		int k = 0;
+
+		// Four taps per iteration.
+		// Lane 0 has taps 0 and 1; lane 1 has taps 2 and 3.
+		for (; k + 4 <= taps; k += 4, pSrc += 16) {
+			__m256i px = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pSrc));
+			px = _mm256_unpacklo_epi16(px, _mm256_srli_si256(px, 8));
+			int64_t wq;
+			memcpy(&wq, &pWeights[k], sizeof(wq));
+			const __m256i w = _mm256_permutevar8x32_epi32(_mm256_set1_epi64x(wq), wperm);
+			acc256 = _mm256_add_epi32(acc256, _mm256_madd_epi16(px, w));
+		}
+		__m128i acc = _mm_add_epi32(rnd, _mm_add_epi32(
+			_mm256_castsi256_si128(acc256), _mm256_extracti128_si256(acc256, 1)));
+
+		// Remaining two taps.
+		if (k < taps) {
+			__m128i px = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc));
+			px = _mm_unpacklo_epi16(px, _mm_srli_si128(px, 8));
+			int32_t wp;
+			memcpy(&wp, &pWeights[k], sizeof(wp));
+			acc = _mm_add_epi32(acc, _mm_madd_epi16(px, _mm_set1_epi32(wp)));
+		}
+
+		acc = _mm_srai_epi32(acc, WEIGHT_SHIFT);
+		_mm_storel_epi64(reinterpret_cast<__m128i*>(dest), _mm_packs_epi32(acc, acc));
+	}
+}
+
+/**
+ * Vertical pass for one row. This also un-premultiplies the pixels.
+ * @param dest		[out] Destination ARGB32 row.
+ * @param src		[in] First source row for this output row.
+ * @param src_stride	[in] Source stride, in int16_t units.
+ * @param taps		[in] Number of taps. (always even)
+ * @param weights	[in] Weights for this output row.
+ * @param width		[in] Width, in pixels.
+ */
+static void vpass_avx2(uint32_t *RESTRICT dest, const int16_t *RESTRICT src, size_t src_stride,
+	int taps, const int16_t *RESTRICT weights, int width)
+{
+	const __m256i rnd = _mm256_set1_epi32(1 << (WEIGHT_SHIFT-1));
+
+	// Process 4 pixels per iteration.
+	for (; width > 3; width -= 4, src += 16, dest += 4) {
+		const int16_t *pSrc = src;
+		__m256i acc02 = rnd, acc13 = rnd;
+		for (int k = 0; k < taps; k += 2, pSrc += src_stride * 2) {
+			const __m256i r0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pSrc));
+			const __m256i r1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pSrc + src_stride));
+			int32_t wp;
+			memcpy(&wp, &weights[k], sizeof(wp));
+			const __m256i w = _mm256_set1_epi32(wp);
+			acc02 = _mm256_add_epi32(acc02, _mm256_madd_epi16(_mm256_unpacklo_epi16(r0, r1), w));
+			acc13 = _mm256_add_epi32(acc13, _mm256_madd_epi16(_mm256_unpackhi_epi16(r0, r1), w));
+		}
+		acc02 = _mm256_srai_epi32(acc02, WEIGHT_SHIFT);
+		acc13 = _mm256_srai_epi32(acc13, WEIGHT_SHIFT);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dest), unpremultiply4(acc02, acc13));
+	}
+
+	// Remaining pixels.
+	for (; width > 0; width--, src += 4, dest++) {
+		*dest = vpassPixel(src, src_stride, taps, weights);
+	}
+}
+
+} }
+
+namespace LibRpTexture {
+
+/**
+ * Scale the rp_image.
+ * AVX2-optimized version.
+ *
+ * Alpha is handled correctly by filtering premultiplied pixels.
+ * CI8 images are converted to ARGB32.
+ *
+ * @param width New width
+ * @param height New height
+ * @param filter Scaling filter
+ * @return New ARGB32 rp_image with a scaled version of the original, or nullptr on error.
+ */
+rp_image *rp_image::scaled_avx2(int width, int height, ScaleFilter filter) const
+{
+	static const ImageScale::ScaleKernels kernels = {
+		ImageScale::premultiplyRow_avx2,
+		ImageScale::hpass_avx2,
+		ImageScale::vpass_avx2,
+	};
+	return ImageScale::scale(this, width, height, filter, kernels);
+}
+
+}
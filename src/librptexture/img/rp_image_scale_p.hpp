@@ -0,0 +1,173 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (librptexture)                     *
+ * rp_image_scale_p.hpp: Image class. (scaling, private)                   *
+ *                                                                         *
+ * Copyright (c) 2016-2022 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#ifndef __ROMPROPERTIES_LIBRPTEXTURE_IMG_RP_IMAGE_SCALE_P_HPP__
+#define __ROMPROPERTIES_LIBRPTEXTURE_IMG_RP_IMAGE_SCALE_P_HPP__
+
+#include "rp_image.hpp"
+
+// C includes.
+#include <math.h>
+
+// C++ includes.
+#include <vector>
+
+/**
+ * Scaling is done in two separable passes on premultiplied pixels.
+ *
+ * Each source row is first expanded to four int16_t channels per pixel
+ * in B,G,R,A order. Color channels are stored as (c * a) >> 1, and the
+ * alpha channel is stored as (a * 255) >> 1, so all channels have the
+ * same scale and fit in a signed 16-bit value. (max 32512)
+ *
+ * Filter weights are 14-bit fixed point and always sum to 16384.
+ * Tap counts are padded to an even number so the SIMD versions can
+ * process two taps at a time with pmaddwd. The extra taps have zero
+ * weight and may point one pixel (or row) past the end of the source,
+ * so the source buffers are allocated with one extra zeroed pixel/row.
+ *
+ * The vertical pass un-premultiplies and converts back to ARGB32.
+ */
+
+namespace LibRpTexture { namespace ImageScale {
+
+// Fixed-point precision of the filter weights.
+static const unsigned int WEIGHT_SHIFT = 14;
+static const int WEIGHT_ONE = (1 << WEIGHT_SHIFT);
+
+/**
+ * Filter coefficients for one dimension.
+ */
+struct ScaleCoeffs {
+	int taps;			// Number of taps per output pixel. (always even)
+	std::vector<int> start;		// Index of the first source pixel for each output pixel
+	std::vector<int16_t> weights;	// Weights: [out_size][taps]
+};
+
+/**
+ * Calculate the filter coefficients for one dimension.
+ * @param coeffs	[out] Filter coefficients.
+ * @param in_size	[in] Source size.
+ * @param out_size	[in] Destination size.
+ * @param filter	[in] Scaling filter.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int calcScaleCoeffs(ScaleCoeffs &coeffs, int in_size, int out_size, rp_image::ScaleFilter filter);
+
+/**
+ * Scaling kernels for a specific instruction set.
+ */
+struct ScaleKernels {
+	/**
+	 * Expand an ARGB32 row to premultiplied int16_t BGRA.
+	 * @param dest	[out] Destination row. (width * 4 values)
+	 * @param src	[in] Source row.
+	 * @param width	[in] Width, in pixels.
+	 */
+	void (*premultiplyRow)(int16_t *RESTRICT dest, const uint32_t *RESTRICT src, int width);
+
+	/**
+	 * Horizontal pass for one row.
+	 * @param dest	[out] Destination row. (out_width * 4 values)
+	 * @param src	[in] Premultiplied source row. (with one zero pixel of padding)
+	 * @param cx	[in] Horizontal filter coefficients.
+	 */
+	void (*hpass)(int16_t *RESTRICT dest, const int16_t *RESTRICT src, const ScaleCoeffs &cx);
+
+	/**
+	 * Vertical pass for one row. This also un-premultiplies the pixels.
+	 * @param dest		[out] Destination ARGB32 row.
+	 * @param src		[in] First source row for this output row.
+	 * @param src_stride	[in] Source stride, in int16_t units.
+	 * @param taps		[in] Number of taps. (always even)
+	 * @param weights	[in] Weights for this output row.
+	 * @param width		[in] Width, in pixels.
+	 */
+	void (*vpass)(uint32_t *RESTRICT dest, const int16_t *RESTRICT src, size_t src_stride,
+		int taps, const int16_t *RESTRICT weights, int width);
+};
+
+/**
+ * Scale an image using the specified kernels.
+ * @param img		[in] Source image.
+ * @param width		[in] New width.
+ * @param height	[in] New height.
+ * @param filter	[in] Scaling filter.
+ * @param kernels	[in] Scaling kernels.
+ * @return Scaled ARGB32 image, or nullptr on error.
+ */
+rp_image *scale(const rp_image *img, int width, int height,
+	rp_image::ScaleFilter filter, const ScaleKernels &kernels);
+
+/**
+ * Convert a filtered premultiplied pixel back to ARGB32.
+ * The SIMD versions use the same float operations, so the
+ * results are bit-identical.
+ * @param b	[in] Blue
+ * @param g	[in] Green
+ * @param r	[in] Red
+ * @param a	[in] Alpha
+ * @return ARGB32 pixel.
+ */
+static inline uint32_t unpremultiplyPixel(int b, int g, int r, int a)
+{
+	// Color channels are (c * a) >> 1; alpha is (a * 255) >> 1.
+	const float inv = 255.0f / static_cast<float>(a > 0 ? a : 1);
+	const float a_scale = 2.0f / 255.0f;
+	int cb = static_cast<int>(lrintf(static_cast<float>(b) * inv));
+	int cg = static_cast<int>(lrintf(static_cast<float>(g) * inv));
+	int cr = static_cast<int>(lrintf(static_cast<float>(r) * inv));
+	int ca = static_cast<int>(lrintf(static_cast<float>(a) * a_scale));
+	if (cb > 255) cb = 255;
+	if (cg > 255) cg = 255;
+	if (cr > 255) cr = 255;
+	if (ca > 255) ca = 255;
+	return (static_cast<uint32_t>(ca) << 24) | (static_cast<uint32_t>(cr) << 16) |
+	       (static_cast<uint32_t>(cg) <<  8) |  static_cast<uint32_t>(cb);
+}
+
+/**
+ * Expand an ARGB32 pixel to premultiplied int16_t BGRA.
+ * @param dest	[out] Destination. (4 values)
+ * @param px	[in] ARGB32 pixel.
+ */
+static inline void premultiplyPixel(int16_t *dest, uint32_t px)
+{
+	const unsigned int a = (px >> 24);
+	dest[0] = static_cast<int16_t>((( px        & 0xFF) * a) >> 1);
+	dest[1] = static_cast<int16_t>((((px >>  8) & 0xFF) * a) >> 1);
+	dest[2] = static_cast<int16_t>((((px >> 16) & 0xFF) * a) >> 1);
+	dest[3] = static_cast<int16_t>((a * 255) >> 1);
+}
+
+/**
+ * Vertical pass for a single pixel.
+ * @param src		[in] First source pixel.
+ * @param src_stride	[in] Source stride, in int16_t units.
+ * @param taps		[in] Number of taps.
+ * @param weights	[in] Weights for this output row.
+ * @return ARGB32 pixel.
+ */
+static inline uint32_t vpassPixel(const int16_t *src, size_t src_stride, int taps, const int16_t *weights)
+{
+	int acc[4] = {1 << (WEIGHT_SHIFT-1), 1 << (WEIGHT_SHIFT-1), 1 << (WEIGHT_SHIFT-1), 1 << (WEIGHT_SHIFT-1)};
+	for (int k = 0; k < taps; k++, src += src_stride) {
+		const int w = weights[k];
+		acc[0] += src[0] * w;
+		acc[1] += src[1] * w;
+		acc[2] += src[2] * w;
+		acc[3] += src[3] * w;
+	}
+	return unpremultiplyPixel(
+		acc[0] >> WEIGHT_SHIFT, acc[1] >> WEIGHT_SHIFT,
+		acc[2] >> WEIGHT_SHIFT, acc[3] >> WEIGHT_SHIFT);
+}
+
+} }
+
+#endif /* __ROMPROPERTIES_LIBRPTEXTURE_IMG_RP_IMAGE_SCALE_P_HPP__ */
@@ -0,0 +1,188 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (librptexture)                     *
+ * rp_image_scale_sse2.cpp: Image class. (scaling)                         *
+ * SSE2-optimized version.                                                 *
+ *                                                                         *
+ * Copyright (c) 2016-2022 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "stdafx.h"
+#include "rp_image.hpp"
+#include "rp_image_scale_p.hpp"
+
+// SSE2 intrinsics
+#include <emmintrin.h>
+
+namespace LibRpTexture { namespace ImageScale {
+
+/**
+ * Broadcast a pair of 16-bit weights to all 32-bit lanes.
+ * @param pWeights	[in] Two weights.
+ * @return __m128i with (w0, w1) in each 32-bit lane.
+ */
+static FORCEINLINE __m128i loadWeightPair(const int16_t *pWeights)
+{
+	int32_t wp;
+	memcpy(&wp, pWeights, sizeof(wp));
+	return _mm_set1_epi32(wp);
+}
+
+/**
+ * Un-premultiply two filtered pixels and pack them as ARGB32.
+ * @param px0	[in] Pixel 0, as four int32_t values. (B,G,R,A)
+ * @param px1	[in] Pixel 1, as four int32_t values. (B,G,R,A)
+ * @return Two ARGB32 pixels in the low 64 bits.
+ */
+static FORCEINLINE __m128i unpremultiply2(__m128i px0, __m128i px1)
+{
+	// NOTE: This must match unpremultiplyPixel() exactly.
+	const __m128 ps_255 = _mm_set1_ps(255.0f);
+	const __m128 ps_1 = _mm_set1_ps(1.0f);
+	const __m128 ps_a_scale = _mm_set1_ps(2.0f / 255.0f);
+	const __m128i alpha_mask = _mm_setr_epi32(0, 0, 0, -1);
+
+	__m128 f0 = _mm_cvtepi32_ps(px0);
+	__m128 f1 = _mm_cvtepi32_ps(px1);
+	const __m128 a0 = _mm_shuffle_ps(f0, f0, _MM_SHUFFLE(3,3,3,3));
+	const __m128 a1 = _mm_shuffle_ps(f1, f1, _MM_SHUFFLE(3,3,3,3));
+	const __m128 inv0 = _mm_div_ps(ps_255, _mm_max_ps(a0, ps_1));
+	const __m128 inv1 = _mm_div_ps(ps_255, _mm_max_ps(a1, ps_1));
+
+	__m128i c0 = _mm_cvtps_epi32(_mm_mul_ps(f0, inv0));
+	__m128i c1 = _mm_cvtps_epi32(_mm_mul_ps(f1, inv1));
+	const __m128i ca0 = _mm_cvtps_epi32(_mm_mul_ps(a0, ps_a_scale));
+	const __m128i ca1 = _mm_cvtps_epi32(_mm_mul_ps(a1, ps_a_scale));
+	c0 = _mm_or_si128(_mm_andnot_si128(alpha_mask, c0), _mm_and_si128(alpha_mask, ca0));
+	c1 = _mm_or_si128(_mm_andnot_si128(alpha_mask, c1), _mm_and_si128(alpha_mask, ca1));
+
+	// Saturate to 8-bit.
+	const __m128i px16 = _mm_packs_epi32(c0, c1);
+	return _mm_packus_epi16(px16, px16);
+}
+
+/**
+ * Expand an ARGB32 row to premultiplied int16_t BGRA.
+ * @param dest	[out] Destination row. (width * 4 values)
+ * @param src	[in] Source row.
+ * @param width	[in] Width, in pixels.
+ */
+static void premultiplyRow_sse2(int16_t *RESTRICT dest, const uint32_t *RESTRICT src, int width)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i alpha_mask = _mm_setr_epi16(0, 0, 0, -1, 0, 0, 0, -1);
+	const __m128i alpha_255 = _mm_and_si128(_mm_set1_epi16(255), alpha_mask);
+
+	// Process 4 pixels per iteration.
+	for (; width > 3; width -= 4, src += 4, dest += 16) {
+		const __m128i px = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+		__m128i lo = _mm_unpacklo_epi8(px, zero);
+		__m128i hi = _mm_unpackhi_epi8(px, zero);
+
+		// Multiply B,G,R by A, and A by 255.
+		__m128i a_lo = _mm_shufflehi_epi16(_mm_shufflelo_epi16(lo, _MM_SHUFFLE(3,3,3,3)), _MM_SHUFFLE(3,3,3,3));
+		__m128i a_hi = _mm_shufflehi_epi16(_mm_shufflelo_epi16(hi, _MM_SHUFFLE(3,3,3,3)), _MM_SHUFFLE(3,3,3,3));
+		a_lo = _mm_or_si128(_mm_andnot_si128(alpha_mask, a_lo), alpha_255);
+		a_hi = _mm_or_si128(_mm_andnot_si128(alpha_mask, a_hi), alpha_255);
+		lo = _mm_srli_epi16(_mm_mullo_epi16(lo, a_lo), 1);
+		hi = _mm_srli_epi16(_mm_mullo_epi16(hi, a_hi), 1);
+
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dest), lo);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dest + 8), hi);
+	}
+
+	// Remaining pixels.
+	for (; width > 0; width--, src++, dest += 4) {
+		premultiplyPixel(dest, *src);
+	}
+}
+
+/**
+ * Horizontal pass for one row.
+ * @param dest	[out] Destination row. (out_width * 4 values)
+ * @param src	[in] Premultiplied source row. (with one zero pixel of padding)
+ * @param cx	[in] Horizontal filter coefficients.
+ */
+static void hpass_sse2(int16_t *RESTRICT dest, const int16_t *RESTRICT src, const ScaleCoeffs &cx)
+{
+	const __m128i rnd = _mm_set1_epi32(1 << (WEIGHT_SHIFT-1));
+	const int taps = cx.taps;
+	const int16_t *pWeights = cx.weights.data();
+	const auto start_cend = cx.start.cend();
+	for (auto iter = cx.start.cbegin(); iter != start_cend; ++iter, pWeights += taps, dest += 4) {
+		const int16_t *pSrc = &src[*iter * 4];
+		__m128i acc = rnd;
+		for (int k = 0; k < taps; k += 2, pSrc += 8) {
+			// Interleave two pixels: b0 b1 g0 g1 r0 r1 a0 a1
+			__m128i px = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc));
+			px = _mm_unpacklo_epi16(px, _mm_srli_si128(px, 8));
+			acc = _mm_add_epi32(acc, _mm_madd_epi16(px, loadWeightPair(&pWeights[k])));
+		}
+		acc = _mm_srai_epi32(acc, WEIGHT_SHIFT);
+		_mm_storel_epi64(reinterpret_cast<__m128i*>(dest), _mm_packs_epi32(acc, acc));
+	}
+}
+
+/**
+ * Vertical pass for one row. This also un-premultiplies the pixels.
+ * @param dest		[out] Destination ARGB32 row.
+ * @param src		[in] First source row for this output row.
+ * @param src_stride	[in] Source stride, in int16_t units.
+ * @param taps		[in] Number of taps. (always even)
+ * @param weights	[in] Weights for this output row.
+ * @param width		[in] Width, in pixels.
+ */
+static void vpass_sse2(uint32_t *RESTRICT dest, const int16_t *RESTRICT src, size_t src_stride,
+	int taps, const int16_t *RESTRICT weights, int width)
+{
+	const __m128i rnd = _mm_set1_epi32(1 << (WEIGHT_SHIFT-1));
+
+	// Process 2 pixels per iteration.
+	for (; width > 1; width -= 2, src += 8, dest += 2) {
+		const int16_t *pSrc = src;
+		__m128i acc0 = rnd, acc1 = rnd;
+		for (int k = 0; k < taps; k += 2, pSrc += src_stride * 2) {
+			const __m128i r0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc));
+			const __m128i r1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc + src_stride));
+			const __m128i w = loadWeightPair(&weights[k]);
+			acc0 = _mm_add_epi32(acc0, _mm_madd_epi16(_mm_unpacklo_epi16(r0, r1), w));
+			acc1 = _mm_add_epi32(acc1, _mm_madd_epi16(_mm_unpackhi_epi16(r0, r1), w));
+		}
+		acc0 = _mm_srai_epi32(acc0, WEIGHT_SHIFT);
+		acc1 = _mm_srai_epi32(acc1, WEIGHT_SHIFT);
+		_mm_storel_epi64(reinterpret_cast<__m128i*>(dest), unpremultiply2(acc0, acc1));
+	}
+
+	// Remaining pixel.
+	if (width > 0) {
+		*dest = vpassPixel(src, src_stride, taps, weights);
+	}
+}
+
+} }
+
+namespace LibRpTexture {
+
+/**
+ * Scale the rp_image.
+ * SSE2-optimized version.
+ *
+ * Alpha is handled correctly by filtering premultiplied pixels.
+ * CI8 images are converted to ARGB32.
+ *
+ * @param width New width
+ * @param height New height
+ * @param filter Scaling filter
+ * @return New ARGB32 rp_image with a scaled version of the original, or nullptr on error.
+ */
+rp_image *rp_image::scaled_sse2(int width, int height, ScaleFilter filter) const
+{
+	static const ImageScale::ScaleKernels kernels = {
+		ImageScale::premultiplyRow_sse2,
+		ImageScale::hpass_sse2,
+		ImageScale::vpass_sse2,
+	};
+	return ImageScale::scale(this, width, height, filter, kernels);
+}
+
+}
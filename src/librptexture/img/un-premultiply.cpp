@@ -11,6 +11,7 @@
 #include "rp_image.hpp"
 #include "rp_image_p.hpp"
 #include "rp_image_backend.hpp"
+#include "rp_image_pipeline_p.hpp"
 
 // Workaround for RP_D() expecting the no-underscore, UpperCamelCase naming convention.
 #define rp_imagePrivate rp_image_private
@@ -85,6 +86,24 @@ static FORCEINLINE uint32_t un_premultiply_pixel(uint32_t px)
 	return rpx.u32;
 }
 
+/**
+ * Un-premultiply pixels.
+ * @param row	[in,out] ARGB32 row.
+ * @param width	[in] Width, in pixels.
+ * @param param	[in] Unused.
+ */
+void PixelPipeline::unPremultiplyRow_cpp(argb32_t *row, int width, uint32_t param)
+{
+	RP_UNUSED(param);
+	for (; width > 1; width -= 2, row += 2) {
+		row[0].u32 = un_premultiply_pixel(row[0].u32);
+		row[1].u32 = un_premultiply_pixel(row[1].u32);
+	}
+	if (width == 1) {
+		row->u32 = un_premultiply_pixel(row->u32);
+	}
+}
+
 /**
  * Un-premultiply an ARGB32 rp_image.
  * Standard version using regular C++ code.
@@ -105,17 +124,9 @@ int rp_image::un_premultiply_cpp(void)
 
 	const int width = backend->width;
 	argb32_t *px_dest = static_cast<argb32_t*>(backend->data());
-	int dest_stride_adj = (backend->stride / sizeof(*px_dest)) - width;
-	for (int y = backend->height; y > 0; y--, px_dest += dest_stride_adj) {
-		int x = width;
-		for (; x > 1; x -= 2, px_dest += 2) {
-			px_dest[0].u32 = un_premultiply_pixel(px_dest[0].u32);
-			px_dest[1].u32 = un_premultiply_pixel(px_dest[1].u32);
-		}
-		if (x == 1) {
-			px_dest->u32 = un_premultiply_pixel(px_dest->u32);
-			px_dest++;
-		}
+	const int dest_stride = backend->stride / sizeof(*px_dest);
+	for (int y = backend->height; y > 0; y--, px_dest += dest_stride) {
+		PixelPipeline::unPremultiplyRow_cpp(px_dest, width, 0);
 	}
 	return 0;
 }
@@ -157,17 +168,34 @@ uint32_t rp_image::premultiply_pixel(uint32_t px)
 	return premultiply_pixel_inl(px);
 }
 
+/**
+ * Premultiply pixels.
+ * @param row	[in,out] ARGB32 row.
+ * @param width	[in] Width, in pixels.
+ * @param param	[in] Unused.
+ */
+void PixelPipeline::premultiplyRow_cpp(argb32_t *row, int width, uint32_t param)
+{
+	RP_UNUSED(param);
+	for (; width > 1; width -= 2, row += 2) {
+		row[0].u32 = premultiply_pixel_inl(row[0].u32);
+		row[1].u32 = premultiply_pixel_inl(row[1].u32);
+	}
+	if (width == 1) {
+		row->u32 = premultiply_pixel_inl(row->u32);
+	}
+}
+
 /**
  * Premultiply an ARGB32 rp_image.
+ * Standard version using regular C++ code.
  *
  * Image must be ARGB32.
  *
  * @return 0 on success; non-zero on error.
  */
-int rp_image::premultiply(void)
+int rp_image::premultiply_cpp(void)
 {
-	// TODO: Qt doesn't have SSE-optimized builds.
-
 	RP_D(const rp_image);
 	rp_image_backend *const backend = d->backend;
 	assert(backend->format == rp_image::Format::ARGB32);
@@ -178,17 +206,9 @@ int rp_image::premultiply(void)
 
 	const int width = backend->width;
 	argb32_t *px_dest = static_cast<argb32_t*>(backend->data());
-	int dest_stride_adj = (backend->stride / sizeof(*px_dest)) - width;
-	for (int y = backend->height; y > 0; y--, px_dest += dest_stride_adj) {
-		int x = width;
-		for (; x > 1; x -= 2, px_dest += 2) {
-			px_dest[0].u32 = premultiply_pixel_inl(px_dest[0].u32);
-			px_dest[1].u32 = premultiply_pixel_inl(px_dest[1].u32);
-		}
-		if (x == 1) {
-			px_dest->u32 = premultiply_pixel_inl(px_dest->u32);
-			px_dest++;
-		}
+	const int dest_stride = backend->stride / sizeof(*px_dest);
+	for (int y = backend->height; y > 0; y--, px_dest += dest_stride) {
+		PixelPipeline::premultiplyRow_cpp(px_dest, width, 0);
 	}
 	return 0;
 }
@@ -11,6 +11,7 @@
 #include "rp_image.hpp"
 #include "rp_image_p.hpp"
 #include "rp_image_backend.hpp"
+#include "rp_image_pipeline_p.hpp"
 
 // SSE4.1 headers.
 #include <emmintrin.h>
@@ -49,6 +50,25 @@ static FORCEINLINE void un_premultiply_pixel_sse41(argb32_t &px)
 	px.u32 = _mm_cvtsi128_si32(vl);
 }
 
+/**
+ * Un-premultiply pixels.
+ * SSE4.1-optimized version.
+ * @param row	[in,out] ARGB32 row.
+ * @param width	[in] Width, in pixels.
+ * @param param	[in] Unused.
+ */
+void PixelPipeline::unPremultiplyRow_sse41(argb32_t *row, int width, uint32_t param)
+{
+	RP_UNUSED(param);
+	for (; width > 1; width -= 2, row += 2) {
+		un_premultiply_pixel_sse41(row[0]);
+		un_premultiply_pixel_sse41(row[1]);
+	}
+	if (width == 1) {
+		un_premultiply_pixel_sse41(*row);
+	}
+}
+
 /**
  * Un-premultiply an ARGB32 rp_image.
  * Image must be ARGB32.
@@ -66,17 +86,9 @@ int rp_image::un_premultiply_sse41(void)
 
 	const int width = backend->width;
 	argb32_t *px_dest = static_cast<argb32_t*>(backend->data());
-	int dest_stride_adj = (backend->stride / sizeof(*px_dest)) - width;
-	for (int y = backend->height; y > 0; y--, px_dest += dest_stride_adj) {
-		int x = width;
-		for (; x > 1; x -= 2, px_dest += 2) {
-			un_premultiply_pixel_sse41(px_dest[0]);
-			un_premultiply_pixel_sse41(px_dest[1]);
-		}
-		if (x == 1) {
-			un_premultiply_pixel_sse41(*px_dest);
-			px_dest++;
-		}
+	const int dest_stride = backend->stride / sizeof(*px_dest);
+	for (int y = backend->height; y > 0; y--, px_dest += dest_stride) {
+		PixelPipeline::unPremultiplyRow_sse41(px_dest, width, 0);
 	}
 	return 0;
 }
@@ -0,0 +1,118 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (librptexture)                     *
+ * un-premultiply_ssse3.cpp: Premultiply function.                         *
+ * SSSE3-optimized version.                                                *
+ *                                                                         *
+ * Copyright (c) 2017-2022 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "stdafx.h"
+#include "rp_image.hpp"
+#include "rp_image_p.hpp"
+#include "rp_image_backend.hpp"
+#include "rp_image_pipeline_p.hpp"
+
+// SSSE3 intrinsics
+#include <emmintrin.h>
+#include <tmmintrin.h>
+
+// Workaround for RP_D() expecting the no-underscore, UpperCamelCase naming convention.
+#define rp_imagePrivate rp_image_private
+
+namespace LibRpTexture {
+
+/**
+ * Premultiply four argb32_t pixels. (SSSE3 version)
+ *
+ * Each color channel is calculated the same way as qPremultiply():
+ * c' = (c*a + ((c*a) >> 8) + 0x80) >> 8
+ * The alpha channel is multiplied by 255, which leaves it unchanged.
+ *
+ * Pixels with alpha == 0 are left unchanged, as in the standard version.
+ *
+ * @param px	[in] Four ARGB32 pixels.
+ * @return Premultiplied pixels.
+ */
+static FORCEINLINE __m128i premultiply_4px_ssse3(__m128i px)
+{
+	// Alpha shuffle masks: Copy alpha to the 16-bit B/G/R lanes.
+	const __m128i shuf_lo = _mm_setr_epi8(3,-1,3,-1,3,-1,-1,-1, 7,-1,7,-1,7,-1,-1,-1);
+	const __m128i shuf_hi = _mm_setr_epi8(11,-1,11,-1,11,-1,-1,-1, 15,-1,15,-1,15,-1,-1,-1);
+	const __m128i alpha_mul = _mm_setr_epi16(0,0,0,255, 0,0,0,255);
+	const __m128i rnd = _mm_set1_epi16(0x80);
+	const __m128i alpha_mask = _mm_set1_epi32(0xFF000000);
+	const __m128i zero = _mm_setzero_si128();
+
+	__m128i lo = _mm_unpacklo_epi8(px, zero);
+	__m128i hi = _mm_unpackhi_epi8(px, zero);
+	lo = _mm_mullo_epi16(lo, _mm_or_si128(_mm_shuffle_epi8(px, shuf_lo), alpha_mul));
+	hi = _mm_mullo_epi16(hi, _mm_or_si128(_mm_shuffle_epi8(px, shuf_hi), alpha_mul));
+	lo = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(lo, _mm_srli_epi16(lo, 8)), rnd), 8);
+	hi = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(hi, _mm_srli_epi16(hi, 8)), rnd), 8);
+	const __m128i res = _mm_packus_epi16(lo, hi);
+
+	// Keep the original pixels if alpha == 0.
+	const __m128i a0 = _mm_cmpeq_epi32(_mm_and_si128(px, alpha_mask), zero);
+	return _mm_or_si128(_mm_and_si128(a0, px), _mm_andnot_si128(a0, res));
+}
+
+/**
+ * Premultiply pixels.
+ * SSSE3-optimized version.
+ * @param row	[in,out] ARGB32 row.
+ * @param width	[in] Width, in pixels.
+ * @param param	[in] Unused.
+ */
+void PixelPipeline::premultiplyRow_ssse3(argb32_t *row, int width, uint32_t param)
+{
+	RP_UNUSED(param);
+
+	// Process 8 pixels per iteration using SSSE3.
+	__m128i *xmm_buf = reinterpret_cast<__m128i*>(row);
+	for (; width > 7; width -= 8, xmm_buf += 2) {
+		const __m128i sa = _mm_loadu_si128(&xmm_buf[0]);
+		const __m128i sb = _mm_loadu_si128(&xmm_buf[1]);
+		_mm_storeu_si128(&xmm_buf[0], premultiply_4px_ssse3(sa));
+		_mm_storeu_si128(&xmm_buf[1], premultiply_4px_ssse3(sb));
+	}
+
+	// Process 4 pixels per iteration using SSSE3.
+	for (; width > 3; width -= 4, xmm_buf++) {
+		_mm_storeu_si128(xmm_buf, premultiply_4px_ssse3(_mm_loadu_si128(xmm_buf)));
+	}
+
+	// Remaining pixels.
+	if (width > 0) {
+		premultiplyRow_cpp(reinterpret_cast<argb32_t*>(xmm_buf), width, 0);
+	}
+}
+
+/**
+ * Premultiply an ARGB32 rp_image.
+ * SSSE3-optimized version.
+ *
+ * Image must be ARGB32.
+ *
+ * @return 0 on success; non-zero on error.
+ */
+int rp_image::premultiply_ssse3(void)
+{
+	RP_D(const rp_image);
+	rp_image_backend *const backend = d->backend;
+	assert(backend->format == rp_image::Format::ARGB32);
+	if (backend->format != rp_image::Format::ARGB32) {
+		// Incorrect format...
+		return -1;
+	}
+
+	const int width = backend->width;
+	argb32_t *px_dest = static_cast<argb32_t*>(backend->data());
+	const int dest_stride = backend->stride / sizeof(*px_dest);
+	for (int y = backend->height; y > 0; y--, px_dest += dest_stride) {
+		PixelPipeline::premultiplyRow_ssse3(px_dest, width, 0);
+	}
+	return 0;
+}
+
+}
@@ -0,0 +1,312 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (librptexture/tests)               *
+ * ImageDecoderBC7Test.cpp: BC7 image decoding tests with SSE4.1/AVX2.     *
+ *                                                                         *
+ * Copyright (c) 2016-2022 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+#include "tcharx.h"
+#include "common.h"
+
+// librpcpu, librptexture
+#include "librpcpu/byteswap_rp.h"
+#include "librptexture/img/rp_image.hpp"
+#include "librptexture/decoder/ImageDecoder.hpp"
+
+// C includes.
+#include <stdint.h>
+#include <stdlib.h>
+
+// C includes. (C++ namespace)
+#include <cstring>
+
+// C++ includes.
+#include <memory>
+#include <string>
+#include <vector>
+using std::unique_ptr;
+using std::string;
+
+namespace LibRpTexture { namespace Tests {
+
+struct RpImageUnrefDeleter {
+	void operator()(rp_image *img) {
+		UNREF(img);
+	}
+};
+typedef unique_ptr<rp_image, RpImageUnrefDeleter> unique_rp_image;
+
+// BC7 decoder function.
+typedef rp_image *(*fromBC7_fn)(int width, int height, const uint8_t *img_buf, int img_siz);
+
+class ImageDecoderBC7Test : public ::testing::TestWithParam<int>
+{
+	protected:
+		ImageDecoderBC7Test()
+			: ::testing::TestWithParam<int>()
+		{ }
+
+		void SetUp(void) final;
+
+	public:
+		/**
+		 * Compare two rp_image objects.
+		 * @param pImgExpected	[in] Expected image data.
+		 * @param pImgActual	[in] Actual image data.
+		 */
+		static void Compare_RpImage(
+			const rp_image *pImgExpected,
+			const rp_image *pImgActual);
+
+		/**
+		 * Decode the test image and compare it to the standard version.
+		 * @param fn BC7 decoder function.
+		 */
+		void decodeTest_internal(fromBC7_fn fn);
+
+		/**
+		 * Benchmark a BC7 decoder function.
+		 * @param fn BC7 decoder function.
+		 */
+		void decodeBenchmark_internal(fromBC7_fn fn);
+
+		/**
+		 * Test case suffix generator.
+		 * @param info Test parameter information.
+		 * @return Test case suffix.
+		 */
+		static string test_case_suffix_generator(const ::testing::TestParamInfo<int> &info);
+
+		// Test image size.
+		static const int IMG_WIDTH = 256;
+		static const int IMG_HEIGHT = 256;
+
+		// Number of iterations for benchmarks.
+		static const unsigned int BENCHMARK_ITERATIONS = 100;
+
+	public:
+		// BC7 image data.
+		std::vector<uint8_t> m_bc7_buf;
+};
+
+/**
+ * SetUp() function.
+ * Run before each test.
+ *
+ * Generates pseudo-random BC7 blocks.
+ * Test parameter: Block mode (0-7), or -1 for mixed modes.
+ */
+void ImageDecoderBC7Test::SetUp(void)
+{
+	const int mode = GetParam();
+
+	// Simple LCG so the test data is reproducible.
+	uint32_t seed = 0x12345678U + mode;
+	auto next_rand = [&seed]() -> uint8_t {
+		seed = seed * 1103515245U + 12345U;
+		return static_cast<uint8_t>(seed >> 16);
+	};
+
+	m_bc7_buf.resize(IMG_WIDTH * IMG_HEIGHT);
+	for (size_t i = 0; i < m_bc7_buf.size(); i++) {
+		m_bc7_buf[i] = next_rand();
+	}
+
+	// Set the mode bits in each block.
+	for (size_t i = 0; i < m_bc7_buf.size(); i += 16) {
+		const unsigned int blk_mode = (mode >= 0) ? mode : (m_bc7_buf[i+1] & 7);
+		const uint8_t mode_bit = (1U << blk_mode);
+		m_bc7_buf[i] = (m_bc7_buf[i] & ~((mode_bit << 1) - 1)) | mode_bit;
+	}
+}
+
+/**
+ * Compare two rp_image objects.
+ * @param pImgExpected	[in] Expected image data.
+ * @param pImgActual	[in] Actual image data.
+ */
+void ImageDecoderBC7Test::Compare_RpImage(
+	const rp_image *pImgExpected,
+	const rp_image *pImgActual)
+{
+	ASSERT_TRUE(pImgExpected->isValid()) << "pImgExpected is not valid.";
+	ASSERT_TRUE(pImgActual->isValid())   << "pImgActual is not valid.";
+	ASSERT_EQ(rp_image::Format::ARGB32, pImgExpected->format());
+	ASSERT_EQ(rp_image::Format::ARGB32, pImgActual->format());
+	ASSERT_EQ(pImgExpected->width(),  pImgActual->width())  << "Image sizes don't match.";
+	ASSERT_EQ(pImgExpected->height(), pImgActual->height()) << "Image sizes don't match.";
+
+	const int width = pImgExpected->width();
+	const int height = pImgExpected->height();
+	for (int y = 0; y < height; y++) {
+		const uint32_t *pBitsExpected = static_cast<const uint32_t*>(pImgExpected->scanLine(y));
+		const uint32_t *pBitsActual   = static_cast<const uint32_t*>(pImgActual->scanLine(y));
+		for (int x = 0; x < width; x++) {
+			ASSERT_EQ(pBitsExpected[x], pBitsActual[x]) <<
+				"Pixel (" << x << "," << y << ") does not match.";
+		}
+	}
+}
+
+/**
+ * Decode the test image and compare it to the standard version.
+ * @param fn BC7 decoder function.
+ */
+void ImageDecoderBC7Test::decodeTest_internal(fromBC7_fn fn)
+{
+	unique_rp_image img_cpp(ImageDecoder::fromBC7_cpp(IMG_WIDTH, IMG_HEIGHT,
+		m_bc7_buf.data(), static_cast<int>(m_bc7_buf.size())));
+	ASSERT_TRUE(img_cpp != nullptr);
+
+	unique_rp_image img(fn(IMG_WIDTH, IMG_HEIGHT,
+		m_bc7_buf.data(), static_cast<int>(m_bc7_buf.size())));
+	ASSERT_TRUE(img != nullptr);
+
+	ASSERT_NO_FATAL_FAILURE(Compare_RpImage(img_cpp.get(), img.get()));
+}
+
+/**
+ * Benchmark a BC7 decoder function.
+ * @param fn BC7 decoder function.
+ */
+void ImageDecoderBC7Test::decodeBenchmark_internal(fromBC7_fn fn)
+{
+	for (unsigned int i = BENCHMARK_ITERATIONS; i > 0; i--) {
+		rp_image *const img = fn(IMG_WIDTH, IMG_HEIGHT,
+			m_bc7_buf.data(), static_cast<int>(m_bc7_buf.size()));
+		ASSERT_TRUE(img != nullptr);
+		img->unref();
+	}
+}
+
+/**
+ * Test case suffix generator.
+ * @param info Test parameter information.
+ * @return Test case suffix.
+ */
+string ImageDecoderBC7Test::test_case_suffix_generator(const ::testing::TestParamInfo<int> &info)
+{
+	if (info.param < 0) {
+		return "mixed";
+	}
+
+	char buf[16];
+	snprintf(buf, sizeof(buf), "mode%d", info.param);
+	return buf;
+}
+
+/**
+ * Benchmark the ImageDecoder::fromBC7() function. (Standard version)
+ */
+TEST_P(ImageDecoderBC7Test, fromBC7_cpp_benchmark)
+{
+	ASSERT_NO_FATAL_FAILURE(decodeBenchmark_internal(ImageDecoder::fromBC7_cpp));
+}
+
+#ifdef IMAGEDECODER_HAS_SSE41
+/**
+ * Test the ImageDecoder::fromBC7() function. (SSE4.1-optimized version)
+ */
+TEST_P(ImageDecoderBC7Test, fromBC7_sse41_test)
+{
+	if (!RP_CPU_HasSSE41()) {
+		fprintf(stderr, "*** SSE4.1 is not supported on this CPU. Skipping test.\n");
+		return;
+	}
+
+	ASSERT_NO_FATAL_FAILURE(decodeTest_internal(ImageDecoder::fromBC7_sse41));
+}
+
+/**
+ * Benchmark the ImageDecoder::fromBC7() function. (SSE4.1-optimized version)
+ */
+TEST_P(ImageDecoderBC7Test, fromBC7_sse41_benchmark)
+{
+	if (!RP_CPU_HasSSE41()) {
+		fprintf(stderr, "*** SSE4.1 is not supported on this CPU. Skipping test.\n");
+		return;
+	}
+
+	ASSERT_NO_FATAL_FAILURE(decodeBenchmark_internal(ImageDecoder::fromBC7_sse41));
+}
+#endif /* IMAGEDECODER_HAS_SSE41 */
+
+#ifdef IMAGEDECODER_HAS_AVX2
+/**
+ * Test the ImageDecoder::fromBC7() function. (AVX2-optimized version)
+ */
+TEST_P(ImageDecoderBC7Test, fromBC7_avx2_test)
+{
+	if (!RP_CPU_HasAVX2()) {
+		fprintf(stderr, "*** AVX2 is not supported on this CPU. Skipping test.\n");
+		return;
+	}
+
+	ASSERT_NO_FATAL_FAILURE(decodeTest_internal(ImageDecoder::fromBC7_avx2));
+}
+
+/**
+ * Benchmark the ImageDecoder::fromBC7() function. (AVX2-optimized version)
+ */
+TEST_P(ImageDecoderBC7Test, fromBC7_avx2_benchmark)
+{
+	if (!RP_CPU_HasAVX2()) {
+		fprintf(stderr, "*** AVX2 is not supported on this CPU. Skipping test.\n");
+		return;
+	}
+
+	ASSERT_NO_FATAL_FAILURE(decodeBenchmark_internal(ImageDecoder::fromBC7_avx2));
+}
+#endif /* IMAGEDECODER_HAS_AVX2 */
+
+/**
+ * Wrapper for the ImageDecoder::fromBC7() dispatch function.
+ * NOTE: Taking the address of an IFUNC symbol causes the resolver
+ * to run before the PLT is set up, so call it indirectly.
+ */
+static rp_image *fromBC7_dispatch(int width, int height, const uint8_t *img_buf, int img_siz)
+{
+	return ImageDecoder::fromBC7(width, height, img_buf, img_siz);
+}
+
+/**
+ * Test the ImageDecoder::fromBC7() dispatch function.
+ */
+TEST_P(ImageDecoderBC7Test, fromBC7_dispatch_test)
+{
+	ASSERT_NO_FATAL_FAILURE(decodeTest_internal(fromBC7_dispatch));
+}
+
+/**
+ * Benchmark the ImageDecoder::fromBC7() dispatch function.
+ */
+TEST_P(ImageDecoderBC7Test, fromBC7_dispatch_benchmark)
+{
+	ASSERT_NO_FATAL_FAILURE(decodeBenchmark_internal(fromBC7_dispatch));
+}
+
+// Test cases.
+INSTANTIATE_TEST_SUITE_P(fromBC7, ImageDecoderBC7Test,
+	::testing::Values(-1, 0, 1, 2, 3, 4, 5, 6, 7),
+	ImageDecoderBC7Test::test_case_suffix_generator);
+
+} }
+
+/**
+ * Test suite main function.
+ * Called by gtest_init.cpp.
+ */
+extern "C" int gtest_main(int argc, TCHAR *argv[])
+{
+	fprintf(stderr, "LibRpTexture test suite: ImageDecoder::fromBC7() tests.\n\n");
+	fprintf(stderr, "Benchmark iterations: %u\n",
+		LibRpTexture::Tests::ImageDecoderBC7Test::BENCHMARK_ITERATIONS);
+	fflush(nullptr);
+
+	// coverity[fun_call_w_exception]: uncaught exceptions cause nonzero exit anyway, so don't warn.
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
@@ -0,0 +1,320 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (librptexture/tests)               *
+ * ImageDecoderETCTest.cpp: ETC1/ETC2/EAC image decoding tests with        *
+ * SSE4.1/AVX2.                                                            *
+ *                                                                         *
+ * Copyright (c) 2016-2022 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+#include "tcharx.h"
+#include "common.h"
+
+// librpcpu, librptexture
+#include "librpcpu/byteswap_rp.h"
+#include "librptexture/img/rp_image.hpp"
+#include "librptexture/decoder/ImageDecoder.hpp"
+
+// C includes.
+#include <stdint.h>
+#include <stdlib.h>
+
+// C includes. (C++ namespace)
+#include <cstring>
+
+// C++ includes.
+#include <memory>
+#include <string>
+#include <vector>
+using std::unique_ptr;
+using std::string;
+
+namespace LibRpTexture { namespace Tests {
+
+struct RpImageUnrefDeleter {
+	void operator()(rp_image *img) {
+		UNREF(img);
+	}
+};
+typedef unique_ptr<rp_image, RpImageUnrefDeleter> unique_rp_image;
+
+// ETC decoder function.
+typedef rp_image *(*fromETC_fn)(int width, int height, const uint8_t *img_buf, int img_siz);
+
+// ETC decoder functions for a single format.
+struct ETC_Decoder_Fns {
+	const char *name;		// Format name
+	unsigned int bytesPerBlock;	// Bytes per 4x4 block
+	fromETC_fn fn_cpp;		// Standard version
+	fromETC_fn fn_sse41;		// SSE4.1-optimized version (nullptr if not available)
+	fromETC_fn fn_avx2;		// AVX2-optimized version (nullptr if not available)
+};
+
+#ifdef IMAGEDECODER_HAS_SSE41
+#  define ETC_FN_SSE41(fn) ImageDecoder::fn##_sse41
+#else /* !IMAGEDECODER_HAS_SSE41 */
+#  define ETC_FN_SSE41(fn) nullptr
+#endif /* IMAGEDECODER_HAS_SSE41 */
+#ifdef IMAGEDECODER_HAS_AVX2
+#  define ETC_FN_AVX2(fn) ImageDecoder::fn##_avx2
+#else /* !IMAGEDECODER_HAS_AVX2 */
+#  define ETC_FN_AVX2(fn) nullptr
+#endif /* IMAGEDECODER_HAS_AVX2 */
+#define ETC_DECODER(fn, bpb) {#fn, (bpb), ImageDecoder::fn##_cpp, ETC_FN_SSE41(fn), ETC_FN_AVX2(fn)}
+
+static const ETC_Decoder_Fns etc_decoders[] = {
+	ETC_DECODER(fromETC1, 8),
+	ETC_DECODER(fromETC2_RGB, 8),
+	ETC_DECODER(fromETC2_RGBA, 16),
+	ETC_DECODER(fromETC2_RGB_A1, 8),
+	ETC_DECODER(fromEAC_R11, 8),
+	ETC_DECODER(fromEAC_RG11, 16),
+};
+
+class ImageDecoderETCTest : public ::testing::TestWithParam<unsigned int>
+{
+	protected:
+		ImageDecoderETCTest()
+			: ::testing::TestWithParam<unsigned int>()
+			, m_fns(nullptr)
+		{ }
+
+		void SetUp(void) final;
+
+	public:
+		/**
+		 * Compare two rp_image objects.
+		 * @param pImgExpected	[in] Expected image data.
+		 * @param pImgActual	[in] Actual image data.
+		 */
+		static void Compare_RpImage(
+			const rp_image *pImgExpected,
+			const rp_image *pImgActual);
+
+		/**
+		 * Decode the test image and compare it to the standard version.
+		 * @param fn ETC decoder function.
+		 */
+		void decodeTest_internal(fromETC_fn fn);
+
+		/**
+		 * Benchmark an ETC decoder function.
+		 * @param fn ETC decoder function.
+		 */
+		void decodeBenchmark_internal(fromETC_fn fn);
+
+		/**
+		 * Test case suffix generator.
+		 * @param info Test parameter information.
+		 * @return Test case suffix.
+		 */
+		static string test_case_suffix_generator(const ::testing::TestParamInfo<unsigned int> &info);
+
+		// Test image size.
+		// NOTE: Height is not a multiple of 4 in order to test partial tiles.
+		static const int IMG_WIDTH = 256;
+		static const int IMG_HEIGHT = 254;
+
+		// Number of iterations for benchmarks.
+		static const unsigned int BENCHMARK_ITERATIONS = 1000;
+
+	public:
+		// ETC image data.
+		std::vector<uint8_t> m_etc_buf;
+
+		// ETC decoder functions.
+		const ETC_Decoder_Fns *m_fns;
+};
+
+/**
+ * SetUp() function.
+ * Run before each test.
+ *
+ * Generates pseudo-random ETC blocks.
+ * Since the ETC2 block mode is determined by overflows in the
+ * differential colors, random data covers all block modes.
+ */
+void ImageDecoderETCTest::SetUp(void)
+{
+	const unsigned int idx = GetParam();
+	ASSERT_LT(idx, ARRAY_SIZE(etc_decoders));
+	m_fns = &etc_decoders[idx];
+
+	// Simple LCG so the test data is reproducible.
+	uint32_t seed = 0x12345678U + idx;
+	auto next_rand = [&seed]() -> uint8_t {
+		seed = seed * 1103515245U + 12345U;
+		return static_cast<uint8_t>(seed >> 16);
+	};
+
+	// NOTE: Partial tiles are stored as full tiles.
+	const unsigned int tilesX = (IMG_WIDTH + 3) / 4;
+	const unsigned int tilesY = (IMG_HEIGHT + 3) / 4;
+	m_etc_buf.resize(tilesX * tilesY * m_fns->bytesPerBlock);
+	for (size_t i = 0; i < m_etc_buf.size(); i++) {
+		m_etc_buf[i] = next_rand();
+	}
+}
+
+/**
+ * Compare two rp_image objects.
+ * @param pImgExpected	[in] Expected image data.
+ * @param pImgActual	[in] Actual image data.
+ */
+void ImageDecoderETCTest::Compare_RpImage(
+	const rp_image *pImgExpected,
+	const rp_image *pImgActual)
+{
+	ASSERT_TRUE(pImgExpected->isValid()) << "pImgExpected is not valid.";
+	ASSERT_TRUE(pImgActual->isValid())   << "pImgActual is not valid.";
+	ASSERT_EQ(rp_image::Format::ARGB32, pImgExpected->format());
+	ASSERT_EQ(rp_image::Format::ARGB32, pImgActual->format());
+	ASSERT_EQ(pImgExpected->width(),  pImgActual->width())  << "Image sizes don't match.";
+	ASSERT_EQ(pImgExpected->height(), pImgActual->height()) << "Image sizes don't match.";
+
+	rp_image::sBIT_t sBIT_expected, sBIT_actual;
+	ASSERT_EQ(0, pImgExpected->get_sBIT(&sBIT_expected));
+	ASSERT_EQ(0, pImgActual->get_sBIT(&sBIT_actual));
+	EXPECT_EQ(0, memcmp(&sBIT_expected, &sBIT_actual, sizeof(sBIT_expected))) << "sBIT values don't match.";
+
+	const int width = pImgExpected->width();
+	const int height = pImgExpected->height();
+	for (int y = 0; y < height; y++) {
+		const uint32_t *pBitsExpected = static_cast<const uint32_t*>(pImgExpected->scanLine(y));
+		const uint32_t *pBitsActual   = static_cast<const uint32_t*>(pImgActual->scanLine(y));
+		for (int x = 0; x < width; x++) {
+			ASSERT_EQ(pBitsExpected[x], pBitsActual[x]) <<
+				"Pixel (" << x << "," << y << ") does not match.";
+		}
+	}
+}
+
+/**
+ * Decode the test image and compare it to the standard version.
+ * @param fn ETC decoder function.
+ */
+void ImageDecoderETCTest::decodeTest_internal(fromETC_fn fn)
+{
+	unique_rp_image img_cpp(m_fns->fn_cpp(IMG_WIDTH, IMG_HEIGHT,
+		m_etc_buf.data(), static_cast<int>(m_etc_buf.size())));
+	ASSERT_TRUE(img_cpp != nullptr);
+
+	unique_rp_image img(fn(IMG_WIDTH, IMG_HEIGHT,
+		m_etc_buf.data(), static_cast<int>(m_etc_buf.size())));
+	ASSERT_TRUE(img != nullptr);
+
+	ASSERT_NO_FATAL_FAILURE(Compare_RpImage(img_cpp.get(), img.get()));
+}
+
+/**
+ * Benchmark an ETC decoder function.
+ * @param fn ETC decoder function.
+ */
+void ImageDecoderETCTest::decodeBenchmark_internal(fromETC_fn fn)
+{
+	for (unsigned int i = BENCHMARK_ITERATIONS; i > 0; i--) {
+		rp_image *const img = fn(IMG_WIDTH, IMG_HEIGHT,
+			m_etc_buf.data(), static_cast<int>(m_etc_buf.size()));
+		ASSERT_TRUE(img != nullptr);
+		img->unref();
+	}
+}
+
+/**
+ * Test case suffix generator.
+ * @param info Test parameter information.
+ * @return Test case suffix.
+ */
+string ImageDecoderETCTest::test_case_suffix_generator(const ::testing::TestParamInfo<unsigned int> &info)
+{
+	return etc_decoders[info.param].name;
+}
+
+/**
+ * Benchmark the ETC decoder function. (Standard version)
+ */
+TEST_P(ImageDecoderETCTest, cpp_benchmark)
+{
+	ASSERT_NO_FATAL_FAILURE(decodeBenchmark_internal(m_fns->fn_cpp));
+}
+
+#ifdef IMAGEDECODER_HAS_SSE41
+/**
+ * Test the ETC decoder function. (SSE4.1-optimized version)
+ */
+TEST_P(ImageDecoderETCTest, sse41_test)
+{
+	if (!RP_CPU_HasSSE41()) {
+		fprintf(stderr, "*** SSE4.1 is not supported on this CPU. Skipping test.\n");
+		return;
+	}
+
+	ASSERT_NO_FATAL_FAILURE(decodeTest_internal(m_fns->fn_sse41));
+}
+
+/**
+ * Benchmark the ETC decoder function. (SSE4.1-optimized version)
+ */
+TEST_P(ImageDecoderETCTest, sse41_benchmark)
+{
+	if (!RP_CPU_HasSSE41()) {
+		fprintf(stderr, "*** SSE4.1 is not supported on this CPU. Skipping test.\n");
+		return;
+	}
+
+	ASSERT_NO_FATAL_FAILURE(decodeBenchmark_internal(m_fns->fn_sse41));
+}
+#endif /* IMAGEDECODER_HAS_SSE41 */
+
+#ifdef IMAGEDECODER_HAS_AVX2
+/**
+ * Test the ETC decoder function. (AVX2-optimized version)
+ */
+TEST_P(ImageDecoderETCTest, avx2_test)
+{
+	if (!RP_CPU_HasAVX2()) {
+		fprintf(stderr, "*** AVX2 is not supported on this CPU. Skipping test.\n");
+		return;
+	}
+
+	ASSERT_NO_FATAL_FAILURE(decodeTest_internal(m_fns->fn_avx2));
+}
+
+/**
+ * Benchmark the ETC decoder function. (AVX2-optimized version)
+ */
+TEST_P(ImageDecoderETCTest, avx2_benchmark)
+{
+	if (!RP_CPU_HasAVX2()) {
+		fprintf(stderr, "*** AVX2 is not supported on this CPU. Skipping test.\n");
+		return;
+	}
+
+	ASSERT_NO_FATAL_FAILURE(decodeBenchmark_internal(m_fns->fn_avx2));
+}
+#endif /* IMAGEDECODER_HAS_AVX2 */
+
+// Test cases.
+INSTANTIATE_TEST_SUITE_P(ETC, ImageDecoderETCTest,
+	::testing::Range(0U, static_cast<unsigned int>(ARRAY_SIZE(etc_decoders))),
+	ImageDecoderETCTest::test_case_suffix_generator);
+
+} }
+
+/**
+ * Test suite main function.
+ * Called by gtest_init.cpp.
+ */
+extern "C" int gtest_main(int argc, TCHAR *argv[])
+{
+	fprintf(stderr, "LibRpTexture test suite: ImageDecoder ETC1/ETC2/EAC tests.\n\n");
+	fprintf(stderr, "Benchmark iterations: %u\n",
+		LibRpTexture::Tests::ImageDecoderETCTest::BENCHMARK_ITERATIONS);
+	fflush(nullptr);
+
+	// coverity[fun_call_w_exception]: uncaught exceptions cause nonzero exit anyway, so don't warn.
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
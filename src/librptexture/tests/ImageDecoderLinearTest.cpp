@@ -1,8 +1,9 @@
 /***************************************************************************
  * ROM Properties Page shell extension. (librptexture/tests)               *
- * ImageDecoderLinearTest.cpp: Linear image decoding tests with SSSE3.     *
+ * ImageDecoderLinearTest.cpp: Linear image decoding tests with           *
+ * SSE2/SSSE3/AVX2.                                                        *
  *                                                                         *
- * Copyright (c) 2016-2020 by David Korth.                                 *
+ * Copyright (c) 2016-2022 by David Korth.                                 *
  * SPDX-License-Identifier: GPL-2.0-or-later                               *
  ***************************************************************************/
 
@@ -36,6 +37,13 @@ using std::string;
 
 namespace LibRpTexture { namespace Tests {
 
+struct RpImageUnrefDeleter {
+	void operator()(rp_image *img) {
+		UNREF(img);
+	}
+};
+typedef unique_ptr<rp_image, RpImageUnrefDeleter> unique_rp_image;
+
 struct ImageDecoderLinearTest_mode
 {
 	/**
@@ -643,8 +651,187 @@ TEST_P(ImageDecoderLinearTest, fromLinear_ssse3_benchmark)
 }
 #endif /* IMAGEDECODER_HAS_SSSE3 */
 
+#ifdef IMAGEDECODER_HAS_AVX2
+/**
+ * Test the ImageDecoder::fromLinear*() functions. (AVX2-optimized version)
+ */
+TEST_P(ImageDecoderLinearTest, fromLinear_avx2_test)
+{
+	if (!RP_CPU_HasAVX2()) {
+		fprintf(stderr, "*** AVX2 is not supported on this CPU. Skipping test.\n");
+		return;
+	}
+
+	// Parameterized test.
+	const ImageDecoderLinearTest_mode &mode = GetParam();
+
+	// Decode the image.
+	switch (mode.bpp) {
+		case 24:
+			// 24-bit image.
+			m_img = ImageDecoder::fromLinear24_avx2(mode.src_pxf, 128, 128,
+				m_img_buf, static_cast<int>(m_img_buf_len), mode.stride);
+			break;
+
+		case 32:
+			// 32-bit image.
+			m_img = ImageDecoder::fromLinear32_avx2(mode.src_pxf, 128, 128,
+				reinterpret_cast<const uint32_t*>(m_img_buf),
+				static_cast<int>(m_img_buf_len), mode.stride);
+			break;
+
+		case 15:
+		case 16:
+			// 15/16-bit image.
+			m_img = ImageDecoder::fromLinear16_avx2(mode.src_pxf, 128, 128,
+				reinterpret_cast<const uint16_t*>(m_img_buf),
+				static_cast<int>(m_img_buf_len), mode.stride);
+			break;
+
+		default:
+			ASSERT_TRUE(false) << "Invalid bpp: " << mode.bpp;
+			return;
+	}
+
+	ASSERT_TRUE(m_img != nullptr);
+
+	// Validate the image.
+	ASSERT_NO_FATAL_FAILURE(Validate_RpImage(m_img, mode.dest_pixel));
+}
+
+/**
+ * Test the ImageDecoder::fromLinear*() functions. (AVX2-optimized version)
+ * Pseudo-random source data with a width that isn't a multiple of
+ * the vector size is compared against the standard version in order
+ * to verify the pixel ordering and the remaining pixel handling.
+ */
+TEST_P(ImageDecoderLinearTest, fromLinear_avx2_random_test)
+{
+	if (!RP_CPU_HasAVX2()) {
+		fprintf(stderr, "*** AVX2 is not supported on this CPU. Skipping test.\n");
+		return;
+	}
+
+	// Parameterized test.
+	const ImageDecoderLinearTest_mode &mode = GetParam();
+
+	// Simple LCG so the test data is reproducible.
+	uint32_t seed = 0x12345678U;
+	for (size_t i = 0; i < m_img_buf_len; i++) {
+		seed = seed * 1103515245U + 12345U;
+		m_img_buf[i] = static_cast<uint8_t>(seed >> 16);
+	}
+
+	// NOTE: Using a width of 125 to test the remaining pixel handling.
+	static const int width = 125;
+	unique_rp_image img_cpp, img_avx2;
+	switch (mode.bpp) {
+		case 24:
+			// 24-bit image.
+			img_cpp.reset(ImageDecoder::fromLinear24_cpp(mode.src_pxf, width, 128,
+				m_img_buf, static_cast<int>(m_img_buf_len), mode.stride));
+			img_avx2.reset(ImageDecoder::fromLinear24_avx2(mode.src_pxf, width, 128,
+				m_img_buf, static_cast<int>(m_img_buf_len), mode.stride));
+			break;
+
+		case 32:
+			// 32-bit image.
+			img_cpp.reset(ImageDecoder::fromLinear32_cpp(mode.src_pxf, width, 128,
+				reinterpret_cast<const uint32_t*>(m_img_buf),
+				static_cast<int>(m_img_buf_len), mode.stride));
+			img_avx2.reset(ImageDecoder::fromLinear32_avx2(mode.src_pxf, width, 128,
+				reinterpret_cast<const uint32_t*>(m_img_buf),
+				static_cast<int>(m_img_buf_len), mode.stride));
+			break;
+
+		case 15:
+		case 16:
+			// 15/16-bit image.
+			img_cpp.reset(ImageDecoder::fromLinear16_cpp(mode.src_pxf, width, 128,
+				reinterpret_cast<const uint16_t*>(m_img_buf),
+				static_cast<int>(m_img_buf_len), mode.stride));
+			img_avx2.reset(ImageDecoder::fromLinear16_avx2(mode.src_pxf, width, 128,
+				reinterpret_cast<const uint16_t*>(m_img_buf),
+				static_cast<int>(m_img_buf_len), mode.stride));
+			break;
+
+		default:
+			ASSERT_TRUE(false) << "Invalid bpp: " << mode.bpp;
+			return;
+	}
+
+	ASSERT_TRUE(img_cpp != nullptr);
+	ASSERT_TRUE(img_avx2 != nullptr);
+
+	rp_image::sBIT_t sBIT_cpp, sBIT_avx2;
+	ASSERT_EQ(0, img_cpp->get_sBIT(&sBIT_cpp));
+	ASSERT_EQ(0, img_avx2->get_sBIT(&sBIT_avx2));
+	EXPECT_EQ(0, memcmp(&sBIT_cpp, &sBIT_avx2, sizeof(sBIT_cpp))) << "sBIT values don't match.";
+
+	for (int y = 0; y < 128; y++) {
+		const uint32_t *px_cpp  = static_cast<const uint32_t*>(img_cpp->scanLine(y));
+		const uint32_t *px_avx2 = static_cast<const uint32_t*>(img_avx2->scanLine(y));
+		for (int x = 0; x < width; x++) {
+			ASSERT_EQ(px_cpp[x], px_avx2[x]) <<
+				"Pixel (" << x << "," << y << ") does not match.";
+		}
+	}
+}
+
+/**
+ * Benchmark the ImageDecoder::fromLinear*() functions. (AVX2-optimized version)
+ */
+TEST_P(ImageDecoderLinearTest, fromLinear_avx2_benchmark)
+{
+	if (!RP_CPU_HasAVX2()) {
+		fprintf(stderr, "*** AVX2 is not supported on this CPU. Skipping test.\n");
+		return;
+	}
+
+	// Parameterized test.
+	const ImageDecoderLinearTest_mode &mode = GetParam();
+
+	// Decode the image.
+	switch (mode.bpp) {
+		case 24:
+			// 24-bit image.
+			for (unsigned int i = BENCHMARK_ITERATIONS; i > 0; i--) {
+				m_img = ImageDecoder::fromLinear24_avx2(mode.src_pxf, 128, 128,
+					m_img_buf, static_cast<int>(m_img_buf_len), mode.stride);
+				UNREF_AND_NULL(m_img);
+			}
+			break;
+
+		case 32:
+			// 32-bit image.
+			for (unsigned int i = BENCHMARK_ITERATIONS; i > 0; i--) {
+				m_img = ImageDecoder::fromLinear32_avx2(mode.src_pxf, 128, 128,
+					reinterpret_cast<const uint32_t*>(m_img_buf),
+					static_cast<int>(m_img_buf_len), mode.stride);
+				UNREF_AND_NULL(m_img);
+			}
+			break;
+
+		case 15:
+		case 16:
+			// 15/16-bit image.
+			for (unsigned int i = BENCHMARK_ITERATIONS; i > 0; i--) {
+				m_img = ImageDecoder::fromLinear16_avx2(mode.src_pxf, 128, 128,
+					reinterpret_cast<const uint16_t*>(m_img_buf),
+					static_cast<int>(m_img_buf_len), mode.stride);
+				UNREF_AND_NULL(m_img);
+			}
+			break;
+
+		default:
+			ASSERT_TRUE(false) << "Invalid bpp: " << mode.bpp;
+			return;
+	}
+}
+#endif /* IMAGEDECODER_HAS_AVX2 */
+
 // NOTE: Add more instruction sets to the #ifdef if other optimizations are added.
-#if defined(IMAGEDECODER_HAS_SSE2) || defined(IMAGEDECODER_HAS_SSSE3)
+#if defined(IMAGEDECODER_HAS_SSE2) || defined(IMAGEDECODER_HAS_SSSE3) || defined(IMAGEDECODER_HAS_AVX2)
 /**
  * Test the ImageDecoder::fromLinear*() dispatch functions.
  */
@@ -732,7 +919,7 @@ TEST_P(ImageDecoderLinearTest, fromLinear_dispatch_benchmark)
 			return;
 	}
 }
-#endif /* IMAGEDECODER_HAS_SSE2 || IMAGEDECODER_HAS_SSSE3 */
+#endif /* IMAGEDECODER_HAS_SSE2 || IMAGEDECODER_HAS_SSSE3 || IMAGEDECODER_HAS_AVX2 */
 
 // Test cases.
 
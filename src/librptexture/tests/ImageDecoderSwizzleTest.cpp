@@ -0,0 +1,363 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (librptexture/tests)               *
+ * ImageDecoderSwizzleTest.cpp: Morton unswizzling tests with SSE2.        *
+ *                                                                         *
+ * Copyright (c) 2016-2022 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+#include "tcharx.h"
+#include "common.h"
+
+// librpcpu, librptexture
+#include "librpcpu/bitstuff.h"
+#include "librptexture/img/rp_image.hpp"
+#include "librptexture/decoder/ImageDecoder.hpp"
+
+// C includes.
+#include <stdint.h>
+#include <stdlib.h>
+
+// C includes. (C++ namespace)
+#include <cstring>
+
+// C++ includes.
+#include <memory>
+#include <string>
+using std::unique_ptr;
+using std::string;
+
+namespace LibRpTexture { namespace Tests {
+
+struct RpImageUnrefDeleter {
+	void operator()(rp_image *img) {
+		UNREF(img);
+	}
+};
+typedef unique_ptr<rp_image, RpImageUnrefDeleter> unique_rp_image;
+
+// Unswizzle function.
+typedef rp_image *(*unswizzle_fn)(const rp_image *img, uint32_t mask_x, uint32_t mask_y);
+
+struct SwizzleTest_mode
+{
+	const char *name;	// Test name
+	int width;		// Image width
+	int height;		// Image height
+	uint32_t mask_x;	// X coordinate bits within a tile
+	uint32_t mask_y;	// Y coordinate bits within a tile
+};
+
+// Xbox swizzle masks. (Morton order, starting with X)
+#define XBOX_MODE(w, h, mx, my) {"Xbox_" #w "x" #h, (w), (h), (mx), (my)}
+// Dreamcast twiddle masks. (Morton order, starting with Y)
+#define DC_MODE(w, mx, my) {"Dreamcast_" #w "x" #w, (w), (w), (mx), (my)}
+
+static const SwizzleTest_mode swizzle_modes[] = {
+	XBOX_MODE(256, 256, 0x5555, 0xAAAA),
+	XBOX_MODE(256, 64, 0x3555, 0x0AAA),
+	XBOX_MODE(64, 256, 0x0555, 0x3AAA),
+	XBOX_MODE(8, 4, 0x15, 0x0A),
+	DC_MODE(256, 0xAAAA, 0x5555),
+	DC_MODE(8, 0x2A, 0x15),
+	DC_MODE(2, 0x2, 0x1),
+	DC_MODE(1, 0x0, 0x0),
+
+	// Nintendo 3DS: 8x8 Morton tiles, starting with X
+	{"N3DS_48x40", 48, 40, 0x15, 0x2A},
+	// GameCube: 4x4 row-major tiles
+	{"GCN_64x32", 64, 32, 0x3, 0xC},
+};
+
+class ImageDecoderSwizzleTest : public ::testing::TestWithParam<unsigned int>
+{
+	protected:
+		ImageDecoderSwizzleTest()
+			: ::testing::TestWithParam<unsigned int>()
+			, m_mode(nullptr)
+		{ }
+
+		void SetUp(void) final;
+
+	public:
+		/**
+		 * Compare two rp_image objects.
+		 * @param pImgExpected	[in] Expected image data.
+		 * @param pImgActual	[in] Actual image data.
+		 */
+		static void Compare_RpImage(
+			const rp_image *pImgExpected,
+			const rp_image *pImgActual);
+
+		/**
+		 * Deposit the low bits of a value into the set bits of a mask.
+		 * @param value Value.
+		 * @param mask Mask.
+		 * @return Deposited value.
+		 */
+		static uint32_t deposit_bits(uint32_t value, uint32_t mask);
+
+		/**
+		 * Unswizzle the test image and compare it to the reference image.
+		 * @param fn Unswizzle function.
+		 */
+		void unswizzleTest_internal(unswizzle_fn fn);
+
+		/**
+		 * Benchmark an unswizzle function.
+		 * @param fn Unswizzle function.
+		 */
+		void unswizzleBenchmark_internal(unswizzle_fn fn);
+
+		/**
+		 * Test case suffix generator.
+		 * @param info Test parameter information.
+		 * @return Test case suffix.
+		 */
+		static string test_case_suffix_generator(const ::testing::TestParamInfo<unsigned int> &info);
+
+		// Number of iterations for benchmarks.
+		static const unsigned int BENCHMARK_ITERATIONS = 10000;
+
+	public:
+		// Swizzled and reference images.
+		unique_rp_image m_img_swz;
+		unique_rp_image m_img_ref;
+
+		// Test mode.
+		const SwizzleTest_mode *m_mode;
+};
+
+/**
+ * Deposit the low bits of a value into the set bits of a mask.
+ * @param value Value.
+ * @param mask Mask.
+ * @return Deposited value.
+ */
+uint32_t ImageDecoderSwizzleTest::deposit_bits(uint32_t value, uint32_t mask)
+{
+	uint32_t result = 0;
+	for (uint32_t bit = 1; value != 0 && bit != 0; bit <<= 1) {
+		if (mask & bit) {
+			if (value & 1) {
+				result |= bit;
+			}
+			value >>= 1;
+		}
+	}
+	return result;
+}
+
+/**
+ * SetUp() function.
+ * Run before each test.
+ *
+ * Generates a pseudo-random swizzled image and the reference
+ * unswizzled image, using per-pixel bit deposits.
+ */
+void ImageDecoderSwizzleTest::SetUp(void)
+{
+	const unsigned int idx = GetParam();
+	ASSERT_LT(idx, ARRAY_SIZE(swizzle_modes));
+	m_mode = &swizzle_modes[idx];
+
+	const int width = m_mode->width;
+	const int height = m_mode->height;
+	m_img_swz.reset(new rp_image(width, height, rp_image::Format::ARGB32));
+	m_img_ref.reset(new rp_image(width, height, rp_image::Format::ARGB32));
+	ASSERT_TRUE(m_img_swz->isValid());
+	ASSERT_TRUE(m_img_ref->isValid());
+
+	static const rp_image::sBIT_t sBIT = {5,6,5,0,0};
+	m_img_swz->set_sBIT(&sBIT);
+	m_img_ref->set_sBIT(&sBIT);
+
+	// Simple LCG so the test data is reproducible.
+	uint32_t seed = 0x12345678U + idx;
+	for (int y = 0; y < height; y++) {
+		uint32_t *const pDest = static_cast<uint32_t*>(m_img_swz->scanLine(y));
+		for (int x = 0; x < width; x++) {
+			seed = seed * 1103515245U + 12345U;
+			pDest[x] = seed;
+		}
+	}
+
+	// Swizzled pixel indexes are contiguous, ignoring the stride.
+	const int tileW = 1 << popcount(m_mode->mask_x);
+	const int tileH = 1 << popcount(m_mode->mask_y);
+	const int tilesX = width / tileW;
+	for (int y = 0; y < height; y++) {
+		uint32_t *const pDest = static_cast<uint32_t*>(m_img_ref->scanLine(y));
+		for (int x = 0; x < width; x++) {
+			const unsigned int tileIdx = (y / tileH) * tilesX + (x / tileW);
+			const unsigned int srcIdx = (tileIdx * tileW * tileH) +
+				(deposit_bits(x % tileW, m_mode->mask_x) |
+				 deposit_bits(y % tileH, m_mode->mask_y));
+			const uint32_t *const pSrc = static_cast<const uint32_t*>(
+				m_img_swz->scanLine(srcIdx / width));
+			pDest[x] = pSrc[srcIdx % width];
+		}
+	}
+}
+
+/**
+ * Compare two rp_image objects.
+ * @param pImgExpected	[in] Expected image data.
+ * @param pImgActual	[in] Actual image data.
+ */
+void ImageDecoderSwizzleTest::Compare_RpImage(
+	const rp_image *pImgExpected,
+	const rp_image *pImgActual)
+{
+	ASSERT_TRUE(pImgExpected->isValid()) << "pImgExpected is not valid.";
+	ASSERT_TRUE(pImgActual->isValid())   << "pImgActual is not valid.";
+	ASSERT_EQ(rp_image::Format::ARGB32, pImgExpected->format());
+	ASSERT_EQ(rp_image::Format::ARGB32, pImgActual->format());
+	ASSERT_EQ(pImgExpected->width(),  pImgActual->width())  << "Image sizes don't match.";
+	ASSERT_EQ(pImgExpected->height(), pImgActual->height()) << "Image sizes don't match.";
+
+	rp_image::sBIT_t sBIT_expected, sBIT_actual;
+	ASSERT_EQ(0, pImgExpected->get_sBIT(&sBIT_expected));
+	ASSERT_EQ(0, pImgActual->get_sBIT(&sBIT_actual));
+	EXPECT_EQ(0, memcmp(&sBIT_expected, &sBIT_actual, sizeof(sBIT_expected))) << "sBIT values don't match.";
+
+	const int width = pImgExpected->width();
+	const int height = pImgExpected->height();
+	for (int y = 0; y < height; y++) {
+		const uint32_t *pBitsExpected = static_cast<const uint32_t*>(pImgExpected->scanLine(y));
+		const uint32_t *pBitsActual   = static_cast<const uint32_t*>(pImgActual->scanLine(y));
+		for (int x = 0; x < width; x++) {
+			ASSERT_EQ(pBitsExpected[x], pBitsActual[x]) <<
+				"Pixel (" << x << "," << y << ") does not match.";
+		}
+	}
+}
+
+/**
+ * Unswizzle the test image and compare it to the reference image.
+ * @param fn Unswizzle function.
+ */
+void ImageDecoderSwizzleTest::unswizzleTest_internal(unswizzle_fn fn)
+{
+	unique_rp_image img(fn(m_img_swz.get(), m_mode->mask_x, m_mode->mask_y));
+	ASSERT_TRUE(img != nullptr);
+	ASSERT_NO_FATAL_FAILURE(Compare_RpImage(m_img_ref.get(), img.get()));
+}
+
+/**
+ * Benchmark an unswizzle function.
+ * @param fn Unswizzle function.
+ */
+void ImageDecoderSwizzleTest::unswizzleBenchmark_internal(unswizzle_fn fn)
+{
+	for (unsigned int i = BENCHMARK_ITERATIONS; i > 0; i--) {
+		rp_image *const img = fn(m_img_swz.get(), m_mode->mask_x, m_mode->mask_y);
+		ASSERT_TRUE(img != nullptr);
+		img->unref();
+	}
+}
+
+/**
+ * Test case suffix generator.
+ * @param info Test parameter information.
+ * @return Test case suffix.
+ */
+string ImageDecoderSwizzleTest::test_case_suffix_generator(const ::testing::TestParamInfo<unsigned int> &info)
+{
+	return swizzle_modes[info.param].name;
+}
+
+/**
+ * Test the ImageDecoder::unswizzleMorton32() function. (Standard version)
+ */
+TEST_P(ImageDecoderSwizzleTest, unswizzleMorton32_cpp_test)
+{
+	ASSERT_NO_FATAL_FAILURE(unswizzleTest_internal(ImageDecoder::unswizzleMorton32_cpp));
+}
+
+/**
+ * Benchmark the ImageDecoder::unswizzleMorton32() function. (Standard version)
+ */
+TEST_P(ImageDecoderSwizzleTest, unswizzleMorton32_cpp_benchmark)
+{
+	ASSERT_NO_FATAL_FAILURE(unswizzleBenchmark_internal(ImageDecoder::unswizzleMorton32_cpp));
+}
+
+#ifdef IMAGEDECODER_HAS_SSE2
+/**
+ * Test the ImageDecoder::unswizzleMorton32() function. (SSE2-optimized version)
+ */
+TEST_P(ImageDecoderSwizzleTest, unswizzleMorton32_sse2_test)
+{
+	if (!RP_CPU_HasSSE2()) {
+		fprintf(stderr, "*** SSE2 is not supported on this CPU. Skipping test.\n");
+		return;
+	}
+
+	ASSERT_NO_FATAL_FAILURE(unswizzleTest_internal(ImageDecoder::unswizzleMorton32_sse2));
+}
+
+/**
+ * Benchmark the ImageDecoder::unswizzleMorton32() function. (SSE2-optimized version)
+ */
+TEST_P(ImageDecoderSwizzleTest, unswizzleMorton32_sse2_benchmark)
+{
+	if (!RP_CPU_HasSSE2()) {
+		fprintf(stderr, "*** SSE2 is not supported on this CPU. Skipping test.\n");
+		return;
+	}
+
+	ASSERT_NO_FATAL_FAILURE(unswizzleBenchmark_internal(ImageDecoder::unswizzleMorton32_sse2));
+}
+#endif /* IMAGEDECODER_HAS_SSE2 */
+
+/**
+ * Wrapper for the ImageDecoder::unswizzleMorton32() dispatch function.
+ * NOTE: Taking the address of an IFUNC symbol causes the resolver
+ * to run before the PLT is set up, so call it indirectly.
+ */
+static rp_image *unswizzleMorton32_dispatch(const rp_image *img, uint32_t mask_x, uint32_t mask_y)
+{
+	return ImageDecoder::unswizzleMorton32(img, mask_x, mask_y);
+}
+
+/**
+ * Test the ImageDecoder::unswizzleMorton32() dispatch function.
+ */
+TEST_P(ImageDecoderSwizzleTest, unswizzleMorton32_dispatch_test)
+{
+	ASSERT_NO_FATAL_FAILURE(unswizzleTest_internal(unswizzleMorton32_dispatch));
+}
+
+/**
+ * Benchmark the ImageDecoder::unswizzleMorton32() dispatch function.
+ */
+TEST_P(ImageDecoderSwizzleTest, unswizzleMorton32_dispatch_benchmark)
+{
+	ASSERT_NO_FATAL_FAILURE(unswizzleBenchmark_internal(unswizzleMorton32_dispatch));
+}
+
+// Test cases.
+INSTANTIATE_TEST_SUITE_P(unswizzleMorton32, ImageDecoderSwizzleTest,
+	::testing::Range(0U, static_cast<unsigned int>(ARRAY_SIZE(swizzle_modes))),
+	ImageDecoderSwizzleTest::test_case_suffix_generator);
+
+} }
+
+/**
+ * Test suite main function.
+ * Called by gtest_init.cpp.
+ */
+extern "C" int gtest_main(int argc, TCHAR *argv[])
+{
+	fprintf(stderr, "LibRpTexture test suite: ImageDecoder::unswizzleMorton32() tests.\n\n");
+	fprintf(stderr, "Benchmark iterations: %u\n",
+		LibRpTexture::Tests::ImageDecoderSwizzleTest::BENCHMARK_ITERATIONS);
+	fflush(nullptr);
+
+	// coverity[fun_call_w_exception]: uncaught exceptions cause nonzero exit anyway, so don't warn.
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
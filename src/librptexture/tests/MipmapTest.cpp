@@ -0,0 +1,301 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (librptexture/tests)               *
+ * MipmapTest.cpp: Test mipmap decoding in texture file formats.           *
+ *                                                                         *
+ * Copyright (c) 2016-2022 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+#include "tcharx.h"
+#include "common.h"
+#include "byteswap_rp.h"
+
+// librpfile
+#include "librpfile/MemFile.hpp"
+using LibRpFile::MemFile;
+
+// librptexture
+#include "librptexture/img/rp_image.hpp"
+#include "librptexture/fileformat/DirectDrawSurface.hpp"
+#include "librptexture/fileformat/KhronosKTX.hpp"
+#include "librptexture/fileformat/dds_structs.h"
+#include "librptexture/fileformat/ktx_structs.h"
+#include "librptexture/fileformat/gl_defs.h"
+
+// C includes.
+#include <stdint.h>
+#include <stdlib.h>
+
+// C includes. (C++ namespace)
+#include <cstring>
+
+// C++ includes.
+#include <memory>
+#include <vector>
+using std::vector;
+
+namespace LibRpTexture { namespace Tests {
+
+class MipmapTest : public ::testing::Test
+{
+	protected:
+		// Texture dimensions. (mipmap 0)
+		static const unsigned int TEX_WIDTH = 32;
+		static const unsigned int TEX_HEIGHT = 16;
+		// Number of mipmaps: 32x16, 16x8, 8x4, 4x2, 2x1, 1x1
+		static const unsigned int TEX_MIPMAPS = 6;
+
+		/**
+		 * Get the ARGB32 fill color for a mipmap level.
+		 * @param mip Mipmap number.
+		 * @return ARGB32 color.
+		 */
+		static inline uint32_t mipColor(int mip)
+		{
+			return 0xFF000000U | ((0x10U + mip) << 16) | ((0x40U + mip) << 8) | (0x80U + mip);
+		}
+
+		/**
+		 * Append a solid-color mipmap level as 32-bit pixels.
+		 * @param buf	[in,out] File buffer.
+		 * @param width	[in] Width.
+		 * @param height	[in] Height.
+		 * @param px	[in] Pixel value, in file byte order.
+		 */
+		static void appendLevel(vector<uint8_t> &buf, unsigned int width, unsigned int height, uint32_t px);
+
+		/**
+		 * Build an uncompressed ARGB8888 DDS texture with mipmaps.
+		 * @param buf	[out] File buffer.
+		 */
+		static void buildDDS(vector<uint8_t> &buf);
+
+		/**
+		 * Build an uncompressed GL_RGBA KTX texture with mipmaps.
+		 * @param buf	[out] File buffer.
+		 */
+		static void buildKTX(vector<uint8_t> &buf);
+
+		/**
+		 * Check the decoded mipmaps of a texture.
+		 * @param fileFormat	[in] FileFormat
+		 */
+		static void checkMipmaps(const FileFormat *fileFormat);
+};
+
+/**
+ * Append a solid-color mipmap level as 32-bit pixels.
+ * @param buf	[in,out] File buffer.
+ * @param width	[in] Width.
+ * @param height	[in] Height.
+ * @param px	[in] Pixel value, in file byte order.
+ */
+void MipmapTest::appendLevel(vector<uint8_t> &buf, unsigned int width, unsigned int height, uint32_t px)
+{
+	const size_t pos = buf.size();
+	buf.resize(pos + (width * height * sizeof(uint32_t)));
+	uint32_t *p = reinterpret_cast<uint32_t*>(&buf[pos]);
+	for (unsigned int i = width * height; i > 0; i--, p++) {
+		*p = px;
+	}
+}
+
+/**
+ * Build an uncompressed ARGB8888 DDS texture with mipmaps.
+ * @param buf	[out] File buffer.
+ */
+void MipmapTest::buildDDS(vector<uint8_t> &buf)
+{
+	DDS_HEADER ddsHeader;
+	memset(&ddsHeader, 0, sizeof(ddsHeader));
+	ddsHeader.dwSize = cpu_to_le32(sizeof(ddsHeader));
+	ddsHeader.dwFlags = cpu_to_le32(DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH |
+		DDSD_PITCH | DDSD_PIXELFORMAT | DDSD_MIPMAPCOUNT);
+	ddsHeader.dwHeight = cpu_to_le32(TEX_HEIGHT);
+	ddsHeader.dwWidth = cpu_to_le32(TEX_WIDTH);
+	ddsHeader.dwPitchOrLinearSize = cpu_to_le32(TEX_WIDTH * 4);
+	ddsHeader.dwMipMapCount = cpu_to_le32(TEX_MIPMAPS);
+	ddsHeader.ddspf.dwSize = cpu_to_le32(sizeof(ddsHeader.ddspf));
+	ddsHeader.ddspf.dwFlags = cpu_to_le32(DDPF_RGB | DDPF_ALPHAPIXELS);
+	ddsHeader.ddspf.dwRGBBitCount = cpu_to_le32(32);
+	ddsHeader.ddspf.dwRBitMask = cpu_to_le32(0x00FF0000);
+	ddsHeader.ddspf.dwGBitMask = cpu_to_le32(0x0000FF00);
+	ddsHeader.ddspf.dwBBitMask = cpu_to_le32(0x000000FF);
+	ddsHeader.ddspf.dwABitMask = cpu_to_le32(0xFF000000);
+	ddsHeader.dwCaps = cpu_to_le32(DDSCAPS_TEXTURE | DDSCAPS_COMPLEX | DDSCAPS_MIPMAP);
+
+	const uint32_t magic = cpu_to_be32(DDS_MAGIC);
+	buf.resize(sizeof(magic) + sizeof(ddsHeader));
+	memcpy(&buf[0], &magic, sizeof(magic));
+	memcpy(&buf[sizeof(magic)], &ddsHeader, sizeof(ddsHeader));
+
+	unsigned int width = TEX_WIDTH, height = TEX_HEIGHT;
+	for (unsigned int mip = 0; mip < TEX_MIPMAPS; mip++) {
+		appendLevel(buf, width, height, cpu_to_le32(mipColor(mip)));
+		width = std::max(width / 2, 1U);
+		height = std::max(height / 2, 1U);
+	}
+}
+
+/**
+ * Build an uncompressed GL_RGBA KTX texture with mipmaps.
+ * @param buf	[out] File buffer.
+ */
+void MipmapTest::buildKTX(vector<uint8_t> &buf)
+{
+	KTX_Header ktxHeader;
+	memset(&ktxHeader, 0, sizeof(ktxHeader));
+	memcpy(ktxHeader.identifier, KTX_IDENTIFIER, sizeof(ktxHeader.identifier));
+	ktxHeader.endianness = KTX_ENDIAN_MAGIC;
+	ktxHeader.glType = GL_UNSIGNED_BYTE;
+	ktxHeader.glTypeSize = 1;
+	ktxHeader.glFormat = GL_RGBA;
+	ktxHeader.glInternalFormat = GL_RGBA8;
+	ktxHeader.glBaseInternalFormat = GL_RGBA;
+	ktxHeader.pixelWidth = TEX_WIDTH;
+	ktxHeader.pixelHeight = TEX_HEIGHT;
+	ktxHeader.numberOfFaces = 1;
+	ktxHeader.numberOfMipmapLevels = TEX_MIPMAPS;
+
+	buf.resize(sizeof(ktxHeader));
+	memcpy(&buf[0], &ktxHeader, sizeof(ktxHeader));
+
+	// KTX stores GL_RGBA as R, G, B, A bytes.
+	unsigned int width = TEX_WIDTH, height = TEX_HEIGHT;
+	for (unsigned int mip = 0; mip < TEX_MIPMAPS; mip++) {
+		const uint32_t imageSize = width * height * sizeof(uint32_t);
+		const size_t pos = buf.size();
+		buf.resize(pos + sizeof(imageSize));
+		memcpy(&buf[pos], &imageSize, sizeof(imageSize));
+
+		const uint32_t argb = mipColor(mip);
+		const uint8_t rgba[4] = {
+			static_cast<uint8_t>(argb >> 16), static_cast<uint8_t>(argb >> 8),
+			static_cast<uint8_t>(argb), static_cast<uint8_t>(argb >> 24)
+		};
+		uint32_t px;
+		memcpy(&px, rgba, sizeof(px));
+		appendLevel(buf, width, height, px);
+
+		width = std::max(width / 2, 1U);
+		height = std::max(height / 2, 1U);
+	}
+}
+
+/**
+ * Check the decoded mipmaps of a texture.
+ * @param fileFormat	[in] FileFormat
+ */
+void MipmapTest::checkMipmaps(const FileFormat *fileFormat)
+{
+	ASSERT_TRUE(fileFormat->isValid());
+	ASSERT_EQ(static_cast<int>(TEX_MIPMAPS), fileFormat->mipmapCount());
+
+	int width = TEX_WIDTH, height = TEX_HEIGHT;
+	for (int mip = 0; mip < static_cast<int>(TEX_MIPMAPS); mip++) {
+		const rp_image *const img = fileFormat->mipmap(mip);
+		ASSERT_TRUE(img != nullptr) << "Mipmap " << mip << " could not be decoded.";
+		EXPECT_EQ(width, img->width()) << "Mipmap " << mip << " has the wrong width.";
+		EXPECT_EQ(height, img->height()) << "Mipmap " << mip << " has the wrong height.";
+
+		// The image is a solid color.
+		const uint32_t expected = mipColor(mip);
+		for (int y = 0; y < img->height(); y++) {
+			const uint32_t *px = static_cast<const uint32_t*>(img->scanLine(y));
+			for (int x = 0; x < img->width(); x++) {
+				ASSERT_EQ(expected, px[x]) << "Mipmap " << mip << " differs at (" << x << ',' << y << ')';
+			}
+		}
+
+		// Decoded mipmaps are cached.
+		EXPECT_EQ(img, fileFormat->mipmap(mip));
+
+		width = std::max(width / 2, 1);
+		height = std::max(height / 2, 1);
+	}
+
+	// Out of range.
+	EXPECT_TRUE(fileFormat->mipmap(TEX_MIPMAPS) == nullptr);
+
+	// imageForSize() should return the smallest mipmap that's
+	// at least as large as the requested size.
+	EXPECT_EQ(fileFormat->mipmap(0), fileFormat->imageForSize(TEX_WIDTH, false));
+	EXPECT_EQ(fileFormat->mipmap(1), fileFormat->imageForSize(TEX_WIDTH / 2, false));
+	EXPECT_EQ(fileFormat->mipmap(2), fileFormat->imageForSize(TEX_WIDTH / 4, false));
+	EXPECT_EQ(fileFormat->mipmap(1), fileFormat->imageForSize(TEX_WIDTH / 4 + 1, false));
+}
+
+/**
+ * DirectDrawSurface: Uncompressed mipmaps.
+ */
+TEST_F(MipmapTest, DirectDrawSurface)
+{
+	vector<uint8_t> buf;
+	buildDDS(buf);
+
+	MemFile *const memFile = new MemFile(buf.data(), buf.size());
+	ASSERT_TRUE(memFile->isOpen());
+	DirectDrawSurface *const dds = new DirectDrawSurface(memFile);
+	memFile->unref();
+
+	ASSERT_NO_FATAL_FAILURE(checkMipmaps(dds));
+	dds->unref();
+}
+
+/**
+ * KhronosKTX: Uncompressed mipmaps.
+ */
+TEST_F(MipmapTest, KhronosKTX)
+{
+	vector<uint8_t> buf;
+	buildKTX(buf);
+
+	MemFile *const memFile = new MemFile(buf.data(), buf.size());
+	ASSERT_TRUE(memFile->isOpen());
+	KhronosKTX *const ktx = new KhronosKTX(memFile);
+	memFile->unref();
+
+	ASSERT_NO_FATAL_FAILURE(checkMipmaps(ktx));
+	ktx->unref();
+}
+
+/**
+ * DirectDrawSurface: Truncated mipmap data.
+ * Mipmaps past the end of the file must not be decoded.
+ */
+TEST_F(MipmapTest, DirectDrawSurface_truncated)
+{
+	vector<uint8_t> buf;
+	buildDDS(buf);
+	// Remove the last two mipmaps. (2x1, 1x1)
+	buf.resize(buf.size() - ((2 + 1) * sizeof(uint32_t)));
+
+	MemFile *const memFile = new MemFile(buf.data(), buf.size());
+	ASSERT_TRUE(memFile->isOpen());
+	DirectDrawSurface *const dds = new DirectDrawSurface(memFile);
+	memFile->unref();
+
+	ASSERT_TRUE(dds->isValid());
+	EXPECT_TRUE(dds->mipmap(3) != nullptr);
+	EXPECT_TRUE(dds->mipmap(4) == nullptr);
+	EXPECT_TRUE(dds->mipmap(5) == nullptr);
+	dds->unref();
+}
+
+} }
+
+/**
+ * Test suite main function.
+ * Called by gtest_init.cpp.
+ */
+extern "C" int gtest_main(int argc, TCHAR *argv[])
+{
+	fprintf(stderr, "LibRpTexture test suite: Mipmap tests.\n\n");
+	fflush(nullptr);
+
+	// coverity[fun_call_w_exception]: uncaught exceptions cause nonzero exit anyway, so don't warn.
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
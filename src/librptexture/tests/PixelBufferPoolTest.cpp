@@ -0,0 +1,229 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (librptexture/tests)               *
+ * PixelBufferPoolTest.cpp: Test PixelBufferPool.                          *
+ *                                                                         *
+ * Copyright (c) 2016-2022 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+#include "tcharx.h"
+#include "common.h"
+
+// librptexture
+#include "librptexture/img/PixelBufferPool.hpp"
+#include "librptexture/img/rp_image.hpp"
+
+// C includes.
+#include <stdint.h>
+#include <stdlib.h>
+
+// C includes. (C++ namespace)
+#include <cstring>
+
+// C++ includes.
+#include <vector>
+using std::vector;
+
+namespace LibRpTexture { namespace Tests {
+
+class PixelBufferPoolTest : public ::testing::Test
+{
+	protected:
+		void SetUp(void) final
+		{
+			// Start each test with empty free lists.
+			PixelBufferPool::trim();
+			PixelBufferPool::getStats(&m_stats);
+		}
+
+		void TearDown(void) final
+		{
+			PixelBufferPool::trim();
+		}
+
+	public:
+		// Statistics at the start of the test.
+		PixelBufferPool::Stats m_stats;
+
+	public:
+		// Number of iterations for benchmarks.
+		static const unsigned int BENCHMARK_ITERATIONS = 100000;
+
+	public:
+		/**
+		 * Get the statistics since the start of the test.
+		 * @param pStats	[out] Statistics.
+		 */
+		void getStatsDelta(PixelBufferPool::Stats *pStats) const
+		{
+			PixelBufferPool::getStats(pStats);
+			pStats->allocs -= m_stats.allocs;
+			pStats->hits -= m_stats.hits;
+			pStats->oversize -= m_stats.oversize;
+			pStats->evictions -= m_stats.evictions;
+		}
+};
+
+/**
+ * All buffers must be 16-byte aligned and writable.
+ */
+TEST_F(PixelBufferPoolTest, alignment)
+{
+	static const size_t sizes[] = {
+		1, 16, 1000, 1024, 1025, 4096, 9216, 12288, 262144, 1048576, 2*1048576,
+	};
+
+	for (size_t size : sizes) {
+		void *const ptr = PixelBufferPool::allocBuffer(size);
+		ASSERT_TRUE(ptr != nullptr);
+		EXPECT_EQ(0U, reinterpret_cast<uintptr_t>(ptr) & 15) << "size == " << size;
+		memset(ptr, 0x55, size);
+		PixelBufferPool::freeBuffer(ptr);
+	}
+}
+
+/**
+ * A freed buffer must be reused for a request in the same size class.
+ */
+TEST_F(PixelBufferPoolTest, reuse)
+{
+	void *const ptr1 = PixelBufferPool::allocBuffer(4096);
+	ASSERT_TRUE(ptr1 != nullptr);
+	PixelBufferPool::freeBuffer(ptr1);
+
+	// 4000 bytes is in the same size class as 4096 bytes.
+	void *const ptr2 = PixelBufferPool::allocBuffer(4000);
+	EXPECT_EQ(ptr1, ptr2);
+
+	// 4097 bytes is in the next size class.
+	void *const ptr3 = PixelBufferPool::allocBuffer(4097);
+	EXPECT_NE(ptr1, ptr3);
+
+	PixelBufferPool::freeBuffer(ptr2);
+	PixelBufferPool::freeBuffer(ptr3);
+
+	PixelBufferPool::Stats stats;
+	getStatsDelta(&stats);
+	EXPECT_EQ(3U, stats.allocs);
+	EXPECT_EQ(1U, stats.hits);
+	EXPECT_EQ(0U, stats.oversize);
+}
+
+/**
+ * Buffers larger than the largest size class aren't pooled.
+ */
+TEST_F(PixelBufferPoolTest, oversize)
+{
+	void *const ptr = PixelBufferPool::allocBuffer(2*1048576);
+	ASSERT_TRUE(ptr != nullptr);
+	PixelBufferPool::freeBuffer(ptr);
+
+	PixelBufferPool::Stats stats;
+	getStatsDelta(&stats);
+	EXPECT_EQ(1U, stats.allocs);
+	EXPECT_EQ(0U, stats.hits);
+	EXPECT_EQ(1U, stats.oversize);
+}
+
+/**
+ * The free lists must be bounded.
+ */
+TEST_F(PixelBufferPoolTest, bounded)
+{
+	// Per-class limit.
+	static const unsigned int count = PixelBufferPool::MAX_BUFFERS_PER_CLASS + 4;
+	vector<void*> bufs;
+	for (unsigned int i = 0; i < count; i++) {
+		bufs.push_back(PixelBufferPool::allocBuffer(4096));
+	}
+	for (void *ptr : bufs) {
+		PixelBufferPool::freeBuffer(ptr);
+	}
+
+	PixelBufferPool::Stats stats;
+	getStatsDelta(&stats);
+	EXPECT_EQ(4U, stats.evictions);
+
+	// Total size limit. (1 MB buffers)
+	PixelBufferPool::trim();
+	PixelBufferPool::getStats(&m_stats);
+	static const unsigned int maxBufs = static_cast<unsigned int>(PixelBufferPool::MAX_POOLED_BYTES / 1048576);
+	bufs.clear();
+	for (unsigned int i = 0; i < maxBufs + 2; i++) {
+		bufs.push_back(PixelBufferPool::allocBuffer(1048576));
+	}
+	for (void *ptr : bufs) {
+		PixelBufferPool::freeBuffer(ptr);
+	}
+
+	getStatsDelta(&stats);
+	EXPECT_EQ(2U, stats.evictions);
+}
+
+/**
+ * rp_image uses the pool for both pixel data and palettes.
+ */
+TEST_F(PixelBufferPoolTest, rp_image)
+{
+	for (int i = 0; i < 4; i++) {
+		rp_image *const img_argb = new rp_image(48, 48, rp_image::Format::ARGB32);
+		rp_image *const img_ci8 = new rp_image(32, 32, rp_image::Format::CI8);
+		ASSERT_TRUE(img_argb->isValid());
+		ASSERT_TRUE(img_ci8->isValid());
+		img_argb->unref();
+		img_ci8->unref();
+	}
+
+	// 3 allocations per iteration: ARGB32 data, CI8 data, CI8 palette.
+	// All iterations after the first should be satisfied by the pool.
+	PixelBufferPool::Stats stats;
+	getStatsDelta(&stats);
+	EXPECT_EQ(12U, stats.allocs);
+	EXPECT_EQ(9U, stats.hits);
+}
+
+/**
+ * Benchmark creating and deleting images with typical
+ * icon, banner, and thumbnail sizes.
+ */
+TEST_F(PixelBufferPoolTest, rp_image_benchmark)
+{
+	static const struct {
+		int width;
+		int height;
+	} sizes[] = {
+		{32, 32}, {48, 48}, {96, 32}, {256, 256},
+	};
+
+	for (unsigned int i = BENCHMARK_ITERATIONS; i > 0; i--) {
+		for (const auto &sz : sizes) {
+			rp_image *const img = new rp_image(sz.width, sz.height, rp_image::Format::ARGB32);
+			img->unref();
+		}
+	}
+
+	PixelBufferPool::Stats stats;
+	getStatsDelta(&stats);
+	fprintf(stderr, "Pool statistics: %u allocs, %u%% hit rate, %u oversize, %u evictions\n",
+		stats.allocs, stats.hitRate(), stats.oversize, stats.evictions);
+}
+
+} }
+
+/**
+ * Test suite main function.
+ * Called by gtest_init.cpp.
+ */
+extern "C" int gtest_main(int argc, TCHAR *argv[])
+{
+	fprintf(stderr, "LibRpTexture test suite: PixelBufferPool tests.\n\n");
+	fprintf(stderr, "Benchmark iterations: %u\n",
+		LibRpTexture::Tests::PixelBufferPoolTest::BENCHMARK_ITERATIONS);
+	fflush(nullptr);
+
+	// coverity[fun_call_w_exception]: uncaught exceptions cause nonzero exit anyway, so don't warn.
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
@@ -0,0 +1,325 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (librptexture/tests)               *
+ * RpImagePipelineTest.cpp: Test rp_image::process() and processed().      *
+ *                                                                         *
+ * Copyright (c) 2016-2022 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+#include "tcharx.h"
+#include "common.h"
+
+// librptexture
+#include "librptexture/img/rp_image.hpp"
+
+// C includes.
+#include <stdint.h>
+#include <stdlib.h>
+
+// C includes. (C++ namespace)
+#include <cstring>
+
+// C++ includes.
+#include <memory>
+#include <vector>
+using std::unique_ptr;
+
+namespace LibRpTexture { namespace Tests {
+
+struct RpImageUnrefDeleter {
+	void operator()(rp_image *img) {
+		UNREF(img);
+	}
+};
+typedef unique_ptr<rp_image, RpImageUnrefDeleter> unique_rp_image;
+
+// Chroma key used for testing.
+static const uint32_t CHROMA_KEY = 0xFFFF00FF;
+
+class RpImagePipelineTest : public ::testing::Test
+{
+	protected:
+		RpImagePipelineTest()
+			: m_argb32(new rp_image(509, 383, rp_image::Format::ARGB32))
+			, m_ci8(new rp_image(211, 317, rp_image::Format::CI8))
+		{
+			// Initialize the images with pseudo-random data,
+			// including chroma-keyed and semi-transparent pixels.
+			uint32_t seed = 0x12345678;
+			for (int y = 0; y < m_argb32->height(); y++) {
+				uint32_t *px = static_cast<uint32_t*>(m_argb32->scanLine(y));
+				for (int x = m_argb32->width(); x > 0; x--, px++) {
+					*px = randomPixel(seed);
+				}
+			}
+
+			uint32_t *const palette = m_ci8->palette();
+			for (unsigned int i = 0; i < m_ci8->palette_len(); i++) {
+				palette[i] = randomPixel(seed);
+			}
+			palette[7] = CHROMA_KEY;
+			for (int y = 0; y < m_ci8->height(); y++) {
+				uint8_t *px = static_cast<uint8_t*>(m_ci8->scanLine(y));
+				for (int x = m_ci8->width(); x > 0; x--, px++) {
+					seed = seed * 1103515245 + 12345;
+					*px = static_cast<uint8_t>(seed >> 16);
+				}
+			}
+		}
+
+	public:
+		unique_rp_image m_argb32;
+		unique_rp_image m_ci8;
+
+	public:
+		// Number of iterations for benchmarks.
+		static const unsigned int BENCHMARK_ITERATIONS = 1000;
+
+	public:
+		/**
+		 * Generate a pseudo-random ARGB32 pixel.
+		 * @param seed	[in,out] Seed.
+		 * @return ARGB32 pixel.
+		 */
+		static uint32_t randomPixel(uint32_t &seed);
+
+		/**
+		 * Apply PixelOps using the separate whole-image functions.
+		 * @param src	[in] Source image.
+		 * @param ops	[in] Pixel operations.
+		 * @return New ARGB32 image.
+		 */
+		static rp_image *applySeparately(const rp_image *src, const rp_image::PixelOps &ops);
+
+		/**
+		 * Compare two ARGB32 images.
+		 * @param expected	[in] Expected image.
+		 * @param actual	[in] Actual image.
+		 */
+		static void compareImages(const rp_image *expected, const rp_image *actual);
+
+		/**
+		 * PixelOps combinations to test.
+		 * @return Array of PixelOps.
+		 */
+		static std::vector<rp_image::PixelOps> testOps(void);
+};
+
+/**
+ * Generate a pseudo-random ARGB32 pixel.
+ * @param seed	[in,out] Seed.
+ * @return ARGB32 pixel.
+ */
+uint32_t RpImagePipelineTest::randomPixel(uint32_t &seed)
+{
+	seed = seed * 1103515245 + 12345;
+	uint32_t argb = seed ^ (seed >> 16);
+	switch (argb & 7) {
+		case 0:	argb &= 0x00FFFFFF; break;
+		case 1:	argb = CHROMA_KEY; break;
+		case 2: case 3:	argb |= 0xFF000000; break;
+		default: break;
+	}
+	return argb;
+}
+
+/**
+ * Apply PixelOps using the separate whole-image functions.
+ * @param src	[in] Source image.
+ * @param ops	[in] Pixel operations.
+ * @return New ARGB32 image.
+ */
+rp_image *RpImagePipelineTest::applySeparately(const rp_image *src, const rp_image::PixelOps &ops)
+{
+	rp_image *img = src->dup_ARGB32();
+	for (unsigned int i = 0; i < ops.count; i++) {
+		switch (ops.ops[i].op) {
+			case rp_image::PixelOps::Op::ChromaKey:
+				img->apply_chroma_key(ops.ops[i].param);
+				break;
+			case rp_image::PixelOps::Op::SwapRB:
+				img->swapRB();
+				break;
+			case rp_image::PixelOps::Op::UnPremultiply:
+				img->un_premultiply();
+				break;
+			case rp_image::PixelOps::Op::Premultiply:
+				img->premultiply();
+				break;
+		}
+	}
+	if (ops.flipOp != rp_image::FLIP_NONE) {
+		rp_image *const tmp = img->flip(ops.flipOp);
+		img->unref();
+		img = tmp;
+	}
+	if (ops.square) {
+		rp_image *const tmp = img->squared();
+		img->unref();
+		img = tmp;
+	}
+	return img;
+}
+
+/**
+ * Compare two ARGB32 images.
+ * @param expected	[in] Expected image.
+ * @param actual	[in] Actual image.
+ */
+void RpImagePipelineTest::compareImages(const rp_image *expected, const rp_image *actual)
+{
+	ASSERT_TRUE(expected != nullptr);
+	ASSERT_TRUE(actual != nullptr);
+	ASSERT_EQ(rp_image::Format::ARGB32, actual->format());
+	ASSERT_EQ(expected->width(), actual->width());
+	ASSERT_EQ(expected->height(), actual->height());
+
+	for (int y = 0; y < expected->height(); y++) {
+		ASSERT_EQ(0, memcmp(expected->scanLine(y), actual->scanLine(y), expected->row_bytes())) <<
+			"Images differ at row " << y;
+	}
+
+	rp_image::sBIT_t sBIT_expected, sBIT_actual;
+	const int ret_expected = expected->get_sBIT(&sBIT_expected);
+	ASSERT_EQ(ret_expected, actual->get_sBIT(&sBIT_actual));
+	if (ret_expected == 0) {
+		EXPECT_EQ(0, memcmp(&sBIT_expected, &sBIT_actual, sizeof(sBIT_expected)));
+	}
+}
+
+/**
+ * PixelOps combinations to test.
+ * @return Array of PixelOps.
+ */
+std::vector<rp_image::PixelOps> RpImagePipelineTest::testOps(void)
+{
+	std::vector<rp_image::PixelOps> v;
+	v.push_back(rp_image::PixelOps());
+	v.push_back(rp_image::PixelOps().apply_chroma_key(CHROMA_KEY));
+	v.push_back(rp_image::PixelOps().swapRB().flip(rp_image::FLIP_H));
+	v.push_back(rp_image::PixelOps().un_premultiply().flip(rp_image::FLIP_V));
+	v.push_back(rp_image::PixelOps().premultiply().swapRB().flip(rp_image::FLIP_VH));
+	v.push_back(rp_image::PixelOps().apply_chroma_key(CHROMA_KEY).swapRB()
+		.flip(rp_image::FLIP_V).squared());
+	v.push_back(rp_image::PixelOps().premultiply().un_premultiply()
+		.flip(rp_image::FLIP_H).squared());
+	return v;
+}
+
+/**
+ * processed() must match the separate operations. (ARGB32)
+ */
+TEST_F(RpImagePipelineTest, processed_argb32)
+{
+	static const rp_image::sBIT_t sBIT = {8,8,8,0,0};
+	m_argb32->set_sBIT(&sBIT);
+
+	for (const auto &ops : testOps()) {
+		unique_rp_image expected(applySeparately(m_argb32.get(), ops));
+		unique_rp_image actual(m_argb32->processed(ops));
+		ASSERT_NO_FATAL_FAILURE(compareImages(expected.get(), actual.get()));
+	}
+}
+
+/**
+ * processed() must match the separate operations. (CI8)
+ */
+TEST_F(RpImagePipelineTest, processed_ci8)
+{
+	for (const auto &ops : testOps()) {
+		unique_rp_image expected(applySeparately(m_ci8.get(), ops));
+		unique_rp_image actual(m_ci8->processed(ops));
+		ASSERT_NO_FATAL_FAILURE(compareImages(expected.get(), actual.get()));
+	}
+}
+
+/**
+ * process() must match the separate operations. (ARGB32)
+ */
+TEST_F(RpImagePipelineTest, process_argb32)
+{
+	for (const auto &ops : testOps()) {
+		if (ops.square) {
+			// Not supported in place.
+			continue;
+		}
+
+		unique_rp_image expected(applySeparately(m_argb32.get(), ops));
+		unique_rp_image actual(m_argb32->dup());
+		ASSERT_EQ(0, actual->process(ops));
+		ASSERT_NO_FATAL_FAILURE(compareImages(expected.get(), actual.get()));
+	}
+}
+
+/**
+ * process() must match the separate operations. (CI8)
+ */
+TEST_F(RpImagePipelineTest, process_ci8)
+{
+	for (const auto &ops : testOps()) {
+		if (ops.square) {
+			// Not supported in place.
+			continue;
+		}
+
+		unique_rp_image expected(applySeparately(m_ci8.get(), ops));
+		unique_rp_image tmp(m_ci8->dup());
+		ASSERT_EQ(0, tmp->process(ops));
+		EXPECT_EQ(rp_image::Format::CI8, tmp->format());
+		unique_rp_image actual(tmp->dup_ARGB32());
+		ASSERT_NO_FATAL_FAILURE(compareImages(expected.get(), actual.get()));
+	}
+}
+
+/**
+ * Benchmark the common thumbnail sequence using separate operations:
+ * chroma key, swap R/B, vertical flip, square.
+ */
+TEST_F(RpImagePipelineTest, thumbnail_separate_benchmark)
+{
+	for (unsigned int i = BENCHMARK_ITERATIONS; i > 0; i--) {
+		rp_image *const img = m_argb32->dup();
+		img->apply_chroma_key(CHROMA_KEY);
+		img->swapRB();
+		rp_image *const flipimg = img->flip(rp_image::FLIP_V);
+		img->unref();
+		rp_image *const sqimg = flipimg->squared();
+		flipimg->unref();
+		sqimg->unref();
+	}
+}
+
+/**
+ * Benchmark the common thumbnail sequence using processed():
+ * chroma key, swap R/B, vertical flip, square.
+ */
+TEST_F(RpImagePipelineTest, thumbnail_fused_benchmark)
+{
+	const rp_image::PixelOps ops = rp_image::PixelOps()
+		.apply_chroma_key(CHROMA_KEY).swapRB()
+		.flip(rp_image::FLIP_V).squared();
+	for (unsigned int i = BENCHMARK_ITERATIONS; i > 0; i--) {
+		rp_image *const img = m_argb32->processed(ops);
+		img->unref();
+	}
+}
+
+} }
+
+/**
+ * Test suite main function.
+ * Called by gtest_init.cpp.
+ */
+extern "C" int gtest_main(int argc, TCHAR *argv[])
+{
+	fprintf(stderr, "LibRpTexture test suite: rp_image pixel pipeline tests.\n\n");
+	fprintf(stderr, "Benchmark iterations: %u\n",
+		LibRpTexture::Tests::RpImagePipelineTest::BENCHMARK_ITERATIONS);
+	fflush(nullptr);
+
+	// coverity[fun_call_w_exception]: uncaught exceptions cause nonzero exit anyway, so don't warn.
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
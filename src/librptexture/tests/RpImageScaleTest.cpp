@@ -0,0 +1,316 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (librptexture/tests)               *
+ * RpImageScaleTest.cpp: Test rp_image::scaled().                          *
+ *                                                                         *
+ * Copyright (c) 2016-2022 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+#include "tcharx.h"
+#include "common.h"
+
+// librptexture
+#include "librptexture/img/rp_image.hpp"
+
+// C includes.
+#include <stdint.h>
+#include <stdlib.h>
+
+// C includes. (C++ namespace)
+#include <cstring>
+
+// C++ includes.
+#include <memory>
+#include <string>
+using std::unique_ptr;
+using std::string;
+
+namespace LibRpTexture { namespace Tests {
+
+struct RpImageUnrefDeleter {
+	void operator()(rp_image *img) {
+		UNREF(img);
+	}
+};
+typedef unique_ptr<rp_image, RpImageUnrefDeleter> unique_rp_image;
+
+// rp_image::scaled() function.
+typedef rp_image *(rp_image::*scaled_fn)(int width, int height, rp_image::ScaleFilter filter) const;
+
+class RpImageScaleTest : public ::testing::Test
+{
+	protected:
+		RpImageScaleTest()
+			: m_img(new rp_image(509, 383, rp_image::Format::ARGB32))
+		{
+			// Initialize the image with pseudo-random data,
+			// including fully-transparent and opaque pixels.
+			uint32_t seed = 0x12345678;
+			for (int y = 0; y < m_img->height(); y++) {
+				uint32_t *px = static_cast<uint32_t*>(m_img->scanLine(y));
+				for (int x = m_img->width(); x > 0; x--, px++) {
+					seed = seed * 1103515245 + 12345;
+					uint32_t argb = seed ^ (seed >> 16);
+					switch (argb & 3) {
+						case 0:	argb &= 0x00FFFFFF; break;
+						case 1:	argb |= 0xFF000000; break;
+						default: break;
+					}
+					*px = argb;
+				}
+			}
+		}
+
+	public:
+		unique_rp_image m_img;
+
+	public:
+		// Number of iterations for benchmarks.
+		static const unsigned int BENCHMARK_ITERATIONS = 1000;
+
+	public:
+		/**
+		 * Fill an ARGB32 image with a single color.
+		 * @param img	[in,out] Image.
+		 * @param color	[in] ARGB32 color.
+		 */
+		static void fill(rp_image *img, uint32_t color);
+
+		/**
+		 * Verify that the scaled images are identical to the standard version.
+		 * @param fn	[in] rp_image::scaled() function.
+		 */
+		void compareToCpp(scaled_fn fn);
+
+		/**
+		 * Benchmark an rp_image::scaled() function.
+		 * @param fn	[in] rp_image::scaled() function.
+		 */
+		void benchmark(scaled_fn fn);
+};
+
+/**
+ * Fill an ARGB32 image with a single color.
+ * @param img	[in,out] Image.
+ * @param color	[in] ARGB32 color.
+ */
+void RpImageScaleTest::fill(rp_image *img, uint32_t color)
+{
+	for (int y = 0; y < img->height(); y++) {
+		uint32_t *px = static_cast<uint32_t*>(img->scanLine(y));
+		for (int x = img->width(); x > 0; x--, px++) {
+			*px = color;
+		}
+	}
+}
+
+/**
+ * Verify that the scaled images are identical to the standard version.
+ * @param fn	[in] rp_image::scaled() function.
+ */
+void RpImageScaleTest::compareToCpp(scaled_fn fn)
+{
+	static const struct {
+		int width;
+		int height;
+	} sizes[] = {
+		{256, 256}, {127, 95}, {1, 1}, {3, 500}, {509, 383}, {1018, 766},
+	};
+	static const rp_image::ScaleFilter filters[] = {
+		rp_image::ScaleFilter::Box,
+		rp_image::ScaleFilter::Bilinear,
+	};
+
+	for (const auto &sz : sizes) {
+		for (const auto filter : filters) {
+			unique_rp_image expected(m_img->scaled_cpp(sz.width, sz.height, filter));
+			unique_rp_image actual(((*m_img).*fn)(sz.width, sz.height, filter));
+			ASSERT_TRUE((bool)expected);
+			ASSERT_TRUE((bool)actual);
+			ASSERT_EQ(sz.width, actual->width());
+			ASSERT_EQ(sz.height, actual->height());
+			ASSERT_EQ(rp_image::Format::ARGB32, actual->format());
+
+			for (int y = 0; y < sz.height; y++) {
+				ASSERT_EQ(0, memcmp(expected->scanLine(y), actual->scanLine(y), actual->row_bytes())) <<
+					"Scaled image to " << sz.width << 'x' << sz.height <<
+					" (filter " << static_cast<int>(filter) << ") differs at row " << y;
+			}
+		}
+	}
+}
+
+/**
+ * Benchmark an rp_image::scaled() function.
+ * @param fn	[in] rp_image::scaled() function.
+ */
+void RpImageScaleTest::benchmark(scaled_fn fn)
+{
+	for (unsigned int i = BENCHMARK_ITERATIONS; i > 0; i--) {
+		rp_image *const img = ((*m_img).*fn)(256, 192, rp_image::ScaleFilter::Box);
+		UNREF(img);
+	}
+}
+
+/**
+ * A solid color must be preserved by both filters.
+ */
+TEST_F(RpImageScaleTest, solidColor)
+{
+	fill(m_img.get(), 0x80C04020);
+	for (int i = 0; i < 2; i++) {
+		const rp_image::ScaleFilter filter = (i == 0)
+			? rp_image::ScaleFilter::Box : rp_image::ScaleFilter::Bilinear;
+		unique_rp_image img(m_img->scaled_cpp(100, 77, filter));
+		ASSERT_TRUE((bool)img);
+		for (int y = 0; y < img->height(); y++) {
+			const uint32_t *px = static_cast<const uint32_t*>(img->scanLine(y));
+			for (int x = 0; x < img->width(); x++) {
+				ASSERT_EQ(0x80C04020U, px[x]) << "at (" << x << ',' << y << ')';
+			}
+		}
+	}
+}
+
+/**
+ * Fully-transparent pixels must not affect the color.
+ * (Filtering is done with premultiplied alpha.)
+ */
+TEST_F(RpImageScaleTest, premultipliedAlpha)
+{
+	unique_rp_image src(new rp_image(2, 2, rp_image::Format::ARGB32));
+	uint32_t *px = static_cast<uint32_t*>(src->scanLine(0));
+	px[0] = 0xFFFF0000;	// opaque red
+	px[1] = 0x0000FF00;	// transparent green
+	px = static_cast<uint32_t*>(src->scanLine(1));
+	px[0] = 0xFFFF0000;	// opaque red
+	px[1] = 0x0000FF00;	// transparent green
+
+	unique_rp_image img(src->scaled_cpp(1, 1, rp_image::ScaleFilter::Box));
+	ASSERT_TRUE((bool)img);
+	const uint32_t px_out = *static_cast<const uint32_t*>(img->scanLine(0));
+	EXPECT_EQ(0xFF0000U, px_out & 0xFFFFFF) << "Transparent pixels bled into the color channels.";
+	EXPECT_NEAR(128, static_cast<int>(px_out >> 24), 1);
+}
+
+/**
+ * Box filter: Each output pixel is the average of its source area.
+ */
+TEST_F(RpImageScaleTest, boxAverage)
+{
+	unique_rp_image src(new rp_image(4, 2, rp_image::Format::ARGB32));
+	static const uint32_t row[4] = {0xFF000000, 0xFFFFFFFF, 0xFF204060, 0xFF6080A0};
+	memcpy(src->scanLine(0), row, sizeof(row));
+	memcpy(src->scanLine(1), row, sizeof(row));
+
+	unique_rp_image img(src->scaled_cpp(2, 1, rp_image::ScaleFilter::Box));
+	ASSERT_TRUE((bool)img);
+	const uint32_t *px = static_cast<const uint32_t*>(img->scanLine(0));
+	EXPECT_EQ(0xFF808080U, px[0]);
+	EXPECT_EQ(0xFF406080U, px[1]);
+}
+
+/**
+ * CI8 images are converted to ARGB32.
+ */
+TEST_F(RpImageScaleTest, ci8)
+{
+	unique_rp_image src(new rp_image(16, 16, rp_image::Format::CI8));
+	uint32_t *const palette = src->palette();
+	ASSERT_TRUE(palette != nullptr);
+	palette[0] = 0xFF123456;
+	memset(src->bits(), 0, src->stride() * src->height());
+
+	unique_rp_image img(src->scaled(4, 4));
+	ASSERT_TRUE((bool)img);
+	EXPECT_EQ(rp_image::Format::ARGB32, img->format());
+	EXPECT_EQ(0xFF123456U, *static_cast<const uint32_t*>(img->scanLine(3)));
+}
+
+#ifdef RP_IMAGE_HAS_SSE2
+/**
+ * Test rp_image::scaled_sse2().
+ */
+TEST_F(RpImageScaleTest, scaled_sse2_test)
+{
+	if (!RP_CPU_HasSSE2()) {
+		fprintf(stderr, "*** SSE2 is not supported on this CPU. Skipping test.\n");
+		return;
+	}
+
+	ASSERT_NO_FATAL_FAILURE(compareToCpp(&rp_image::scaled_sse2));
+}
+#endif /* RP_IMAGE_HAS_SSE2 */
+
+#ifdef RP_IMAGE_HAS_AVX2
+/**
+ * Test rp_image::scaled_avx2().
+ */
+TEST_F(RpImageScaleTest, scaled_avx2_test)
+{
+	if (!RP_CPU_HasAVX2()) {
+		fprintf(stderr, "*** AVX2 is not supported on this CPU. Skipping test.\n");
+		return;
+	}
+
+	ASSERT_NO_FATAL_FAILURE(compareToCpp(&rp_image::scaled_avx2));
+}
+#endif /* RP_IMAGE_HAS_AVX2 */
+
+/**
+ * Benchmark rp_image::scaled_cpp().
+ */
+TEST_F(RpImageScaleTest, scaled_cpp_benchmark)
+{
+	ASSERT_NO_FATAL_FAILURE(benchmark(&rp_image::scaled_cpp));
+}
+
+#ifdef RP_IMAGE_HAS_SSE2
+/**
+ * Benchmark rp_image::scaled_sse2().
+ */
+TEST_F(RpImageScaleTest, scaled_sse2_benchmark)
+{
+	if (!RP_CPU_HasSSE2()) {
+		fprintf(stderr, "*** SSE2 is not supported on this CPU. Skipping test.\n");
+		return;
+	}
+
+	ASSERT_NO_FATAL_FAILURE(benchmark(&rp_image::scaled_sse2));
+}
+#endif /* RP_IMAGE_HAS_SSE2 */
+
+#ifdef RP_IMAGE_HAS_AVX2
+/**
+ * Benchmark rp_image::scaled_avx2().
+ */
+TEST_F(RpImageScaleTest, scaled_avx2_benchmark)
+{
+	if (!RP_CPU_HasAVX2()) {
+		fprintf(stderr, "*** AVX2 is not supported on this CPU. Skipping test.\n");
+		return;
+	}
+
+	ASSERT_NO_FATAL_FAILURE(benchmark(&rp_image::scaled_avx2));
+}
+#endif /* RP_IMAGE_HAS_AVX2 */
+
+} }
+
+/**
+ * Test suite main function.
+ * Called by gtest_init.cpp.
+ */
+extern "C" int gtest_main(int argc, TCHAR *argv[])
+{
+	fprintf(stderr, "LibRpTexture test suite: rp_image::scaled() tests.\n\n");
+	fprintf(stderr, "Benchmark iterations: %u\n",
+		LibRpTexture::Tests::RpImageScaleTest::BENCHMARK_ITERATIONS);
+	fflush(nullptr);
+
+	// coverity[fun_call_w_exception]: uncaught exceptions cause nonzero exit anyway, so don't warn.
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
@@ -22,11 +22,23 @@
 #include <cstring>
 
 // C++ includes.
+#include <memory>
 #include <string>
 using std::string;
+using std::unique_ptr;
 
 namespace LibRpTexture { namespace Tests {
 
+struct RpImageUnrefDeleter {
+	void operator()(rp_image *img) {
+		UNREF(img);
+	}
+};
+typedef unique_ptr<rp_image, RpImageUnrefDeleter> unique_rp_image;
+
+// rp_image::premultiply() / rp_image::un_premultiply() function.
+typedef int (rp_image::*premultiply_fn)(void);
+
 class UnPremultiplyTest : public ::testing::Test
 {
 	protected:
@@ -50,10 +62,179 @@ class UnPremultiplyTest : public ::testing::Test
 
 		// Image.
 		rp_image *m_img;
+
+	public:
+		/**
+		 * Create an image with pseudo-random pixels.
+		 * The width is not a multiple of 8 in order to test
+		 * the remaining pixels in the optimized versions.
+		 * @return ARGB32 image.
+		 */
+		static rp_image *createRandomImage(void);
+
+		/**
+		 * Verify that an optimized function matches the standard version.
+		 * @param src		[in] Source image.
+		 * @param fn_cpp	[in] Standard version.
+		 * @param fn		[in] Optimized version.
+		 */
+		static void compareToCpp(const rp_image *src, premultiply_fn fn_cpp, premultiply_fn fn);
 };
 
-// TODO: Add actual tests to verify that un-premultiply works.
-// Currently we only have benchmark tests.
+/**
+ * Create an image with pseudo-random pixels.
+ * The width is not a multiple of 8 in order to test
+ * the remaining pixels in the optimized versions.
+ * @return ARGB32 image.
+ */
+rp_image *UnPremultiplyTest::createRandomImage(void)
+{
+	rp_image *const img = new rp_image(509, 127, rp_image::Format::ARGB32);
+	uint32_t seed = 0x12345678;
+	for (int y = 0; y < img->height(); y++) {
+		uint32_t *px = static_cast<uint32_t*>(img->scanLine(y));
+		for (int x = img->width(); x > 0; x--, px++) {
+			seed = seed * 1103515245 + 12345;
+			uint32_t argb = seed ^ (seed >> 16);
+			switch (argb & 7) {
+				case 0:	argb &= 0x00FFFFFF; break;
+				case 1:	argb |= 0xFF000000; break;
+				default: break;
+			}
+			*px = argb;
+		}
+	}
+	return img;
+}
+
+/**
+ * Verify that an optimized function matches the standard version.
+ * @param src		[in] Source image.
+ * @param fn_cpp	[in] Standard version.
+ * @param fn		[in] Optimized version.
+ */
+void UnPremultiplyTest::compareToCpp(const rp_image *src, premultiply_fn fn_cpp, premultiply_fn fn)
+{
+	unique_rp_image expected(src->dup());
+	unique_rp_image actual(src->dup());
+	ASSERT_EQ(0, ((*expected).*fn_cpp)());
+	ASSERT_EQ(0, ((*actual).*fn)());
+
+	for (int y = 0; y < src->height(); y++) {
+		ASSERT_EQ(0, memcmp(expected->scanLine(y), actual->scanLine(y), src->row_bytes())) <<
+			"Images differ at row " << y;
+	}
+}
+
+/**
+ * Premultiplying an opaque pixel or a fully-transparent pixel
+ * must not change it.
+ */
+TEST_F(UnPremultiplyTest, premultiply_pixel_test)
+{
+	EXPECT_EQ(0xFF123456U, rp_image::premultiply_pixel(0xFF123456));
+	EXPECT_EQ(0x00123456U, rp_image::premultiply_pixel(0x00123456));
+	EXPECT_EQ(0x80800000U, rp_image::premultiply_pixel(0x80FF0000));
+}
+
+/**
+ * Un-premultiplying a premultiplied image must restore
+ * the original image for opaque pixels.
+ */
+TEST_F(UnPremultiplyTest, round_trip_test)
+{
+	unique_rp_image src(createRandomImage());
+	unique_rp_image img(src->dup());
+	ASSERT_EQ(0, img->premultiply());
+	ASSERT_EQ(0, img->un_premultiply());
+
+	for (int y = 0; y < src->height(); y++) {
+		const uint32_t *px_src = static_cast<const uint32_t*>(src->scanLine(y));
+		const uint32_t *px_img = static_cast<const uint32_t*>(img->scanLine(y));
+		for (int x = 0; x < src->width(); x++) {
+			if ((px_src[x] >> 24) == 0xFF) {
+				ASSERT_EQ(px_src[x], px_img[x]) << "at (" << x << ',' << y << ')';
+			}
+		}
+	}
+}
+
+#ifdef RP_IMAGE_HAS_SSSE3
+/**
+ * Test rp_image::premultiply_ssse3().
+ */
+TEST_F(UnPremultiplyTest, premultiply_ssse3_test)
+{
+	if (!RP_CPU_HasSSSE3()) {
+		fprintf(stderr, "*** SSSE3 is not supported on this CPU. Skipping test.\n");
+		return;
+	}
+
+	unique_rp_image src(createRandomImage());
+	ASSERT_NO_FATAL_FAILURE(compareToCpp(src.get(),
+		&rp_image::premultiply_cpp, &rp_image::premultiply_ssse3));
+}
+#endif /* RP_IMAGE_HAS_SSSE3 */
+
+#ifdef RP_IMAGE_HAS_SSE41
+/**
+ * Test rp_image::un_premultiply_sse41().
+ * NOTE: The SSE4.1 version clamps invalid pixels (color > alpha)
+ * differently, so only premultiplied pixels are tested.
+ */
+TEST_F(UnPremultiplyTest, un_premultiply_sse41_test)
+{
+	if (!RP_CPU_HasSSE41()) {
+		fprintf(stderr, "*** SSE4.1 is not supported on this CPU. Skipping test.\n");
+		return;
+	}
+
+	unique_rp_image src(createRandomImage());
+	src->premultiply_cpp();
+	ASSERT_NO_FATAL_FAILURE(compareToCpp(src.get(),
+		&rp_image::un_premultiply_cpp, &rp_image::un_premultiply_sse41));
+}
+#endif /* RP_IMAGE_HAS_SSE41 */
+
+#ifdef RP_IMAGE_HAS_AVX2
+/**
+ * Test rp_image::premultiply_avx2().
+ */
+TEST_F(UnPremultiplyTest, premultiply_avx2_test)
+{
+	if (!RP_CPU_HasAVX2()) {
+		fprintf(stderr, "*** AVX2 is not supported on this CPU. Skipping test.\n");
+		return;
+	}
+
+	unique_rp_image src(createRandomImage());
+	ASSERT_NO_FATAL_FAILURE(compareToCpp(src.get(),
+		&rp_image::premultiply_cpp, &rp_image::premultiply_avx2));
+}
+
+/**
+ * Test rp_image::un_premultiply_avx2().
+ */
+TEST_F(UnPremultiplyTest, un_premultiply_avx2_test)
+{
+	if (!RP_CPU_HasAVX2()) {
+		fprintf(stderr, "*** AVX2 is not supported on this CPU. Skipping test.\n");
+		return;
+	}
+
+	// Premultiplied pixels.
+	unique_rp_image src(createRandomImage());
+	src->premultiply_cpp();
+	ASSERT_NO_FATAL_FAILURE(compareToCpp(src.get(),
+		&rp_image::un_premultiply_cpp, &rp_image::un_premultiply_avx2));
+
+	// Invalid pixels. (color > alpha)
+	// The AVX2 version should match the standard version here, too.
+	src.reset(createRandomImage());
+	ASSERT_NO_FATAL_FAILURE(compareToCpp(src.get(),
+		&rp_image::un_premultiply_cpp, &rp_image::un_premultiply_avx2));
+}
+#endif /* RP_IMAGE_HAS_AVX2 */
 
 /**
  * Benchmark the ImageDecoder::un_premultiply() function. (Standard version)
@@ -82,8 +263,25 @@ TEST_F(UnPremultiplyTest, un_premultiply_sse41_benchmark)
 }
 #endif /* RP_IMAGE_HAS_SSE41 */
 
+#ifdef RP_IMAGE_HAS_AVX2
+/**
+ * Benchmark the ImageDecoder::un_premultiply() function. (AVX2-optimized version)
+ */
+TEST_F(UnPremultiplyTest, un_premultiply_avx2_benchmark)
+{
+	if (!RP_CPU_HasAVX2()) {
+		fprintf(stderr, "*** AVX2 is not supported on this CPU. Skipping test.\n");
+		return;
+	}
+
+	for (unsigned int i = BENCHMARK_ITERATIONS; i > 0; i--) {
+		m_img->un_premultiply_avx2();
+	}
+}
+#endif /* RP_IMAGE_HAS_AVX2 */
+
 // NOTE: Add more instruction sets to the #ifdef if other optimizations are added.
-#if defined(RP_IMAGE_HAS_SSE41)
+#if defined(RP_IMAGE_HAS_SSE41) || defined(RP_IMAGE_HAS_AVX2)
 /**
  * Benchmark the ImageDecoder::un_premultiply() dispatch function.
  */
@@ -93,7 +291,7 @@ TEST_F(UnPremultiplyTest, un_premultiply_dispatch_benchmark)
 		m_img->un_premultiply();
 	}
 }
-#endif /* RP_IMAGE_HAS_SSE41 */
+#endif /* defined(RP_IMAGE_HAS_SSE41) || defined(RP_IMAGE_HAS_AVX2) */
 
 /**
  * Benchmark the ImageDecoder::premultiply() function. (Standard version)
@@ -101,9 +299,43 @@ TEST_F(UnPremultiplyTest, un_premultiply_dispatch_benchmark)
 TEST_F(UnPremultiplyTest, premultiply_cpp)
 {
 	for (unsigned int i = BENCHMARK_ITERATIONS; i > 0; i--) {
-		m_img->premultiply();
+		m_img->premultiply_cpp();
+	}
+}
+
+#ifdef RP_IMAGE_HAS_SSSE3
+/**
+ * Benchmark the ImageDecoder::premultiply() function. (SSSE3-optimized version)
+ */
+TEST_F(UnPremultiplyTest, premultiply_ssse3_benchmark)
+{
+	if (!RP_CPU_HasSSSE3()) {
+		fprintf(stderr, "*** SSSE3 is not supported on this CPU. Skipping test.\n");
+		return;
+	}
+
+	for (unsigned int i = BENCHMARK_ITERATIONS; i > 0; i--) {
+		m_img->premultiply_ssse3();
+	}
+}
+#endif /* RP_IMAGE_HAS_SSSE3 */
+
+#ifdef RP_IMAGE_HAS_AVX2
+/**
+ * Benchmark the ImageDecoder::premultiply() function. (AVX2-optimized version)
+ */
+TEST_F(UnPremultiplyTest, premultiply_avx2_benchmark)
+{
+	if (!RP_CPU_HasAVX2()) {
+		fprintf(stderr, "*** AVX2 is not supported on this CPU. Skipping test.\n");
+		return;
+	}
+
+	for (unsigned int i = BENCHMARK_ITERATIONS; i > 0; i--) {
+		m_img->premultiply_avx2();
 	}
 }
+#endif /* RP_IMAGE_HAS_AVX2 */
 
 } }
 
@@ -0,0 +1,199 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (rp-download)                      *
+ * CacheFileETag.cpp: Store ETags for cache files.                         *
+ *                                                                         *
+ * Copyright (c) 2016-2022 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "stdafx.h"
+#include "config.rp-download.h"
+#include "CacheFileETag.hpp"
+
+// C++ STL classes.
+using std::string;
+using std::tstring;
+
+#ifdef _WIN32
+// libwin32common
+# include "libwin32common/w32err.h"
+#else /* !_WIN32 */
+// xattrs
+# if defined(HAVE_FSETXATTR_LINUX)
+#  include <sys/xattr.h>
+# elif defined(HAVE_EXTATTR_SET_FD)
+#  include <sys/extattr.h>
+# elif defined(HAVE_FSETXATTR_MAC)
+#  include <sys/xattr.h>
+# endif /* HAVE_FSETXATTR_LINUX */
+# ifndef ENOATTR
+// Linux uses ENODATA for missing xattrs.
+#  define ENOATTR ENODATA
+# endif /* !ENOATTR */
+#endif /* _WIN32 */
+
+namespace RpDownload {
+
+// Maximum ETag length.
+// ETags are usually much shorter than this.
+#define ETAG_MAX_LENGTH 256
+
+#ifdef _WIN32
+// ADS name
+static const TCHAR etag_ads_name[] = _T(":rom-properties.etag");
+#else /* !_WIN32 */
+// xattr name
+# ifdef HAVE_EXTATTR_SET_FD
+// NOTE: FreeBSD uses a separate namespace parameter.
+static const char etag_xattr_name[] = "rom-properties.etag";
+# else /* !HAVE_EXTATTR_SET_FD */
+static const char etag_xattr_name[] = "user.rom-properties.etag";
+# endif /* HAVE_EXTATTR_SET_FD */
+#endif /* _WIN32 */
+
+/**
+ * Get the ETag that was stored for a cache file.
+ * This uses xattrs on Linux and ADS on Windows.
+ * @param filename	[in] Cache filename
+ * @param etag		[out] ETag
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int getCacheFileETag(const TCHAR *filename, string &etag)
+{
+	char buf[ETAG_MAX_LENGTH];
+	ptrdiff_t len;
+
+#if defined(_WIN32)
+	tstring tfilename = filename;
+	tfilename += etag_ads_name;
+	FILE *f_ads = _tfopen(tfilename.c_str(), _T("rb"));
+	if (!f_ads) {
+		const int err = errno;
+		return (err != 0 ? -err : -EIO);
+	}
+	len = static_cast<ptrdiff_t>(fread(buf, 1, sizeof(buf), f_ads));
+	fclose(f_ads);
+#elif defined(HAVE_FSETXATTR_LINUX)
+	len = getxattr(filename, etag_xattr_name, buf, sizeof(buf));
+#elif defined(HAVE_EXTATTR_SET_FD)
+	len = extattr_get_file(filename, EXTATTR_NAMESPACE_USER, etag_xattr_name, buf, sizeof(buf));
+#elif defined(HAVE_FSETXATTR_MAC)
+	len = getxattr(filename, etag_xattr_name, buf, sizeof(buf), 0, 0);
+#else
+	RP_UNUSED(filename);
+	RP_UNUSED(etag);
+	RP_UNUSED(buf);
+	return -ENOTSUP;
+#endif
+
+	if (len < 0) {
+		const int err = errno;
+		return (err != 0 ? -err : -EIO);
+	} else if (len == 0) {
+		// No ETag.
+		return -ENOENT;
+	}
+
+	etag.assign(buf, len);
+	return 0;
+}
+
+#ifndef _WIN32
+/**
+ * Store the ETag for a cache file.
+ * This uses xattrs on Linux and ADS on Windows.
+ * @param file Open file. (Must be writable.)
+ * @param etag ETag. If empty, a previously-stored ETag will be removed.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int setCacheFileETag(FILE *file, const string &etag)
+{
+	if (etag.size() > ETAG_MAX_LENGTH) {
+		// ETag is too long. Don't bother storing it.
+		return -ENAMETOOLONG;
+	}
+
+	const int fd = fileno(file);
+	int ret;
+	errno = 0;
+	if (!etag.empty()) {
+#if defined(HAVE_FSETXATTR_LINUX)
+		ret = fsetxattr(fd, etag_xattr_name, etag.data(), etag.size(), 0);
+#elif defined(HAVE_EXTATTR_SET_FD)
+		ret = (extattr_set_fd(fd, EXTATTR_NAMESPACE_USER, etag_xattr_name,
+			etag.data(), etag.size()) == static_cast<ssize_t>(etag.size()) ? 0 : -1);
+#elif defined(HAVE_FSETXATTR_MAC)
+		ret = fsetxattr(fd, etag_xattr_name, etag.data(), etag.size(), 0, 0);
+#else
+		RP_UNUSED(fd);
+		return -ENOTSUP;
+#endif
+	} else {
+		// Remove the ETag from the previous download, if present.
+#if defined(HAVE_FSETXATTR_LINUX)
+		ret = fremovexattr(fd, etag_xattr_name);
+#elif defined(HAVE_EXTATTR_SET_FD)
+		ret = extattr_delete_fd(fd, EXTATTR_NAMESPACE_USER, etag_xattr_name);
+#elif defined(HAVE_FSETXATTR_MAC)
+		ret = fremovexattr(fd, etag_xattr_name, 0);
+#else
+		RP_UNUSED(fd);
+		return -ENOTSUP;
+#endif
+		if (ret != 0 && errno == ENOATTR) {
+			// ETag wasn't present.
+			return 0;
+		}
+	}
+
+	if (ret != 0) {
+		const int err = errno;
+		return (err != 0 ? -err : -EIO);
+	}
+	return 0;
+}
+#endif /* !_WIN32 */
+
+#ifdef _WIN32
+/**
+ * Store the ETag for a cache file.
+ * This uses xattrs on Linux and ADS on Windows.
+ * @param file Open file. (Must be writable.)
+ * @param filename Filename. [FIXME: Make it so we don't need this on Windows.]
+ * @param etag ETag. If empty, a previously-stored ETag will be removed.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int setCacheFileETag(FILE *file, const TCHAR *filename, const string &etag)
+{
+	RP_UNUSED(file);
+	if (etag.size() > ETAG_MAX_LENGTH) {
+		// ETag is too long. Don't bother storing it.
+		return -ENAMETOOLONG;
+	}
+
+	tstring tfilename = filename;
+	tfilename += etag_ads_name;
+	if (etag.empty()) {
+		// Remove the ETag from the previous download, if present.
+		if (!DeleteFile(tfilename.c_str())) {
+			const DWORD dwError = GetLastError();
+			if (dwError != ERROR_FILE_NOT_FOUND) {
+				const int err = w32err_to_posix(dwError);
+				return (err != 0 ? -err : -EIO);
+			}
+		}
+		return 0;
+	}
+
+	FILE *f_ads = _tfopen(tfilename.c_str(), _T("wb"));
+	if (!f_ads) {
+		const int err = errno;
+		return (err != 0 ? -err : -EIO);
+	}
+	const size_t size = fwrite(etag.data(), 1, etag.size(), f_ads);
+	fclose(f_ads);
+	return (size == etag.size() ? 0 : -EIO);
+}
+#endif /* _WIN32 */
+
+}
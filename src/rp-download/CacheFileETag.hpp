@@ -0,0 +1,58 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (rp-download)                      *
+ * CacheFileETag.hpp: Store ETags for cache files.                         *
+ *                                                                         *
+ * Copyright (c) 2016-2022 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#ifndef __ROMPROPERTIES_RP_DOWNLOAD_CACHEFILEETAG_HPP__
+#define __ROMPROPERTIES_RP_DOWNLOAD_CACHEFILEETAG_HPP__
+
+// C includes. (C++ namespace)
+#include <cerrno>
+#include <cstdio>
+
+// C++ includes.
+#include <string>
+
+// tcharx
+#include "tcharx.h"
+
+namespace RpDownload {
+
+/**
+ * Get the ETag that was stored for a cache file.
+ * This uses xattrs on Linux and ADS on Windows.
+ * @param filename	[in] Cache filename
+ * @param etag		[out] ETag
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int getCacheFileETag(const TCHAR *filename, std::string &etag);
+
+#ifndef _WIN32
+/**
+ * Store the ETag for a cache file.
+ * This uses xattrs on Linux and ADS on Windows.
+ * @param file Open file. (Must be writable.)
+ * @param etag ETag. If empty, a previously-stored ETag will be removed.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int setCacheFileETag(FILE *file, const std::string &etag);
+#endif /* !_WIN32 */
+
+#ifdef _WIN32
+/**
+ * Store the ETag for a cache file.
+ * This uses xattrs on Linux and ADS on Windows.
+ * @param file Open file. (Must be writable.)
+ * @param filename Filename. [FIXME: Make it so we don't need this on Windows.]
+ * @param etag ETag. If empty, a previously-stored ETag will be removed.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int setCacheFileETag(FILE *file, const TCHAR *filename, const std::string &etag);
+#endif /* _WIN32 */
+
+}
+
+#endif /* __ROMPROPERTIES_RP_DOWNLOAD_CACHEFILEETAG_HPP__ */
@@ -19,16 +19,24 @@ namespace RpDownload {
 
 CurlDownloader::CurlDownloader()
 	: super()
+	, m_headers(nullptr)
 { }
 
 CurlDownloader::CurlDownloader(const TCHAR *url)
 	: super(url)
+	, m_headers(nullptr)
 { }
 
 CurlDownloader::CurlDownloader(const tstring &url)
 	: super(url)
+	, m_headers(nullptr)
 { }
 
+CurlDownloader::~CurlDownloader()
+{
+	curl_slist_free_all(static_cast<struct curl_slist*>(m_headers));
+}
+
 /**
  * Internal cURL data write function.
  * @param ptr Data to write.
@@ -90,6 +98,7 @@ size_t CurlDownloader::parse_header(char *ptr, size_t size, size_t nitems, void
 	// Supported headers.
 	static const char http_content_length[] = "Content-Length: ";
 	static const char http_last_modified[] = "Last-Modified: ";
+	static const char http_etag[] = "ETag: ";
 
 	if (len >= sizeof(http_content_length) &&
 	    !strncasecmp(ptr, http_content_length, sizeof(http_content_length)-1))
@@ -145,16 +154,30 @@ size_t CurlDownloader::parse_header(char *ptr, size_t size, size_t nitems, void
 		// Parse the modification time.
 		curlDL->m_mtime = curl_getdate(mtime_str, nullptr);
 	}
+	else if (len >= sizeof(http_etag) &&
+	         !strncasecmp(ptr, http_etag, sizeof(http_etag)-1))
+	{
+		// Found the ETag.
+		// Should be a quoted string, optionally with a "W/" prefix.
+		// Remove trailing whitespace, including CRLF.
+		const char *const val = ptr+sizeof(http_etag)-1;
+		size_t val_len = len-(sizeof(http_etag)-1);
+		while (val_len > 0 && ISSPACE(val[val_len-1])) {
+			val_len--;
+		}
+		curlDL->m_etag.assign(val, val_len);
+	}
 
 	// Continue processing.
 	return len;
 }
 
 /**
- * Download the file.
- * @return 0 on success; negative POSIX error code, positive HTTP status code on error.
+ * Create a cURL easy handle for this download.
+ * The previous download will be cleared.
+ * @return cURL easy handle (CURL*), or nullptr on error.
  */
-int CurlDownloader::download(void)
+void *CurlDownloader::createEasyHandle(void)
 {
 	// References:
 	// - http://stackoverflow.com/questions/1636333/download-file-using-libcurl-in-c-c
@@ -164,12 +187,15 @@ int CurlDownloader::download(void)
 	// Clear the previous download.
 	m_data.clear();
 	m_mtime = -1;
+	m_etag.clear();
+	curl_slist_free_all(static_cast<struct curl_slist*>(m_headers));
+	m_headers = nullptr;
 
 	// Initialize cURL.
 	CURL *curl = curl_easy_init();
 	if (!curl) {
 		// Could not initialize cURL.
-		return -ENOMEM;	// TODO: Better error?
+		return nullptr;
 	}
 
 	// Proxy settings should be set by the calling application
@@ -185,6 +211,12 @@ int CurlDownloader::download(void)
 	// Redirection is required for https://amiibo.life/nfc/%08X-%08X
 	// TODO: Limit the number of redirects?
 	curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, true);
+#if LIBCURL_VERSION_NUM >= 0x072F00
+	// Use HTTP/2 for HTTPS if the server supports it. (cURL 7.47.0)
+	// This allows multiple downloads to share a single connection
+	// when using CurlMultiDownloader.
+	curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, (long)CURL_HTTP_VERSION_2TLS);
+#endif /* LIBCURL_VERSION_NUM >= 0x072F00 */
 
 	// Header and data functions.
 	curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, parse_header);
@@ -206,9 +238,52 @@ int CurlDownloader::download(void)
 	// Set the User-Agent.
 	curl_easy_setopt(curl, CURLOPT_USERAGENT, m_userAgent.c_str());
 
-	// Download the file.
-	CURLcode res = curl_easy_perform(curl);
-	curl_easy_cleanup(curl);
+	// Conditional request validators.
+	// NOTE: Not using CURLOPT_TIMECONDITION, since cURL discards
+	// the response if Last-Modified is older than the specified
+	// time, even if If-None-Match indicates it was modified.
+	struct curl_slist *headers = nullptr;
+	if (!m_ifNoneMatch.empty()) {
+		const string hdr = "If-None-Match: " + m_ifNoneMatch;
+		headers = curl_slist_append(headers, hdr.c_str());
+	}
+	if (m_ifModifiedSince >= 0) {
+		// HTTP date format: "Wed, 15 Nov 1995 04:58:08 GMT"
+		// NOTE: Not using strftime(), since %a and %b are locale-dependent.
+		static const char day_names[7][4] = {
+			"Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"
+		};
+		static const char month_names[12][4] = {
+			"Jan", "Feb", "Mar", "Apr", "May", "Jun",
+			"Jul", "Aug", "Sep", "Oct", "Nov", "Dec"
+		};
+
+		struct tm tm;
+		if (gmtime_r(&m_ifModifiedSince, &tm) != nullptr) {
+			char hdr[64];
+			snprintf(hdr, sizeof(hdr), "If-Modified-Since: %s, %02d %s %04d %02d:%02d:%02d GMT",
+				day_names[tm.tm_wday], tm.tm_mday, month_names[tm.tm_mon],
+				tm.tm_year + 1900, tm.tm_hour, tm.tm_min, tm.tm_sec);
+			headers = curl_slist_append(headers, hdr);
+		}
+	}
+	if (headers) {
+		m_headers = headers;
+		curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+	}
+
+	return curl;
+}
+
+/**
+ * Get the result of a completed transfer.
+ * This must be called before the easy handle is cleaned up.
+ * @param curl cURL easy handle (CURL*)
+ * @param res Transfer result (CURLcode)
+ * @return 0 on success; negative POSIX error code, positive HTTP status code on error.
+ */
+int CurlDownloader::transferResult(void *curl, int res)
+{
 	switch (res) {
 		case CURLE_OK:
 			// File downloaded successfully.
@@ -218,18 +293,28 @@ int CurlDownloader::download(void)
 			// Operation timed out.
 			return -ETIMEDOUT;
 
-		default:
+		default: {
 			// Some other error downloading the file.
 			// Check if we have an HTTP response code.
 			// NOTE: GameTDB sometimes returns nothing instead of 404...
 			long response_code = 0;
-			curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &response_code);
+			curl_easy_getinfo(static_cast<CURL*>(curl), CURLINFO_RESPONSE_CODE, &response_code);
 			if (response_code <= 0) {
 				// No HTTP response code.
 				// TODO: Return a cURL error code and/or message...
 				return -EIO;
 			}
 			return (int)response_code;
+		}
+	}
+
+	// Check if the file was not modified. (conditional request)
+	// NOTE: cURL doesn't consider this to be an error.
+	long response_code = 0;
+	curl_easy_getinfo(static_cast<CURL*>(curl), CURLINFO_RESPONSE_CODE, &response_code);
+	if (response_code == 304) {
+		// Not modified.
+		return 304;
 	}
 
 	// Check if we have data.
@@ -242,4 +327,26 @@ int CurlDownloader::download(void)
 	return 0;
 }
 
+/**
+ * Download the file.
+ * @return 0 on success; negative POSIX error code, positive HTTP status code on error.
+ */
+int CurlDownloader::download(void)
+{
+	CURL *const curl = static_cast<CURL*>(createEasyHandle());
+	if (!curl) {
+		// Could not initialize cURL.
+		return -ENOMEM;	// TODO: Better error?
+	}
+
+	// Download the file.
+	// NOTE: The result must be checked before calling
+	// curl_easy_cleanup(), since the response code is
+	// retrieved from the easy handle.
+	const CURLcode res = curl_easy_perform(curl);
+	const int ret = transferResult(curl, res);
+	curl_easy_cleanup(curl);
+	return ret;
+}
+
 }
@@ -13,12 +13,15 @@
 
 namespace RpDownload {
 
+class CurlMultiDownloader;
+
 class CurlDownloader final : public IDownloader
 {
 	public:
 		CurlDownloader();
 		explicit CurlDownloader(const TCHAR *url);
 		explicit CurlDownloader(const std::tstring &url);
+		~CurlDownloader() final;
 
 	private:
 		typedef IDownloader super;
@@ -45,6 +48,30 @@ class CurlDownloader final : public IDownloader
 		 */
 		static size_t parse_header(char *ptr, size_t size, size_t nitems, void *userdata);
 
+	private:
+		friend class CurlMultiDownloader;
+
+		/**
+		 * Create a cURL easy handle for this download.
+		 * The previous download will be cleared.
+		 * @return cURL easy handle (CURL*), or nullptr on error.
+		 */
+		void *createEasyHandle(void);
+
+		/**
+		 * Get the result of a completed transfer.
+		 * This must be called before the easy handle is cleaned up.
+		 * @param curl cURL easy handle (CURL*)
+		 * @param res Transfer result (CURLcode)
+		 * @return 0 on success; negative POSIX error code, positive HTTP status code on error.
+		 */
+		int transferResult(void *curl, int res);
+
+	private:
+		// Additional request headers. (struct curl_slist*)
+		// Must remain valid until the transfer is finished.
+		void *m_headers;
+
 	public:
 		/**
 		 * Download the file.
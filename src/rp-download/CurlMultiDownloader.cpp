@@ -0,0 +1,235 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (rp-download)                      *
+ * CurlMultiDownloader.cpp: libcurl-based concurrent file downloader.      *
+ *                                                                         *
+ * Copyright (c) 2016-2022 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "stdafx.h"
+#include "CurlMultiDownloader.hpp"
+
+// C++ STL classes.
+#include <algorithm>
+using std::pair;
+
+// cURL for network access.
+#include <curl/curl.h>
+
+namespace RpDownload {
+
+CurlMultiDownloader::CurlMultiDownloader()
+	: m_multi(curl_multi_init())
+{
+	CURLM *const multi = static_cast<CURLM*>(m_multi);
+	if (!multi) {
+		// Could not initialize cURL.
+		return;
+	}
+
+#if LIBCURL_VERSION_NUM >= 0x072B00
+	// Allow HTTP/2 multiplexing. (cURL 7.43.0)
+	// HTTP/1.1 connections are reused after each transfer
+	// finishes regardless of this setting.
+	curl_multi_setopt(multi, CURLMOPT_PIPELINING, (long)CURLPIPE_MULTIPLEX);
+#endif /* LIBCURL_VERSION_NUM >= 0x072B00 */
+}
+
+CurlMultiDownloader::~CurlMultiDownloader()
+{
+	CURLM *const multi = static_cast<CURLM*>(m_multi);
+	if (!multi) {
+		return;
+	}
+
+	// Abort any active transfers.
+	for (void *easy : m_easy) {
+		curl_multi_remove_handle(multi, static_cast<CURL*>(easy));
+		curl_easy_cleanup(static_cast<CURL*>(easy));
+	}
+	curl_multi_cleanup(multi);
+}
+
+/**
+ * Set the maximum number of connections per host.
+ * Additional transfers will wait for an existing connection.
+ * @param maxConns Maximum number of connections per host. (0 == unlimited)
+ */
+void CurlMultiDownloader::setMaxHostConnections(unsigned int maxConns)
+{
+	CURLM *const multi = static_cast<CURLM*>(m_multi);
+	if (!multi) {
+		return;
+	}
+
+#if LIBCURL_VERSION_NUM >= 0x071E00
+	// cURL 7.30.0
+	curl_multi_setopt(multi, CURLMOPT_MAX_HOST_CONNECTIONS, (long)maxConns);
+#else /* LIBCURL_VERSION_NUM < 0x071E00 */
+	RP_UNUSED(maxConns);
+#endif /* LIBCURL_VERSION_NUM >= 0x071E00 */
+}
+
+/**
+ * Start a transfer.
+ * The CurlDownloader must remain valid until it's
+ * returned by takeFinished().
+ * @param downloader CurlDownloader with the URL set.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int CurlMultiDownloader::add(CurlDownloader *downloader)
+{
+	assert(downloader != nullptr);
+	CURLM *const multi = static_cast<CURLM*>(m_multi);
+	if (!multi) {
+		return -EBADF;
+	} else if (!downloader) {
+		return -EINVAL;
+	}
+
+	CURL *const curl = static_cast<CURL*>(downloader->createEasyHandle());
+	if (!curl) {
+		// Could not initialize cURL.
+		return -ENOMEM;	// TODO: Better error?
+	}
+	curl_easy_setopt(curl, CURLOPT_PRIVATE, downloader);
+#if LIBCURL_VERSION_NUM >= 0x072B00
+	// Wait for an existing connection that can multiplex
+	// instead of opening a new connection. (cURL 7.43.0)
+	// NOTE: Only for HTTPS, since HTTP/2 is negotiated using ALPN.
+	// For plain HTTP, this would wait for the previous response
+	// before opening another connection.
+	if (downloader->url().compare(0, 8, _T("https://")) == 0) {
+		curl_easy_setopt(curl, CURLOPT_PIPEWAIT, 1L);
+	}
+#endif /* LIBCURL_VERSION_NUM >= 0x072B00 */
+
+	if (curl_multi_add_handle(multi, curl) != CURLM_OK) {
+		curl_easy_cleanup(curl);
+		return -EIO;
+	}
+	m_easy.push_back(curl);
+	return 0;
+}
+
+/**
+ * Abort an active transfer.
+ * The transfer will not be returned by takeFinished().
+ * @param downloader CurlDownloader
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int CurlMultiDownloader::remove(CurlDownloader *downloader)
+{
+	CURLM *const multi = static_cast<CURLM*>(m_multi);
+	if (!multi) {
+		return -EBADF;
+	}
+
+	// Check for a finished transfer that hasn't been retrieved yet.
+	for (auto iter = m_finished.begin(); iter != m_finished.end(); ++iter) {
+		if (iter->first == downloader) {
+			m_finished.erase(iter);
+			return 0;
+		}
+	}
+
+	for (auto iter = m_easy.begin(); iter != m_easy.end(); ++iter) {
+		CURL *const curl = static_cast<CURL*>(*iter);
+		char *priv = nullptr;
+		curl_easy_getinfo(curl, CURLINFO_PRIVATE, &priv);
+		if (reinterpret_cast<CurlDownloader*>(priv) != downloader)
+			continue;
+
+		curl_multi_remove_handle(multi, curl);
+		curl_easy_cleanup(curl);
+		m_easy.erase(iter);
+		return 0;
+	}
+
+	// Transfer not found.
+	return -ENOENT;
+}
+
+/**
+ * Process transfers, waiting up to timeout_ms for activity.
+ * @param extra_fd	[in,opt] Additional file descriptor to wait for input on, or -1 for none.
+ * @param timeout_ms	[in] Maximum time to wait, in milliseconds.
+ * @param pExtraReady	[out,opt] Set to true if extra_fd has input available.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int CurlMultiDownloader::perform(int extra_fd, int timeout_ms, bool *pExtraReady)
+{
+	CURLM *const multi = static_cast<CURLM*>(m_multi);
+	if (!multi) {
+		return -EBADF;
+	}
+
+	// Wait for activity on the transfers and/or extra_fd.
+	struct curl_waitfd extra_wfd;
+	extra_wfd.fd = extra_fd;
+	extra_wfd.events = CURL_WAIT_POLLIN;
+	extra_wfd.revents = 0;
+	const unsigned int extra_nfds = (extra_fd >= 0 ? 1 : 0);
+	CURLMcode mret = curl_multi_wait(multi, &extra_wfd, extra_nfds, timeout_ms, nullptr);
+	if (mret != CURLM_OK) {
+		return -EIO;
+	}
+	if (pExtraReady) {
+		*pExtraReady = (extra_nfds > 0 && extra_wfd.revents != 0);
+	}
+
+	// Run the transfers.
+	int running = 0;
+	mret = curl_multi_perform(multi, &running);
+	if (mret != CURLM_OK) {
+		return -EIO;
+	}
+
+	// Check for finished transfers.
+	int msgs_left = 0;
+	CURLMsg *msg;
+	while ((msg = curl_multi_info_read(multi, &msgs_left)) != nullptr) {
+		if (msg->msg != CURLMSG_DONE)
+			continue;
+
+		CURL *const curl = msg->easy_handle;
+		char *priv = nullptr;
+		curl_easy_getinfo(curl, CURLINFO_PRIVATE, &priv);
+		CurlDownloader *const downloader = reinterpret_cast<CurlDownloader*>(priv);
+		assert(downloader != nullptr);
+
+		// NOTE: The result must be retrieved before the easy handle is cleaned up.
+		const int ret = downloader->transferResult(curl, msg->data.result);
+		curl_multi_remove_handle(multi, curl);
+		curl_easy_cleanup(curl);
+
+		auto iter = std::find(m_easy.begin(), m_easy.end(), static_cast<void*>(curl));
+		assert(iter != m_easy.end());
+		if (iter != m_easy.end()) {
+			m_easy.erase(iter);
+		}
+		m_finished.emplace_back(downloader, ret);
+	}
+
+	return 0;
+}
+
+/**
+ * Retrieve a finished transfer.
+ * @param pRet [out] Transfer result: 0 on success; negative POSIX error code, positive HTTP status code on error.
+ * @return CurlDownloader, or nullptr if no transfers have finished.
+ */
+CurlDownloader *CurlMultiDownloader::takeFinished(int *pRet)
+{
+	assert(pRet != nullptr);
+	if (m_finished.empty()) {
+		return nullptr;
+	}
+
+	const pair<CurlDownloader*, int> finished = m_finished.front();
+	m_finished.pop_front();
+	*pRet = finished.second;
+	return finished.first;
+}
+
+}
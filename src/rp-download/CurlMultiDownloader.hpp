@@ -0,0 +1,109 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (rp-download)                      *
+ * CurlMultiDownloader.hpp: libcurl-based concurrent file downloader.      *
+ *                                                                         *
+ * Copyright (c) 2016-2022 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#ifndef __ROMPROPERTIES_RP_DOWNLOAD_CURLMULTIDOWNLOADER_HPP__
+#define __ROMPROPERTIES_RP_DOWNLOAD_CURLMULTIDOWNLOADER_HPP__
+
+#include "CurlDownloader.hpp"
+
+// C++ includes.
+#include <deque>
+#include <utility>
+#include <vector>
+
+namespace RpDownload {
+
+/**
+ * Runs multiple CurlDownloader transfers concurrently
+ * using cURL's "multi" interface.
+ *
+ * Connections are cached by the multi handle, so consecutive
+ * downloads from the same server reuse the same connection.
+ * (HTTP/1.1 keep-alive or HTTP/2 multiplexing)
+ */
+class CurlMultiDownloader
+{
+	public:
+		CurlMultiDownloader();
+		~CurlMultiDownloader();
+
+	private:
+		RP_DISABLE_COPY(CurlMultiDownloader)
+
+	public:
+		/**
+		 * Was the cURL multi handle initialized successfully?
+		 * @return True if initialized; false if not.
+		 */
+		bool isInit(void) const
+		{
+			return (m_multi != nullptr);
+		}
+
+		/**
+		 * Set the maximum number of connections per host.
+		 * Additional transfers will wait for an existing connection.
+		 * @param maxConns Maximum number of connections per host. (0 == unlimited)
+		 */
+		void setMaxHostConnections(unsigned int maxConns);
+
+		/**
+		 * Get the number of active transfers.
+		 * This does not include finished transfers that
+		 * haven't been retrieved with takeFinished().
+		 * @return Number of active transfers.
+		 */
+		unsigned int activeCount(void) const
+		{
+			return static_cast<unsigned int>(m_easy.size());
+		}
+
+		/**
+		 * Start a transfer.
+		 * The CurlDownloader must remain valid until it's
+		 * returned by takeFinished().
+		 * @param downloader CurlDownloader with the URL set.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		int add(CurlDownloader *downloader);
+
+		/**
+		 * Abort an active transfer.
+		 * The transfer will not be returned by takeFinished().
+		 * @param downloader CurlDownloader
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		int remove(CurlDownloader *downloader);
+
+		/**
+		 * Process transfers, waiting up to timeout_ms for activity.
+		 * @param extra_fd	[in,opt] Additional file descriptor to wait for input on, or -1 for none.
+		 * @param timeout_ms	[in] Maximum time to wait, in milliseconds.
+		 * @param pExtraReady	[out,opt] Set to true if extra_fd has input available.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		int perform(int extra_fd, int timeout_ms, bool *pExtraReady = nullptr);
+
+		/**
+		 * Retrieve a finished transfer.
+		 * @param pRet [out] Transfer result: 0 on success; negative POSIX error code, positive HTTP status code on error.
+		 * @return CurlDownloader, or nullptr if no transfers have finished.
+		 */
+		CurlDownloader *takeFinished(int *pRet);
+
+	private:
+		void *m_multi;			// CURLM*
+		std::vector<void*> m_easy;	// Active easy handles (CURL*)
+
+		// Finished transfers: downloader and result
+		std::deque<std::pair<CurlDownloader*, int> > m_finished;
+};
+
+}
+
+#endif /* __ROMPROPERTIES_RP_DOWNLOAD_CURLMULTIDOWNLOADER_HPP__ */
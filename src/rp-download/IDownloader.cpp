@@ -15,6 +15,7 @@
 
 // C++ includes
 #include <string>
+using std::string;
 using std::tstring;
 
 #ifdef __linux__
@@ -29,6 +30,7 @@ namespace RpDownload {
 
 IDownloader::IDownloader()
 	: m_mtime(-1)
+	, m_ifModifiedSince(-1)
 	, m_inProgress(false)
 	, m_maxSize(0)
 #ifdef _WIN32
@@ -41,6 +43,7 @@ IDownloader::IDownloader()
 IDownloader::IDownloader(const TCHAR *url)
 	: m_url(url)
 	, m_mtime(-1)
+	, m_ifModifiedSince(-1)
 	, m_inProgress(false)
 	, m_maxSize(0)
 #ifdef _WIN32
@@ -53,6 +56,7 @@ IDownloader::IDownloader(const TCHAR *url)
 IDownloader::IDownloader(const tstring &url)
 	: m_url(url)
 	, m_mtime(-1)
+	, m_ifModifiedSince(-1)
 	, m_inProgress(false)
 	, m_maxSize(0)
 {
@@ -124,6 +128,32 @@ void IDownloader::setMaxSize(size_t maxSize)
 	m_maxSize = maxSize;
 }
 
+/** Conditional requests. **/
+
+/**
+ * Set the ETag of the cached copy of the file.
+ * If set, the server will be asked to only send the file if
+ * its ETag has changed. (If-None-Match)
+ * @param etag ETag, or empty string for none.
+ */
+void IDownloader::setIfNoneMatch(const string &etag)
+{
+	assert(!m_inProgress);
+	m_ifNoneMatch = etag;
+}
+
+/**
+ * Set the modification time of the cached copy of the file.
+ * If set, the server will be asked to only send the file if
+ * it was modified after this time. (If-Modified-Since)
+ * @param mtime Modification time, or -1 for none.
+ */
+void IDownloader::setIfModifiedSince(time_t mtime)
+{
+	assert(!m_inProgress);
+	m_ifModifiedSince = mtime;
+}
+
 /** Data accessors. **/
 
 /**
@@ -153,6 +183,15 @@ time_t IDownloader::mtime(void) const
 	return m_mtime;
 }
 
+/**
+ * Get the ETag.
+ * @return ETag, or empty string if none was set by the server.
+ */
+const string &IDownloader::etag(void) const
+{
+	return m_etag;
+}
+
 /**
  * Clear the data.
  */
@@ -78,6 +78,25 @@ class IDownloader
 		 */
 		void setMaxSize(size_t maxSize);
 
+	public:
+		/** Conditional requests. **/
+
+		/**
+		 * Set the ETag of the cached copy of the file.
+		 * If set, the server will be asked to only send the file if
+		 * its ETag has changed. (If-None-Match)
+		 * @param etag ETag, or empty string for none.
+		 */
+		void setIfNoneMatch(const std::string &etag);
+
+		/**
+		 * Set the modification time of the cached copy of the file.
+		 * If set, the server will be asked to only send the file if
+		 * it was modified after this time. (If-Modified-Since)
+		 * @param mtime Modification time, or -1 for none.
+		 */
+		void setIfModifiedSince(time_t mtime);
+
 	public:
 		/** Data accessors. **/
 
@@ -99,6 +118,12 @@ class IDownloader
 		 */
 		time_t mtime(void) const;
 
+		/**
+		 * Get the ETag.
+		 * @return ETag, or empty string if none was set by the server.
+		 */
+		const std::string &etag(void) const;
+
 		/**
 		 * Clear the data.
 		 */
@@ -107,6 +132,11 @@ class IDownloader
 	public:
 		/**
 		 * Download the file.
+		 *
+		 * If a conditional request was set up using setIfNoneMatch()
+		 * and/or setIfModifiedSince() and the file was not modified,
+		 * 304 will be returned and no data will be downloaded.
+		 *
 		 * @return 0 on success; negative POSIX error code, positive HTTP status code on error.
 		 */
 		virtual int download(void) = 0;
@@ -132,6 +162,12 @@ class IDownloader
 
 		// Last-Modified time.
 		time_t m_mtime;
+		// ETag.
+		std::string m_etag;
+
+		// Conditional request validators.
+		std::string m_ifNoneMatch;
+		time_t m_ifModifiedSince;
 
 		bool m_inProgress;	// Set when downloading.
 		size_t m_maxSize;	// Maximum buffer size. (0 == unlimited)
@@ -11,8 +11,11 @@
 
 // libwin32common
 #include "libwin32common/RpWin32_sdk.h"
+#include "libwin32common/MiniU82T.hpp"
 #include "libwin32common/w32err.h"
 #include "libwin32common/w32time.h"
+using LibWin32Common::T2U8_c;
+using LibWin32Common::U82T_s;
 
 // C++ STL classes.
 using std::string;
@@ -49,6 +52,7 @@ int WinInetDownloader::download(void)
 	// Clear the previous download.
 	m_data.clear();
 	m_mtime = -1;
+	m_etag.clear();
 
 	// Open up an Internet connection.
 	// This doesn't actually connect to anything yet.
@@ -80,12 +84,35 @@ int WinInetDownloader::download(void)
 		}
 	}
 
+	// Conditional request validators.
+	tstring headers;
+	if (!m_ifNoneMatch.empty()) {
+		headers += _T("If-None-Match: ");
+		headers += U82T_s(m_ifNoneMatch);
+		headers += _T("\r\n");
+	}
+	if (m_ifModifiedSince >= 0) {
+		SYSTEMTIME st;
+		UnixTimeToSystemTime(m_ifModifiedSince, &st);
+		TCHAR szTime[64];
+		if (InternetTimeFromSystemTime(&st, INTERNET_RFC1123_FORMAT, szTime, sizeof(szTime))) {
+			headers += _T("If-Modified-Since: ");
+			headers += szTime;
+			headers += _T("\r\n");
+		}
+	}
+	if (!headers.empty()) {
+		// Make sure WinInet's own cache doesn't handle the
+		// conditional request, since we need to see the 304.
+		dwFlags |= INTERNET_FLAG_RELOAD | INTERNET_FLAG_NO_CACHE_WRITE;
+	}
+
 	// Request the URL.
 	HINTERNET hURL = InternetOpenUrl(
 		hConnection,	// hInternet
 		m_url.c_str(),	// lpszUrl (Latin-1 characters only!)
-		nullptr,	// lpszHeaders
-		0,		// dwHeaderLength
+		(!headers.empty() ? headers.c_str() : nullptr),	// lpszHeaders
+		static_cast<DWORD>(headers.size()),		// dwHeaderLength
 		dwFlags,	// dwFlags
 		reinterpret_cast<DWORD_PTR>(this));	// dwContext
 	if (!hURL) {
@@ -113,6 +140,7 @@ int WinInetDownloader::download(void)
 		if (dwBufferLength == static_cast<DWORD>(sizeof(dwHttpStatusCode))) {
 			// Length is valid.
 			// We're only accepting HTTP 200.
+			// NOTE: This includes 304 for conditional requests.
 			if (dwHttpStatusCode != 200) {
 				// Unexpected status code.
 				InternetCloseHandle(hURL);
@@ -140,6 +168,19 @@ int WinInetDownloader::download(void)
 		}
 	}
 
+	// Get the ETag if it's available.
+	TCHAR szETag[256];
+	dwBufferLength = static_cast<DWORD>(sizeof(szETag));
+	if (HttpQueryInfo(hURL,			// hRequest
+		HTTP_QUERY_ETAG,		// dwInfoLevel
+		szETag,				// lpBuffer
+		&dwBufferLength,		// lpdwBufferLength
+		0))				// lpdwIndex
+	{
+		// Received the ETag.
+		m_etag = T2U8_c(szETag);
+	}
+
 	// Get Content-Length.
 	DWORD dwContentLength = 0;
 	dwBufferLength = static_cast<DWORD>(sizeof(dwContentLength));
@@ -13,9 +13,12 @@
 #include "librpsecure/os-secure.h"
 
 // C includes.
-#ifndef _WIN32
+#ifdef _WIN32
+#  include <sys/utime.h>
+#else /* !_WIN32 */
 #  include <fcntl.h>
 #  include <sys/stat.h>
+#  include <sys/time.h>
 #  include <unistd.h>
 #endif /* _WIN32 */
 
@@ -35,10 +38,19 @@
 #include <cstdio>
 
 // C++ includes.
+#include <algorithm>
+#include <deque>
+#include <map>
 #include <memory>
+#include <utility>
+#include <vector>
+using std::deque;
+using std::map;
+using std::pair;
 using std::string;
 using std::tstring;
 using std::unique_ptr;
+using std::vector;
 
 #ifdef _WIN32
 // libwin32common
@@ -67,7 +79,9 @@ using std::unique_ptr;
 #  include "WinInetDownloader.hpp"
 #else
 #  include "CurlDownloader.hpp"
+#  include "CurlMultiDownloader.hpp"
 #endif
+#include "CacheFileETag.hpp"
 #include "SetFileOriginInfo.hpp"
 using namespace RpDownload;
 
@@ -77,12 +91,26 @@ using namespace RpDownload;
 static const TCHAR *argv0 = nullptr;
 static bool verbose = false;
 
+#ifdef RP_DOWNLOAD_TESTING
+// Testing only: Download all files from this base URL instead of
+// the online databases. (--base-url=URL; not shown in the usage)
+static const TCHAR *base_url = nullptr;
+#endif /* RP_DOWNLOAD_TESTING */
+
 /**
  * Show command usage.
  */
 static void show_usage(void)
 {
 	_ftprintf(stderr, _T("Syntax: %s [-v] [-f] cache_key\n"), argv0);
+#ifndef _WIN32
+	_ftprintf(stderr, _T("        %s [-v] [-f] -w\n"), argv0);
+#endif /* !_WIN32 */
+	_ftprintf(stderr, _T("\n-f: Redownload files that are already cached, unless the server\n")
+	                  _T("    indicates they haven't been modified.\n"));
+#ifndef _WIN32
+	_ftprintf(stderr, _T("-w: Worker mode. Read \"id cache_key\" requests from stdin.\n"));
+#endif /* !_WIN32 */
 }
 
 /**
@@ -288,179 +316,17 @@ int rmkdir(const tstring &path)
 }
 
 /**
- * rp-download: Download an image from a supported online database.
- * @param cache_key Cache key, e.g. "ds/cover/US/ADAE.png"
- * @return 0 on success; non-zero on error.
+ * Get the download URL for a cache key.
  *
- * TODO:
- * - More error codes based on the error.
+ * The cache key prefix indicates the system and identifies
+ * the online database used.
+ *
+ * @param cache_key	[in] Cache key, e.g. "ds/cover/US/ADAE.png"
+ * @param full_url	[out] Full URL
+ * @return 0 on success; negative POSIX error code on error.
  */
-int RP_C_API _tmain(int argc, TCHAR *argv[])
+static int get_cache_key_url(const TCHAR *cache_key, tstring &full_url)
 {
-	// Create a downloader based on OS:
-	// - Linux: CurlDownloader
-	// - Windows: WinInetDownloader
-
-	// Syntax: rp-download cache_key
-	// Example: rp-download ds/coverM/US/ADAE.png
-
-	// If http_proxy or https_proxy are set, they will be used
-	// by the downloader code if supported.
-
-	// Reduce process integrity, if available.
-	rp_secure_reduce_integrity();
-
-	// Set OS-specific security options.
-	rp_secure_param_t param;
-#if defined(_WIN32)
-	param.bHighSec = FALSE;
-#elif defined(HAVE_SECCOMP)
-	static const int syscall_wl[] = {
-		// Syscalls used by rp-download.
-		// TODO: Add more syscalls.
-		// FIXME: glibc-2.31 uses 64-bit time syscalls that may not be
-		// defined in earlier versions, including Ubuntu 14.04.
-		SCMP_SYS(access),
-		SCMP_SYS(clock_gettime),
-#if defined(__SNR_clock_gettime64) || defined(__NR_clock_gettime64)
-		SCMP_SYS(clock_gettime64),
-#endif /* __SNR_clock_gettime64 || __NR_clock_gettime64 */
-		SCMP_SYS(close),
-		SCMP_SYS(fcntl),     SCMP_SYS(fcntl64),		// gcc profiling
-		SCMP_SYS(fsetxattr),
-		SCMP_SYS(fstat),     SCMP_SYS(fstat64),		// __GI___fxstat() [printf()]
-		SCMP_SYS(fstatat64), SCMP_SYS(newfstatat),	// Ubuntu 19.10 (32-bit)
-		SCMP_SYS(futex),
-		SCMP_SYS(getdents), SCMP_SYS(getdents64),
-		SCMP_SYS(getppid),	// for bubblewrap verification
-		SCMP_SYS(getrusage),
-		SCMP_SYS(gettimeofday),	// 32-bit only?
-		SCMP_SYS(getuid),	// TODO: Only use geteuid()?
-		SCMP_SYS(lseek), SCMP_SYS(_llseek),
-		//SCMP_SYS(lstat), SCMP_SYS(lstat64),	// Not sure if used?
-		SCMP_SYS(mkdir), SCMP_SYS(mmap), SCMP_SYS(mmap2),
-		SCMP_SYS(munmap),
-		SCMP_SYS(open),		// Ubuntu 16.04
-		SCMP_SYS(openat),	// glibc-2.31
-#if defined(__SNR_openat2)
-		SCMP_SYS(openat2),	// Linux 5.6
-#elif defined(__NR_openat2)
-		__NR_openat2,		// Linux 5.6
-#endif /* __SNR_openat2 || __NR_openat2 */
-		SCMP_SYS(poll), SCMP_SYS(select),
-		SCMP_SYS(stat), SCMP_SYS(stat64),
-		SCMP_SYS(unlink),	// to delete expired cache files
-		SCMP_SYS(utimensat),
-
-#if defined(__SNR_statx) || defined(__NR_statx)
-		SCMP_SYS(getcwd),	// called by glibc's statx()
-		SCMP_SYS(statx),
-#endif /* __SNR_statx || __NR_statx */
-
-#ifndef NDEBUG
-		// Needed for assert() on some systems.
-		SCMP_SYS(uname),
-#endif /* NDEBUG */
-
-		// glibc ncsd
-		// TODO: Restrict connect() to AF_UNIX.
-		SCMP_SYS(connect), SCMP_SYS(recvmsg), SCMP_SYS(sendto),
-		SCMP_SYS(sendmmsg),	// getaddrinfo() (32-bit only?)
-		SCMP_SYS(ioctl),	// getaddrinfo() (32-bit only?) [FIXME: Filter for FIONREAD]
-		SCMP_SYS(recvfrom),	// getaddrinfo() (32-bit only?)
-
-		// Needed for network access on Kubuntu 20.04 for some reason.
-		SCMP_SYS(getpid), SCMP_SYS(uname),
-
-		// cURL and OpenSSL
-		SCMP_SYS(bind),		// getaddrinfo() [curl_thread_create_thunk(), curl-7.68.0]
-#ifdef __SNR_getrandom
-		SCMP_SYS(getrandom),
-#endif /* __SNR_getrandom */
-		SCMP_SYS(getpeername), SCMP_SYS(getsockname),
-		SCMP_SYS(getsockopt), SCMP_SYS(madvise), SCMP_SYS(mprotect),
-		SCMP_SYS(setsockopt), SCMP_SYS(socket),
-		SCMP_SYS(socketcall),	// FIXME: Enhanced filtering? [cURL+GnuTLS only?]
-		SCMP_SYS(socketpair), SCMP_SYS(sysinfo),
-		SCMP_SYS(rt_sigprocmask),	// Ubuntu 20.04: __GI_getaddrinfo() ->
-						// gaih_inet() ->
-						// _nss_myhostname_gethostbyname4_r()
-
-		// libnss_resolve.so (systemd-resolved)
-		SCMP_SYS(geteuid),
-		SCMP_SYS(sendmsg),	// libpthread.so [_nss_resolve_gethostbyname4_r() from libnss_resolve.so]
-
-		// FIXME: Manjaro is using these syscalls for some reason...
-		SCMP_SYS(prctl), SCMP_SYS(mremap), SCMP_SYS(ppoll),
-
-		-1	// End of whitelist
-	};
-	param.syscall_wl = syscall_wl;
-	param.threading = true;		// libcurl uses multi-threading.
-#elif defined(HAVE_PLEDGE)
-	// Promises:
-	// - stdio: General stdio functionality.
-	// - rpath: Read from ~/.config/rom-properties/ and ~/.cache/rom-properties/
-	// - wpath: Write to ~/.cache/rom-properties/
-	// - cpath: Create ~/.cache/rom-properties/ if it doesn't exist.
-	// - inet: Internet access.
-	// - fattr: Modify file attributes, e.g. mtime.
-	// - dns: Resolve hostnames.
-	// - getpw: Get user's home directory if HOME is empty.
-	param.promises = "stdio rpath wpath cpath inet fattr dns getpw";
-#elif defined(HAVE_TAME)
-	// NOTE: stdio includes fattr, e.g. utimes().
-	param.tame_flags = TAME_STDIO | TAME_RPATH | TAME_WPATH | TAME_CPATH |
-	                   TAME_INET | TAME_DNS | TAME_GETPW;
-#else
-	param.dummy = 0;
-#endif
-	rp_secure_enable(param);
-
-	// Store argv[0] globally.
-	argv0 = argv[0];
-
-	if (argc < 2) {
-		show_usage();
-		return EXIT_FAILURE;
-	}
-
-	// Check for arguments. (simple non-getopt version)
-	bool force = false;
-	int optind = 1;
-	for (; optind < argc; optind++) {
-		if (!argv[optind] || argv[optind][0] != '-') {
-			// End of options.
-			break;
-		}
-
-		// Allow multiple options in one argument, e.g. '-vf'.
-		for (int i = 1; argv[optind][i] != '\0'; i++) {
-			switch (argv[optind][i]) {
-				case 'v':
-					// Verbose mode is enabled.
-					verbose = true;
-					break;
-				case 'f':
-					// Force download is enabled.
-					force = true;
-					break;
-				default:
-					// Invalid parameter.
-					show_error(_T("Unrecognized option: %c"), argv[optind][i]);
-					show_usage();
-					return EXIT_FAILURE;
-			}
-		}
-	}
-
-	if (optind >= argc) {
-		show_error(_T("No cache key specified."));
-		show_usage();
-		return EXIT_FAILURE;
-	}
-	const TCHAR *const cache_key = argv[optind];
-
 	// Check the cache key prefix. The prefix indicates the system
 	// and identifies the online database used.
 	// [key] indicates the cache key without the prefix.
@@ -484,14 +350,14 @@ int RP_C_API _tmain(int argc, TCHAR *argv[])
 		// - Does not contain any slashes.
 		// - First slash is either the first or the last character.
 		SHOW_ERROR(_T("Cache key '%s' is invalid."), cache_key);
-		return EXIT_FAILURE;
+		return -EINVAL;
 	}
 
 	const ptrdiff_t prefix_len = (slash_pos - cache_key);
 	if (prefix_len <= 0) {
 		// Empty prefix.
 		SHOW_ERROR(_T("Cache key '%s' is invalid."), cache_key);
-		return EXIT_FAILURE;
+		return -EINVAL;
 	}
 
 	// Cache key must include a lowercase file extension.
@@ -499,14 +365,14 @@ int RP_C_API _tmain(int argc, TCHAR *argv[])
 	if (!lastdot) {
 		// No dot...
 		SHOW_ERROR(_T("Cache key '%s' is invalid."), cache_key);
-		return EXIT_FAILURE;
+		return -EINVAL;
 	}
 	if (_tcscmp(lastdot, _T(".png")) != 0 &&
 	    _tcscmp(lastdot, _T(".jpg")) != 0)
 	{
 		// Not a supported file extension.
 		SHOW_ERROR(_T("Cache key '%s' is invalid."), cache_key);
-		return EXIT_FAILURE;
+		return -EINVAL;
 	}
 
 	// urlencode the cache key.
@@ -516,14 +382,14 @@ int RP_C_API _tmain(int argc, TCHAR *argv[])
 
 	// Determine the full URL based on the cache key.
 	bool ok = false;
-	TCHAR full_url[256];
+	TCHAR url_buf[256];
 	if ((prefix_len == 3 && (!_tcsncmp(cache_key, _T("wii"), 3) || !_tcsncmp(cache_key, _T("3ds"), 3))) ||
 	    (prefix_len == 4 && !_tcsncmp(cache_key, _T("wiiu"), 4)) ||
 	    (prefix_len == 2 && !_tcsncmp(cache_key, _T("ds"), 2)))
 	{
 		// GameTDB: Wii, Wii U, Nintendo 3DS, Nintendo DS
 		ok = true;
-		_sntprintf(full_url, _countof(full_url),
+		_sntprintf(url_buf, _countof(url_buf),
 			_T("https://art.gametdb.com/%s"), cache_key_urlencode.c_str());
 	} else if (prefix_len == 6 && !_tcsncmp(cache_key, _T("amiibo"), 6)) {
 		// amiibo.life: amiibo images
@@ -532,12 +398,12 @@ int RP_C_API _tmain(int argc, TCHAR *argv[])
 		if (filename_len <= 4) {
 			// Can't remove the extension...
 			SHOW_ERROR(_T("Cache key '%s' is invalid."), cache_key);
-			return EXIT_FAILURE;
+			return -EINVAL;
 		}
 		filename_len -= 4;
 
 		ok = true;
-		_sntprintf(full_url, _countof(full_url),
+		_sntprintf(url_buf, _countof(url_buf),
 			_T("https://amiibo.life/nfc/%.*s/image"),
 			static_cast<int>(filename_len), slash_pos+1);
 	} else {
@@ -588,7 +454,7 @@ int RP_C_API _tmain(int argc, TCHAR *argv[])
 		}
 
 		if (ok) {
-			_sntprintf(full_url, _countof(full_url),
+			_sntprintf(url_buf, _countof(url_buf),
 				_T("https://rpdb.gerbilsoft.com/%s"), cache_key_urlencode.c_str());
 		}
 	}
@@ -596,28 +462,51 @@ int RP_C_API _tmain(int argc, TCHAR *argv[])
 	if (!ok) {
 		// Prefix is not supported.
 		SHOW_ERROR(_T("Cache key '%s' has an unsupported prefix."), cache_key);
-		return EXIT_FAILURE;
+		return -ENOTSUP;
 	}
 
+#ifdef RP_DOWNLOAD_TESTING
+	if (base_url) {
+		// Testing only: Use the base URL override.
+		full_url.assign(base_url);
+		full_url += _T('/');
+		full_url += cache_key_urlencode;
+	} else
+#endif /* RP_DOWNLOAD_TESTING */
+	{
+		full_url.assign(url_buf);
+	}
 	if (verbose) {
-		_ftprintf(stderr, _T("URL: %s\n"), full_url);
+		_ftprintf(stderr, _T("URL: %s\n"), full_url.c_str());
 	}
+	return 0;
+}
 
-	// Make sure we have a valid cache directory.
-	const string &cache_dir = LibCacheCommon::getCacheDirectory();
-	if (cache_dir.empty()) {
-		// Cache directory is invalid...
-		// This may happen if bubblewrap is in use.
-		SHOW_ERROR(_T("Unable to access cache directory. Check the sandbox environment!"));
-		return EXIT_FAILURE;
-	}
+/**
+ * Check if a cache file needs to be downloaded.
+ *
+ * Expired negative cache files will be deleted, and the
+ * cache directory structure will be created if necessary.
+ *
+ * If force is set and the file is already cached, the existing file
+ * will be kept so it can be revalidated using a conditional request.
+ *
+ * @param cache_key		[in] Cache key
+ * @param force			[in] If true, redownload the file even if it's cached.
+ * @param cache_filename	[out] Cache filename
+ * @param cached_mtime		[out] mtime of the cached file to revalidate, or -1 if none.
+ * @return 0 if the file should be downloaded; 1 if it's already cached; negative POSIX error code on error.
+ */
+static int check_cache_file(const TCHAR *cache_key, bool force, tstring &cache_filename, time_t &cached_mtime)
+{
+	cached_mtime = -1;
 
 	// Get the cache filename.
-	tstring cache_filename = LibCacheCommon::getCacheFilename(cache_key);
+	cache_filename = LibCacheCommon::getCacheFilename(cache_key);
 	if (cache_filename.empty()) {
 		// Invalid cache filename.
 		SHOW_ERROR(_T("Cache key '%s' is invalid."), cache_key);
-		return EXIT_FAILURE;
+		return -EINVAL;
 	}
 	if (verbose) {
 		_ftprintf(stderr, _T("Cache Filename: %s\n"), cache_filename.c_str());
@@ -648,7 +537,7 @@ int RP_C_API _tmain(int argc, TCHAR *argv[])
 				// Less than a week old.
 				if (likely(!force)) {
 					SHOW_INFO(_T("Negative cache file for '%s' has not expired; not redownloading."), cache_key);
-					return EXIT_FAILURE;
+					return -ENOENT;
 				} else {
 					SHOW_INFO(_T("Negative cache file for '%s' has not expired, but -f was specified. Redownloading anyway."), cache_key);
 				}
@@ -657,104 +546,763 @@ int RP_C_API _tmain(int argc, TCHAR *argv[])
 			// More than a week old.
 			// Delete the cache file and try to download it again.
 			if (_tremove(cache_filename.c_str()) != 0) {
-				SHOW_ERROR(_T("Error deleting negative cache file for '%s': %s"), cache_key, _tcserror(errno));
-				return EXIT_FAILURE;
+				const int err = errno;
+				SHOW_ERROR(_T("Error deleting negative cache file for '%s': %s"), cache_key, _tcserror(err));
+				return (err != 0 ? -err : -EIO);
 			}
 		} else if (filesize > 0) {
 			// File is larger than 0 bytes, which indicates
 			// it was previously cached successfully
 			if (likely(!force)) {
 				SHOW_INFO(_T("Cache file for '%s' is already downloaded."), cache_key);
-				return EXIT_SUCCESS;
+				return 1;
 			} else {
-				SHOW_INFO(_T("Cache file for '%s' is already downloaded, but -f was specified. Redownloading anyway."), cache_key);
-				if (_tremove(cache_filename.c_str()) != 0) {
-					SHOW_ERROR(_T("Error deleting cache file for '%s': %s"), cache_key, _tcserror(errno));
-					return EXIT_FAILURE;
-				}
+				SHOW_INFO(_T("Cache file for '%s' is already downloaded, but -f was specified. Revalidating."), cache_key);
+				cached_mtime = filemtime;
 			}
 		}
 	} else if (ret == -ENOENT) {
 		// File not found. We'll need to download it.
 		// Make sure the path structure exists.
-		int ret = rmkdir(cache_filename.c_str());
+		ret = rmkdir(cache_filename.c_str());
 		if (ret != 0) {
 			SHOW_ERROR(_T("Error creating directory structure: %s"), _tcserror(-ret));
-			return EXIT_FAILURE;
+			return ret;
 		}
 	} else {
 		// Other error.
 		SHOW_ERROR(_T("Error checking cache file for '%s': %s"), cache_key, _tcserror(-ret));
-		return EXIT_FAILURE;
+		return ret;
 	}
 
-	// Attempt to download the file.
-	// TODO: IDownloaderFactory?
+	// The file needs to be downloaded.
+	return 0;
+}
+
+/**
+ * Set up a conditional request to revalidate a cached file.
+ * The stored ETag and the file's mtime will be used as validators.
+ * @param downloader	[in] Downloader
+ * @param cache_filename [in] Cache filename
+ * @param cached_mtime	[in] mtime of the cached file to revalidate, or -1 if none.
+ */
+static void set_conditional_request(IDownloader *downloader,
+	const tstring &cache_filename, time_t cached_mtime)
+{
+	string etag;
+	if (cached_mtime >= 0) {
+		if (getCacheFileETag(cache_filename.c_str(), etag) != 0) {
+			// No ETag. Only use the mtime.
+			etag.clear();
+		}
+	}
+
+	downloader->setIfNoneMatch(etag);
+	downloader->setIfModifiedSince(cached_mtime);
+}
+
+/**
+ * Write a downloaded file to the cache.
+ *
+ * If the download failed, the cache file will be left empty,
+ * which indicates a negative cache hit.
+ *
+ * If a cached file was being revalidated, it will be kept as-is
+ * if it wasn't modified (304) or if the server couldn't be reached.
+ *
+ * @param f_out		[in] Cache file, opened for writing, or nullptr if revalidating a cached file. (This will be closed.)
+ * @param cache_key	[in] Cache key
+ * @param cache_filename [in] Cache filename
+ * @param full_url	[in] Full URL
+ * @param dl_ret	[in] Return value from IDownloader::download().
+ * @param downloader	[in] Downloader
+ * @return 0 on success; negative POSIX error code, positive HTTP status code on error.
+ */
+static int write_cache_file(FILE *f_out, const TCHAR *cache_key,
+	const tstring &cache_filename, const tstring &full_url,
+	int dl_ret, const IDownloader *downloader)
+{
+	if (!f_out) {
+		// Revalidating a cached file.
+		if (dl_ret == 304) {
+			// Not modified.
+			// Update the cache file's mtime so it won't be
+			// revalidated again until it expires.
+			SHOW_INFO(_T("Cache file for '%s' has not been modified."), cache_key);
 #ifdef _WIN32
-	unique_ptr<IDownloader> m_downloader(new WinInetDownloader());
+			_tutime(cache_filename.c_str(), nullptr);
 #else /* !_WIN32 */
-	unique_ptr<IDownloader> m_downloader(new CurlDownloader());
+			utimes(cache_filename.c_str(), nullptr);
 #endif /* _WIN32 */
+			return 0;
+		}
 
-	// Open the cache file now so we can use it as a negative hit
-	// if the download fails.
-	FILE *f_out = _tfopen(cache_filename.c_str(), _T("wb"));
-	if (!f_out) {
-		// Error opening the cache file.
-		SHOW_ERROR(_T("Error writing to cache file: %s"), _tcserror(errno));
-		return EXIT_FAILURE;
+		// Overwrite the cached file if it was modified or if it
+		// no longer exists on the server. Other errors, e.g.
+		// network errors, will leave the cached file as-is.
+		if (dl_ret == 0 || dl_ret == 404 || dl_ret == 410) {
+			f_out = _tfopen(cache_filename.c_str(), _T("wb"));
+			if (!f_out) {
+				const int err = errno;
+				SHOW_ERROR(_T("Error writing to cache file: %s"), _tcserror(err));
+				return (err != 0 ? -err : -EIO);
+			}
+			if (dl_ret != 0) {
+				// Remove the previous ETag, since this is now a negative cache file.
+#ifdef _WIN32
+				setCacheFileETag(f_out, cache_filename.c_str(), string());
+#else /* !_WIN32 */
+				setCacheFileETag(f_out, string());
+#endif /* _WIN32 */
+			}
+		}
 	}
 
-	// TODO: Configure this somewhere?
-	m_downloader->setMaxSize(4*1024*1024);
-
-	m_downloader->setUrl(full_url);
-	ret = m_downloader->download();
-	if (ret != 0) {
+	if (dl_ret != 0) {
 		// Error downloading the file.
 		if (verbose) {
-			if (ret < 0) {
+			if (dl_ret < 0) {
 				// POSIX error code
-				show_error(_T("Error downloading file: %s"), _tcserror(-ret));
-			} else /*if (ret > 0)*/ {
+				show_error(_T("Error downloading file: %s"), _tcserror(-dl_ret));
+			} else /*if (dl_ret > 0)*/ {
 				// HTTP status code
-				const TCHAR *msg = http_status_string(ret);
+				const TCHAR *msg = http_status_string(dl_ret);
 				if (msg) {
-					show_error(_T("Error downloading file: HTTP %d %s"), ret, msg);
+					show_error(_T("Error downloading file: HTTP %d %s"), dl_ret, msg);
 				} else {
-					show_error(_T("Error downloading file: HTTP %d"), ret);
+					show_error(_T("Error downloading file: HTTP %d"), dl_ret);
 				}
 			}
 		}
-		fclose(f_out);
-		return EXIT_FAILURE;
+		if (f_out) {
+			fclose(f_out);
+		}
+		return dl_ret;
 	}
 
-	if (m_downloader->dataSize() <= 0) {
+	if (downloader->dataSize() <= 0) {
 		// No data downloaded...
 		SHOW_ERROR(_T("Error downloading file: 0 bytes received"));
 		fclose(f_out);
-		return EXIT_FAILURE;
+		return -EIO;
 	}
 
 	// Write the file to the cache.
 	// TODO: Verify the size.
-	const size_t dataSize = m_downloader->dataSize();
-	size_t size = fwrite(m_downloader->data(), 1, dataSize, f_out);
+	const size_t dataSize = downloader->dataSize();
+	fwrite(downloader->data(), 1, dataSize, f_out);
 	fflush(f_out);
 
-	// Save the file origin information.
+	// Save the ETag for revalidation and the file origin information.
+	// NOTE: If no ETag was received, a previously-stored ETag will be removed.
 #ifdef _WIN32
 	// TODO: Figure out how to setFileOriginInfo() on Windows using an open file handle.
-	setFileOriginInfo(f_out, cache_filename.c_str(), full_url, m_downloader->mtime());
+	setCacheFileETag(f_out, cache_filename.c_str(), downloader->etag());
+	setFileOriginInfo(f_out, cache_filename.c_str(), full_url.c_str(), downloader->mtime());
 #else /* !_WIN32 */
-	setFileOriginInfo(f_out, full_url, m_downloader->mtime());
+	setCacheFileETag(f_out, downloader->etag());
+	setFileOriginInfo(f_out, full_url.c_str(), downloader->mtime());
 #endif /* _WIN32 */
 	fclose(f_out);
 
 	// Success.
 	SHOW_INFO(_T("Downloaded cache file for '%s': %u byte%s."),
 		cache_key, static_cast<unsigned int>(dataSize),
-		unlikely(dataSize == 1) ? "" : "s");
-	return EXIT_SUCCESS;
+		unlikely(dataSize == 1) ? _T("") : _T("s"));
+	return 0;
+}
+
+#ifndef _WIN32
+// Worker mode: Maximum number of simultaneous transfers.
+#define WORKER_MAX_ACTIVE 8
+// Worker mode: Maximum number of connections per host.
+#define WORKER_MAX_HOST_CONNECTIONS 4
+// Worker mode: Exit if no requests are received for this many seconds.
+#define WORKER_IDLE_TIMEOUT 30
+#ifdef RP_DOWNLOAD_TESTING
+// Testing only: Idle timeout override. (--idle-timeout=N; not shown in the usage)
+static int worker_idle_timeout = WORKER_IDLE_TIMEOUT;
+#else /* !RP_DOWNLOAD_TESTING */
+static const int worker_idle_timeout = WORKER_IDLE_TIMEOUT;
+#endif /* RP_DOWNLOAD_TESTING */
+// Worker mode: Maximum request line length.
+#define WORKER_MAX_LINE_LENGTH 1024
+
+/**
+ * Worker mode: A single cache key being downloaded.
+ */
+struct WorkerRequest {
+	tstring cache_key;
+	tstring cache_filename;
+	tstring full_url;
+	time_t cached_mtime;	// mtime of the cached file to revalidate, or -1 if none.
+	FILE *f_out;		// nullptr if revalidating
+	bool started;
+	CurlDownloader downloader;
+	vector<string> ids;	// Request IDs waiting for this cache key.
+
+	WorkerRequest()
+		: cached_mtime(-1)
+		, f_out(nullptr)
+		, started(false)
+	{ }
+};
+
+/**
+ * Worker mode: Send a response to the client.
+ * @param id Request ID
+ * @param status Status: 0 on success; negative POSIX error code, positive HTTP status code on error.
+ */
+static void worker_respond(const string &id, int status)
+{
+	char buf[64];
+	int len = snprintf(buf, sizeof(buf), "%s %d\n", id.c_str(), status);
+	if (len <= 0 || len >= static_cast<int>(sizeof(buf)))
+		return;
+
+	const char *p = buf;
+	while (len > 0) {
+		ssize_t sz = write(STDOUT_FILENO, p, len);
+		if (sz < 0) {
+			if (errno == EINTR)
+				continue;
+			// Client is gone.
+			return;
+		}
+		p += sz;
+		len -= static_cast<int>(sz);
+	}
+}
+
+/**
+ * Worker mode: Cancel a request.
+ * @param multi		[in] CurlMultiDownloader
+ * @param requests	[in,out] Requests, indexed by cache key.
+ * @param queued	[in,out] Requests that haven't been started yet.
+ * @param id		[in] Request ID
+ */
+static void worker_cancel(CurlMultiDownloader &multi,
+	map<tstring, unique_ptr<WorkerRequest> > &requests,
+	deque<WorkerRequest*> &queued, const string &id)
+{
+	for (auto iter = requests.begin(); iter != requests.end(); ++iter) {
+		WorkerRequest *const req = iter->second.get();
+		auto id_iter = std::find(req->ids.begin(), req->ids.end(), id);
+		if (id_iter == req->ids.end())
+			continue;
+
+		req->ids.erase(id_iter);
+		if (!req->ids.empty()) {
+			// Other requests are still waiting for this cache key.
+			worker_respond(id, -ECANCELED);
+			return;
+		}
+
+		if (req->started) {
+			// Download was started. Abort it and delete the
+			// incomplete file so it isn't a negative cache entry.
+			// (If revalidating, the cached file is left as-is.)
+			multi.remove(&req->downloader);
+			if (req->f_out) {
+				fclose(req->f_out);
+				_tremove(req->cache_filename.c_str());
+			}
+		} else {
+			auto q_iter = std::find(queued.begin(), queued.end(), req);
+			if (q_iter != queued.end()) {
+				queued.erase(q_iter);
+			}
+		}
+		SHOW_INFO(_T("Canceled download for '%s'."), req->cache_key.c_str());
+		requests.erase(iter);
+
+		// Respond after the incomplete file is deleted so the
+		// client doesn't see it as a negative cache entry.
+		worker_respond(id, -ECANCELED);
+		return;
+	}
+
+	// Request not found. It may have already finished.
+}
+
+/**
+ * Worker mode: Download cache keys requested over stdin.
+ *
+ * This allows a single sandboxed rp-download process to handle
+ * many downloads, reusing connections to the online databases
+ * and downloading multiple files concurrently.
+ *
+ * Requests are read from stdin, one per line:
+ * - "<id> <cache_key>": Download a cache key.
+ * - "<id> -f <cache_key>": Revalidate a cache key, even if it's cached.
+ * - "!<id>": Cancel a request.
+ *
+ * Responses are written to stdout, one per line, as each request finishes:
+ * - "<id> <status>"
+ *
+ * id is chosen by the client and may contain up to 15 non-space characters.
+ * It must not start with '!'.
+ * status is 0 on success; negative POSIX error code, positive HTTP status code on error.
+ * Canceled requests return -ECANCELED, unless they already finished.
+ * Responses are not necessarily written in the same order as the requests.
+ *
+ * If all requests for a cache key are canceled, its download is aborted
+ * and no negative cache entry is created.
+ *
+ * The worker exits once stdin is closed and all requests are finished,
+ * or if no requests are received for WORKER_IDLE_TIMEOUT seconds.
+ *
+ * @param force If true, redownload files even if they're cached.
+ * @return Exit code.
+ */
+static int worker_main(bool force)
+{
+	CurlMultiDownloader multi;
+	if (!multi.isInit()) {
+		SHOW_ERROR(_T("Unable to initialize cURL."));
+		return EXIT_FAILURE;
+	}
+	multi.setMaxHostConnections(WORKER_MAX_HOST_CONNECTIONS);
+
+	// Don't block on stdin. Input is polled by CurlMultiDownloader.
+	const int fl = fcntl(STDIN_FILENO, F_GETFL);
+	if (fl < 0 || fcntl(STDIN_FILENO, F_SETFL, fl | O_NONBLOCK) != 0) {
+		SHOW_ERROR(_T("Unable to set stdin to non-blocking mode: %s"), _tcserror(errno));
+		return EXIT_FAILURE;
+	}
+
+	// Requests, indexed by cache key.
+	// Duplicate cache keys are only downloaded once.
+	map<tstring, unique_ptr<WorkerRequest> > requests;
+	// Requests that haven't been started yet.
+	deque<WorkerRequest*> queued;
+
+	string linebuf;
+	bool eof = false;
+	time_t last_activity = time(nullptr);
+
+	while (!eof || !requests.empty()) {
+		bool stdin_ready = false;
+		int ret = multi.perform(eof ? -1 : STDIN_FILENO, 1000, &stdin_ready);
+		if (ret != 0) {
+			SHOW_ERROR(_T("cURL error: %s"), _tcserror(-ret));
+			return EXIT_FAILURE;
+		}
+
+		// Read new requests.
+		if (stdin_ready) {
+			char buf[4096];
+			ssize_t sz = read(STDIN_FILENO, buf, sizeof(buf));
+			if (sz > 0) {
+				linebuf.append(buf, sz);
+				last_activity = time(nullptr);
+			} else if (sz == 0 || (errno != EAGAIN && errno != EINTR)) {
+				// Client closed the connection.
+				eof = true;
+			}
+		}
+
+		size_t nl_pos;
+		while ((nl_pos = linebuf.find('\n')) != string::npos) {
+			const string line = linebuf.substr(0, nl_pos);
+			linebuf.erase(0, nl_pos + 1);
+
+			if (!line.empty() && line[0] == '!') {
+				// Cancel a request.
+				worker_cancel(multi, requests, queued, line.substr(1));
+				continue;
+			}
+
+			const size_t sp_pos = line.find(' ');
+			if (sp_pos == string::npos || sp_pos == 0 || sp_pos > 15) {
+				// Invalid request.
+				SHOW_ERROR(_T("Invalid request: %s"), line.c_str());
+				continue;
+			}
+			const string id = line.substr(0, sp_pos);
+			tstring cache_key = line.substr(sp_pos + 1);
+			bool req_force = force;
+			if (cache_key.compare(0, 3, "-f ") == 0) {
+				// Revalidate this cache key.
+				// NOTE: Cache keys can't start with '-'.
+				cache_key.erase(0, 3);
+				req_force = true;
+			}
+
+			// Is this cache key already being downloaded?
+			auto iter = requests.find(cache_key);
+			if (iter != requests.end()) {
+				iter->second->ids.push_back(id);
+				continue;
+			}
+
+			unique_ptr<WorkerRequest> req(new WorkerRequest());
+			ret = get_cache_key_url(cache_key.c_str(), req->full_url);
+			if (ret == 0) {
+				ret = check_cache_file(cache_key.c_str(), req_force, req->cache_filename, req->cached_mtime);
+			}
+			if (ret != 0) {
+				// Already cached (1), or an error occurred.
+				worker_respond(id, (ret > 0 ? 0 : ret));
+				continue;
+			}
+
+			req->cache_key = cache_key;
+			req->ids.push_back(id);
+			queued.push_back(req.get());
+			requests.emplace(cache_key, std::move(req));
+		}
+		if (linebuf.size() > WORKER_MAX_LINE_LENGTH) {
+			// Line is too long. Discard it.
+			SHOW_ERROR(_T("Request is too long; discarding."));
+			linebuf.clear();
+		}
+
+		// Write finished downloads to the cache.
+		int dl_ret;
+		CurlDownloader *downloader;
+		while ((downloader = multi.takeFinished(&dl_ret)) != nullptr) {
+			// Find the request that owns this downloader.
+			auto iter = std::find_if(requests.begin(), requests.end(),
+				[downloader](const pair<const tstring, unique_ptr<WorkerRequest> > &p) {
+					return (&p.second->downloader == downloader);
+				});
+			assert(iter != requests.end());
+			if (iter == requests.end())
+				continue;
+
+			WorkerRequest *const req = iter->second.get();
+			ret = write_cache_file(req->f_out, req->cache_key.c_str(),
+				req->cache_filename, req->full_url, dl_ret, &req->downloader);
+			for (const string &id : req->ids) {
+				worker_respond(id, ret);
+			}
+			requests.erase(iter);
+		}
+
+		// Start queued downloads.
+		while (!queued.empty() && multi.activeCount() < WORKER_MAX_ACTIVE) {
+			WorkerRequest *const req = queued.front();
+			queued.pop_front();
+
+			// Open the cache file now so we can use it as a negative hit
+			// if the download fails. If a cached file is being revalidated,
+			// it won't be opened until we know it was modified.
+			if (req->cached_mtime < 0) {
+				req->f_out = _tfopen(req->cache_filename.c_str(), _T("wb"));
+			}
+			if (req->f_out || req->cached_mtime >= 0) {
+				// TODO: Configure this somewhere?
+				req->downloader.setMaxSize(4*1024*1024);
+				req->downloader.setUrl(req->full_url);
+				set_conditional_request(&req->downloader, req->cache_filename, req->cached_mtime);
+				ret = multi.add(&req->downloader);
+				if (ret == 0) {
+					req->started = true;
+				} else if (req->f_out) {
+					fclose(req->f_out);
+				}
+			} else {
+				const int err = errno;
+				SHOW_ERROR(_T("Error writing to cache file: %s"), _tcserror(err));
+				ret = (err != 0 ? -err : -EIO);
+			}
+
+			if (ret != 0) {
+				for (const string &id : req->ids) {
+					worker_respond(id, ret);
+				}
+				const tstring cache_key = req->cache_key;
+				requests.erase(cache_key);
+			}
+		}
+
+		if (!requests.empty()) {
+			last_activity = time(nullptr);
+		} else if (time(nullptr) - last_activity >= worker_idle_timeout) {
+			// No requests for a while.
+			SHOW_INFO(_T("No requests received in %d seconds; exiting."), worker_idle_timeout);
+			break;
+		}
+	}
+
+	return EXIT_SUCCESS;
+}
+#endif /* !_WIN32 */
+
+/**
+ * rp-download: Download an image from a supported online database.
+ * @param cache_key Cache key, e.g. "ds/cover/US/ADAE.png"
+ * @return 0 on success; non-zero on error.
+ *
+ * TODO:
+ * - More error codes based on the error.
+ */
+int RP_C_API _tmain(int argc, TCHAR *argv[])
+{
+	// Create a downloader based on OS:
+	// - Linux: CurlDownloader
+	// - Windows: WinInetDownloader
+
+	// Syntax: rp-download cache_key
+	// Example: rp-download ds/coverM/US/ADAE.png
+
+	// Worker mode: rp-download -w
+	// Cache keys are read from stdin. See worker_main().
+
+	// If http_proxy or https_proxy are set, they will be used
+	// by the downloader code if supported.
+
+	// Reduce process integrity, if available.
+	rp_secure_reduce_integrity();
+
+	// Set OS-specific security options.
+	rp_secure_param_t param;
+#if defined(_WIN32)
+	param.bHighSec = FALSE;
+#elif defined(HAVE_SECCOMP)
+	static const int syscall_wl[] = {
+		// Syscalls used by rp-download.
+		// TODO: Add more syscalls.
+		// FIXME: glibc-2.31 uses 64-bit time syscalls that may not be
+		// defined in earlier versions, including Ubuntu 14.04.
+		SCMP_SYS(access),
+		SCMP_SYS(clock_gettime),
+#if defined(__SNR_clock_gettime64) || defined(__NR_clock_gettime64)
+		SCMP_SYS(clock_gettime64),
+#endif /* __SNR_clock_gettime64 || __NR_clock_gettime64 */
+		SCMP_SYS(close),
+		SCMP_SYS(eventfd2), SCMP_SYS(pipe), SCMP_SYS(pipe2),	// curl_multi_init() [worker mode]
+		SCMP_SYS(fcntl),     SCMP_SYS(fcntl64),		// gcc profiling
+		SCMP_SYS(fsetxattr), SCMP_SYS(fremovexattr),
+		SCMP_SYS(getxattr),	// for revalidation
+		SCMP_SYS(fstat),     SCMP_SYS(fstat64),		// __GI___fxstat() [printf()]
+		SCMP_SYS(fstatat64), SCMP_SYS(newfstatat),	// Ubuntu 19.10 (32-bit)
+		SCMP_SYS(futex),
+		SCMP_SYS(getdents), SCMP_SYS(getdents64),
+		SCMP_SYS(getppid),	// for bubblewrap verification
+		SCMP_SYS(getrusage),
+		SCMP_SYS(gettimeofday),	// 32-bit only?
+		SCMP_SYS(getuid),	// TODO: Only use geteuid()?
+		SCMP_SYS(lseek), SCMP_SYS(_llseek),
+		//SCMP_SYS(lstat), SCMP_SYS(lstat64),	// Not sure if used?
+		SCMP_SYS(mkdir), SCMP_SYS(mmap), SCMP_SYS(mmap2),
+		SCMP_SYS(munmap),
+		SCMP_SYS(open),		// Ubuntu 16.04
+		SCMP_SYS(openat),	// glibc-2.31
+#if defined(__SNR_openat2)
+		SCMP_SYS(openat2),	// Linux 5.6
+#elif defined(__NR_openat2)
+		__NR_openat2,		// Linux 5.6
+#endif /* __SNR_openat2 || __NR_openat2 */
+		SCMP_SYS(poll), SCMP_SYS(select),
+		SCMP_SYS(stat), SCMP_SYS(stat64),
+		SCMP_SYS(unlink),	// to delete expired cache files
+		SCMP_SYS(utimensat),
+		SCMP_SYS(utimes),	// glibc < 2.33
+
+#if defined(__SNR_statx) || defined(__NR_statx)
+		SCMP_SYS(getcwd),	// called by glibc's statx()
+		SCMP_SYS(statx),
+#endif /* __SNR_statx || __NR_statx */
+
+#ifndef NDEBUG
+		// Needed for assert() on some systems.
+		SCMP_SYS(uname),
+#endif /* NDEBUG */
+
+		// glibc ncsd
+		// TODO: Restrict connect() to AF_UNIX.
+		SCMP_SYS(connect), SCMP_SYS(recvmsg), SCMP_SYS(sendto),
+		SCMP_SYS(sendmmsg),	// getaddrinfo() (32-bit only?)
+		SCMP_SYS(ioctl),	// getaddrinfo() (32-bit only?) [FIXME: Filter for FIONREAD]
+		SCMP_SYS(recvfrom),	// getaddrinfo() (32-bit only?)
+
+		// Needed for network access on Kubuntu 20.04 for some reason.
+		SCMP_SYS(getpid), SCMP_SYS(uname),
+
+		// cURL and OpenSSL
+		SCMP_SYS(bind),		// getaddrinfo() [curl_thread_create_thunk(), curl-7.68.0]
+#ifdef __SNR_getrandom
+		SCMP_SYS(getrandom),
+#endif /* __SNR_getrandom */
+		SCMP_SYS(getpeername), SCMP_SYS(getsockname),
+		SCMP_SYS(getsockopt), SCMP_SYS(madvise), SCMP_SYS(mprotect),
+		SCMP_SYS(setsockopt), SCMP_SYS(socket),
+		SCMP_SYS(socketcall),	// FIXME: Enhanced filtering? [cURL+GnuTLS only?]
+		SCMP_SYS(socketpair), SCMP_SYS(sysinfo),
+		SCMP_SYS(rt_sigprocmask),	// Ubuntu 20.04: __GI_getaddrinfo() ->
+						// gaih_inet() ->
+						// _nss_myhostname_gethostbyname4_r()
+
+		// libnss_resolve.so (systemd-resolved)
+		SCMP_SYS(geteuid),
+		SCMP_SYS(sendmsg),	// libpthread.so [_nss_resolve_gethostbyname4_r() from libnss_resolve.so]
+
+		// FIXME: Manjaro is using these syscalls for some reason...
+		SCMP_SYS(prctl), SCMP_SYS(mremap), SCMP_SYS(ppoll),
+
+		-1	// End of whitelist
+	};
+	param.syscall_wl = syscall_wl;
+	param.threading = true;		// libcurl uses multi-threading.
+#elif defined(HAVE_PLEDGE)
+	// Promises:
+	// - stdio: General stdio functionality.
+	// - rpath: Read from ~/.config/rom-properties/ and ~/.cache/rom-properties/
+	// - wpath: Write to ~/.cache/rom-properties/
+	// - cpath: Create ~/.cache/rom-properties/ if it doesn't exist.
+	// - inet: Internet access.
+	// - fattr: Modify file attributes, e.g. mtime.
+	// - dns: Resolve hostnames.
+	// - getpw: Get user's home directory if HOME is empty.
+	param.promises = "stdio rpath wpath cpath inet fattr dns getpw";
+#elif defined(HAVE_TAME)
+	// NOTE: stdio includes fattr, e.g. utimes().
+	param.tame_flags = TAME_STDIO | TAME_RPATH | TAME_WPATH | TAME_CPATH |
+	                   TAME_INET | TAME_DNS | TAME_GETPW;
+#else
+	param.dummy = 0;
+#endif
+	rp_secure_enable(param);
+
+	// Store argv[0] globally.
+	argv0 = argv[0];
+
+	if (argc < 2) {
+		show_usage();
+		return EXIT_FAILURE;
+	}
+
+	// Check for arguments. (simple non-getopt version)
+	bool force = false;
+	bool worker = false;
+	int optind = 1;
+	for (; optind < argc; optind++) {
+		if (!argv[optind] || argv[optind][0] != '-') {
+			// End of options.
+			break;
+		}
+
+		// Long options. These are only used for testing, and are only
+		// accepted by the test build of rp-download. (rp-download-test)
+		if (argv[optind][1] == _T('-')) {
+#ifdef RP_DOWNLOAD_TESTING
+			const TCHAR *const opt = &argv[optind][2];
+			if (!_tcsncmp(opt, _T("base-url="), 9) && opt[9] != _T('\0')) {
+				base_url = &opt[9];
+#  ifndef _WIN32
+			} else if (!_tcsncmp(opt, _T("idle-timeout="), 13)) {
+				char *endptr = nullptr;
+				const long val = strtol(&opt[13], &endptr, 10);
+				if (!endptr || *endptr != '\0' || val <= 0 || val > WORKER_IDLE_TIMEOUT) {
+					show_error(_T("Invalid idle timeout: %s"), &opt[13]);
+					return EXIT_FAILURE;
+				}
+				worker_idle_timeout = static_cast<int>(val);
+#  endif /* !_WIN32 */
+			} else
+#endif /* RP_DOWNLOAD_TESTING */
+			{
+				show_error(_T("Unrecognized option: %s"), argv[optind]);
+				show_usage();
+				return EXIT_FAILURE;
+			}
+			continue;
+		}
+
+		// Allow multiple options in one argument, e.g. '-vf'.
+		for (int i = 1; argv[optind][i] != '\0'; i++) {
+			switch (argv[optind][i]) {
+				case 'v':
+					// Verbose mode is enabled.
+					verbose = true;
+					break;
+				case 'f':
+					// Force download is enabled.
+					force = true;
+					break;
+#ifndef _WIN32
+				case 'w':
+					// Worker mode is enabled.
+					worker = true;
+					break;
+#endif /* !_WIN32 */
+				default:
+					// Invalid parameter.
+					show_error(_T("Unrecognized option: %c"), argv[optind][i]);
+					show_usage();
+					return EXIT_FAILURE;
+			}
+		}
+	}
+
+	if (!worker && optind >= argc) {
+		show_error(_T("No cache key specified."));
+		show_usage();
+		return EXIT_FAILURE;
+	}
+
+	// Make sure we have a valid cache directory.
+	const string &cache_dir = LibCacheCommon::getCacheDirectory();
+	if (cache_dir.empty()) {
+		// Cache directory is invalid...
+		// This may happen if bubblewrap is in use.
+		SHOW_ERROR(_T("Unable to access cache directory. Check the sandbox environment!"));
+		return EXIT_FAILURE;
+	}
+
+#ifndef _WIN32
+	if (worker) {
+		return worker_main(force);
+	}
+#endif /* !_WIN32 */
+
+	const TCHAR *const cache_key = argv[optind];
+
+	// Determine the full URL based on the cache key.
+	tstring full_url;
+	int ret = get_cache_key_url(cache_key, full_url);
+	if (ret != 0) {
+		return EXIT_FAILURE;
+	}
+
+	// Check if the file needs to be downloaded.
+	tstring cache_filename;
+	time_t cached_mtime;
+	ret = check_cache_file(cache_key, force, cache_filename, cached_mtime);
+	if (ret != 0) {
+		// Already downloaded (1), or an error occurred.
+		return (ret > 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+	}
+
+	// Attempt to download the file.
+	// TODO: IDownloaderFactory?
+#ifdef _WIN32
+	unique_ptr<IDownloader> m_downloader(new WinInetDownloader());
+#else /* !_WIN32 */
+	unique_ptr<IDownloader> m_downloader(new CurlDownloader());
+#endif /* _WIN32 */
+
+	// Open the cache file now so we can use it as a negative hit
+	// if the download fails. If a cached file is being revalidated,
+	// it won't be opened until we know it was modified.
+	FILE *f_out = nullptr;
+	if (cached_mtime < 0) {
+		f_out = _tfopen(cache_filename.c_str(), _T("wb"));
+		if (!f_out) {
+			// Error opening the cache file.
+			SHOW_ERROR(_T("Error writing to cache file: %s"), _tcserror(errno));
+			return EXIT_FAILURE;
+		}
+	}
+
+	// TODO: Configure this somewhere?
+	m_downloader->setMaxSize(4*1024*1024);
+
+	m_downloader->setUrl(full_url);
+	set_conditional_request(m_downloader.get(), cache_filename, cached_mtime);
+	ret = m_downloader->download();
+	ret = write_cache_file(f_out, cache_key, cache_filename, full_url, ret, m_downloader.get());
+	return (ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
 }
@@ -0,0 +1,211 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (rp-download/tests)                *
+ * CurlDownloaderTest.cpp: CurlDownloader test.                            *
+ *                                                                         *
+ * Copyright (c) 2016-2022 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+
+// rp-download
+#include "../CurlDownloader.hpp"
+#include "../CacheFileETag.hpp"
+#include "LocalHttpServer.hpp"
+
+// C includes.
+#include <unistd.h>
+
+// C includes. (C++ namespace)
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// C++ includes.
+#include <string>
+using std::string;
+
+namespace RpDownload { namespace Tests {
+
+// Last-Modified time used by LocalHttpServer.
+static const time_t LAST_MODIFIED = 816411488;
+
+class CurlDownloaderTest : public ::testing::Test
+{
+	protected:
+		void SetUp(void) override
+		{
+			ASSERT_TRUE(m_server.start());
+		}
+
+		LocalHttpServer m_server;
+};
+
+/**
+ * A regular download should retrieve the ETag and Last-Modified time.
+ */
+TEST_F(CurlDownloaderTest, downloadValidators)
+{
+	CurlDownloader dl(m_server.url("/data/validators.png"));
+	EXPECT_EQ(0, dl.download());
+	EXPECT_EQ(m_server.etag("/data/validators.png"), dl.etag());
+	EXPECT_EQ(LAST_MODIFIED, dl.mtime());
+
+	static const char expected[] = "data:validators.png";
+	ASSERT_EQ(sizeof(expected)-1, dl.dataSize());
+	EXPECT_EQ(0, memcmp(expected, dl.data(), dl.dataSize()));
+}
+
+/**
+ * If-None-Match with the current ETag should return 304.
+ */
+TEST_F(CurlDownloaderTest, ifNoneMatchNotModified)
+{
+	CurlDownloader dl(m_server.url("/data/inm.png"));
+	dl.setIfNoneMatch(m_server.etag("/data/inm.png"));
+	EXPECT_EQ(304, dl.download());
+	EXPECT_EQ(0U, dl.dataSize());
+	EXPECT_EQ(1U, m_server.notModified());
+}
+
+/**
+ * If-None-Match with an old ETag should download the file,
+ * even if If-Modified-Since indicates it wasn't modified.
+ */
+TEST_F(CurlDownloaderTest, ifNoneMatchModified)
+{
+	CurlDownloader dl(m_server.url("/data/inm.png"));
+	dl.setIfNoneMatch("\"v0-inm.png\"");
+	dl.setIfModifiedSince(LAST_MODIFIED);
+	EXPECT_EQ(0, dl.download());
+	EXPECT_EQ(m_server.etag("/data/inm.png"), dl.etag());
+
+	static const char expected[] = "data:inm.png";
+	ASSERT_EQ(sizeof(expected)-1, dl.dataSize());
+	EXPECT_EQ(0, memcmp(expected, dl.data(), dl.dataSize()));
+	EXPECT_EQ(0U, m_server.notModified());
+}
+
+/**
+ * If-Modified-Since with the current Last-Modified time should return 304.
+ */
+TEST_F(CurlDownloaderTest, ifModifiedSinceNotModified)
+{
+	CurlDownloader dl(m_server.url("/data/ims.png"));
+	dl.setIfModifiedSince(LAST_MODIFIED);
+	EXPECT_EQ(304, dl.download());
+	EXPECT_EQ(0U, dl.dataSize());
+	EXPECT_EQ(1U, m_server.notModified());
+}
+
+/**
+ * If-Modified-Since with an older time should download the file.
+ */
+TEST_F(CurlDownloaderTest, ifModifiedSinceModified)
+{
+	CurlDownloader dl(m_server.url("/data/ims.png"));
+	dl.setIfModifiedSince(LAST_MODIFIED - 86400);
+	EXPECT_EQ(0, dl.download());
+
+	static const char expected[] = "data:ims.png";
+	ASSERT_EQ(sizeof(expected)-1, dl.dataSize());
+	EXPECT_EQ(0, memcmp(expected, dl.data(), dl.dataSize()));
+}
+
+/**
+ * Revalidating unchanged files should transfer much less data
+ * than downloading them again.
+ */
+TEST_F(CurlDownloaderTest, revalidateBytesTransferred)
+{
+	static const unsigned int count = 10;
+	string etags[count];
+
+	// Initial download.
+	for (unsigned int i = 0; i < count; i++) {
+		char path[32];
+		snprintf(path, sizeof(path), "/large/reval%u.png", i);
+		CurlDownloader dl(m_server.url(path));
+		ASSERT_EQ(0, dl.download());
+		ASSERT_EQ(64U*1024U, dl.dataSize());
+		etags[i] = dl.etag();
+		ASSERT_FALSE(etags[i].empty());
+	}
+	const size_t full_bytes = m_server.bytesSent();
+	EXPECT_GE(full_bytes, count * 64U*1024U);
+
+	// Revalidation.
+	m_server.resetCounters();
+	for (unsigned int i = 0; i < count; i++) {
+		char path[32];
+		snprintf(path, sizeof(path), "/large/reval%u.png", i);
+		CurlDownloader dl(m_server.url(path));
+		dl.setIfNoneMatch(etags[i]);
+		dl.setIfModifiedSince(LAST_MODIFIED);
+		EXPECT_EQ(304, dl.download());
+		EXPECT_EQ(0U, dl.dataSize());
+	}
+	const size_t reval_bytes = m_server.bytesSent();
+	EXPECT_EQ(count, m_server.notModified());
+
+	printf("Full download: %u bytes; revalidation: %u bytes\n",
+		static_cast<unsigned int>(full_bytes),
+		static_cast<unsigned int>(reval_bytes));
+	EXPECT_LT(reval_bytes * 100, full_bytes);
+}
+
+/**
+ * Storing and retrieving an ETag for a cache file.
+ */
+TEST_F(CurlDownloaderTest, cacheFileETag)
+{
+	char filename[] = "CurlDownloaderTest.XXXXXX";
+	const int fd = mkstemp(filename);
+	ASSERT_GE(fd, 0);
+	FILE *f = fdopen(fd, "wb");
+	ASSERT_TRUE(f != nullptr);
+
+	static const char etag[] = "\"v1-cachefile.png\"";
+	int ret = setCacheFileETag(f, etag);
+	if (ret == -ENOTSUP || ret == -EOPNOTSUPP) {
+		fclose(f);
+		unlink(filename);
+		GTEST_SKIP() << "xattrs are not supported on this file system.";
+	}
+	EXPECT_EQ(0, ret);
+
+	string read_etag;
+	EXPECT_EQ(0, getCacheFileETag(filename, read_etag));
+	EXPECT_EQ(etag, read_etag);
+
+	// Removing the ETag.
+	EXPECT_EQ(0, setCacheFileETag(f, string()));
+	EXPECT_NE(0, getCacheFileETag(filename, read_etag));
+	// Removing it again shouldn't be an error.
+	EXPECT_EQ(0, setCacheFileETag(f, string()));
+
+	fclose(f);
+	unlink(filename);
+}
+
+} }
+
+/**
+ * Test suite main function.
+ */
+int main(int argc, char *argv[])
+{
+	fprintf(stderr, "rp-download test suite: CurlDownloader tests.\n\n");
+	fflush(nullptr);
+
+	// Don't use a proxy for the local test server.
+	unsetenv("http_proxy");
+	unsetenv("HTTP_PROXY");
+	unsetenv("all_proxy");
+	unsetenv("ALL_PROXY");
+
+	// coverity[fun_call_w_exception]: uncaught exceptions cause nonzero exit anyway, so don't warn.
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
@@ -0,0 +1,325 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (rp-download/tests)                *
+ * CurlMultiDownloaderTest.cpp: CurlMultiDownloader test.                  *
+ *                                                                         *
+ * Copyright (c) 2016-2022 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+
+// rp-download
+#include "../CurlMultiDownloader.hpp"
+#include "LocalHttpServer.hpp"
+
+// C includes. (C++ namespace)
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// C++ includes.
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+namespace RpDownload { namespace Tests {
+
+class CurlMultiDownloaderTest : public ::testing::Test
+{
+	protected:
+		void SetUp(void) override
+		{
+			ASSERT_TRUE(m_server.start());
+		}
+
+		/**
+		 * Run the CurlMultiDownloader until all transfers are finished.
+		 * @param multi CurlMultiDownloader
+		 * @param results Finished transfers, in completion order.
+		 */
+		static void runAll(CurlMultiDownloader &multi, vector<std::pair<CurlDownloader*, int> > &results)
+		{
+			for (unsigned int i = 0; i < 200; i++) {
+				ASSERT_EQ(0, multi.perform(-1, 100));
+				int ret;
+				CurlDownloader *dl;
+				while ((dl = multi.takeFinished(&ret)) != nullptr) {
+					results.emplace_back(dl, ret);
+				}
+				if (multi.activeCount() == 0)
+					return;
+			}
+			FAIL() << "Timed out waiting for transfers to finish.";
+		}
+
+		LocalHttpServer m_server;
+};
+
+/**
+ * Sequential downloads should reuse a single connection.
+ */
+TEST_F(CurlMultiDownloaderTest, sequentialReusesConnection)
+{
+	CurlMultiDownloader multi;
+	ASSERT_TRUE(multi.isInit());
+
+	for (unsigned int i = 0; i < 5; i++) {
+		char path[32];
+		snprintf(path, sizeof(path), "/data/seq%u.png", i);
+		CurlDownloader dl(m_server.url(path));
+		ASSERT_EQ(0, multi.add(&dl));
+
+		vector<std::pair<CurlDownloader*, int> > results;
+		runAll(multi, results);
+		ASSERT_EQ(1U, results.size());
+		EXPECT_EQ(&dl, results[0].first);
+		EXPECT_EQ(0, results[0].second);
+
+		char expected[32];
+		snprintf(expected, sizeof(expected), "data:seq%u.png", i);
+		ASSERT_EQ(strlen(expected), dl.dataSize());
+		EXPECT_EQ(0, memcmp(expected, dl.data(), dl.dataSize()));
+		EXPECT_EQ(816411488, dl.mtime());
+	}
+
+	EXPECT_EQ(5U, m_server.requests());
+	EXPECT_EQ(1U, m_server.connections());
+}
+
+/**
+ * Concurrent downloads should all complete, and shouldn't
+ * use more than the maximum number of connections per host.
+ */
+TEST_F(CurlMultiDownloaderTest, concurrentDownloads)
+{
+	CurlMultiDownloader multi;
+	ASSERT_TRUE(multi.isInit());
+	multi.setMaxHostConnections(2);
+
+	static const unsigned int count = 16;
+	vector<unique_ptr<CurlDownloader> > dls;
+	for (unsigned int i = 0; i < count; i++) {
+		char path[32];
+		snprintf(path, sizeof(path), "/data/con%u.png", i);
+		dls.emplace_back(new CurlDownloader(m_server.url(path)));
+		ASSERT_EQ(0, multi.add(dls.back().get()));
+	}
+	EXPECT_EQ(count, multi.activeCount());
+
+	vector<std::pair<CurlDownloader*, int> > results;
+	runAll(multi, results);
+	ASSERT_EQ(count, results.size());
+	for (const auto &p : results) {
+		EXPECT_EQ(0, p.second);
+	}
+	for (unsigned int i = 0; i < count; i++) {
+		char expected[32];
+		snprintf(expected, sizeof(expected), "data:con%u.png", i);
+		ASSERT_EQ(strlen(expected), dls[i]->dataSize());
+		EXPECT_EQ(0, memcmp(expected, dls[i]->data(), dls[i]->dataSize()));
+	}
+
+	EXPECT_EQ(count, m_server.requests());
+	EXPECT_LE(m_server.connections(), 2U);
+}
+
+/**
+ * HTTP errors should be returned as the HTTP status code.
+ */
+TEST_F(CurlMultiDownloaderTest, httpError)
+{
+	CurlMultiDownloader multi;
+	ASSERT_TRUE(multi.isInit());
+
+	CurlDownloader dl(m_server.url("/missing.png"));
+	ASSERT_EQ(0, multi.add(&dl));
+
+	vector<std::pair<CurlDownloader*, int> > results;
+	runAll(multi, results);
+	ASSERT_EQ(1U, results.size());
+	EXPECT_EQ(404, results[0].second);
+}
+
+/**
+ * perform() should report input on the extra file descriptor.
+ */
+TEST_F(CurlMultiDownloaderTest, extraFd)
+{
+	CurlMultiDownloader multi;
+	ASSERT_TRUE(multi.isInit());
+
+	int fds[2];
+	ASSERT_EQ(0, pipe(fds));
+
+	bool ready = true;
+	EXPECT_EQ(0, multi.perform(fds[0], 10, &ready));
+	EXPECT_FALSE(ready);
+
+	ASSERT_EQ(1, write(fds[1], "x", 1));
+	EXPECT_EQ(0, multi.perform(fds[0], 1000, &ready));
+	EXPECT_TRUE(ready);
+
+	close(fds[0]);
+	close(fds[1]);
+}
+
+/**
+ * Removed transfers should not be returned by takeFinished().
+ */
+TEST_F(CurlMultiDownloaderTest, removeActive)
+{
+	CurlMultiDownloader multi;
+	ASSERT_TRUE(multi.isInit());
+
+	CurlDownloader dl1(m_server.url("/data/keep.png"));
+	CurlDownloader dl2(m_server.url("/data/remove.png"));
+	ASSERT_EQ(0, multi.add(&dl1));
+	ASSERT_EQ(0, multi.add(&dl2));
+	EXPECT_EQ(2U, multi.activeCount());
+
+	EXPECT_EQ(0, multi.remove(&dl2));
+	EXPECT_EQ(1U, multi.activeCount());
+	EXPECT_EQ(-ENOENT, multi.remove(&dl2));
+
+	vector<std::pair<CurlDownloader*, int> > results;
+	runAll(multi, results);
+	ASSERT_EQ(1U, results.size());
+	EXPECT_EQ(&dl1, results[0].first);
+	EXPECT_EQ(0, results[0].second);
+}
+
+/**
+ * Benchmark: Find the first available image from a list of
+ * candidate URLs, e.g. region fallbacks for external images.
+ *
+ * Serial: Download each URL in order until one succeeds.
+ * (Previous behavior of TCreateThumbnail::getExternalImage().)
+ *
+ * Concurrent: Request all URLs at once, wait for them in priority
+ * order, and abort the lower-priority requests once one succeeds.
+ *
+ * Latency can be set using the RP_TEST_HTTP_LATENCY_MS environment variable.
+ */
+TEST_F(CurlMultiDownloaderTest, firstAvailable_benchmark)
+{
+	// Restart the server with simulated latency.
+	unsigned int latency_ms = 50;
+	const char *const s_latency = getenv("RP_TEST_HTTP_LATENCY_MS");
+	if (s_latency && s_latency[0] != '\0') {
+		latency_ms = static_cast<unsigned int>(strtoul(s_latency, nullptr, 10));
+	}
+	m_server.stop();
+	m_server.setLatency(latency_ms);
+	ASSERT_TRUE(m_server.start());
+
+	// Candidate URLs, in priority order.
+	// Only the last one is available.
+	static const char *const paths[] = {
+		"/cover/EN/ABCE.png",
+		"/cover/US/ABCE.png",
+		"/coverM/EN/ABCE.png",
+		"/data/coverM/US/ABCE.png",
+	};
+	static const int expected_idx = 3;
+	static const size_t path_count = sizeof(paths) / sizeof(paths[0]);
+	static const unsigned int iterations = 5;
+
+	typedef std::chrono::steady_clock clock;
+
+	// Serial
+	const clock::time_point serial_start = clock::now();
+	for (unsigned int iter = 0; iter < iterations; iter++) {
+		int found = -1;
+		for (size_t i = 0; i < path_count; i++) {
+			CurlDownloader dl(m_server.url(paths[i]));
+			if (dl.download() == 0) {
+				found = static_cast<int>(i);
+				break;
+			}
+		}
+		ASSERT_EQ(expected_idx, found);
+	}
+	const auto serial_ms = std::chrono::duration_cast<std::chrono::milliseconds>(clock::now() - serial_start).count();
+
+	// Concurrent
+	const clock::time_point concurrent_start = clock::now();
+	for (unsigned int iter = 0; iter < iterations; iter++) {
+		CurlMultiDownloader multi;
+		ASSERT_TRUE(multi.isInit());
+
+		vector<unique_ptr<CurlDownloader> > dls;
+		vector<int> status(path_count, -1);
+		vector<bool> done(path_count, false);
+		for (size_t i = 0; i < path_count; i++) {
+			dls.emplace_back(new CurlDownloader(m_server.url(paths[i])));
+			ASSERT_EQ(0, multi.add(dls.back().get()));
+		}
+
+		int found = -1;
+		size_t next = 0;	// Highest-priority candidate that hasn't failed.
+		for (unsigned int loop = 0; loop < 1000 && found < 0 && next < path_count; loop++) {
+			ASSERT_EQ(0, multi.perform(-1, 100));
+			int ret;
+			CurlDownloader *dl;
+			while ((dl = multi.takeFinished(&ret)) != nullptr) {
+				for (size_t i = 0; i < path_count; i++) {
+					if (dls[i].get() == dl) {
+						status[i] = ret;
+						done[i] = true;
+						break;
+					}
+				}
+			}
+			while (next < path_count && done[next]) {
+				if (status[next] == 0) {
+					found = static_cast<int>(next);
+					break;
+				}
+				next++;
+			}
+		}
+		ASSERT_EQ(expected_idx, found);
+
+		// Abort the lower-priority requests.
+		for (size_t i = found + 1; i < path_count; i++) {
+			if (!done[i]) {
+				multi.remove(dls[i].get());
+			}
+		}
+	}
+	const auto concurrent_ms = std::chrono::duration_cast<std::chrono::milliseconds>(clock::now() - concurrent_start).count();
+
+	printf("Latency: %u ms; %u iterations, %u candidates\n",
+		latency_ms, iterations, static_cast<unsigned int>(path_count));
+	printf("- Serial:     %5u ms\n", static_cast<unsigned int>(serial_ms));
+	printf("- Concurrent: %5u ms\n", static_cast<unsigned int>(concurrent_ms));
+	if (latency_ms > 0) {
+		EXPECT_LT(concurrent_ms, serial_ms);
+	}
+}
+
+} }
+
+/**
+ * Test suite main function.
+ */
+int main(int argc, char *argv[])
+{
+	fprintf(stderr, "rp-download test suite: CurlMultiDownloader tests.\n\n");
+	fflush(nullptr);
+
+	// Don't use a proxy for the local test server.
+	unsetenv("http_proxy");
+	unsetenv("HTTP_PROXY");
+	unsetenv("all_proxy");
+	unsetenv("ALL_PROXY");
+
+	// coverity[fun_call_w_exception]: uncaught exceptions cause nonzero exit anyway, so don't warn.
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
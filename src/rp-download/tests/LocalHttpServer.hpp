@@ -0,0 +1,431 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (rp-download/tests)                *
+ * LocalHttpServer.hpp: Minimal local HTTP server for tests.               *
+ *                                                                         *
+ * Copyright (c) 2016-2022 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#ifndef __ROMPROPERTIES_RP_DOWNLOAD_TESTS_LOCALHTTPSERVER_HPP__
+#define __ROMPROPERTIES_RP_DOWNLOAD_TESTS_LOCALHTTPSERVER_HPP__
+
+// C includes.
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// C includes. (C++ namespace)
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+
+// C++ includes.
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace RpDownload { namespace Tests {
+
+/**
+ * Minimal HTTP/1.1 server with keep-alive support.
+ * Runs on 127.0.0.1 using an ephemeral port.
+ *
+ * - /data/NAME: 200, body is "data:NAME"
+ * - /large/NAME: 200, body is 64 KiB starting with "large:NAME"
+ * - Anything else: 404
+ *
+ * Successful responses include ETag and Last-Modified headers.
+ * Conditional requests (If-None-Match, If-Modified-Since) are
+ * supported, and result in 304 if the file was not modified.
+ * ETags can be changed using setETagPrefix().
+ *
+ * Responses can be delayed to simulate network latency.
+ */
+class LocalHttpServer
+{
+	public:
+		LocalHttpServer()
+			: m_listenFd(-1)
+			, m_port(0)
+			, m_latency(0)
+			, m_etagPrefix("v1")
+			, m_connections(0)
+			, m_requests(0)
+			, m_notModified(0)
+			, m_bytesSent(0)
+			, m_quit(false)
+		{ }
+
+		~LocalHttpServer()
+		{
+			stop();
+		}
+
+		/**
+		 * Start the server.
+		 * @return True on success; false on error.
+		 */
+		bool start(void)
+		{
+			m_listenFd = socket(AF_INET, SOCK_STREAM, 0);
+			if (m_listenFd < 0)
+				return false;
+
+			struct sockaddr_in addr;
+			memset(&addr, 0, sizeof(addr));
+			addr.sin_family = AF_INET;
+			addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+			addr.sin_port = 0;
+			socklen_t addrlen = sizeof(addr);
+			if (bind(m_listenFd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0 ||
+			    listen(m_listenFd, 16) != 0 ||
+			    getsockname(m_listenFd, reinterpret_cast<struct sockaddr*>(&addr), &addrlen) != 0)
+			{
+				close(m_listenFd);
+				m_listenFd = -1;
+				return false;
+			}
+			m_port = ntohs(addr.sin_port);
+
+			m_quit = false;
+			m_thread = std::thread(&LocalHttpServer::run, this);
+			return true;
+		}
+
+		/**
+		 * Set the simulated latency for each response.
+		 * This must be set before calling start().
+		 * @param ms Latency, in milliseconds.
+		 */
+		void setLatency(unsigned int ms)
+		{
+			m_latency = std::chrono::milliseconds(ms);
+		}
+
+		/**
+		 * Set the ETag prefix.
+		 * Changing this simulates modifying all files on the server.
+		 * This must be set before calling start().
+		 * @param prefix ETag prefix.
+		 */
+		void setETagPrefix(const char *prefix)
+		{
+			m_etagPrefix = prefix;
+		}
+
+		/**
+		 * Get the ETag for a path.
+		 * @param path Path, including the leading slash.
+		 * @return ETag, including quotes.
+		 */
+		std::string etag(const std::string &path) const
+		{
+			return '"' + m_etagPrefix + '-' + path.substr(path.rfind('/') + 1) + '"';
+		}
+
+		/**
+		 * Stop the server.
+		 */
+		void stop(void)
+		{
+			m_quit = true;
+			if (m_thread.joinable()) {
+				m_thread.join();
+			}
+			if (m_listenFd >= 0) {
+				close(m_listenFd);
+				m_listenFd = -1;
+			}
+		}
+
+		/**
+		 * Get a URL on this server.
+		 * @param path Path, including the leading slash.
+		 * @return URL.
+		 */
+		std::string url(const char *path) const
+		{
+			char buf[64];
+			snprintf(buf, sizeof(buf), "http://127.0.0.1:%u", m_port);
+			return std::string(buf) + path;
+		}
+
+		/**
+		 * Number of TCP connections accepted.
+		 */
+		unsigned int connections(void) const { return m_connections; }
+
+		/**
+		 * Number of HTTP requests handled.
+		 */
+		unsigned int requests(void) const { return m_requests; }
+
+		/**
+		 * Number of 304 responses sent.
+		 */
+		unsigned int notModified(void) const { return m_notModified; }
+
+		/**
+		 * Number of bytes sent, including headers.
+		 */
+		size_t bytesSent(void) const { return m_bytesSent; }
+
+		/**
+		 * Reset the request and byte counters.
+		 */
+		void resetCounters(void)
+		{
+			m_requests = 0;
+			m_notModified = 0;
+			m_bytesSent = 0;
+		}
+
+	private:
+		typedef std::chrono::steady_clock clock;
+
+		struct Client {
+			int fd;
+			std::string buf;
+		};
+
+		struct PendingResponse {
+			int fd;
+			clock::time_point due;
+			std::string response;
+		};
+
+		/**
+		 * Get a request header.
+		 * @param request Request line and headers.
+		 * @param name Header name. (case-insensitive)
+		 * @return Header value, or empty string if not found.
+		 */
+		static std::string getHeader(const std::string &request, const char *name)
+		{
+			const size_t name_len = strlen(name);
+			size_t pos = request.find("\r\n");
+			while (pos != std::string::npos) {
+				pos += 2;
+				const size_t eol = request.find("\r\n", pos);
+				const std::string line = request.substr(pos, (eol != std::string::npos ? eol - pos : std::string::npos));
+				if (line.size() > name_len && line[name_len] == ':' &&
+				    !strncasecmp(line.c_str(), name, name_len))
+				{
+					size_t val_pos = name_len + 1;
+					while (val_pos < line.size() && line[val_pos] == ' ') {
+						val_pos++;
+					}
+					return line.substr(val_pos);
+				}
+				pos = eol;
+			}
+			return std::string();
+		}
+
+		/**
+		 * Check if a conditional request matches the current file.
+		 * @param request Request line and headers.
+		 * @param etag Current ETag.
+		 * @return True if the file was not modified.
+		 */
+		static bool isNotModified(const std::string &request, const std::string &etag)
+		{
+			// If-None-Match takes precedence over If-Modified-Since.
+			const std::string ifNoneMatch = getHeader(request, "If-None-Match");
+			if (!ifNoneMatch.empty()) {
+				return (ifNoneMatch == etag);
+			}
+
+			const std::string ifModifiedSince = getHeader(request, "If-Modified-Since");
+			if (!ifModifiedSince.empty()) {
+				struct tm tm;
+				memset(&tm, 0, sizeof(tm));
+				if (strptime(ifModifiedSince.c_str(), "%a, %d %b %Y %H:%M:%S GMT", &tm) != nullptr) {
+					return (timegm(&tm) >= LAST_MODIFIED);
+				}
+			}
+
+			return false;
+		}
+
+		/**
+		 * Handle a single request.
+		 * @param fd Client socket.
+		 * @param request Request line and headers.
+		 */
+		void handleRequest(int fd, const std::string &request)
+		{
+			m_requests++;
+
+			// Request line: "GET /path HTTP/1.1"
+			std::string path;
+			const size_t sp1 = request.find(' ');
+			if (sp1 != std::string::npos) {
+				const size_t sp2 = request.find(' ', sp1 + 1);
+				if (sp2 != std::string::npos) {
+					path = request.substr(sp1 + 1, sp2 - sp1 - 1);
+				}
+			}
+
+			std::string body;
+			if (path.compare(0, 6, "/data/") == 0) {
+				body = "data:" + path.substr(6);
+			} else if (path.compare(0, 7, "/large/") == 0) {
+				body = "large:" + path.substr(7);
+				body.resize(64*1024, '.');
+			}
+
+			std::string response;
+			if (!body.empty()) {
+				const std::string etag = this->etag(path);
+				char hdr[256];
+				if (isNotModified(request, etag)) {
+					m_notModified++;
+					snprintf(hdr, sizeof(hdr),
+						"HTTP/1.1 304 Not Modified\r\n"
+						"ETag: %s\r\n"
+						"\r\n", etag.c_str());
+					response = hdr;
+				} else {
+					snprintf(hdr, sizeof(hdr),
+						"HTTP/1.1 200 OK\r\n"
+						"Content-Type: image/png\r\n"
+						"Content-Length: %u\r\n"
+						"Last-Modified: Wed, 15 Nov 1995 04:58:08 GMT\r\n"
+						"ETag: %s\r\n"
+						"\r\n", static_cast<unsigned int>(body.size()), etag.c_str());
+					response = hdr + body;
+				}
+			} else {
+				response = "HTTP/1.1 404 Not Found\r\n"
+					"Content-Length: 0\r\n"
+					"\r\n";
+			}
+
+			PendingResponse pending;
+			pending.fd = fd;
+			pending.due = clock::now() + m_latency;
+			pending.response = std::move(response);
+			m_pending.push_back(std::move(pending));
+		}
+
+		/**
+		 * Send responses that are due.
+		 * @return Time until the next response is due, in milliseconds, or 50 if none are pending.
+		 */
+		int sendPendingResponses(void)
+		{
+			const clock::time_point now = clock::now();
+			while (!m_pending.empty() && m_pending.front().due <= now) {
+				const PendingResponse &pending = m_pending.front();
+				const char *p = pending.response.data();
+				size_t len = pending.response.size();
+				while (len > 0) {
+					ssize_t sz = send(pending.fd, p, len, MSG_NOSIGNAL);
+					if (sz <= 0)
+						break;
+					m_bytesSent += sz;
+					p += sz;
+					len -= sz;
+				}
+				m_pending.pop_front();
+			}
+
+			if (m_pending.empty())
+				return 50;
+			const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(m_pending.front().due - now).count();
+			return (ms < 50 ? static_cast<int>(ms) : 50);
+		}
+
+		/**
+		 * Server thread.
+		 */
+		void run(void)
+		{
+			std::vector<Client> clients;
+			while (!m_quit) {
+				std::vector<struct pollfd> pfds(clients.size() + 1);
+				pfds[0].fd = m_listenFd;
+				pfds[0].events = POLLIN;
+				pfds[0].revents = 0;
+				for (size_t i = 0; i < clients.size(); i++) {
+					pfds[i+1].fd = clients[i].fd;
+					pfds[i+1].events = POLLIN;
+					pfds[i+1].revents = 0;
+				}
+				const int timeout = sendPendingResponses();
+				if (poll(pfds.data(), pfds.size(), timeout) <= 0)
+					continue;
+
+				// Handle client requests first, since new clients
+				// will be added to the end of the vector.
+				for (size_t i = clients.size(); i > 0; i--) {
+					if (!pfds[i].revents)
+						continue;
+
+					Client &client = clients[i-1];
+					char buf[4096];
+					ssize_t sz = recv(client.fd, buf, sizeof(buf), 0);
+					if (sz <= 0) {
+						// Discard pending responses for this client.
+						for (auto iter = m_pending.begin(); iter != m_pending.end(); ) {
+							if (iter->fd == client.fd) {
+								iter = m_pending.erase(iter);
+							} else {
+								++iter;
+							}
+						}
+						close(client.fd);
+						clients.erase(clients.begin() + (i-1));
+						continue;
+					}
+					client.buf.append(buf, sz);
+
+					size_t end;
+					while ((end = client.buf.find("\r\n\r\n")) != std::string::npos) {
+						handleRequest(client.fd, client.buf.substr(0, end));
+						client.buf.erase(0, end + 4);
+					}
+				}
+
+				if (pfds[0].revents) {
+					Client client;
+					client.fd = accept(m_listenFd, nullptr, nullptr);
+					if (client.fd >= 0) {
+						m_connections++;
+						clients.push_back(client);
+					}
+				}
+			}
+
+			for (const Client &client : clients) {
+				close(client.fd);
+			}
+		}
+
+	private:
+		// Last-Modified time for all files.
+		static const time_t LAST_MODIFIED = 816411488;
+
+		int m_listenFd;
+		unsigned int m_port;
+		std::chrono::milliseconds m_latency;
+		std::string m_etagPrefix;
+		std::deque<PendingResponse> m_pending;
+		std::atomic<unsigned int> m_connections;
+		std::atomic<unsigned int> m_requests;
+		std::atomic<unsigned int> m_notModified;
+		std::atomic<size_t> m_bytesSent;
+		std::atomic<bool> m_quit;
+		std::thread m_thread;
+};
+
+} }
+
+#endif /* __ROMPROPERTIES_RP_DOWNLOAD_TESTS_LOCALHTTPSERVER_HPP__ */
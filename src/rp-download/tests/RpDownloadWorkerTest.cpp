@@ -0,0 +1,248 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (rp-download/tests)                *
+ * RpDownloadWorkerTest.cpp: libromdata RpDownloadWorker client test.      *
+ *                                                                         *
+ * Copyright (c) 2016-2022 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+
+// librpbase
+#include "common.h"
+
+// libromdata
+#include "libromdata/img/RpDownloadWorker.hpp"
+using LibRomData::RpDownloadWorker;
+
+// rp-download
+#include "LocalHttpServer.hpp"
+
+// OS-specific includes.
+#include <ftw.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// C includes. (C++ namespace)
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+
+// C++ includes.
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+namespace RpDownload { namespace Tests {
+
+class RpDownloadWorkerTest : public ::testing::Test
+{
+	protected:
+		void SetUp(void) override
+		{
+			// Temporary home directory for the cache.
+			// RpDownloadWorker only passes HOME to rp-download.
+			char tmpl[] = "/tmp/rp-download-RpDownloadWorkerTest.XXXXXX";
+			ASSERT_NE(nullptr, mkdtemp(tmpl));
+			m_home = tmpl;
+			ASSERT_EQ(0, mkdir((m_home + "/.cache").c_str(), 0700));
+			setenv("HOME", m_home.c_str(), 1);
+		}
+
+		void TearDown(void) override
+		{
+			// Stop the worker before the server.
+			m_worker.reset();
+			m_server.stop();
+			if (!m_home.empty()) {
+				nftw(m_home.c_str(), removeCallback, 16, FTW_DEPTH | FTW_PHYS);
+			}
+		}
+
+		/**
+		 * nftw() callback to remove the temporary home directory.
+		 */
+		static int removeCallback(const char *fpath, const struct stat *sb, int typeflag, struct FTW *ftwbuf)
+		{
+			RP_UNUSED(sb);
+			RP_UNUSED(typeflag);
+			RP_UNUSED(ftwbuf);
+			remove(fpath);
+			return 0;
+		}
+
+		/**
+		 * Start the local HTTP server and create the worker client.
+		 * NOTE: The server latency must be set before calling this function.
+		 * @param idle_timeout Worker idle timeout, in seconds.
+		 */
+		void createWorker(int idle_timeout = 30)
+		{
+			ASSERT_TRUE(m_server.start());
+
+			const string base_url = "--base-url=" + m_server.url("/data");
+			char s_idle_timeout[32];
+			snprintf(s_idle_timeout, sizeof(s_idle_timeout), "--idle-timeout=%d", idle_timeout);
+			const char *const args[] = {base_url.c_str(), s_idle_timeout, nullptr};
+			m_worker.reset(new RpDownloadWorker(RP_DOWNLOAD_EXE, args));
+		}
+
+		/**
+		 * Check if a cache file exists.
+		 * @param cache_key Cache key.
+		 * @return True if the file exists; false if not.
+		 */
+		bool cacheFileExists(const char *cache_key) const
+		{
+			const string filename = m_home + "/.cache/rom-properties/" + cache_key;
+			return (access(filename.c_str(), F_OK) == 0);
+		}
+
+		LocalHttpServer m_server;
+		unique_ptr<RpDownloadWorker> m_worker;
+		string m_home;
+};
+
+/**
+ * Download a file using the worker.
+ */
+TEST_F(RpDownloadWorkerTest, download)
+{
+	createWorker();
+
+	EXPECT_EQ(0, m_worker->download("gba/title/TEST1.png", string()));
+	EXPECT_TRUE(cacheFileExists("gba/title/TEST1.png"));
+
+	// Invalid cache keys are rejected by the worker.
+	EXPECT_EQ(-EINVAL, m_worker->download("invalid_cache_key", string()));
+	// Newlines are rejected by the client.
+	EXPECT_EQ(-EINVAL, m_worker->download("gba/title/A.png\n1 gba/title/B.png", string()));
+}
+
+/**
+ * Multiple threads waiting on the same worker.
+ * Only one thread reads from the worker at a time; the others
+ * must still receive their responses without blocking each other.
+ */
+TEST_F(RpDownloadWorkerTest, concurrentWaits)
+{
+	static const unsigned int THREAD_COUNT = 4;
+	m_server.setLatency(300);
+	createWorker();
+
+	int results[THREAD_COUNT];
+	vector<std::thread> threads;
+	const auto start = std::chrono::steady_clock::now();
+	for (unsigned int i = 0; i < THREAD_COUNT; i++) {
+		results[i] = -1;
+		threads.emplace_back([this, i, &results]() {
+			char cache_key[32];
+			snprintf(cache_key, sizeof(cache_key), "gba/title/THREAD%u.png", i);
+			results[i] = m_worker->download(cache_key, string());
+		});
+	}
+	for (std::thread &thread : threads) {
+		thread.join();
+	}
+	const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+		std::chrono::steady_clock::now() - start).count();
+
+	for (unsigned int i = 0; i < THREAD_COUNT; i++) {
+		EXPECT_EQ(0, results[i]) << "thread " << i;
+	}
+
+	// The downloads are concurrent, so this shouldn't take
+	// anywhere near THREAD_COUNT * latency.
+	EXPECT_LT(elapsed, 300 * static_cast<long>(THREAD_COUNT));
+}
+
+/**
+ * A request that times out can be canceled.
+ * The worker aborts the download and doesn't cache it.
+ */
+TEST_F(RpDownloadWorkerTest, timeoutCancel)
+{
+	m_server.setLatency(3000);
+	createWorker();
+
+	RpDownloadWorker::Ticket ticket;
+	ASSERT_EQ(0, m_worker->submit("gba/title/SLOW.png", string(), &ticket));
+	EXPECT_EQ(-ETIMEDOUT, m_worker->wait(ticket, time(nullptr) + 1));
+	m_worker->cancel(ticket);
+
+	// The incomplete cache file is deleted once the worker
+	// processes the cancellation.
+	bool exists = true;
+	for (unsigned int i = 0; i < 20 && exists; i++) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+		exists = cacheFileExists("gba/title/SLOW.png");
+	}
+	EXPECT_FALSE(exists);
+}
+
+/**
+ * The worker is restarted if it exits due to its idle timeout.
+ */
+TEST_F(RpDownloadWorkerTest, restartAfterIdleExit)
+{
+	createWorker(1);
+
+	EXPECT_EQ(0, m_worker->download("gba/title/RESTART1.png", string()));
+	EXPECT_EQ(1U, m_server.connections());
+
+	// Wait for the worker to exit.
+	std::this_thread::sleep_for(std::chrono::milliseconds(3000));
+
+	// The new worker process can't reuse the previous connection.
+	EXPECT_EQ(0, m_worker->download("gba/title/RESTART2.png", string()));
+	EXPECT_EQ(2U, m_server.connections());
+	EXPECT_TRUE(cacheFileExists("gba/title/RESTART2.png"));
+}
+
+/**
+ * -ECHILD is returned if rp-download can't be started,
+ * so the caller can fall back to running rp-download directly.
+ */
+TEST_F(RpDownloadWorkerTest, missingExecutable)
+{
+	RpDownloadWorker worker("/nonexistent/rp-download");
+	EXPECT_EQ(-ECHILD, worker.download("gba/title/TEST1.png", string()));
+}
+
+/**
+ * -ECHILD is returned if rp-download exits without responding.
+ */
+TEST_F(RpDownloadWorkerTest, workerExits)
+{
+	RpDownloadWorker worker("/bin/false");
+	EXPECT_EQ(-ECHILD, worker.download("gba/title/TEST1.png", string()));
+}
+
+} }
+
+/**
+ * Test suite main function.
+ */
+int main(int argc, char *argv[])
+{
+	fprintf(stderr, "rp-download test suite: RpDownloadWorker tests.\n\n");
+	fflush(nullptr);
+
+	// Don't use a proxy for the local test server.
+	unsetenv("http_proxy");
+	unsetenv("HTTP_PROXY");
+	unsetenv("https_proxy");
+	unsetenv("all_proxy");
+	unsetenv("ALL_PROXY");
+
+	// coverity[fun_call_w_exception]: uncaught exceptions cause nonzero exit anyway, so don't warn.
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
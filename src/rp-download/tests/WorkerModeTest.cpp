@@ -0,0 +1,413 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (rp-download/tests)                *
+ * WorkerModeTest.cpp: rp-download worker mode test. (rp-download -w)      *
+ *                                                                         *
+ * Copyright (c) 2016-2022 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+
+// librpbase
+#include "common.h"
+
+// rp-download
+#include "LocalHttpServer.hpp"
+
+// OS-specific includes.
+#include <ftw.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// C includes. (C++ namespace)
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+
+// C++ includes.
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+using std::string;
+using std::vector;
+
+namespace RpDownload { namespace Tests {
+
+class WorkerModeTest : public ::testing::Test
+{
+	protected:
+		WorkerModeTest()
+			: m_pid(-1)
+			, m_fd(-1)
+		{ }
+
+		void SetUp(void) override
+		{
+			// Temporary home directory for the cache.
+			char tmpl[] = "/tmp/rp-download-WorkerModeTest.XXXXXX";
+			ASSERT_NE(nullptr, mkdtemp(tmpl));
+			m_home = tmpl;
+			ASSERT_EQ(0, mkdir((m_home + "/.cache").c_str(), 0700));
+		}
+
+		void TearDown(void) override
+		{
+			stopWorker();
+			m_server.stop();
+			if (!m_home.empty()) {
+				nftw(m_home.c_str(), removeCallback, 16, FTW_DEPTH | FTW_PHYS);
+			}
+		}
+
+		/**
+		 * nftw() callback to remove the temporary home directory.
+		 */
+		static int removeCallback(const char *fpath, const struct stat *sb, int typeflag, struct FTW *ftwbuf)
+		{
+			RP_UNUSED(sb);
+			RP_UNUSED(typeflag);
+			RP_UNUSED(ftwbuf);
+			remove(fpath);
+			return 0;
+		}
+
+		/**
+		 * Start the local HTTP server and rp-download in worker mode.
+		 * NOTE: The server latency must be set before calling this function.
+		 * @param base_path Server path to use as the base URL.
+		 * @param idle_timeout Idle timeout, in seconds.
+		 */
+		void startWorker(const char *base_path, int idle_timeout = 30)
+		{
+			ASSERT_TRUE(m_server.start());
+
+			int sv[2];
+			ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sv));
+
+			const string base_url = "--base-url=" + m_server.url(base_path);
+			char s_idle_timeout[32];
+			snprintf(s_idle_timeout, sizeof(s_idle_timeout), "--idle-timeout=%d", idle_timeout);
+			const char *const argv[] = {
+				RP_DOWNLOAD_EXE, "-w", base_url.c_str(), s_idle_timeout, nullptr
+			};
+			const string s_home = "HOME=" + m_home;
+			const char *const envp[] = {s_home.c_str(), nullptr};
+
+			m_pid = fork();
+			ASSERT_NE(-1, m_pid);
+			if (m_pid == 0) {
+				// Child process.
+				if (dup2(sv[1], STDIN_FILENO) < 0 || dup2(sv[1], STDOUT_FILENO) < 0) {
+					_exit(EXIT_FAILURE);
+				}
+				execve(argv[0], (char *const *)argv, (char *const *)envp);
+				_exit(EXIT_FAILURE);
+			}
+
+			close(sv[1]);
+			m_fd = sv[0];
+		}
+
+		/**
+		 * Stop the worker.
+		 * @return Worker exit status, or -1 if it didn't exit normally.
+		 */
+		int stopWorker(void)
+		{
+			if (m_fd >= 0) {
+				close(m_fd);
+				m_fd = -1;
+			}
+			if (m_pid <= 0) {
+				return -1;
+			}
+
+			// The worker exits on EOF once all requests are finished.
+			int wstatus = 0;
+			pid_t wpid = 0;
+			for (unsigned int i = 0; i < 50 && wpid == 0; i++) {
+				wpid = waitpid(m_pid, &wstatus, WNOHANG);
+				if (wpid == 0) {
+					std::this_thread::sleep_for(std::chrono::milliseconds(100));
+				}
+			}
+			if (wpid == 0) {
+				kill(m_pid, SIGKILL);
+				waitpid(m_pid, &wstatus, 0);
+			}
+			m_pid = -1;
+			return (WIFEXITED(wstatus) ? WEXITSTATUS(wstatus) : -1);
+		}
+
+		/**
+		 * Send a line to the worker.
+		 * @param line Line, without the trailing newline.
+		 */
+		void sendLine(const string &line)
+		{
+			const string buf = line + '\n';
+			ASSERT_EQ(static_cast<ssize_t>(buf.size()),
+				send(m_fd, buf.data(), buf.size(), MSG_NOSIGNAL));
+		}
+
+		/**
+		 * Read a line from the worker.
+		 * @param timeout_ms Timeout, in milliseconds.
+		 * @return Line, without the trailing newline, or empty string on timeout or EOF.
+		 */
+		string readLine(int timeout_ms = 10000)
+		{
+			const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+			size_t nl_pos;
+			while ((nl_pos = m_linebuf.find('\n')) == string::npos) {
+				const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+					deadline - std::chrono::steady_clock::now()).count();
+				if (remaining <= 0)
+					return string();
+
+				struct pollfd pfd = {m_fd, POLLIN, 0};
+				if (poll(&pfd, 1, static_cast<int>(remaining)) <= 0)
+					continue;
+
+				char buf[256];
+				ssize_t sz = recv(m_fd, buf, sizeof(buf), 0);
+				if (sz <= 0)
+					return string();
+				m_linebuf.append(buf, sz);
+			}
+
+			const string line = m_linebuf.substr(0, nl_pos);
+			m_linebuf.erase(0, nl_pos + 1);
+			return line;
+		}
+
+		/**
+		 * Read the contents of a cached file.
+		 * @param cache_key Cache key.
+		 * @param pData Contents.
+		 * @return True if the file exists; false if not.
+		 */
+		bool readCacheFile(const char *cache_key, string *pData) const
+		{
+			const string filename = m_home + "/.cache/rom-properties/" + cache_key;
+			FILE *f = fopen(filename.c_str(), "rb");
+			if (!f)
+				return false;
+
+			char buf[256];
+			size_t sz;
+			pData->clear();
+			while ((sz = fread(buf, 1, sizeof(buf), f)) > 0) {
+				pData->append(buf, sz);
+			}
+			fclose(f);
+			return true;
+		}
+
+		LocalHttpServer m_server;
+		string m_home;
+		pid_t m_pid;
+		int m_fd;
+		string m_linebuf;
+};
+
+/**
+ * A request is answered with "<id> 0" once the file is cached.
+ * Requests for files that are already cached don't hit the server.
+ */
+TEST_F(WorkerModeTest, download)
+{
+	startWorker("/data");
+
+	sendLine("1 gba/title/TEST1.png");
+	EXPECT_EQ("1 0", readLine());
+
+	string data;
+	ASSERT_TRUE(readCacheFile("gba/title/TEST1.png", &data));
+	EXPECT_EQ("data:gba/title/TEST1.png", data);
+	EXPECT_EQ(1U, m_server.requests());
+
+	// IDs are chosen by the client.
+	sendLine("abc gba/title/TEST1.png");
+	EXPECT_EQ("abc 0", readLine());
+	EXPECT_EQ(1U, m_server.requests());
+
+	EXPECT_EQ(0, stopWorker());
+}
+
+/**
+ * "<id> -f <cache_key>" revalidates a cached file.
+ * If it wasn't modified, the file's mtime is updated.
+ */
+TEST_F(WorkerModeTest, revalidate)
+{
+	startWorker("/data");
+
+	sendLine("1 gba/title/REVAL.png");
+	EXPECT_EQ("1 0", readLine());
+
+	// The file's mtime is the server's Last-Modified time.
+	const string filename = m_home + "/.cache/rom-properties/gba/title/REVAL.png";
+	struct stat st;
+	ASSERT_EQ(0, stat(filename.c_str(), &st));
+	const time_t now = time(nullptr);
+	EXPECT_LT(st.st_mtime, now - 86400);
+
+	sendLine("2 -f gba/title/REVAL.png");
+	EXPECT_EQ("2 0", readLine());
+	EXPECT_EQ(2U, m_server.requests());
+	EXPECT_EQ(1U, m_server.notModified());
+
+	// The file was kept, and its mtime was updated.
+	string data;
+	ASSERT_TRUE(readCacheFile("gba/title/REVAL.png", &data));
+	EXPECT_EQ("data:gba/title/REVAL.png", data);
+	ASSERT_EQ(0, stat(filename.c_str(), &st));
+	EXPECT_GE(st.st_mtime, now);
+
+	// Other requests aren't affected.
+	sendLine("3 gba/title/REVAL.png");
+	EXPECT_EQ("3 0", readLine());
+	EXPECT_EQ(2U, m_server.requests());
+
+	EXPECT_EQ(0, stopWorker());
+}
+
+/**
+ * Errors are returned as HTTP status codes or negative POSIX error codes.
+ */
+TEST_F(WorkerModeTest, errors)
+{
+	startWorker("/missing");
+
+	sendLine("1 gba/title/TEST1.png");
+	EXPECT_EQ("1 404", readLine());
+
+	char expected[32];
+	snprintf(expected, sizeof(expected), "2 %d", -EINVAL);
+	sendLine("2 invalid_cache_key");
+	EXPECT_EQ(expected, readLine());
+
+	EXPECT_EQ(0, stopWorker());
+}
+
+/**
+ * Duplicate cache keys are only downloaded once,
+ * but each request gets its own response.
+ */
+TEST_F(WorkerModeTest, duplicateKeys)
+{
+	m_server.setLatency(300);
+	startWorker("/data");
+
+	sendLine("1 gba/title/DUP.png");
+	sendLine("2 gba/title/DUP.png");
+	sendLine("3 gba/title/DUP.png");
+
+	vector<string> lines;
+	for (unsigned int i = 0; i < 3; i++) {
+		lines.push_back(readLine());
+	}
+	std::sort(lines.begin(), lines.end());
+	EXPECT_EQ("1 0", lines[0]);
+	EXPECT_EQ("2 0", lines[1]);
+	EXPECT_EQ("3 0", lines[2]);
+	EXPECT_EQ(1U, m_server.requests());
+
+	EXPECT_EQ(0, stopWorker());
+}
+
+/**
+ * "!<id>" cancels a request. If it was the only request for
+ * its cache key, the download is aborted and not cached.
+ */
+TEST_F(WorkerModeTest, cancel)
+{
+	m_server.setLatency(2000);
+	startWorker("/data");
+
+	sendLine("1 gba/title/CANCEL.png");
+	std::this_thread::sleep_for(std::chrono::milliseconds(200));
+	sendLine("!1");
+
+	char expected[32];
+	snprintf(expected, sizeof(expected), "1 %d", -ECANCELED);
+	EXPECT_EQ(expected, readLine(1000));
+
+	string data;
+	EXPECT_FALSE(readCacheFile("gba/title/CANCEL.png", &data));
+
+	// Canceling an unknown request does nothing.
+	sendLine("!999");
+	EXPECT_EQ("", readLine(200));
+}
+
+/**
+ * Canceling one of several requests for the same cache key
+ * doesn't abort the download for the other requests.
+ */
+TEST_F(WorkerModeTest, cancelDuplicate)
+{
+	m_server.setLatency(500);
+	startWorker("/data");
+
+	sendLine("1 gba/title/DUP.png");
+	sendLine("2 gba/title/DUP.png");
+	sendLine("!1");
+
+	char expected[32];
+	snprintf(expected, sizeof(expected), "1 %d", -ECANCELED);
+	EXPECT_EQ(expected, readLine());
+	EXPECT_EQ("2 0", readLine());
+
+	string data;
+	EXPECT_TRUE(readCacheFile("gba/title/DUP.png", &data));
+}
+
+/**
+ * The worker exits if no requests are received within the idle timeout.
+ */
+TEST_F(WorkerModeTest, idleExit)
+{
+	startWorker("/data", 1);
+
+	sendLine("1 gba/title/IDLE.png");
+	EXPECT_EQ("1 0", readLine());
+
+	// The worker closes its end of the socket when it exits.
+	EXPECT_EQ("", readLine(5000));
+	char buf[16];
+	EXPECT_EQ(0, recv(m_fd, buf, sizeof(buf), MSG_DONTWAIT));
+
+	EXPECT_EQ(0, stopWorker());
+}
+
+} }
+
+/**
+ * Test suite main function.
+ */
+int main(int argc, char *argv[])
+{
+	fprintf(stderr, "rp-download test suite: Worker mode tests.\n\n");
+	fflush(nullptr);
+
+	// Don't use a proxy for the local test server.
+	unsetenv("http_proxy");
+	unsetenv("HTTP_PROXY");
+	unsetenv("all_proxy");
+	unsetenv("ALL_PROXY");
+
+	// coverity[fun_call_w_exception]: uncaught exceptions cause nonzero exit anyway, so don't warn.
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
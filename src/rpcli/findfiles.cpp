@@ -0,0 +1,69 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (rpcli)                            *
+ * findfiles.cpp: Recursive directory scanning.                            *
+ *                                                                         *
+ * Copyright (c) 2016-2022 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "stdafx.h"
+#include "findfiles.hpp"
+
+// librpbase
+#include "librpbase/TextFuncs.hpp"
+#include "libi18n/i18n.h"
+using namespace LibRpBase;
+
+// C includes.
+#include <dirent.h>
+#include <sys/stat.h>
+
+// C includes. (C++ namespace)
+#include <cerrno>
+
+// C++ includes.
+#include <iostream>
+using std::cerr;
+using std::endl;
+using std::string;
+using std::vector;
+
+/**
+ * Recursively find all regular files in a directory.
+ * Hidden files and directories are skipped.
+ * Symlinks are not followed.
+ * @param path		[in] Directory.
+ * @param files		[out] Files.
+ */
+void findFiles(const string &path, vector<FoundFile> &files)
+{
+	DIR *const pdir = opendir(path.c_str());
+	if (!pdir) {
+		cerr << "-- " << rp_sprintf_p(C_("rpcli", "Couldn't open directory '%1$s': %2$s"),
+			path.c_str(), strerror(errno)) << endl;
+		return;
+	}
+
+	const struct dirent *dirent;
+	while ((dirent = readdir(pdir)) != nullptr) {
+		if (dirent->d_name[0] == '.') {
+			// Skip ".", "..", and hidden files.
+			continue;
+		}
+
+		string fullpath = path;
+		fullpath += '/';
+		fullpath += dirent->d_name;
+
+		struct stat sb;
+		if (lstat(fullpath.c_str(), &sb) != 0)
+			continue;
+
+		if (S_ISDIR(sb.st_mode)) {
+			findFiles(fullpath, files);
+		} else if (S_ISREG(sb.st_mode)) {
+			files.emplace_back(fullpath, sb.st_size, sb.st_mtime);
+		}
+	}
+	closedir(pdir);
+}
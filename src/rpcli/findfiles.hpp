@@ -0,0 +1,45 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (rpcli)                            *
+ * findfiles.hpp: Recursive directory scanning.                            *
+ *                                                                         *
+ * Copyright (c) 2016-2022 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#ifndef __ROMPROPERTIES_RPCLI_FINDFILES_HPP__
+#define __ROMPROPERTIES_RPCLI_FINDFILES_HPP__
+
+#ifdef _WIN32
+#  error findfiles is not currently implemented on Windows.
+#endif
+
+// C includes.
+#include <sys/types.h>
+#include <time.h>
+
+// C++ includes.
+#include <string>
+#include <vector>
+
+/**
+ * File found by findFiles().
+ */
+struct FoundFile {
+	std::string filename;
+	off64_t size;
+	time_t mtime;
+
+	FoundFile(const std::string &filename, off64_t size, time_t mtime)
+		: filename(filename), size(size), mtime(mtime) { }
+};
+
+/**
+ * Recursively find all regular files in a directory.
+ * Hidden files and directories are skipped.
+ * Symlinks are not followed.
+ * @param path		[in] Directory.
+ * @param files		[out] Files.
+ */
+void findFiles(const std::string &path, std::vector<FoundFile> &files);
+
+#endif /* __ROMPROPERTIES_RPCLI_FINDFILES_HPP__ */
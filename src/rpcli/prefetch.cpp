@@ -0,0 +1,308 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (rpcli)                            *
+ * prefetch.cpp: External image prefetching.                               *
+ *                                                                         *
+ * Copyright (c) 2016-2022 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "stdafx.h"
+#include "config.rpcli.h"
+#include "prefetch.hpp"
+#include "prefetchkeys.hpp"
+#include "findfiles.hpp"
+#include "rpcli_secure.h"
+
+#ifndef RPCLI_PREFETCH_SUPPORTED
+#error This file should only be compiled if external image prefetching is supported.
+#endif
+
+// librpbase, librpfile
+#include "librpbase/RomData.hpp"
+#include "librpbase/TextFuncs.hpp"
+#include "librpfile/RpFile.hpp"
+#include "libi18n/i18n.h"
+using namespace LibRpBase;
+using namespace LibRpFile;
+
+// libromdata
+#include "libromdata/RomDataFactory.hpp"
+#include "libromdata/img/CacheManager.hpp"
+using LibRomData::CacheManager;
+using LibRomData::RomDataFactory;
+
+// C includes.
+#include <sys/wait.h>
+#include <unistd.h>
+
+// C includes. (C++ namespace)
+#include <cerrno>
+
+// C++ includes.
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+using std::vector;
+
+// Default number of concurrent downloads.
+// This matches CacheManager's limit on simultaneous downloads.
+static const int PREFETCH_DEFAULT_THREADS = 8;
+
+/**
+ * Get the external image cache keys for a file.
+ * All external image types and sizes are included.
+ * @param filename	[in] Filename.
+ * @param cache_keys	[out] Cache keys.
+ * @return True if the file is supported; false if not.
+ */
+static bool getExtImageCacheKeys(const string &filename, vector<string> &cache_keys)
+{
+	RpFile *const file = new RpFile(filename, RpFile::FM_OPEN_READ_GZ);
+	if (!file->isOpen()) {
+		file->unref();
+		return false;
+	}
+	RomData *const romData = RomDataFactory::create(file, RomDataFactory::RDA_HAS_THUMBNAIL);
+	file->unref();	// file is ref()'d by RomData.
+	if (!romData) {
+		return false;
+	}
+
+	const uint32_t imgbf = romData->supportedImageTypes();
+	vector<RomData::ExtURL> extURLs;
+	for (int i = RomData::IMG_EXT_MIN; i <= RomData::IMG_EXT_MAX; i++) {
+		if (!(imgbf & (1U << i)))
+			continue;
+
+		const RomData::ImageType imageType = static_cast<RomData::ImageType>(i);
+		vector<int> sizes;
+		for (const RomData::ImageSizeDef &sizeDef : romData->supportedImageSizes(imageType)) {
+			sizes.push_back(std::max(sizeDef.width, sizeDef.height));
+		}
+		if (sizes.empty()) {
+			sizes.push_back(RomData::IMAGE_SIZE_DEFAULT);
+		}
+
+		for (const int size : sizes) {
+			extURLs.clear();
+			if (romData->extURLs(imageType, &extURLs, size) != 0)
+				continue;
+			for (const RomData::ExtURL &extURL : extURLs) {
+				// NOTE: Cache keys are sent to the parent process
+				// one per line, so they can't contain newlines.
+				if (!extURL.cache_key.empty() &&
+				    extURL.cache_key.find('\n') == string::npos)
+				{
+					cache_keys.push_back(extURL.cache_key);
+				}
+			}
+		}
+	}
+
+	romData->unref();
+	return true;
+}
+
+/**
+ * Write a string to a file descriptor.
+ * @param fd	[in] File descriptor.
+ * @param buf	[in] String.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+static int writeAll(int fd, const string &buf)
+{
+	const char *p = buf.data();
+	size_t len = buf.size();
+	while (len > 0) {
+		const ssize_t sz = write(fd, p, len);
+		if (sz < 0) {
+			if (errno == EINTR)
+				continue;
+			return -errno;
+		}
+		p += sz;
+		len -= sz;
+	}
+	return 0;
+}
+
+/**
+ * Scan a directory for external image cache keys.
+ * This runs in the sandboxed child process.
+ * @param path		[in] Directory to scan.
+ * @param fd		[in] Pipe to write the cache keys to, one per line.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+static int scanDirectory(const string &path, int fd)
+{
+	cerr << "== " << rp_sprintf(C_("rpcli", "Scanning directory '%s'..."), path.c_str()) << endl;
+	vector<FoundFile> files;
+	findFiles(path, files);
+
+	unsigned int supported = 0;
+	size_t key_count = 0;
+	string buf;
+	for (const FoundFile &ff : files) {
+		vector<string> cache_keys;
+		if (!getExtImageCacheKeys(ff.filename, cache_keys))
+			continue;
+		supported++;
+		key_count += cache_keys.size();
+
+		for (const string &cache_key : cache_keys) {
+			buf += cache_key;
+			buf += '\n';
+		}
+
+		// Write the cache keys in blocks.
+		if (buf.size() >= 4096) {
+			const int ret = writeAll(fd, buf);
+			if (ret != 0)
+				return ret;
+			buf.clear();
+		}
+	}
+
+	const int ret = writeAll(fd, buf);
+	if (ret != 0)
+		return ret;
+
+	cerr << "-- " << rp_sprintf_p(C_("rpcli", "Found %1$u external image(s) in %2$u supported file(s) (%3$u file(s) scanned)"),
+		static_cast<unsigned int>(key_count), supported, static_cast<unsigned int>(files.size())) << endl;
+	return 0;
+}
+
+/**
+ * Prefetch function for PrefetchCacheKeys().
+ * @param cache_key	[in] Cache key.
+ * @param userdata	[in] Unused.
+ * @return PrefetchResult
+ */
+static PrefetchResult prefetchCacheKey(const string &cache_key, void *userdata)
+{
+	RP_UNUSED(userdata);
+
+	CacheManager cache;
+	IRpFile *file = cache.findInCache(cache_key);
+	if (file) {
+		file->unref();
+		return PrefetchResult::Cached;
+	}
+
+	file = cache.download(cache_key);
+	if (file) {
+		file->unref();
+		return PrefetchResult::New;
+	}
+	return PrefetchResult::Failed;
+}
+
+/**
+ * Prefetch external images for all files in a directory tree.
+ *
+ * The directory is scanned by a child process with rpcli's security
+ * options enabled. It collects the cache keys for all external image
+ * types and sizes of each supported file. The parent process then
+ * downloads the cache keys using CacheManager.
+ *
+ * NOTE: This must be called *before* rpcli_do_security_options(),
+ * since rp-download can't be executed by a sandboxed process.
+ *
+ * NOTE: Files that aren't available on the server are counted as
+ * failed downloads. This is expected for region fallbacks, so they
+ * aren't treated as errors.
+ *
+ * @param path		[in] Directory to scan.
+ * @param threads	[in] Number of concurrent downloads. (0 for the default)
+ * @return 0 on success; non-zero on error.
+ */
+int PrefetchExtImages(const char *path, int threads)
+{
+	if (!path || path[0] == '\0') {
+		cerr << "-- " << C_("rpcli", "No directory specified for external image prefetching") << endl;
+		return -EINVAL;
+	}
+	if (threads <= 0) {
+		threads = PREFETCH_DEFAULT_THREADS;
+	}
+
+	// ROM images are only parsed by the child process,
+	// which has the usual rpcli security options enabled.
+	int pipefd[2];
+	if (pipe(pipefd) != 0) {
+		const int err = errno;
+		cerr << "-- " << rp_sprintf(C_("rpcli", "Couldn't create a pipe: %s"), strerror(err)) << endl;
+		return -err;
+	}
+
+	cout.flush();
+	cerr.flush();
+	const pid_t pid = fork();
+	if (pid < 0) {
+		const int err = errno;
+		cerr << "-- " << rp_sprintf(C_("rpcli", "Couldn't create a child process: %s"), strerror(err)) << endl;
+		close(pipefd[0]);
+		close(pipefd[1]);
+		return -err;
+	} else if (pid == 0) {
+		// Child process.
+		close(pipefd[0]);
+		rpcli_do_security_options();
+		const int ret = scanDirectory(path, pipefd[1]);
+		close(pipefd[1]);
+		cerr.flush();
+		_exit(ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+	}
+
+	// Parent process: Read the cache keys.
+	close(pipefd[1]);
+	vector<string> cache_keys;
+	string line;
+	char buf[4096];
+	for (;;) {
+		const ssize_t sz = read(pipefd[0], buf, sizeof(buf));
+		if (sz < 0) {
+			if (errno == EINTR)
+				continue;
+			break;
+		} else if (sz == 0) {
+			break;
+		}
+
+		for (const char *p = buf; p < &buf[sz]; p++) {
+			if (*p == '\n') {
+				cache_keys.push_back(std::move(line));
+				line.clear();
+			} else {
+				line += *p;
+			}
+		}
+	}
+	close(pipefd[0]);
+
+	int status = 0;
+	while (waitpid(pid, &status, 0) < 0 && errno == EINTR) { }
+	if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+		cerr << "-- " << rp_sprintf(C_("rpcli", "Couldn't scan directory '%s'"), path) << endl;
+		return -EIO;
+	}
+
+	cerr << "== " << rp_sprintf(C_("rpcli", "Downloading external images using %d connection(s)..."), threads) << endl;
+	const auto start = std::chrono::steady_clock::now();
+
+	PrefetchStats stats;
+	PrefetchCacheKeys(cache_keys, threads, prefetchCacheKey, nullptr, stats);
+
+	const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	cout << rp_sprintf_p(C_("rpcli", "Processed %1$u external image(s) in %2$.2f s (%3$u duplicate(s) skipped)"),
+		stats.keys, elapsed.count(), stats.duplicates) << '\n';
+	cout << "  " << rp_sprintf(C_("rpcli", "New:    %u"), stats.results[static_cast<size_t>(PrefetchResult::New)]) << '\n';
+	cout << "  " << rp_sprintf(C_("rpcli", "Cached: %u"), stats.results[static_cast<size_t>(PrefetchResult::Cached)]) << '\n';
+	cout << "  " << rp_sprintf(C_("rpcli", "Failed: %u"), stats.results[static_cast<size_t>(PrefetchResult::Failed)]) << endl;
+	return 0;
+}
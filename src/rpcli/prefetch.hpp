@@ -0,0 +1,43 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (rpcli)                            *
+ * prefetch.hpp: External image prefetching.                               *
+ *                                                                         *
+ * Copyright (c) 2016-2022 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#ifndef __ROMPROPERTIES_RPCLI_PREFETCH_HPP__
+#define __ROMPROPERTIES_RPCLI_PREFETCH_HPP__
+
+// NOTE: Prefetching uses fork() to scan the directory
+// in a sandboxed child process.
+#ifndef _WIN32
+#  define RPCLI_PREFETCH_SUPPORTED 1
+#endif
+
+#ifdef RPCLI_PREFETCH_SUPPORTED
+
+/**
+ * Prefetch external images for all files in a directory tree.
+ *
+ * The directory is scanned by a child process with rpcli's security
+ * options enabled. It collects the cache keys for all external image
+ * types and sizes of each supported file. The parent process then
+ * downloads the cache keys using CacheManager.
+ *
+ * NOTE: This must be called *before* rpcli_do_security_options(),
+ * since rp-download can't be executed by a sandboxed process.
+ *
+ * NOTE: Files that aren't available on the server are counted as
+ * failed downloads. This is expected for region fallbacks, so they
+ * aren't treated as errors.
+ *
+ * @param path		[in] Directory to scan.
+ * @param threads	[in] Number of concurrent downloads. (0 for the default)
+ * @return 0 on success; non-zero on error.
+ */
+int PrefetchExtImages(const char *path, int threads);
+
+#endif /* RPCLI_PREFETCH_SUPPORTED */
+
+#endif /* __ROMPROPERTIES_RPCLI_PREFETCH_HPP__ */
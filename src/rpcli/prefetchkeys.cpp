@@ -0,0 +1,81 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (rpcli)                            *
+ * prefetchkeys.cpp: Concurrent cache key prefetching.                     *
+ *                                                                         *
+ * Copyright (c) 2016-2022 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "stdafx.h"
+#include "prefetchkeys.hpp"
+
+// C includes.
+#ifdef _OPENMP
+#  include <omp.h>
+#endif /* _OPENMP */
+
+// C includes. (C++ namespace)
+#include <cassert>
+#include <cstring>
+
+// C++ includes.
+#include <unordered_set>
+using std::string;
+using std::unordered_set;
+using std::vector;
+
+/**
+ * Prefetch a list of cache keys.
+ *
+ * Duplicate and empty cache keys are skipped. The remaining
+ * cache keys are processed in order, with at most the specified
+ * number of prefetch function calls running at once.
+ *
+ * @param cache_keys	[in] Cache keys.
+ * @param threads	[in] Maximum number of concurrent prefetches.
+ * @param func		[in] Prefetch function.
+ * @param userdata	[in] User data for func.
+ * @param stats		[out] Prefetch statistics.
+ */
+void PrefetchCacheKeys(const vector<string> &cache_keys, int threads,
+	PrefetchFunc func, void *userdata, PrefetchStats &stats)
+{
+	assert(func != nullptr);
+	memset(&stats, 0, sizeof(stats));
+
+	// Remove duplicate cache keys.
+	// Many ROM images share the same external images,
+	// e.g. revisions of the same game or region fallbacks.
+	vector<const string*> keys;
+	unordered_set<string> seen;
+	keys.reserve(cache_keys.size());
+	seen.reserve(cache_keys.size());
+	for (const string &cache_key : cache_keys) {
+		if (cache_key.empty())
+			continue;
+		if (seen.insert(cache_key).second) {
+			keys.push_back(&cache_key);
+		} else {
+			stats.duplicates++;
+		}
+	}
+	stats.keys = static_cast<unsigned int>(keys.size());
+
+#ifdef _OPENMP
+	if (threads <= 0) {
+		threads = 1;
+	}
+#else /* !_OPENMP */
+	// Not compiled with OpenMP. Cache keys are prefetched serially.
+	threads = 1;
+#endif /* _OPENMP */
+
+	const int key_count = static_cast<int>(keys.size());
+#pragma omp parallel for schedule(dynamic, 1) num_threads(threads)
+	for (int i = 0; i < key_count; i++) {
+		const PrefetchResult res = func(*keys[i], userdata);
+		assert(res >= PrefetchResult::New && res < PrefetchResult::Max);
+#pragma omp atomic
+		stats.results[static_cast<size_t>(res)]++;
+	}
+}
@@ -0,0 +1,61 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (rpcli)                            *
+ * prefetchkeys.hpp: Concurrent cache key prefetching.                     *
+ *                                                                         *
+ * Copyright (c) 2016-2022 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#ifndef __ROMPROPERTIES_RPCLI_PREFETCHKEYS_HPP__
+#define __ROMPROPERTIES_RPCLI_PREFETCHKEYS_HPP__
+
+// C++ includes.
+#include <string>
+#include <vector>
+
+/**
+ * Result of prefetching a single cache key.
+ */
+enum class PrefetchResult {
+	New,		// File was downloaded.
+	Cached,		// File was already cached.
+	Failed,		// File could not be downloaded.
+
+	Max
+};
+
+/**
+ * Prefetch function.
+ * This is called from multiple threads at once.
+ * @param cache_key	[in] Cache key.
+ * @param userdata	[in] User data.
+ * @return PrefetchResult
+ */
+typedef PrefetchResult (*PrefetchFunc)(const std::string &cache_key, void *userdata);
+
+/**
+ * Prefetch statistics.
+ */
+struct PrefetchStats {
+	unsigned int keys;		// Number of unique cache keys.
+	unsigned int duplicates;	// Number of duplicate cache keys that were skipped.
+	unsigned int results[static_cast<size_t>(PrefetchResult::Max)];
+};
+
+/**
+ * Prefetch a list of cache keys.
+ *
+ * Duplicate and empty cache keys are skipped. The remaining
+ * cache keys are processed in order, with at most the specified
+ * number of prefetch function calls running at once.
+ *
+ * @param cache_keys	[in] Cache keys.
+ * @param threads	[in] Maximum number of concurrent prefetches.
+ * @param func		[in] Prefetch function.
+ * @param userdata	[in] User data for func.
+ * @param stats		[out] Prefetch statistics.
+ */
+void PrefetchCacheKeys(const std::vector<std::string> &cache_keys, int threads,
+	PrefetchFunc func, void *userdata, PrefetchStats &stats);
+
+#endif /* __ROMPROPERTIES_RPCLI_PREFETCHKEYS_HPP__ */
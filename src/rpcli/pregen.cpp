@@ -0,0 +1,563 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (rpcli)                            *
+ * pregen.cpp: Thumbnail cache pre-generation.                             *
+ *                                                                         *
+ * Copyright (c) 2016-2022 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "stdafx.h"
+#include "config.rpcli.h"
+#include "pregen.hpp"
+#include "findfiles.hpp"
+
+#ifndef RPCLI_PREGEN_SUPPORTED
+#error This file should only be compiled if thumbnail pre-generation is supported.
+#endif
+
+// librpbase, librpfile, librpcpu
+#include "librpbase/RomData.hpp"
+#include "librpbase/TextFuncs.hpp"
+#include "librpbase/crypto/MD5Hash.hpp"
+#include "librpbase/img/RpPngWriter.hpp"
+#include "librpcpu/byteswap_rp.h"
+#include "librpfile/FileSystem.hpp"
+#include "librpfile/RpFile.hpp"
+#include "libi18n/i18n.h"
+using namespace LibRpBase;
+using namespace LibRpFile;
+
+// librptexture
+#include "librptexture/img/rp_image.hpp"
+using LibRpTexture::rp_image;
+
+// libromdata
+#include "libromdata/RomDataFactory.hpp"
+using LibRomData::RomDataFactory;
+
+// TCreateThumbnail is a templated class,
+// so we have to #include the .cpp file here.
+#include "libromdata/img/TCreateThumbnail.cpp"
+using LibRomData::TCreateThumbnail;
+
+// OS-specific userdirs
+#include "libunixcommon/userdirs.hpp"
+
+// C includes.
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef _OPENMP
+#  include <omp.h>
+#endif /* _OPENMP */
+
+// C includes. (C++ namespace)
+#include <cerrno>
+#include <cinttypes>
+#include <cstdio>
+
+// C++ includes.
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+// Thumbnail flavors to generate.
+// Reference: https://specifications.freedesktop.org/thumbnail-spec/thumbnail-spec-latest.html
+// NOTE: Ordered from largest to smallest.
+static const struct {
+	const char *name;	// Flavor name, which is also the cache subdirectory.
+	int size;		// Maximum thumbnail size.
+} pregen_flavors[] = {
+	{"large",	256},
+	{"normal",	128},
+};
+
+/**
+ * Thumbnail creator for rpcli.
+ * ImgClass is an ARGB32 rp_image.
+ */
+class CreateThumbnailRpcli : public TCreateThumbnail<rp_image*>
+{
+	public:
+		CreateThumbnailRpcli() { }
+
+	private:
+		typedef TCreateThumbnail<rp_image*> super;
+		RP_DISABLE_COPY(CreateThumbnailRpcli)
+
+	public:
+		/** TCreateThumbnail functions. **/
+
+		/**
+		 * Wrapper function to convert rp_image* to ImgClass.
+		 * @param img rp_image
+		 * @return ImgClass
+		 */
+		inline rp_image *rpImageToImgClass(const rp_image *img) const final
+		{
+			return img->dup_ARGB32();
+		}
+
+		/**
+		 * Wrapper function to check if an ImgClass is valid.
+		 * @param imgClass ImgClass
+		 * @return True if valid; false if not.
+		 */
+		inline bool isImgClassValid(rp_image *const &imgClass) const final
+		{
+			return (imgClass != nullptr);
+		}
+
+		/**
+		 * Wrapper function to get a "null" ImgClass.
+		 * @return "Null" ImgClass.
+		 */
+		inline rp_image *getNullImgClass(void) const final
+		{
+			return nullptr;
+		}
+
+		/**
+		 * Free an ImgClass object.
+		 * @param imgClass ImgClass object.
+		 */
+		inline void freeImgClass(rp_image *&imgClass) const final
+		{
+			UNREF_AND_NULL(imgClass);
+		}
+
+		/**
+		 * Rescale an ImgClass using the specified scaling method.
+		 * @param imgClass ImgClass object.
+		 * @param sz New size.
+		 * @param method Scaling method.
+		 * @return Rescaled ImgClass.
+		 */
+		rp_image *rescaleImgClass(rp_image *const &imgClass, const ImgSize &sz, ScalingMethod method = ScalingMethod::Nearest) const final;
+
+		/**
+		 * Get the size of the specified ImgClass.
+		 * @param imgClass	[in] ImgClass object.
+		 * @param pOutSize	[out] Pointer to ImgSize to store the image size.
+		 * @return 0 on success; non-zero on error.
+		 */
+		inline int getImgClassSize(rp_image *const &imgClass, ImgSize *pOutSize) const final
+		{
+			pOutSize->width = imgClass->width();
+			pOutSize->height = imgClass->height();
+			return 0;
+		}
+
+		/**
+		 * Get the proxy for the specified URL.
+		 * @return Proxy, or empty string if no proxy is needed.
+		 */
+		inline string proxyForUrl(const string &url) const final
+		{
+			// rpcli doesn't have any proxy settings.
+			RP_UNUSED(url);
+			return string();
+		}
+};
+
+/**
+ * Rescale an ImgClass using the specified scaling method.
+ * @param imgClass ImgClass object.
+ * @param sz New size.
+ * @param method Scaling method.
+ * @return Rescaled ImgClass.
+ */
+rp_image *CreateThumbnailRpcli::rescaleImgClass(rp_image *const &imgClass, const ImgSize &sz, ScalingMethod method) const
+{
+	if (method == ScalingMethod::Bilinear) {
+		// Use an area average if downscaling in both directions.
+		const bool isDownscale = (sz.width <= imgClass->width() && sz.height <= imgClass->height());
+		return imgClass->scaled(sz.width, sz.height,
+			isDownscale ? rp_image::ScaleFilter::Box : rp_image::ScaleFilter::Bilinear);
+	}
+
+	// Nearest-neighbor scaling.
+	// ImgClass is always ARGB32.
+	assert(imgClass->format() == rp_image::Format::ARGB32);
+	rp_image *const img = new rp_image(sz.width, sz.height, rp_image::Format::ARGB32);
+	if (!img->isValid()) {
+		img->unref();
+		return nullptr;
+	}
+
+	const int srcWidth = imgClass->width();
+	const int srcHeight = imgClass->height();
+	for (int y = 0; y < sz.height; y++) {
+		const uint32_t *const src = static_cast<const uint32_t*>(
+			imgClass->scanLine(static_cast<int>((static_cast<int64_t>(y) * srcHeight) / sz.height)));
+		uint32_t *const dest = static_cast<uint32_t*>(img->scanLine(y));
+		for (int x = 0; x < sz.width; x++) {
+			dest[x] = src[(static_cast<int64_t>(x) * srcWidth) / sz.width];
+		}
+	}
+
+	rp_image::sBIT_t sBIT;
+	if (imgClass->get_sBIT(&sBIT) == 0) {
+		img->set_sBIT(&sBIT);
+	}
+	return img;
+}
+
+/** Pre-generation **/
+
+/**
+ * Per-file result.
+ */
+enum class PregenResult {
+	Generated,	// Thumbnails were created.
+	UpToDate,	// Existing thumbnails are up to date.
+	Unsupported,	// File isn't supported.
+	NoImage,	// File is supported, but doesn't have an image.
+	Failed,		// An error occurred.
+
+	Max
+};
+
+/**
+ * Convert an absolute filename to a file:// URI.
+ * Characters are escaped the same way as g_filename_to_uri(),
+ * since the URI's MD5 is the thumbnail filename.
+ * @param filename Absolute filename.
+ * @return URI.
+ */
+static string filenameToUri(const string &filename)
+{
+	static const char hex_lookup[] = "0123456789ABCDEF";
+	static const char unescaped[] = "!$&'()*+,-./:=@_~";
+
+	string uri = "file://";
+	uri.reserve(uri.size() + filename.size());
+	for (const char chr : filename) {
+		const uint8_t c = static_cast<uint8_t>(chr);
+		if ((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') ||
+		    (c >= '0' && c <= '9') || (c != 0 && strchr(unescaped, c)))
+		{
+			uri += chr;
+		} else {
+			uri += '%';
+			uri += hex_lookup[c >> 4];
+			uri += hex_lookup[c & 0x0F];
+		}
+	}
+	return uri;
+}
+
+/**
+ * Get the Thumb::MTime value from an existing thumbnail.
+ * Only the chunks before IDAT are checked.
+ * @param filename Thumbnail filename.
+ * @return Thumb::MTime, or empty string if not found.
+ */
+static string getThumbMTime(const string &filename)
+{
+	static const uint8_t png_sig[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+	static const char key[] = "Thumb::MTime";
+	string ret;
+
+	RpFile *const file = new RpFile(filename, RpFile::FM_OPEN_READ);
+	if (!file->isOpen()) {
+		file->unref();
+		return ret;
+	}
+
+	uint8_t sig[8];
+	if (file->read(sig, sizeof(sig)) != sizeof(sig) || memcmp(sig, png_sig, sizeof(sig)) != 0) {
+		file->unref();
+		return ret;
+	}
+
+	off64_t pos = sizeof(sig);
+	uint32_t chunk_hdr[2];	// length, type
+	while (file->seekAndRead(pos, chunk_hdr, sizeof(chunk_hdr)) == sizeof(chunk_hdr)) {
+		const uint32_t len = be32_to_cpu(chunk_hdr[0]);
+		const uint32_t type = be32_to_cpu(chunk_hdr[1]);
+		if (type == 'IDAT' || type == 'IEND')
+			break;
+
+		if (type == 'tEXt' && len > sizeof(key) && len <= 1024) {
+			char buf[1024];
+			if (file->read(buf, len) != len)
+				break;
+			if (!memcmp(buf, key, sizeof(key))) {
+				// Found Thumb::MTime. (sizeof(key) includes the NULL separator.)
+				ret.assign(&buf[sizeof(key)], len - sizeof(key));
+				break;
+			}
+		}
+
+		// Next chunk. (header + data + CRC)
+		pos += sizeof(chunk_hdr) + len + 4;
+	}
+
+	file->unref();
+	return ret;
+}
+
+/**
+ * Write a thumbnail to the cache.
+ * The thumbnail is written to a temporary file and then
+ * renamed, so other programs never see a partial file.
+ * @param filename	[in] Thumbnail filename.
+ * @param img		[in] Thumbnail image.
+ * @param fullSize	[in] Full image size.
+ * @param kv_common	[in] Common tEXt chunks.
+ * @param uri		[in] Source file URI.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+static int writeThumbnail(const string &filename, const rp_image *img,
+	const CreateThumbnailRpcli::ImgSize &fullSize,
+	const RpPngWriter::kv_vector &kv_common, const string &uri)
+{
+	char tmp_suffix[32];
+	snprintf(tmp_suffix, sizeof(tmp_suffix), ".rpcli-%d.tmp", static_cast<int>(getpid()));
+	const string tmp_filename = filename + tmp_suffix;
+
+	unique_ptr<RpPngWriter> pngWriter(new RpPngWriter(tmp_filename.c_str(), img));
+	if (!pngWriter->isOpen()) {
+		const int err = pngWriter->lastError();
+		return (err != 0 ? -err : -EIO);
+	}
+
+	RpPngWriter::kv_vector kv(kv_common);
+	if (fullSize.width > 0 && fullSize.height > 0) {
+		char imgdim_str[16];
+		snprintf(imgdim_str, sizeof(imgdim_str), "%d", fullSize.width);
+		kv.emplace_back("Thumb::Image::Width", imgdim_str);
+		snprintf(imgdim_str, sizeof(imgdim_str), "%d", fullSize.height);
+		kv.emplace_back("Thumb::Image::Height", imgdim_str);
+	}
+	kv.emplace_back("Thumb::URI", uri);
+	pngWriter->write_tEXt(kv);
+
+	// Thumbnails are cached, so encoding speed is more
+	// important than file size.
+	pngWriter->setCompressionProfile(RpPngWriter::CompressionProfile::Fast);
+
+	int ret = pngWriter->write_IHDR();
+	if (ret == 0) {
+		ret = pngWriter->write_IDAT();
+	}
+	pngWriter.reset();
+
+	if (ret == 0) {
+		// Thumbnails should only be readable by the user.
+		chmod(tmp_filename.c_str(), 0600);
+		if (rename(tmp_filename.c_str(), filename.c_str()) != 0) {
+			ret = -errno;
+		}
+	}
+	if (ret != 0) {
+		FileSystem::delete_file(tmp_filename);
+	}
+	return ret;
+}
+
+/**
+ * Pre-generate thumbnails for a single file.
+ * @param pf		[in] File.
+ * @param thumb_dir	[in] Thumbnail cache directory, with trailing slash.
+ * @return PregenResult
+ */
+static PregenResult pregenFile(const FoundFile &pf, const string &thumb_dir)
+{
+	static constexpr unsigned int flavor_count = ARRAY_SIZE(pregen_flavors);
+
+	const string uri = filenameToUri(pf.filename);
+	uint8_t md5[16];
+	if (MD5Hash::calcHash(md5, sizeof(md5), uri.data(), uri.size()) != 0) {
+		return PregenResult::Failed;
+	}
+	char md5_str[sizeof(md5)*2 + 1];
+	for (unsigned int i = 0; i < sizeof(md5); i++) {
+		snprintf(&md5_str[i*2], 3, "%02x", md5[i]);
+	}
+
+	char mtime_str[32];
+	snprintf(mtime_str, sizeof(mtime_str), "%" PRId64, static_cast<int64_t>(pf.mtime));
+
+	// Check which thumbnails need to be created.
+	string thumb_filenames[flavor_count];
+	int reqSizes[flavor_count];
+	unsigned int idx[flavor_count];
+	unsigned int count = 0;
+	for (unsigned int i = 0; i < flavor_count; i++) {
+		thumb_filenames[i] = thumb_dir;
+		thumb_filenames[i] += pregen_flavors[i].name;
+		thumb_filenames[i] += '/';
+		thumb_filenames[i] += md5_str;
+		thumb_filenames[i] += ".png";
+
+		if (getThumbMTime(thumb_filenames[i]) != mtime_str) {
+			reqSizes[count] = pregen_flavors[i].size;
+			idx[count] = i;
+			count++;
+		}
+	}
+	if (count == 0) {
+		// All thumbnails are up to date.
+		return PregenResult::UpToDate;
+	}
+
+	RpFile *const file = new RpFile(pf.filename, RpFile::FM_OPEN_READ_GZ);
+	if (!file->isOpen()) {
+		file->unref();
+		return PregenResult::Failed;
+	}
+	RomData *const romData = RomDataFactory::create(file, RomDataFactory::RDA_HAS_THUMBNAIL);
+	file->unref();	// file is ref()'d by RomData.
+	if (!romData) {
+		return PregenResult::Unsupported;
+	}
+
+	// Create all of the thumbnails from a single decode.
+	CreateThumbnailRpcli ct;
+	CreateThumbnailRpcli::GetThumbnailOutParams_t outParams[flavor_count];
+	int ret = ct.getThumbnails(romData, reqSizes, count, outParams);
+	if (ret != RPCT_SUCCESS) {
+		romData->unref();
+		switch (ret) {
+			case RPCT_SOURCE_FILE_NO_IMAGE:
+			case RPCT_SOURCE_FILE_CLASS_DISABLED:
+				return PregenResult::NoImage;
+			default:
+				return PregenResult::Failed;
+		}
+	}
+
+	// tEXt chunks shared by all of the thumbnails.
+	// KDE uses this order: Software, MTime, Mimetype, Size, URI
+	RpPngWriter::kv_vector kv_common;
+	kv_common.reserve(7);
+	kv_common.emplace_back("Software", "ROM Properties Page shell extension (rpcli)");
+	kv_common.emplace_back("Thumb::MTime", mtime_str);
+	const char *const mimeType = romData->mimeType();
+	if (mimeType) {
+		kv_common.emplace_back("Thumb::Mimetype", mimeType);
+	}
+	char szFile_str[32];
+	snprintf(szFile_str, sizeof(szFile_str), "%" PRId64, static_cast<int64_t>(pf.size));
+	kv_common.emplace_back("Thumb::Size", szFile_str);
+
+	PregenResult res = PregenResult::Generated;
+	for (unsigned int i = 0; i < count; i++) {
+		if (res == PregenResult::Generated) {
+			if (writeThumbnail(thumb_filenames[idx[i]], outParams[i].retImg,
+			    outParams[i].fullSize, kv_common, uri) != 0)
+			{
+				res = PregenResult::Failed;
+			}
+		}
+		ct.freeImgClass(outParams[i].retImg);
+	}
+
+	romData->unref();
+	return res;
+}
+
+/**
+ * Pre-generate freedesktop.org thumbnails for all files in a directory tree.
+ *
+ * Thumbnails are written to the XDG thumbnail cache.
+ * Files whose existing thumbnails have a matching Thumb::MTime
+ * are skipped.
+ *
+ * @param path		[in] Directory to scan.
+ * @param threads	[in] Number of worker threads. (0 for the number of CPU cores)
+ * @return 0 on success; non-zero if any thumbnails could not be created.
+ */
+int PregenThumbnails(const char *path, int threads)
+{
+	if (!path || path[0] == '\0') {
+		cerr << "-- " << C_("rpcli", "No directory specified for thumbnail pre-generation") << endl;
+		return -EINVAL;
+	}
+
+	// URIs must use absolute paths.
+	char *const abs_path = realpath(path, nullptr);
+	if (!abs_path) {
+		const int err = errno;
+		cerr << "-- " << rp_sprintf_p(C_("rpcli", "Couldn't open directory '%1$s': %2$s"),
+			path, strerror(err)) << endl;
+		return -err;
+	}
+	const string s_path(abs_path);
+	free(abs_path);
+
+	// Make sure the thumbnail cache directories exist.
+	// Reference: https://specifications.freedesktop.org/thumbnail-spec/thumbnail-spec-latest.html
+	string thumb_dir = LibUnixCommon::getCacheDirectory();
+	if (thumb_dir.empty()) {
+		cerr << "-- " << C_("rpcli", "Couldn't get the thumbnail cache directory") << endl;
+		return -ENOENT;
+	}
+	thumb_dir += "/thumbnails/";
+	FileSystem::rmkdir(thumb_dir);
+	mkdir(thumb_dir.c_str(), 0700);
+	for (const auto &flavor : pregen_flavors) {
+		const string flavor_dir = thumb_dir + flavor.name;
+		if (mkdir(flavor_dir.c_str(), 0700) != 0 && errno != EEXIST) {
+			const int err = errno;
+			cerr << "-- " << rp_sprintf_p(C_("rpcli", "Couldn't create directory '%1$s': %2$s"),
+				flavor_dir.c_str(), strerror(err)) << endl;
+			return -err;
+		}
+	}
+
+	cerr << "== " << rp_sprintf(C_("rpcli", "Scanning directory '%s'..."), s_path.c_str()) << endl;
+	vector<FoundFile> files;
+	findFiles(s_path, files);
+
+#ifdef _OPENMP
+	if (threads <= 0) {
+		threads = omp_get_num_procs();
+	}
+#else /* !_OPENMP */
+	// Not compiled with OpenMP. Files are processed serially.
+	threads = 1;
+#endif /* _OPENMP */
+
+	cerr << "== " << rp_sprintf(C_("rpcli", "Generating thumbnails for %u file(s) using %d thread(s)..."),
+		static_cast<unsigned int>(files.size()), threads) << endl;
+
+	unsigned int results[static_cast<size_t>(PregenResult::Max)] = {0, 0, 0, 0, 0};
+	const auto start = std::chrono::steady_clock::now();
+
+	const int file_count = static_cast<int>(files.size());
+#pragma omp parallel for schedule(dynamic, 1) num_threads(threads)
+	for (int i = 0; i < file_count; i++) {
+		const PregenResult res = pregenFile(files[i], thumb_dir);
+		if (res == PregenResult::Failed) {
+#pragma omp critical
+			cerr << "-- " << rp_sprintf(C_("rpcli", "Couldn't create thumbnails for '%s'"),
+				files[i].filename.c_str()) << endl;
+		}
+#pragma omp atomic
+		results[static_cast<size_t>(res)]++;
+	}
+
+	const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	const double secs = elapsed.count();
+	const double files_per_sec = (secs > 0 ? file_count / secs : 0.0);
+
+	cout << rp_sprintf(C_("rpcli", "Processed %u file(s) in %.2f s (%.1f files/sec)"),
+		static_cast<unsigned int>(file_count), secs, files_per_sec) << '\n';
+	cout << "  " << rp_sprintf(C_("rpcli", "Generated:   %u"), results[static_cast<size_t>(PregenResult::Generated)]) << '\n';
+	cout << "  " << rp_sprintf(C_("rpcli", "Up to date:  %u"), results[static_cast<size_t>(PregenResult::UpToDate)]) << '\n';
+	cout << "  " << rp_sprintf(C_("rpcli", "Unsupported: %u"), results[static_cast<size_t>(PregenResult::Unsupported)]) << '\n';
+	cout << "  " << rp_sprintf(C_("rpcli", "No image:    %u"), results[static_cast<size_t>(PregenResult::NoImage)]) << '\n';
+	cout << "  " << rp_sprintf(C_("rpcli", "Failed:      %u"), results[static_cast<size_t>(PregenResult::Failed)]) << endl;
+
+	return (results[static_cast<size_t>(PregenResult::Failed)] == 0 ? 0 : 1);
+}
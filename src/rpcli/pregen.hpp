@@ -0,0 +1,39 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (rpcli)                            *
+ * pregen.hpp: Thumbnail cache pre-generation.                             *
+ *                                                                         *
+ * Copyright (c) 2016-2022 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#ifndef __ROMPROPERTIES_RPCLI_PREGEN_HPP__
+#define __ROMPROPERTIES_RPCLI_PREGEN_HPP__
+
+#include "librpbase/config.librpbase.h"
+
+// NOTE: Thumbnail cache filenames are MD5 hashes of the URI,
+// so pre-generation requires MD5Hash, which is only available
+// if decryption is enabled.
+// The freedesktop.org thumbnail cache isn't used on Windows.
+#if defined(ENABLE_DECRYPTION) && !defined(_WIN32)
+#  define RPCLI_PREGEN_SUPPORTED 1
+#endif
+
+#ifdef RPCLI_PREGEN_SUPPORTED
+
+/**
+ * Pre-generate freedesktop.org thumbnails for all files in a directory tree.
+ *
+ * Thumbnails are written to the XDG thumbnail cache.
+ * Files whose existing thumbnails have a matching Thumb::MTime
+ * are skipped.
+ *
+ * @param path		[in] Directory to scan.
+ * @param threads	[in] Number of worker threads. (0 for the number of CPU cores)
+ * @return 0 on success; non-zero if any thumbnails could not be created.
+ */
+int PregenThumbnails(const char *path, int threads);
+
+#endif /* RPCLI_PREGEN_SUPPORTED */
+
+#endif /* __ROMPROPERTIES_RPCLI_PREGEN_HPP__ */
@@ -48,6 +48,8 @@ using LibRpTexture::rp_image;
 # include "verifykeys.hpp"
 #endif /* ENABLE_DECRYPTION */
 #include "device.hpp"
+#include "pregen.hpp"
+#include "prefetch.hpp"
 
 // OS-specific userdirs
 #ifdef _WIN32
@@ -61,15 +63,20 @@ using LibRpTexture::rp_image;
 
 // C includes.
 #include <stdlib.h>
+#ifdef _OPENMP
+#  include <omp.h>
+#endif /* _OPENMP */
 
 // C includes. (C++ namespace)
 #include <cassert>
 #include <cerrno>
+#include <climits>
 
 // C++ includes.
 #include <fstream>
 #include <iostream>
 #include <locale>
+#include <sstream>
 #include <string>
 #include <vector>
 using std::cout;
@@ -77,6 +84,8 @@ using std::cerr;
 using std::endl;
 using std::locale;
 using std::ofstream;
+using std::ostream;
+using std::ostringstream;
 using std::string;
 using std::vector;
 
@@ -101,8 +110,9 @@ struct ExtractParam {
 * Extracts images from romdata
 * @param romData RomData containing the images
 * @param extract Vector of image extraction parameters
+* @param err Output stream for status messages
 */
-static void ExtractImages(const RomData *romData, vector<ExtractParam>& extract) {
+static void ExtractImages(const RomData *romData, const vector<ExtractParam>& extract, ostream &err) {
 	int supported = romData->supportedImageTypes();
 	for (const ExtractParam &p : extract) {
 		if (!p.filename) continue;
@@ -115,7 +125,7 @@ static void ExtractImages(const RomData *romData, vector<ExtractParam>& extract)
 			auto image = romData->image(imageType);
 			if (image && image->isValid()) {
 				found = true;
-				cerr << "-- " <<
+				err << "-- " <<
 					// tr: %1$s == image type name, %2$s == output filename
 					rp_sprintf_p(C_("rpcli", "Extracting %1$s into '%2$s'"),
 						RomData::getImageTypeName(imageType),
@@ -123,10 +133,10 @@ static void ExtractImages(const RomData *romData, vector<ExtractParam>& extract)
 				int errcode = RpPng::save(p.filename, image);
 				if (errcode != 0) {
 					// tr: %1$s == filename, %2%s == error message
-					cerr << rp_sprintf_p(C_("rpcli", "Couldn't create file '%1$s': %2$s"),
+					err << rp_sprintf_p(C_("rpcli", "Couldn't create file '%1$s': %2$s"),
 						p.filename, strerror(-errcode)) << endl;
 				} else {
-					cerr << "   " << C_("rpcli", "Done") << endl;
+					err << "   " << C_("rpcli", "Done") << endl;
 				}
 			}
 		} else if (p.imageType == -1) {
@@ -134,30 +144,30 @@ static void ExtractImages(const RomData *romData, vector<ExtractParam>& extract)
 			auto iconAnimData = romData->iconAnimData();
 			if (iconAnimData && iconAnimData->count != 0 && iconAnimData->seq_count != 0) {
 				found = true;
-				cerr << "-- " << rp_sprintf(C_("rpcli", "Extracting animated icon into '%s'"), p.filename) << endl;
+				err << "-- " << rp_sprintf(C_("rpcli", "Extracting animated icon into '%s'"), p.filename) << endl;
 				int errcode = RpPng::save(p.filename, iconAnimData);
 				if (errcode == -ENOTSUP) {
-					cerr << "   " << C_("rpcli", "APNG not supported, extracting only the first frame") << endl;
+					err << "   " << C_("rpcli", "APNG not supported, extracting only the first frame") << endl;
 					// falling back to outputting the first frame
 					errcode = RpPng::save(p.filename, iconAnimData->frames[iconAnimData->seq_index[0]]);
 				}
 				if (errcode != 0) {
-					cerr << "   " <<
+					err << "   " <<
 						rp_sprintf_p(C_("rpcli", "Couldn't create file '%1$s': %2$s"),
 							p.filename, strerror(-errcode)) << endl;
 				} else {
-					cerr << "   " << C_("rpcli", "Done") << endl;
+					err << "   " << C_("rpcli", "Done") << endl;
 				}
 			}
 		}
 		if (!found) {
 			// TODO: Return an error code?
 			if (p.imageType == -1) {
-				cerr << "-- " << C_("rpcli", "Animated icon not found") << endl;
+				err << "-- " << C_("rpcli", "Animated icon not found") << endl;
 			} else {
 				const RomData::ImageType imageType =
 					static_cast<RomData::ImageType>(p.imageType);
-				cerr << "-- " <<
+				err << "-- " <<
 					rp_sprintf(C_("rpcli", "Image '%s' not found"),
 						RomData::getImageTypeName(imageType)) << endl;
 			}
@@ -172,32 +182,34 @@ static void ExtractImages(const RomData *romData, vector<ExtractParam>& extract)
  * @param extract Vector of image extraction parameters
  * @param languageCode Language code. (0 for default)
  * @param skipInternalImages If true, skip internal image processing.
+ * @param out Output stream for ROM information
+ * @param err Output stream for status messages
  */
-static void DoFile(const char *filename, bool json, vector<ExtractParam>& extract,
-	uint32_t languageCode = 0, bool skipInternalImages = false)
+static void DoFile(const char *filename, bool json, const vector<ExtractParam>& extract,
+	uint32_t languageCode, bool skipInternalImages, ostream &out, ostream &err)
 {
-	cerr << "== " << rp_sprintf(C_("rpcli", "Reading file '%s'..."), filename) << endl;
+	err << "== " << rp_sprintf(C_("rpcli", "Reading file '%s'..."), filename) << endl;
 	RpFile *const file = new RpFile(filename, RpFile::FM_OPEN_READ_GZ);
 	if (file->isOpen()) {
 		RomData *romData = RomDataFactory::create(file);
 		if (romData && romData->isValid()) {
 			if (json) {
-				cerr << "-- " << C_("rpcli", "Outputting JSON data") << endl;
-				cout << JSONROMOutput(romData, languageCode, skipInternalImages) << endl;
+				err << "-- " << C_("rpcli", "Outputting JSON data") << endl;
+				out << JSONROMOutput(romData, languageCode, skipInternalImages) << endl;
 			} else {
-				cout << ROMOutput(romData, languageCode, skipInternalImages) << endl;
+				out << ROMOutput(romData, languageCode, skipInternalImages) << endl;
 			}
 
-			ExtractImages(romData, extract);
+			ExtractImages(romData, extract, err);
 		} else {
-			cerr << "-- " << C_("rpcli", "ROM is not supported") << endl;
-			if (json) cout << "{\"error\":\"rom is not supported\"}" << endl;
+			err << "-- " << C_("rpcli", "ROM is not supported") << endl;
+			if (json) out << "{\"error\":\"rom is not supported\"}" << endl;
 		}
 
 		UNREF(romData);
 	} else {
-		cerr << "-- " << rp_sprintf(C_("rpcli", "Couldn't open file: %s"), strerror(file->lastError())) << endl;
-		if (json) cout << "{\"error\":\"couldn't open file\",\"code\":" << file->lastError() << "}" << endl;
+		err << "-- " << rp_sprintf(C_("rpcli", "Couldn't open file: %s"), strerror(file->lastError())) << endl;
+		if (json) out << "{\"error\":\"couldn't open file\",\"code\":" << file->lastError() << "}" << endl;
 	}
 	file->unref();
 }
@@ -260,28 +272,30 @@ static void PrintPathnames(void)
  * Run a SCSI INQUIRY command on a device.
  * @param filename Device filename
  * @param json Is program running in json mode?
+ * @param out Output stream for device information
+ * @param err Output stream for status messages
  */
-static void DoScsiInquiry(const char *filename, bool json)
+static void DoScsiInquiry(const char *filename, bool json, ostream &out, ostream &err)
 {
-	cerr << "== " << rp_sprintf(C_("rpcli", "Opening device file '%s'..."), filename) << endl;
+	err << "== " << rp_sprintf(C_("rpcli", "Opening device file '%s'..."), filename) << endl;
 	RpFile *const file = new RpFile(filename, RpFile::FM_OPEN_READ_GZ);
 	if (file->isOpen()) {
 		// TODO: Check for unsupported devices? (Only CD-ROM is supported.)
 		if (file->isDevice()) {
 			if (json) {
-				cerr << "-- " << C_("rpcli", "Outputting JSON data") << endl;
+				err << "-- " << C_("rpcli", "Outputting JSON data") << endl;
 				// TODO: JSONScsiInquiry
-				//cout << JSONScsiInquiry(file) << endl;
+				//out << JSONScsiInquiry(file) << endl;
 			} else {
-				cout << ScsiInquiry(file) << endl;
+				out << ScsiInquiry(file) << endl;
 			}
 		} else {
-			cerr << "-- " << C_("rpcli", "Not a device file") << endl;
-			if (json) cout << "{\"error\":\"Not a device file\"}" << endl;
+			err << "-- " << C_("rpcli", "Not a device file") << endl;
+			if (json) out << "{\"error\":\"Not a device file\"}" << endl;
 		}
 	} else {
-		cerr << "-- " << rp_sprintf(C_("rpcli", "Couldn't open file: %s"), strerror(file->lastError())) << endl;
-		if (json) cout << "{\"error\":\"couldn't open file\",\"code\":" << file->lastError() << "}" << endl;
+		err << "-- " << rp_sprintf(C_("rpcli", "Couldn't open file: %s"), strerror(file->lastError())) << endl;
+		if (json) out << "{\"error\":\"couldn't open file\",\"code\":" << file->lastError() << "}" << endl;
 	}
 	file->unref();
 }
@@ -291,37 +305,196 @@ static void DoScsiInquiry(const char *filename, bool json)
  * @param filename Device filename
  * @param json Is program running in json mode?
  * @param packet If true, use ATA IDENTIFY PACKET.
+ * @param out Output stream for device information
+ * @param err Output stream for status messages
  */
-static void DoAtaIdentifyDevice(const char *filename, bool json, bool packet)
+static void DoAtaIdentifyDevice(const char *filename, bool json, bool packet, ostream &out, ostream &err)
 {
-	cerr << "== " << rp_sprintf(C_("rpcli", "Opening device file '%s'..."), filename) << endl;
+	err << "== " << rp_sprintf(C_("rpcli", "Opening device file '%s'..."), filename) << endl;
 	RpFile *const file = new RpFile(filename, RpFile::FM_OPEN_READ_GZ);
 	if (file->isOpen()) {
 		// TODO: Check for unsupported devices? (Only CD-ROM is supported.)
 		if (file->isDevice()) {
 			if (json) {
-				cerr << "-- " << C_("rpcli", "Outputting JSON data") << endl;
+				err << "-- " << C_("rpcli", "Outputting JSON data") << endl;
 				// TODO: JSONAtaIdentifyDevice
-				//cout << JSONAtaIdentifyDevice(file) << endl;
+				//out << JSONAtaIdentifyDevice(file) << endl;
 			} else {
-				cout << AtaIdentifyDevice(file, packet) << endl;
+				out << AtaIdentifyDevice(file, packet) << endl;
 			}
 		} else {
-			cerr << "-- " << C_("rpcli", "Not a device file") << endl;
-			if (json) cout << "{\"error\":\"Not a device file\"}" << endl;
+			err << "-- " << C_("rpcli", "Not a device file") << endl;
+			if (json) out << "{\"error\":\"Not a device file\"}" << endl;
 		}
 	} else {
-		cerr << "-- " << rp_sprintf(C_("rpcli", "Couldn't open file: %s"), strerror(file->lastError())) << endl;
-		if (json) cout << "{\"error\":\"couldn't open file\",\"code\":" << file->lastError() << "}" << endl;
+		err << "-- " << rp_sprintf(C_("rpcli", "Couldn't open file: %s"), strerror(file->lastError())) << endl;
+		if (json) out << "{\"error\":\"couldn't open file\",\"code\":" << file->lastError() << "}" << endl;
 	}
 	file->unref();
 }
 #endif /* RP_OS_SCSI_SUPPORTED */
 
+/**
+ * File to process.
+ * All parameters are captured when the file is queued,
+ * since they may be changed by options specified later.
+ */
+struct FileJob {
+	enum class Mode {
+		File,			// Regular file
+#ifdef RP_OS_SCSI_SUPPORTED
+		ScsiInquiry,		// SCSI INQUIRY command
+		AtaIdentify,		// ATA IDENTIFY DEVICE command
+		AtaIdentifyPacket,	// ATA IDENTIFY PACKET DEVICE command
+#endif /* RP_OS_SCSI_SUPPORTED */
+	};
+
+	const char *filename;
+	vector<ExtractParam> extract;
+	uint32_t languageCode;
+	bool skipInternalImages;
+	Mode mode;
+};
+
+/**
+ * Process a file.
+ * @param job File to process
+ * @param json Is program running in json mode?
+ * @param out Output stream for ROM information
+ * @param err Output stream for status messages
+ */
+static void DoFileJob(const FileJob &job, bool json, ostream &out, ostream &err)
+{
+	switch (job.mode) {
+		default:
+		case FileJob::Mode::File:
+			DoFile(job.filename, json, job.extract, job.languageCode, job.skipInternalImages, out, err);
+			break;
+#ifdef RP_OS_SCSI_SUPPORTED
+		case FileJob::Mode::ScsiInquiry:
+			DoScsiInquiry(job.filename, json, out, err);
+			break;
+		case FileJob::Mode::AtaIdentify:
+			DoAtaIdentifyDevice(job.filename, json, false, out, err);
+			break;
+		case FileJob::Mode::AtaIdentifyPacket:
+			DoAtaIdentifyDevice(job.filename, json, true, out, err);
+			break;
+#endif /* RP_OS_SCSI_SUPPORTED */
+	}
+}
+
+/**
+ * Parse a worker thread count. (-J)
+ * @param s String
+ * @param pThreads [out,opt] Thread count
+ * @return True if s is a valid thread count; false if not.
+ */
+static bool ParseThreadCount(const char *s, int *pThreads)
+{
+	char *endptr = nullptr;
+	errno = 0;
+	const long val = strtol(s, &endptr, 10);
+	if (endptr == s || *endptr != '\0' || errno != 0 || val < 0 || val > INT_MAX) {
+		return false;
+	}
+	if (pThreads) {
+		*pThreads = static_cast<int>(val);
+	}
+	return true;
+}
+
+/**
+ * Print the JSON separator before a file's output, if needed.
+ * @param json Is program running in json mode?
+ * @param first [in/out] True if no files have been printed yet
+ */
+static inline void BeginFileOutput(bool json, bool &first)
+{
+	if (first) first = false;
+	else if (json) cout << "," << endl;
+}
+
+/**
+ * Process multiple files using a pool of worker threads.
+ *
+ * The output of each file is buffered, and then printed as a
+ * single block, so output from different files is never mixed.
+ * In ordered mode, files are printed in the order they were
+ * specified; otherwise, they're printed as soon as they finish.
+ *
+ * @param jobs Files to process (cleared on return)
+ * @param json Is program running in json mode?
+ * @param threads Number of worker threads
+ * @param ordered If true, print the files in order.
+ * @param first [in/out] True if no files have been printed yet
+ */
+static void RunFileJobs(vector<FileJob> &jobs, bool json, int threads, bool ordered, bool &first)
+{
+	struct FileOutput {
+		string out;
+		string err;
+		bool done;
+	};
+
+	if (jobs.empty())
+		return;
+
+	const int job_count = static_cast<int>(jobs.size());
+	vector<FileOutput> results(job_count);
+	int next = 0;	// Next file to print in ordered mode.
+
+	// Print a file's buffered output.
+	// NOTE: Must be called from within the critical section.
+	auto printFileOutput = [json, &first](FileOutput &result) {
+		BeginFileOutput(json, first);
+		cerr << result.err;
+		cerr.flush();
+		cout << result.out;
+		cout.flush();
+		string().swap(result.out);
+		string().swap(result.err);
+	};
+
+#pragma omp parallel for schedule(dynamic, 1) num_threads(threads)
+	for (int i = 0; i < job_count; i++) {
+		// NOTE: Use the same locale as the standard streams.
+		ostringstream out, err;
+		out.imbue(cout.getloc());
+		err.imbue(cerr.getloc());
+		DoFileJob(jobs[i], json, out, err);
+
+#pragma omp critical
+		{
+			results[i].out = out.str();
+			results[i].err = err.str();
+			results[i].done = true;
+			if (ordered) {
+				for (; next < job_count && results[next].done; next++) {
+					printFileOutput(results[next]);
+				}
+			} else {
+				printFileOutput(results[i]);
+			}
+		}
+	}
+
+	jobs.clear();
+}
+
 int RP_C_API main(int argc, char *argv[])
 {
-	// Enable security options.
-	rpcli_do_security_options();
+#ifdef RPCLI_PREFETCH_SUPPORTED
+	// External image prefetching (-d) uses rp-download, which can't
+	// be executed by a sandboxed process. PrefetchExtImages() enables
+	// the security options in the child process that scans the files.
+	const bool prefetch = (argc >= 2 && argv[1][0] == '-' && argv[1][1] == 'd');
+	if (!prefetch)
+#endif /* RPCLI_PREFETCH_SUPPORTED */
+	{
+		// Enable security options.
+		rpcli_do_security_options();
+	}
 
 	// Set the C and C++ locales.
 	locale::global(locale(""));
@@ -345,19 +518,41 @@ int RP_C_API main(int argc, char *argv[])
 	// Initialize i18n.
 	rp_i18n_init();
 
+#ifdef RPCLI_PREFETCH_SUPPORTED
+	if (prefetch) {
+		// External image prefetching.
+		// N is optional; 0 uses the default number of connections.
+		if (argc != 3) {
+			cerr << C_("rpcli", "Usage: rpcli -dN directory") << endl;
+			return EXIT_FAILURE;
+		}
+		const int threads = atoi(argv[1] + 2);
+		return (PrefetchExtImages(argv[2], threads) == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+	}
+#endif /* RPCLI_PREFETCH_SUPPORTED */
+
 	if(argc < 2){
 #ifdef ENABLE_DECRYPTION
-		cerr << C_("rpcli", "Usage: rpcli [-k] [-c] [-p] [-j] [-l lang] [[-x[b]N outfile]... [-a apngoutfile] filename]...") << '\n';
+		cerr << C_("rpcli", "Usage: rpcli [-k] [-c] [-p] [-j] [-J N [-u]] [-l lang] [-gN directory] [[-x[b]N outfile]... [-a apngoutfile] filename]...") << '\n';
 		cerr << "  -k:   " << C_("rpcli", "Verify encryption keys in keys.conf.") << '\n';
 #else /* !ENABLE_DECRYPTION */
-		cerr << C_("rpcli", "Usage: rpcli [-c] [-p] [-j] [-l lang] [[-x[b]N outfile]... [-a apngoutfile] filename]...") << '\n';
+		cerr << C_("rpcli", "Usage: rpcli [-c] [-p] [-j] [-J N [-u]] [-l lang] [-gN directory] [[-x[b]N outfile]... [-a apngoutfile] filename]...") << '\n';
 #endif /* ENABLE_DECRYPTION */
 		cerr << "  -c:   " << C_("rpcli", "Print system region information.") << '\n';
 		cerr << "  -p:   " << C_("rpcli", "Print system path information.") << '\n';
 		cerr << "  -j:   " << C_("rpcli", "Use JSON output format.") << '\n';
+		cerr << "  -J:   " << C_("rpcli", "Process files using N worker threads. (0 for the number of CPU cores)") << '\n';
+		cerr << "  -u:   " << C_("rpcli", "With -J, print each file as soon as it's processed instead of in order.") << '\n';
 		cerr << "  -l:   " << C_("rpcli", "Retrieve the specified language from the ROM image.") << '\n';
 		cerr << "  -xN:  " << C_("rpcli", "Extract image N to outfile in PNG format.") << '\n';
 		cerr << "  -a:   " << C_("rpcli", "Extract the animated icon to outfile in APNG format.") << '\n';
+#ifdef RPCLI_PREGEN_SUPPORTED
+		cerr << "  -gN:  " << C_("rpcli", "Pre-generate thumbnails for all files in a directory using N threads.") << '\n';
+#endif /* RPCLI_PREGEN_SUPPORTED */
+#ifdef RPCLI_PREFETCH_SUPPORTED
+		cerr << "  -dN:  " << C_("rpcli", "Download external images for all files in a directory using N connections.") << '\n';
+		cerr << "        " << C_("rpcli", "This must be the only option.") << '\n';
+#endif /* RPCLI_PREFETCH_SUPPORTED */
 		cerr << '\n';
 #ifdef RP_OS_SCSI_SUPPORTED
 		cerr << C_("rpcli", "Special options for devices:") << '\n';
@@ -371,6 +566,16 @@ int RP_C_API main(int argc, char *argv[])
 		cerr << "\t " << C_("rpcli", "displays info about s3.gen") << '\n';
 		cerr << "* rpcli -x0 icon.png pokeb2.nds" << '\n';
 		cerr << "\t " << C_("rpcli", "extracts icon from pokeb2.nds") << endl;
+		cerr << "* rpcli -j -J 8 *.nds" << '\n';
+		cerr << "\t " << C_("rpcli", "displays info about all .nds files in JSON format using 8 threads") << endl;
+#ifdef RPCLI_PREGEN_SUPPORTED
+		cerr << "* rpcli -g4 /mnt/roms" << '\n';
+		cerr << "\t " << C_("rpcli", "pre-generates thumbnails for /mnt/roms using 4 threads") << endl;
+#endif /* RPCLI_PREGEN_SUPPORTED */
+#ifdef RPCLI_PREFETCH_SUPPORTED
+		cerr << "* rpcli -d8 /mnt/roms" << '\n';
+		cerr << "\t " << C_("rpcli", "downloads external images for /mnt/roms using 8 connections") << endl;
+#endif /* RPCLI_PREFETCH_SUPPORTED */
 
 		// Since we didn't do anything, return a failure code.
 		return EXIT_FAILURE;
@@ -381,11 +586,73 @@ int RP_C_API main(int argc, char *argv[])
 	bool json = false;
 	vector<ExtractParam> extract;
 
-	for (int i = 1; i < argc; i++) { // figure out the json mode in advance
-		if (argv[i][0] == '-' && argv[i][1] == 'j') {
-			json = true;
+	// Worker threads for processing files. (-J)
+	int threads = 1;
+	bool ordered = true;
+
+	for (int i = 1; i < argc; i++) { // figure out the json mode and worker threads in advance
+		if (argv[i][0] != '-')
+			continue;
+		switch (argv[i][1]) {
+			case 'j':
+				json = true;
+				break;
+			case 'J':
+				// NOTE: N may be immediately after 'J',
+				// or it might be a completely separate argument.
+				// If the separate argument isn't a number, it's
+				// left for the main loop to handle as a filename.
+				if (argv[i][2] != '\0') {
+					if (!ParseThreadCount(&argv[i][2], &threads)) {
+						cerr << rp_sprintf(C_("rpcli", "Warning: ignoring invalid thread count '%s'"), &argv[i][2]) << endl;
+					}
+				} else if (i + 1 < argc && ParseThreadCount(argv[i+1], &threads)) {
+					i++;
+				} else {
+					cerr << C_("rpcli", "Warning: no thread count specified for '-J'") << endl;
+				}
+				break;
+			case 'u':
+				ordered = false;
+				break;
+			case 'l':
+				// Skip the language code if it's a separate argument.
+				if (argv[i][2] == '\0') {
+					i++;
+				}
+				break;
+			case 'x':
+			case 'a':
+				// Skip the output filename.
+				i++;
+				break;
+#ifdef RPCLI_PREGEN_SUPPORTED
+			case 'g':
+				// Skip the directory.
+				i++;
+				break;
+#endif /* RPCLI_PREGEN_SUPPORTED */
+#ifdef RPCLI_PREFETCH_SUPPORTED
+			case 'd':
+				// Skip the directory.
+				i++;
+				break;
+#endif /* RPCLI_PREFETCH_SUPPORTED */
+			default:
+				break;
 		}
 	}
+#ifdef _OPENMP
+	if (threads == 0) {
+		threads = omp_get_num_procs();
+	}
+#else /* !_OPENMP */
+	// Not compiled with OpenMP. Files are processed serially.
+	threads = 1;
+#endif /* _OPENMP */
+	if (threads < 1) {
+		threads = 1;
+	}
 	if (json) cout << "[\n";
 
 #ifdef _WIN32
@@ -398,14 +665,11 @@ int RP_C_API main(int argc, char *argv[])
 	}
 #endif /* _WIN32 */
 
-#ifdef RP_OS_SCSI_SUPPORTED
-	bool inq_scsi = false;
-	bool inq_ata = false;
-	bool inq_ata_packet = false;
-#endif /* RP_OS_SCSI_SUPPORTED */
+	FileJob::Mode mode = FileJob::Mode::File;
 	uint32_t languageCode = 0;
 	bool skipInternalImages = false;
 	bool first = true;
+	vector<FileJob> jobs;	// Files queued for the worker threads.
 	int ret = 0;
 	for (int i = 1; i < argc; i++){
 		if (argv[i][0] == '-'){
@@ -413,6 +677,7 @@ int RP_C_API main(int argc, char *argv[])
 #ifdef ENABLE_DECRYPTION
 			case 'k': {
 				// Verify encryption keys.
+				RunFileJobs(jobs, json, threads, ordered, first);
 				static bool hasVerifiedKeys = false;
 				if (!hasVerifiedKeys) {
 					hasVerifiedKeys = true;
@@ -423,10 +688,12 @@ int RP_C_API main(int argc, char *argv[])
 #endif /* ENABLE_DECRYPTION */
 			case 'c':
 				// Print the system region information.
+				RunFileJobs(jobs, json, threads, ordered, first);
 				PrintSystemRegion();
 				break;
 			case 'p':
 				// Print pathnames.
+				RunFileJobs(jobs, json, threads, ordered, first);
 				PrintPathnames();
 				break;
 			case 'l': {
@@ -479,23 +746,52 @@ int RP_C_API main(int argc, char *argv[])
 			case 'a':
 				extract.emplace_back(ExtractParam(argv[++i], -1));
 				break;
+#ifdef RPCLI_PREGEN_SUPPORTED
+			case 'g': {
+				// Thumbnail pre-generation.
+				// N is optional; 0 uses the number of CPU cores.
+				RunFileJobs(jobs, json, threads, ordered, first);
+				const int pregen_threads = atoi(argv[i] + 2);
+				if (PregenThumbnails(argv[++i], pregen_threads) != 0) {
+					ret = EXIT_FAILURE;
+				}
+				break;
+			}
+#endif /* RPCLI_PREGEN_SUPPORTED */
+#ifdef RPCLI_PREFETCH_SUPPORTED
+			case 'd':
+				// External image prefetching is handled before
+				// the security options are enabled.
+				cerr << C_("rpcli", "Warning: '-d' must be the first option; skipping") << endl;
+				i++;
+				break;
+#endif /* RPCLI_PREFETCH_SUPPORTED */
 			case 'j': // do nothing
 				break;
+			case 'J':
+				// Worker threads were set in advance.
+				// Skip N if it's a separate argument.
+				if (argv[i][2] == '\0' && i + 1 < argc && ParseThreadCount(argv[i+1], nullptr)) {
+					i++;
+				}
+				break;
+			case 'u': // do nothing
+				break;
 #ifdef RP_OS_SCSI_SUPPORTED
 			case 'i':
 				// These commands take precedence over the usual rpcli functionality.
 				switch (argv[i][2]) {
 					case 's':
 						// SCSI INQUIRY command.
-						inq_scsi = true;
+						mode = FileJob::Mode::ScsiInquiry;
 						break;
 					case 'a':
 						// ATA IDENTIFY DEVICE command.
-						inq_ata = true;
+						mode = FileJob::Mode::AtaIdentify;
 						break;
 					case 'p':
 						// ATA IDENTIFY PACKET DEVICE command.
-						inq_ata_packet = true;
+						mode = FileJob::Mode::AtaIdentifyPacket;
 						break;
 					default:
 						if (argv[i][2] == '\0') {
@@ -512,35 +808,27 @@ int RP_C_API main(int argc, char *argv[])
 				break;
 			}
 		} else {
-			if (first) first = false;
-			else if (json) cout << "," << endl;
+			FileJob job;
+			job.filename = argv[i];
+			job.extract = std::move(extract);
+			job.languageCode = languageCode;
+			job.skipInternalImages = skipInternalImages;
+			job.mode = mode;
 
 			// TODO: Return codes?
-#ifdef RP_OS_SCSI_SUPPORTED
-			if (inq_scsi) {
-				// SCSI INQUIRY command.
-				DoScsiInquiry(argv[i], json);
-			} else if (inq_ata) {
-				// ATA IDENTIFY DEVICE command.
-				DoAtaIdentifyDevice(argv[i], json, false);
-			} else if (inq_ata_packet) {
-				// ATA IDENTIFY PACKET DEVICE command.
-				DoAtaIdentifyDevice(argv[i], json, true);
-			} else
-#endif /* RP_OS_SCSI_SUPPORTED */
-			{
-				// Regular file.
-				DoFile(argv[i], json, extract, languageCode, skipInternalImages);
+			if (threads > 1) {
+				// Queue the file for the worker threads.
+				jobs.push_back(std::move(job));
+			} else {
+				BeginFileOutput(json, first);
+				DoFileJob(job, json, cout, cerr);
 			}
 
-#ifdef RP_OS_SCSI_SUPPORTED
-			inq_scsi = false;
-			inq_ata = false;
-			inq_ata_packet = false;
-#endif /* RP_OS_SCSI_SUPPORTED */
+			mode = FileJob::Mode::File;
 			extract.clear();
 		}
 	}
+	RunFileJobs(jobs, json, threads, ordered, first);
 	if (json) cout << ']' << endl;
 
 #ifdef _WIN32
@@ -59,6 +59,19 @@ int rpcli_do_security_options(void)
 		SCMP_SYS(statx),
 #endif /* __SNR_statx || __NR_statx */
 
+		// Thumbnail pre-generation (-g)
+		SCMP_SYS(getdents), SCMP_SYS(getdents64),	// opendir(), readdir()
+		SCMP_SYS(mkdir), SCMP_SYS(mkdirat),
+		SCMP_SYS(chmod), SCMP_SYS(fchmodat),
+		SCMP_SYS(rename), SCMP_SYS(renameat),
+		SCMP_SYS(unlink), SCMP_SYS(unlinkat),		// FileSystem::delete_file()
+		SCMP_SYS(sched_getaffinity),	// OpenMP
+
+		// Cache index (LibCacheCommon::CacheIndex)
+		SCMP_SYS(flock),
+		SCMP_SYS(pread64),
+		SCMP_SYS(rmdir),
+
 #ifndef NDEBUG
 		// Needed for assert() on some systems.
 		SCMP_SYS(uname),
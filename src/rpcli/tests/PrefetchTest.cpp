@@ -0,0 +1,264 @@
+/***************************************************************************
+ * ROM Properties Page shell extension. (rpcli/tests)                      *
+ * PrefetchTest.cpp: PrefetchCacheKeys() test.                             *
+ *                                                                         *
+ * Copyright (c) 2016-2022 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+
+// rpcli
+#include "prefetchkeys.hpp"
+
+// rp-download
+#include "rp-download/CurlDownloader.hpp"
+#include "rp-download/tests/LocalHttpServer.hpp"
+using RpDownload::CurlDownloader;
+using RpDownload::Tests::LocalHttpServer;
+
+// cURL
+#include <curl/curl.h>
+
+// C includes.
+#include <sys/stat.h>
+#include <unistd.h>
+
+// C includes. (C++ namespace)
+#include <cstdio>
+#include <cstdlib>
+
+// C++ includes.
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <vector>
+using std::string;
+using std::vector;
+
+namespace Rpcli { namespace Tests {
+
+class PrefetchTest : public ::testing::Test
+{
+	protected:
+		PrefetchTest()
+			: m_inFlight(0)
+			, m_maxInFlight(0)
+		{ }
+
+		void SetUp(void) override
+		{
+			char dirname[] = "PrefetchTest.XXXXXX";
+			ASSERT_TRUE(mkdtemp(dirname) != nullptr);
+			m_cacheDir = dirname;
+		}
+
+		void TearDown(void) override
+		{
+			for (const string &filename : m_files) {
+				unlink(filename.c_str());
+			}
+			rmdir(m_cacheDir.c_str());
+		}
+
+		/**
+		 * Start the local HTTP server.
+		 * @param latency Simulated latency, in milliseconds.
+		 */
+		void startServer(unsigned int latency = 0)
+		{
+			m_server.setLatency(latency);
+			ASSERT_TRUE(m_server.start());
+		}
+
+		/**
+		 * Get the local filename for a cache key.
+		 * @param cache_key Cache key.
+		 * @return Local filename.
+		 */
+		string cacheFilename(const string &cache_key) const
+		{
+			string filename = cache_key;
+			std::replace(filename.begin(), filename.end(), '/', '_');
+			return m_cacheDir + '/' + filename;
+		}
+
+		/**
+		 * Prefetch function.
+		 * This mimics CacheManager: files are downloaded from
+		 * the local HTTP server if they aren't already cached.
+		 * @param cache_key Cache key. (Used as the URL path.)
+		 * @param userdata PrefetchTest
+		 * @return PrefetchResult
+		 */
+		static PrefetchResult fetch(const string &cache_key, void *userdata)
+		{
+			PrefetchTest *const test = static_cast<PrefetchTest*>(userdata);
+			const string filename = test->cacheFilename(cache_key);
+			if (access(filename.c_str(), F_OK) == 0) {
+				return PrefetchResult::Cached;
+			}
+
+			const unsigned int inFlight = ++test->m_inFlight;
+			unsigned int maxInFlight = test->m_maxInFlight;
+			while (inFlight > maxInFlight &&
+			       !test->m_maxInFlight.compare_exchange_weak(maxInFlight, inFlight)) { }
+
+			CurlDownloader dl(test->m_server.url(('/' + cache_key).c_str()));
+			const int ret = dl.download();
+			test->m_inFlight--;
+			if (ret != 0) {
+				return PrefetchResult::Failed;
+			}
+
+			FILE *f = fopen(filename.c_str(), "wb");
+			if (!f) {
+				return PrefetchResult::Failed;
+			}
+			const size_t size = fwrite(dl.data(), 1, dl.dataSize(), f);
+			fclose(f);
+			return (size == dl.dataSize() ? PrefetchResult::New : PrefetchResult::Failed);
+		}
+
+		/**
+		 * Prefetch cache keys.
+		 * Downloaded files will be deleted in TearDown().
+		 * @param cache_keys Cache keys.
+		 * @param threads Maximum number of concurrent prefetches.
+		 * @param stats Prefetch statistics.
+		 */
+		void prefetch(const vector<string> &cache_keys, int threads, PrefetchStats &stats)
+		{
+			for (const string &cache_key : cache_keys) {
+				if (!cache_key.empty()) {
+					m_files.push_back(cacheFilename(cache_key));
+				}
+			}
+			PrefetchCacheKeys(cache_keys, threads, fetch, this, stats);
+		}
+
+		static inline unsigned int result(const PrefetchStats &stats, PrefetchResult res)
+		{
+			return stats.results[static_cast<size_t>(res)];
+		}
+
+		LocalHttpServer m_server;
+		string m_cacheDir;
+		vector<string> m_files;
+
+		std::atomic<unsigned int> m_inFlight;
+		std::atomic<unsigned int> m_maxInFlight;
+};
+
+/**
+ * Duplicate cache keys should only be downloaded once.
+ */
+TEST_F(PrefetchTest, deduplicate)
+{
+	startServer();
+
+	// Multiple ROM images often share the same
+	// cache keys, e.g. revisions of the same game.
+	const vector<string> cache_keys = {
+		"data/a.png", "data/b.png", "data/a.png", "",
+		"data/c.png", "data/b.png", "data/a.png",
+	};
+	PrefetchStats stats;
+	prefetch(cache_keys, 4, stats);
+
+	EXPECT_EQ(3U, stats.keys);
+	EXPECT_EQ(3U, stats.duplicates);
+	EXPECT_EQ(3U, result(stats, PrefetchResult::New));
+	EXPECT_EQ(0U, result(stats, PrefetchResult::Cached));
+	EXPECT_EQ(0U, result(stats, PrefetchResult::Failed));
+	EXPECT_EQ(3U, m_server.requests());
+}
+
+/**
+ * New, cached, and failed downloads should be counted separately.
+ */
+TEST_F(PrefetchTest, resultCounts)
+{
+	startServer();
+
+	// Pre-cache one of the files.
+	const string cached_filename = cacheFilename("data/cached.png");
+	FILE *f = fopen(cached_filename.c_str(), "wb");
+	ASSERT_TRUE(f != nullptr);
+	fclose(f);
+
+	const vector<string> cache_keys = {
+		"data/new1.png", "data/cached.png", "missing/1.png",
+		"large/new2.png", "missing/2.png", "data/new3.png",
+	};
+	PrefetchStats stats;
+	prefetch(cache_keys, 4, stats);
+
+	EXPECT_EQ(6U, stats.keys);
+	EXPECT_EQ(0U, stats.duplicates);
+	EXPECT_EQ(3U, result(stats, PrefetchResult::New));
+	EXPECT_EQ(1U, result(stats, PrefetchResult::Cached));
+	EXPECT_EQ(2U, result(stats, PrefetchResult::Failed));
+	EXPECT_EQ(5U, m_server.requests());
+
+	// Prefetching again should only retry the failed downloads.
+	m_server.resetCounters();
+	prefetch(cache_keys, 4, stats);
+	EXPECT_EQ(0U, result(stats, PrefetchResult::New));
+	EXPECT_EQ(4U, result(stats, PrefetchResult::Cached));
+	EXPECT_EQ(2U, result(stats, PrefetchResult::Failed));
+	EXPECT_EQ(2U, m_server.requests());
+}
+
+/**
+ * The number of concurrent downloads should be limited.
+ */
+TEST_F(PrefetchTest, boundedConcurrency)
+{
+	static const int threads = 4;
+	startServer(100);
+
+	vector<string> cache_keys;
+	for (unsigned int i = 0; i < 16; i++) {
+		char buf[32];
+		snprintf(buf, sizeof(buf), "data/file%u.png", i);
+		cache_keys.emplace_back(buf);
+	}
+	PrefetchStats stats;
+	prefetch(cache_keys, threads, stats);
+
+	EXPECT_EQ(16U, result(stats, PrefetchResult::New));
+	EXPECT_LE(m_maxInFlight, static_cast<unsigned int>(threads));
+#ifdef _OPENMP
+	// Downloads should actually run concurrently.
+	EXPECT_GT(m_maxInFlight, 1U);
+#endif /* _OPENMP */
+	printf("Maximum concurrent downloads: %u\n", m_maxInFlight.load());
+}
+
+} }
+
+/**
+ * Test suite main function.
+ */
+int main(int argc, char *argv[])
+{
+	fprintf(stderr, "rpcli test suite: PrefetchCacheKeys() tests.\n\n");
+	fflush(nullptr);
+
+	// Don't use a proxy for the local test server.
+	unsetenv("http_proxy");
+	unsetenv("HTTP_PROXY");
+	unsetenv("all_proxy");
+	unsetenv("ALL_PROXY");
+
+	// cURL must be initialized before using it from multiple threads.
+	curl_global_init(CURL_GLOBAL_DEFAULT);
+
+	// coverity[fun_call_w_exception]: uncaught exceptions cause nonzero exit anyway, so don't warn.
+	::testing::InitGoogleTest(&argc, argv);
+	const int ret = RUN_ALL_TESTS();
+	curl_global_cleanup();
+	return ret;
+}
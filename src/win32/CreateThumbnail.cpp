@@ -54,7 +54,7 @@ HBITMAP CreateThumbnail::rpImageToImgClass(const rp_image *img) const
 	rp_image *tmp_img = nullptr;
 	if (!img->isSquare()) {
 		// Image is non-square.
-		tmp_img = img->squared();
+		tmp_img = img->processed(rp_image::PixelOps().squared());
 		assert(tmp_img != nullptr);
 		if (tmp_img) {
 			const RpGdiplusBackend *const tmp_backend =
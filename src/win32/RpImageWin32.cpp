@@ -325,7 +325,7 @@ HICON RpImageWin32::toHICON(const rp_image *image)
 	rp_image *tmp_img = nullptr;
 	if (!image->isSquare()) {
 		// Image is non-square.
-		tmp_img = image->squared();
+		tmp_img = image->processed(rp_image::PixelOps().squared());
 		if (tmp_img) {
 			image = tmp_img;
 		}
@@ -492,7 +492,7 @@ HICON RpImageWin32::toHICON(HBITMAP hBitmap)
 	HBITMAP hBmpTmp = nullptr;
 	if (!img->isSquare()) {
 		// Image is non-square.
-		rp_image *const tmp_img = img->squared();
+		rp_image *const tmp_img = img->processed(rp_image::PixelOps().squared());
 		if (tmp_img) {
 			UNREF(img);
 			img = tmp_img;